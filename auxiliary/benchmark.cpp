@@ -24,6 +24,7 @@
 #include <iostream>
 #include <string>
 #include <cmath>
+#include <fstream>
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -81,6 +82,66 @@ public:
     }
 };
 
+#if defined(__linux__)
+// the reader util::read_file used before it moved to read(2): an existence
+// check followed by an ifstream that is consumed line by line
+static std::string legacy_read_file(const char* path) {
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        return "";
+    }
+
+    std::ifstream file(path);
+    if (!file) {
+        return "";
+    }
+
+    std::string content;
+    std::string line;
+    while (std::getline(file, line)) {
+        content += line + "\n";
+    }
+
+    return content;
+}
+
+static void benchmark_file_reads() {
+    const char* files[] = { "/proc/iomem", "/proc/modules", "/proc/cpuinfo" };
+    const int rounds = 200;
+
+    std::cout << "File reads (average of " << rounds << " rounds):\n";
+
+    std::string buffer;
+
+    for (const char* path : files) {
+        std::size_t legacy_size = 0;
+        std::size_t current_size = 0;
+
+        uint64_t start = VMAwareBenchmark::get_timestamp();
+        for (int i = 0; i < rounds; i++) {
+            legacy_size += legacy_read_file(path).size();
+        }
+        uint64_t end = VMAwareBenchmark::get_timestamp();
+        const double legacy_time = VMAwareBenchmark::get_elapsed(start, end) / rounds;
+
+        start = VMAwareBenchmark::get_timestamp();
+        for (int i = 0; i < rounds; i++) {
+            current_size += VM::util::read_into(path, buffer).size;
+        }
+        end = VMAwareBenchmark::get_timestamp();
+        const double current_time = VMAwareBenchmark::get_elapsed(start, end) / rounds;
+
+        std::cout << path << " (" << (current_size / rounds) << " bytes):\n"
+            << "    ifstream + getline: " << VMAwareBenchmark::format_duration(legacy_time) << "\n"
+            << "    util::read_into:    " << VMAwareBenchmark::format_duration(current_time) << "\n";
+
+        (void)legacy_size;
+    }
+
+    std::cout << "\n";
+}
+#endif
+
 static void enable_ansi_on_windows() {
 #if defined(_WIN32)
     HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
@@ -103,6 +164,12 @@ int main(void) {
     std::string vm_brand, vm_type;
     uint8_t vm_percent;
 
+    // VMAwareBenchmark VM::cpu::get_identity(), before anything else has built it
+    start = VMAwareBenchmark::get_timestamp();
+    (void)VM::cpu::get_identity();
+    end = VMAwareBenchmark::get_timestamp();
+    const double identity_time = VMAwareBenchmark::get_elapsed(start, end);
+
     // VMAwareBenchmark VM::detect()
     start = VMAwareBenchmark::get_timestamp();
     is_detected = VM::detect();
@@ -136,10 +203,18 @@ int main(void) {
         << "VM::detect():    " << VMAwareBenchmark::format_duration(detect_time) << "\n"
         << "VM::brand():     " << VMAwareBenchmark::format_duration(brand_time) << "\n"
         << "VM::type():      " << VMAwareBenchmark::format_duration(type_time) << "\n"
-        << "VM::percentage(): " << VMAwareBenchmark::format_duration(percent_time) << "\n\n"
+        << "VM::percentage(): " << VMAwareBenchmark::format_duration(percent_time) << "\n"
+        << "CPU identity:    " << VMAwareBenchmark::format_duration(identity_time) << "\n\n"
         << "Benchmark Results (not cached):\n";
 
-    for (const VM::enum_flags technique_enum : VM::technique_vector) {
+    for (uint8_t i = VM::technique_begin; i < VM::technique_end; i++) {
+        // skip the techniques that aren't available on this platform
+        if (VM::core::technique_table()[i].run == nullptr) {
+            continue;
+        }
+
+        const VM::enum_flags technique_enum = static_cast<VM::enum_flags>(i);
+
         start = VMAwareBenchmark::get_timestamp();
 
         VM::check(technique_enum);
@@ -157,5 +232,9 @@ int main(void) {
 
     std::cout << "\n";
 
+#if defined(__linux__)
+    benchmark_file_reads();
+#endif
+
     return 0;
 }
@@ -0,0 +1,47 @@
+/**
+ * ██╗   ██╗███╗   ███╗ █████╗ ██╗    ██╗ █████╗ ██████╗ ███████╗
+ * ██║   ██║████╗ ████║██╔══██╗██║    ██║██╔══██╗██╔══██╗██╔════╝
+ * ██║   ██║██╔████╔██║███████║██║ █╗ ██║███████║██████╔╝█████╗
+ * ╚██╗ ██╔╝██║╚██╔╝██║██╔══██║██║███╗██║██╔══██║██╔══██╗██╔══╝
+ *  ╚████╔╝ ██║ ╚═╝ ██║██║  ██║╚███╔███╔╝██║  ██║██║  ██║███████╗
+ *   ╚═══╝  ╚═╝     ╚═╝╚═╝  ╚═╝ ╚══╝╚══╝ ╚═╝  ╚═╝╚═╝  ╚═╝╚══════╝
+ *
+ *  C++ VM detection library
+ *
+ * ===============================================================
+ *
+ *  Checks that VM::detect<...>() gives the same verdict when the
+ *  techniques were already run by VM::check() as it does for the
+ *  points those results add up to. Exits with 1 on a mismatch.
+ *
+ * ===============================================================
+ *
+ *  - Repository: https://github.com/kernelwernel/VMAware
+ *  - License: MIT
+ */
+
+#include "../src/vmaware.hpp"
+#include <cstdio>
+
+int main() {
+    const VM::enum_flags techniques[] = { VM::HYPERVISOR_BIT, VM::HYPERVISOR_STR, VM::VMID };
+    unsigned points = 0;
+
+    // every result is cached after this, so detect<...>() below only fetches them
+    for (const VM::enum_flags technique : techniques) {
+        if (VM::check(technique)) {
+            points += VM::memo::cache_fetch(technique).points;
+        }
+    }
+
+    const bool expected = (points >= VM::threshold_score);
+    const bool warm = VM::detect<VM::HYPERVISOR_BIT, VM::HYPERVISOR_STR, VM::VMID>();
+
+    const bool expected_high = (points >= VM::high_threshold_score);
+    const bool warm_high = VM::detect<VM::HYPERVISOR_BIT, VM::HYPERVISOR_STR, VM::VMID>(VM::HIGH_THRESHOLD);
+
+    std::printf("detect<...>() after VM::check(): %d, %u points (expected %d)\n", warm, points, expected);
+    std::printf("detect<...>(VM::HIGH_THRESHOLD) after VM::check(): %d (expected %d)\n", warm_high, expected_high);
+
+    return (warm == expected && warm_high == expected_high) ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+/**
+ * ██╗   ██╗███╗   ███╗ █████╗ ██╗    ██╗ █████╗ ██████╗ ███████╗
+ * ██║   ██║████╗ ████║██╔══██╗██║    ██║██╔══██╗██╔══██╗██╔════╝
+ * ██║   ██║██╔████╔██║███████║██║ █╗ ██║███████║██████╔╝█████╗
+ * ╚██╗ ██╔╝██║╚██╔╝██║██╔══██║██║███╗██║██╔══██║██╔══██╗██╔══╝
+ *  ╚████╔╝ ██║ ╚═╝ ██║██║  ██║╚███╔███╔╝██║  ██║██║  ██║███████╗
+ *   ╚═══╝  ╚═╝     ╚═╝╚═╝  ╚═╝ ╚══╝╚══╝ ╚═╝  ╚═╝╚═╝  ╚═╝╚══════╝
+ *
+ *  C++ VM detection library
+ *
+ * ===============================================================
+ *
+ *  Compares util::pattern_matcher against a naive search on random
+ *  needles and buffers, through the scalar path and every SIMD path
+ *  the CPU supports. Exits with 1 on the first mismatch.
+ *
+ * ===============================================================
+ *
+ *  - Repository: https://github.com/kernelwernel/VMAware
+ *  - License: MIT
+ */
+
+#include "../src/vmaware.hpp"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using matcher_t = VM::util::pattern_matcher;
+using pattern_t = VM::util::pattern;
+
+// the bytes that only differ by 0x20 without being letters are the interesting ones
+static const char alphabet[] = "aAbBzZ@`[{]}^~01 \x80\xA0\xC1\xE1";
+
+static bool naive_same(const unsigned char a, const unsigned char b, const bool ignore_case) {
+    if (a == b) {
+        return true;
+    }
+
+    if (!ignore_case) {
+        return false;
+    }
+
+    const bool a_letter = ((a >= 'a' && a <= 'z') || (a >= 'A' && a <= 'Z'));
+    return a_letter && ((a ^ b) == 0x20);
+}
+
+static size_t naive_find(const std::vector<std::string>& needles, const std::string& haystack, const bool ignore_case, const uint64_t skip) {
+    for (size_t i = 0; i < needles.size(); i++) {
+        if ((skip >> i) & 1) {
+            continue;
+        }
+
+        const std::string& needle = needles[i];
+
+        for (size_t position = 0; position + needle.size() <= haystack.size(); position++) {
+            size_t n = 0;
+
+            while (n < needle.size() && naive_same(
+                static_cast<unsigned char>(haystack[position + n]),
+                static_cast<unsigned char>(needle[n]),
+                ignore_case
+            )) {
+                n++;
+            }
+
+            if (n == needle.size()) {
+                return i;
+            }
+        }
+    }
+
+    return matcher_t::MAX_NEEDLES;
+}
+
+// the same as pattern_matcher::find(), except the SIMD level is picked by the caller
+static size_t forced_find(const matcher_t& matcher, const std::string& haystack, const uint64_t skip, const int level) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(haystack.data());
+    const uint64_t all = (matcher.count >= matcher_t::MAX_NEEDLES) ? ~0ULL : ((1ULL << matcher.count) - 1);
+    matcher_t::search_state state = { all & ~skip, matcher_t::MAX_NEEDLES };
+    size_t position = 0;
+
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+    if (level == 2) {
+        position = matcher.scan_avx2(bytes, haystack.size(), state);
+    } else if (level == 1) {
+        position = matcher.scan_ssse3(bytes, haystack.size(), state);
+    }
+#else
+    (void)level;
+#endif
+
+    for (; position < haystack.size() && state.wanted != 0; position++) {
+        matcher.verify(bytes, haystack.size(), position, state);
+    }
+
+    return state.best;
+}
+
+static std::string random_string(std::mt19937& rng, const size_t length) {
+    std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 2);
+    std::string result;
+
+    for (size_t i = 0; i < length; i++) {
+        result += alphabet[pick(rng)];
+    }
+
+    return result;
+}
+
+int main() {
+    std::mt19937 rng(0x564D41);
+    int max_level = 0;
+
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+    max_level = matcher_t::simd_level();
+#endif
+
+    for (int round = 0; round < 20000; round++) {
+        const bool ignore_case = (round % 2 == 0);
+        const size_t needle_count = std::uniform_int_distribution<size_t>(1, (round % 10 == 0) ? 64 : 12)(rng);
+
+        std::vector<std::string> needles;
+        std::vector<pattern_t> list;
+
+        for (size_t i = 0; i < needle_count; i++) {
+            needles.push_back(random_string(rng, std::uniform_int_distribution<size_t>(1, 5)(rng)));
+        }
+
+        for (const std::string& needle : needles) {
+            list.push_back({ needle.c_str(), VM::brand_enum::NULL_BRAND });
+        }
+
+        const matcher_t matcher(list.data(), list.size(), ignore_case);
+        const std::string haystack = random_string(rng, std::uniform_int_distribution<size_t>(0, 200)(rng));
+        const uint64_t skip = (round % 3 == 0) ? static_cast<uint64_t>(rng()) : 0;
+
+        const size_t expected = naive_find(needles, haystack, ignore_case, skip);
+
+        for (int level = 0; level <= max_level; level++) {
+            const size_t actual = forced_find(matcher, haystack, skip, level);
+
+            if (actual != expected) {
+                std::printf("mismatch in round %d at SIMD level %d: expected %zu, got %zu\n", round, level, expected, actual);
+                return 1;
+            }
+        }
+
+        const pattern_t* hit = matcher.find(haystack, skip);
+        const size_t found = (hit == nullptr) ? matcher_t::MAX_NEEDLES : static_cast<size_t>(hit - list.data());
+
+        if (found != expected) {
+            std::printf("mismatch in round %d through find(): expected %zu, got %zu\n", round, expected, found);
+            return 1;
+        }
+    }
+
+    std::printf("pattern_matcher: all rounds matched the naive search (SIMD level %d)\n", max_level);
+    return 0;
+}
@@ -1222,29 +1222,32 @@ static void general(
 static void generate_json(const char* output) {
     std::vector<std::string> json;
 
+    // one evaluation for every field below
+    const VM::vmaware vm;
+
     json.push_back("{");
     json.push_back("\n\t\"is_detected\": ");
-    json.push_back(VM::detect() ? "true," : "false,");
+    json.push_back(vm.is_vm ? "true," : "false,");
     json.push_back("\n\t\"brand\": \"");
-    json.push_back(VM::brand());
+    json.push_back(vm.brand);
     json.push_back("\",");
     json.push_back("\n\t\"conclusion\": \"");
-    json.push_back(VM::conclusion());
+    json.push_back(vm.conclusion);
     json.push_back("\",");
     json.push_back("\n\t\"percentage\": ");
-    json.push_back(std::to_string(static_cast<int>(VM::percentage())));
+    json.push_back(std::to_string(static_cast<int>(vm.percentage)));
     json.push_back(",");
     json.push_back("\n\t\"detected_technique_count\": ");
-    json.push_back(std::to_string(VM::technique_count));
+    json.push_back(std::to_string(vm.technique_count));
     json.push_back(",");
     json.push_back("\n\t\"vm_type\": \"");
-    json.push_back(VM::type());
+    json.push_back(vm.type);
     json.push_back("\",");
     json.push_back("\n\t\"is_hardened\": ");
-    json.push_back(VM::is_hardened() ? "true," : "false,");
+    json.push_back(vm.is_hardened ? "true," : "false,");
     json.push_back("\n\t\"detected_techniques\": [");
 
-    const auto detected_status = VM::detected_enums();
+    const auto& detected_status = vm.detected_techniques;
 
     if (detected_status.size() == 0) {
         json.push_back("]\n}");
@@ -374,9 +374,16 @@
 #include <bitset>
 #include <type_traits>
 #include <stdexcept>
+#include <exception>
+#include <system_error>
 #include <numeric>
 #include <atomic>
 #include <random>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <future>
 
 #if (WINDOWS)
     #include <windows.h>
@@ -389,10 +396,12 @@
     #include <devpkey.h>
     #include <devguid.h>
     #include <winevt.h>
+    #include <objbase.h>
 
     #pragma comment(lib, "setupapi.lib")
     #pragma comment(lib, "powrprof.lib")
     #pragma comment(lib, "wevtapi.lib")
+    #pragma comment(lib, "ole32.lib")
 #elif (LINUX)
     #if (x86)
         #include <cpuid.h>
@@ -400,10 +409,12 @@
         #include <immintrin.h>
     #endif
     #include <sys/stat.h>
+    #include <sys/mman.h>
     #include <sys/statvfs.h>
     #include <sys/ioctl.h>
     #include <sys/syscall.h>
     #include <sys/sysinfo.h>
+    #include <sys/klog.h>
     #include <net/if.h> 
     #include <netinet/in.h>
     #include <unistd.h>
@@ -418,6 +429,18 @@
     #include <pthread.h>     
     #include <sched.h>      
     #include <cerrno>   
+    // batched reads through io_uring are opt-in. procfs and sysfs files can't be read without 
+    // blocking so the kernel hands every request to its worker threads, which costs more time 
+    // than the saved syscalls on most hosts. It's worth it where syscalls are expensive (gVisor, 
+    // heavily audited or seccomp filtered processes)
+    #if defined(__VMAWARE_IO_URING__) && defined(__has_include)
+        #if __has_include(<linux/io_uring.h>)
+            #include <linux/io_uring.h>
+            #if defined(IORING_SETUP_CLAMP) && defined(IOSQE_IO_HARDLINK) && defined(__NR_io_uring_setup)
+                #define VMA_IO_URING 1
+            #endif
+        #endif
+    #endif
 #elif (APPLE)
     #if (x86)
         #include <cpuid.h>
@@ -428,9 +451,10 @@
     #include <sys/sysctl.h>
     #include <sys/user.h>
     #include <unistd.h>
+    #include <fcntl.h>
     #include <time.h>
     #include <errno.h>
-    #include <chrono>
+    #include <sys/stat.h>
 #endif
 
 #ifdef __VMAWARE_DEBUG__
@@ -663,7 +687,10 @@ public:
         // start of settings technique flags (THE ORDERING IS VERY SPECIFIC HERE AND MIGHT BREAK SOMETHING IF RE-ORDERED)
         HIGH_THRESHOLD,
         DYNAMIC,
-        MULTIPLE
+        MULTIPLE,
+        PARALLEL,
+        ADAPTIVE,
+        PERSISTENT
     };
 
     enum class brand_enum : u8 {
@@ -741,14 +768,15 @@ public:
         NULL_BRAND // do not modify the placement for this, as it's used to count the number of brands here
     };
 
-    static constexpr u8 enum_size = MULTIPLE; // get enum size through value of last element
-    static constexpr u8 settings_count = MULTIPLE - HIGH_THRESHOLD + 1; // get number of settings technique flags
+    static constexpr u8 enum_size = PERSISTENT; // get enum size through value of last element
+    static constexpr u8 settings_count = PERSISTENT - HIGH_THRESHOLD + 1; // get number of settings technique flags
     static constexpr u8 INVALID = 255; // explicit invalid technique macro
     static constexpr u16 base_technique_count = HIGH_THRESHOLD; // original technique count, constant on purpose (can also be used as a base count value if custom techniques are added)
     static constexpr u16 threshold_score = 150; // standard threshold score
     static constexpr u16 high_threshold_score = 300; // new threshold score from 150 to 300 if VM::HIGH_THRESHOLD flag is enabled
     static constexpr bool SHORTCUT = true; // macro for whether VM::core::run_all() should take a shortcut by skipping the rest of the techniques if the threshold score is already met
     static constexpr size_t MAX_CUSTOM_TECHNIQUES = 256; // specific to VM::add_custom(), where custom techniques will be stored here
+    static constexpr u8 MAX_PARALLEL_WORKERS = 8; // upper bound of worker threads for VM::core::run_all() if the VM::PARALLEL flag is enabled
     static constexpr size_t MAX_BRANDS = static_cast<size_t>(brand_enum::NULL_BRAND) + 1; // VM scoreboard table specifically for VM::brand()
 
     // intended for loop indexes
@@ -767,10 +795,14 @@ public:
     static constexpr u8 MACOS_START = VM::THREAD_COUNT;
     static constexpr u8 MACOS_END = VM::MAC_SYS;
 
-    // this is specifically meant for VM::detected_count() to 
-    // get the total number of techniques that detected a VM
-    static u8 detected_count_num; 
-    static u16 technique_count; // get total number of techniques
+    // get total number of techniques, this refers to the state of the static 
+    // API (a VM::session keeps its own count, see VM::core::context)
+    static u16 technique_count;
+
+    // the counters of the static API, these used to be plain members before 
+    // VM::session existed and are only kept as aliases for compatibility
+    [[deprecated("Use VM::detected_count() instead")]] static std::atomic<u8>& detected_count_num;
+    [[deprecated("Use VM::skipped_count() instead")]] static std::atomic<u16>& skipped_count_num;
 
     static std::vector<enum_flags> disabled_techniques;
 
@@ -788,6 +820,15 @@ public:
     using brand_list_t = std::vector<brand_element_t>;
     using brand_array_t = std::array<brand_element_t, MAX_BRANDS>;
 
+    // specific to VM::detect_within() and VM::percentage_within(), which might only be based on part of the techniques
+    struct partial_result {
+        bool is_vm;
+        u8 percentage;
+        u16 points;
+        bool timed_out; // whether the time budget ran out before the verdict was decided
+        std::vector<enum_flags> unevaluated; // every enabled technique that wasn't evaluated
+    };
+
     // constructor stuff
     VM() = delete;
     VM(const VM&) = delete;
@@ -831,16 +872,18 @@ public:
         #else
             #define CPUID_COUNT(leaf, subleaf, a_ptr, b_ptr, c_ptr, d_ptr) \
                     do { \
-                        __get_cpuid_count((unsigned)(leaf), (unsigned)(subleaf), (a_ptr), (b_ptr), (c_ptr), (d_ptr)); \
+                        __cpuid_count((unsigned)(leaf), (unsigned)(subleaf), *(a_ptr), *(b_ptr), *(c_ptr), *(d_ptr)); \
                     } while (0)
         #endif
 
-        // cross-platform wrapper for linux and MSVC cpuid
-        static void cpuid
+        // cross-platform wrapper for linux and MSVC cpuid, which executes the instruction every time. 
+        // Only for the checks that depend on the core they run on or on CPUID being a VM exit, 
+        // everything else should go through cpuid() which reads from memo::cpuid_snapshot
+        static void raw_cpuid
         (
             u32& a, u32& b, u32& c, u32& d,
             const u32 a_leaf,
-            const u32 c_leaf = 0xFF  // dummy value if not set manually
+            const u32 c_leaf = 0
         ) {
         #if (x86)
             // may be unmodified for older 32-bit processors, clearing just in case
@@ -851,96 +894,98 @@ public:
 
             unsigned int aa = 0u, bb = 0u, cc = 0u, dd = 0u;
             CPUID_COUNT(a_leaf, c_leaf, &aa, &bb, &cc, &dd);
+            core::mark_cpuid_input();
 
             a = static_cast<u32>(aa);
             b = static_cast<u32>(bb);
             c = static_cast<u32>(cc);
             d = static_cast<u32>(dd);
+        #else
+            VMAWARE_UNUSED(a_leaf);
+            VMAWARE_UNUSED(c_leaf);
         #endif
             return;
         };
 
-        // same as above but for array type parameters (MSVC specific)
         static void cpuid
         (
-            i32 x[4],
+            u32& a, u32& b, u32& c, u32& d,
             const u32 a_leaf,
-            const u32 c_leaf = 0xFF
+            const u32 c_leaf = 0
         ) {
         #if (x86)
-            // may be unmodified for older 32-bit processors, clearing just in case
-            x[0] = 0;
-            x[1] = 0;
-            x[2] = 0;
-            x[3] = 0;
+            u32 regs[4] = { 0, 0, 0, 0 };
 
-            unsigned int aa = 0u, bb = 0u, cc = 0u, dd = 0u;
-            CPUID_COUNT(a_leaf, c_leaf, &aa, &bb, &cc, &dd);
+            // leaves outside the table are executed every time
+            if (!memo::cpuid_snapshot::fetch(a_leaf, c_leaf, regs)) {
+                raw_cpuid(regs[0], regs[1], regs[2], regs[3], a_leaf, c_leaf);
+            }
+
+            core::mark_cpuid_input();
 
-            x[0] = static_cast<i32>(aa);
-            x[1] = static_cast<i32>(bb);
-            x[2] = static_cast<i32>(cc);
-            x[3] = static_cast<i32>(dd);
+            a = regs[0];
+            b = regs[1];
+            c = regs[2];
+            d = regs[3];
+        #else
+            a = 0;
+            b = 0;
+            c = 0;
+            d = 0;
+            VMAWARE_UNUSED(a_leaf);
+            VMAWARE_UNUSED(c_leaf);
         #endif
             return;
         };
 
+        // same as above but for array type parameters (MSVC specific)
+        static void cpuid
+        (
+            i32 x[4],
+            const u32 a_leaf,
+            const u32 c_leaf = 0
+        ) {
+            u32 a = 0, b = 0, c = 0, d = 0;
+            cpuid(a, b, c, d, a_leaf, c_leaf);
+
+            x[0] = static_cast<i32>(a);
+            x[1] = static_cast<i32>(b);
+            x[2] = static_cast<i32>(c);
+            x[3] = static_cast<i32>(d);
+        };
+
         static bool is_leaf_supported(const u32 p_leaf) {
         #if (APPLE) 
             return false;
         #endif
-            bool cached;
-
-            if (memo::leaf_cache::fetch(p_leaf, cached)) {
-                return cached;
-            }
-
             u32 eax = 0, unused = 0;
-            bool supported = false;
 
+            // the highest leaf of each range comes from the snapshot, so this is just a comparison
             if (p_leaf < 0x40000000) {
                 // Standard range: 0x00000000 - 0x3FFFFFFF
                 cpu::cpuid(eax, unused, unused, unused, 0x00000000);
-                debug("CPUID: max standard leaf = ", eax);
-                supported = (p_leaf <= eax);
             }
             else if (p_leaf < 0x80000000) {
                 // Hypervisor range: 0x40000000 - 0x7FFFFFFF
                 cpu::cpuid(eax, unused, unused, unused, cpu::leaf::hypervisor);
-                debug("CPUID: max hypervisor leaf = ", eax);
-                supported = (p_leaf <= eax);
             }
             else if (p_leaf < 0xC0000000) {
                 // Extended range: 0x80000000 - 0xBFFFFFFF
                 cpu::cpuid(eax, unused, unused, unused, cpu::leaf::func_ext);
-                debug("CPUID: max extended leaf = ", eax);
-                supported = (p_leaf <= eax);
             }
             else {
-                supported = false;
+                return false;
             }
 
-            memo::leaf_cache::store(p_leaf, supported);
-            return supported;
+            return (p_leaf <= eax);
         }
 
         [[nodiscard]] static bool is_amd() {
-            constexpr u32 amd_ecx = 0x444d4163; // "cAMD"
-
-            u32 unused, ecx = 0;
-            cpuid(unused, unused, ecx, unused, 0);
-
-            return (ecx == amd_ecx);
+            return (get_identity().vendor == identity_struct::AMD);
         }
 
         [[nodiscard]] static bool is_intel() {
-            constexpr u32 intel_ecx1 = 0x6c65746e; // "ntel"
-            constexpr u32 intel_ecx2 = 0x6c65746f; // "otel", this is because some Intel CPUs have a rare manufacturer string of "GenuineIotel"
-
-            u32 unused, ecx = 0;
-            cpuid(unused, unused, ecx, unused, 0);
-
-            return ((ecx == intel_ecx1) || (ecx == intel_ecx2));
+            return (get_identity().vendor == identity_struct::INTEL);
         }
 
         [[nodiscard]] static const char* get_brand() {
@@ -1008,200 +1053,119 @@ public:
             return std::string(buffer);
         }
 
-        struct stepping_struct {
-            u8 model;
-            u8 family;
-            u8 extmodel;
-        };
-
-        static stepping_struct fetch_steppings() {
-            struct stepping_struct steps {};
-
-            u32 unused, eax = 0;
-            cpu::cpuid(eax, unused, unused, unused, 1);
-            VMAWARE_UNUSED(unused);
-
-            steps.model = ((eax >> 4) & 0b1111);
-            steps.family = ((eax >> 8) & 0b1111);
-            steps.extmodel = ((eax >> 16) & 0b1111);
-
-            return steps;
-        }
-
         // check if the CPU is an intel celeron
-        static bool is_celeron(const stepping_struct steps) {
-            if (!cpu::is_intel()) {
-                return false;
-            }
-
-            constexpr u8 celeron_model = 0xA;
-            constexpr u8 celeron_family = 0x6;
-            constexpr u8 celeron_extmodel = 0x2;
-
-            return (
-                steps.model == celeron_model &&
-                steps.family == celeron_family &&
-                steps.extmodel == celeron_extmodel
-            );
+        static bool is_celeron() {
+            return get_identity().is_celeron;
         }
 
         static bool is_amd_A_series() {
-            if (!cpu::is_amd()) {
-                return false;
-            }
-
-            const model_struct model = get_model();
-            const char* s = model.string.c_str();
-
-            for (; *s; ++s) {
-                if ((*s | 0x20) != 'a') continue;
-
-                // check for "MD A" (case-insensitive match for "AMD A")
-                // We need 5 specific characters following the 'A': 'm', 'd', ' ', 'a', and a digit
-                if (!s[1] || !s[2] || !s[3] || !s[4] || !s[5]) break;
-
-                if ((s[1] | 0x20) == 'm' &&
-                    (s[2] | 0x20) == 'd' &&
-                    s[3] == ' ' &&
-                    (s[4] | 0x20) == 'a') {
-
-                    // we found "AMD A" so now verify pattern [0-9]+-[0-9]+
-                    const char* num = s + 5;
+            return get_identity().is_amd_a_series;
+        }
 
-                    // must have at least one digit immediately after "AMD A"
-                    if (*num < '0' || *num > '9') continue;
-                    do { num++; } while (*num >= '0' && *num <= '9');
-                    if (*num != '-') continue;
-                    num++;
+        // the 12 byte vendor signature as it appears in the registers, so "VMwareVMware" is 
+        // EBX = "VMwa", ECX = "reVM", EDX = "ware" for the hypervisor leaves
+        struct vmid_entry {
+            u32 words[3];
+            enum brand_enum brand;
 
-                    // Must have at least one digit after the hyphen
-                    if (*num >= '0' && *num <= '9') {
-                        return true;
-                    }
-                }
+            // little endian, like the bytes CPUID hands out
+            static constexpr u32 word(const char* s) {
+                return static_cast<u32>(static_cast<u8>(s[0])) |
+                    (static_cast<u32>(static_cast<u8>(s[1])) << 8) |
+                    (static_cast<u32>(static_cast<u8>(s[2])) << 16) |
+                    (static_cast<u32>(static_cast<u8>(s[3])) << 24);
             }
 
-            return false;
-        }
-
-        struct model_struct {
-            bool found;
-            bool is_xeon;
-            bool is_i_series;
-            bool is_ryzen;
-            std::string string;
+            constexpr vmid_entry(const char* signature, const enum brand_enum b)
+                : words{ word(signature), word(signature + 4), word(signature + 8) }, brand(b) {
+            }
         };
 
-        [[nodiscard]] static model_struct get_model() {
-            const std::string brand = get_brand();
-
-            model_struct result { false, false, false, false, {} };
-
-            if (cpu::is_intel()) {
-                // Ultra
-                if (brand.find("Ultra") != std::string::npos &&
-                    brand.find_first_of("0123456789") != std::string::npos) {
-                    result.found = true;
-                    result.string = brand;
-                    return result;
-                }
-
-                // i-series
-                if (brand.find("i") != std::string::npos && brand.find("-") != std::string::npos &&
-                    brand.find_first_of("0123456789") != std::string::npos) {
-                    result.found = true;
-                    result.is_i_series = true;
-                    result.string = brand;
-                    return result;
-                }
+        [[nodiscard]] static bool vmid_template(const u32 p_leaf) {
+            // constant initialised, so there's no guard or allocation on the first call either
+            static constexpr vmid_entry vmids[] = {
+                { "VMwareVMware", brand_enum::VMWARE },
+                { "VBoxVBoxVBox", brand_enum::VBOX },
+                { "TCGTCGTCGTCG", brand_enum::QEMU },
+                { "XenVMMXenVMM", brand_enum::XEN },
+                { "Linux KVM Hv", brand_enum::KVM_HYPERV },
+                { " prl hyperv ", brand_enum::PARALLELS },
+                { " lrpepyh  vr", brand_enum::PARALLELS },
+                { "bhyve bhyve ", brand_enum::BHYVE },
+                { "BHyVE BHyVE ", brand_enum::BHYVE },
+                { "ACRNACRNACRN", brand_enum::ACRN },
+                { " QNXQVMBSQG ", brand_enum::QNX },
+                { "___ NVMM ___", brand_enum::NVMM },
+                { "OpenBSDVMM58", brand_enum::BSD_VMM },
+                { "HAXMHAXMHAXM", brand_enum::INTEL_HAXM },
+                { "UnisysSpar64", brand_enum::UNISYS },
+                { "SRESRESRESRE", brand_enum::LMHS },
+                { "Jailhouse\0\0\0", brand_enum::JAILHOUSE },
+                { "EVMMEVMMEVMM", brand_enum::INTEL_KGT },
+                { "Barevisor!\0\0", brand_enum::BAREVISOR },
+                { "MiniVisor\0\0\0", brand_enum::MINIVISOR },
+                { "IntelTDX    ", brand_enum::INTEL_TDX },
+                { "LKVMLKVMLKVM", brand_enum::LKVM },
+                { "Neko Project", brand_enum::NEKO_PROJECT },
+                { "NoirVisor ZT", brand_enum::NOIRVISOR },
+                { "Compaq FX!32", brand_enum::COMPAQ },
+                { "Insignia 586", brand_enum::INSIGNIA },
+                { "ConnectixCPU", brand_enum::CONNECTIX }
+            };
 
-                // Xeon
-                if (brand.find_first_of("DEW") != std::string::npos && brand.find("-") != std::string::npos &&
-                    brand.find_first_of("0123456789") != std::string::npos) {
-                    result.found = true;
-                    result.is_xeon = true;
-                    result.string = brand;
-                    return result;
-                }
-            }
-            else if (cpu::is_amd()) {
-                if (brand.find("AMD Ryzen") != std::string::npos) {
-                    result.found = true;
-                    result.is_ryzen = true;
-                    result.string = brand;
-                    return result;
-                }
-            }
+            constexpr vmid_entry microsoft_hv = { "Microsoft Hv", brand_enum::INVALID };
 
-            return result;
-        }
+            u32 eax = 0, ebx = 0, ecx = 0, edx = 0;
+            cpuid(eax, ebx, ecx, edx, p_leaf);
 
-        [[nodiscard]] static bool vmid_template(const u32 p_leaf) {
-            const std::string brand_str = cpu_manufacturer(p_leaf);
+            // leaf 0 has the vendor in EBX, EDX, ECX order
+            const u32 words[3] = { ebx, (p_leaf >= 0x40000000) ? ecx : edx, (p_leaf >= 0x40000000) ? edx : ecx };
 
-            if (brand_str == "Microsoft Hv") {
+            if (words[0] == microsoft_hv.words[0] && words[1] == microsoft_hv.words[1] && words[2] == microsoft_hv.words[2]) {
                 if (util::hyper_x() == HYPERV_ARTIFACT_VM) {
                     return false;
                 }
                 return core::add(brand_enum::HYPERV, brand_enum::VPC);
             }
 
-            if (util::find(brand_str, "KVM")) {
-                return core::add(brand_enum::KVM);
+            // the signatures are unique, so at most one entry contributes its brand
+            u8 brand = 0;
+
+            for (const vmid_entry& entry : vmids) {
+                const u32 diff = (words[0] ^ entry.words[0]) | (words[1] ^ entry.words[1]) | (words[2] ^ entry.words[2]);
+                brand |= static_cast<u8>(static_cast<u8>(entry.brand) & (0u - static_cast<u32>(diff == 0)));
             }
 
-            static const std::unordered_map<std::string, enum brand_enum> brand_map = {
-                {"VMwareVMware", brand_enum::VMWARE},
-                {"VBoxVBoxVBox", brand_enum::VBOX},
-                {"TCGTCGTCGTCG", brand_enum::QEMU},
-                {"XenVMMXenVMM", brand_enum::XEN},
-                {"Linux KVM Hv", brand_enum::KVM_HYPERV},
-                {" prl hyperv ", brand_enum::PARALLELS},
-                {" lrpepyh  vr", brand_enum::PARALLELS},
-                {"bhyve bhyve ", brand_enum::BHYVE},
-                {"BHyVE BHyVE ", brand_enum::BHYVE},
-                {"ACRNACRNACRN", brand_enum::ACRN},
-                {" QNXQVMBSQG ", brand_enum::QNX},
-                {"___ NVMM ___", brand_enum::NVMM},
-                {"OpenBSDVMM58", brand_enum::BSD_VMM},
-                {"HAXMHAXMHAXM", brand_enum::INTEL_HAXM},
-                {"UnisysSpar64", brand_enum::UNISYS},
-                {"SRESRESRESRE", brand_enum::LMHS},
-                {"Jailhouse\0\0\0", brand_enum::JAILHOUSE},
-                {"EVMMEVMMEVMM", brand_enum::INTEL_KGT},
-                {"Barevisor!\0\0", brand_enum::BAREVISOR},
-                {"MiniVisor\0\0\0", brand_enum::MINIVISOR},
-                {"IntelTDX    ", brand_enum::INTEL_TDX},
-                {"LKVMLKVMLKVM", brand_enum::LKVM},
-                {"Neko Project", brand_enum::NEKO_PROJECT},
-                {"NoirVisor ZT", brand_enum::NOIRVISOR},
-                {"Compaq FX!32", brand_enum::COMPAQ},
-                {"Insignia 586", brand_enum::INSIGNIA},
-                {"ConnectixCPU", brand_enum::CONNECTIX}
-            };
+            if (brand != 0) {
+                return core::add(static_cast<enum brand_enum>(brand));
+            }
+
+            // the signatures that only have a part in common, treated as a string up to the first NUL
+            char signature[13];
+            std::memcpy(signature, words, sizeof(words));
+            signature[12] = '\0';
 
-            const auto it = brand_map.find(brand_str);
-            if (it != brand_map.end()) {
-                return core::add(it->second);
+            if (std::strstr(signature, "KVM") != nullptr) {
+                return core::add(brand_enum::KVM);
             }
 
-            if (util::find(brand_str, "QXNQSBMV")) {
+            if (std::strstr(signature, "QXNQSBMV") != nullptr) {
                 return core::add(brand_enum::QNX);
             }
 
-            if (util::find(brand_str, "Apple VZ")) {
+            if (std::strstr(signature, "Apple VZ") != nullptr) {
                 return core::add(brand_enum::APPLE_VZ);
             }
 
-            if (util::find(brand_str, "PpyH")) {
+            if (std::strstr(signature, "PpyH") != nullptr) {
                 return core::add(brand_enum::HYPERPLATFORM);
             }
 
             return false;
         }
   
-        // to search in our databases, we want to precompute hashes at compile time for C++11 and later
-        // so we need to match the hardware _mm_crc32_u8, it is based on CRC32-C (Castagnoli) polynomial
+        // to search in our databases, we want to precompute hashes at compile time for C++11 and later.
+        // It is CRC32-C (Castagnoli), and the brand string tokens are hashed with the same functions at runtime
         struct constexpr_hash {
             // it does 8 rounds of CRC32-C bit reflection recursively
             static constexpr u32 crc32_bits(u32 crc, int bits) {
@@ -1225,172 +1189,301 @@ public:
             u32 hash;
             u32 threads;
 
+            constexpr cpu_entry() : hash(0), threads(0) {}
+
             constexpr cpu_entry(const char* m, u32 t)
                 : hash(constexpr_hash::get(m)), threads(t) {
             }
         };
 
-        struct cpu_cache {
-            u32 expected_threads;
-            bool found;
-            const char* debug_tag;
-            std::string model_name;
-        };
+        // a database as an open addressing table indexed by the low bits of the hash, so looking up a 
+        // token is a single probe most of the time instead of a scan over every model. The table is 
+        // at least twice the size of the database, and an empty slot has a hash of 0. From C++14 on 
+        // it's built at compile time, which is also where two models with the same hash, or a model 
+        // that hashes to 0, are caught. With C++11 it's built once at first use
+        template <size_t N>
+        struct cpu_db {
+            static constexpr size_t slot_count(const size_t size, const size_t count = 1) {
+                return (count >= size * 2) ? count : slot_count(size, count * 2);
+            }
 
-        enum class cpu_type {
-            INTEL_I,
-            INTEL_XEON,
-            INTEL_ULTRA,
-            AMD
-        };
+            static constexpr size_t SIZE = slot_count(N);
 
-        static const cpu_cache& analyze_cpu() {
-            static cpu_cache result = { 0, false, "", "" };
-            static bool initialized = false;
+            cpu_entry slots[SIZE];
+            bool unique;
+            bool nonzero; // a model with a hash of 0 would look like an empty slot
 
-            if (initialized) return result;
+            VMAWARE_CONSTEXPR_14 explicit cpu_db(const cpu_entry (&db)[N]) : slots(), unique(true), nonzero(true) {
+                for (size_t i = 0; i < N; i++) {
+                    if (db[i].hash == 0) {
+                        nonzero = false;
+                        continue;
+                    }
 
-            // to save a few cycles
-            struct hasher {
-                static u32 crc32_sw(u32 crc, char data) {
-                    crc ^= static_cast<u8>(data);
-                    for (int i = 0; i < 8; ++i)
-                        crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78u : 0);
-                    return crc;
+                    size_t index = db[i].hash & (SIZE - 1);
+
+                    while (slots[index].hash != 0 && slots[index].hash != db[i].hash) {
+                        index = (index + 1) & (SIZE - 1);
+                    }
+
+                    if (slots[index].hash == db[i].hash) {
+                        unique = false;
+                    }
+
+                    slots[index] = db[i];
                 }
+            }
+        };
 
-                using hashfc = u32(*)(u32, char);
+        // size is the slot count of a cpu_db, which is a power of 2
+        static const cpu_entry* find_entry(const cpu_entry* db, const size_t size, const u32 hash) noexcept {
+            if (size == 0 || hash == 0) {
+                return nullptr;
+            }
 
-                static hashfc get() {
-                    i32 regs[4];
-                    cpu::cpuid(regs, 1);
-                    const bool has_sse42 = (regs[2] & (1 << 20)) != 0;
-                    return has_sse42 ? util::crc32 : crc32_sw;
+            for (size_t index = hash & (size - 1); db[index].hash != 0; index = (index + 1) & (size - 1)) {
+                if (db[index].hash == hash) {
+                    return &db[index];
                 }
+            }
+
+            return nullptr;
+        }
+
+        // everything the techniques compare against about the CPU itself, worked out once from CPUID 
+        // and the brand string. The vendor checks, the model flags and the expected thread count 
+        // are all read from here instead of each of them querying CPUID and copying the brand again
+        struct identity_struct {
+            enum vendor_id : u8 {
+                OTHER_VENDOR,
+                INTEL,
+                AMD
             };
 
-            const cpu_entry* db = nullptr;
-            size_t db_size = 0;
-            size_t max_model_len = 32;
-            cpu_type type;
+            // a key to look up in the thread databases, so "i9" and "i9-11900K" for "i9-11900K"
+            struct token {
+                u32 hash; // CRC32-C, lowercase for AMD like the Ryzen database
+                u8 length;
+            };
 
-            // Detection logic
-            if (is_amd()) {
-                type = cpu_type::AMD;
-                result.model_name = get_brand();
-                result.debug_tag = "AMD_THREAD_MISMATCH";
-                get_amd_ryzen_db(db, db_size);
+            vendor_id vendor;
+            u8 family;   // base fields of leaf 1 EAX
+            u8 model;
+            u8 extmodel;
+            u8 stepping;
+            std::string brand;
+            std::vector<token> tokens;
+
+            bool is_ultra;
+            bool is_i_series;
+            bool is_xeon;
+            bool is_ryzen;
+            bool is_amd_a_series;
+            bool is_celeron;
+
+            bool found; // whether the model is in one of the thread databases
+            u32 expected_threads;
+            const char* debug_tag;
+        };
+
+        static const identity_struct& get_identity() {
+            // never destroyed on purpose, a background thread may still be reading it while 
+            // the process exits and the static destructors run (see core::thread_registry)
+            static const identity_struct& identity = *new identity_struct(make_identity());
+
+            // the record stands in for the CPUID queries the callers would have made themselves
+            core::mark_cpuid_input();
+            return identity;
+        }
+
+        static identity_struct make_identity() {
+            identity_struct result {};
+            result.debug_tag = "";
+
+            constexpr u32 intel_ecx1 = 0x6c65746e; // "ntel"
+            constexpr u32 intel_ecx2 = 0x6c65746f; // "otel", this is because some Intel CPUs have a rare manufacturer string of "GenuineIotel"
+            constexpr u32 amd_ecx = 0x444d4163;    // "cAMD"
+
+            u32 eax = 0, unused = 0, ecx = 0;
+            cpuid(unused, unused, ecx, unused, 0);
+
+            if (ecx == intel_ecx1 || ecx == intel_ecx2) {
+                result.vendor = identity_struct::INTEL;
+            } else if (ecx == amd_ecx) {
+                result.vendor = identity_struct::AMD;
             }
-            else if (is_intel()) {
-                const model_struct model = get_model();
-                if (!model.found) { initialized = true; return result; }
 
-                result.model_name = model.string;
+            cpuid(eax, unused, unused, unused, 1);
 
-                if (result.model_name.find("Ultra") != std::string::npos) {
-                    type = cpu_type::INTEL_ULTRA;
-                    result.debug_tag = "ULTRA_THREAD_MISMATCH";
-                    get_intel_ultra_db(db, db_size);
-                }
-                else if (model.is_i_series) {
-                    type = cpu_type::INTEL_I;
-                    result.debug_tag = "INTEL_THREAD_MISMATCH";
-                    get_intel_core_db(db, db_size);
-                }
-                else if (model.is_xeon) {
-                    type = cpu_type::INTEL_XEON;
-                    result.debug_tag = "XEON_THREAD_MISMATCH";
-                    get_intel_xeon_db(db, db_size);
-                }
-                else { 
-                    initialized = true; 
-                    return result; 
-                }
-                result.model_name = model.string;
+            result.stepping = static_cast<u8>(eax & 0b1111);
+            result.model = static_cast<u8>((eax >> 4) & 0b1111);
+            result.family = static_cast<u8>((eax >> 8) & 0b1111);
+            result.extmodel = static_cast<u8>((eax >> 16) & 0b1111);
+
+            result.brand = get_brand();
+            const std::string& brand = result.brand;
+            const bool has_digit = (brand.find_first_of("0123456789") != std::string::npos);
+
+            if (result.vendor == identity_struct::INTEL) {
+                result.is_ultra = (brand.find("Ultra") != std::string::npos) && has_digit;
+                result.is_i_series = !result.is_ultra && (brand.find("i") != std::string::npos) && 
+                    (brand.find("-") != std::string::npos) && has_digit;
+                result.is_xeon = !result.is_ultra && !result.is_i_series && (brand.find_first_of("DEW") != std::string::npos) && 
+                    (brand.find("-") != std::string::npos) && has_digit;
+
+                constexpr u8 celeron_model = 0xA;
+                constexpr u8 celeron_family = 0x6;
+                constexpr u8 celeron_extmodel = 0x2;
+
+                result.is_celeron = (
+                    result.model == celeron_model &&
+                    result.family == celeron_family &&
+                    result.extmodel == celeron_extmodel
+                );
             }
-            else { 
-                initialized = true; 
-                return result; 
+            else if (result.vendor == identity_struct::AMD) {
+                result.is_ryzen = (brand.find("AMD Ryzen") != std::string::npos);
+                result.is_amd_a_series = has_amd_a_series_name(brand.c_str());
             }
 
-            if (result.model_name.empty() || db == nullptr) { 
-                initialized = true; 
-                return result; 
+            tokenize(result);
+            lookup_threads(result);
+
+            return result;
+        }
+
+        // "AMD A" followed by [0-9]+-[0-9], case insensitive
+        static bool has_amd_a_series_name(const char* s) {
+            for (; *s; ++s) {
+                if ((*s | 0x20) != 'a') continue;
+
+                // We need 5 specific characters following the 'A': 'm', 'd', ' ', 'a', and a digit
+                if (!s[1] || !s[2] || !s[3] || !s[4] || !s[5]) break;
+
+                if ((s[1] | 0x20) == 'm' &&
+                    (s[2] | 0x20) == 'd' &&
+                    s[3] == ' ' &&
+                    (s[4] | 0x20) == 'a') {
+
+                    const char* num = s + 5;
+
+                    // must have at least one digit immediately after "AMD A"
+                    if (*num < '0' || *num > '9') continue;
+                    do { num++; } while (*num >= '0' && *num <= '9');
+                    if (*num != '-') continue;
+                    num++;
+
+                    // Must have at least one digit after the hyphen
+                    if (*num >= '0' && *num <= '9') {
+                        return true;
+                    }
+                }
             }
 
-            const char* str = result.model_name.c_str();
-            size_t best_len = 0;
-            u32 z_series_threads = 0;
+            return false;
+        }
+
+        // every alphanumeric run of the brand string becomes a token, and hyphenated models give one 
+        // token per part so that both "i9" and "i9-11900K" can be looked up
+        static void tokenize(identity_struct& result) {
+            constexpr size_t max_model_len = 32;
+            const bool lowercase = (result.vendor == identity_struct::AMD);
 
-            const auto hash_func = hasher::get();
+            auto is_alnum = [](const char c) noexcept -> bool {
+                return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+            };
+
+            const char* str = result.brand.c_str();
 
             for (size_t i = 0; str[i] != '\0'; ) {
-                char c = str[i];
-                if (!((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))) {
+                if (!is_alnum(str[i])) {
                     i++;
                     continue;
                 }
 
-                u32 current_hash = 0;
-                size_t current_len = 0;
+                u32 hash = 0;
+                size_t length = 0;
                 size_t j = i;
 
-                while (true) {
-                    char k = str[j];
-                    const bool is_valid = (k >= '0' && k <= '9') ||
-                        (k >= 'A' && k <= 'Z') ||
-                        (k >= 'a' && k <= 'z') ||
-                        (k == '-');
-                    if (!is_valid) break;
-
-                    if (current_len >= max_model_len) {
-                        while (str[j] != '\0' && str[j] != ' ') j++;
+                // models have hyphens
+                while (is_alnum(str[j]) || str[j] == '-') {
+                    if (length >= max_model_len) {
+                        while (str[j] != '\0' && str[j] != ' ') j++; // fast forward to space/null
                         break;
                     }
 
-                    // convert to lowercase on-the-fly to match compile-time keys
-                    if (type == cpu_type::AMD && (k >= 'A' && k <= 'Z')) k += 32;
-
-                    current_hash = hash_func(current_hash, k);
-                    current_len++;
-                    j++;
+                    char k = str[j];
 
-                    const char next = str[j];
-                    const bool next_is_alnum = (next >= '0' && next <= '9') ||
-                        (next >= 'A' && next <= 'Z') ||
-                        (next >= 'a' && next <= 'z');
+                    // convert to lowercase to match the compile-time keys
+                    if (lowercase && (k >= 'A' && k <= 'Z')) k += 32;
 
-                    if (!next_is_alnum) {
-                        // Check specific Z1 Extreme token
-                        if (type == cpu_type::AMD && current_hash == 0x3D09D5B4) { 
-                            z_series_threads = 16; 
-                        }
+                    hash = constexpr_hash::crc32_bits(hash ^ static_cast<u8>(k), 8);
+                    length++;
+                    j++;
 
-                        for (size_t idx = 0; idx < db_size; ++idx) {
-                            if (db[idx].hash == current_hash) {
-                                if (current_len > best_len) {
-                                    best_len = current_len;
-                                    result.expected_threads = db[idx].threads;
-                                    result.found = true;
-                                }
-                            }
-                        }
+                    // a token ends where the next character isn't alphanumeric
+                    if (!is_alnum(str[j])) {
+                        result.tokens.push_back({ hash, static_cast<u8>(length) });
                     }
                 }
+
                 i = j;
             }
+        }
+
+        static void lookup_threads(identity_struct& result) {
+            const cpu_entry* db = nullptr;
+            size_t db_size = 0;
 
-            // Z1 Extreme fix
-            if (type == cpu_type::AMD && z_series_threads != 0 && result.expected_threads == 12) {
-                result.expected_threads = z_series_threads;
+            if (result.vendor == identity_struct::AMD) {
+                result.debug_tag = "AMD_THREAD_MISMATCH";
+                get_amd_ryzen_db(db, db_size);
+            }
+            else if (result.is_ultra) {
+                result.debug_tag = "ULTRA_THREAD_MISMATCH";
+                get_intel_ultra_db(db, db_size);
+            }
+            else if (result.is_i_series) {
+                result.debug_tag = "INTEL_THREAD_MISMATCH";
+                get_intel_core_db(db, db_size);
+            }
+            else if (result.is_xeon) {
+                result.debug_tag = "XEON_THREAD_MISMATCH";
+                get_intel_xeon_db(db, db_size);
             }
 
-            initialized = true;
-            return result;
+            if (db == nullptr || result.brand.empty()) {
+                return;
+            }
+
+            size_t best_len = 0;
+            u32 best_hash = 0;
+            bool extreme = false;
+
+            // the longest token wins, so "i9-11900K" over "i9-11900" if both are in there
+            for (const auto& token : result.tokens) {
+                const cpu_entry* entry = find_entry(db, db_size, token.hash);
+
+                if (token.hash == constexpr_hash::get("extreme")) {
+                    extreme = true;
+                }
+
+                if (entry != nullptr && token.length > best_len) {
+                    best_len = token.length;
+                    best_hash = token.hash;
+                    result.expected_threads = entry->threads;
+                    result.found = true;
+                }
+            }
+
+            // "Z1 Extreme" is two tokens, and "extreme" alone doesn't say anything about the model
+            if (result.vendor == identity_struct::AMD && extreme && best_hash == constexpr_hash::get("z1")) {
+                result.expected_threads = 16;
+            }
         }
 
         inline static void get_intel_core_db(const cpu_entry*& out_ptr, size_t& out_size) {
-            static const cpu_entry db[] = {
+            static constexpr cpu_entry db[] = {
                 // i3 series
                 { "i3-1000G1", 4 },
                 { "i3-1000G4", 4 },
@@ -2398,12 +2491,19 @@ public:
                 { "i9-14900H", 32 },
                 { "i9-14901KE", 16 }
             };
-            out_ptr = db;
-            out_size = sizeof(db) / sizeof(cpu_entry);
+        #if (VMA_CPP >= 14)
+            static constexpr cpu_db<sizeof(db) / sizeof(cpu_entry)> table(db);
+            static_assert(table.unique, "INTEL_CORE_DB: two models have the same CRC32-C hash");
+            static_assert(table.nonzero, "INTEL_CORE_DB: a model has a CRC32-C hash of 0");
+        #else
+            static const cpu_db<sizeof(db) / sizeof(cpu_entry)> table(db);
+        #endif
+            out_ptr = table.slots;
+            out_size = sizeof(table.slots) / sizeof(cpu_entry);
         }
 
         inline static void get_intel_xeon_db(const cpu_entry*& out_ptr, size_t& out_size) {
-            static const cpu_entry db[] = {
+            static constexpr cpu_entry db[] = {
                 { "D-1518", 8 },
                 { "D-1520", 8 },
                 { "D-1521", 8 },
@@ -2537,12 +2637,19 @@ public:
                 { "w9-3575X", 88 },
                 { "w9-3595X", 120 }
             };
-            out_ptr = db;
-            out_size = sizeof(db) / sizeof(cpu_entry);
-        }
+        #if (VMA_CPP >= 14)
+            static constexpr cpu_db<sizeof(db) / sizeof(cpu_entry)> table(db);
+            static_assert(table.unique, "INTEL_XEON_DB: two models have the same CRC32-C hash");
+            static_assert(table.nonzero, "INTEL_XEON_DB: a model has a CRC32-C hash of 0");
+        #else
+            static const cpu_db<sizeof(db) / sizeof(cpu_entry)> table(db);
+        #endif
+            out_ptr = table.slots;
+            out_size = sizeof(table.slots) / sizeof(cpu_entry);
+        }
 
         inline static void get_intel_ultra_db(const cpu_entry*& db, size_t& size) {
-            static const cpu_entry intel_ultra[] = {
+            static constexpr cpu_entry intel_ultra[] = {
                 // Series 2 (Arrow Lake - Desktop/Mobile) - No HT on P-Cores
                 { "285K", 24 },
                 { "265K", 20 },
@@ -2571,12 +2678,19 @@ public:
                 { "135U", 14 },
                 { "125U", 14 },
             };
-            db = intel_ultra;
-            size = sizeof(intel_ultra) / sizeof(cpu_entry);
+        #if (VMA_CPP >= 14)
+            static constexpr cpu_db<sizeof(intel_ultra) / sizeof(cpu_entry)> table(intel_ultra);
+            static_assert(table.unique, "INTEL_ULTRA_DB: two models have the same CRC32-C hash");
+            static_assert(table.nonzero, "INTEL_ULTRA_DB: a model has a CRC32-C hash of 0");
+        #else
+            static const cpu_db<sizeof(intel_ultra) / sizeof(cpu_entry)> table(intel_ultra);
+        #endif
+            db = table.slots;
+            size = sizeof(table.slots) / sizeof(cpu_entry);
         }
 
         inline static void get_amd_ryzen_db(const cpu_entry*& out_ptr, size_t& out_size) {
-            static const cpu_entry db[] = {
+            static constexpr cpu_entry db[] = {
                 // 3015/3020
                 { "3015ce", 4 },
                 { "3015e", 4 },
@@ -3076,11 +3190,18 @@ public:
                 { "2650", 2 },
                 { "3850", 4 },
 
-                // Z-Series
+                // Z-Series, "Z1 Extreme" is handled in lookup_threads()
                 { "z1", 12 }
             };
-            out_ptr = db;
-            out_size = sizeof(db) / sizeof(cpu_entry);
+        #if (VMA_CPP >= 14)
+            static constexpr cpu_db<sizeof(db) / sizeof(cpu_entry)> table(db);
+            static_assert(table.unique, "AMD_RYZEN_DB: two models have the same CRC32-C hash");
+            static_assert(table.nonzero, "AMD_RYZEN_DB: a model has a CRC32-C hash of 0");
+        #else
+            static const cpu_db<sizeof(db) / sizeof(cpu_entry)> table(db);
+        #endif
+            out_ptr = table.slots;
+            out_size = sizeof(table.slots) / sizeof(cpu_entry);
         }
     };
 
@@ -3115,6 +3236,11 @@ public:
     }
 
     // memoization
+    // 
+    // every write to the memoized state happens while holding memo::mutex, and 
+    // every cached value is published through an atomic flag with release/acquire 
+    // ordering. This means a cache hit never has to take the lock, while multiple 
+    // threads querying the lib at the same time never run the same technique twice
     struct memo {
         struct data_t {
             bool result;
@@ -3125,2713 +3251,4625 @@ public:
         struct cache_entry {
             bool result;
             u8 points;
-            bool has_value;
+            std::atomic<bool> has_value;
             brand_enum brand_name;
+            bool running; // a thread is evaluating this technique right now (guarded by memo::mutex)
         };
 
-        static std::array<cache_entry, enum_size + 1> cache_table;
+        static std::mutex mutex;
+        static std::condition_variable published; // notified whenever a technique result is published
 
-        static void cache_store(u16 flag, bool result, u8 points, const brand_enum brand = brand_enum::NULL_BRAND) {
+        // same as cache_store(), but the caller must be holding memo::mutex
+        static void cache_publish(u16 flag, bool result, u8 points, const brand_enum brand = brand_enum::NULL_BRAND) {
             if (flag <= enum_size) {
-                cache_table[flag] = { result, points, true, brand };
+                cache_entry& entry = core::current().cache_table[flag];
+                entry.result = result;
+                entry.points = points;
+                entry.brand_name = brand;
+                entry.has_value.store(true, std::memory_order_release);
             }
         }
 
+        static void cache_store(u16 flag, bool result, u8 points, const brand_enum brand = brand_enum::NULL_BRAND) {
+            std::lock_guard<std::mutex> guard(mutex);
+            cache_publish(flag, result, points, brand);
+        }
+
         static bool is_cached(u16 flag) {
             if (flag <= enum_size) {
-                return cache_table[flag].has_value;
+                return core::current().cache_table[flag].has_value.load(std::memory_order_acquire);
             }
             return false;
         }
 
         static data_t cache_fetch(u16 flag) {
-            if (flag <= enum_size && cache_table[flag].has_value) {
-                return { cache_table[flag].result, cache_table[flag].points, true, cache_table[flag].brand_name };
+            if (is_cached(flag)) {
+                const cache_entry& entry = core::current().cache_table[flag];
+                return { entry.result, entry.points, true, entry.brand_name };
             }
             return { false, 0, false, brand_enum::NULL_BRAND };
         }
 
         static void uncache(u16 flag) {
             if (flag <= enum_size) {
-                cache_table[flag].has_value = false;
-                cache_table[flag].brand_name = brand_enum::NULL_BRAND;
+                std::lock_guard<std::mutex> guard(mutex);
+                cache_entry& entry = core::current().cache_table[flag];
+                entry.has_value.store(false, std::memory_order_release);
+                entry.brand_name = brand_enum::NULL_BRAND;
             }
         }
 
-        struct single_brand {
-            static brand_enum brand_cache;
-            static bool cached;
+        // run-once semantics for the techniques. Returns true if the caller should evaluate 
+        // the technique (and later publish it with release_claim() or core::commit()), or 
+        // false if the result got published by another thread, whose result should be used
+        static bool claim(u16 flag) {
+            if (flag > enum_size) {
+                return true;
+            }
+
+            if (is_cached(flag)) {
+                return false;
+            }
+
+            std::unique_lock<std::mutex> guard(mutex);
+
+            cache_entry& entry = core::current().cache_table[flag];
+
+            // wait for whichever thread got here first
+            published.wait(guard, [&entry]() { 
+                return !entry.running; 
+            });
+
+            if (entry.has_value.load(std::memory_order_relaxed)) {
+                return false;
+            }
+
+            entry.running = true;
+            return true;
+        }
+
+        // the caller must be holding memo::mutex
+        static void release_claim(u16 flag) {
+            if (flag <= enum_size) {
+                core::current().cache_table[flag].running = false;
+            }
+        }
 
+        // the brand and conclusion caches below belong to the active core::context, 
+        // so every VM::session gets its own set of them
+        struct single_brand {
             static void store(const brand_enum s) {
-                brand_cache = s;
-                cached = true;
+                core::context& ctx = core::current();
+                std::lock_guard<std::mutex> guard(mutex);
+                if (ctx.single_brand_cached.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                ctx.single_brand = s;
+                ctx.single_brand_cached.store(true, std::memory_order_release);
                 debug("VM::brand(): cached brand string");
             }
 
-            static bool is_cached() { return cached; }
+            static bool is_cached() { return core::current().single_brand_cached.load(std::memory_order_acquire); }
             static brand_enum fetch() { 
                 debug("VM::brand(): returned brand from cache");
-                return brand_cache; 
+                return core::current().single_brand; 
             }
         };
 
         struct multi_brand {
-            static std::string brand_cache;
-            static bool cached;
-
             static void store(const std::string& s) {
-                brand_cache = s;
-                cached = true;
+                core::context& ctx = core::current();
+                std::lock_guard<std::mutex> guard(mutex);
+                if (ctx.multi_brand_cached.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                ctx.multi_brand = s;
+                ctx.multi_brand_cached.store(true, std::memory_order_release);
                 debug("VM::brand(): cached multiple brand string");
             }
 
-            static bool is_cached() { return cached; }
+            static bool is_cached() { return core::current().multi_brand_cached.load(std::memory_order_acquire); }
             static std::string fetch() { 
                 debug("VM::brand(): returned multi brand from cache");
-                return brand_cache; 
+                return core::current().multi_brand; 
             }
         };
 
         struct brand_list {
-            static brand_list_t cache;
-            static bool cached;
-
             static void store(const brand_list_t& list) {
-                cache = list;
-                cached = true;
+                core::context& ctx = core::current();
+                std::lock_guard<std::mutex> guard(mutex);
+                if (ctx.brand_list_cached.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                ctx.brand_list = list;
+                ctx.brand_list_cached.store(true, std::memory_order_release);
                 debug("VM::brand(): cached internal brand list");
             }
 
-            static bool is_cached() { return cached; }
+            static bool is_cached() { return core::current().brand_list_cached.load(std::memory_order_acquire); }
             static brand_list_t fetch() { 
                 debug("VM::brand(): returned internal brand list from cache");
-                return cache;
+                return core::current().brand_list;
             }
         };
 
         // helper specifically for conclusion strings
         struct conclusion {
-            static char cache[512];
-            static bool cached;
             static void store(const char* s) {
-                str_copy(cache, s, sizeof(cache));
-                cached = true;
+                core::context& ctx = core::current();
+                std::lock_guard<std::mutex> guard(mutex);
+                if (ctx.conclusion_cached.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                str_copy(ctx.conclusion, s, sizeof(ctx.conclusion));
+                ctx.conclusion_cached.store(true, std::memory_order_release);
             }
-            static const char* fetch() { return cache; }
+            static bool is_cached() { return core::current().conclusion_cached.load(std::memory_order_acquire); }
+            static const char* fetch() { return core::current().conclusion; }
         };
 
         struct cpu_brand {
             static char brand_cache[128];
-            static bool cached;
+            static std::atomic<bool> cached;
             static void store(const char* s) {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (cached.load(std::memory_order_relaxed)) {
+                    return;
+                }
                 str_copy(brand_cache, s, sizeof(brand_cache));
-                cached = true;
+                cached.store(true, std::memory_order_release);
             }
-            static bool is_cached() { return cached; }
+            static bool is_cached() { return cached.load(std::memory_order_acquire); }
             static const char* fetch() { return brand_cache; }
         };
 
         struct threadcount {
-            static u32 threadcount_cache;
+            static std::atomic<u32> threadcount_cache;
             static u32 fetch() {
-                if (threadcount_cache != 0) {
-                    return threadcount_cache;
+                const u32 cache = threadcount_cache.load(std::memory_order_relaxed);
+                if (cache != 0) {
+                    return cache;
                 }
-                threadcount_cache = std::thread::hardware_concurrency();
-                return threadcount_cache;
+                const u32 count = std::thread::hardware_concurrency();
+                threadcount_cache.store(count, std::memory_order_relaxed);
+                return count;
             }
         };
 
         struct hyperx {
             static hyperx_state state;
-            static bool cached;
+            static std::atomic<bool> cached;
             static hyperx_state fetch() { return state; }
             static void store(const hyperx_state p_state) {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (cached.load(std::memory_order_relaxed)) {
+                    return;
+                }
                 state = p_state;
-                cached = true;
+                cached.store(true, std::memory_order_release);
             }
-            static bool is_cached() { return cached; }
+            static bool is_cached() { return cached.load(std::memory_order_acquire); }
         };
 
-        struct leaf_entry { 
-            u32 leaf; 
-            bool value;
-            bool has_value; 
-        };
+        // every CPUID leaf the techniques read, since under a hypervisor each CPUID instruction is a 
+        // VM exit that costs 1-2 us. The table covers the standard, hypervisor and extended ranges 
+        // with their first few subleaves, flat and indexed by the leaf. A slot is filled the first 
+        // time it's read, so it's one exit per leaf and none for the leaves nobody asks for.
+        // 
+        // Readers don't take the lock. Every slot records the generation it was filled in and is 
+        // only valid while that's the current one, so invalidate() just starts a new generation. 
+        // A refill sets the slot's generation to 0 before rewriting the registers, and a reader 
+        // that sees the generation change across its copy takes the locked path instead (seqlock)
+        struct cpuid_snapshot {
+            static constexpr u32 SUBLEAVES = 4;
+            static constexpr u32 STANDARD_LEAVES = 0x40;
+            static constexpr u32 HYPERVISOR_LEAVES = 0x20; // at both 0x40000000 and 0x40000100
+            static constexpr u32 EXTENDED_LEAVES = 0x40;
+            static constexpr u32 SLOT_COUNT = (STANDARD_LEAVES + (2 * HYPERVISOR_LEAVES) + EXTENDED_LEAVES) * SUBLEAVES;
+
+            static std::array<std::array<std::atomic<u32>, 4>, SLOT_COUNT> slots;
+            static std::array<std::atomic<u32>, SLOT_COUNT> generations; // 0 while empty or being written
+            static std::atomic<u32> generation; // never 0
+            static std::mutex fill_mutex;
+
+            // SLOT_COUNT if the leaf isn't in the table
+            static u32 index(const u32 leaf, const u32 subleaf) noexcept {
+                u32 offset = 0;
+
+                if (leaf < STANDARD_LEAVES) {
+                    offset = leaf;
+                } else if (leaf - 0x40000000u < HYPERVISOR_LEAVES) {
+                    offset = STANDARD_LEAVES + (leaf - 0x40000000u);
+                } else if (leaf - 0x40000100u < HYPERVISOR_LEAVES) {
+                    offset = STANDARD_LEAVES + HYPERVISOR_LEAVES + (leaf - 0x40000100u);
+                } else if (leaf - 0x80000000u < EXTENDED_LEAVES) {
+                    offset = STANDARD_LEAVES + (2 * HYPERVISOR_LEAVES) + (leaf - 0x80000000u);
+                } else {
+                    return SLOT_COUNT;
+                }
+
+                return (subleaf < SUBLEAVES) ? ((offset * SUBLEAVES) + subleaf) : SLOT_COUNT;
+            }
 
-        struct leaf_cache {
-            static constexpr std::size_t CAPACITY = 128;
-            static std::array<leaf_entry, CAPACITY> table;
-            static std::size_t count;      
-            static std::size_t next_index; 
+            // false if the caller has to execute the leaf itself
+            static bool fetch(const u32 leaf, const u32 subleaf, u32 (&out)[4]) {
+                const u32 i = index(leaf, subleaf);
 
-            static bool fetch(u32 leaf, bool& out) {
-                for (std::size_t i = 0; i < count; ++i) {
-                    if (table[i].has_value && table[i].leaf == leaf) { out = table[i].value; return true; }
+                if (i == SLOT_COUNT) {
+                    return false;
                 }
-                return false;
-            }
 
-            static void store(u32 leaf, bool val) {
-                for (std::size_t i = 0; i < count; ++i) {
-                    if (table[i].leaf == leaf) { table[i].value = val; table[i].has_value = true; return; }
+                const u32 seen = generations[i].load(std::memory_order_acquire);
+
+                if (seen == generation.load(std::memory_order_acquire)) {
+                    for (size_t r = 0; r < 4; r++) {
+                        out[r] = slots[i][r].load(std::memory_order_relaxed);
+                    }
+
+                    std::atomic_thread_fence(std::memory_order_acquire);
+
+                    if (generations[i].load(std::memory_order_relaxed) == seen) {
+                        return true;
+                    }
                 }
-                if (count < CAPACITY) {
-                    table[count++] = { leaf, val, true };
-                    return;
+
+                std::lock_guard<std::mutex> guard(fill_mutex);
+                const u32 current = generation.load(std::memory_order_relaxed);
+
+                if (generations[i].load(std::memory_order_relaxed) != current) {
+                    u32 regs[4] = { 0, 0, 0, 0 };
+                    cpu::raw_cpuid(regs[0], regs[1], regs[2], regs[3], leaf, subleaf);
+
+                    generations[i].store(0, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_release);
+
+                    for (size_t r = 0; r < 4; r++) {
+                        slots[i][r].store(regs[r], std::memory_order_relaxed);
+                    }
+
+                    generations[i].store(current, std::memory_order_release);
+                }
+
+                // writers hold the lock, so this copy can't be torn
+                for (size_t r = 0; r < 4; r++) {
+                    out[r] = slots[i][r].load(std::memory_order_relaxed);
+                }
+
+                return true;
+            }
+
+            static void invalidate() {
+                std::lock_guard<std::mutex> guard(fill_mutex);
+
+                if (generation.fetch_add(1, std::memory_order_release) + 1 == 0) {
+                    generation.store(1, std::memory_order_release);
                 }
-                // otherwise evict in round-robin fashion
-                table[next_index] = { leaf, val, true };
-                next_index = (next_index + 1) % CAPACITY;
             }
         };
 
         struct bios_info {
             static char manufacturer[256];
             static char model[128];
-            static bool cached;
-
-            static void store_manufacturer(const char* s) noexcept {
-                if (!s) { manufacturer[0] = '\0'; return; }
-                const size_t n = strlen(s);
-                const size_t cap = sizeof(manufacturer) - 1;
-                const size_t tocopy = (n > cap) ? cap : n;
-                memcpy(manufacturer, s, tocopy);
-                manufacturer[tocopy] = '\0';
-                cached = true;
-            }
-            static void store_model(const char* s) noexcept {
-                if (!s) { model[0] = '\0'; return; }
-                const size_t n = strlen(s);
-                const size_t cap = sizeof(model) - 1;
-                const size_t tocopy = (n > cap) ? cap : n;
-                memcpy(model, s, tocopy);
-                model[tocopy] = '\0';
-                cached = true;
-            }
-
-            static bool is_cached() noexcept { return cached; }
+            static std::atomic<bool> cached;
+
+            // both strings are published together, so a reader never sees only one of them
+            static void store(const char* p_manufacturer, const char* p_model) {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (cached.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                str_copy(manufacturer, p_manufacturer ? p_manufacturer : "", sizeof(manufacturer));
+                str_copy(model, p_model ? p_model : "", sizeof(model));
+                cached.store(true, std::memory_order_release);
+            }
+
+            static bool is_cached() noexcept { return cached.load(std::memory_order_acquire); }
             static const char* fetch_manufacturer() noexcept { return manufacturer; }
             static const char* fetch_model() noexcept { return model; }
         };
 
-        struct hardened {
-            static bool result;
-            static bool cached;
-        };
-    };
+        // measured execution cost of each technique in microseconds, specific to 
+        // the VM::ADAPTIVE flag. If VM::PERSISTENT is set as well, these are saved 
+        // per host and per user (Linux only), so the ordering of the techniques gets 
+        // more accurate the more the lib is used. Only techniques that ran on the 
+        // calling thread are measured, as the parallel workers compete with each other
+        struct technique_cost {
+            static std::array<std::atomic<u32>, enum_size + 1> table;
+            static bool loaded; // guarded by memo::mutex
+            static std::atomic<bool> dirty;
+
+            // rough estimate for techniques that haven't been measured yet, 
+            // the cpuid ones are practically free compared to the rest
+            static u32 estimate(const u16 flag) noexcept {
+                switch (flag) {
+                    case HYPERVISOR_BIT:
+                    case HYPERVISOR_STR:
+                    case VMID:
+                    case CPU_BRAND:
+                    case CPUID_SIGNATURE:
+                    case BOCHS_CPU:
+                    case KGT_SIGNATURE:
+                        return 1;
+                    default:
+                        return 1000;
+                }
+            }
 
-    // miscellaneous functionalities
-    struct util {
-        static bool is_unsupported(const VM::enum_flags flag) {
-            // cross platform?
-            if (
-                (flag >= VM::HYPERVISOR_BIT) &&
-                (flag <= VM::KGT_SIGNATURE)
-            ) {
-                return false;
+            static u32 fetch(const u16 flag) noexcept {
+                if (flag > enum_size) {
+                    return estimate(flag);
+                }
+
+                const u32 micros = table[flag].load(std::memory_order_relaxed);
+                return (micros != 0) ? micros : estimate(flag);
             }
 
-            #if (LINUX)
-                return (!(
-                    (flag >= LINUX_START) &&
-                    (flag <= LINUX_END)
-                ));
-            #elif (WINDOWS)
-                return (!(
-                    (flag >= WINDOWS_START) &&
-                    (flag <= WINDOWS_END)
-                ));
-            #elif (APPLE) 
-                return (!(
-                    (flag >= MACOS_START) &&
-                    (flag <= MACOS_END)
-                ));
-            #else
-                return false;
-            #endif
-        }
+            // smooth out the noise of a single measurement with the previous ones
+            static void record(const u16 flag, u32 micros) noexcept {
+                if (flag > enum_size) {
+                    return;
+                }
 
-    #if (LINUX)
-        // fetch file data
-        [[nodiscard]] static std::string read_file(const char* raw_path) {
-            std::string path = "";
-            const std::string raw_path_str = raw_path;
+                if (micros == 0) {
+                    micros = 1;
+                }
+
+                const u32 previous = table[flag].load(std::memory_order_relaxed);
+                table[flag].store((previous == 0) ? micros : static_cast<u32>((static_cast<u64>(previous) * 3 + micros) / 4), std::memory_order_relaxed);
+                dirty.store(true, std::memory_order_relaxed);
+            }
+
+        #if (LINUX)
+            static constexpr u32 MAGIC = 0x54534F43; // "COST"
+
+            // a fixed-size table of microseconds, indexed by the technique enum
+            struct image {
+                u32 magic;
+                u32 count;
+                u32 micros[base_technique_count];
+            };
+
+            static std::string directory() {
+                const char* xdg = std::getenv("XDG_CACHE_HOME");
+                if (xdg && xdg[0] == '/') {
+                    return std::string(xdg) + "/vmaware";
+                }
 
-            // replace the "~" part with the home directory
-            if (raw_path[0] == '~') {
                 const char* home = std::getenv("HOME");
-                if (home) {
-                    path = std::string(home) + raw_path_str.substr(1);
+                if (home && home[0] == '/') {
+                    return std::string(home) + "/.cache/vmaware";
                 }
-            } else {
-                path = raw_path;
-            }
 
-            if (!exists(path.c_str())) {
                 return "";
             }
+        #endif
 
-            std::ifstream file{};
-            std::string data{};
-            std::string line{};
+            // the technique count is part of the header, so a table 
+            // written by a different version of the lib is ignored
+            static void load() {
+            #if (LINUX)
+                std::lock_guard<std::mutex> guard(mutex);
 
-            file.open(path);
+                if (loaded) {
+                    return;
+                }
 
-            if (file.is_open()) {
-                while (std::getline(file, line)) {
-                    data += line + "\n";
+                loaded = true;
+
+                const std::string dir = directory();
+                if (dir.empty()) {
+                    return;
                 }
-            }
 
-            file.close();
-            return data;
-        }
+                std::string buffer;
+                if (!util::append_file((dir + "/technique_costs").c_str(), buffer)) {
+                    return;
+                }
 
-        [[nodiscard]] static bool exists(const char* path) {
-        #if (VMA_CPP >= 17)
-            return std::filesystem::exists(path);
-        #elif (VMA_CPP >= 11)
-            struct stat buffer;
-            return (stat(path, &buffer) == 0);
-        #endif
-        }
+                if (buffer.size() != sizeof(image)) {
+                    debug("ADAPTIVE: ignoring stale technique cost file");
+                    return;
+                }
 
-        static bool is_directory(const char* path) {
-            struct stat info;
-            if (stat(path, &info) != 0) {
-                return false;
-            }
-            return (info.st_mode & S_IFDIR); // check if directory
-        };
-    #endif
+                image img;
+                std::memcpy(&img, buffer.data(), sizeof(image));
 
-        // fetch the file but in binary form
-        [[nodiscard]] static std::vector<u8> read_file_binary(const char* file_path) {
-            std::ifstream file(file_path, std::ios::binary);
+                if (img.magic != MAGIC || img.count != base_technique_count) {
+                    debug("ADAPTIVE: ignoring stale technique cost file");
+                    return;
+                }
 
-            if (!file) {
-                return {};
+                for (u16 i = 0; i < base_technique_count; i++) {
+                    if (img.micros[i] != 0 && table[i].load(std::memory_order_relaxed) == 0) {
+                        table[i].store(img.micros[i], std::memory_order_relaxed);
+                    }
+                }
+            #endif
             }
 
-            std::vector<u8> buffer;
-            std::istreambuf_iterator<char> it(file);
-            std::istreambuf_iterator<char> end;
+            // written to a temporary file first, so readers never see a partial table
+            static void save() {
+                if (!dirty.exchange(false)) {
+                    return;
+                }
 
-            while (it != end) {
-                buffer.push_back(static_cast<u8>(*it));
-                ++it;
-            }
+            #if (LINUX)
+                std::lock_guard<std::mutex> guard(mutex);
 
-            file.close();
+                const std::string dir = directory();
+                if (dir.empty()) {
+                    return;
+                }
 
-            return buffer;
-        }
+                image img;
+                std::memset(&img, 0, sizeof(image));
+                img.magic = MAGIC;
+                img.count = base_technique_count;
 
+                for (u16 i = 0; i < base_technique_count; i++) {
+                    img.micros[i] = table[i].load(std::memory_order_relaxed);
+                }
 
-        // wrapper for std::make_unique because it's not available for C++11
-        template<typename T, typename... Args>
-        [[nodiscard]] static std::unique_ptr<T> make_unique(Args&&... args) {
-        #if (VMA_CPP < 14)
-            return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
-        #else
-            return std::make_unique<T>(std::forward<Args>(args)...);
-        #endif
-        }
+                const std::size_t parent = dir.rfind('/');
+                if (parent != std::string::npos && parent != 0) {
+                    mkdir(dir.substr(0, parent).c_str(), 0700);
+                }
+                mkdir(dir.c_str(), 0700);
 
+                const std::string path = dir + "/technique_costs";
+                const std::string temp = path + "." + std::to_string(getpid());
 
-        [[nodiscard]] static bool is_admin() noexcept {
-        #if (LINUX || APPLE)
-            const uid_t uid = getuid();
-            const uid_t euid = geteuid();
+                const int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+                if (fd < 0) {
+                    return;
+                }
 
-            return (
-                (uid != euid) ||
-                (euid == 0)
-            );
-        #elif (WINDOWS)
-            bool is_admin = false;
-            HANDLE hToken = nullptr;
-            const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
-            if (OpenProcessToken(current_process, TOKEN_QUERY, &hToken)) {
-                TOKEN_ELEVATION elevation{};
-                DWORD dwSize;
-                if (GetTokenInformation(hToken, TokenElevation, &elevation, sizeof(elevation), &dwSize)) {
-                    if (elevation.TokenIsElevated)
-                        is_admin = true;
+                const ssize_t written = write(fd, &img, sizeof(image));
+                close(fd);
+
+                if (written != static_cast<ssize_t>(sizeof(image)) || rename(temp.c_str(), path.c_str()) != 0) {
+                    unlink(temp.c_str());
                 }
-                CloseHandle(hToken);
+            #endif
             }
-            return is_admin;
-        #else
-            return true;
-        #endif
-        }
+        };
 
+        // cross-process cache of the technique results, specific to the VM::PERSISTENT flag. 
+        // The image is a fixed-size POD that gets mapped directly, and it's only valid for 
+        // the same boot, the same build of the lib and the same flag combination. The 
+        // environment can't change from being a VM to baremetal without a reboot after all.
+        // Root processes use /run/vmaware, while others use $XDG_RUNTIME_DIR/vmaware.
+        // This is only supported on Linux, as it relies on the kernel's boot id.
+        struct persistent {
+            static constexpr u32 MAGIC = 0x4D564D41; // "AMVM"
+            static constexpr u32 FORMAT = 2;
+
+            struct entry {
+                u8 has_value;
+                u8 result;
+                u8 points;
+                u8 brand;
+            };
 
-        [[nodiscard]] static bool find(const std::string& base_str, const char* keyword) noexcept {
-            return (base_str.find(keyword) != std::string::npos);
-        };
+            struct image {
+                u32 magic;
+                u32 format;
+                u64 build; // see build_id()
+                char boot_id[40];
+                u32 checksum; // of the technique points, so VM::modify_score() invalidates the image
+                u8 flags[(enum_size + 1 + 7) / 8];
+                u8 detected_count;
+                u8 cpu_brand_cached;
+                u8 bios_cached;
+                entry entries[enum_size + 1];
+                brand_score_t scores[MAX_BRANDS];
+                char cpu_brand[128];
+                char manufacturer[256];
+                char model[128];
+            };
 
-        static std::string narrow_wide(const wchar_t* wstr) {
-            if (!wstr) return std::string{};
-            std::wstring ws(wstr);
-            std::string result;
-            result.reserve(ws.size());
-            for (wchar_t wc : ws) {
-                result.push_back((wc >= 0 && wc < 128)
-                    ? static_cast<char>(wc)
-                    : '?');
-            }
-            return result;
-        }
+            static bool attempted; // guarded by memo::mutex
+            static u16 published_count; // number of techniques in the last image that was loaded or saved (guarded by memo::mutex)
 
-        // choose correct << or narrow for each type
-        static void write_arg_impl(std::ostream& os, const wchar_t* arg) {
-            os << narrow_wide(arg);
-        }
-        static void write_arg_impl(std::ostream& os, wchar_t* arg) {
-            os << narrow_wide(arg);
-        }
+        #if (LINUX)
+            // identifies the build of the lib, so that an image written by another build is never 
+            // trusted, since the techniques themselves might behave differently. That's the technique 
+            // list along with the binary the lib was compiled into, which is found through 
+            // /proc/self/maps so it's the right one even if the lib is part of a shared library
+            static u64 build_id() {
+                u64 hash = util::fingerprint(nullptr, 0);
+
+                for (const auto& entry : core::technique_list) {
+                    const u32 fields[2] = { static_cast<u32>(entry.id), entry.tech.points };
+                    hash = util::fingerprint(fields, sizeof(fields), hash);
+                }
 
-        static void write_arg_impl(std::ostream& os, const std::wstring& ws) {
-            os << narrow_wide(ws.c_str());
-        }
+                std::string maps;
+                if (!util::append_file("/proc/self/maps", maps)) {
+                    return hash;
+                }
 
-        // everything else that is not std::string or wchar_t
-        template <typename T>
-        static typename std::enable_if<!std::is_convertible<T, std::wstring>::value
-            && !std::is_same<typename std::decay<T>::type, wchar_t*>::value,
-            void>::type
-            write_arg_impl(std::ostream& os, T&& arg) {
-            os << std::forward<T>(arg);
-        }
-
-        // variadic pack printer for C++11
-        static inline void print_to_stream(std::ostream& /*unused*/) noexcept {}
-
-        // forward the first, then expand the rest in an initializer list
-        template <typename T, typename... Args>
-        static void print_to_stream(std::ostream& os,
-            T&& first,
-            Args&&... args) noexcept
-        {
-            write_arg_impl(os, std::forward<T>(first));
-            // trick to expand the pack
-            using expander = int[];
-            (void)expander {
-                0, ((void)write_arg_impl(os, std::forward<Args>(args)), 0)...
-            };
-        }
+                const uintptr_t self = reinterpret_cast<uintptr_t>(&build_id);
+                std::size_t start = 0;
 
-        template <typename... Args>
-        static inline void debug_msg(Args&&... message) noexcept {
-            static std::unordered_set<std::string> printed_messages;
+                while (start < maps.size()) {
+                    std::size_t end = maps.find('\n', start);
+                    if (end == std::string::npos) {
+                        end = maps.size();
+                    }
 
-            std::stringstream ss;
-            print_to_stream(ss, std::forward<Args>(message)...);
-            std::string msg_content = ss.str();
+                    // "begin-end perms offset dev inode path"
+                    const std::string line = maps.substr(start, end - start);
+                    start = end + 1;
 
-            if (printed_messages.find(msg_content) == printed_messages.end()) {
-        #if (LINUX || APPLE)
-                constexpr const char* black_bg = "\x1B[48;2;0;0;0m";
-                constexpr const char* bold = "\033[1m";
-                constexpr const char* blue = "\x1B[38;2;00;59;193m";
-                constexpr const char* ansiexit = "\x1B[0m";
+                    char* cursor = nullptr;
+                    const uintptr_t begin = static_cast<uintptr_t>(std::strtoull(line.c_str(), &cursor, 16));
+                    const uintptr_t finish = static_cast<uintptr_t>(std::strtoull(cursor + 1, nullptr, 16));
 
-                std::cout.setf(std::ios::fixed, std::ios::floatfield);
-                std::cout.setf(std::ios::showpoint);
+                    if (self < begin || self >= finish) {
+                        continue;
+                    }
 
-                std::cout << black_bg
-                    << bold << "["
-                    << blue << "DEBUG"
-                    << ansiexit << bold << black_bg << "]"
-                    << ansiexit << " ";
-        #else
-                std::cout << "[DEBUG] ";
-        #endif
-                std::cout << msg_content;
-                std::cout << std::dec << "\n";
+                    const std::size_t path = line.find('/');
+                    if (path == std::string::npos) {
+                        break;
+                    }
 
-                printed_messages.insert(std::move(msg_content));
-            }
-        }
+                    // the device and inode of the mapping (the addresses change with ASLR), plus the size and mtime of the file
+                    char device[32] = { 0 };
+                    unsigned long long inode = 0;
 
+                    if (std::sscanf(line.c_str(), "%*s %*s %*s %31s %llu", device, &inode) == 2) {
+                        hash = util::fingerprint(device, std::strlen(device), hash);
+                        hash = util::fingerprint(&inode, sizeof(inode), hash);
+                    }
 
-        [[nodiscard]] static std::unique_ptr<std::string> sys_result(const char* cmd) {
-        #if (VMA_CPP < 14)
-            VMAWARE_UNUSED(cmd);
-            return util::make_unique<std::string>();
-        #else
-            #if (LINUX || APPLE)
-                struct file_deleter {
-                    void operator()(FILE* f) const noexcept {
-                        if (f) {
-                            pclose(f);
+                    struct stat info{};
+                    if (stat(line.c_str() + path, &info) == 0) {
+                        const u64 fields[3] = { 
+                            static_cast<u64>(info.st_size), 
+                            static_cast<u64>(info.st_mtim.tv_sec), 
+                            static_cast<u64>(info.st_mtim.tv_nsec) 
                         };
+                        hash = util::fingerprint(fields, sizeof(fields), hash);
                     }
-                };
 
-                std::unique_ptr<FILE, file_deleter> pipe(popen(cmd, "r"), file_deleter());
-                if (!pipe) {
-                    return util::make_unique<std::string>();
+                    break;
                 }
 
-                std::string result;
-                char* line = nullptr;
+                return hash;
+            }
 
-                // to ensure line is freed even if string::append throws std::bad_alloc
-                struct line_guard {
-                    char*& ptr;
-                    ~line_guard() { if (ptr) free(ptr); }
-                } guard{ line };
+            // fill in everything that identifies the image, except for the results themselves
+            static bool make_key(image& img, const flagset& flags) {
+                std::memset(&img, 0, sizeof(image));
 
-                size_t len = 0;
-                ssize_t nread;
+                static const u64 build = build_id();
 
-                while ((nread = getline(&line, &len, pipe.get())) != -1) {
-                    result.append(line, static_cast<size_t>(nread));
-                }
+                img.magic = MAGIC;
+                img.format = FORMAT;
+                img.build = build;
 
-                if (!result.empty() && result.back() == '\n') {
-                    result.pop_back();
+                const int fd = open("/proc/sys/kernel/random/boot_id", O_RDONLY | O_CLOEXEC);
+                if (fd < 0) {
+                    return false;
                 }
 
-                return util::make_unique<std::string>(std::move(result));
-            #else
-                VMAWARE_UNUSED(cmd);
-                return std::make_unique<std::string>();
-            #endif
-        #endif
-        }
+                const ssize_t length = read(fd, img.boot_id, sizeof(img.boot_id) - 1);
+                close(fd);
 
+                if (length <= 0) {
+                    return false;
+                }
 
-        [[nodiscard]] static bool is_proc_running(const char* executable) {
-        #if (LINUX)
-            #if (VMA_CPP >= 17)
-                for (const auto& entry : std::filesystem::directory_iterator("/proc")) {
-                    if (!entry.is_directory()) {
-                        continue;
-                    }
+                img.boot_id[length] = '\0';
 
-                    const std::string filename = entry.path().filename().string();
-            #else
-                std::unique_ptr<DIR, decltype(&closedir)> dir(opendir("/proc"), closedir);
-                if (!dir) {
-                    debug("util::is_proc_running: ", "failed to open /proc directory");
-                    return false;
+                u32 checksum = 0;
+                for (u8 i = technique_begin; i < technique_end; i++) {
+                    checksum = (checksum * 31) + core::technique_table()[i].points;
                 }
+                img.checksum = checksum;
 
-                struct dirent* entry;
-                while ((entry = readdir(dir.get())) != nullptr) {
-                    std::string filename(entry->d_name);
-                    if (filename == "." || filename == "..") {
-                        continue;
+                for (size_t i = 0; i < flags.size(); i++) {
+                    if (flags.test(i)) {
+                        img.flags[i / 8] = static_cast<u8>(img.flags[i / 8] | (1u << (i % 8)));
                     }
-            #endif
-                if (!std::all_of(filename.begin(), filename.end(), [](u8 c) { return std::isdigit(c); })) {
-                    continue;
                 }
 
-                const std::string cmdline_file = "/proc/" + filename + "/cmdline";
+                return true;
+            }
 
-                // read raw bytes (binary) to preserve embedded NULs
-                std::ifstream ifs(cmdline_file, std::ios::in | std::ios::binary);
-                if (!ifs.is_open()) {
-                    continue;
+            static std::string directory() {
+                if (geteuid() == 0) {
+                    return "/run/vmaware";
                 }
 
-                // read entire file into vector<char>
-                std::vector<char> buf((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
-                ifs.close();
-
-                if (buf.empty()) {
-                    continue;
+                const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+                if (runtime && runtime[0] == '/') {
+                    return std::string(runtime) + "/vmaware";
                 }
 
-                // cmdline is argv0\0argv1\0..., so argv0 is bytes up to first NUL
-                const auto it_nul = std::find(buf.begin(), buf.end(), '\0');
-                if (it_nul == buf.begin()) {
-                    continue;
+                return "";
+            }
+
+            static bool same_key(const image& a, const image& b) {
+                return (
+                    (a.magic == b.magic) &&
+                    (a.format == b.format) &&
+                    (a.build == b.build) &&
+                    (std::memcmp(a.boot_id, b.boot_id, sizeof(a.boot_id)) == 0) &&
+                    (a.checksum == b.checksum) &&
+                    (std::memcmp(a.flags, b.flags, sizeof(a.flags)) == 0)
+                );
+            }
+
+            // only accepted from root or from the current user, so nobody else can forge a verdict
+            static bool try_load(const std::string& path, const image& key) {
+                const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0) {
+                    return false;
                 }
 
-                std::string argv0(buf.begin(), it_nul);
-                if (argv0.empty()) {
-                    continue;
+                struct stat info{};
+                if (
+                    (fstat(fd, &info) != 0) ||
+                    (static_cast<size_t>(info.st_size) != sizeof(image)) ||
+                    (info.st_uid != 0 && info.st_uid != geteuid())
+                ) {
+                    close(fd);
+                    return false;
                 }
 
-                // extract basename of argv0
-                const std::size_t slash_index = argv0.find_last_of('/');
-                std::string basename = (slash_index == std::string::npos) ? argv0 : argv0.substr(slash_index + 1);
+                void* mapping = mmap(nullptr, sizeof(image), PROT_READ, MAP_PRIVATE, fd, 0);
+                close(fd);
 
-                if (basename != executable) {
-                    continue;
+                if (mapping == MAP_FAILED) {
+                    return false;
                 }
 
-                return true;
-            }
+                const image& img = *static_cast<const image*>(mapping);
+                bool loaded = false;
 
-            return false;
-        #else
-            VMAWARE_UNUSED(executable);
-            return false;
-        #endif
-        }
+                if (same_key(img, key)) {
+                    u16 count = 0;
 
+                    for (size_t i = 0; i <= enum_size; i++) {
+                        const entry& e = img.entries[i];
 
-        [[nodiscard]] static bool is_running_under_translator() {
-        #if (WINDOWS && _WIN32_WINNT >= _WIN32_WINNT_WIN10)
-            const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
-            USHORT procMachine = 0, nativeMachine = 0;
-            const auto pIsWow64Process2 = &IsWow64Process2;
+                        // the file is trusted, but not to the point of casting an out of range brand
+                        if (e.has_value && e.brand >= MAX_BRANDS) {
+                            debug("PERSISTENT: ignoring an entry with an invalid brand in ", path);
+                            continue;
+                        }
 
-            if (pIsWow64Process2(current_process, &procMachine, &nativeMachine)) {
-                if (nativeMachine == IMAGE_FILE_MACHINE_ARM64 &&
-                    (procMachine == IMAGE_FILE_MACHINE_AMD64 || procMachine == IMAGE_FILE_MACHINE_I386)) {
-                    debug("Translator detected x64/x86 process on ARM64");
-                    return true;
-                }
-            }
+                        if (e.has_value) {
+                            cache_publish(static_cast<u16>(i), e.result != 0, e.points, static_cast<brand_enum>(e.brand));
+                            count++;
+                        }
+                    }
 
-            // only if we got MACHINE_UNKNOWN on process but native is ARM64
-            if (nativeMachine == IMAGE_FILE_MACHINE_ARM64) {
-                using get_process_information = BOOL(__stdcall*)(HANDLE, PROCESS_INFORMATION_CLASS, PVOID, DWORD);
-                const HMODULE ntdll = util::get_ntdll();
-                if (ntdll == nullptr) {
-                    return false;
-                }
+                    core::context& ctx = core::current();
 
-                const char* names[] = { "GetProcessInformation" };
-                void* funcs[ARRAYSIZE(names)] = {};
-                util::get_function_address(ntdll, names, funcs, 1);
+                    for (size_t i = 0; i < MAX_BRANDS; i++) {
+                        ctx.brand_scoreboard[i].score = img.scores[i];
+                        ctx.baseline_scores[i] = img.scores[i];
+                    }
 
-                get_process_information get_proc_info = reinterpret_cast<get_process_information>(funcs[0]);
-                if (get_proc_info) {
-                    struct PROCESS_MACHINE_INFORMATION {
-                        USHORT ProcessMachine;
-                        USHORT Res0;
-                        DWORD  MachineAttributes;
-                    } pmInfo = {};
-                    // ProcessMachineTypeInfo == 9 per MS Q&A
-                    if (get_proc_info(current_process, (PROCESS_INFORMATION_CLASS)9, &pmInfo, sizeof(pmInfo))) {
-                        if (pmInfo.ProcessMachine == IMAGE_FILE_MACHINE_AMD64 || pmInfo.ProcessMachine == IMAGE_FILE_MACHINE_I386) {
-                            debug("Translator detected x64/x86 process on ARM64 by fallback");
-                            return true;
-                        }
+                    ctx.detected_count_num = img.detected_count;
+
+                    if (img.cpu_brand_cached && !cpu_brand::cached.load(std::memory_order_relaxed)) {
+                        str_copy(cpu_brand::brand_cache, img.cpu_brand, sizeof(cpu_brand::brand_cache));
+                        cpu_brand::cached.store(true, std::memory_order_release);
                     }
+
+                    if (img.bios_cached && !bios_info::cached.load(std::memory_order_relaxed)) {
+                        str_copy(bios_info::manufacturer, img.manufacturer, sizeof(bios_info::manufacturer));
+                        str_copy(bios_info::model, img.model, sizeof(bios_info::model));
+                        bios_info::cached.store(true, std::memory_order_release);
+                    }
+
+                    published_count = count;
+                    loaded = true;
+                    debug("PERSISTENT: loaded ", count, " technique results from ", path);
                 }
+
+                munmap(mapping, sizeof(image));
+                return loaded;
             }
         #endif
 
-            if (cpu::is_leaf_supported(cpu::leaf::hypervisor)) {
-                const std::string vendor = cpu::cpu_manufacturer(cpu::leaf::hypervisor);
-                
-                if (vendor == "VirtualApple" ||   // Apple Rosetta
-                    vendor == "PowerVM Lx86")     // IBM PowerVM Lx86
-                {
-                    return true;
+            // this is only attempted once per process, and only if nothing has been evaluated yet
+            static void load(const flagset& flags) {
+            #if (!LINUX)
+                VMAWARE_UNUSED(flags);
+            #else
+                std::lock_guard<std::mutex> guard(mutex);
+
+                if (attempted) {
+                    return;
                 }
-            }
 
-        #if (WINDOWS)
-            const std::string& brand = cpu::get_brand();
-            if (brand.find("Virtual CPU") != std::string::npos) {
-                return true;
-            }
-        #endif
+                attempted = true;
 
-            return false;
-        }
+                for (const auto& e : core::current().cache_table) {
+                    if (e.has_value.load(std::memory_order_relaxed)) {
+                        return;
+                    }
+                }
 
+                image key;
+                if (!make_key(key, flags)) {
+                    return;
+                }
 
-        /**
-         * @brief Check whether the system is running in a Hyper-V virtual machine or if the host system has Hyper-V enabled
-         * @note Hyper-V's presence on a host system can set certain hypervisor-related CPU flags that may appear similar to those in a virtualized environment, which can make it challenging to differentiate between an actual Hyper-V virtual machine (VM) and a host system with Hyper-V enabled.
-         *       This can lead to false conclusions, where the system might mistakenly be identified as running in a Hyper-V VM, when in reality, it's simply the host system with Hyper-V features active.
-         *       This check aims to distinguish between these two cases by identifying specific CPU flags and hypervisor-related artifacts that are indicative of a Hyper-V VM rather than a host system with Hyper-V enabled.
-         * @returns hyperx_state enum indicating the detected state:
-         *          - HYPERV_ARTIFACT_VM for host with Hyper-V enabled
-         *          - HYPERV_REAL_VM for real Hyper-V VM
-         *          - HYPERV_ENLIGHTENMENT for QEMU with Hyper-V enlightenments
-         *          - HYPERV_UNKNOWN for unknown/undetected state
-         */
-        [[nodiscard]] static hyperx_state hyper_x() {
-        #if (!WINDOWS)
-            return HYPERV_UNKNOWN;
-        #else
-            if (memo::hyperx::is_cached()) {
-                debug("HYPER_X: returned from cache");
-                return memo::hyperx::fetch();
+                // a root image was made with more privileges, so it takes priority
+                if (try_load("/run/vmaware/cache", key)) {
+                    return;
+                }
+
+                const std::string dir = directory();
+                if (!dir.empty() && dir != "/run/vmaware") {
+                    try_load(dir + "/cache", key);
+                }
+            #endif
             }
 
-            // Check if hypervisor feature bit in CPUID Leaf 1, ECX bit 31 is enabled
-            auto is_hyperv_present = []() noexcept -> bool {
-                u32 unused, ecx = 0;
-                cpu::cpuid(unused, unused, ecx, unused, 1);
+            // written to a temporary file first, so readers never see a partial image
+            static void save(const flagset& flags) {
+            #if (!LINUX)
+                VMAWARE_UNUSED(flags);
+            #else
+                std::unique_ptr<image> img(new image);
 
-                return (ecx >> 31) & 1;
-            };
+                if (!make_key(*img, flags)) {
+                    return;
+                }
 
-            // 0x40000003 on EBX indicates the flags that a parent partition specified to create a child partition (https://learn.microsoft.com/en-us/virtualization/hyper-v-on-windows/tlfs/datatypes/hv_partition_privilege_mask)
-            // some CPU models like N-models (N4200, etc) expose 0x40000003 leaves without exposing the hypervisor bit
-            auto is_root_partition = []() noexcept -> bool {
-                u32 ebx, unused = 0;
-                cpu::cpuid(unused, ebx, unused, unused, 0x40000003);
+                const std::string dir = directory();
+                if (dir.empty()) {
+                    return;
+                }
 
-                return (ebx & 1);
-            };
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
 
-            /**
-              * On Hyper-V virtual machines, the cpuid function reports an EAX value of 11
-              * This value is tied to the Hyper-V partition model, where each virtual machine runs as a child partition
-              * These child partitions have limited privileges and access to hypervisor resources, 
-              * which is reflected in the maximum input value for hypervisor CPUID information as 11
-              * Essentially, it indicates that the hypervisor is managing the VM and that the VM is not running directly on hardware but rather in a virtualized environment
-            */
-            auto eax = []() noexcept -> u32 {
-                u32 eax_reg, unused = 0;
-                cpu::cpuid(eax_reg, unused, unused, unused, cpu::leaf::hypervisor);
+                    const core::context& ctx = core::current();
+                    u16 count = 0;
 
-                // truncation is intentional
-                return eax_reg & 0xFF;
-            };
+                    for (size_t i = 0; i <= enum_size; i++) {
+                        const cache_entry& e = ctx.cache_table[i];
+                        if (e.has_value.load(std::memory_order_relaxed)) {
+                            img->entries[i] = { 1, static_cast<u8>(e.result), e.points, static_cast<u8>(e.brand_name) };
+                            count++;
+                        }
+                    }
 
-            hyperx_state state = HYPERV_UNKNOWN;
+                    // nothing new since the last time
+                    if (count == published_count) {
+                        return;
+                    }
 
-            if (!is_root_partition()) {
-                if (eax() == 11 && is_hyperv_present()) {
-                    // Windows machine running under Hyper-V type 2
-                    debug("HYPER-X: Detected Hyper-V guest VM");
-                    core::add(brand_enum::HYPERV);
-                    state = HYPERV_REAL_VM;
-                }
-                else {
-                    debug("HYPER-X: Hyper-V is not active");
-                    state = HYPERV_UNKNOWN;
+                    for (size_t i = 0; i < MAX_BRANDS; i++) {
+                        img->scores[i] = ctx.brand_scoreboard[i].score;
+                    }
+
+                    img->detected_count = ctx.detected_count_num.load();
+                    img->cpu_brand_cached = cpu_brand::cached.load(std::memory_order_relaxed);
+                    img->bios_cached = bios_info::cached.load(std::memory_order_relaxed);
+                    str_copy(img->cpu_brand, cpu_brand::brand_cache, sizeof(img->cpu_brand));
+                    str_copy(img->manufacturer, bios_info::manufacturer, sizeof(img->manufacturer));
+                    str_copy(img->model, bios_info::model, sizeof(img->model));
+
+                    published_count = count;
                 }
-            }
-            else {
-                const std::string brand_str = cpu::cpu_manufacturer(0x40000100);
-                
-                if (util::find(brand_str, "KVM")) {
-                    debug("HYPER-X: Detected Hyper-V enlightenments");
-                    core::add(brand_enum::QEMU_KVM_HYPERV);
-                    state = HYPERV_ENLIGHTENMENT;
+
+                const bool is_root = (geteuid() == 0);
+                mkdir(dir.c_str(), is_root ? 0755 : 0700);
+
+                const std::string path = dir + "/cache";
+                const std::string temp = path + "." + std::to_string(getpid());
+
+                const int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, is_root ? 0644 : 0600);
+                if (fd < 0) {
+                    return;
                 }
-                else {
-                    // Windows machine running under Hyper-V type 1
-                    // If we reach here, we do some sanity checks to ensure a hypervisor is not trying to spoof itself as Hyper-V, bypassing some detections
-                #if (x86_64)
-                    u8 idtr_buffer[10] = { 0 };
 
-                    // we know we're not using SEH here, it's on purpose, and doesn't matter the CPU core
-                    #if (CLANG || GCC)
-                        __asm__ volatile("sidt %0" : "=m"(idtr_buffer));
-                    #elif (MSVC)
-                        #pragma pack(push, 1)
-                        struct {
-                            USHORT Limit;
-                            ULONG_PTR Base;
-                        } idtr;
-                        #pragma pack(pop)
-                        __sidt(&idtr);
-                        memcpy(idtr_buffer, &idtr, sizeof(idtr));
-                    #endif   
+                const ssize_t written = write(fd, img.get(), sizeof(image));
+                close(fd);
 
-                    ULONG_PTR idt_base = 0;
-                    memcpy(&idt_base, &idtr_buffer[2], sizeof(idt_base));
+                if (written != static_cast<ssize_t>(sizeof(image)) || rename(temp.c_str(), path.c_str()) != 0) {
+                    unlink(temp.c_str());
+                    return;
+                }
 
-                    // if running under Hyper-V in AMD64 (doesnt matter the VTL/partition level), this value is hardcoded and intercepted/emulated at kernel level
-                    // specifically at KiPreprocessFault -> KiOpDecode -> KiOpLocateDecodeEntry (KiOp_SLDTSTRSMSW)
-                    // this is intercepted by the kernel before handling execution to the hypervisor, so it's a decent safeguard against basic cpuid spoofing
-                    if (idt_base == 0xfffff80000001000) {
-                        debug("HYPER-X: Detected Hyper-V host machine");
-                        core::add(brand_enum::HYPERV_ROOT);
-                        state = HYPERV_ARTIFACT_VM;
-                    }
-                    else {
-                        debug("HYPER-X: Detected hypervisor trying to spoof itself as Hyper-V");
-                        state = HYPERV_UNKNOWN; // doing this is enough to trigger a VM detection, we dont need to mark a 100% vm score as our techniques will do the job for us
-                    }
-                #else
-                    debug("HYPER-X: Detected Hyper-V host machine");
-                    core::add(brand_enum::HYPERV_ROOT);
-                    state = HYPERV_ARTIFACT_VM;
-                #endif                    
-                } 
+                debug("PERSISTENT: saved technique results to ", path);
+            #endif
             }
+        };
+    };
 
-            memo::hyperx::store(state);
+    // miscellaneous functionalities
+    struct util {
+        static bool is_unsupported(const VM::enum_flags flag) {
+            // cross platform?
+            if (
+                (flag >= VM::HYPERVISOR_BIT) &&
+                (flag <= VM::KGT_SIGNATURE)
+            ) {
+                return false;
+            }
 
-            return state;
-        #endif
+            #if (LINUX)
+                return (!(
+                    (flag >= LINUX_START) &&
+                    (flag <= LINUX_END)
+                ));
+            #elif (WINDOWS)
+                return (!(
+                    (flag >= WINDOWS_START) &&
+                    (flag <= WINDOWS_END)
+                ));
+            #elif (APPLE) 
+                return (!(
+                    (flag >= MACOS_START) &&
+                    (flag <= MACOS_END)
+                ));
+            #else
+                return false;
+            #endif
         }
 
-        // For strings shorter than 16-32 bytes, the overhead of setting up the _mm_crc32_u64 (or 32) loop, then checking length, handling the tail bytes, and finally handling alignment, 
-        // will always make it slower or equal to a simple unrolled u8 loop, and not every cpu model fits in u32/u64
-        #if (x86 && (CLANG || GCC))
-            __attribute__((__target__("crc32")))
-        #endif
-        static u32 crc32(u32 crc, char data) {
-        #if (x86)
-            return _mm_crc32_u8(crc, static_cast<u8>(data));
-        #else
-            // Fallback for non-x86: use software CRC32-C
-            crc ^= static_cast<u8>(data);
-            for (int i = 0; i < 8; ++i)
-                crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78u : 0);
-            return crc;
-        #endif
-        }
+    #if (LINUX)
+        // read-only view into a file buffer, since std::string_view isn't available before C++17
+        struct text_view {
+            const char* data;
+            size_t size;
 
-        // to search in our databases, we want to precompute hashes at compile time for C++11 and later
-        // so we need to match the hardware _mm_crc32_u8, it is based on CRC32-C (Castagnoli) polynomial
-        struct constexpr_hash {
-            // it does 8 rounds of CRC32-C bit reflection recursively
-            static constexpr u32 crc32_bits(u32 crc, int bits) {
-                return (bits == 0) ? crc :
-                    crc32_bits((crc >> 1) ^ ((crc & 1) ? 0x82F63B78u : 0), bits - 1);
+            bool empty() const noexcept { 
+                return (size == 0); 
             }
 
-            // over string
-            static constexpr u32 crc32_str(const char* s, u32 crc) {
-                return (*s == '\0') ? crc :
-                    crc32_str(s + 1, crc32_bits(crc ^ static_cast<u8>(*s), 8));
+            bool contains(const char* keyword) const noexcept {
+                const char* end = data + size;
+                return (std::search(data, end, keyword, keyword + std::strlen(keyword)) != end);
             }
 
-            static constexpr u32 get(const char* s) {
-                return crc32_str(s, 0);
+            bool starts_with(const char* prefix) const noexcept {
+                const size_t length = std::strlen(prefix);
+                return ((size >= length) && (std::memcmp(data, prefix, length) == 0));
             }
-        };
 
-        // this forces the compiler to calculate the hash when initializing the array while staying C++11 compatible
-        struct thread_entry {
-            u32 hash;
-            u32 threads;
-            constexpr thread_entry(const char* m, u32 t) : hash(constexpr_hash::get(m)), threads(t) {}
+            // same as above but case insensitive, the keyword must be lowercase
+            bool contains_lowercase(const char* keyword) const noexcept {
+                const char* end = data + size;
+                return (std::search(data, end, keyword, keyword + std::strlen(keyword), [](const char a, const char b) {
+                    return (((a >= 'A' && a <= 'Z') ? (a | 0x20) : a) == b);
+                }) != end);
+            }
         };
 
-        enum class cpu_type {
-            INTEL_I,
-            INTEL_XEON,
-            AMD
-        };
+        // fetch file data
+        [[nodiscard]] static std::string read_file(const char* raw_path) {
+            std::string path = "";
+            const std::string raw_path_str = raw_path;
 
-        // 4 arguments to stay compliant with x64 __fastcall (just in case)
-        [[nodiscard]] static bool verify_thread_count(const thread_entry* db, size_t db_size, size_t max_model_len, cpu_type type) {
-            // to save a few cycles
-            struct hasher {
-                static u32 crc32_sw(u32 crc, char data) {
-                    crc ^= static_cast<u8>(data);
-                    for (int i = 0; i < 8; ++i)
-                        crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78u : 0);
-                    return crc;
+            // replace the "~" part with the home directory
+            if (raw_path[0] == '~') {
+                const char* home = std::getenv("HOME");
+                if (home) {
+                    path = std::string(home) + raw_path_str.substr(1);
                 }
+            } else {
+                path = raw_path;
+            }
+
+            std::string data{};
+
+            // the last line is always terminated, like the line-based reader this replaced
+            if (append_file(path.c_str(), data) && !data.empty() && data.back() != '\n') {
+                data.push_back('\n');
+            }
+
+            track_input(path.c_str(), core::TEXT_INPUT, fingerprint(data.data(), data.size()));
+            return data;
+        }
 
-                using hashfc = u32(*)(u32, char);
+        // appends the whole file to the buffer with open(2) and read(2), returns false if it couldn't be opened. 
+        // The buffer only grows when it runs out of space, so reusing one across calls avoids most allocations
+        static bool append_file(const char* path, std::string& buffer) {
+            const int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+            if (fd < 0) {
+                return false;
+            }
 
-                static hashfc get() {
-                    // yes, vmaware runs on dinosaur cpus without sse4.2 pretty often
-                    i32 regs[4];
-                    cpu::cpuid(regs, 1);
-                    const bool has_sse42 = (regs[2] & (1 << 20)) != 0;
+            size_t length = buffer.size();
+            size_t capacity = std::max<size_t>(buffer.capacity(), length + 4096);
 
-                    return has_sse42 ? util::crc32 : crc32_sw;
+            while (true) {
+                if (capacity - length < 1024) {
+                    capacity *= 2;
                 }
-            };
 
-            std::string model_string;
-            const char* debug_tag = "";
+                buffer.resize(capacity);
+                const ssize_t bytes = read(fd, &buffer[length], capacity - length);
 
-            if (type == cpu_type::AMD) {
-                if (!cpu::is_amd()) {
-                    return false;
+                if (bytes < 0 && errno == EINTR) {
+                    continue;
+                }
+
+                if (bytes <= 0) {
+                    break;
                 }
-                model_string = cpu::get_brand();
-                debug_tag = "AMD_THREAD_MISMATCH";
+
+                length += static_cast<size_t>(bytes);
             }
-            else {
-                if (!cpu::is_intel()) {
+
+            close(fd);
+            buffer.resize(length);
+            return true;
+        }
+
+        // reads the whole file into a caller provided buffer and returns a view into it. There's no 
+        // separate existence check, a file that couldn't be opened gives a view with a null pointer
+        static text_view read_into(const char* path, std::string& buffer) {
+            buffer.clear();
+
+            text_view result = { nullptr, 0 };
+
+            if (append_file(path, buffer)) {
+                result = { buffer.data(), buffer.size() };
+            }
+
+            track_input(path, core::BINARY_INPUT, fingerprint(result.data, result.size));
+            return result;
+        }
+
+        // a file for read_batch(), the capacity is the expected upper bound of its size. 
+        // Anything bigger than that is read again separately, so it's only a hint
+        struct batch_file {
+            const char* path;
+            size_t capacity;
+            size_t offset;
+            size_t size;
+            bool present;
+        };
+
+    #if (VMA_IO_URING)
+        // minimal io_uring wrapper on top of the raw syscalls, liburing is not a dependency we want
+        struct io_ring {
+            int fd = -1;
+            u8* sq_ring = nullptr;
+            u8* cq_ring = nullptr;
+            io_uring_sqe* sqes = nullptr;
+            size_t sq_ring_size = 0;
+            size_t cq_ring_size = 0;
+            size_t sqes_size = 0;
+            unsigned entries = 0;
+            unsigned queued = 0;
+
+            unsigned* sq_tail = nullptr;
+            unsigned* sq_mask = nullptr;
+            unsigned* sq_array = nullptr;
+            unsigned* cq_head = nullptr;
+            unsigned* cq_tail = nullptr;
+            unsigned* cq_mask = nullptr;
+            io_uring_cqe* cqes = nullptr;
+
+            io_ring() = default;
+            io_ring(const io_ring&) = delete;
+            io_ring& operator=(const io_ring&) = delete;
+
+            bool init(const unsigned requested) {
+                io_uring_params params;
+                std::memset(&params, 0, sizeof(params));
+                params.flags = IORING_SETUP_CLAMP;
+
+                // fails with ENOSYS on old kernels and EPERM under most container seccomp profiles
+                fd = static_cast<int>(syscall(__NR_io_uring_setup, requested, &params));
+
+                if (fd < 0) {
                     return false;
                 }
 
-                const cpu::model_struct model = cpu::get_model();
+                entries = params.sq_entries;
+                sq_ring_size = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+                cq_ring_size = params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+                sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+                const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP);
 
-                if (!model.found) {
+                if (single_mmap) {
+                    sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+                }
+
+                void* sq = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+                if (sq == MAP_FAILED) {
                     return false;
                 }
+                sq_ring = static_cast<u8*>(sq);
 
-                if (type == cpu_type::INTEL_I) {
-                    if (!model.is_i_series) {
+                if (single_mmap) {
+                    cq_ring = sq_ring;
+                } else {
+                    void* cq = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+                    if (cq == MAP_FAILED) {
                         return false;
                     }
-                    debug_tag = "INTEL_THREAD_MISMATCH";
+                    cq_ring = static_cast<u8*>(cq);
                 }
-                else {
-                    if (!model.is_xeon) {
-                        return false;
-                    }
-                    debug_tag = "XEON_THREAD_MISMATCH";
+
+                void* entries_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+                if (entries_ptr == MAP_FAILED) {
+                    return false;
+                }
+                sqes = static_cast<io_uring_sqe*>(entries_ptr);
+
+                sq_tail = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+                sq_mask = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+                sq_array = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+                cq_head = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+                cq_tail = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+                cq_mask = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+                cqes = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+
+                return true;
+            }
+
+            ~io_ring() {
+                if (sqes != nullptr) {
+                    munmap(sqes, sqes_size);
+                }
+                if (cq_ring != nullptr && cq_ring != sq_ring) {
+                    munmap(cq_ring, cq_ring_size);
+                }
+                if (sq_ring != nullptr) {
+                    munmap(sq_ring, sq_ring_size);
+                }
+                if (fd >= 0) {
+                    close(fd);
                 }
-                model_string = model.string;
             }
 
-            if (model_string.empty()) return false;
+            // the caller never queues more than the ring holds between two submit() calls
+            io_uring_sqe& queue(const u64 user_data) {
+                const unsigned tail = *sq_tail + queued;
+                const unsigned index = (tail & *sq_mask);
 
-            debug(debug_tag, ": CPU model = ", model_string);
+                io_uring_sqe& sqe = sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.user_data = user_data;
+                sq_array[index] = index;
+                queued++;
 
-            const char* str = model_string.c_str();
-            u32 expected_threads = 0;
-            bool found = false;
-            size_t best_len = 0;
+                return sqe;
+            }
 
-            // manual collision fix for Z1 Extreme (16) vs Z1 (12)
-            // this is a special runtime check because "z1" is a substring of "z1 extreme" tokens
-            // and both might be hashed. VMAware should prioritize 'extreme' if found
-            u32 z_series_threads = 0;
+            // submits everything queued and waits for all of it to complete, every sqe produces exactly one cqe
+            template <typename Callback>
+            bool submit(Callback&& on_complete) {
+                const unsigned expected = queued;
+                __atomic_store_n(sq_tail, *sq_tail + queued, __ATOMIC_RELEASE);
+                queued = 0;
 
-            const auto hash_func = hasher::get();
+                unsigned submitted = 0;
+                unsigned completed = 0;
 
-            for (size_t i = 0; str[i] != '\0'; ) {
-                char c = str[i];
-                if (!((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))) {
-                    i++;
-                    continue;
+                while (completed < expected) {
+                    const long result = syscall(__NR_io_uring_enter, fd, expected - submitted, expected - completed, IORING_ENTER_GETEVENTS, nullptr, 0);
+
+                    if (result < 0) {
+                        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                            continue;
+                        }
+
+                        // nothing in flight can still write into the caller's buffers
+                        if (submitted == completed) {
+                            return false;
+                        }
+                    } else {
+                        submitted += static_cast<unsigned>(result);
+                    }
+
+                    unsigned head = *cq_head;
+                    const unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+
+                    for (; head != tail; head++) {
+                        const io_uring_cqe& cqe = cqes[head & *cq_mask];
+                        on_complete(cqe.user_data, cqe.res);
+                        completed++;
+                    }
+
+                    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
                 }
 
-                u32 current_hash = 0;
-                size_t current_len = 0;
-                size_t j = i;
+                return true;
+            }
+        };
+    #endif
 
-                while (true) {
-                    char k = str[j];
-                    const bool is_valid = (k >= '0' && k <= '9') ||
-                        (k >= 'A' && k <= 'Z') ||
-                        (k >= 'a' && k <= 'z') ||
-                        (k == '-'); // models have hyphen
-                    if (!is_valid) break;
+        // reads a set of files into the arena with as few syscalls as possible. Every file gets a slot
+        // sized by its capacity hint and is null terminated. By default each file is an open, a pread 
+        // and a close. A sysfs attribute is generated in one go, so a short read is its end and there's 
+        // no extra read to confirm it like in append_file(). procfs files are generated about a page per 
+        // read though, so those are read until a read returns 0. With __VMAWARE_IO_URING__ all the opens 
+        // are submitted as one batch and the first reads as a second one, the sysfs ones hard linked to 
+        // the close of their file, which is 2 io_uring_enter() calls instead of 3 syscalls per file. 
+        // The pread path is still the fallback when the kernel or a seccomp profile refuses io_uring
+        static void read_batch(batch_file* files, const size_t count, std::string& arena) {
+            constexpr long pending = LONG_MIN;
+            std::vector<int> fds(count, -1);
+            std::vector<long> results(count, pending);
+
+            size_t total = arena.size();
+            for (size_t i = 0; i < count; i++) {
+                files[i].offset = total;
+                files[i].present = false;
+                total += files[i].capacity + 1;
+            }
+            arena.resize(total, '\0');
+
+            auto is_procfs = [](const char* path) -> bool {
+                return (std::strncmp(path, "/proc/", 6) == 0);
+            };
 
-                    if (current_len >= max_model_len) {
-                        while (str[j] != '\0' && str[j] != ' ') j++; // fast forward to space/null
+        #if (VMA_IO_URING)
+            io_ring ring;
+
+            if (count > 1 && ring.init(64)) {
+                // one open per file in the first batch, then a read and a close per file in the second
+                const size_t chunk = (ring.entries / 2);
+                const u64 close_tag = (1ULL << 63);
+
+                for (size_t first = 0; first < count; first += chunk) {
+                    const size_t last = std::min(count, first + chunk);
+
+                    for (size_t i = first; i < last; i++) {
+                        io_uring_sqe& sqe = ring.queue(i);
+                        sqe.opcode = IORING_OP_OPENAT;
+                        sqe.fd = AT_FDCWD;
+                        sqe.addr = reinterpret_cast<u64>(files[i].path);
+                        sqe.open_flags = O_RDONLY | O_CLOEXEC;
+                    }
+
+                    const bool opened = ring.submit([&](const u64 user_data, const int res) {
+                        if (res >= 0) {
+                            fds[user_data] = res;
+                        } else if (res != -EINVAL) {
+                            // -EINVAL means the opcode isn't supported, so the fallback below retries it
+                            results[user_data] = res;
+                        }
+                    });
+
+                    if (!opened) {
                         break;
                     }
 
-                    /*
-                       models are usually 8 or more bytes long, i.e. i9-10900K
-                       so imagine we want to use u64, you hash the first 8 bytes i9-10900
-                       but then you are left with K. You have to handle the tail
-                       fetching 8 bytes would include the characters after the token, corrupting the hash
-                       so a byte-by-byte loop is the most optimal choice here
-                    */
+                    for (size_t i = first; i < last; i++) {
+                        if (fds[i] < 0) {
+                            continue;
+                        }
 
-                    // convert to lowercase on-the-fly to match compile-time keys
-                    if (type == cpu_type::AMD && (k >= 'A' && k <= 'Z')) k += 32;
+                        io_uring_sqe& read_sqe = ring.queue(i);
+                        read_sqe.opcode = IORING_OP_READ;
+                        read_sqe.fd = fds[i];
+                        read_sqe.addr = reinterpret_cast<u64>(&arena[files[i].offset]);
+                        read_sqe.len = static_cast<u32>(files[i].capacity);
+                        read_sqe.off = 0;
 
-                    // since this technique is cross-platform, we cannot use a standard C++ try-catch block to catch a missing CPU instruction
-                    // we could use preprocessor directives and add an exception handler (VEH/SEH or SIGHANDLER) but nah
-                    current_hash = hash_func(current_hash, k);
-                    current_len++;
-                    j++;
+                        // procfs files stay open, since the rest of them is read below
+                        if (is_procfs(files[i].path)) {
+                            continue;
+                        }
 
-                    // only verify match if the token has ended (next char is not alphanumeric)
-                    const char next = str[j];
-                    const bool next_is_alnum = (next >= '0' && next <= '9') ||
-                        (next >= 'A' && next <= 'Z') ||
-                        (next >= 'a' && next <= 'z');
-
-                    if (!next_is_alnum) {
-                        // Check specific Z1 Extreme token
-                        // Hash for "extreme" (CRC32-C) is 0x3D09D5B4
-                        if (type == cpu_type::AMD && current_hash == 0x3D09D5B4) { z_series_threads = 16; }
-
-                        // since it's a contiguous block of integers in .rodata/.rdata, this is extremely fast
-                        for (size_t idx = 0; idx < db_size; ++idx) {
-                            if (db[idx].hash == current_hash) {
-                                if (current_len > best_len) {
-                                    best_len = current_len;
-                                    expected_threads = db[idx].threads;
-                                    found = true;
-                                }
-                                // since hashing implies uniqueness in this dataset, you might say we could break here,
-                                // but we continue to ensure we find the longest substring match if overlaps exist,
-                                // so like it finds both "i9-11900" and "i9-11900K" i.e.
+                        // a hard link keeps the chain going even though short reads count as failures
+                        read_sqe.flags = IOSQE_IO_HARDLINK;
+
+                        io_uring_sqe& close_sqe = ring.queue(close_tag | i);
+                        close_sqe.opcode = IORING_OP_CLOSE;
+                        close_sqe.fd = fds[i];
+                    }
+
+                    const bool read = ring.submit([&](const u64 user_data, const int res) {
+                        const size_t i = static_cast<size_t>(user_data & ~close_tag);
+
+                        if (user_data & close_tag) {
+                            if (res >= 0) {
+                                fds[i] = -1;
                             }
+                            return;
                         }
+
+                        files[i].present = true;
+                        results[i] = (res == -EINVAL) ? pending : res;
+                    });
+
+                    if (!read) {
+                        break;
                     }
                 }
-                i = j;
             }
+        #endif
 
-            // Z1 Extreme fix
-            if (type == cpu_type::AMD && z_series_threads != 0 && expected_threads == 12) {
-                expected_threads = z_series_threads;
-            }
+            for (size_t i = 0; i < count; i++) {
+                batch_file& file = files[i];
 
-            if (found) {
-                const u32 actual = memo::threadcount::fetch();
-                if (actual != expected_threads) {
-                    debug(debug_tag, ": Expected threads -> ", expected_threads);
-                    VMAWARE_UNUSED(debug_tag); // if compiled in release mode, silence the unused variable warning
-                    return true;
+                // procfs files opened by the ring are still open, and so is any file whose close didn't go through
+                int fd = fds[i];
+
+                if (results[i] == pending) {
+                    if (fd < 0) {
+                        fd = open(file.path, O_RDONLY | O_CLOEXEC);
+                    }
+
+                    if (fd < 0) {
+                        file.present = false;
+                        results[i] = -errno;
+                    } else {
+                        ssize_t bytes;
+                        do {
+                            bytes = pread(fd, &arena[file.offset], file.capacity, 0);
+                        } while (bytes < 0 && errno == EINTR);
+
+                        file.present = true;
+                        results[i] = bytes;
+                    }
                 }
-            }
 
-            return false;
-        }
+                file.size = (file.present && results[i] > 0) ? static_cast<size_t>(results[i]) : 0;
 
-    #if (WINDOWS)
-        // retrieves the addresses of specified functions from a loaded module using the export directory, manual implementation of GetProcAddress
-        static void get_function_address(const HMODULE hModule, const char* names[], void** functions, size_t count) {
-            using func_map = std::unordered_map<std::string, void*>;
-            static std::unordered_map<HMODULE, func_map> function_cache;
+                if (fd >= 0 && file.size > 0 && is_procfs(file.path)) {
+                    while (file.size < file.capacity) {
+                        const ssize_t bytes = pread(fd, &arena[file.offset + file.size], file.capacity - file.size, static_cast<off_t>(file.size));
 
-            for (size_t i = 0; i < count; ++i) functions[i] = nullptr;
-            if (!hModule) return;
+                        if (bytes < 0 && errno == EINTR) {
+                            continue;
+                        }
 
-            BYTE* base = reinterpret_cast<BYTE*>(hModule);
+                        if (bytes <= 0) {
+                            break;
+                        }
 
-            size_t module_size = 0;
-            {
-                MEMORY_BASIC_INFORMATION mbi = {};
-                if (VirtualQuery(base, &mbi, sizeof(mbi))) {
-                    module_size = static_cast<size_t>(mbi.RegionSize);
+                        file.size += static_cast<size_t>(bytes);
+                    }
                 }
-                else {
-                    return;
+
+                if (fd >= 0) {
+                    close(fd);
                 }
-            }
 
-            auto valid_range = [&](size_t offset, size_t sz) noexcept -> bool {
-                return (sz > 0) && (offset < module_size) && (sz <= module_size - offset);
-            };
+                if (!file.present) {
+                    file.size = 0;
+                    continue;
+                }
 
-            auto cstr_from_rva = [&](DWORD rva) noexcept -> const char* {
-                if (!valid_range(static_cast<size_t>(rva), 1)) return nullptr;
+                // the slot is full so there might be more, read the whole thing at the end of the arena
+                if (file.size == file.capacity) {
+                    file.offset = arena.size();
+                    file.present = append_file(file.path, arena);
+                    file.size = (arena.size() - file.offset);
+                    arena.push_back('\0');
+                }
+            }
+        }
 
-                const char* start = reinterpret_cast<const char*>(base + rva);
-                const size_t remaining = module_size - static_cast<size_t>(rva);
+        [[nodiscard]] static bool exists(const char* path) {
+            track_input(path, core::PRESENCE_INPUT, 0);
 
-                if (std::memchr(start, '\0', remaining)) {
-                    return start;
-                }
+        #if (VMA_CPP >= 17)
+            return std::filesystem::exists(path);
+        #elif (VMA_CPP >= 11)
+            struct stat buffer;
+            return (stat(path, &buffer) == 0);
+        #endif
+        }
 
-                return nullptr;
-            };
+        static bool is_directory(const char* path) {
+            track_input(path, core::PRESENCE_INPUT, 0);
 
-            // Validate DOS header 
-            if (!valid_range(0, sizeof(IMAGE_DOS_HEADER))) return;
-            const auto* dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(base);
-            if (dosHeader->e_magic != IMAGE_DOS_SIGNATURE) return;
+            struct stat info;
+            if (stat(path, &info) != 0) {
+                return false;
+            }
+            return (info.st_mode & S_IFDIR); // check if directory
+        };
+    #endif
 
-            // e_lfanew -> NT headers
-            if (dosHeader->e_lfanew < 0) return;
-            const size_t e_lfanew = static_cast<size_t>(dosHeader->e_lfanew);
-            if (!valid_range(e_lfanew, sizeof(IMAGE_NT_HEADERS))) return;
-            const auto* ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(base + e_lfanew);
-            if (ntHeaders->Signature != IMAGE_NT_SIGNATURE) return;
+        // 64-bit FNV-1a, used to tell whether an input changed since it was last seen
+        [[nodiscard]] static u64 fingerprint(const void* data, const size_t size, u64 hash = 0xcbf29ce484222325ULL) noexcept {
+            const u8* bytes = static_cast<const u8*>(data);
 
-            const size_t sizeOfImage = static_cast<size_t>(ntHeaders->OptionalHeader.SizeOfImage);
-            if (sizeOfImage != 0 && sizeOfImage > module_size) {
-                module_size = sizeOfImage;
+            for (size_t i = 0; i < size; i++) {
+                hash ^= bytes[i];
+                hash *= 0x100000001b3ULL;
             }
 
-            // Check export data directory exists
-            if (ntHeaders->OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_EXPORT) {
-                return; // no export directory
+            return hash;
+        }
+
+        // procfs and sysfs don't update the metadata of their files when the contents change
+        [[nodiscard]] static bool is_pseudo_file(const char* path) noexcept {
+            return (
+                (std::strncmp(path, "/proc/", 6) == 0) || 
+                (std::strncmp(path, "/sys/", 5) == 0)
+            );
+        }
+
+        // metadata of a file that changes whenever it's replaced or modified, or 0 if it doesn't exist
+        [[nodiscard]] static u64 file_metadata(const char* path) noexcept {
+        #if (WINDOWS)
+            WIN32_FILE_ATTRIBUTE_DATA info;
+            if (!GetFileAttributesExA(path, GetFileExInfoStandard, &info)) {
+                return 0;
             }
 
-            const auto& dd = ntHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
-            if (dd.VirtualAddress == 0 || dd.Size == 0) {
-                return; // no exports
+            u64 hash = fingerprint(&info.ftLastWriteTime, sizeof(info.ftLastWriteTime));
+            hash = fingerprint(&info.nFileSizeLow, sizeof(info.nFileSizeLow), hash);
+            return fingerprint(&info.dwFileAttributes, sizeof(info.dwFileAttributes), hash);
+        #else
+            struct stat info;
+            if (stat(path, &info) != 0) {
+                return 0;
             }
 
-            // Validate export directory fits
-            if (!valid_range(static_cast<size_t>(dd.VirtualAddress), sizeof(IMAGE_EXPORT_DIRECTORY))) {
+            const u64 fields[] = {
+                static_cast<u64>(info.st_dev),
+                static_cast<u64>(info.st_ino),
+                static_cast<u64>(info.st_mode),
+                static_cast<u64>(info.st_size),
+            #if (APPLE)
+                static_cast<u64>(info.st_mtimespec.tv_sec),
+                static_cast<u64>(info.st_mtimespec.tv_nsec)
+            #else
+                static_cast<u64>(info.st_mtim.tv_sec),
+                static_cast<u64>(info.st_mtim.tv_nsec)
+            #endif
+            };
+
+            return fingerprint(fields, sizeof(fields));
+        #endif
+        }
+
+        // record a file the running technique depends on, specific to VM::rescan(). 
+        // This only does anything while a technique is being evaluated by core::execute()
+        static void track_input(const char* path, const u8 kind, const u64 content) {
+            core::parallel_slot* const slot = core::active_slot;
+
+            if (slot == nullptr || path == nullptr) {
                 return;
             }
 
-            const auto* exportDir = reinterpret_cast<const IMAGE_EXPORT_DIRECTORY*>(base + dd.VirtualAddress);
-
-            const DWORD nameCount = exportDir->NumberOfNames;
-            const DWORD funcCount = exportDir->NumberOfFunctions;
+            for (const auto& input : slot->inputs) {
+                if (input.kind == kind && input.path == path) {
+                    return;
+                }
+            }
 
-            constexpr DWORD MAX_NAMES = 1u << 20; // 1M names is absurd but protective
-            if (nameCount == 0 || nameCount > MAX_NAMES) return;
-            if (funcCount == 0 || funcCount > MAX_NAMES) return;
+            // the metadata of procfs and sysfs files is meaningless for anything but presence checks
+            const bool is_presence = (kind == core::PRESENCE_INPUT);
+            const u64 metadata = (is_presence || (kind != core::KERNEL_LOG_INPUT && !is_pseudo_file(path))) ? file_metadata(path) : 0;
 
-            const DWORD addr_names = exportDir->AddressOfNames;
-            const DWORD addr_funcs = exportDir->AddressOfFunctions;
-            const DWORD addr_ord = exportDir->AddressOfNameOrdinals;
+            // presence checks only care about whether the file is there and what it is
+            slot->inputs.push_back({ path, kind, metadata, is_presence ? (metadata != 0) : content });
+        }
 
-            if (!valid_range(static_cast<size_t>(addr_names), static_cast<size_t>(nameCount) * sizeof(DWORD))) return;
-            if (!valid_range(static_cast<size_t>(addr_funcs), static_cast<size_t>(funcCount) * sizeof(DWORD))) return;
-            if (!valid_range(static_cast<size_t>(addr_ord), static_cast<size_t>(nameCount) * sizeof(WORD))) return;
+    #if (LINUX)
+        // every procfs/sysfs file the Linux techniques read, loaded in a single pass into one 
+        // buffer the first time any of them is needed. Several techniques check the same DMI 
+        // attributes, so this way each file is only opened and read once per evaluation, 
+        // and none of the techniques need their own heap allocated copy of the contents
+        struct sys_snapshot {
+            enum file : u8 {
+                CHASSIS_VENDOR,
+                CHASSIS_TYPE,
+                SYS_VENDOR,
+                MODALIAS,
+                BIOS_VENDOR,
+                BOARD_NAME,
+                BOARD_VENDOR,
+                CHASSIS_ASSET_TAG,
+                PRODUCT_FAMILY,
+                PRODUCT_SKU,
+                PRODUCT_NAME,
+                MODULES,
+                IOMEM,
+                IOPORTS,
+                SCSI,
+                SYSINFO,
+                OSRELEASE,
+                VERSION,
+                HYPERVISOR_TYPE,
+                FILE_COUNT
+            };
 
-            const DWORD* nameRvas = reinterpret_cast<const DWORD*>(base + addr_names);
-            const DWORD* funcRvas = reinterpret_cast<const DWORD*>(base + addr_funcs);
-            const WORD* ordinals = reinterpret_cast<const WORD*>(base + addr_ord);
+            std::string arena;
+            std::array<size_t, FILE_COUNT> offsets;
+            std::array<size_t, FILE_COUNT> sizes;
+            std::bitset<FILE_COUNT> present;
+
+            static std::mutex mutex;
+            static std::shared_ptr<const sys_snapshot> cache;
+
+            static const char* path(const file id) noexcept {
+                switch (id) {
+                    case CHASSIS_VENDOR: return "/sys/devices/virtual/dmi/id/chassis_vendor";
+                    case CHASSIS_TYPE: return "/sys/devices/virtual/dmi/id/chassis_type";
+                    case SYS_VENDOR: return "/sys/devices/virtual/dmi/id/sys_vendor";
+                    case MODALIAS: return "/sys/devices/virtual/dmi/id/modalias";
+                    case BIOS_VENDOR: return "/sys/devices/virtual/dmi/id/bios_vendor";
+                    case BOARD_NAME: return "/sys/devices/virtual/dmi/id/board_name";
+                    case BOARD_VENDOR: return "/sys/devices/virtual/dmi/id/board_vendor";
+                    case CHASSIS_ASSET_TAG: return "/sys/devices/virtual/dmi/id/chassis_asset_tag";
+                    case PRODUCT_FAMILY: return "/sys/devices/virtual/dmi/id/product_family";
+                    case PRODUCT_SKU: return "/sys/devices/virtual/dmi/id/product_sku";
+                    case PRODUCT_NAME: return "/sys/devices/virtual/dmi/id/product_name";
+                    case MODULES: return "/proc/modules";
+                    case IOMEM: return "/proc/iomem";
+                    case IOPORTS: return "/proc/ioports";
+                    case SCSI: return "/proc/scsi/scsi";
+                    case SYSINFO: return "/proc/sysinfo";
+                    case OSRELEASE: return "/proc/sys/kernel/osrelease";
+                    case VERSION: return "/proc/version";
+                    case HYPERVISOR_TYPE: return "/sys/hypervisor/type";
+                    case FILE_COUNT: break;
+                }
 
-            func_map& module_cache = function_cache[hModule];
+                return "";
+            }
 
-            for (size_t i = 0; i < count; ++i) {
-                const char* current_name = names[i];
-                if (!current_name) continue;
-                const std::string s_name(current_name);
+            // every file is null terminated inside the arena, so the views can also be used as C strings
+            static std::shared_ptr<const sys_snapshot> load() {
+                std::shared_ptr<sys_snapshot> snapshot = std::make_shared<sys_snapshot>();
+                std::array<batch_file, FILE_COUNT> files;
 
-                // check cache first
-                const auto cache_it = module_cache.find(s_name);
-                if (cache_it != module_cache.end()) {
-                    functions[i] = cache_it->second;
-                    continue;
+                for (u8 i = 0; i < FILE_COUNT; i++) {
+                    // sysfs attributes are capped at a page, the /proc tables are usually a few pages
+                    const bool is_proc = (i >= MODULES && i <= VERSION);
+                    files[i].path = path(static_cast<file>(i));
+                    files[i].capacity = (is_proc ? (16 * 1024) : 4096);
                 }
 
-                // binary search over names (names array is typically sorted)
-                DWORD lo = 0, hi = nameCount;
-                while (lo < hi) {
-                    const DWORD mid = lo + (hi - lo) / 2;
-                    const DWORD midNameRva = nameRvas[mid];
-                    const char* midName = cstr_from_rva(midNameRva);
-                    if (!midName) { // corrupted string table or something
-                        lo = hi;
-                        break;
-                    }
+                read_batch(files.data(), files.size(), snapshot->arena);
 
-                    const int cmp = strcmp(current_name, midName);
-                    if (cmp > 0) {
-                        lo = mid + 1;
-                    }
-                    else {
-                        hi = mid;
-                    }
+                for (u8 i = 0; i < FILE_COUNT; i++) {
+                    snapshot->offsets[i] = files[i].offset;
+                    snapshot->sizes[i] = files[i].size;
+                    snapshot->present.set(i, files[i].present);
                 }
 
-                if (lo < nameCount) {
-                    const char* candidateName = cstr_from_rva(nameRvas[lo]);
-                    if (candidateName && strcmp(current_name, candidateName) == 0) {
-                        const WORD nameOrdinal = ordinals[lo];
-                        if (static_cast<DWORD>(nameOrdinal) >= funcCount) continue;
-                        const DWORD funcRva = funcRvas[nameOrdinal];
-                        if (!valid_range(static_cast<size_t>(funcRva), 1)) continue;
-                        void* addr = reinterpret_cast<void*>(base + funcRva);
-                        functions[i] = addr;
-                        module_cache[s_name] = addr;
-                        continue;
-                    }
+                return snapshot;
+            }
+
+            static std::shared_ptr<const sys_snapshot> fetch() {
+                std::lock_guard<std::mutex> guard(mutex);
+
+                if (!cache) {
+                    cache = load();
                 }
+
+                return cache;
             }
-        }
 
+            // the next fetch() reads everything again, specific to VM::rescan()
+            static void invalidate() {
+                std::lock_guard<std::mutex> guard(mutex);
+                cache.reset();
+            }
 
-        [[nodiscard]] static HMODULE get_ntdll() {
-            static HMODULE cached_ntdll = nullptr;
-            if (cached_ntdll != nullptr) {
-                return cached_ntdll;
+            bool exists(const file id) const {
+                view(id);
+                return present.test(id);
             }
 
-        #ifndef _WINTERNL_
-            typedef struct _UNICODE_STRING {
-                USHORT Length;
-                USHORT MaximumLength;
-                PWSTR  Buffer;
-            } UNICODE_STRING, * PUNICODE_STRING;
+            text_view view(const file id) const {
+                const text_view result = { arena.data() + offsets[id], sizes[id] };
+                track_input(path(id), core::BINARY_INPUT, fingerprint(result.data, result.size));
+                return result;
+            }
+        };
 
-            typedef struct _PEB_LDR_DATA {
-                BYTE Reserved1[8];
-                PVOID Reserved2[3];
-                LIST_ENTRY InMemoryOrderModuleList;
-            } PEB_LDR_DATA, * PPEB_LDR_DATA;
+        // the kernel ring buffer, captured once and scanned in a single pass for everything that 
+        // KMSG, DMESG and VMWARE_DMESG look for. Only the results of the scan are kept around. 
+        // Reading it needs CAP_SYSLOG unless kernel.dmesg_restrict is 0
+        struct kernel_log {
+            enum finding : u8 {
+                HYPERVISOR_DETECTED,
+                HYPERVISOR_KVM,
+                HYPERVISOR_QEMU,
+                BUSLOGIC,
+                PCNET32,
+                FINDING_COUNT
+            };
 
-            typedef struct _LDR_DATA_TABLE_ENTRY {
-                PVOID Reserved1[2];
-                LIST_ENTRY InMemoryOrderLinks;
-                PVOID Reserved2[2];
-                PVOID DllBase;
-                PVOID Reserved3[2];
-                UNICODE_STRING FullDllName;
-                BYTE Reserved4[8];
-                PVOID Reserved5[3];
-            #pragma warning(push)
-            #pragma warning(disable: 4201)
-                union {
-                    ULONG CheckSum;
-                    PVOID Reserved6;
-                } DUMMYUNIONNAME;
-            #pragma warning(pop)
-                ULONG TimeDateStamp;
-            } LDR_DATA_TABLE_ENTRY, * PLDR_DATA_TABLE_ENTRY;
+            bool available = false;
+            std::bitset<FINDING_COUNT> findings;
 
-            typedef struct _PEB {
-                BYTE Reserved1[2];
-                BYTE BeingDebugged;
-                BYTE Reserved2[1];
-                PVOID Reserved3[2];
-                PPEB_LDR_DATA Ldr;
-            } PEB, * PPEB;
-        #endif
+            static std::mutex mutex;
+            static std::shared_ptr<const kernel_log> cache;
 
-            PPEB peb = nullptr;
+            // klogctl() gets the whole buffer in one syscall, /dev/kmsg is the fallback for kernels 
+            // built without CONFIG_PRINTK's syslog interface and returns one record per read
+            static bool capture(std::string& buffer) {
+                constexpr int SYSLOG_ACTION_READ_ALL = 3;
+                constexpr int SYSLOG_ACTION_SIZE_BUFFER = 10;
 
-        #if (x86_64)
-            #if (MSVC && !CLANG)
-                peb = reinterpret_cast<PPEB>(__readgsqword(0x60));
-            #else
-                asm("movq %%gs:0x60, %0" : "=r"(peb));
-            #endif
-        #elif (x86_32)
-            #if (MSVC&& !CLANG)
-                peb = reinterpret_cast<PPEB>(__readfsdword(0x30));
-            #else
-                asm("movl %%fs:0x30, %0" : "=r"(peb));
-            #endif
-        #endif
+                const int size = klogctl(SYSLOG_ACTION_SIZE_BUFFER, nullptr, 0);
 
-            if (!peb) { // not x86 or tampered with
-                const HMODULE ntdll = GetModuleHandleW(L"ntdll.dll");
-                if (ntdll) cached_ntdll = ntdll;
-                return ntdll;
-            }
+                if (size > 0) {
+                    buffer.resize(static_cast<size_t>(size));
+                    const int bytes = klogctl(SYSLOG_ACTION_READ_ALL, &buffer[0], size);
 
-            PPEB_LDR_DATA ldr = peb->Ldr;
-            if (!ldr) {
-                const HMODULE h = GetModuleHandleW(L"ntdll.dll");
-                if (h) cached_ntdll = h;
-                return h;
-            }
+                    if (bytes >= 0) {
+                        buffer.resize(static_cast<size_t>(bytes));
+                        return true;
+                    }
+                }
 
-            #ifndef CONTAINING_RECORD
-                #define CONTAINING_RECORD(address, type, field) ((type *)((char*)(address) - (size_t)(&((type *)0)->field)))
-            #endif
+                const int fd = open("/dev/kmsg", O_RDONLY | O_NONBLOCK | O_CLOEXEC);
 
-            constexpr WCHAR target_name[] = L"ntdll.dll";
-            constexpr size_t target_length = (std::size(target_name) - 1);
+                if (fd < 0) {
+                    debug("kernel_log: ", "failed to open /dev/kmsg");
+                    buffer.clear();
+                    return false;
+                }
 
-            LIST_ENTRY* head = &ldr->InMemoryOrderModuleList;
-            // static analyzers don't know that InMemoryOrderModuleList is a circular list managed by the loader
-            // so they conservatively assume head->Flink or some cur->Flink might be nullptr
-            for (LIST_ENTRY* cur = head->Flink; cur != nullptr && cur != head; cur = cur->Flink) {
-                auto* ent = CONTAINING_RECORD(cur, LDR_DATA_TABLE_ENTRY, InMemoryOrderLinks);
-                if (!ent) continue;
+                // a record never exceeds 8 KiB, and the read fails with EINVAL if it doesn't fit
+                constexpr size_t record_size = 8192;
+                size_t length = 0;
 
-                auto* fullname = &ent->FullDllName;
-                if (!fullname->Buffer || fullname->Length == 0) continue;
+                while (true) {
+                    buffer.resize(length + record_size);
+                    const ssize_t bytes = read(fd, &buffer[length], record_size);
 
-                const auto total_chars = static_cast<USHORT>(fullname->Length / sizeof(WCHAR));
+                    if (bytes > 0) {
+                        length += static_cast<size_t>(bytes);
+                        continue;
+                    }
 
-                size_t start = total_chars;
-                while (start > 0) {
-                    const WCHAR c = fullname->Buffer[start - 1];
-                    if (c == L'\\' || c == L'/') break;
-                    --start;
+                    // EPIPE means the record was overwritten while reading, the next one is still fine
+                    if (bytes < 0 && (errno == EINTR || errno == EPIPE)) {
+                        continue;
+                    }
+
+                    // EAGAIN is the end of the buffer, there's no point waiting for new messages
+                    break;
                 }
 
-                const size_t file_length = total_chars - start;
-                if (file_length != target_length) continue;
+                close(fd);
+                buffer.resize(length);
+                return true;
+            }
 
-                bool match = true;
-                for (size_t i = 0; i < file_length; ++i) {
-                    WCHAR a = fullname->Buffer[start + i];
-                    WCHAR b = target_name[i];
-                    if (a >= L'A' && a <= L'Z') a = static_cast<WCHAR>(a + 32);
-                    if (b >= L'A' && b <= L'Z') b = static_cast<WCHAR>(b + 32);
-                    if (a != b) { match = false; break; }
-                }
+            static std::shared_ptr<const kernel_log> load() {
+                std::shared_ptr<kernel_log> log = std::make_shared<kernel_log>();
+                std::string buffer;
 
-                if (match) {
-                    cached_ntdll = reinterpret_cast<HMODULE>(ent->DllBase);
-                    return cached_ntdll;
-                }
-            }
+                log->available = capture(buffer);
 
-            const HMODULE h = GetModuleHandleW(L"ntdll.dll");
-            if (h) cached_ntdll = h;
-            return h;
-        } 
+                const char* const end = buffer.data() + buffer.size();
 
+                for (const char* line = buffer.data(); line < end; ) {
+                    const char* const line_end = std::find(line, end, '\n');
+                    const text_view view = { line, static_cast<size_t>(line_end - line) };
 
-        static bool get_manufacturer_model(const char** out_manufacturer, const char** out_model) {
-            if (out_manufacturer) *out_manufacturer = "";
-            if (out_model) *out_model = "";
+                    if (view.contains_lowercase("hypervisor")) {
+                        if (view.contains("Hypervisor detected")) log->findings.set(HYPERVISOR_DETECTED);
+                        if (view.contains("KVM")) log->findings.set(HYPERVISOR_KVM);
+                        if (view.contains("QEMU")) log->findings.set(HYPERVISOR_QEMU);
+                    }
 
-            if (memo::bios_info::is_cached()) {
-                if (out_manufacturer) *out_manufacturer = memo::bios_info::fetch_manufacturer();
-                if (out_model) *out_model = memo::bios_info::fetch_model();
-                return memo::bios_info::fetch_manufacturer()[0] != '\0' || memo::bios_info::fetch_model()[0] != '\0';
+                    if (view.contains("BusLogic BT-958")) log->findings.set(BUSLOGIC);
+                    if (view.contains("pcnet32")) log->findings.set(PCNET32);
+
+                    line = (line_end == end) ? end : line_end + 1;
+                }
+
+                return log;
             }
 
-            WCHAR wbuf[256]{};
-            DWORD cb = sizeof(wbuf);
+            // the findings are recorded on every fetch, so VM::rescan() notices a new kernel line 
+            // that changes them. The log itself grows all the time, so it isn't compared as a whole
+            static std::shared_ptr<const kernel_log> fetch() {
+                std::shared_ptr<const kernel_log> log;
 
-            char man_tmp[sizeof(memo::bios_info::manufacturer)]{};
-            char model_tmp[sizeof(memo::bios_info::model)]{};
-            man_tmp[0] = '\0';
-            model_tmp[0] = '\0';
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
 
-            bool got_any = false;
+                    if (!cache) {
+                        cache = load();
+                    }
 
-            cb = sizeof(wbuf);
-            if (RegGetValueW(HKEY_LOCAL_MACHINE,
-                L"HARDWARE\\DESCRIPTION\\System\\BIOS",
-                L"SystemManufacturer",
-                RRF_RT_REG_SZ,
-                nullptr,
-                wbuf,
-                &cb) == ERROR_SUCCESS && wbuf[0] != L'\0') {
-                const int conv = WideCharToMultiByte(CP_UTF8, 0, wbuf, -1, man_tmp, static_cast<int>(sizeof(man_tmp)), nullptr, nullptr);
-                if (conv > 0) {
-                    man_tmp[sizeof(man_tmp) - 1] = '\0';
-                    memo::bios_info::store_manufacturer(man_tmp);
-                    got_any = true;
+                    log = cache;
                 }
-            }
 
-            cb = sizeof(wbuf);
-            if (RegGetValueW(HKEY_LOCAL_MACHINE,
-                L"HARDWARE\\DESCRIPTION\\System\\BIOS",
-                L"SystemProductName",
-                RRF_RT_REG_SZ,
-                nullptr,
-                wbuf,
-                &cb) == ERROR_SUCCESS && wbuf[0] != L'\0') {
-                const int conv = WideCharToMultiByte(CP_UTF8, 0, wbuf, -1, model_tmp, static_cast<int>(sizeof(model_tmp)), nullptr, nullptr);
-                if (conv > 0) {
-                    model_tmp[sizeof(model_tmp) - 1] = '\0';
-                    memo::bios_info::store_model(model_tmp);
-                    got_any = true;
-                }
+                track_input("/dev/kmsg", core::KERNEL_LOG_INPUT, log->fingerprint());
+                return log;
             }
 
-            if (!memo::bios_info::is_cached()) {
-                memo::bios_info::cached = true;
+            // the next fetch() captures the log again, specific to VM::rescan()
+            static void invalidate() {
+                std::lock_guard<std::mutex> guard(mutex);
+                cache.reset();
             }
 
-            if (out_manufacturer) *out_manufacturer = memo::bios_info::fetch_manufacturer();
-            if (out_model) *out_model = memo::bios_info::fetch_model();
+            u64 fingerprint() const {
+                const u64 state = (static_cast<u64>(findings.to_ulong()) << 1) | static_cast<u64>(available);
+                return util::fingerprint(&state, sizeof(state));
+            }
 
-            return got_any;
-        }
-    #endif
-    };
+            bool has(const finding id) const {
+                return findings.test(id);
+            }
+        };
 
+        // the SMBIOS type 0 to 3 structures, decoded once straight from the firmware table so no 
+        // dmidecode binary is needed. The table is only readable by root, otherwise the strings 
+        // come from the copy the kernel decoded into /sys/devices/virtual/dmi/id, which has 
+        // everything except the BIOS characteristics
+        struct smbios {
+            enum field : u8 {
+                BIOS_VENDOR,
+                SYS_VENDOR,
+                PRODUCT_NAME,
+                PRODUCT_FAMILY,
+                PRODUCT_SKU,
+                BOARD_VENDOR,
+                BOARD_NAME,
+                CHASSIS_VENDOR,
+                CHASSIS_ASSET_TAG,
+                FIELD_COUNT
+            };
 
-    struct brands {
-        static constexpr const char* NULL_BRAND = "Unknown";
-        static constexpr const char* VBOX = "VirtualBox";
-        static constexpr const char* VMWARE = "VMware";
-        static constexpr const char* VMWARE_EXPRESS = "VMware Express";
-        static constexpr const char* VMWARE_ESX = "VMware ESX";
-        static constexpr const char* VMWARE_GSX = "VMware GSX";
-        static constexpr const char* VMWARE_WORKSTATION = "VMware Workstation";
-        static constexpr const char* VMWARE_FUSION = "VMware Fusion";
-        static constexpr const char* VMWARE_HARD = "VMware (with VmwareHardenedLoader)";
-        static constexpr const char* BHYVE = "bhyve";
-        static constexpr const char* KVM = "KVM";
-        static constexpr const char* QEMU = "QEMU";
-        static constexpr const char* QEMU_KVM = "QEMU+KVM";
-        static constexpr const char* KVM_HYPERV = "KVM Hyper-V Enlightenment";
-        static constexpr const char* QEMU_KVM_HYPERV = "QEMU+KVM Hyper-V Enlightenment";
-        static constexpr const char* HYPERV = "Microsoft Hyper-V";
-        static constexpr const char* HYPERV_VPC = "Microsoft Virtual PC/Hyper-V";
-        static constexpr const char* PARALLELS = "Parallels";
-        static constexpr const char* XEN = "Xen HVM";
-        static constexpr const char* ACRN = "ACRN";
-        static constexpr const char* QNX = "QNX hypervisor";
-        static constexpr const char* HYBRID = "Hybrid Analysis";
-        static constexpr const char* SANDBOXIE = "Sandboxie";
-        static constexpr const char* DOCKER = "Docker";
-        static constexpr const char* WINE = "Wine";
-        static constexpr const char* VPC = "Virtual PC";
-        static constexpr const char* ANUBIS = "Anubis";
-        static constexpr const char* JOEBOX = "JoeBox";
-        static constexpr const char* THREATEXPERT = "ThreatExpert";
-        static constexpr const char* CWSANDBOX = "CWSandbox";
-        static constexpr const char* COMODO = "Comodo";
-        static constexpr const char* BOCHS = "Bochs";
-        static constexpr const char* NVMM = "NetBSD NVMM";
-        static constexpr const char* BSD_VMM = "OpenBSD VMM";
-        static constexpr const char* INTEL_HAXM = "Intel HAXM";
-        static constexpr const char* UNISYS = "Unisys s-Par";
-        static constexpr const char* LMHS = "Lockheed Martin LMHS";
-        static constexpr const char* CUCKOO = "Cuckoo";
-        static constexpr const char* BLUESTACKS = "BlueStacks";
-        static constexpr const char* JAILHOUSE = "Jailhouse";
-        static constexpr const char* APPLE_VZ = "Apple VZ";
-        static constexpr const char* INTEL_KGT = "Intel KGT (Trusty)";
-        static constexpr const char* AZURE_HYPERV = "Microsoft Azure Hyper-V";
-        static constexpr const char* SIMPLEVISOR = "SimpleVisor";
-        static constexpr const char* HYPERV_ROOT = "Hyper-V root partition (host system, not an actual VM)";
-        static constexpr const char* UML = "User-mode Linux";
-        static constexpr const char* POWERVM = "IBM PowerVM";
-        static constexpr const char* GCE = "Google Compute Engine (KVM)";
-        static constexpr const char* OPENSTACK = "OpenStack (KVM)";
-        static constexpr const char* KUBEVIRT = "KubeVirt (KVM)";
-        static constexpr const char* AWS_NITRO = "AWS Nitro System EC2 (KVM-based)";
-        static constexpr const char* PODMAN = "Podman";
-        static constexpr const char* WSL = "WSL";
-        static constexpr const char* OPENVZ = "OpenVZ";
-        static constexpr const char* BAREVISOR = "Barevisor";
-        static constexpr const char* HYPERPLATFORM = "HyperPlatform";
-        static constexpr const char* MINIVISOR = "MiniVisor";
-        static constexpr const char* INTEL_TDX = "Intel TDX";
-        static constexpr const char* LKVM = "LKVM";
-        static constexpr const char* AMD_SEV = "AMD SEV";
-        static constexpr const char* AMD_SEV_ES = "AMD SEV-ES";
-        static constexpr const char* AMD_SEV_SNP = "AMD SEV-SNP";
-        static constexpr const char* NEKO_PROJECT = "Neko Project II";
-        static constexpr const char* NOIRVISOR = "NoirVisor";
-        static constexpr const char* QIHOO = "Qihoo 360 Sandbox";
-        static constexpr const char* NSJAIL = "nsjail";
-        static constexpr const char* DBVM = "DBVM";
-        static constexpr const char* UTM = "UTM";
-        static constexpr const char* COMPAQ = "Compaq FX!32";
-        static constexpr const char* INSIGNIA = "Insignia RealPC";
-        static constexpr const char* CONNECTIX = "Connectix Virtual PC";
+            bool from_table = false;
+            bool has_vm_bit = false;
+            bool vm_bit = false;
+            u8 chassis_type = 0; // 0 if there's no chassis structure, it's not a valid type
+            u64 table_fingerprint = 0;
+            std::array<std::string, FIELD_COUNT> fields;
+
+            static std::mutex mutex;
+            static std::shared_ptr<const smbios> cache;
+
+            static const char* table_path() noexcept {
+                return "/sys/firmware/dmi/tables/DMI";
+            }
+
+            static sys_snapshot::file sysfs_file(const field id) noexcept {
+                switch (id) {
+                    case BIOS_VENDOR: return sys_snapshot::BIOS_VENDOR;
+                    case SYS_VENDOR: return sys_snapshot::SYS_VENDOR;
+                    case PRODUCT_NAME: return sys_snapshot::PRODUCT_NAME;
+                    case PRODUCT_FAMILY: return sys_snapshot::PRODUCT_FAMILY;
+                    case PRODUCT_SKU: return sys_snapshot::PRODUCT_SKU;
+                    case BOARD_VENDOR: return sys_snapshot::BOARD_VENDOR;
+                    case BOARD_NAME: return sys_snapshot::BOARD_NAME;
+                    case CHASSIS_VENDOR: return sys_snapshot::CHASSIS_VENDOR;
+                    case CHASSIS_ASSET_TAG: return sys_snapshot::CHASSIS_ASSET_TAG;
+                    case FIELD_COUNT: break;
+                }
 
-        static brand_list_t brand_list(const flagset& flags) {
-            if (memo::brand_list::is_cached()) {
-                return memo::brand_list::fetch();
+                return sys_snapshot::FILE_COUNT;
             }
 
-            // run all the techniques
-            const u16 score = core::run_all(flags);
+            // walks the structure table, every structure is a formatted area of the length in its
+            // header followed by a set of strings that ends with a double null. The strings are 
+            // referenced from the formatted area by their 1-based index, 0 meaning there's none
+            static void decode(const u8* data, const size_t size, smbios& out) {
+                size_t offset = 0;
 
-            brand_list_t active_brands = {};
-            active_brands.reserve(MAX_BRANDS);
+                while (offset + 4 <= size) {
+                    const u8* const header = data + offset;
+                    const u8 type = header[0];
+                    const u8 length = header[1];
+
+                    if (length < 4 || offset + length > size) {
+                        break;
+                    }
+
+                    // the string set starts right after the formatted area
+                    const char* const strings = reinterpret_cast<const char*>(header + length);
+                    const char* const table_end = reinterpret_cast<const char*>(data + size);
+                    const char* next = strings;
+
+                    while (next + 1 < table_end && !(next[0] == '\0' && next[1] == '\0')) {
+                        next++;
+                    }
+
+                    auto string_at = [&](const u8 byte_offset) -> std::string {
+                        if (byte_offset >= length || header[byte_offset] == 0) {
+                            return "";
+                        }
 
-            for (size_t i = 0; i < MAX_BRANDS; ++i) {
-                if (core::brand_scoreboard.at(i).score > 0) {
-                    active_brands.push_back(std::make_pair(core::brand_scoreboard.at(i).name, core::brand_scoreboard.at(i).score));
+                        const char* current = strings;
+                        for (u8 index = 1; index < header[byte_offset] && current < next; index++) {
+                            current += std::strlen(current) + 1;
+                        }
+
+                        return (current < next) ? std::string(current) : "";
+                    };
+
+                    switch (type) {
+                        case 0: // BIOS information
+                            out.fields[BIOS_VENDOR] = string_at(0x04);
+                            if (length > 0x13) {
+                                // bit 4 of the BIOS characteristics extension byte 2
+                                out.has_vm_bit = true;
+                                out.vm_bit = (header[0x13] & (1 << 4));
+                            }
+                            break;
+                        case 1: // system information
+                            out.fields[SYS_VENDOR] = string_at(0x04);
+                            out.fields[PRODUCT_NAME] = string_at(0x05);
+                            out.fields[PRODUCT_SKU] = string_at(0x19);
+                            out.fields[PRODUCT_FAMILY] = string_at(0x1A);
+                            break;
+                        case 2: // baseboard information
+                            out.fields[BOARD_VENDOR] = string_at(0x04);
+                            out.fields[BOARD_NAME] = string_at(0x05);
+                            break;
+                        case 3: // chassis information
+                            out.fields[CHASSIS_VENDOR] = string_at(0x04);
+                            out.fields[CHASSIS_ASSET_TAG] = string_at(0x08);
+                            if (length > 0x05) {
+                                out.chassis_type = (header[0x05] & 0x7F);
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+
+                    // type 127 is the end of table marker
+                    if (type == 127) {
+                        break;
+                    }
+
+                    offset = static_cast<size_t>(reinterpret_cast<const u8*>(next) - data) + 2;
                 }
             }
-    
-            #ifdef __VMAWARE_DEBUG__
-                for (const auto brand : active_brands) {
-                    debug("pre-processed scoreboard: ", int(brand.second), " : ", brands::brand_enum_to_string(brand.first));
+
+            static std::shared_ptr<const smbios> load() {
+                std::shared_ptr<smbios> info = std::make_shared<smbios>();
+                std::string buffer;
+
+                if (append_file(table_path(), buffer) && !buffer.empty()) {
+                    info->from_table = true;
+                    info->table_fingerprint = fingerprint(buffer.data(), buffer.size());
+                    decode(reinterpret_cast<const u8*>(buffer.data()), buffer.size(), *info);
+                    debug("smbios: decoded ", buffer.size(), " bytes of structure table");
+                    return info;
                 }
-            #endif
 
-            auto remove = [&](const enum brand_enum brand) noexcept {
-                for (u8 i = 0; i < active_brands.size(); i++) {
-                    if (brand == active_brands.at(i).first) {
-                        active_brands.erase(active_brands.begin() + i);
-                        return;
+                const std::shared_ptr<const sys_snapshot> snapshot = sys_snapshot::fetch();
+
+                if (snapshot->present.test(sys_snapshot::CHASSIS_TYPE)) {
+                    const int type = std::atoi(snapshot->arena.data() + snapshot->offsets[sys_snapshot::CHASSIS_TYPE]);
+                    info->chassis_type = static_cast<u8>(type & 0x7F);
+                }
+
+                for (u8 i = 0; i < FIELD_COUNT; i++) {
+                    const sys_snapshot::file file = sysfs_file(static_cast<field>(i));
+
+                    if (!snapshot->present.test(file)) {
+                        continue;
+                    }
+
+                    // sysfs attributes end with a newline, the table strings don't
+                    std::string& value = info->fields[i];
+                    value.assign(snapshot->arena.data() + snapshot->offsets[file], snapshot->sizes[file]);
+                    while (!value.empty() && (value.back() == '\n' || value.back() == ' ')) {
+                        value.pop_back();
                     }
                 }
-            };
 
-            // if all brands have a point of 0, return "Unknown"
-            if (active_brands.size() == 0) {                        
-                active_brands.push_back({brand_enum::NULL_BRAND, 1});
-                memo::brand_list::store(active_brands);
-                return active_brands;
+                return info;
             }
 
-            // if there's only a single brand, return it immediately
-            // We skip this early return if the single brand is HYPERV_ARTIFACT,
-            // but we must also nullify the result if the score is above 0, 
-            // which would most likely indicate a hardened VM instead and return "Unknown".
-            if (active_brands.size() == 1) {
-                const enum brand_enum brand = active_brands.front().first;
+            // the inputs are recorded on every fetch since the decoded result is shared between techniques
+            static std::shared_ptr<const smbios> fetch() {
+                std::shared_ptr<const smbios> info;
 
-                if (brand == brand_enum::HYPERV_ROOT && score > 0) {
-                    active_brands.push_back({brand_enum::NULL_BRAND, 1});
-                    remove(brand_enum::HYPERV_ROOT);
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+
+                    if (!cache) {
+                        cache = load();
+                    }
+
+                    info = cache;
                 }
 
-                memo::brand_list::store(active_brands);
-                return active_brands;
-            }
+                if (info->from_table) {
+                    track_input(table_path(), core::BINARY_INPUT, info->table_fingerprint);
+                } else {
+                    const std::shared_ptr<const sys_snapshot> snapshot = sys_snapshot::fetch();
 
-            // remove Hyper-V artifacts and Unknown if found with other brands
-            if (active_brands.size() > 1) {
-                remove(brand_enum::HYPERV_ROOT);
-                remove(brand_enum::NULL_BRAND);
-                remove(brand_enum::INVALID);
-            }
+                    for (u8 i = 0; i < FIELD_COUNT; i++) {
+                        snapshot->view(sysfs_file(static_cast<field>(i)));
+                    }
 
-            // this bitset acts as an abstraction layer for the merging stage of this function.
-            // the amount of hits above 0 for a brand isn't relevant, the core idea here is to
-            // just check the presence of the brand itself so we can merge them. 
-            std::bitset<MAX_BRANDS> brand_hits = {};
+                    snapshot->view(sys_snapshot::CHASSIS_TYPE);
+                }
 
-            for (const auto brand : active_brands) {
-                brand_hits.set(static_cast<u8>(brand.first));
+                return info;
             }
 
-            // merge 2 brands into one
-            auto merge = [&](const enum brand_enum a, const enum brand_enum b, const enum brand_enum result) noexcept -> void {
-                const bool a_hit = brand_hits.test(static_cast<u8>(a));
-                const bool b_hit = brand_hits.test(static_cast<u8>(b));
+            static void invalidate() {
+                std::lock_guard<std::mutex> guard(mutex);
+                cache.reset();
+            }
 
-                if (a_hit && b_hit) {
-                    remove(a);
-                    remove(b);
-                    active_brands.push_back({result, 2});
-                }
+            text_view view(const field id) const {
+                return { fields[id].data(), fields[id].size() };
+            }
+        };
+
+        // the processes the techniques look for, found in a single walk over /proc. Every process 
+        // is matched by the basename of its argv0 against the whole list at once, so looking 
+        // for one more process only costs another entry in the list and not another walk
+        struct process_table {
+            enum process : u8 {
+                QEMU_GA,
+                PROCESS_COUNT
             };
 
-            // same as above, but for 3
-            auto triple_merge = [&](const enum brand_enum a, const enum brand_enum b, const enum brand_enum c, const enum brand_enum result) noexcept -> void {
-                const bool a_hit = brand_hits.test(static_cast<u8>(a));
-                const bool b_hit = brand_hits.test(static_cast<u8>(b));
-                const bool c_hit = brand_hits.test(static_cast<u8>(c));
+            std::bitset<PROCESS_COUNT> found;
+            std::array<std::string, PROCESS_COUNT> cmdline_paths; // of the first match, for VM::rescan()
+            std::array<u64, PROCESS_COUNT> fingerprints;
 
-                if (a_hit && b_hit && c_hit) {
-                    remove(a);
-                    remove(b);
-                    remove(c);
-                    active_brands.push_back({result, 2});
-                }
-            };
+            static std::mutex mutex;
+            static std::shared_ptr<const process_table> cache;
 
-            // Brand post-processing / merging
-            merge(brand_enum::VPC, brand_enum::HYPERV, brand_enum::HYPERV_VPC);
+            static const char* name(const process id) noexcept {
+                static constexpr const char* names[PROCESS_COUNT] = {
+                    "qemu_ga"
+                };
 
-            merge(brand_enum::AZURE_HYPERV, brand_enum::HYPERV, brand_enum::AZURE_HYPERV);
-            merge(brand_enum::AZURE_HYPERV, brand_enum::VPC, brand_enum::AZURE_HYPERV);
-            merge(brand_enum::AZURE_HYPERV, brand_enum::HYPERV_VPC, brand_enum::AZURE_HYPERV);
+                return names[id];
+            }
 
-            merge(brand_enum::QEMU, brand_enum::KVM, brand_enum::QEMU_KVM);
-            merge(brand_enum::KVM, brand_enum::HYPERV, brand_enum::KVM_HYPERV);
-            merge(brand_enum::QEMU, brand_enum::HYPERV, brand_enum::QEMU_KVM_HYPERV);
-            merge(brand_enum::QEMU_KVM, brand_enum::HYPERV, brand_enum::QEMU_KVM_HYPERV);
+            // bitmap of which of the (at most 64) names have a running process, with the pid of 
+            // the first match in pids if it's given. Nothing is allocated, the directory entries 
+            // and the files are read into stack buffers relative to the /proc descriptor. 
+            // A process matches by its comm, which is the executable name, or by the basename of 
+            // its argv0. comm is cut to 15 characters, so a comm of that length could be a longer 
+            // name and doesn't count on its own. cmdline is only read when comm didn't already 
+            // match every name that's still missing, since argv0 can differ from the executable
+            static u64 scan(const char* const* names, const size_t count, u32* pids = nullptr) {
+                const size_t needles = std::min<size_t>(count, 64);
+                const u64 all = (needles == 64) ? ~0ULL : ((1ULL << needles) - 1);
+                u64 result = 0;
 
-            merge(brand_enum::KVM, brand_enum::HYPERV_VPC, brand_enum::KVM_HYPERV);
-            merge(brand_enum::QEMU, brand_enum::HYPERV_VPC, brand_enum::QEMU_KVM_HYPERV);
-            merge(brand_enum::QEMU_KVM, brand_enum::HYPERV_VPC, brand_enum::QEMU_KVM_HYPERV);
+                const int proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                if (proc_fd < 0) {
+                    debug("process_table: ", "failed to open /proc directory");
+                    return 0;
+                }
 
-            merge(brand_enum::KVM, brand_enum::KVM_HYPERV, brand_enum::KVM_HYPERV);
-            merge(brand_enum::QEMU, brand_enum::KVM_HYPERV, brand_enum::QEMU_KVM_HYPERV);
-            merge(brand_enum::QEMU_KVM, brand_enum::KVM_HYPERV, brand_enum::QEMU_KVM_HYPERV);
+                std::array<size_t, 64> lengths;
+                for (size_t i = 0; i < needles; i++) {
+                    lengths[i] = std::strlen(names[i]);
+                }
 
-            triple_merge(brand_enum::QEMU, brand_enum::KVM, brand_enum::KVM_HYPERV, brand_enum::QEMU_KVM_HYPERV);
+                // linux_dirent64 records: 8 byte inode, 8 byte offset, 2 byte record length, 1 byte type, then the name
+                constexpr size_t reclen_offset = 16;
+                constexpr size_t name_offset = 19;
+                constexpr size_t comm_length = 15;
+                alignas(8) char entries[16384];
+                char path[32];
+                char cmdline[4096];
+
+                auto read_at = [&](const char* file, char* out, const size_t size) -> ssize_t {
+                    // fails if the process exited in the meantime
+                    const int fd = openat(proc_fd, file, O_RDONLY | O_CLOEXEC);
+                    if (fd < 0) {
+                        return -1;
+                    }
 
-            merge(brand_enum::VMWARE, brand_enum::VMWARE_FUSION, brand_enum::VMWARE_FUSION);
-            merge(brand_enum::VMWARE, brand_enum::VMWARE_EXPRESS, brand_enum::VMWARE_EXPRESS);
-            merge(brand_enum::VMWARE, brand_enum::VMWARE_ESX, brand_enum::VMWARE_ESX);
-            merge(brand_enum::VMWARE, brand_enum::VMWARE_GSX, brand_enum::VMWARE_GSX);
-            merge(brand_enum::VMWARE, brand_enum::VMWARE_WORKSTATION, brand_enum::VMWARE_WORKSTATION);
+                    ssize_t length;
+                    do {
+                        length = read(fd, out, size);
+                    } while (length < 0 && errno == EINTR);
 
-            merge(brand_enum::VMWARE_HARD, brand_enum::VMWARE, brand_enum::VMWARE_HARD);
-            merge(brand_enum::VMWARE_HARD, brand_enum::VMWARE_FUSION, brand_enum::VMWARE_HARD);
-            merge(brand_enum::VMWARE_HARD, brand_enum::VMWARE_EXPRESS, brand_enum::VMWARE_HARD);
-            merge(brand_enum::VMWARE_HARD, brand_enum::VMWARE_ESX, brand_enum::VMWARE_HARD);
-            merge(brand_enum::VMWARE_HARD, brand_enum::VMWARE_GSX, brand_enum::VMWARE_HARD);
-            merge(brand_enum::VMWARE_HARD, brand_enum::VMWARE_WORKSTATION, brand_enum::VMWARE_HARD);
+                    close(fd);
+                    return length;
+                };
 
-            
-            if (active_brands.size() > 1) {
-                std::sort(active_brands.begin(), active_brands.begin() + static_cast<std::ptrdiff_t>(active_brands.size()), [](
-                    const brand_element_t& a,
-                    const brand_element_t& b
-                ) {
-                    return a.second > b.second; // .second = brand score (usually u8)
-                });
-            }
+                while (result != all) {
+                    const long bytes = syscall(SYS_getdents64, proc_fd, entries, sizeof(entries));
 
-            for (const auto brand : active_brands) {
-                if (brand.second > 0) {
-                    active_brands.push_back({brand.first, brand.second});
-                }
-            }
+                    if (bytes <= 0) {
+                        break;
+                    }
 
-        #ifdef __VMAWARE_DEBUG__
-            for (const auto brand : active_brands) {
-                debug("post-processed scoreboard: ", brand.second, " : ", brands::brand_enum_to_string(brand.first));
-            }
-        #endif
+                    for (long position = 0; position < bytes && result != all; ) {
+                        u16 record_length = 0;
+                        std::memcpy(&record_length, entries + position + reclen_offset, sizeof(record_length));
 
-            memo::brand_list::store(active_brands);
-            return active_brands;
-        }
+                        const char* const entry = entries + position + name_offset;
+                        position += record_length;
 
-        static const char* brand_enum_to_string(const brand_enum brand) {
-            switch (brand) {
-                case brand_enum::INVALID: return "Invalid";
-                case brand_enum::VBOX: return VM::brands::VBOX;
-                case brand_enum::VMWARE: return VM::brands::VMWARE;
-                case brand_enum::VMWARE_EXPRESS: return VM::brands::VMWARE_EXPRESS;
-                case brand_enum::VMWARE_ESX: return VM::brands::VMWARE_ESX;
-                case brand_enum::VMWARE_GSX: return VM::brands::VMWARE_GSX;
-                case brand_enum::VMWARE_WORKSTATION: return VM::brands::VMWARE_WORKSTATION;
-                case brand_enum::VMWARE_FUSION: return VM::brands::VMWARE_FUSION;
-                case brand_enum::VMWARE_HARD: return VM::brands::VMWARE_HARD;
-                case brand_enum::BHYVE: return VM::brands::BHYVE;
-                case brand_enum::KVM: return VM::brands::KVM;
-                case brand_enum::QEMU: return VM::brands::QEMU;
-                case brand_enum::QEMU_KVM: return VM::brands::QEMU_KVM;
-                case brand_enum::KVM_HYPERV: return VM::brands::KVM_HYPERV;
-                case brand_enum::QEMU_KVM_HYPERV: return VM::brands::QEMU_KVM_HYPERV;
-                case brand_enum::HYPERV: return VM::brands::HYPERV;
-                case brand_enum::HYPERV_VPC: return VM::brands::HYPERV_VPC;
-                case brand_enum::PARALLELS: return VM::brands::PARALLELS;
-                case brand_enum::XEN: return VM::brands::XEN;
-                case brand_enum::ACRN: return VM::brands::ACRN;
-                case brand_enum::QNX: return VM::brands::QNX;
-                case brand_enum::HYBRID: return VM::brands::HYBRID;
-                case brand_enum::SANDBOXIE: return VM::brands::SANDBOXIE;
-                case brand_enum::DOCKER: return VM::brands::DOCKER;
-                case brand_enum::WINE: return VM::brands::WINE;
-                case brand_enum::VPC: return VM::brands::VPC;
-                case brand_enum::ANUBIS: return VM::brands::ANUBIS;
-                case brand_enum::JOEBOX: return VM::brands::JOEBOX;
-                case brand_enum::THREATEXPERT: return VM::brands::THREATEXPERT;
-                case brand_enum::CWSANDBOX: return VM::brands::CWSANDBOX;
-                case brand_enum::COMODO: return VM::brands::COMODO;
-                case brand_enum::BOCHS: return VM::brands::BOCHS;
-                case brand_enum::NVMM: return VM::brands::NVMM;
-                case brand_enum::BSD_VMM: return VM::brands::BSD_VMM;
-                case brand_enum::INTEL_HAXM: return VM::brands::INTEL_HAXM;
-                case brand_enum::UNISYS: return VM::brands::UNISYS;
-                case brand_enum::LMHS: return VM::brands::LMHS;
-                case brand_enum::CUCKOO: return VM::brands::CUCKOO;
-                case brand_enum::BLUESTACKS: return VM::brands::BLUESTACKS;
-                case brand_enum::JAILHOUSE: return VM::brands::JAILHOUSE;
-                case brand_enum::APPLE_VZ: return VM::brands::APPLE_VZ;
-                case brand_enum::INTEL_KGT: return VM::brands::INTEL_KGT;
-                case brand_enum::AZURE_HYPERV: return VM::brands::AZURE_HYPERV;
-                case brand_enum::SIMPLEVISOR: return VM::brands::SIMPLEVISOR;
-                case brand_enum::HYPERV_ROOT: return VM::brands::HYPERV_ROOT;
-                case brand_enum::UML: return VM::brands::UML;
-                case brand_enum::POWERVM: return VM::brands::POWERVM;
-                case brand_enum::GCE: return VM::brands::GCE;
-                case brand_enum::OPENSTACK: return VM::brands::OPENSTACK;
-                case brand_enum::KUBEVIRT: return VM::brands::KUBEVIRT;
-                case brand_enum::AWS_NITRO: return VM::brands::AWS_NITRO;
-                case brand_enum::PODMAN: return VM::brands::PODMAN;
-                case brand_enum::WSL: return VM::brands::WSL;
-                case brand_enum::OPENVZ: return VM::brands::OPENVZ;
-                case brand_enum::BAREVISOR: return VM::brands::BAREVISOR;
-                case brand_enum::HYPERPLATFORM: return VM::brands::HYPERPLATFORM;
-                case brand_enum::MINIVISOR: return VM::brands::MINIVISOR;
-                case brand_enum::INTEL_TDX: return VM::brands::INTEL_TDX;
-                case brand_enum::LKVM: return VM::brands::LKVM;
-                case brand_enum::AMD_SEV: return VM::brands::AMD_SEV;
-                case brand_enum::AMD_SEV_ES: return VM::brands::AMD_SEV_ES;
-                case brand_enum::AMD_SEV_SNP: return VM::brands::AMD_SEV_SNP;
-                case brand_enum::NEKO_PROJECT: return VM::brands::NEKO_PROJECT;
-                case brand_enum::NOIRVISOR: return VM::brands::NOIRVISOR;
-                case brand_enum::QIHOO: return VM::brands::QIHOO;
-                case brand_enum::NSJAIL: return VM::brands::NSJAIL;
-                case brand_enum::DBVM: return VM::brands::DBVM;
-                case brand_enum::UTM: return VM::brands::UTM;
-                case brand_enum::COMPAQ: return VM::brands::COMPAQ;
-                case brand_enum::INSIGNIA: return VM::brands::INSIGNIA;
-                case brand_enum::CONNECTIX: return VM::brands::CONNECTIX;
-                case brand_enum::NULL_BRAND: return VM::brands::NULL_BRAND; // do not modify placement of this, it's used as an anchor point to count the number of brands
-            }
+                        // only the pid directories, which are all digits
+                        size_t digits = 0;
+                        u32 pid = 0;
 
-            return "Invalid";
-        }
+                        while (entry[digits] >= '0' && entry[digits] <= '9' && digits < 10) {
+                            pid = (pid * 10) + static_cast<u32>(entry[digits] - '0');
+                            digits++;
+                        }
 
-        static std::string fetch_brand_name(const brand_list_t& list, const size_t index) {
-            return brand_enum_to_string(list[index].first);
-        };
-    
-        static std::string brand_multiple(const flagset& flags = core::generate_default()) {
-            if (memo::multi_brand::is_cached()) {
-                return memo::multi_brand::fetch();
-            }
+                        if (digits == 0 || entry[digits] != '\0') {
+                            continue;
+                        }
 
-            const brand_list_t& list = brands::brand_list(flags);
-            const std::string& buffer = brand_multiple(list);
-    
-            memo::multi_brand::store(buffer);
-            return buffer;
-        }
-            
-        static std::string brand_multiple(const brand_list_t& list) {
-            std::string buffer = {};
-            buffer += brands::fetch_brand_name(list, 0);
+                        std::memcpy(path, entry, digits);
+                        std::memcpy(path + digits, "/comm", sizeof("/comm"));
 
-            for (size_t i = 1; i < list.size(); i++) {
-                buffer += " or "; 
-                buffer += brands::fetch_brand_name(list, i);
-            }
+                        char comm[comm_length + 1];
+                        ssize_t length = read_at(path, comm, sizeof(comm));
 
-            return buffer;
-        }
+                        if (length <= 0) {
+                            continue;
+                        }
 
-        static brand_enum brand_enum(const flagset& flags = core::generate_default()) {
-            if (memo::single_brand::is_cached()) {
-                return memo::single_brand::fetch();
-            }
+                        const size_t comm_size = static_cast<size_t>(length) - (comm[length - 1] == '\n' ? 1 : 0);
+                        u64 matched = 0;
 
-            const brand_list_t& list = brands::brand_list(flags);
-            const enum brand_enum brand = brand_enum(list);
-    
-            memo::single_brand::store(brand);
+                        if (comm_size < comm_length) {
+                            for (size_t i = 0; i < needles; i++) {
+                                if (lengths[i] == comm_size && std::memcmp(comm, names[i], comm_size) == 0) {
+                                    matched |= (1ULL << i);
+                                }
+                            }
+                        }
 
-            return brand;
-        }
+                        if (pids != nullptr) {
+                            for (size_t i = 0; i < needles; i++) {
+                                if ((matched & ~result) & (1ULL << i)) {
+                                    pids[i] = pid;
+                                }
+                            }
+                        }
 
-        static enum brand_enum brand_enum(const brand_list_t& list) {
-            const brand_element_t brand = list.front();
-            return brand.first;
-        }
-    };
+                        result |= matched;
 
-// START OF PRIVATE VM DETECTION TECHNIQUE DEFINITIONS
-    /**
-     * @brief Check CPUID output of manufacturer ID for known VMs/hypervisors at leaf 0 and 0x40000000-0x40000100
-     * @category x86
-     * @implements VM::VMID
-     */
-     [[nodiscard]] static bool vmid() {
-    #if (!x86)
-        return false;
-    #else
-        return (
-            cpu::vmid_template(0) ||
-            cpu::vmid_template(cpu::leaf::hypervisor) || // 0x40000000
-            cpu::vmid_template(cpu::leaf::hypervisor + 0x100) // 0x40000100
-        );
-    #endif
-    }
+                        // nothing left that argv0 could add
+                        if (result == all) {
+                            continue;
+                        }
 
+                        std::memcpy(path + digits, "/cmdline", sizeof("/cmdline"));
+                        length = read_at(path, cmdline, sizeof(cmdline));
 
-    /**
-     * @brief Check if CPU brand model contains any VM-specific string snippets
-     * @category x86
-     * @implements VM::CPU_BRAND
-     */
-    [[nodiscard]] static bool cpu_brand() {
-    #if (!x86)
-        return false;
-    #else
-        const std::string& brand = cpu::get_brand();
+                        // kernel threads have an empty command line
+                        if (length <= 0) {
+                            continue;
+                        }
 
-        // easy shortcut for QEMU
-        if (brand.rfind("QEMU Virtual CPU version", 0) == 0) {
-            return core::add(brand_enum::QEMU);
-        }
+                        // cmdline is argv0\0argv1\0..., so argv0 is bytes up to first NUL
+                        const char* argv0_end = static_cast<const char*>(std::memchr(cmdline, '\0', static_cast<size_t>(length)));
+                        if (argv0_end == nullptr) {
+                            argv0_end = cmdline + length;
+                        }
 
-        struct cstrview {
-            const char* data;
-            std::size_t size;
-            constexpr cstrview(const char* d, std::size_t s) noexcept
-                : data(d), size(s) {
-            }
-        };
-
-        static constexpr std::array<cstrview, 10> checks{ {
-            { "qemu",       4 },
-            { "kvm",        3 },
-            { "vbox",       4 },
-            { "virtualbox", 10},
-            { "monitor",    7 },
-            { "bhyve",      5 },
-            { "hypervisor", 10},
-            { "hvisor",     6 },
-            { "parallels",  9 },
-            { "vmware",     6 }
-        } };
+                        const char* basename = argv0_end;
+                        while (basename > cmdline && basename[-1] != '/') {
+                            basename--;
+                        }
 
-        for (auto& v : checks) {
-            if (brand.size() < v.size)
-                continue;  // too short to match
+                        const size_t basename_length = static_cast<size_t>(argv0_end - basename);
 
-            if (brand.find(v.data) != std::string::npos) {
-                debug("CPU_BRAND: match = ", v.data);
+                        for (size_t i = 0; i < needles; i++) {
+                            const u64 bit = (1ULL << i);
 
-                // For these, we only care that it's virtualized:
-                if (v.size == 7  // "monitor"
-                    || ((v.size == 6) && (v.data[0] == 'h'))  // "hvisor"
-                    || ((v.size == 10) && (v.data[0] == 'h')) // "hypervisor" 
-                    ) {
-                    return true;
-                }
+                            if ((result & bit) || lengths[i] != basename_length || std::memcmp(basename, names[i], basename_length) != 0) {
+                                continue;
+                            }
 
-                // Otherwise map to our enums:
-                switch (v.size) {
-                case 4:  // "qemu" or "vbox"
-                    return core::add(v.data[0] == 'q'
-                        ? brand_enum::QEMU
-                        : brand_enum::VBOX);
-                case 3:  // "kvm"
-                    return core::add(brand_enum::KVM);
-                case 5:  // "bhyve"
-                    return core::add(brand_enum::BHYVE);
-                case 9:  // "parallels"
-                    return core::add(brand_enum::PARALLELS);
-                case 10: // "virtualbox"
-                    return core::add(brand_enum::VBOX);
-                case 6:  // "vmware"
-                    return core::add(brand_enum::VMWARE);
-                default:
-                    return false;
+                            result |= bit;
+
+                            if (pids != nullptr) {
+                                pids[i] = pid;
+                            }
+                        }
+                    }
                 }
+
+                close(proc_fd);
+                return result;
             }
-        }
 
-        return false;
-    #endif
-    }
+            static std::string cmdline_path(const u32 pid) {
+                return "/proc/" + std::to_string(pid) + "/cmdline";
+            }
 
+            static std::shared_ptr<const process_table> load() {
+                std::shared_ptr<process_table> table = std::make_shared<process_table>();
 
-    /**
-     * @brief Check if hypervisor feature bit in CPUID ECX bit 31 is enabled (always false for physical CPUs)
-     * @category x86
-     * @implements VM::HYPERVISOR_BIT
-     */
-    [[nodiscard]] static bool hypervisor_bit() {
-    #if (!x86)
-        return false;
-    #else
-        u32 eax = 0, ebx = 0, ecx = 0, edx = 0;
-        cpu::cpuid(eax, ebx, ecx, edx, 1); 
-        constexpr u32 HYPERVISOR_MASK = (1u << 31);
+                std::array<const char*, PROCESS_COUNT> names;
+                std::array<u32, PROCESS_COUNT> pids{};
 
-        if (ecx & HYPERVISOR_MASK) {
-            // if hypervisor bit is enabled, but we're in a root partition, prevent it from flagging
-            if (util::hyper_x() == HYPERV_ARTIFACT_VM) {
-                return false;
-            }
+                for (u8 i = 0; i < PROCESS_COUNT; i++) {
+                    names[i] = name(static_cast<process>(i));
+                }
 
-            return true;
-        }
-        else {
-            // if hypervisor bit is disabled, but vmaware detects hyper-v signals, we're in an impossible situation (patching)
-            if (util::hyper_x() == HYPERV_ARTIFACT_VM) {
-                return true;
-            }
-        }
+                const u64 result = scan(names.data(), names.size(), pids.data());
 
-        return false;
-    #endif
-    }
+                for (u8 i = 0; i < PROCESS_COUNT; i++) {
+                    if (!((result >> i) & 1ULL)) {
+                        continue;
+                    }
 
+                    std::string content;
+                    table->cmdline_paths[i] = cmdline_path(pids[i]);
+                    append_file(table->cmdline_paths[i].c_str(), content);
 
-    /**
-     * @brief Check for hypervisor brand string length (would be around 2 characters in a host machine)
-     * @category x86
-     * @implements VM::HYPERVISOR_STR
-     */
-    [[nodiscard]] static bool hypervisor_str() {
-    #if (!x86)
-        return false;
-    #else
-        if (util::hyper_x() == HYPERV_ARTIFACT_VM) {
-            return false;
-        }
+                    table->found.set(i);
+                    table->fingerprints[i] = fingerprint(content.data(), content.size());
+                }
 
-        char out[sizeof(i32) * 4 + 1] = { 0 }; // e*x size + number of e*x registers + null terminator
-        cpu::cpuid(reinterpret_cast<int*>(out), cpu::leaf::hypervisor);
+                return table;
+            }
 
-        debug("HYPERVISOR_STR: \neax: ", static_cast<u32>(out[0]),
-            "\nebx: ", static_cast<u32>(out[1]),
-            "\necx: ", static_cast<u32>(out[2]),
-            "\nedx: ", static_cast<u32>(out[3])
-        );
+            // a match is recorded on every fetch so VM::rescan() notices when that process exits. 
+            // A process that starts after the scan is not noticed, same as with single files
+            static std::shared_ptr<const process_table> fetch() {
+                std::shared_ptr<const process_table> table;
 
-        return (std::strlen(out + 4) >= 4);
-    #endif  
-    }
-    
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
 
-    /**
-     * @brief Check for various Bochs-related emulation oversights through CPU checks
-     * @category x86
-     * @author Discovered by Peter Ferrie, Senior Principal Researcher, Symantec Advanced Threat Research peter_ferrie@symantec.com
-     * @implements VM::BOCHS_CPU
-     */
-    [[nodiscard]] static bool bochs_cpu() {
-    #if (!x86)
-        return false;
-    #else
-        const bool intel = cpu::is_intel();
-        const bool amd = cpu::is_amd();
+                    if (!cache) {
+                        cache = load();
+                    }
 
-        // if neither amd or intel, return false
-        if (!(intel || amd)) {
-            debug("BOCHS_CPU: neither AMD or Intel detected, returned false");
-            return false;
-        }
+                    table = cache;
+                }
 
-        const std::string brand = cpu::get_brand();
+                for (u8 i = 0; i < PROCESS_COUNT; i++) {
+                    if (table->found.test(i)) {
+                        track_input(table->cmdline_paths[i].c_str(), core::BINARY_INPUT, table->fingerprints[i]);
+                    }
+                }
 
-        if (intel) {
-            // technique 1: not a valid brand 
-            if (brand == "              Intel(R) Pentium(R) 4 CPU        ") {
-                debug("BOCHS_CPU: technique 1 found");
-                return core::add(brand_enum::BOCHS);
-            }
-        } else if (amd) {
-            // technique 2: "processor" should have a capital P
-            if (brand == "AMD Athlon(tm) processor") {
-                debug("BOCHS_CPU: technique 2 found");
-                return core::add(brand_enum::BOCHS);
+                return table;
             }
 
-            // technique 3: Check for absence of AMD easter egg for K7 and K8 CPUs
-            constexpr u32 AMD_EASTER_EGG = 0x8fffffff; // this is the CPUID leaf of the AMD easter egg
+            static void invalidate() {
+                std::lock_guard<std::mutex> guard(mutex);
+                cache.reset();
+            }
 
-            if (!cpu::is_leaf_supported(AMD_EASTER_EGG)) {
-                return false;
+            bool running(const process id) const {
+                return found.test(id);
             }
+        };
+    #endif
 
-            u32 unused, eax = 0;
-            cpu::cpuid(eax, unused, unused, unused, 1);
+        // fetch the file but in binary form
+        [[nodiscard]] static std::vector<u8> read_file_binary(const char* file_path) {
+            std::vector<u8> buffer;
 
-            auto is_k7 = [](const u32 eax) noexcept -> bool {
-                if ((eax & 0x0FF00F00) != 0x00000600) {
-                    return false;
-                }
+        #if (LINUX)
+            std::string data;
 
-                const u32 model = (eax >> 4) & 0xF;
+            if (append_file(file_path, data)) {
+                buffer.assign(data.begin(), data.end());
+            }
+        #else
+            // no read(2) based reader outside of Linux, but the file is still read in one go
+            std::ifstream file(file_path, std::ios::binary | std::ios::ate);
 
-                return (model - 1) < 4;
-            };
+            if (file) {
+                const std::streamoff size = file.tellg();
 
-            auto is_k8 = [](const u32 eax) noexcept -> bool {
-                if (((eax >> 8) & 0xF) != 0xF) {
-                    return false;
+                if (size > 0) {
+                    buffer.resize(static_cast<size_t>(size));
+                    file.seekg(0);
+
+                    if (!file.read(reinterpret_cast<char*>(buffer.data()), size)) {
+                        buffer.clear();
+                    }
                 }
+            }
+        #endif
 
-                const u32 extended_family = (eax >> 20) & 0xFF;
+            track_input(file_path, core::BINARY_INPUT, fingerprint(buffer.data(), buffer.size()));
+            return buffer;
+        }
 
-                return extended_family <= 1;
-            };
 
-            if (!(is_k7(eax) || is_k8(eax))) {
-                return false;
-            }
+        // wrapper for std::make_unique because it's not available for C++11
+        template<typename T, typename... Args>
+        [[nodiscard]] static std::unique_ptr<T> make_unique(Args&&... args) {
+        #if (VMA_CPP < 14)
+            return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
+        #else
+            return std::make_unique<T>(std::forward<Args>(args)...);
+        #endif
+        }
 
-            u32 ecx_bochs = 0;
-            cpu::cpuid(unused, unused, ecx_bochs, unused, AMD_EASTER_EGG);
 
-            if (ecx_bochs == 0) {
-                return true;
+        [[nodiscard]] static bool is_admin() noexcept {
+        #if (LINUX || APPLE)
+            const uid_t uid = getuid();
+            const uid_t euid = geteuid();
+
+            return (
+                (uid != euid) ||
+                (euid == 0)
+            );
+        #elif (WINDOWS)
+            bool is_admin = false;
+            HANDLE hToken = nullptr;
+            const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
+            if (OpenProcessToken(current_process, TOKEN_QUERY, &hToken)) {
+                TOKEN_ELEVATION elevation{};
+                DWORD dwSize;
+                if (GetTokenInformation(hToken, TokenElevation, &elevation, sizeof(elevation), &dwSize)) {
+                    if (elevation.TokenIsElevated)
+                        is_admin = true;
+                }
+                CloseHandle(hToken);
             }
+            return is_admin;
+        #else
+            return true;
+        #endif
         }
 
-        return false;
-    #endif
-    }
-       
-    
-    /**
-	 * @brief Check if the system's thread count matches the expected thread count for the detected CPU model
-     * @category x86
-     * @implements VM::THREAD_MISMATCH
-     */
-    [[nodiscard]] static bool thread_mismatch() {
-    #if (!x86)
-        return false;
-    #else
-        auto is_smt_enabled = []() noexcept -> bool {
-            auto popcount = [](uint64_t v) noexcept -> int {
-            #if (GCC) || (CLANG)
-                return __builtin_popcountll(v);
-            #elif (MSVC)
-            #if (x86_32)
-                return static_cast<int>(
-                    __popcnt(static_cast<unsigned int>(v)) +
-                    __popcnt(static_cast<unsigned int>(v >> 32))
-                    );
-            #else
-                return static_cast<int>(__popcnt64(static_cast<unsigned long long>(v)));
-            #endif
-            #else
-                int c = 0;
-                while (v) { c += static_cast<int>(v & 1ull); v >>= 1; }
-                return c;
-            #endif
+
+        [[nodiscard]] static bool find(const std::string& base_str, const char* keyword) noexcept {
+            return (base_str.find(keyword) != std::string::npos);
+        };
+
+        // a needle for pattern_matcher and the brand it stands for, NULL_BRAND if it only means "some VM"
+        struct pattern {
+            const char* text;
+            enum brand_enum brand;
+        };
+
+        // Finds which of a fixed set of needles occur in a buffer with a single pass over it, rather than 
+        // one pass per needle. Candidate positions come from the first two bytes of every needle, Teddy 
+        // style: each needle goes into one of 8 buckets, and a position is a candidate if the nibbles of 
+        // its byte and of the next one both select the same bucket. With SSSE3 or AVX2 that check runs 
+        // on 16 or 32 positions at once through pshufb, and only the few candidates are verified against 
+        // the exact first/second byte tables. The tables are built by the constructor, so matchers are 
+        // meant to be function-local statics that get built once
+        struct pattern_matcher {
+            static constexpr size_t MAX_NEEDLES = 64;
+
+            const pattern* needles;
+            size_t count;
+            bool ignore_case;
+            std::array<u8, MAX_NEEDLES> lengths;
+            std::array<u64, 256> first;
+            std::array<u64, 256> second;
+            u64 single_byte = 0;
+            alignas(16) u8 masks[4][16]; // low and high nibble of the first byte, then of the second byte
+
+            // lowest index found so far, and which needles could still beat it
+            struct search_state {
+                u64 wanted;
+                size_t best;
             };
-        #if (WINDOWS)
-            DWORD len = 0;
-            if (GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &len) ||
-                GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
-                return false;
-            }
-            std::vector<char> buf(static_cast<size_t>(len));
-            if (!GetLogicalProcessorInformationEx(RelationProcessorCore,
-                reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buf.data()), &len)) {
-                return false;
-            }
-            // first RelationProcessorCore record encountered, basically if two logical processors maps to the same core, SMT is enabled to the OS point of view
-            size_t offset = 0;
-            while (offset + sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX) <= static_cast<size_t>(len)) {
-                auto rec = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buf.data() + offset);
-                if (rec->Relationship == RelationProcessorCore) {
-                    const PROCESSOR_RELATIONSHIP& pr = rec->Processor;
-                    unsigned total = 0;
-                    for (WORD i = 0; i < pr.GroupCount; ++i) {
-                        total += popcount(static_cast<uint64_t>(pr.GroupMask[i].Mask));
+
+            pattern_matcher(const pattern* list, const size_t size, const bool case_insensitive = false)
+                : needles(list), count(size), ignore_case(case_insensitive), lengths(), first(), second() {
+                std::memset(masks, 0, sizeof(masks));
+
+                for (size_t i = 0; i < count && i < MAX_NEEDLES; i++) {
+                    const u8* text = reinterpret_cast<const u8*>(needles[i].text);
+                    const u64 bit = (1ULL << i);
+                    const u8 bucket = static_cast<u8>(1u << (i % 8));
+
+                    lengths[i] = static_cast<u8>(std::strlen(needles[i].text));
+
+                    for (const u8 c : variants(text[0])) {
+                        first[c] |= bit;
+                        masks[0][c & 0x0F] |= bucket;
+                        masks[1][c >> 4] |= bucket;
                     }
-                    return total > 1;
-                }
-                if (rec->Size == 0) break;
-                offset += rec->Size;
-            }
-            return false;
-        #elif (APPLE)
-            int logical = 0, physical = 0;
-            size_t sz = sizeof(logical);
-            if (sysctlbyname("hw.logicalcpu", &logical, &sz, nullptr, 0) != 0) logical = 0;
-            sz = sizeof(physical);
-            if (sysctlbyname("hw.physicalcpu", &physical, &sz, nullptr, 0) != 0) physical = 0;
-            if (logical > 0 && physical > 0) return logical > physical;
-            return false;
-        #else
-            //  check cpu0 thread_siblings_list
-            {
-                std::ifstream f("/sys/devices/system/cpu/cpu0/topology/thread_siblings_list");
-                if (f) {
-                    std::string s;
-                    if (std::getline(f, s)) {
-                        // trim
-                        size_t a = 0; while (a < s.size() && std::isspace(static_cast<unsigned char>(s[a]))) ++a;
-                        size_t b = s.size(); while (b > a && std::isspace(static_cast<unsigned char>(s[b - 1]))) --b;
-                        if (b > a) {
-                            for (size_t k = a; k < b; ++k) {
-                                if (s[k] == ',' || s[k] == '-') return true;
-                            }
-                            return false;
+
+                    // the second byte can be anything for single byte needles
+                    if (lengths[i] == 1) {
+                        single_byte |= bit;
+
+                        for (size_t c = 0; c < 256; c++) {
+                            second[c] |= bit;
                         }
+
+                        for (size_t n = 0; n < 16; n++) {
+                            masks[2][n] |= bucket;
+                            masks[3][n] |= bucket;
+                        }
+
+                        continue;
+                    }
+
+                    for (const u8 c : variants(text[1])) {
+                        second[c] |= bit;
+                        masks[2][c & 0x0F] |= bucket;
+                        masks[3][c >> 4] |= bucket;
                     }
                 }
             }
-            // /proc/cpuinfo for unique (physical id, core id) pairs vs processors
-            std::ifstream cpuinfo("/proc/cpuinfo");
-            if (!cpuinfo) return false;
-            std::string line;
-            int processors = 0;
-            bool in_section = false;
-            int cur_phys = -1, cur_core = -1;
-            std::vector<std::pair<int, int>> cores;
-            while (std::getline(cpuinfo, line)) {
-                if (line.empty()) {
-                    if (cur_phys != -1 && cur_core != -1) cores.emplace_back(cur_phys, cur_core);
-                    cur_phys = cur_core = -1;
-                    in_section = false;
-                    continue;
+
+            // the needle with the lowest index that occurs anywhere in the buffer, so the order of 
+            // the list is the priority. Needles in the skip mask are ignored
+            const pattern* find(const char* data, const size_t size, const u64 skip = 0) const {
+                const u8* bytes = reinterpret_cast<const u8*>(data);
+                const u64 all = (count >= MAX_NEEDLES) ? ~0ULL : ((1ULL << count) - 1);
+                search_state state = { all & ~skip, MAX_NEEDLES };
+                size_t position = 0;
+
+            #if (x86)
+                switch (simd_level()) {
+                    case 2: position = scan_avx2(bytes, size, state); break;
+                    case 1: position = scan_ssse3(bytes, size, state); break;
+                    default: break;
                 }
-                auto pos = line.find(':');
-                if (pos == std::string::npos) continue;
-                std::string key = line.substr(0, pos);
-                std::string val = line.substr(pos + 1);
-                // trim
-                while (!key.empty() && std::isspace(static_cast<unsigned char>(key.back()))) key.pop_back();
-                while (!val.empty() && std::isspace(static_cast<unsigned char>(val.front()))) val.erase(val.begin());
-                if (key == "processor") ++processors;
-                else if (key == "physical id") { try { cur_phys = std::stoi(val); } catch (...) { cur_phys = -1; } }
-                else if (key == "core id") { try { cur_core = std::stoi(val); } catch (...) { cur_core = -1; } }
+            #endif
+
+                for (; position < size && state.wanted != 0; position++) {
+                    verify(bytes, size, position, state);
+                }
+
+                return (state.best < MAX_NEEDLES) ? &needles[state.best] : nullptr;
             }
-            if (cur_phys != -1 && cur_core != -1) cores.emplace_back(cur_phys, cur_core);
-            if (!cores.empty() && processors > 0) {
-                std::sort(cores.begin(), cores.end());
-                cores.erase(std::unique(cores.begin(), cores.end()), cores.end());
-                int physical_cores = static_cast<int>(cores.size());
-                return processors > physical_cores;
+
+            const pattern* find(const std::string& data, const u64 skip = 0) const {
+                return find(data.data(), data.size(), skip);
             }
-            return false;
-        #endif
-        };
 
-        const auto& info = cpu::analyze_cpu();
-
-        if (info.found) {
-            debug(info.debug_tag, ": CPU model = ", info.model_name);
+            // the needles of a brand, as a skip mask for find()
+            u64 mask(const enum brand_enum brand) const noexcept {
+                u64 result = 0;
 
-            const u32 actual = memo::threadcount::fetch();
-            if (actual != info.expected_threads) {
-                debug(info.debug_tag, ": Current threads -> ", actual);
-                const bool smt = is_smt_enabled();
-                if (smt) {
-                    debug(info.debug_tag, ": Expected  ", info.expected_threads, " threads");
-                    return true;
+                for (size_t i = 0; i < count && i < MAX_NEEDLES; i++) {
+                    if (needles[i].brand == brand) {
+                        result |= (1ULL << i);
+                    }
                 }
-                else {
-                    debug(info.debug_tag, ": Expected ", info.expected_threads, " threads, but found SMT disabled");
-                    return false;
-                }         
-            }
-        }
-        return false;
-    #endif
-    }
 
+                return result;
+            }
 
-    /**
-     * @brief Check for CPUID signatures that reveal the presence of a hypervisor
-     * @category x86
-     * @implements VM::CPUID_SIGNATURE
-     */
-    [[nodiscard]] static bool cpuid_signature() {
-    #if (!x86)
-        return false;
-    #else
-        u32 eax = 0, ebx = 0, ecx = 0, edx = 0;
-        cpu::cpuid(eax, ebx, ecx, edx, 0x40000001);
+            static bool is_letter(const u8 c) noexcept {
+                return ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+            }
 
-        constexpr u32 simplevisor = 0x00766853; // " vhS"
+            // both cases of a letter when matching case insensitively
+            std::array<u8, 2> variants(const u8 c) const noexcept {
+                return {{ c, static_cast<u8>((ignore_case && is_letter(c)) ? (c ^ 0x20) : c) }};
+            }
 
-        debug("CPUID_SIGNATURE: eax = ", eax);
+            // only letters are folded, so '@' doesn't match '`' and '[' doesn't match '{'
+            bool same(const u8 a, const u8 b) const noexcept {
+                return (a == b) || (ignore_case && (a ^ b) == 0x20 && is_letter(a));
+            }
 
-        if (eax == simplevisor) {
-            return core::add(brand_enum::SIMPLEVISOR);
-        }
+            static size_t lowest_bit(const u64 value) noexcept {
+            #if (GCC || CLANG)
+                return static_cast<size_t>(__builtin_ctzll(value));
+            #else
+                size_t index = 0;
+                while (!((value >> index) & 1ULL)) index++;
+                return index;
+            #endif
+            }
 
-        if (cpu::is_intel()) {
-            const bool has_leaf_b = cpu::is_leaf_supported(0x0B);
-            const bool has_leaf_1f = cpu::is_leaf_supported(0x1F);
+            void verify(const u8* bytes, const size_t size, const size_t position, search_state& state) const {
+                u64 candidates = first[bytes[position]] & state.wanted;
 
-            // If neither extended topology leaf is supported, we can't perform the check
-            if (!has_leaf_b && !has_leaf_1f) {
-                return false;
-            }
+                if (candidates == 0) {
+                    return;
+                }
 
-            u32 l1_eax = 0, l1_ebx = 0, l1_ecx = 0, l1_edx = 0;
-            u32 vb_eax = 0, vb_ebx = 0, vb_ecx = 0, vb_edx = 0;
-            u32 v1f_eax = 0, v1f_ebx = 0, v1f_ecx = 0, v1f_edx = 0;
+                candidates &= (position + 1 < size) ? second[bytes[position + 1]] : single_byte;
 
-            u32 aba_start = 0, aba_end = 0;
-            u32 unused = 0;
-            int retries = 0;
+                while (candidates != 0) {
+                    const size_t index = lowest_bit(candidates);
+                    candidates &= (candidates - 1);
 
-            // triple-read ABA pattern to detect thread migration and bounded to 8 retries
-            // leaf 1's Initial APIC ID is the ABA guard
-            do {
-                cpu::cpuid(l1_eax, l1_ebx, l1_ecx, l1_edx, 1, 0);
-                aba_start = (l1_ebx >> 24) & 0xFF; // Initial APIC ID
+                    const size_t length = lengths[index];
+                    if (position + length > size) {
+                        continue;
+                    }
 
-                if (has_leaf_b)  cpu::cpuid(vb_eax, vb_ebx, vb_ecx, vb_edx, 0x0B, 0);
-                if (has_leaf_1f) cpu::cpuid(v1f_eax, v1f_ebx, v1f_ecx, v1f_edx, 0x1F, 0);
+                    const u8* text = reinterpret_cast<const u8*>(needles[index].text);
+                    size_t i = 0;
 
-                cpu::cpuid(unused, l1_ebx, unused, unused, 1, 0);
-                aba_end = (l1_ebx >> 24) & 0xFF;
-            } while (aba_start != aba_end && ++retries < 8);
+                    while (i < length && same(bytes[position + i], text[i])) i++;
 
-            // If we hit the retry limit and the thread is still migrating, 
-            // abort the check to prevent false positives
-            if (aba_start != aba_end) {
-                return false;
+                    // the bits are visited in ascending order, so this is the best this position can do
+                    if (i == length) {
+                        state.best = index;
+                        state.wanted &= ((1ULL << index) - 1);
+                        return;
+                    }
+                }
             }
 
-            const u32 initial_apic_id = aba_start;
+        #if (x86)
+            // 0 = scalar, 1 = SSSE3, 2 = AVX2 (which also needs the OS to save the YMM registers)
+            static u8 simd_level() {
+                static const u8 level = []() -> u8 {
+                    u32 eax = 0, ebx = 0, ecx = 0, edx = 0;
+                    cpu::cpuid(eax, ebx, ecx, edx, 1);
+
+                    const bool ssse3 = (ecx & (1u << 9));
+                    const bool osxsave = (ecx & (1u << 27));
+                    const bool avx = (ecx & (1u << 28));
+
+                    bool avx2 = false;
+
+                    if (osxsave && avx && cpu::is_leaf_supported(7)) {
+                        u32 xcr0 = 0;
+                    #if (MSVC && !CLANG)
+                        xcr0 = static_cast<u32>(_xgetbv(0));
+                    #else
+                        u32 xcr0_high = 0;
+                        __asm__ __volatile__("xgetbv" : "=a"(xcr0), "=d"(xcr0_high) : "c"(0));
+                        VMAWARE_UNUSED(xcr0_high);
+                    #endif
+                        cpu::cpuid(eax, ebx, ecx, edx, 7, 0);
+                        avx2 = ((xcr0 & 0x6) == 0x6) && (ebx & (1u << 5));
+                    }
 
-            // check Leaf 0x0B against Leaf 1
-            if (has_leaf_b) {
-                const u32 vb_level = (vb_ecx >> 8) & 0xFF;
+                    return static_cast<u8>(avx2 ? 2 : (ssse3 ? 1 : 0));
+                }();
 
-                if (vb_level != 0) {
-                    // if x2APIC ID is < 255, Initial APIC ID must match exactly
-                    if (vb_edx < 255 && (vb_edx & 0xFF) != initial_apic_id) {
-                        return true;
-                    }
-                }
+                return level;
             }
 
-            // check Leaf 0x1F against Leaf 1, and cross-check with 0x0B
-            if (has_leaf_1f) {
-                const u32 v1f_level = (v1f_ecx >> 8) & 0xFF;
+            // both return the first position they didn't cover, the rest is done by the scalar loop
+            #if (GCC || CLANG)
+                __attribute__((__target__("ssse3")))
+            #endif
+            size_t scan_ssse3(const u8* bytes, const size_t size, search_state& state) const {
+                const __m128i low_first = _mm_load_si128(reinterpret_cast<const __m128i*>(masks[0]));
+                const __m128i high_first = _mm_load_si128(reinterpret_cast<const __m128i*>(masks[1]));
+                const __m128i low_second = _mm_load_si128(reinterpret_cast<const __m128i*>(masks[2]));
+                const __m128i high_second = _mm_load_si128(reinterpret_cast<const __m128i*>(masks[3]));
+                const __m128i nibble = _mm_set1_epi8(0x0F);
+                const __m128i zero = _mm_setzero_si128();
+
+                size_t position = 0;
+
+                for (; position + 17 <= size && state.wanted != 0; position += 16) {
+                    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + position));
+                    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + position + 1));
+
+                    const __m128i first_hit = _mm_and_si128(
+                        _mm_shuffle_epi8(low_first, _mm_and_si128(a, nibble)),
+                        _mm_shuffle_epi8(high_first, _mm_and_si128(_mm_srli_epi16(a, 4), nibble))
+                    );
+                    const __m128i second_hit = _mm_and_si128(
+                        _mm_shuffle_epi8(low_second, _mm_and_si128(b, nibble)),
+                        _mm_shuffle_epi8(high_second, _mm_and_si128(_mm_srli_epi16(b, 4), nibble))
+                    );
 
-                if (v1f_level != 0) {
-                    // if x2APIC ID is < 255, Initial APIC ID must match exactly
-                    if (v1f_edx < 255 && (v1f_edx & 0xFF) != initial_apic_id) {
-                        return true;
-                    }
+                    u32 hits = ~static_cast<u32>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(first_hit, second_hit), zero))) & 0xFFFFu;
 
-                    // cross-check 0x0B vs 0x1F if both are supported and valid
-                    if (has_leaf_b) {
-                        const u32 vb_level = (vb_ecx >> 8) & 0xFF;
-                        if (vb_level != 0 && vb_edx != v1f_edx) {
-                            return true;
-                        }
+                    while (hits != 0 && state.wanted != 0) {
+                        verify(bytes, size, position + lowest_bit(hits), state);
+                        hits &= (hits - 1);
                     }
                 }
-            }
-        }
-        else if (cpu::is_amd()) {
-            const bool has_leaf_7 = cpu::is_leaf_supported(7);
 
-            if (!has_leaf_7) {
-                return false;
+                return position;
             }
 
-            u32 l7_eax = 0, l7_ebx = 0, l7_ecx = 0, l7_edx = 0;
-            cpu::cpuid(l7_eax, l7_ebx, l7_ecx, l7_edx, 7, 0);
+            #if (GCC || CLANG)
+                __attribute__((__target__("avx2")))
+            #endif
+            size_t scan_avx2(const u8* bytes, const size_t size, search_state& state) const {
+                const __m256i low_first = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(masks[0])));
+                const __m256i high_first = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(masks[1])));
+                const __m256i low_second = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(masks[2])));
+                const __m256i high_second = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(masks[3])));
+                const __m256i nibble = _mm256_set1_epi8(0x0F);
+                const __m256i zero = _mm256_setzero_si256();
+
+                size_t position = 0;
+
+                for (; position + 33 <= size && state.wanted != 0; position += 32) {
+                    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + position));
+                    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + position + 1));
+
+                    const __m256i first_hit = _mm256_and_si256(
+                        _mm256_shuffle_epi8(low_first, _mm256_and_si256(a, nibble)),
+                        _mm256_shuffle_epi8(high_first, _mm256_and_si256(_mm256_srli_epi16(a, 4), nibble))
+                    );
+                    const __m256i second_hit = _mm256_and_si256(
+                        _mm256_shuffle_epi8(low_second, _mm256_and_si256(b, nibble)),
+                        _mm256_shuffle_epi8(high_second, _mm256_and_si256(_mm256_srli_epi16(b, 4), nibble))
+                    );
 
-            // Intel enumerates hardware mitigations in Leaf 7.0.EDX:
-            // Bit 26: IBRS and IBPB
-            // Bit 27: STIBP
-            // Bit 31: SSBD
+                    u64 hits = ~static_cast<u32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(first_hit, second_hit), zero)));
+                    hits &= 0xFFFFFFFFULL;
 
-            // AMD processors strictly reserve these bits (force them to 0) 
-            // and instead enumerate their mitigations in Leaf 0x80000008.EBX
-            const bool has_intel_ibrs = (l7_edx & (1 << 26)) != 0;
-            const bool has_intel_stibp = (l7_edx & (1 << 27)) != 0;
-            const bool has_intel_ssbd = (l7_edx & (1 << 31)) != 0;
+                    while (hits != 0 && state.wanted != 0) {
+                        verify(bytes, size, position + lowest_bit(hits), state);
+                        hits &= (hits - 1);
+                    }
+                }
 
-            if (has_intel_ibrs || has_intel_stibp || has_intel_ssbd) {
-                return true;
+                return position;
             }
-        }
+        #endif
+        };
 
-        return false;
-    #endif
-    }
-                
-                
-    /**
-     * @brief Check for Intel KGT (Trusty branch) hypervisor signature in CPUID
-     * @link https://github.com/intel/ikgt-core/blob/7dfd4d1614d788ec43b02602cce7a272ef8d5931/vmm/vmexit/vmexit_cpuid.c
-     * @category x86
-     * @implements VM::KGT_SIGNATURE
-     */
-    [[nodiscard]] static bool intel_kgt_signature() {
-    #if (!x86)
-        return false;
-    #else
-        u32 unused, ecx, edx = 0;
-        cpu::cpuid(unused, unused, ecx, edx, 0x40000003);
+        static std::string narrow_wide(const wchar_t* wstr) {
+            if (!wstr) return std::string{};
+            std::wstring ws(wstr);
+            std::string result;
+            result.reserve(ws.size());
+            for (wchar_t wc : ws) {
+                result.push_back((wc >= 0 && wc < 128)
+                    ? static_cast<char>(wc)
+                    : '?');
+            }
+            return result;
+        }
 
-        constexpr u32 ECX_SIG = 0x4D4D5645u; // 'EVMM' -> 0x4D4D5645
-        constexpr u32 EDX_SIG = 0x43544E49u; // 'INTC' -> 0x43544E49
+        // choose correct << or narrow for each type
+        static void write_arg_impl(std::ostream& os, const wchar_t* arg) {
+            os << narrow_wide(arg);
+        }
+        static void write_arg_impl(std::ostream& os, wchar_t* arg) {
+            os << narrow_wide(arg);
+        }
 
-        if (ecx == ECX_SIG && edx == EDX_SIG) {
-            return core::add(brand_enum::INTEL_KGT);
+        static void write_arg_impl(std::ostream& os, const std::wstring& ws) {
+            os << narrow_wide(ws.c_str());
         }
 
-        return false;
-    #endif
-    }
+        // everything else that is not std::string or wchar_t
+        template <typename T>
+        static typename std::enable_if<!std::is_convertible<T, std::wstring>::value
+            && !std::is_same<typename std::decay<T>::type, wchar_t*>::value,
+            void>::type
+            write_arg_impl(std::ostream& os, T&& arg) {
+            os << std::forward<T>(arg);
+        }
 
+        // variadic pack printer for C++11
+        static inline void print_to_stream(std::ostream& /*unused*/) noexcept {}
 
-    /**
-     * @brief Check for timing anomalies in the system
-     * @category x86, Windows
-     * @implements VM::TIMER
-     */
-    [[nodiscard]] static bool timer() {
-    #if (x86 && WINDOWS)
-        // Detect a hypervisor without giving it time to react (when the hypervisor sees the vmexit, it's already too late for it, as the counter already exceeded the threshold)
-        // Uses our own software-based clock, meaning a hypervisor can't hide time by offsetting TSC or controlling any hardware timer
-        double threshold = 4.0;
-        if (util::is_running_under_translator()) {
-            debug("TIMER: Running inside a binary translation layer");
-            return false;
-        }
-        if (util::hyper_x() != HYPERV_UNKNOWN) {
-            threshold = 15.0;
+        // forward the first, then expand the rest in an initializer list
+        template <typename T, typename... Args>
+        static void print_to_stream(std::ostream& os,
+            T&& first,
+            Args&&... args) noexcept
+        {
+            write_arg_impl(os, std::forward<T>(first));
+            // trick to expand the pack
+            using expander = int[];
+            (void)expander {
+                0, ((void)write_arg_impl(os, std::forward<Args>(args)), 0)...
+            };
         }
 
-        // prevent false sharing when triggering hypervisor exits with the intentional data race condition
-        struct alignas(64) cache_state {
-            alignas(64) volatile u64 counter { 0 };
-            alignas(64) std::atomic<bool> start_test{ false };
-            alignas(64) std::atomic<bool> test_done{ false };
+        // shared by every instantiation of debug_msg(), since the parallel and background workers 
+        // print at the same time. Leaked on purpose so they can still print while the program exits
+        struct debug_state {
+            std::mutex mutex;
+            std::unordered_set<std::string> printed_messages;
         };
 
-        // Shared state and results
-        cache_state state;
-        bool hypervisor_detected = false;
-        bool bypass_detected = false;
-
-        // we dont use cpu::cpuid on purpose
-        auto trigger_vmexit = [](i32* info, i32 leaf, i32 sub) {
-        #if (GCC || CLANG)
-            __asm__ volatile (
-                "cpuid"
-                : "=a"(info[0]), "=b"(info[1]), "=c"(info[2]), "=d"(info[3])
-                : "a"(leaf), "c"(sub)
-                : "cc", "memory"
-                );
-        #else
-            __cpuidex(info, leaf, sub);
-        #endif
-        };
+        static debug_state& debug_shared() {
+            static debug_state& state = *new debug_state();
+            return state;
+        }
 
-        auto counter_thread = [&state]() {
-            const HANDLE current_thread = reinterpret_cast<HANDLE>(-2LL);
-            const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
+        template <typename... Args>
+        static inline void debug_msg(Args&&... message) noexcept {
+            std::stringstream ss;
+            print_to_stream(ss, std::forward<Args>(message)...);
+            std::string msg_content = ss.str();
 
-            // search for the physical sibling of CPU 0, then pick a random CPU excluding it to avoid SMT locks
-            DWORD_PTR procMask = 0, sysMask = 0;
-            GetProcessAffinityMask(current_process, &procMask, &sysMask);
+            debug_state& shared = debug_shared();
+            std::lock_guard<std::mutex> guard(shared.mutex);
 
-            DWORD len = 0;
-            GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &len);
+            if (shared.printed_messages.find(msg_content) == shared.printed_messages.end()) {
+        #if (LINUX || APPLE)
+                constexpr const char* black_bg = "\x1B[48;2;0;0;0m";
+                constexpr const char* bold = "\033[1m";
+                constexpr const char* blue = "\x1B[38;2;00;59;193m";
+                constexpr const char* ansiexit = "\x1B[0m";
 
-            BYTE stackBuf[1024]{};
-            BYTE* buf = stackBuf;
+                std::cout.setf(std::ios::fixed, std::ios::floatfield);
+                std::cout.setf(std::ios::showpoint);
 
-            std::vector<BYTE> heapBuf;
-            if (len > sizeof(stackBuf)) {
-                heapBuf.resize(len);
-                buf = heapBuf.data();
+                std::cout << black_bg
+                    << bold << "["
+                    << blue << "DEBUG"
+                    << ansiexit << bold << black_bg << "]"
+                    << ansiexit << " ";
+        #else
+                std::cout << "[DEBUG] ";
+        #endif
+                std::cout << msg_content;
+                std::cout << std::dec << "\n";
+
+                shared.printed_messages.insert(std::move(msg_content));
             }
+        }
 
-            GetLogicalProcessorInformationEx(RelationProcessorCore,
-                reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buf), &len);
 
-            DWORD_PTR cpu0CoreMask = 0;
-            for (BYTE* p = buf; p < buf + len; ) {
-                const auto* r = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(p);
-                if (r->Relationship == RelationProcessorCore) {
-                    for (WORD i = 0; i < r->Processor.GroupCount; ++i) {
-                        const auto& m = r->Processor.GroupMask[i];
-                        if (m.Group == 0 && (m.Mask & 1)) cpu0CoreMask |= m.Mask;
+        [[nodiscard]] static std::unique_ptr<std::string> sys_result(const char* cmd) {
+        #if (VMA_CPP < 14)
+            VMAWARE_UNUSED(cmd);
+            return util::make_unique<std::string>();
+        #else
+            #if (LINUX || APPLE)
+                struct file_deleter {
+                    void operator()(FILE* f) const noexcept {
+                        if (f) {
+                            pclose(f);
+                        };
                     }
+                };
+
+                std::unique_ptr<FILE, file_deleter> pipe(popen(cmd, "r"), file_deleter());
+                if (!pipe) {
+                    return util::make_unique<std::string>();
                 }
-                p += r->Size;
-            }
 
-            const DWORD_PTR choices = procMask & ~cpu0CoreMask;
+                std::string result;
+                char* line = nullptr;
 
-            DWORD idxs[64]{}, n = 0;
-            for (DWORD i = 0; i < 64; ++i)
-                if (choices & (1ull << i)) idxs[n++] = i;
+                // to ensure line is freed even if string::append throws std::bad_alloc
+                struct line_guard {
+                    char*& ptr;
+                    ~line_guard() { if (ptr) free(ptr); }
+                } guard{ line };
 
-            if (n) {
-                // random so that the hypervisor doesn't know where the counter thread is
-                // this will affect latency if cache lines from trigger_thread and counter_thread are separated
-                // however, we do a ratio based detection, so this wont affect the detection accuracy because the cache latency affects both samples
-                std::mt19937 gen(std::random_device{}());
-                const u32 cpu = idxs[std::uniform_int_distribution<u32>(0, n - 1)(gen)];
-                SetThreadAffinityMask(current_thread, 1ull << cpu);
-            }
-            SetThreadPriority(current_thread, THREAD_PRIORITY_HIGHEST); // decrease chance of being rescheduled
+                size_t len = 0;
+                ssize_t nread;
 
-            while (!state.start_test.load(std::memory_order_acquire)) {}
+                while ((nread = getline(&line, &len, pipe.get())) != -1) {
+                    result.append(line, static_cast<size_t>(nread));
+                }
 
-            while (!state.test_done.load(std::memory_order_relaxed)) {
-            #if (GCC || CLANG)
-                #if (x86_64)
-                // A single incq is enough. Unrolling for example 8 times on a volatile memory address 
-                // creates unpredictable store-buffer behavior and we want it stable, latency is aprox 1 cycle in all microarchs
-                    __asm__ volatile ("incq %0\n\t" : "+m" (state.counter) : : "cc", "memory");
-                #else
-                    __asm__ volatile (
-                        "addl $1, %0; adcl $0, %1\n\t"
-                        : "+m" (((u32*)&state.counter)[0]), "+m" (((u32*)&state.counter)[1])
-                        : : "cc", "memory");
-                #endif
+                if (!result.empty() && result.back() == '\n') {
+                    result.pop_back();
+                }
+
+                return util::make_unique<std::string>(std::move(result));
             #else
-                state.counter++;
+                VMAWARE_UNUSED(cmd);
+                return std::make_unique<std::string>();
             #endif
-            }
-        };
-
-        auto trigger_thread = [&]() {
-            auto calculate_latency = [&](const std::vector<u64>& samples_in) -> u64 {
-                if (samples_in.empty()) return 0;
-                const size_t N = samples_in.size();
-                if (N == 1) return samples_in[0];
+        #endif
+        }
 
-                // local sorted copy
-                std::vector<u64> s = samples_in;
-                std::sort(s.begin(), s.end()); // ascending
 
-                // tiny-sample short-circuits
-                if (N <= 4) return s.front();
+        [[nodiscard]] static bool is_running_under_translator() {
+        #if (WINDOWS && _WIN32_WINNT >= _WIN32_WINNT_WIN10)
+            const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
+            USHORT procMachine = 0, nativeMachine = 0;
+            const auto pIsWow64Process2 = &IsWow64Process2;
 
-                // median (and works for sorted input)
-                auto median_of_sorted = [](const std::vector<u64>& v, size_t lo, size_t hi) -> u64 {
-                    // this is the median of v[lo..hi-1], requires 0 <= lo < hi
-                    const size_t len = hi - lo;
-                    if (len == 0) return 0;
-                    const size_t mid = lo + (len / 2);
-                    if (len & 1) return v[mid];
-                    return (v[mid - 1] + v[mid]) / 2;
-                };
+            if (pIsWow64Process2(current_process, &procMachine, &nativeMachine)) {
+                if (nativeMachine == IMAGE_FILE_MACHINE_ARM64 &&
+                    (procMachine == IMAGE_FILE_MACHINE_AMD64 || procMachine == IMAGE_FILE_MACHINE_I386)) {
+                    debug("Translator detected x64/x86 process on ARM64");
+                    return true;
+                }
+            }
 
-                // the robust center: median M and MAD -> approximate sigma
-                const u64 M = median_of_sorted(s, 0, s.size());
-                std::vector<u64> absdev;
-                absdev.reserve(N);
-                for (size_t i = 0; i < N; ++i) {
-                    const u64 d = (s[i] > M) ? (s[i] - M) : (M - s[i]);
-                    absdev.push_back(d);
+            // only if we got MACHINE_UNKNOWN on process but native is ARM64
+            if (nativeMachine == IMAGE_FILE_MACHINE_ARM64) {
+                using get_process_information = BOOL(__stdcall*)(HANDLE, PROCESS_INFORMATION_CLASS, PVOID, DWORD);
+                const HMODULE ntdll = util::get_ntdll();
+                if (ntdll == nullptr) {
+                    return false;
                 }
-                std::sort(absdev.begin(), absdev.end());
-                const u64 MAD = median_of_sorted(absdev, 0, absdev.size());
-                // convert MAD to an approximate standard-deviation-like measure
-                constexpr long double kmad_to_sigma = 1.4826L; // consistent for normal approx
-                const long double sigma = (MAD == 0) ? 1.0L : (static_cast<long double>(MAD) * kmad_to_sigma);
 
-                // find the densest small-valued cluster by sliding a fixed-count window
-                // this locates the most concentrated group of samples (likely it would be the true VMEXIT cluster)
-                // const size_t frac_win = (N * 8 + 99) / 100; // ceil(N * 0.08)
-                // const size_t win = std::min(N, std::max(MIN_WIN, frac_win));
-                const size_t MIN_WIN = 10;
-                // manual min/max calculation for win size
-                const size_t calc_frac = static_cast<size_t>(std::ceil(static_cast<double>(N) * 0.08));
-                const size_t inner_max = (MIN_WIN > calc_frac) ? MIN_WIN : calc_frac;
-                const size_t win = (N < inner_max) ? N : inner_max;
+                const char* names[] = { "GetProcessInformation" };
+                void* funcs[ARRAYSIZE(names)] = {};
+                util::get_function_address(ntdll, names, funcs, 1);
 
-                size_t best_i = 0;
-                u64 best_span = (s.back() - s.front()) + 1; // large initial
-                for (size_t i = 0; i + win <= N; ++i) {
-                    const u64 span = s[i + win - 1] - s[i];
-                    if (span < best_span) {
-                        best_span = span;
-                        best_i = i;
+                get_process_information get_proc_info = reinterpret_cast<get_process_information>(funcs[0]);
+                if (get_proc_info) {
+                    struct PROCESS_MACHINE_INFORMATION {
+                        USHORT ProcessMachine;
+                        USHORT Res0;
+                        DWORD  MachineAttributes;
+                    } pmInfo = {};
+                    // ProcessMachineTypeInfo == 9 per MS Q&A
+                    if (get_proc_info(current_process, (PROCESS_INFORMATION_CLASS)9, &pmInfo, sizeof(pmInfo))) {
+                        if (pmInfo.ProcessMachine == IMAGE_FILE_MACHINE_AMD64 || pmInfo.ProcessMachine == IMAGE_FILE_MACHINE_I386) {
+                            debug("Translator detected x64/x86 process on ARM64 by fallback");
+                            return true;
+                        }
                     }
                 }
+            }
+        #endif
 
-                // expand the initial window greedily while staying "tight"
-                // allow expansion while adding samples does not more than multiply the span by EXPAND_FACTOR
-                constexpr long double EXPAND_FACTOR = 1.5L;
-                size_t cluster_lo = best_i;
-                size_t cluster_hi = best_i + win; // exclusive
-                // expand left
-                while (cluster_lo > 0) {
-                    const u64 new_span = s[cluster_hi - 1] - s[cluster_lo - 1];
-                    if (static_cast<long double>(new_span) <= EXPAND_FACTOR * static_cast<long double>(best_span) ||
-                        (s[cluster_hi - 1] <= (s[cluster_lo - 1] + static_cast<u64>(std::ceil(3.0L * sigma))))) {
-                        --cluster_lo;
-                        // manual min calculation
-                        best_span = (best_span < new_span) ? best_span : new_span;
-                    }
-                    else break;
-                }
-                // expand right
-                while (cluster_hi < N) {
-                    const u64 new_span = s[cluster_hi] - s[cluster_lo];
-                    if (static_cast<long double>(new_span) <= EXPAND_FACTOR * static_cast<long double>(best_span) ||
-                        (s[cluster_hi] <= (s[cluster_lo] + static_cast<u64>(std::ceil(3.0L * sigma))))) {
-                        ++cluster_hi;
-                        best_span = (best_span < new_span) ? best_span : new_span;
-                    }
-                    else break;
+            if (cpu::is_leaf_supported(cpu::leaf::hypervisor)) {
+                const std::string vendor = cpu::cpu_manufacturer(cpu::leaf::hypervisor);
+                
+                if (vendor == "VirtualApple" ||   // Apple Rosetta
+                    vendor == "PowerVM Lx86")     // IBM PowerVM Lx86
+                {
+                    return true;
                 }
+            }
 
-                const size_t cluster_size = (cluster_hi > cluster_lo) ? (cluster_hi - cluster_lo) : 0;
-
-                // cluster must be reasonably dense and cover a non-negligible portion of samples, so this is pure sanity checks
-                const double fraction_in_cluster = static_cast<double>(cluster_size) / static_cast<double>(N);
-
-                // min/max calculation for MIN_CLUSTER
-                const int val_n_50 = static_cast<int>(N / 50);
-                const size_t val_max = static_cast<size_t>((5 > val_n_50) ? 5 : val_n_50);
-                const size_t MIN_CLUSTER = (val_max < N) ? val_max : N; // at least 2% or 5 elements
-
-                if (cluster_size < MIN_CLUSTER || fraction_in_cluster < 0.02) {
-                    // low-percentile (10th) trimmed median
-                    // Manual max calculation for fallback_count
-                    const size_t floor_val = static_cast<size_t>(std::floor(static_cast<double>(N) * 0.10));
-                    const size_t fallback_count = (1 > floor_val) ? 1 : floor_val;
+        #if (WINDOWS)
+            const std::string& brand = cpu::get_identity().brand;
+            if (brand.find("Virtual CPU") != std::string::npos) {
+                return true;
+            }
+        #endif
 
-                    // median of lowest fallback_count elements (if fallback_count==1 that's smallest)
-                    if (fallback_count == 1) return s.front();
-                    const size_t mid = fallback_count / 2;
-                    if (fallback_count & 1) return s[mid];
-                    return (s[mid - 1] + s[mid]) / 2;
-                }
+            return false;
+        }
 
-                // now we try to get a robust estimate inside the cluster, trimmed mean (10% trim) centered on cluster
-                const size_t trim_count = static_cast<size_t>(std::floor(static_cast<double>(cluster_size) * 0.10));
-                const size_t lo = cluster_lo + trim_count;
-                const size_t hi = cluster_hi - trim_count; // exclusive
-                if (hi <= lo) {
-                    // degenerate -> median of cluster
-                    return median_of_sorted(s, cluster_lo, cluster_hi);
-                }
 
-                // sum with long double to avoid overflow and better rounding
-                long double sum = 0.0L;
-                for (size_t i = lo; i < hi; ++i) sum += static_cast<long double>(s[i]);
-                const long double avg = sum / static_cast<long double>(hi - lo);
-                u64 result = static_cast<u64>(std::llround(avg));
-
-                // final sanity adjustments:
-                // if the computed result is suspiciously far from the global median (e.g., > +6*sigma)
-                // clamp toward the median to avoid choosing a high noisy cluster by mistake
-                const long double diff_from_med = static_cast<long double>(result) - static_cast<long double>(M);
-                if (diff_from_med > 0 && diff_from_med > (6.0L * sigma)) {
-                    // clamp to median + 4*sigma (conservative)
-                    result = static_cast<u64>(std::llround(static_cast<long double>(M) + 4.0L * sigma));
-                }
+        /**
+         * @brief Check whether the system is running in a Hyper-V virtual machine or if the host system has Hyper-V enabled
+         * @note Hyper-V's presence on a host system can set certain hypervisor-related CPU flags that may appear similar to those in a virtualized environment, which can make it challenging to differentiate between an actual Hyper-V virtual machine (VM) and a host system with Hyper-V enabled.
+         *       This can lead to false conclusions, where the system might mistakenly be identified as running in a Hyper-V VM, when in reality, it's simply the host system with Hyper-V features active.
+         *       This check aims to distinguish between these two cases by identifying specific CPU flags and hypervisor-related artifacts that are indicative of a Hyper-V VM rather than a host system with Hyper-V enabled.
+         * @returns hyperx_state enum indicating the detected state:
+         *          - HYPERV_ARTIFACT_VM for host with Hyper-V enabled
+         *          - HYPERV_REAL_VM for real Hyper-V VM
+         *          - HYPERV_ENLIGHTENMENT for QEMU with Hyper-V enlightenments
+         *          - HYPERV_UNKNOWN for unknown/undetected state
+         */
+        [[nodiscard]] static hyperx_state hyper_x() {
+        #if (!WINDOWS)
+            return HYPERV_UNKNOWN;
+        #else
+            if (memo::hyperx::is_cached()) {
+                debug("HYPER_X: returned from cache");
+                return memo::hyperx::fetch();
+            }
 
-                // also, if result is zero (shouldn't be) or extremely small, return a smallest observed sample
-                if (result == 0) result = s.front();
+            // Check if hypervisor feature bit in CPUID Leaf 1, ECX bit 31 is enabled
+            auto is_hyperv_present = []() noexcept -> bool {
+                u32 unused, ecx = 0;
+                cpu::cpuid(unused, unused, ecx, unused, 1);
 
-                return result;
+                return (ecx >> 31) & 1;
             };
 
-            const HANDLE current_thread = reinterpret_cast<HANDLE>(-2LL);
-            const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
-            SetThreadAffinityMask(current_thread, 1);
-            SetPriorityClass(current_process, ABOVE_NORMAL_PRIORITY_CLASS); // ABOVE_NORMAL_PRIORITY_CLASS + THREAD_PRIORITY_HIGHEST = 12 base priority
-            SetThreadPriority(current_thread, THREAD_PRIORITY_HIGHEST);
+            // 0x40000003 on EBX indicates the flags that a parent partition specified to create a child partition (https://learn.microsoft.com/en-us/virtualization/hyper-v-on-windows/tlfs/datatypes/hv_partition_privilege_mask)
+            // some CPU models like N-models (N4200, etc) expose 0x40000003 leaves without exposing the hypervisor bit
+            auto is_root_partition = []() noexcept -> bool {
+                u32 ebx, unused = 0;
+                cpu::cpuid(unused, ebx, unused, unused, 0x40000003);
 
-            // so that hypervisor can't predict how many samples we will collect
-            std::mt19937 gen(std::random_device{}());
-            std::uniform_int_distribution<size_t> batch_dist(30000, 70000);
-            const size_t BATCH_SIZE = batch_dist(gen);
-            i32 dummy_res[4]{};
-            std::vector<u64> vm_samples(BATCH_SIZE), ref_samples(BATCH_SIZE); // pre page-fault MMU, wwe wont warm-up cpuid samples for the P-states intentionally
+                return (ebx & 1);
+            };
 
-            state.start_test.store(true, std::memory_order_release); // _mm_pause can be exited conditionally, spam hit L3.
-            while (state.counter == 0) {}
+            /**
+              * On Hyper-V virtual machines, the cpuid function reports an EAX value of 11
+              * This value is tied to the Hyper-V partition model, where each virtual machine runs as a child partition
+              * These child partitions have limited privileges and access to hypervisor resources, 
+              * which is reflected in the maximum input value for hypervisor CPUID information as 11
+              * Essentially, it indicates that the hypervisor is managing the VM and that the VM is not running directly on hardware but rather in a virtualized environment
+            */
+            auto eax = []() noexcept -> u32 {
+                u32 eax_reg, unused = 0;
+                cpu::cpuid(eax_reg, unused, unused, unused, cpu::leaf::hypervisor);
 
-            size_t valid = 0;
-            while (valid < BATCH_SIZE) {
-                // interpolated so that any turbo boost, thermal throttling, speculation (for the loop overhead itself, not for the serializing instructions), etc affects both samples
-                u64 v_pre, v_post, r_pre, r_post, sync;
+                // truncation is intentional
+                return eax_reg & 0xFF;
+            };
 
-                sync = state.counter; while (state.counter == sync); // infer if counter got enough quantum momentum (so its currently scheduled)
-                sync = state.counter; while (state.counter == sync); // fastest busy-waiting strategy, PAUSE affects cache, calling APIs like SwitchToThread() would be even worse
+            hyperx_state state = HYPERV_UNKNOWN;
 
-                v_pre = state.counter;
-                std::atomic_signal_fence(std::memory_order_seq_cst); // _ReadWriteBarrier() aka dont emit runtime fences
-                // force cpuid collection here so that the hypervisor is either forced to disable interception and try to bypass latency, or intercept cpuid and try to bypass XSAVE states
-                trigger_vmexit(dummy_res, 0, 0);
-                std::atomic_signal_fence(std::memory_order_seq_cst);
-                v_post = state.counter;
+            if (!is_root_partition()) {
+                if (eax() == 11 && is_hyperv_present()) {
+                    // Windows machine running under Hyper-V type 2
+                    debug("HYPER-X: Detected Hyper-V guest VM");
+                    core::add(brand_enum::HYPERV);
+                    state = HYPERV_REAL_VM;
+                }
+                else {
+                    debug("HYPER-X: Hyper-V is not active");
+                    state = HYPERV_UNKNOWN;
+                }
+            }
+            else {
+                const std::string brand_str = cpu::cpu_manufacturer(0x40000100);
+                
+                if (util::find(brand_str, "KVM")) {
+                    debug("HYPER-X: Detected Hyper-V enlightenments");
+                    core::add(brand_enum::QEMU_KVM_HYPERV);
+                    state = HYPERV_ENLIGHTENMENT;
+                }
+                else {
+                    // Windows machine running under Hyper-V type 1
+                    // If we reach here, we do some sanity checks to ensure a hypervisor is not trying to spoof itself as Hyper-V, bypassing some detections
+                #if (x86_64)
+                    u8 idtr_buffer[10] = { 0 };
 
-                sync = state.counter; while (state.counter == sync); // sync to our counter tick again
-                sync = state.counter; while (state.counter == sync);
+                    // we know we're not using SEH here, it's on purpose, and doesn't matter the CPU core
+                    #if (CLANG || GCC)
+                        __asm__ volatile("sidt %0" : "=m"(idtr_buffer));
+                    #elif (MSVC)
+                        #pragma pack(push, 1)
+                        struct {
+                            USHORT Limit;
+                            ULONG_PTR Base;
+                        } idtr;
+                        #pragma pack(pop)
+                        __sidt(&idtr);
+                        memcpy(idtr_buffer, &idtr, sizeof(idtr));
+                    #endif   
 
-                r_pre = state.counter;
-                std::atomic_signal_fence(std::memory_order_seq_cst);
-                for (int i = 0; i < 8; ++i) _mm_lfence(); // 8 LFENCES is enough for the MESI RFO cache bounce in the data race (so that the counter thread sees an increment)
-                std::atomic_signal_fence(std::memory_order_seq_cst);
-                r_post = state.counter;
+                    ULONG_PTR idt_base = 0;
+                    memcpy(&idt_base, &idtr_buffer[2], sizeof(idt_base));
 
-                // we dont filter by cycles spent here (for example by querying thread cycle time) because the point of this function is to not let either the kernel or this app handle a TSC read
-                if (v_post > v_pre && r_post > r_pre) {
-                    vm_samples[valid] = v_post - v_pre;
-                    ref_samples[valid] = r_post - r_pre;
-                    valid++;
-                }
+                    // if running under Hyper-V in AMD64 (doesnt matter the VTL/partition level), this value is hardcoded and intercepted/emulated at kernel level
+                    // specifically at KiPreprocessFault -> KiOpDecode -> KiOpLocateDecodeEntry (KiOp_SLDTSTRSMSW)
+                    // this is intercepted by the kernel before handling execution to the hypervisor, so it's a decent safeguard against basic cpuid spoofing
+                    if (idt_base == 0xfffff80000001000) {
+                        debug("HYPER-X: Detected Hyper-V host machine");
+                        core::add(brand_enum::HYPERV_ROOT);
+                        state = HYPERV_ARTIFACT_VM;
+                    }
+                    else {
+                        debug("HYPER-X: Detected hypervisor trying to spoof itself as Hyper-V");
+                        state = HYPERV_UNKNOWN; // doing this is enough to trigger a VM detection, we dont need to mark a 100% vm score as our techniques will do the job for us
+                    }
+                #else
+                    debug("HYPER-X: Detected Hyper-V host machine");
+                    core::add(brand_enum::HYPERV_ROOT);
+                    state = HYPERV_ARTIFACT_VM;
+                #endif                    
+                } 
             }
 
-            const u64 cpuid_l = calculate_latency(vm_samples); // check for lowest dense cluster with no interrupt spikes, filter noise we can detect (SMIs, etc)
-            const u64 ref_l = calculate_latency(ref_samples);
-            const double ratio = ref_l ? (double)cpuid_l / (double)ref_l : 0;
+            memo::hyperx::store(state);
 
-            debug("TIMER: CPUID -> ", cpuid_l, " | Ref -> ",  ref_l, " | Ratio -> ", ratio);
+            return state;
+        #endif
+        }
 
-            if (ratio >= threshold) hypervisor_detected = true;
+    #if (WINDOWS)
+        // retrieves the addresses of specified functions from a loaded module using the export directory, manual implementation of GetProcAddress
+        static void get_function_address(const HMODULE hModule, const char* names[], void** functions, size_t count) {
+            using func_map = std::unordered_map<std::string, void*>;
+            static std::unordered_map<HMODULE, func_map> function_cache;
 
-            // Now detect bypassers letting the VM boot with cpuid interception, and then disabling interception with SVM by flipping bit 18 in the VMCB 
-            // if hypervisor lies about the CPU vendor, it will create 100000 more detectable signals (querying intel-specific behavior)
-            if (cpu::is_amd()) {
-                i32 res_d0[4], res_d1[4], res_d12[4], res_ext[4];
-                trigger_vmexit(res_d0, 0xD, 0);
-                trigger_vmexit(res_d1, 0xD, 1);
-                trigger_vmexit(res_d12, 0xD, 12);
-                trigger_vmexit(res_ext, 0x80000008, 0);
+            for (size_t i = 0; i < count; ++i) functions[i] = nullptr;
+            if (!hModule) return;
 
-                const bool hardware_supports_cet = (res_d12[0] > 0);
-                const u32 active_xcr0_size = (u32)res_d0[1];
-                const u32 active_total_size = (u32)res_d1[1];
+            BYTE* base = reinterpret_cast<BYTE*>(hModule);
 
-                if (hardware_supports_cet && (active_total_size == active_xcr0_size)) {
-                    debug("TIMER: VMAware detected a SVM hypervisor with cpuid interception disabled, score was raised up due to a bypass attempt.");
-                    bypass_detected = true;
+            size_t module_size = 0;
+            {
+                MEMORY_BASIC_INFORMATION mbi = {};
+                if (VirtualQuery(base, &mbi, sizeof(mbi))) {
+                    module_size = static_cast<size_t>(mbi.RegionSize);
+                }
+                else {
+                    return;
                 }
             }
 
-            SetPriorityClass(current_process, NORMAL_PRIORITY_CLASS);
-            state.test_done.store(true, std::memory_order_release);
-        };
-
-        std::thread t1(counter_thread);
-        std::thread t2(trigger_thread);
-
-        t1.join();
-        t2.join();
+            auto valid_range = [&](size_t offset, size_t sz) noexcept -> bool {
+                return (sz > 0) && (offset < module_size) && (sz <= module_size - offset);
+            };
 
-        if (hypervisor_detected) {
-            return true; // 100 score
-        }
-        else if (bypass_detected) {
-            return core::add(brand_enum::KVM, 150); // 150 score, KVM is a guess
-        }
+            auto cstr_from_rva = [&](DWORD rva) noexcept -> const char* {
+                if (!valid_range(static_cast<size_t>(rva), 1)) return nullptr;
 
-        return hypervisor_detected;
-#endif
-        return false;
-    }
+                const char* start = reinterpret_cast<const char*>(base + rva);
+                const size_t remaining = module_size - static_cast<size_t>(rva);
 
-#if (LINUX)
-    /**
-     * @brief Check result from systemd-detect-virt tool
-     * @category Linux
-     * @implements VM::SYSTEMD
-     */
-    [[nodiscard]] static bool systemd_virt() {
-        if (!(util::exists("/usr/bin/systemd-detect-virt") || util::exists("/bin/systemd-detect-virt"))) {
-            debug("SYSTEMD: ", "binary doesn't exist");
-            return false;
-        }
+                if (std::memchr(start, '\0', remaining)) {
+                    return start;
+                }
 
-        const std::unique_ptr<std::string> result = util::sys_result("systemd-detect-virt");
+                return nullptr;
+            };
 
-        if (result == nullptr) {
-            debug("SYSTEMD: ", "invalid stdout output from systemd-detect-virt");
-            return false;
-        }
+            // Validate DOS header 
+            if (!valid_range(0, sizeof(IMAGE_DOS_HEADER))) return;
+            const auto* dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(base);
+            if (dosHeader->e_magic != IMAGE_DOS_SIGNATURE) return;
 
-        debug("SYSTEMD: ", "output = ", *result);
+            // e_lfanew -> NT headers
+            if (dosHeader->e_lfanew < 0) return;
+            const size_t e_lfanew = static_cast<size_t>(dosHeader->e_lfanew);
+            if (!valid_range(e_lfanew, sizeof(IMAGE_NT_HEADERS))) return;
+            const auto* ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(base + e_lfanew);
+            if (ntHeaders->Signature != IMAGE_NT_SIGNATURE) return;
 
-        return (*result != "none");
-    }
+            const size_t sizeOfImage = static_cast<size_t>(ntHeaders->OptionalHeader.SizeOfImage);
+            if (sizeOfImage != 0 && sizeOfImage > module_size) {
+                module_size = sizeOfImage;
+            }
 
+            // Check export data directory exists
+            if (ntHeaders->OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_EXPORT) {
+                return; // no export directory
+            }
 
-    /**
-     * @brief Check if the chassis vendor is a VM vendor
-     * @category Linux
-     * @implements VM::CVENDOR
-     */
-    [[nodiscard]] static bool chassis_vendor() {
-        const char* vendor_file = "/sys/devices/virtual/dmi/id/chassis_vendor";
-
-        if (!util::exists(vendor_file)) {
-            debug("CVENDOR: ", "file doesn't exist");
-            return false;
-        }
+            const auto& dd = ntHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+            if (dd.VirtualAddress == 0 || dd.Size == 0) {
+                return; // no exports
+            }
 
-        const std::string vendor = util::read_file(vendor_file);
+            // Validate export directory fits
+            if (!valid_range(static_cast<size_t>(dd.VirtualAddress), sizeof(IMAGE_EXPORT_DIRECTORY))) {
+                return;
+            }
 
-        // TODO: More can definitely be added, only QEMU and VBox were tested so far
-        if (util::find(vendor, "QEMU")) { return core::add(brand_enum::QEMU); }
-        if (util::find(vendor, "Oracle Corporation")) { return core::add(brand_enum::VBOX); }
+            const auto* exportDir = reinterpret_cast<const IMAGE_EXPORT_DIRECTORY*>(base + dd.VirtualAddress);
 
-        debug("CVENDOR: vendor = ", vendor);
+            const DWORD nameCount = exportDir->NumberOfNames;
+            const DWORD funcCount = exportDir->NumberOfFunctions;
 
-        return false;
-    }
+            constexpr DWORD MAX_NAMES = 1u << 20; // 1M names is absurd but protective
+            if (nameCount == 0 || nameCount > MAX_NAMES) return;
+            if (funcCount == 0 || funcCount > MAX_NAMES) return;
 
+            const DWORD addr_names = exportDir->AddressOfNames;
+            const DWORD addr_funcs = exportDir->AddressOfFunctions;
+            const DWORD addr_ord = exportDir->AddressOfNameOrdinals;
 
-    /**
-     * @brief Check if the chassis type is valid (it's very often invalid in VMs)
-     * @category Linux
-     * @implements VM::CTYPE
-     */
-    [[nodiscard]] static bool chassis_type() {
-        const char* chassis = "/sys/devices/virtual/dmi/id/chassis_type";
+            if (!valid_range(static_cast<size_t>(addr_names), static_cast<size_t>(nameCount) * sizeof(DWORD))) return;
+            if (!valid_range(static_cast<size_t>(addr_funcs), static_cast<size_t>(funcCount) * sizeof(DWORD))) return;
+            if (!valid_range(static_cast<size_t>(addr_ord), static_cast<size_t>(nameCount) * sizeof(WORD))) return;
 
-        if (util::exists(chassis)) {
-            return (stoi(util::read_file(chassis)) == 1);
-        } else {
-            debug("CTYPE: ", "file doesn't exist");
-        }
+            const DWORD* nameRvas = reinterpret_cast<const DWORD*>(base + addr_names);
+            const DWORD* funcRvas = reinterpret_cast<const DWORD*>(base + addr_funcs);
+            const WORD* ordinals = reinterpret_cast<const WORD*>(base + addr_ord);
 
-        return false;
-    }
+            func_map& module_cache = function_cache[hModule];
 
+            for (size_t i = 0; i < count; ++i) {
+                const char* current_name = names[i];
+                if (!current_name) continue;
+                const std::string s_name(current_name);
 
-    /**
-     * @brief Check if /.dockerenv or /.dockerinit file is present
-     * @category Linux
-     * @implements VM::DOCKERENV
-     */
-    [[nodiscard]] static bool dockerenv() {
-        if (util::exists("/.dockerenv") || util::exists("/.dockerinit")) {
-            return core::add(brand_enum::DOCKER);
-        }
+                // check cache first
+                const auto cache_it = module_cache.find(s_name);
+                if (cache_it != module_cache.end()) {
+                    functions[i] = cache_it->second;
+                    continue;
+                }
 
-        return false;
-    }
+                // binary search over names (names array is typically sorted)
+                DWORD lo = 0, hi = nameCount;
+                while (lo < hi) {
+                    const DWORD mid = lo + (hi - lo) / 2;
+                    const DWORD midNameRva = nameRvas[mid];
+                    const char* midName = cstr_from_rva(midNameRva);
+                    if (!midName) { // corrupted string table or something
+                        lo = hi;
+                        break;
+                    }
 
+                    const int cmp = strcmp(current_name, midName);
+                    if (cmp > 0) {
+                        lo = mid + 1;
+                    }
+                    else {
+                        hi = mid;
+                    }
+                }
 
-    /**
-     * @brief Check if dmidecode output matches a VM brand
-     * @category Linux
-     * @warning Permissions required
-     * @implements VM::DMIDECODE
-     */
-    [[nodiscard]] static bool dmidecode() {
-        if (!util::is_admin()) {
-            debug("DMIDECODE: ", "precondition return called (root = ", util::is_admin(), ")");
-            return false;
+                if (lo < nameCount) {
+                    const char* candidateName = cstr_from_rva(nameRvas[lo]);
+                    if (candidateName && strcmp(current_name, candidateName) == 0) {
+                        const WORD nameOrdinal = ordinals[lo];
+                        if (static_cast<DWORD>(nameOrdinal) >= funcCount) continue;
+                        const DWORD funcRva = funcRvas[nameOrdinal];
+                        if (!valid_range(static_cast<size_t>(funcRva), 1)) continue;
+                        void* addr = reinterpret_cast<void*>(base + funcRva);
+                        functions[i] = addr;
+                        module_cache[s_name] = addr;
+                        continue;
+                    }
+                }
+            }
         }
 
-        if (!(util::exists("/bin/dmidecode") || util::exists("/usr/bin/dmidecode"))) {
-            debug("DMIDECODE: ", "binary doesn't exist");
-            return false;
-        }
 
-        const std::unique_ptr<std::string> result = util::sys_result("dmidecode -t system | grep 'Manufacturer|Product' | grep -c \"QEMU|VirtualBox|KVM\"");
+        [[nodiscard]] static HMODULE get_ntdll() {
+            static HMODULE cached_ntdll = nullptr;
+            if (cached_ntdll != nullptr) {
+                return cached_ntdll;
+            }
 
-        if (!result || result->empty()) {
-            debug("DMIDECODE: ", "invalid output");
-            return false;
-        } else if (*result == "QEMU") {
-            return core::add(brand_enum::QEMU);
-        } else if (*result == "VirtualBox") {
-            return core::add(brand_enum::VBOX);
-        } else if (*result == "KVM") {
-            return core::add(brand_enum::KVM);
-        } else if (std::atoi(result->c_str()) >= 1) {
-            return true;
-        } else {
-            debug("DMIDECODE: ", "output = ", *result);
-        }
+        #ifndef _WINTERNL_
+            typedef struct _UNICODE_STRING {
+                USHORT Length;
+                USHORT MaximumLength;
+                PWSTR  Buffer;
+            } UNICODE_STRING, * PUNICODE_STRING;
 
-        return false;
-    }
+            typedef struct _PEB_LDR_DATA {
+                BYTE Reserved1[8];
+                PVOID Reserved2[3];
+                LIST_ENTRY InMemoryOrderModuleList;
+            } PEB_LDR_DATA, * PPEB_LDR_DATA;
 
+            typedef struct _LDR_DATA_TABLE_ENTRY {
+                PVOID Reserved1[2];
+                LIST_ENTRY InMemoryOrderLinks;
+                PVOID Reserved2[2];
+                PVOID DllBase;
+                PVOID Reserved3[2];
+                UNICODE_STRING FullDllName;
+                BYTE Reserved4[8];
+                PVOID Reserved5[3];
+            #pragma warning(push)
+            #pragma warning(disable: 4201)
+                union {
+                    ULONG CheckSum;
+                    PVOID Reserved6;
+                } DUMMYUNIONNAME;
+            #pragma warning(pop)
+                ULONG TimeDateStamp;
+            } LDR_DATA_TABLE_ENTRY, * PLDR_DATA_TABLE_ENTRY;
 
-    /**
-     * @brief Check if mac address starts with certain VM designated values
-     * @category Linux
-     * @implements VM::MAC
-     */
-    [[nodiscard]] static bool mac_address_check() {
-        struct fdguard {
-            int fd;
-            explicit fdguard(int fd = -1) : fd(fd) {}
-            ~fdguard() { if (fd != -1) ::close(fd); }
-            int get() const { return fd; }
-            int release() { int tmp = fd; fd = -1; return tmp; }
-        };
+            typedef struct _PEB {
+                BYTE Reserved1[2];
+                BYTE BeingDebugged;
+                BYTE Reserved2[1];
+                PVOID Reserved3[2];
+                PPEB_LDR_DATA Ldr;
+            } PEB, * PPEB;
+        #endif
 
-        u8 mac[6] = { 0 };
-        struct ifreq ifr;
-        struct ifconf ifc;
-        char buf[1024];
-        int success = 0;
+            PPEB peb = nullptr;
 
-        int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
-        if (sock == -1) {
-            return false;
-        }
-        fdguard sockGuard(sock); // will close on function exit
+        #if (x86_64)
+            #if (MSVC && !CLANG)
+                peb = reinterpret_cast<PPEB>(__readgsqword(0x60));
+            #else
+                asm("movq %%gs:0x60, %0" : "=r"(peb));
+            #endif
+        #elif (x86_32)
+            #if (MSVC&& !CLANG)
+                peb = reinterpret_cast<PPEB>(__readfsdword(0x30));
+            #else
+                asm("movl %%fs:0x30, %0" : "=r"(peb));
+            #endif
+        #endif
 
-        ifc.ifc_len = sizeof(buf);
-        ifc.ifc_buf = buf;
+            if (!peb) { // not x86 or tampered with
+                const HMODULE ntdll = GetModuleHandleW(L"ntdll.dll");
+                if (ntdll) cached_ntdll = ntdll;
+                return ntdll;
+            }
 
-        if (ioctl(sockGuard.get(), SIOCGIFCONF, &ifc) == -1) {
-            return false;
-        }
+            PPEB_LDR_DATA ldr = peb->Ldr;
+            if (!ldr) {
+                const HMODULE h = GetModuleHandleW(L"ntdll.dll");
+                if (h) cached_ntdll = h;
+                return h;
+            }
 
-        struct ifreq* it = ifc.ifc_req;
-        const struct ifreq* end = it + (ifc.ifc_len / sizeof(struct ifreq));
+            #ifndef CONTAINING_RECORD
+                #define CONTAINING_RECORD(address, type, field) ((type *)((char*)(address) - (size_t)(&((type *)0)->field)))
+            #endif
 
-        for (; it != end; ++it) {
-            std::size_t name_len = std::min<std::size_t>(sizeof(ifr.ifr_name) - 1, strlen(it->ifr_name));
-            std::memcpy(ifr.ifr_name, it->ifr_name, name_len);
-            ifr.ifr_name[name_len] = '\0';
+            constexpr WCHAR target_name[] = L"ntdll.dll";
+            constexpr size_t target_length = (std::size(target_name) - 1);
 
-            if (ioctl(sockGuard.get(), SIOCGIFFLAGS, &ifr) != 0) {
-                return false;
-            }
+            LIST_ENTRY* head = &ldr->InMemoryOrderModuleList;
+            // static analyzers don't know that InMemoryOrderModuleList is a circular list managed by the loader
+            // so they conservatively assume head->Flink or some cur->Flink might be nullptr
+            for (LIST_ENTRY* cur = head->Flink; cur != nullptr && cur != head; cur = cur->Flink) {
+                auto* ent = CONTAINING_RECORD(cur, LDR_DATA_TABLE_ENTRY, InMemoryOrderLinks);
+                if (!ent) continue;
 
-            if (!(ifr.ifr_flags & IFF_LOOPBACK)) {
-                if (ioctl(sockGuard.get(), SIOCGIFHWADDR, &ifr) == 0) {
-                    success = 1;
-                    break;
-                }
-            }
-        }
+                auto* fullname = &ent->FullDllName;
+                if (!fullname->Buffer || fullname->Length == 0) continue;
 
-        if (success) {
-            std::memcpy(mac, ifr.ifr_hwaddr.sa_data, 6);
-        }
-        else {
-            debug("MAC: ", "not successful");
-        }
+                const auto total_chars = static_cast<USHORT>(fullname->Length / sizeof(WCHAR));
 
-    #ifdef __VMAWARE_DEBUG__
-        {
-            std::stringstream ss;
-            ss << std::hex << std::setw(2) << std::setfill('0')
-                << static_cast<int>(mac[0]) << ":"
+                size_t start = total_chars;
+                while (start > 0) {
+                    const WCHAR c = fullname->Buffer[start - 1];
+                    if (c == L'\\' || c == L'/') break;
+                    --start;
+                }
+
+                const size_t file_length = total_chars - start;
+                if (file_length != target_length) continue;
+
+                bool match = true;
+                for (size_t i = 0; i < file_length; ++i) {
+                    WCHAR a = fullname->Buffer[start + i];
+                    WCHAR b = target_name[i];
+                    if (a >= L'A' && a <= L'Z') a = static_cast<WCHAR>(a + 32);
+                    if (b >= L'A' && b <= L'Z') b = static_cast<WCHAR>(b + 32);
+                    if (a != b) { match = false; break; }
+                }
+
+                if (match) {
+                    cached_ntdll = reinterpret_cast<HMODULE>(ent->DllBase);
+                    return cached_ntdll;
+                }
+            }
+
+            const HMODULE h = GetModuleHandleW(L"ntdll.dll");
+            if (h) cached_ntdll = h;
+            return h;
+        } 
+
+
+        static bool get_manufacturer_model(const char** out_manufacturer, const char** out_model) {
+            if (out_manufacturer) *out_manufacturer = "";
+            if (out_model) *out_model = "";
+
+            if (memo::bios_info::is_cached()) {
+                if (out_manufacturer) *out_manufacturer = memo::bios_info::fetch_manufacturer();
+                if (out_model) *out_model = memo::bios_info::fetch_model();
+                return memo::bios_info::fetch_manufacturer()[0] != '\0' || memo::bios_info::fetch_model()[0] != '\0';
+            }
+
+            WCHAR wbuf[256]{};
+            DWORD cb = sizeof(wbuf);
+
+            char man_tmp[sizeof(memo::bios_info::manufacturer)]{};
+            char model_tmp[sizeof(memo::bios_info::model)]{};
+            man_tmp[0] = '\0';
+            model_tmp[0] = '\0';
+
+            bool got_any = false;
+
+            cb = sizeof(wbuf);
+            if (RegGetValueW(HKEY_LOCAL_MACHINE,
+                L"HARDWARE\\DESCRIPTION\\System\\BIOS",
+                L"SystemManufacturer",
+                RRF_RT_REG_SZ,
+                nullptr,
+                wbuf,
+                &cb) == ERROR_SUCCESS && wbuf[0] != L'\0') {
+                const int conv = WideCharToMultiByte(CP_UTF8, 0, wbuf, -1, man_tmp, static_cast<int>(sizeof(man_tmp)), nullptr, nullptr);
+                if (conv > 0) {
+                    man_tmp[sizeof(man_tmp) - 1] = '\0';
+                    got_any = true;
+                }
+            }
+
+            cb = sizeof(wbuf);
+            if (RegGetValueW(HKEY_LOCAL_MACHINE,
+                L"HARDWARE\\DESCRIPTION\\System\\BIOS",
+                L"SystemProductName",
+                RRF_RT_REG_SZ,
+                nullptr,
+                wbuf,
+                &cb) == ERROR_SUCCESS && wbuf[0] != L'\0') {
+                const int conv = WideCharToMultiByte(CP_UTF8, 0, wbuf, -1, model_tmp, static_cast<int>(sizeof(model_tmp)), nullptr, nullptr);
+                if (conv > 0) {
+                    model_tmp[sizeof(model_tmp) - 1] = '\0';
+                    got_any = true;
+                }
+            }
+
+            memo::bios_info::store(man_tmp, model_tmp);
+
+            if (out_manufacturer) *out_manufacturer = memo::bios_info::fetch_manufacturer();
+            if (out_model) *out_model = memo::bios_info::fetch_model();
+
+            return got_any;
+        }
+    #endif
+    };
+
+
+    struct brands {
+        static constexpr const char* NULL_BRAND = "Unknown";
+        static constexpr const char* VBOX = "VirtualBox";
+        static constexpr const char* VMWARE = "VMware";
+        static constexpr const char* VMWARE_EXPRESS = "VMware Express";
+        static constexpr const char* VMWARE_ESX = "VMware ESX";
+        static constexpr const char* VMWARE_GSX = "VMware GSX";
+        static constexpr const char* VMWARE_WORKSTATION = "VMware Workstation";
+        static constexpr const char* VMWARE_FUSION = "VMware Fusion";
+        static constexpr const char* VMWARE_HARD = "VMware (with VmwareHardenedLoader)";
+        static constexpr const char* BHYVE = "bhyve";
+        static constexpr const char* KVM = "KVM";
+        static constexpr const char* QEMU = "QEMU";
+        static constexpr const char* QEMU_KVM = "QEMU+KVM";
+        static constexpr const char* KVM_HYPERV = "KVM Hyper-V Enlightenment";
+        static constexpr const char* QEMU_KVM_HYPERV = "QEMU+KVM Hyper-V Enlightenment";
+        static constexpr const char* HYPERV = "Microsoft Hyper-V";
+        static constexpr const char* HYPERV_VPC = "Microsoft Virtual PC/Hyper-V";
+        static constexpr const char* PARALLELS = "Parallels";
+        static constexpr const char* XEN = "Xen HVM";
+        static constexpr const char* ACRN = "ACRN";
+        static constexpr const char* QNX = "QNX hypervisor";
+        static constexpr const char* HYBRID = "Hybrid Analysis";
+        static constexpr const char* SANDBOXIE = "Sandboxie";
+        static constexpr const char* DOCKER = "Docker";
+        static constexpr const char* WINE = "Wine";
+        static constexpr const char* VPC = "Virtual PC";
+        static constexpr const char* ANUBIS = "Anubis";
+        static constexpr const char* JOEBOX = "JoeBox";
+        static constexpr const char* THREATEXPERT = "ThreatExpert";
+        static constexpr const char* CWSANDBOX = "CWSandbox";
+        static constexpr const char* COMODO = "Comodo";
+        static constexpr const char* BOCHS = "Bochs";
+        static constexpr const char* NVMM = "NetBSD NVMM";
+        static constexpr const char* BSD_VMM = "OpenBSD VMM";
+        static constexpr const char* INTEL_HAXM = "Intel HAXM";
+        static constexpr const char* UNISYS = "Unisys s-Par";
+        static constexpr const char* LMHS = "Lockheed Martin LMHS";
+        static constexpr const char* CUCKOO = "Cuckoo";
+        static constexpr const char* BLUESTACKS = "BlueStacks";
+        static constexpr const char* JAILHOUSE = "Jailhouse";
+        static constexpr const char* APPLE_VZ = "Apple VZ";
+        static constexpr const char* INTEL_KGT = "Intel KGT (Trusty)";
+        static constexpr const char* AZURE_HYPERV = "Microsoft Azure Hyper-V";
+        static constexpr const char* SIMPLEVISOR = "SimpleVisor";
+        static constexpr const char* HYPERV_ROOT = "Hyper-V root partition (host system, not an actual VM)";
+        static constexpr const char* UML = "User-mode Linux";
+        static constexpr const char* POWERVM = "IBM PowerVM";
+        static constexpr const char* GCE = "Google Compute Engine (KVM)";
+        static constexpr const char* OPENSTACK = "OpenStack (KVM)";
+        static constexpr const char* KUBEVIRT = "KubeVirt (KVM)";
+        static constexpr const char* AWS_NITRO = "AWS Nitro System EC2 (KVM-based)";
+        static constexpr const char* PODMAN = "Podman";
+        static constexpr const char* WSL = "WSL";
+        static constexpr const char* OPENVZ = "OpenVZ";
+        static constexpr const char* BAREVISOR = "Barevisor";
+        static constexpr const char* HYPERPLATFORM = "HyperPlatform";
+        static constexpr const char* MINIVISOR = "MiniVisor";
+        static constexpr const char* INTEL_TDX = "Intel TDX";
+        static constexpr const char* LKVM = "LKVM";
+        static constexpr const char* AMD_SEV = "AMD SEV";
+        static constexpr const char* AMD_SEV_ES = "AMD SEV-ES";
+        static constexpr const char* AMD_SEV_SNP = "AMD SEV-SNP";
+        static constexpr const char* NEKO_PROJECT = "Neko Project II";
+        static constexpr const char* NOIRVISOR = "NoirVisor";
+        static constexpr const char* QIHOO = "Qihoo 360 Sandbox";
+        static constexpr const char* NSJAIL = "nsjail";
+        static constexpr const char* DBVM = "DBVM";
+        static constexpr const char* UTM = "UTM";
+        static constexpr const char* COMPAQ = "Compaq FX!32";
+        static constexpr const char* INSIGNIA = "Insignia RealPC";
+        static constexpr const char* CONNECTIX = "Connectix Virtual PC";
+
+        static brand_list_t brand_list(const flagset& flags) {
+            if (memo::brand_list::is_cached()) {
+                return memo::brand_list::fetch();
+            }
+
+            // run all the techniques
+            return brand_list(core::run_all(flags));
+        }
+
+        // same as above, but for a scoreboard that's already filled by a core::run_all() call
+        static brand_list_t brand_list(const u16 score) {
+            if (memo::brand_list::is_cached()) {
+                return memo::brand_list::fetch();
+            }
+
+            brand_list_t active_brands = {};
+            active_brands.reserve(MAX_BRANDS);
+
+            {
+                // the scoreboard is only written while holding this lock
+                std::lock_guard<std::mutex> guard(memo::mutex);
+
+                for (size_t i = 0; i < MAX_BRANDS; ++i) {
+                    const core::brand_entry& entry = core::current().brand_scoreboard.at(i);
+                    if (entry.score > 0) {
+                        active_brands.push_back(std::make_pair(entry.name, entry.score));
+                    }
+                }
+            }
+    
+            #ifdef __VMAWARE_DEBUG__
+                for (const auto brand : active_brands) {
+                    debug("pre-processed scoreboard: ", int(brand.second), " : ", brands::brand_enum_to_string(brand.first));
+                }
+            #endif
+
+            auto remove = [&](const enum brand_enum brand) noexcept {
+                for (u8 i = 0; i < active_brands.size(); i++) {
+                    if (brand == active_brands.at(i).first) {
+                        active_brands.erase(active_brands.begin() + i);
+                        return;
+                    }
+                }
+            };
+
+            // if all brands have a point of 0, return "Unknown"
+            if (active_brands.size() == 0) {                        
+                active_brands.push_back({brand_enum::NULL_BRAND, 1});
+                memo::brand_list::store(active_brands);
+                return active_brands;
+            }
+
+            // if there's only a single brand, return it immediately
+            // We skip this early return if the single brand is HYPERV_ARTIFACT,
+            // but we must also nullify the result if the score is above 0, 
+            // which would most likely indicate a hardened VM instead and return "Unknown".
+            if (active_brands.size() == 1) {
+                const enum brand_enum brand = active_brands.front().first;
+
+                if (brand == brand_enum::HYPERV_ROOT && score > 0) {
+                    active_brands.push_back({brand_enum::NULL_BRAND, 1});
+                    remove(brand_enum::HYPERV_ROOT);
+                }
+
+                memo::brand_list::store(active_brands);
+                return active_brands;
+            }
+
+            // remove Hyper-V artifacts and Unknown if found with other brands
+            if (active_brands.size() > 1) {
+                remove(brand_enum::HYPERV_ROOT);
+                remove(brand_enum::NULL_BRAND);
+                remove(brand_enum::INVALID);
+            }
+
+            // this bitset acts as an abstraction layer for the merging stage of this function.
+            // the amount of hits above 0 for a brand isn't relevant, the core idea here is to
+            // just check the presence of the brand itself so we can merge them. 
+            std::bitset<MAX_BRANDS> brand_hits = {};
+
+            for (const auto brand : active_brands) {
+                brand_hits.set(static_cast<u8>(brand.first));
+            }
+
+            // merge 2 brands into one
+            auto merge = [&](const enum brand_enum a, const enum brand_enum b, const enum brand_enum result) noexcept -> void {
+                const bool a_hit = brand_hits.test(static_cast<u8>(a));
+                const bool b_hit = brand_hits.test(static_cast<u8>(b));
+
+                if (a_hit && b_hit) {
+                    remove(a);
+                    remove(b);
+                    active_brands.push_back({result, 2});
+                }
+            };
+
+            // same as above, but for 3
+            auto triple_merge = [&](const enum brand_enum a, const enum brand_enum b, const enum brand_enum c, const enum brand_enum result) noexcept -> void {
+                const bool a_hit = brand_hits.test(static_cast<u8>(a));
+                const bool b_hit = brand_hits.test(static_cast<u8>(b));
+                const bool c_hit = brand_hits.test(static_cast<u8>(c));
+
+                if (a_hit && b_hit && c_hit) {
+                    remove(a);
+                    remove(b);
+                    remove(c);
+                    active_brands.push_back({result, 2});
+                }
+            };
+
+            // Brand post-processing / merging
+            merge(brand_enum::VPC, brand_enum::HYPERV, brand_enum::HYPERV_VPC);
+
+            merge(brand_enum::AZURE_HYPERV, brand_enum::HYPERV, brand_enum::AZURE_HYPERV);
+            merge(brand_enum::AZURE_HYPERV, brand_enum::VPC, brand_enum::AZURE_HYPERV);
+            merge(brand_enum::AZURE_HYPERV, brand_enum::HYPERV_VPC, brand_enum::AZURE_HYPERV);
+
+            merge(brand_enum::QEMU, brand_enum::KVM, brand_enum::QEMU_KVM);
+            merge(brand_enum::KVM, brand_enum::HYPERV, brand_enum::KVM_HYPERV);
+            merge(brand_enum::QEMU, brand_enum::HYPERV, brand_enum::QEMU_KVM_HYPERV);
+            merge(brand_enum::QEMU_KVM, brand_enum::HYPERV, brand_enum::QEMU_KVM_HYPERV);
+
+            merge(brand_enum::KVM, brand_enum::HYPERV_VPC, brand_enum::KVM_HYPERV);
+            merge(brand_enum::QEMU, brand_enum::HYPERV_VPC, brand_enum::QEMU_KVM_HYPERV);
+            merge(brand_enum::QEMU_KVM, brand_enum::HYPERV_VPC, brand_enum::QEMU_KVM_HYPERV);
+
+            merge(brand_enum::KVM, brand_enum::KVM_HYPERV, brand_enum::KVM_HYPERV);
+            merge(brand_enum::QEMU, brand_enum::KVM_HYPERV, brand_enum::QEMU_KVM_HYPERV);
+            merge(brand_enum::QEMU_KVM, brand_enum::KVM_HYPERV, brand_enum::QEMU_KVM_HYPERV);
+
+            triple_merge(brand_enum::QEMU, brand_enum::KVM, brand_enum::KVM_HYPERV, brand_enum::QEMU_KVM_HYPERV);
+
+            merge(brand_enum::VMWARE, brand_enum::VMWARE_FUSION, brand_enum::VMWARE_FUSION);
+            merge(brand_enum::VMWARE, brand_enum::VMWARE_EXPRESS, brand_enum::VMWARE_EXPRESS);
+            merge(brand_enum::VMWARE, brand_enum::VMWARE_ESX, brand_enum::VMWARE_ESX);
+            merge(brand_enum::VMWARE, brand_enum::VMWARE_GSX, brand_enum::VMWARE_GSX);
+            merge(brand_enum::VMWARE, brand_enum::VMWARE_WORKSTATION, brand_enum::VMWARE_WORKSTATION);
+
+            merge(brand_enum::VMWARE_HARD, brand_enum::VMWARE, brand_enum::VMWARE_HARD);
+            merge(brand_enum::VMWARE_HARD, brand_enum::VMWARE_FUSION, brand_enum::VMWARE_HARD);
+            merge(brand_enum::VMWARE_HARD, brand_enum::VMWARE_EXPRESS, brand_enum::VMWARE_HARD);
+            merge(brand_enum::VMWARE_HARD, brand_enum::VMWARE_ESX, brand_enum::VMWARE_HARD);
+            merge(brand_enum::VMWARE_HARD, brand_enum::VMWARE_GSX, brand_enum::VMWARE_HARD);
+            merge(brand_enum::VMWARE_HARD, brand_enum::VMWARE_WORKSTATION, brand_enum::VMWARE_HARD);
+
+            
+            if (active_brands.size() > 1) {
+                std::sort(active_brands.begin(), active_brands.begin() + static_cast<std::ptrdiff_t>(active_brands.size()), [](
+                    const brand_element_t& a,
+                    const brand_element_t& b
+                ) {
+                    return a.second > b.second; // .second = brand score (usually u8)
+                });
+            }
+
+            for (const auto brand : active_brands) {
+                if (brand.second > 0) {
+                    active_brands.push_back({brand.first, brand.second});
+                }
+            }
+
+        #ifdef __VMAWARE_DEBUG__
+            for (const auto brand : active_brands) {
+                debug("post-processed scoreboard: ", brand.second, " : ", brands::brand_enum_to_string(brand.first));
+            }
+        #endif
+
+            memo::brand_list::store(active_brands);
+            return active_brands;
+        }
+
+        static const char* brand_enum_to_string(const brand_enum brand) {
+            switch (brand) {
+                case brand_enum::INVALID: return "Invalid";
+                case brand_enum::VBOX: return VM::brands::VBOX;
+                case brand_enum::VMWARE: return VM::brands::VMWARE;
+                case brand_enum::VMWARE_EXPRESS: return VM::brands::VMWARE_EXPRESS;
+                case brand_enum::VMWARE_ESX: return VM::brands::VMWARE_ESX;
+                case brand_enum::VMWARE_GSX: return VM::brands::VMWARE_GSX;
+                case brand_enum::VMWARE_WORKSTATION: return VM::brands::VMWARE_WORKSTATION;
+                case brand_enum::VMWARE_FUSION: return VM::brands::VMWARE_FUSION;
+                case brand_enum::VMWARE_HARD: return VM::brands::VMWARE_HARD;
+                case brand_enum::BHYVE: return VM::brands::BHYVE;
+                case brand_enum::KVM: return VM::brands::KVM;
+                case brand_enum::QEMU: return VM::brands::QEMU;
+                case brand_enum::QEMU_KVM: return VM::brands::QEMU_KVM;
+                case brand_enum::KVM_HYPERV: return VM::brands::KVM_HYPERV;
+                case brand_enum::QEMU_KVM_HYPERV: return VM::brands::QEMU_KVM_HYPERV;
+                case brand_enum::HYPERV: return VM::brands::HYPERV;
+                case brand_enum::HYPERV_VPC: return VM::brands::HYPERV_VPC;
+                case brand_enum::PARALLELS: return VM::brands::PARALLELS;
+                case brand_enum::XEN: return VM::brands::XEN;
+                case brand_enum::ACRN: return VM::brands::ACRN;
+                case brand_enum::QNX: return VM::brands::QNX;
+                case brand_enum::HYBRID: return VM::brands::HYBRID;
+                case brand_enum::SANDBOXIE: return VM::brands::SANDBOXIE;
+                case brand_enum::DOCKER: return VM::brands::DOCKER;
+                case brand_enum::WINE: return VM::brands::WINE;
+                case brand_enum::VPC: return VM::brands::VPC;
+                case brand_enum::ANUBIS: return VM::brands::ANUBIS;
+                case brand_enum::JOEBOX: return VM::brands::JOEBOX;
+                case brand_enum::THREATEXPERT: return VM::brands::THREATEXPERT;
+                case brand_enum::CWSANDBOX: return VM::brands::CWSANDBOX;
+                case brand_enum::COMODO: return VM::brands::COMODO;
+                case brand_enum::BOCHS: return VM::brands::BOCHS;
+                case brand_enum::NVMM: return VM::brands::NVMM;
+                case brand_enum::BSD_VMM: return VM::brands::BSD_VMM;
+                case brand_enum::INTEL_HAXM: return VM::brands::INTEL_HAXM;
+                case brand_enum::UNISYS: return VM::brands::UNISYS;
+                case brand_enum::LMHS: return VM::brands::LMHS;
+                case brand_enum::CUCKOO: return VM::brands::CUCKOO;
+                case brand_enum::BLUESTACKS: return VM::brands::BLUESTACKS;
+                case brand_enum::JAILHOUSE: return VM::brands::JAILHOUSE;
+                case brand_enum::APPLE_VZ: return VM::brands::APPLE_VZ;
+                case brand_enum::INTEL_KGT: return VM::brands::INTEL_KGT;
+                case brand_enum::AZURE_HYPERV: return VM::brands::AZURE_HYPERV;
+                case brand_enum::SIMPLEVISOR: return VM::brands::SIMPLEVISOR;
+                case brand_enum::HYPERV_ROOT: return VM::brands::HYPERV_ROOT;
+                case brand_enum::UML: return VM::brands::UML;
+                case brand_enum::POWERVM: return VM::brands::POWERVM;
+                case brand_enum::GCE: return VM::brands::GCE;
+                case brand_enum::OPENSTACK: return VM::brands::OPENSTACK;
+                case brand_enum::KUBEVIRT: return VM::brands::KUBEVIRT;
+                case brand_enum::AWS_NITRO: return VM::brands::AWS_NITRO;
+                case brand_enum::PODMAN: return VM::brands::PODMAN;
+                case brand_enum::WSL: return VM::brands::WSL;
+                case brand_enum::OPENVZ: return VM::brands::OPENVZ;
+                case brand_enum::BAREVISOR: return VM::brands::BAREVISOR;
+                case brand_enum::HYPERPLATFORM: return VM::brands::HYPERPLATFORM;
+                case brand_enum::MINIVISOR: return VM::brands::MINIVISOR;
+                case brand_enum::INTEL_TDX: return VM::brands::INTEL_TDX;
+                case brand_enum::LKVM: return VM::brands::LKVM;
+                case brand_enum::AMD_SEV: return VM::brands::AMD_SEV;
+                case brand_enum::AMD_SEV_ES: return VM::brands::AMD_SEV_ES;
+                case brand_enum::AMD_SEV_SNP: return VM::brands::AMD_SEV_SNP;
+                case brand_enum::NEKO_PROJECT: return VM::brands::NEKO_PROJECT;
+                case brand_enum::NOIRVISOR: return VM::brands::NOIRVISOR;
+                case brand_enum::QIHOO: return VM::brands::QIHOO;
+                case brand_enum::NSJAIL: return VM::brands::NSJAIL;
+                case brand_enum::DBVM: return VM::brands::DBVM;
+                case brand_enum::UTM: return VM::brands::UTM;
+                case brand_enum::COMPAQ: return VM::brands::COMPAQ;
+                case brand_enum::INSIGNIA: return VM::brands::INSIGNIA;
+                case brand_enum::CONNECTIX: return VM::brands::CONNECTIX;
+                case brand_enum::NULL_BRAND: return VM::brands::NULL_BRAND; // do not modify placement of this, it's used as an anchor point to count the number of brands
+            }
+
+            return "Invalid";
+        }
+
+        static std::string fetch_brand_name(const brand_list_t& list, const size_t index) {
+            return brand_enum_to_string(list[index].first);
+        };
+    
+        static std::string brand_multiple(const flagset& flags = core::generate_default()) {
+            if (memo::multi_brand::is_cached()) {
+                return memo::multi_brand::fetch();
+            }
+
+            const brand_list_t& list = brands::brand_list(flags);
+            const std::string& buffer = brand_multiple(list);
+    
+            memo::multi_brand::store(buffer);
+            return buffer;
+        }
+            
+        static std::string brand_multiple(const brand_list_t& list) {
+            std::string buffer = {};
+            buffer += brands::fetch_brand_name(list, 0);
+
+            for (size_t i = 1; i < list.size(); i++) {
+                buffer += " or "; 
+                buffer += brands::fetch_brand_name(list, i);
+            }
+
+            return buffer;
+        }
+
+        static enum brand_enum brand_enum(const flagset& flags = core::generate_default()) {
+            if (memo::single_brand::is_cached()) {
+                return memo::single_brand::fetch();
+            }
+
+            const brand_list_t& list = brands::brand_list(flags);
+            const enum brand_enum brand = brand_enum(list);
+    
+            memo::single_brand::store(brand);
+
+            return brand;
+        }
+
+        static enum brand_enum brand_enum(const brand_list_t& list) {
+            const brand_element_t brand = list.front();
+            return brand.first;
+        }
+    };
+
+// START OF PRIVATE VM DETECTION TECHNIQUE DEFINITIONS
+    /**
+     * @brief Check CPUID output of manufacturer ID for known VMs/hypervisors at leaf 0 and 0x40000000-0x40000100
+     * @category x86
+     * @implements VM::VMID
+     */
+     [[nodiscard]] static bool vmid() {
+    #if (!x86)
+        return false;
+    #else
+        return (
+            cpu::vmid_template(0) ||
+            cpu::vmid_template(cpu::leaf::hypervisor) || // 0x40000000
+            cpu::vmid_template(cpu::leaf::hypervisor + 0x100) // 0x40000100
+        );
+    #endif
+    }
+
+
+    /**
+     * @brief Check if CPU brand model contains any VM-specific string snippets
+     * @category x86
+     * @implements VM::CPU_BRAND
+     */
+    [[nodiscard]] static bool cpu_brand() {
+    #if (!x86)
+        return false;
+    #else
+        const std::string& brand = cpu::get_identity().brand;
+
+        // easy shortcut for QEMU
+        if (brand.rfind("QEMU Virtual CPU version", 0) == 0) {
+            return core::add(brand_enum::QEMU);
+        }
+
+        // the generic ones only mean it's virtualized, without saying by what
+        static constexpr util::pattern checks[] = {
+            { "qemu",       brand_enum::QEMU },
+            { "kvm",        brand_enum::KVM },
+            { "vbox",       brand_enum::VBOX },
+            { "virtualbox", brand_enum::VBOX },
+            { "monitor",    brand_enum::NULL_BRAND },
+            { "bhyve",      brand_enum::BHYVE },
+            { "hypervisor", brand_enum::NULL_BRAND },
+            { "hvisor",     brand_enum::NULL_BRAND },
+            { "parallels",  brand_enum::PARALLELS },
+            { "vmware",     brand_enum::VMWARE }
+        };
+
+        static const util::pattern_matcher matcher(checks, sizeof(checks) / sizeof(checks[0]));
+
+        const util::pattern* hit = matcher.find(brand);
+
+        if (hit != nullptr) {
+            debug("CPU_BRAND: match = ", hit->text);
+            return (hit->brand != brand_enum::NULL_BRAND) ? core::add(hit->brand) : true;
+        }
+
+        return false;
+    #endif
+    }
+
+
+    /**
+     * @brief Check if hypervisor feature bit in CPUID ECX bit 31 is enabled (always false for physical CPUs)
+     * @category x86
+     * @implements VM::HYPERVISOR_BIT
+     */
+    [[nodiscard]] static bool hypervisor_bit() {
+    #if (!x86)
+        return false;
+    #else
+        u32 eax = 0, ebx = 0, ecx = 0, edx = 0;
+        cpu::cpuid(eax, ebx, ecx, edx, 1); 
+        constexpr u32 HYPERVISOR_MASK = (1u << 31);
+
+        if (ecx & HYPERVISOR_MASK) {
+            // if hypervisor bit is enabled, but we're in a root partition, prevent it from flagging
+            if (util::hyper_x() == HYPERV_ARTIFACT_VM) {
+                return false;
+            }
+
+            return true;
+        }
+        else {
+            // if hypervisor bit is disabled, but vmaware detects hyper-v signals, we're in an impossible situation (patching)
+            if (util::hyper_x() == HYPERV_ARTIFACT_VM) {
+                return true;
+            }
+        }
+
+        return false;
+    #endif
+    }
+
+
+    /**
+     * @brief Check for hypervisor brand string length (would be around 2 characters in a host machine)
+     * @category x86
+     * @implements VM::HYPERVISOR_STR
+     */
+    [[nodiscard]] static bool hypervisor_str() {
+    #if (!x86)
+        return false;
+    #else
+        if (util::hyper_x() == HYPERV_ARTIFACT_VM) {
+            return false;
+        }
+
+        char out[sizeof(i32) * 4 + 1] = { 0 }; // e*x size + number of e*x registers + null terminator
+        cpu::cpuid(reinterpret_cast<int*>(out), cpu::leaf::hypervisor);
+
+        debug("HYPERVISOR_STR: \neax: ", static_cast<u32>(out[0]),
+            "\nebx: ", static_cast<u32>(out[1]),
+            "\necx: ", static_cast<u32>(out[2]),
+            "\nedx: ", static_cast<u32>(out[3])
+        );
+
+        return (std::strlen(out + 4) >= 4);
+    #endif  
+    }
+    
+
+    /**
+     * @brief Check for various Bochs-related emulation oversights through CPU checks
+     * @category x86
+     * @author Discovered by Peter Ferrie, Senior Principal Researcher, Symantec Advanced Threat Research peter_ferrie@symantec.com
+     * @implements VM::BOCHS_CPU
+     */
+    [[nodiscard]] static bool bochs_cpu() {
+    #if (!x86)
+        return false;
+    #else
+        const bool intel = cpu::is_intel();
+        const bool amd = cpu::is_amd();
+
+        // if neither amd or intel, return false
+        if (!(intel || amd)) {
+            debug("BOCHS_CPU: neither AMD or Intel detected, returned false");
+            return false;
+        }
+
+        const std::string& brand = cpu::get_identity().brand;
+
+        if (intel) {
+            // technique 1: not a valid brand 
+            if (brand == "              Intel(R) Pentium(R) 4 CPU        ") {
+                debug("BOCHS_CPU: technique 1 found");
+                return core::add(brand_enum::BOCHS);
+            }
+        } else if (amd) {
+            // technique 2: "processor" should have a capital P
+            if (brand == "AMD Athlon(tm) processor") {
+                debug("BOCHS_CPU: technique 2 found");
+                return core::add(brand_enum::BOCHS);
+            }
+
+            // technique 3: Check for absence of AMD easter egg for K7 and K8 CPUs
+            constexpr u32 AMD_EASTER_EGG = 0x8fffffff; // this is the CPUID leaf of the AMD easter egg
+
+            if (!cpu::is_leaf_supported(AMD_EASTER_EGG)) {
+                return false;
+            }
+
+            u32 unused, eax = 0;
+            cpu::cpuid(eax, unused, unused, unused, 1);
+
+            auto is_k7 = [](const u32 eax) noexcept -> bool {
+                if ((eax & 0x0FF00F00) != 0x00000600) {
+                    return false;
+                }
+
+                const u32 model = (eax >> 4) & 0xF;
+
+                return (model - 1) < 4;
+            };
+
+            auto is_k8 = [](const u32 eax) noexcept -> bool {
+                if (((eax >> 8) & 0xF) != 0xF) {
+                    return false;
+                }
+
+                const u32 extended_family = (eax >> 20) & 0xFF;
+
+                return extended_family <= 1;
+            };
+
+            if (!(is_k7(eax) || is_k8(eax))) {
+                return false;
+            }
+
+            u32 ecx_bochs = 0;
+            cpu::cpuid(unused, unused, ecx_bochs, unused, AMD_EASTER_EGG);
+
+            if (ecx_bochs == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    #endif
+    }
+       
+    
+    /**
+	 * @brief Check if the system's thread count matches the expected thread count for the detected CPU model
+     * @category x86
+     * @implements VM::THREAD_MISMATCH
+     */
+    [[nodiscard]] static bool thread_mismatch() {
+    #if (!x86)
+        return false;
+    #else
+        auto is_smt_enabled = []() noexcept -> bool {
+            auto popcount = [](uint64_t v) noexcept -> int {
+            #if (GCC) || (CLANG)
+                return __builtin_popcountll(v);
+            #elif (MSVC)
+            #if (x86_32)
+                return static_cast<int>(
+                    __popcnt(static_cast<unsigned int>(v)) +
+                    __popcnt(static_cast<unsigned int>(v >> 32))
+                    );
+            #else
+                return static_cast<int>(__popcnt64(static_cast<unsigned long long>(v)));
+            #endif
+            #else
+                int c = 0;
+                while (v) { c += static_cast<int>(v & 1ull); v >>= 1; }
+                return c;
+            #endif
+            };
+        #if (WINDOWS)
+            DWORD len = 0;
+            if (GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &len) ||
+                GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
+                return false;
+            }
+            std::vector<char> buf(static_cast<size_t>(len));
+            if (!GetLogicalProcessorInformationEx(RelationProcessorCore,
+                reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buf.data()), &len)) {
+                return false;
+            }
+            // first RelationProcessorCore record encountered, basically if two logical processors maps to the same core, SMT is enabled to the OS point of view
+            size_t offset = 0;
+            while (offset + sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX) <= static_cast<size_t>(len)) {
+                auto rec = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buf.data() + offset);
+                if (rec->Relationship == RelationProcessorCore) {
+                    const PROCESSOR_RELATIONSHIP& pr = rec->Processor;
+                    unsigned total = 0;
+                    for (WORD i = 0; i < pr.GroupCount; ++i) {
+                        total += popcount(static_cast<uint64_t>(pr.GroupMask[i].Mask));
+                    }
+                    return total > 1;
+                }
+                if (rec->Size == 0) break;
+                offset += rec->Size;
+            }
+            return false;
+        #elif (APPLE)
+            int logical = 0, physical = 0;
+            size_t sz = sizeof(logical);
+            if (sysctlbyname("hw.logicalcpu", &logical, &sz, nullptr, 0) != 0) logical = 0;
+            sz = sizeof(physical);
+            if (sysctlbyname("hw.physicalcpu", &physical, &sz, nullptr, 0) != 0) physical = 0;
+            if (logical > 0 && physical > 0) return logical > physical;
+            return false;
+        #else
+            // both files are read into the same buffer
+            std::string buffer;
+
+            //  check cpu0 thread_siblings_list
+            {
+                const util::text_view s = util::read_into("/sys/devices/system/cpu/cpu0/topology/thread_siblings_list", buffer);
+                if (s.data != nullptr) {
+                    // only the first line, trimmed
+                    size_t a = 0; while (a < s.size && s.data[a] != '\n' && std::isspace(static_cast<unsigned char>(s.data[a]))) ++a;
+                    size_t b = a; while (b < s.size && s.data[b] != '\n') ++b;
+                    while (b > a && std::isspace(static_cast<unsigned char>(s.data[b - 1]))) --b;
+                    if (b > a) {
+                        for (size_t k = a; k < b; ++k) {
+                            if (s.data[k] == ',' || s.data[k] == '-') return true;
+                        }
+                        return false;
+                    }
+                }
+            }
+            // /proc/cpuinfo for unique (physical id, core id) pairs vs processors
+            const util::text_view cpuinfo = util::read_into("/proc/cpuinfo", buffer);
+            if (cpuinfo.data == nullptr) return false;
+            int processors = 0;
+            int cur_phys = -1, cur_core = -1;
+            std::vector<std::pair<int, int>> cores;
+            const char* const cpuinfo_end = cpuinfo.data + cpuinfo.size;
+            for (const char* line = cpuinfo.data; line < cpuinfo_end; ) {
+                const char* const line_end = std::find(line, cpuinfo_end, '\n');
+                const char* const next = (line_end == cpuinfo_end) ? line_end : line_end + 1;
+                if (line == line_end) {
+                    if (cur_phys != -1 && cur_core != -1) cores.emplace_back(cur_phys, cur_core);
+                    cur_phys = cur_core = -1;
+                    line = next;
+                    continue;
+                }
+                const char* const colon = std::find(line, line_end, ':');
+                if (colon == line_end) { line = next; continue; }
+                // trim
+                const char* key_end = colon;
+                while (key_end > line && std::isspace(static_cast<unsigned char>(key_end[-1]))) --key_end;
+                const char* val = colon + 1;
+                while (val < line_end && std::isspace(static_cast<unsigned char>(*val))) ++val;
+                auto key_is = [&](const char* key) noexcept -> bool {
+                    const size_t key_len = std::strlen(key);
+                    return (static_cast<size_t>(key_end - line) == key_len) && (std::memcmp(line, key, key_len) == 0);
+                };
+                // the buffer is null terminated, so strtol stops at the end of the line at the latest
+                auto number = [&]() noexcept -> int {
+                    return (val < line_end && std::isdigit(static_cast<unsigned char>(*val))) ? static_cast<int>(std::strtol(val, nullptr, 10)) : -1;
+                };
+                if (key_is("processor")) ++processors;
+                else if (key_is("physical id")) cur_phys = number();
+                else if (key_is("core id")) cur_core = number();
+                line = next;
+            }
+            if (cur_phys != -1 && cur_core != -1) cores.emplace_back(cur_phys, cur_core);
+            if (!cores.empty() && processors > 0) {
+                std::sort(cores.begin(), cores.end());
+                cores.erase(std::unique(cores.begin(), cores.end()), cores.end());
+                int physical_cores = static_cast<int>(cores.size());
+                return processors > physical_cores;
+            }
+            return false;
+        #endif
+        };
+
+        const cpu::identity_struct& info = cpu::get_identity();
+
+        if (info.found) {
+            debug(info.debug_tag, ": CPU model = ", info.brand);
+
+            const u32 actual = memo::threadcount::fetch();
+            if (actual != info.expected_threads) {
+                debug(info.debug_tag, ": Current threads -> ", actual);
+                const bool smt = is_smt_enabled();
+                if (smt) {
+                    debug(info.debug_tag, ": Expected  ", info.expected_threads, " threads");
+                    return true;
+                }
+                else {
+                    debug(info.debug_tag, ": Expected ", info.expected_threads, " threads, but found SMT disabled");
+                    return false;
+                }         
+            }
+        }
+        return false;
+    #endif
+    }
+
+
+    /**
+     * @brief Check for CPUID signatures that reveal the presence of a hypervisor
+     * @category x86
+     * @implements VM::CPUID_SIGNATURE
+     */
+    [[nodiscard]] static bool cpuid_signature() {
+    #if (!x86)
+        return false;
+    #else
+        u32 eax = 0, ebx = 0, ecx = 0, edx = 0;
+        cpu::cpuid(eax, ebx, ecx, edx, 0x40000001);
+
+        constexpr u32 simplevisor = 0x00766853; // " vhS"
+
+        debug("CPUID_SIGNATURE: eax = ", eax);
+
+        if (eax == simplevisor) {
+            return core::add(brand_enum::SIMPLEVISOR);
+        }
+
+        if (cpu::is_intel()) {
+            const bool has_leaf_b = cpu::is_leaf_supported(0x0B);
+            const bool has_leaf_1f = cpu::is_leaf_supported(0x1F);
+
+            // If neither extended topology leaf is supported, we can't perform the check
+            if (!has_leaf_b && !has_leaf_1f) {
+                return false;
+            }
+
+            u32 l1_eax = 0, l1_ebx = 0, l1_ecx = 0, l1_edx = 0;
+            u32 vb_eax = 0, vb_ebx = 0, vb_ecx = 0, vb_edx = 0;
+            u32 v1f_eax = 0, v1f_ebx = 0, v1f_ecx = 0, v1f_edx = 0;
+
+            u32 aba_start = 0, aba_end = 0;
+            u32 unused = 0;
+            int retries = 0;
+
+            // triple-read ABA pattern to detect thread migration and bounded to 8 retries
+            // leaf 1's Initial APIC ID is the ABA guard
+            do {
+                cpu::raw_cpuid(l1_eax, l1_ebx, l1_ecx, l1_edx, 1, 0);
+                aba_start = (l1_ebx >> 24) & 0xFF; // Initial APIC ID
+
+                if (has_leaf_b)  cpu::raw_cpuid(vb_eax, vb_ebx, vb_ecx, vb_edx, 0x0B, 0);
+                if (has_leaf_1f) cpu::raw_cpuid(v1f_eax, v1f_ebx, v1f_ecx, v1f_edx, 0x1F, 0);
+
+                cpu::raw_cpuid(unused, l1_ebx, unused, unused, 1, 0);
+                aba_end = (l1_ebx >> 24) & 0xFF;
+            } while (aba_start != aba_end && ++retries < 8);
+
+            // If we hit the retry limit and the thread is still migrating, 
+            // abort the check to prevent false positives
+            if (aba_start != aba_end) {
+                return false;
+            }
+
+            const u32 initial_apic_id = aba_start;
+
+            // check Leaf 0x0B against Leaf 1
+            if (has_leaf_b) {
+                const u32 vb_level = (vb_ecx >> 8) & 0xFF;
+
+                if (vb_level != 0) {
+                    // if x2APIC ID is < 255, Initial APIC ID must match exactly
+                    if (vb_edx < 255 && (vb_edx & 0xFF) != initial_apic_id) {
+                        return true;
+                    }
+                }
+            }
+
+            // check Leaf 0x1F against Leaf 1, and cross-check with 0x0B
+            if (has_leaf_1f) {
+                const u32 v1f_level = (v1f_ecx >> 8) & 0xFF;
+
+                if (v1f_level != 0) {
+                    // if x2APIC ID is < 255, Initial APIC ID must match exactly
+                    if (v1f_edx < 255 && (v1f_edx & 0xFF) != initial_apic_id) {
+                        return true;
+                    }
+
+                    // cross-check 0x0B vs 0x1F if both are supported and valid
+                    if (has_leaf_b) {
+                        const u32 vb_level = (vb_ecx >> 8) & 0xFF;
+                        if (vb_level != 0 && vb_edx != v1f_edx) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        else if (cpu::is_amd()) {
+            const bool has_leaf_7 = cpu::is_leaf_supported(7);
+
+            if (!has_leaf_7) {
+                return false;
+            }
+
+            u32 l7_eax = 0, l7_ebx = 0, l7_ecx = 0, l7_edx = 0;
+            cpu::cpuid(l7_eax, l7_ebx, l7_ecx, l7_edx, 7, 0);
+
+            // Intel enumerates hardware mitigations in Leaf 7.0.EDX:
+            // Bit 26: IBRS and IBPB
+            // Bit 27: STIBP
+            // Bit 31: SSBD
+
+            // AMD processors strictly reserve these bits (force them to 0) 
+            // and instead enumerate their mitigations in Leaf 0x80000008.EBX
+            const bool has_intel_ibrs = (l7_edx & (1 << 26)) != 0;
+            const bool has_intel_stibp = (l7_edx & (1 << 27)) != 0;
+            const bool has_intel_ssbd = (l7_edx & (1 << 31)) != 0;
+
+            if (has_intel_ibrs || has_intel_stibp || has_intel_ssbd) {
+                return true;
+            }
+        }
+
+        return false;
+    #endif
+    }
+                
+                
+    /**
+     * @brief Check for Intel KGT (Trusty branch) hypervisor signature in CPUID
+     * @link https://github.com/intel/ikgt-core/blob/7dfd4d1614d788ec43b02602cce7a272ef8d5931/vmm/vmexit/vmexit_cpuid.c
+     * @category x86
+     * @implements VM::KGT_SIGNATURE
+     */
+    [[nodiscard]] static bool intel_kgt_signature() {
+    #if (!x86)
+        return false;
+    #else
+        u32 unused, ecx, edx = 0;
+        cpu::cpuid(unused, unused, ecx, edx, 0x40000003);
+
+        constexpr u32 ECX_SIG = 0x4D4D5645u; // 'EVMM' -> 0x4D4D5645
+        constexpr u32 EDX_SIG = 0x43544E49u; // 'INTC' -> 0x43544E49
+
+        if (ecx == ECX_SIG && edx == EDX_SIG) {
+            return core::add(brand_enum::INTEL_KGT);
+        }
+
+        return false;
+    #endif
+    }
+
+
+    /**
+     * @brief Check for timing anomalies in the system
+     * @category x86, Windows
+     * @implements VM::TIMER
+     */
+    [[nodiscard]] static bool timer() {
+    #if (x86 && WINDOWS)
+        // Detect a hypervisor without giving it time to react (when the hypervisor sees the vmexit, it's already too late for it, as the counter already exceeded the threshold)
+        // Uses our own software-based clock, meaning a hypervisor can't hide time by offsetting TSC or controlling any hardware timer
+        double threshold = 4.0;
+        if (util::is_running_under_translator()) {
+            debug("TIMER: Running inside a binary translation layer");
+            return false;
+        }
+        if (util::hyper_x() != HYPERV_UNKNOWN) {
+            threshold = 15.0;
+        }
+
+        // prevent false sharing when triggering hypervisor exits with the intentional data race condition
+        struct alignas(64) cache_state {
+            alignas(64) volatile u64 counter { 0 };
+            alignas(64) std::atomic<bool> start_test{ false };
+            alignas(64) std::atomic<bool> test_done{ false };
+        };
+
+        // Shared state and results
+        cache_state state;
+        bool hypervisor_detected = false;
+        bool bypass_detected = false;
+
+        // we dont use cpu::cpuid on purpose
+        auto trigger_vmexit = [](i32* info, i32 leaf, i32 sub) {
+        #if (GCC || CLANG)
+            __asm__ volatile (
+                "cpuid"
+                : "=a"(info[0]), "=b"(info[1]), "=c"(info[2]), "=d"(info[3])
+                : "a"(leaf), "c"(sub)
+                : "cc", "memory"
+                );
+        #else
+            __cpuidex(info, leaf, sub);
+        #endif
+        };
+
+        auto counter_thread = [&state]() {
+            const HANDLE current_thread = reinterpret_cast<HANDLE>(-2LL);
+            const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
+
+            // search for the physical sibling of CPU 0, then pick a random CPU excluding it to avoid SMT locks
+            DWORD_PTR procMask = 0, sysMask = 0;
+            GetProcessAffinityMask(current_process, &procMask, &sysMask);
+
+            DWORD len = 0;
+            GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &len);
+
+            BYTE stackBuf[1024]{};
+            BYTE* buf = stackBuf;
+
+            std::vector<BYTE> heapBuf;
+            if (len > sizeof(stackBuf)) {
+                heapBuf.resize(len);
+                buf = heapBuf.data();
+            }
+
+            GetLogicalProcessorInformationEx(RelationProcessorCore,
+                reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buf), &len);
+
+            DWORD_PTR cpu0CoreMask = 0;
+            for (BYTE* p = buf; p < buf + len; ) {
+                const auto* r = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(p);
+                if (r->Relationship == RelationProcessorCore) {
+                    for (WORD i = 0; i < r->Processor.GroupCount; ++i) {
+                        const auto& m = r->Processor.GroupMask[i];
+                        if (m.Group == 0 && (m.Mask & 1)) cpu0CoreMask |= m.Mask;
+                    }
+                }
+                p += r->Size;
+            }
+
+            const DWORD_PTR choices = procMask & ~cpu0CoreMask;
+
+            DWORD idxs[64]{}, n = 0;
+            for (DWORD i = 0; i < 64; ++i)
+                if (choices & (1ull << i)) idxs[n++] = i;
+
+            if (n) {
+                // random so that the hypervisor doesn't know where the counter thread is
+                // this will affect latency if cache lines from trigger_thread and counter_thread are separated
+                // however, we do a ratio based detection, so this wont affect the detection accuracy because the cache latency affects both samples
+                std::mt19937 gen(std::random_device{}());
+                const u32 cpu = idxs[std::uniform_int_distribution<u32>(0, n - 1)(gen)];
+                SetThreadAffinityMask(current_thread, 1ull << cpu);
+            }
+            SetThreadPriority(current_thread, THREAD_PRIORITY_HIGHEST); // decrease chance of being rescheduled
+
+            while (!state.start_test.load(std::memory_order_acquire)) {}
+
+            while (!state.test_done.load(std::memory_order_relaxed)) {
+            #if (GCC || CLANG)
+                #if (x86_64)
+                // A single incq is enough. Unrolling for example 8 times on a volatile memory address 
+                // creates unpredictable store-buffer behavior and we want it stable, latency is aprox 1 cycle in all microarchs
+                    __asm__ volatile ("incq %0\n\t" : "+m" (state.counter) : : "cc", "memory");
+                #else
+                    __asm__ volatile (
+                        "addl $1, %0; adcl $0, %1\n\t"
+                        : "+m" (((u32*)&state.counter)[0]), "+m" (((u32*)&state.counter)[1])
+                        : : "cc", "memory");
+                #endif
+            #else
+                state.counter++;
+            #endif
+            }
+        };
+
+        auto trigger_thread = [&]() {
+            auto calculate_latency = [&](const std::vector<u64>& samples_in) -> u64 {
+                if (samples_in.empty()) return 0;
+                const size_t N = samples_in.size();
+                if (N == 1) return samples_in[0];
+
+                // local sorted copy
+                std::vector<u64> s = samples_in;
+                std::sort(s.begin(), s.end()); // ascending
+
+                // tiny-sample short-circuits
+                if (N <= 4) return s.front();
+
+                // median (and works for sorted input)
+                auto median_of_sorted = [](const std::vector<u64>& v, size_t lo, size_t hi) -> u64 {
+                    // this is the median of v[lo..hi-1], requires 0 <= lo < hi
+                    const size_t len = hi - lo;
+                    if (len == 0) return 0;
+                    const size_t mid = lo + (len / 2);
+                    if (len & 1) return v[mid];
+                    return (v[mid - 1] + v[mid]) / 2;
+                };
+
+                // the robust center: median M and MAD -> approximate sigma
+                const u64 M = median_of_sorted(s, 0, s.size());
+                std::vector<u64> absdev;
+                absdev.reserve(N);
+                for (size_t i = 0; i < N; ++i) {
+                    const u64 d = (s[i] > M) ? (s[i] - M) : (M - s[i]);
+                    absdev.push_back(d);
+                }
+                std::sort(absdev.begin(), absdev.end());
+                const u64 MAD = median_of_sorted(absdev, 0, absdev.size());
+                // convert MAD to an approximate standard-deviation-like measure
+                constexpr long double kmad_to_sigma = 1.4826L; // consistent for normal approx
+                const long double sigma = (MAD == 0) ? 1.0L : (static_cast<long double>(MAD) * kmad_to_sigma);
+
+                // find the densest small-valued cluster by sliding a fixed-count window
+                // this locates the most concentrated group of samples (likely it would be the true VMEXIT cluster)
+                // const size_t frac_win = (N * 8 + 99) / 100; // ceil(N * 0.08)
+                // const size_t win = std::min(N, std::max(MIN_WIN, frac_win));
+                const size_t MIN_WIN = 10;
+                // manual min/max calculation for win size
+                const size_t calc_frac = static_cast<size_t>(std::ceil(static_cast<double>(N) * 0.08));
+                const size_t inner_max = (MIN_WIN > calc_frac) ? MIN_WIN : calc_frac;
+                const size_t win = (N < inner_max) ? N : inner_max;
+
+                size_t best_i = 0;
+                u64 best_span = (s.back() - s.front()) + 1; // large initial
+                for (size_t i = 0; i + win <= N; ++i) {
+                    const u64 span = s[i + win - 1] - s[i];
+                    if (span < best_span) {
+                        best_span = span;
+                        best_i = i;
+                    }
+                }
+
+                // expand the initial window greedily while staying "tight"
+                // allow expansion while adding samples does not more than multiply the span by EXPAND_FACTOR
+                constexpr long double EXPAND_FACTOR = 1.5L;
+                size_t cluster_lo = best_i;
+                size_t cluster_hi = best_i + win; // exclusive
+                // expand left
+                while (cluster_lo > 0) {
+                    const u64 new_span = s[cluster_hi - 1] - s[cluster_lo - 1];
+                    if (static_cast<long double>(new_span) <= EXPAND_FACTOR * static_cast<long double>(best_span) ||
+                        (s[cluster_hi - 1] <= (s[cluster_lo - 1] + static_cast<u64>(std::ceil(3.0L * sigma))))) {
+                        --cluster_lo;
+                        // manual min calculation
+                        best_span = (best_span < new_span) ? best_span : new_span;
+                    }
+                    else break;
+                }
+                // expand right
+                while (cluster_hi < N) {
+                    const u64 new_span = s[cluster_hi] - s[cluster_lo];
+                    if (static_cast<long double>(new_span) <= EXPAND_FACTOR * static_cast<long double>(best_span) ||
+                        (s[cluster_hi] <= (s[cluster_lo] + static_cast<u64>(std::ceil(3.0L * sigma))))) {
+                        ++cluster_hi;
+                        best_span = (best_span < new_span) ? best_span : new_span;
+                    }
+                    else break;
+                }
+
+                const size_t cluster_size = (cluster_hi > cluster_lo) ? (cluster_hi - cluster_lo) : 0;
+
+                // cluster must be reasonably dense and cover a non-negligible portion of samples, so this is pure sanity checks
+                const double fraction_in_cluster = static_cast<double>(cluster_size) / static_cast<double>(N);
+
+                // min/max calculation for MIN_CLUSTER
+                const int val_n_50 = static_cast<int>(N / 50);
+                const size_t val_max = static_cast<size_t>((5 > val_n_50) ? 5 : val_n_50);
+                const size_t MIN_CLUSTER = (val_max < N) ? val_max : N; // at least 2% or 5 elements
+
+                if (cluster_size < MIN_CLUSTER || fraction_in_cluster < 0.02) {
+                    // low-percentile (10th) trimmed median
+                    // Manual max calculation for fallback_count
+                    const size_t floor_val = static_cast<size_t>(std::floor(static_cast<double>(N) * 0.10));
+                    const size_t fallback_count = (1 > floor_val) ? 1 : floor_val;
+
+                    // median of lowest fallback_count elements (if fallback_count==1 that's smallest)
+                    if (fallback_count == 1) return s.front();
+                    const size_t mid = fallback_count / 2;
+                    if (fallback_count & 1) return s[mid];
+                    return (s[mid - 1] + s[mid]) / 2;
+                }
+
+                // now we try to get a robust estimate inside the cluster, trimmed mean (10% trim) centered on cluster
+                const size_t trim_count = static_cast<size_t>(std::floor(static_cast<double>(cluster_size) * 0.10));
+                const size_t lo = cluster_lo + trim_count;
+                const size_t hi = cluster_hi - trim_count; // exclusive
+                if (hi <= lo) {
+                    // degenerate -> median of cluster
+                    return median_of_sorted(s, cluster_lo, cluster_hi);
+                }
+
+                // sum with long double to avoid overflow and better rounding
+                long double sum = 0.0L;
+                for (size_t i = lo; i < hi; ++i) sum += static_cast<long double>(s[i]);
+                const long double avg = sum / static_cast<long double>(hi - lo);
+                u64 result = static_cast<u64>(std::llround(avg));
+
+                // final sanity adjustments:
+                // if the computed result is suspiciously far from the global median (e.g., > +6*sigma)
+                // clamp toward the median to avoid choosing a high noisy cluster by mistake
+                const long double diff_from_med = static_cast<long double>(result) - static_cast<long double>(M);
+                if (diff_from_med > 0 && diff_from_med > (6.0L * sigma)) {
+                    // clamp to median + 4*sigma (conservative)
+                    result = static_cast<u64>(std::llround(static_cast<long double>(M) + 4.0L * sigma));
+                }
+
+                // also, if result is zero (shouldn't be) or extremely small, return a smallest observed sample
+                if (result == 0) result = s.front();
+
+                return result;
+            };
+
+            const HANDLE current_thread = reinterpret_cast<HANDLE>(-2LL);
+            const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
+            SetThreadAffinityMask(current_thread, 1);
+            SetPriorityClass(current_process, ABOVE_NORMAL_PRIORITY_CLASS); // ABOVE_NORMAL_PRIORITY_CLASS + THREAD_PRIORITY_HIGHEST = 12 base priority
+            SetThreadPriority(current_thread, THREAD_PRIORITY_HIGHEST);
+
+            // so that hypervisor can't predict how many samples we will collect
+            std::mt19937 gen(std::random_device{}());
+            std::uniform_int_distribution<size_t> batch_dist(30000, 70000);
+            const size_t BATCH_SIZE = batch_dist(gen);
+            i32 dummy_res[4]{};
+            std::vector<u64> vm_samples(BATCH_SIZE), ref_samples(BATCH_SIZE); // pre page-fault MMU, wwe wont warm-up cpuid samples for the P-states intentionally
+
+            state.start_test.store(true, std::memory_order_release); // _mm_pause can be exited conditionally, spam hit L3.
+            while (state.counter == 0) {}
+
+            size_t valid = 0;
+            while (valid < BATCH_SIZE) {
+                // interpolated so that any turbo boost, thermal throttling, speculation (for the loop overhead itself, not for the serializing instructions), etc affects both samples
+                u64 v_pre, v_post, r_pre, r_post, sync;
+
+                sync = state.counter; while (state.counter == sync); // infer if counter got enough quantum momentum (so its currently scheduled)
+                sync = state.counter; while (state.counter == sync); // fastest busy-waiting strategy, PAUSE affects cache, calling APIs like SwitchToThread() would be even worse
+
+                v_pre = state.counter;
+                std::atomic_signal_fence(std::memory_order_seq_cst); // _ReadWriteBarrier() aka dont emit runtime fences
+                // force cpuid collection here so that the hypervisor is either forced to disable interception and try to bypass latency, or intercept cpuid and try to bypass XSAVE states
+                trigger_vmexit(dummy_res, 0, 0);
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+                v_post = state.counter;
+
+                sync = state.counter; while (state.counter == sync); // sync to our counter tick again
+                sync = state.counter; while (state.counter == sync);
+
+                r_pre = state.counter;
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+                for (int i = 0; i < 8; ++i) _mm_lfence(); // 8 LFENCES is enough for the MESI RFO cache bounce in the data race (so that the counter thread sees an increment)
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+                r_post = state.counter;
+
+                // we dont filter by cycles spent here (for example by querying thread cycle time) because the point of this function is to not let either the kernel or this app handle a TSC read
+                if (v_post > v_pre && r_post > r_pre) {
+                    vm_samples[valid] = v_post - v_pre;
+                    ref_samples[valid] = r_post - r_pre;
+                    valid++;
+                }
+            }
+
+            const u64 cpuid_l = calculate_latency(vm_samples); // check for lowest dense cluster with no interrupt spikes, filter noise we can detect (SMIs, etc)
+            const u64 ref_l = calculate_latency(ref_samples);
+            const double ratio = ref_l ? (double)cpuid_l / (double)ref_l : 0;
+
+            debug("TIMER: CPUID -> ", cpuid_l, " | Ref -> ",  ref_l, " | Ratio -> ", ratio);
+
+            if (ratio >= threshold) hypervisor_detected = true;
+
+            // Now detect bypassers letting the VM boot with cpuid interception, and then disabling interception with SVM by flipping bit 18 in the VMCB 
+            // if hypervisor lies about the CPU vendor, it will create 100000 more detectable signals (querying intel-specific behavior)
+            if (cpu::is_amd()) {
+                i32 res_d0[4], res_d1[4], res_d12[4], res_ext[4];
+                trigger_vmexit(res_d0, 0xD, 0);
+                trigger_vmexit(res_d1, 0xD, 1);
+                trigger_vmexit(res_d12, 0xD, 12);
+                trigger_vmexit(res_ext, 0x80000008, 0);
+
+                const bool hardware_supports_cet = (res_d12[0] > 0);
+                const u32 active_xcr0_size = (u32)res_d0[1];
+                const u32 active_total_size = (u32)res_d1[1];
+
+                if (hardware_supports_cet && (active_total_size == active_xcr0_size)) {
+                    debug("TIMER: VMAware detected a SVM hypervisor with cpuid interception disabled, score was raised up due to a bypass attempt.");
+                    bypass_detected = true;
+                }
+            }
+
+            SetPriorityClass(current_process, NORMAL_PRIORITY_CLASS);
+            state.test_done.store(true, std::memory_order_release);
+        };
+
+        std::thread t1(counter_thread);
+        std::thread t2(trigger_thread);
+
+        t1.join();
+        t2.join();
+
+        if (hypervisor_detected) {
+            return true; // 100 score
+        }
+        else if (bypass_detected) {
+            return core::add(brand_enum::KVM, 150); // 150 score, KVM is a guess
+        }
+
+        return hypervisor_detected;
+#endif
+        return false;
+    }
+
+#if (LINUX)
+    /**
+     * @brief Check if systemd-detect-virt would report anything other than "none", without running it
+     * @author logic from https://github.com/systemd/systemd/blob/main/src/basic/virt.c
+     * @category Linux
+     * @implements VM::SYSTEMD
+     */
+    [[nodiscard]] static bool systemd_virt() {
+        std::string buffer;
+        const std::shared_ptr<const util::sys_snapshot> snapshot = util::sys_snapshot::fetch();
+
+        // containers first, same order as detect_container()
+        if (util::exists("/proc/vz") && !util::exists("/proc/bc")) {
+            debug("SYSTEMD: ", "openvz");
+            return true;
+        }
+
+        const util::text_view osrelease = snapshot->view(util::sys_snapshot::OSRELEASE);
+        if (osrelease.contains("Microsoft") || osrelease.contains("WSL")) {
+            debug("SYSTEMD: ", "wsl");
+            return true;
+        }
+
+        // the container manager leaves its name for the payload
+        if (!util::read_into("/run/host/container-manager", buffer).empty() || !util::read_into("/run/systemd/container", buffer).empty()) {
+            debug("SYSTEMD: ", "container manager = ", buffer);
+            return true;
+        }
+
+        if (util::exists("/run/.containerenv") || util::exists("/.dockerenv")) {
+            debug("SYSTEMD: ", "podman or docker");
+            return true;
+        }
+
+        // a non-empty container= variable in the environment of PID 1, only readable by root
+        const util::text_view environment = util::read_into("/proc/1/environ", buffer);
+        const char* const environment_end = environment.data + environment.size;
+
+        for (const char* entry = environment.data; entry < environment_end; entry += std::strlen(entry) + 1) {
+            if (std::strncmp(entry, "container=", 10) == 0 && entry[10] != '\0') {
+                debug("SYSTEMD: ", "PID 1 ", entry);
+                return true;
+            }
+        }
+
+        // everything Xen points to is the host itself in dom0, which is reported as "none"
+        const bool xen_dom0 = util::read_into("/proc/xen/capabilities", buffer).contains("control_d");
+
+    #if (x86)
+        // any hypervisor vendor counts, unknown ones are reported as "vm-other"
+        u32 eax = 0, ebx = 0, ecx = 0, edx = 0;
+        cpu::cpuid(eax, ebx, ecx, edx, 1);
+
+        if ((ecx & (1u << 31)) && util::hyper_x() != HYPERV_ARTIFACT_VM) {
+            const std::string vendor = cpu::cpu_manufacturer(cpu::leaf::hypervisor);
+
+            if (!(xen_dom0 && vendor == "XenVMMXenVMM")) {
+                debug("SYSTEMD: ", "cpuid vendor = ", vendor);
+                return true;
+            }
+        }
+    #endif
+
+        // DMI vendors are matched by prefix, EC2 instances also need the SMBIOS VM bit to tell them apart from bare-metal ones
+        constexpr std::array<const char*, 17> dmi_vendors{ {
+            "KVM", "OpenStack", "KubeVirt", "QEMU", "VMware", "VMW", "innotek GmbH", "VirtualBox",
+            "Oracle Corporation", "Xen", "Bochs", "Parallels", "BHYVE", "Hyper-V", "Apple Virtualization",
+            "Google Compute Engine", "Amazon EC2"
+        } };
+
+        constexpr std::array<util::smbios::field, 4> dmi_fields{ {
+            util::smbios::PRODUCT_NAME,
+            util::smbios::SYS_VENDOR,
+            util::smbios::BOARD_VENDOR,
+            util::smbios::BIOS_VENDOR
+        } };
+
+        const std::shared_ptr<const util::smbios> info = util::smbios::fetch();
+
+        for (const auto field : dmi_fields) {
+            const util::text_view value = info->view(field);
+
+            for (const char* vendor : dmi_vendors) {
+                if (!value.starts_with(vendor)) {
+                    continue;
+                }
+
+                if (std::strcmp(vendor, "Amazon EC2") == 0 && !info->vm_bit) {
+                    continue;
+                }
+
+                if (xen_dom0 && std::strcmp(vendor, "Xen") == 0) {
+                    continue;
+                }
+
+                debug("SYSTEMD: ", "DMI vendor = ", vendor);
+                return true;
+            }
+        }
+
+        if (!xen_dom0 && (util::exists("/proc/xen") || snapshot->view(util::sys_snapshot::HYPERVISOR_TYPE).starts_with("xen"))) {
+            debug("SYSTEMD: ", "xen");
+            return true;
+        }
+
+        // device tree based platforms announce the hypervisor themselves
+        if (!util::read_into("/proc/device-tree/hypervisor/compatible", buffer).empty()) {
+            debug("SYSTEMD: ", "device tree hypervisor = ", buffer.c_str());
+            return true;
+        }
+
+        if (util::read_into("/proc/cpuinfo", buffer).contains("User Mode Linux")) {
+            debug("SYSTEMD: ", "uml");
+            return true;
+        }
+
+        if (snapshot->view(util::sys_snapshot::SYSINFO).contains("VM00 Control Program")) {
+            debug("SYSTEMD: ", "zvm");
+            return true;
+        }
+
+        return false;
+    }
+
+
+    /**
+     * @brief Check if the chassis vendor is a VM vendor
+     * @category Linux
+     * @implements VM::CVENDOR
+     */
+    [[nodiscard]] static bool chassis_vendor() {
+        const util::text_view vendor = util::smbios::fetch()->view(util::smbios::CHASSIS_VENDOR);
+
+        if (vendor.empty()) {
+            debug("CVENDOR: ", "no chassis manufacturer");
+            return false;
+        }
+
+        // TODO: More can definitely be added, only QEMU and VBox were tested so far
+        if (vendor.contains("QEMU")) { return core::add(brand_enum::QEMU); }
+        if (vendor.contains("Oracle Corporation")) { return core::add(brand_enum::VBOX); }
+
+        debug("CVENDOR: vendor = ", vendor.data);
+
+        return false;
+    }
+
+
+    /**
+     * @brief Check if the chassis type is valid (it's very often invalid in VMs)
+     * @category Linux
+     * @implements VM::CTYPE
+     */
+    [[nodiscard]] static bool chassis_type() {
+        const std::shared_ptr<const util::smbios> info = util::smbios::fetch();
+
+        if (info->chassis_type == 0) {
+            debug("CTYPE: ", "no chassis type in the SMBIOS data");
+            return false;
+        }
+
+        // 1 is "Other"
+        return (info->chassis_type == 1);
+    }
+
+
+    /**
+     * @brief Check if /.dockerenv or /.dockerinit file is present
+     * @category Linux
+     * @implements VM::DOCKERENV
+     */
+    [[nodiscard]] static bool dockerenv() {
+        if (util::exists("/.dockerenv") || util::exists("/.dockerinit")) {
+            return core::add(brand_enum::DOCKER);
+        }
+
+        return false;
+    }
+
+
+    /**
+     * @brief Check if dmidecode output matches a VM brand
+     * @category Linux
+     * @warning Permissions required
+     * @note The manufacturer is also one of the fields VM::DMI_SCAN matches, so a QEMU, 
+     *       VirtualBox or KVM manufacturer is scored by both techniques, as it was with dmidecode
+     * @implements VM::DMIDECODE
+     */
+    [[nodiscard]] static bool dmidecode() {
+        if (!util::is_admin()) {
+            debug("DMIDECODE: ", "precondition return called (root = ", util::is_admin(), ")");
+            return false;
+        }
+
+        // the manufacturer and product name of the system information structure (type 1)
+        const std::shared_ptr<const util::smbios> info = util::smbios::fetch();
+        const util::text_view manufacturer = info->view(util::smbios::SYS_VENDOR);
+        const util::text_view product = info->view(util::smbios::PRODUCT_NAME);
+
+        auto mentions = [&](const char* keyword) -> bool {
+            return (manufacturer.contains(keyword) || product.contains(keyword));
+        };
+
+        if (mentions("QEMU")) {
+            return core::add(brand_enum::QEMU);
+        } else if (mentions("VirtualBox")) {
+            return core::add(brand_enum::VBOX);
+        } else if (mentions("KVM")) {
+            return core::add(brand_enum::KVM);
+        }
+
+        debug("DMIDECODE: ", "manufacturer = ", info->fields[util::smbios::SYS_VENDOR], ", product = ", info->fields[util::smbios::PRODUCT_NAME]);
+
+        return false;
+    }
+
+
+    /**
+     * @brief Check if mac address starts with certain VM designated values
+     * @category Linux
+     * @implements VM::MAC
+     */
+    [[nodiscard]] static bool mac_address_check() {
+        struct fdguard {
+            int fd;
+            explicit fdguard(int fd = -1) : fd(fd) {}
+            ~fdguard() { if (fd != -1) ::close(fd); }
+            int get() const { return fd; }
+            int release() { int tmp = fd; fd = -1; return tmp; }
+        };
+
+        u8 mac[6] = { 0 };
+        struct ifreq ifr;
+        struct ifconf ifc;
+        char buf[1024];
+        int success = 0;
+
+        int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+        if (sock == -1) {
+            return false;
+        }
+        fdguard sockGuard(sock); // will close on function exit
+
+        ifc.ifc_len = sizeof(buf);
+        ifc.ifc_buf = buf;
+
+        if (ioctl(sockGuard.get(), SIOCGIFCONF, &ifc) == -1) {
+            return false;
+        }
+
+        struct ifreq* it = ifc.ifc_req;
+        const struct ifreq* end = it + (ifc.ifc_len / sizeof(struct ifreq));
+
+        for (; it != end; ++it) {
+            std::size_t name_len = std::min<std::size_t>(sizeof(ifr.ifr_name) - 1, strlen(it->ifr_name));
+            std::memcpy(ifr.ifr_name, it->ifr_name, name_len);
+            ifr.ifr_name[name_len] = '\0';
+
+            if (ioctl(sockGuard.get(), SIOCGIFFLAGS, &ifr) != 0) {
+                return false;
+            }
+
+            if (!(ifr.ifr_flags & IFF_LOOPBACK)) {
+                if (ioctl(sockGuard.get(), SIOCGIFHWADDR, &ifr) == 0) {
+                    success = 1;
+                    break;
+                }
+            }
+        }
+
+        if (success) {
+            std::memcpy(mac, ifr.ifr_hwaddr.sa_data, 6);
+        }
+        else {
+            debug("MAC: ", "not successful");
+        }
+
+    #ifdef __VMAWARE_DEBUG__
+        {
+            std::stringstream ss;
+            ss << std::hex << std::setw(2) << std::setfill('0')
+                << static_cast<int>(mac[0]) << ":"
                 << static_cast<int>(mac[1]) << ":"
                 << static_cast<int>(mac[2]) << ":XX:XX:XX";
             debug("MAC: ", ss.str());
@@ -5879,38 +7917,27 @@ public:
      * @implements VM::DMESG
      */
     [[nodiscard]] static bool dmesg() {
-    #if (VMA_CPP <= 11)
-        return false;
-    #else
         if (!util::is_admin()) {
             return false;
         }
 
-        if (!util::exists("/bin/dmesg") && !util::exists("/usr/bin/dmesg")) {
-            debug("DMESG: ", "binary doesn't exist");
-            return false;
-        }
+        // hypervisor related lines mentioning KVM or QEMU
+        const std::shared_ptr<const util::kernel_log> log = util::kernel_log::fetch();
 
-        const std::unique_ptr<std::string> result = util::sys_result("dmesg | grep -i hypervisor | grep -c \"KVM|QEMU\"");
-
-        if (!result || result->empty()) {
+        if (!log->available) {
+            debug("DMESG: ", "kernel log isn't readable");
             return false;
         }
-        else if (*result == "KVM") {
+
+        if (log->has(util::kernel_log::HYPERVISOR_KVM)) {
             return core::add(brand_enum::KVM);
         }
-        else if (*result == "QEMU") {
+
+        if (log->has(util::kernel_log::HYPERVISOR_QEMU)) {
             return core::add(brand_enum::QEMU);
         }
-        else if (std::atoi(result->c_str())) {
-            return true;
-        }
-        else {
-            debug("DMESG: ", "output = ", *result);
-        }
 
         return false;
-    #endif
     }
 
 
@@ -5959,9 +7986,9 @@ public:
      * @implements VM::VMWARE_IOMEM
      */
     [[nodiscard]] static bool vmware_iomem() {
-        const std::string iomem_file = util::read_file("/proc/iomem");
+        const std::shared_ptr<const util::sys_snapshot> snapshot = util::sys_snapshot::fetch();
 
-        if (util::find(iomem_file, "VMware")) {
+        if (snapshot->view(util::sys_snapshot::IOMEM).contains("VMware")) {
             return core::add(brand_enum::VMWARE);
         }
 
@@ -6023,19 +8050,19 @@ public:
 
         u64 result = 0;
 
-        const std::string msr_device = "/dev/cpu/0/msr";
-        std::ifstream msr_file(msr_device, std::ios::binary);
+        // the msr device maps the register index to the file offset
+        const int fd = open("/dev/cpu/0/msr", O_RDONLY | O_CLOEXEC);
 
-        if (!msr_file.is_open()) {
+        if (fd < 0) {
             debug("AMD_SEV: unable to open MSR file");
             return false;
         }
 
-        msr_file.seekg(msr_index);
-        msr_file.read(reinterpret_cast<char*>(&result), sizeof(result));
+        const ssize_t bytes = pread(fd, &result, sizeof(result), msr_index);
+        close(fd);
 
-        if (!msr_file) {
-            debug("AMD_SEV: unable to open MSR file");
+        if (bytes != static_cast<ssize_t>(sizeof(result))) {
+            debug("AMD_SEV: unable to read MSR file");
             return false;
         }
 
@@ -6056,19 +8083,15 @@ public:
      * @implements VM::QEMU_VIRTUAL_DMI
      */
     [[nodiscard]] static bool qemu_virtual_dmi() {
-        const char* sys_vendor = "/sys/devices/virtual/dmi/id/sys_vendor";
-        const char* modalias = "/sys/devices/virtual/dmi/id/modalias";
+        const std::shared_ptr<const util::sys_snapshot> snapshot = util::sys_snapshot::fetch();
 
         if (
-            util::exists(sys_vendor) &&
-            util::exists(modalias)
+            snapshot->exists(util::sys_snapshot::SYS_VENDOR) &&
+            snapshot->exists(util::sys_snapshot::MODALIAS)
         ) {
-            const std::string sys_vendor_str = util::read_file(sys_vendor);
-            const std::string modalias_str = util::read_file(modalias);
-
             if (
-                util::find(sys_vendor_str, "QEMU") &&
-                util::find(modalias_str, "QEMU")
+                snapshot->view(util::sys_snapshot::SYS_VENDOR).contains("QEMU") &&
+                snapshot->view(util::sys_snapshot::MODALIAS).contains("QEMU")
             ) {
                 return core::add(brand_enum::QEMU);
             }
@@ -6089,21 +8112,10 @@ public:
             return false;
         }
 
-        constexpr const char* usb_path = "/sys/kernel/debug/usb/devices";
-
-        std::ifstream file(usb_path);
-        if (!file) {
-            return false;
-        }
-
-        std::string line;
-        while (std::getline(file, line)) {
-            if (line.find("QEMU") != std::string::npos) {
-                return true;
-            }
-        }
+        std::string buffer;
+        const util::text_view devices = util::read_into("/sys/kernel/debug/usb/devices", buffer);
 
-        return false;
+        return devices.contains("QEMU");
     }
 
 
@@ -6136,15 +8148,12 @@ public:
 
         closedir(dir);
 
-        bool type = false;
+        const std::shared_ptr<const util::sys_snapshot> snapshot = util::sys_snapshot::fetch();
 
-        if (util::exists("/sys/hypervisor/type")) {
-            type = true;
-        }
+        const bool type = snapshot->exists(util::sys_snapshot::HYPERVISOR_TYPE);
 
         if (type) {
-            const std::string content = util::read_file("/sys/hypervisor/type");
-            if (util::find(content, "xen")) {
+            if (snapshot->view(util::sys_snapshot::HYPERVISOR_TYPE).contains("xen")) {
                 return core::add(brand_enum::XEN);
             }
         }
@@ -6162,79 +8171,36 @@ public:
      */
     [[nodiscard]] static bool uml_cpu() {
         // method 1, get the CPU brand model
-        const std::string brand = cpu::get_brand();
+        const std::string& brand = cpu::get_identity().brand;
 
         if (brand == "UML") {
             return core::add(brand_enum::UML);
         }
 
-        // method 2, match for the "User Mode Linux" string in /proc/cpuinfo
-        const char* file = "/proc/cpuinfo";
-
-        if (util::exists(file)) {
-            const std::string file_content = util::read_file(file);
-
-            if (util::find(file_content, "User Mode Linux")) {
-                return core::add(brand_enum::UML);
-            }
-        }
-
-        return false;
-    } 
-
-
-    /**
-     * @brief Check for any indications of hypervisors in the kernel message logs
-     * @author idea from https://github.com/ShellCode33/VM-Detection/blob/master/vmdetect/linux.go
-     * @category Linux
-     * @warning Permissions required
-     * @implements VM::KMSG
-     */
-    [[nodiscard]] static bool kmsg() {
-        if (!util::is_admin()) {
-            return false;
-        }
-
-        int fd = open("/dev/kmsg", O_RDONLY | O_NONBLOCK);
-        if (fd < 0) {
-            debug("KMSG: Failed to open /dev/kmsg");
-            return false;
-        }
-
-        char buffer[1024];
-        std::stringstream ss;
-
-        while (true) {
-            ssize_t bytes_read = read(fd, buffer, sizeof(buffer) - 1);
-
-            if (bytes_read > 0) {
-                buffer[bytes_read] = '\0';
-                ss << buffer;
-            } else if (bytes_read == 0) {
-                usleep(100000); // Sleep for 100 milliseconds
-            } else {
-                if (errno == EAGAIN) {
-                    usleep(100000);
-                } else {
-                    debug("KMSG: Error reading /dev/kmsg");
-                    break;
-                }
-            }
+        // method 2, match for the "User Mode Linux" string in /proc/cpuinfo
+        std::string buffer;
 
-            if (bytes_read < 0) {
-                break;
-            }
+        if (util::read_into("/proc/cpuinfo", buffer).contains("User Mode Linux")) {
+            return core::add(brand_enum::UML);
         }
 
-        close(fd);
+        return false;
+    } 
 
-        const std::string content = ss.str();
 
-        if (content.empty()) {
+    /**
+     * @brief Check for any indications of hypervisors in the kernel message logs
+     * @author idea from https://github.com/ShellCode33/VM-Detection/blob/master/vmdetect/linux.go
+     * @category Linux
+     * @warning Permissions required
+     * @implements VM::KMSG
+     */
+    [[nodiscard]] static bool kmsg() {
+        if (!util::is_admin()) {
             return false;
         }
 
-        return (util::find(content, "Hypervisor detected"));
+        return util::kernel_log::fetch()->has(util::kernel_log::HYPERVISOR_DETECTED);
     } 
 
 
@@ -6245,15 +8211,13 @@ public:
      * @implements VM::VBOX_MODULE
      */
     [[nodiscard]] static bool vbox_module() {
-        const char* file = "/proc/modules";
+        const std::shared_ptr<const util::sys_snapshot> snapshot = util::sys_snapshot::fetch();
 
-        if (!util::exists(file)) {
+        if (!snapshot->exists(util::sys_snapshot::MODULES)) {
             return false;
         }
 
-        const std::string content = util::read_file(file);
-
-        if (util::find(content, "vboxguest")) {
+        if (snapshot->view(util::sys_snapshot::MODULES).contains("vboxguest")) {
             return core::add(brand_enum::VBOX);
         }
 
@@ -6268,9 +8232,9 @@ public:
      * @implements VM::VMWARE_SCSI
      */
     [[nodiscard]] static bool vmware_scsi() {
-        const std::string scsi_file = util::read_file("/proc/scsi/scsi");
+        const std::shared_ptr<const util::sys_snapshot> snapshot = util::sys_snapshot::fetch();
 
-        if (util::find(scsi_file, "VMware")) {
+        if (snapshot->view(util::sys_snapshot::SCSI).contains("VMware")) {
             return core::add(brand_enum::VMWARE);
         }
 
@@ -6291,22 +8255,9 @@ public:
             return false;
         }
 
-        if (!util::exists("/usr/bin/dmesg")) {
-            return false;
-        }
-
-        auto dmesg_output = util::sys_result("dmesg");
-        const std::string dmesg_o = *dmesg_output;
-
-        if (dmesg_o.empty()) {
-            return false;
-        }
-
-        if (util::find(dmesg_o, "BusLogic BT-958")) {
-            return core::add(brand_enum::VMWARE);
-        }
+        const std::shared_ptr<const util::kernel_log> log = util::kernel_log::fetch();
 
-        if (util::find(dmesg_o, "pcnet32")) {
+        if (log->has(util::kernel_log::BUSLOGIC) || log->has(util::kernel_log::PCNET32)) {
             return core::add(brand_enum::VMWARE);
         }
 
@@ -6321,15 +8272,13 @@ public:
      * @implements VM::SYSINFO_PROC
      */
     [[nodiscard]] static bool sysinfo_proc() {
-        const char* file = "/proc/sysinfo";
+        const std::shared_ptr<const util::sys_snapshot> snapshot = util::sys_snapshot::fetch();
 
-        if (!util::exists(file)) {
+        if (!snapshot->exists(util::sys_snapshot::SYSINFO)) {
             return false;
         }
 
-        const std::string content = util::read_file(file);
-
-        if (util::find(content, "VM00")) {
+        if (snapshot->view(util::sys_snapshot::SYSINFO).contains("VM00")) {
             return true;
         }
 
@@ -6350,17 +8299,18 @@ public:
         cat: /sys/class/dmi/id/product_uuid: Permission denied
         */
 
-        constexpr std::array<const char*, 7> dmi_array{
-            "/sys/class/dmi/id/bios_vendor",
-            "/sys/class/dmi/id/board_name",
-            "/sys/class/dmi/id/board_vendor",
-            "/sys/class/dmi/id/chassis_asset_tag",
-            "/sys/class/dmi/id/product_family",
-            "/sys/class/dmi/id/product_sku",
-            "/sys/class/dmi/id/sys_vendor"
-        };
+        // the same fields as /sys/class/dmi/id, which is a symlink to /sys/devices/virtual/dmi/id
+        constexpr std::array<util::smbios::field, 7> dmi_array{ {
+            util::smbios::BIOS_VENDOR,
+            util::smbios::BOARD_NAME,
+            util::smbios::BOARD_VENDOR,
+            util::smbios::CHASSIS_ASSET_TAG,
+            util::smbios::PRODUCT_FAMILY,
+            util::smbios::PRODUCT_SKU,
+            util::smbios::SYS_VENDOR
+        } };
 
-        constexpr std::array<std::pair<const char*, enum brand_enum>, 15> vm_table{ {
+        static constexpr util::pattern vm_table[] = {
             { "kvm", brand_enum::KVM },
             { "openstack", brand_enum::OPENSTACK },
             { "kubevirt", brand_enum::KUBEVIRT },
@@ -6376,40 +8326,30 @@ public:
             { "hyper-v", brand_enum::HYPERV },
             { "apple virtualization", brand_enum::APPLE_VZ },
             { "google compute engine", brand_enum::GCE }
-        } };
+        };
 
+        static const util::pattern_matcher matcher(vm_table, sizeof(vm_table) / sizeof(vm_table[0]), true);
+        static const u64 aws_nitro = matcher.mask(brand_enum::AWS_NITRO);
 
-        for (const auto file : dmi_array) {
-            if (!util::exists(file)) {
-                continue;
-            }
 
-            std::string content = util::read_file(file);
+        const std::shared_ptr<const util::smbios> info = util::smbios::fetch();
+
+        for (const auto field : dmi_array) {
+            const util::text_view content = info->view(field);
             if (content.empty()) {
                 continue;
             }
-            char* data = &content[0];
-            const size_t len = content.size();
-            for (size_t i = 0; i < len; ++i) {
-                if (data[i] >= 'A' && data[i] <= 'Z') {
-                    data[i] |= 0x20;
-                }
-            }
 
-            for (const auto& vm_string : vm_table) {
-                if (content.find(vm_string.first) != std::string::npos) {
+            const util::pattern* hit = matcher.find(content.data, content.size);
 
-                    debug("DMI_SCAN: content = ", content);
+            // "amazon ec2" only counts with the SMBIOS VM bit, otherwise it's an EC2 bare metal host
+            if (hit != nullptr && hit->brand == brand_enum::AWS_NITRO && !smbios_vm_bit()) {
+                hit = matcher.find(content.data, content.size, aws_nitro);
+            }
 
-                    if (vm_string.second == brand_enum::AWS_NITRO) {
-                        if (smbios_vm_bit()) {
-                            return core::add(brand_enum::AWS_NITRO);
-                        }
-                    }
-                    else {
-                        return core::add(vm_string.second);
-                    }
-                }
+            if (hit != nullptr) {
+                debug("DMI_SCAN: content = ", content.data);
+                return core::add(hit->brand);
             }
         }
 
@@ -6429,22 +8369,14 @@ public:
             return false;
         }
 
-        const char* file = "/sys/firmware/dmi/entries/0-0/raw";
-
-        if (!util::exists(file)) {
-            return false;
-        }
-
-        const std::vector<u8> content = util::read_file_binary(file);
+        const std::shared_ptr<const util::smbios> info = util::smbios::fetch();
 
-        if (content.size() < 20 || content.at(1) < 20) {
-            debug("SMBIOS_VM_BIT: ", "only read ", content.size(), " bytes, expected 20");
+        if (!info->has_vm_bit) {
+            debug("SMBIOS_VM_BIT: ", "no BIOS characteristics extension byte 2 in the SMBIOS table");
             return false;
         }
 
-        debug("SMBIOS_VM_BIT: ", "content.at(19) = ", static_cast<int>(content.at(19)));
-
-        return (content.at(19) & (1 << 4));
+        return info->vm_bit;
     } 
 
 
@@ -6470,9 +8402,9 @@ public:
      * @implements VM::VMWARE_IOPORTS
      */
     [[nodiscard]] static bool vmware_ioports() {
-        const std::string ioports_file = util::read_file("/proc/ioports");
+        const std::shared_ptr<const util::sys_snapshot> snapshot = util::sys_snapshot::fetch();
     
-        if (util::find(ioports_file, "VMware")) {
+        if (snapshot->view(util::sys_snapshot::IOPORTS).contains("VMware")) {
             return core::add(brand_enum::VMWARE);
         }
     
@@ -6487,19 +8419,18 @@ public:
      * @implements VM::WSL_PROC
      */
     [[nodiscard]] static bool wsl_proc_subdir() {
-        const char* osrelease = "/proc/sys/kernel/osrelease";
-        const char* version = "/proc/version";
+        const std::shared_ptr<const util::sys_snapshot> snapshot = util::sys_snapshot::fetch();
 
         if (
-            util::exists(osrelease) &&
-            util::exists(version)
+            snapshot->exists(util::sys_snapshot::OSRELEASE) &&
+            snapshot->exists(util::sys_snapshot::VERSION)
         ) {
-            const std::string osrelease_content = util::read_file(osrelease);
-            const std::string version_content = util::read_file(version);
+            const util::text_view osrelease_content = snapshot->view(util::sys_snapshot::OSRELEASE);
+            const util::text_view version_content = snapshot->view(util::sys_snapshot::VERSION);
 
             if (
-                (util::find(osrelease_content, "WSL") || util::find(osrelease_content, "Microsoft")) &&
-                (util::find(version_content, "WSL") || util::find(version_content, "Microsoft"))
+                (osrelease_content.contains("WSL") || osrelease_content.contains("Microsoft")) &&
+                (version_content.contains("WSL") || version_content.contains("Microsoft"))
             ) {
                 return core::add(brand_enum::WSL);
             }
@@ -6572,22 +8503,26 @@ public:
      * @implements VM::NSJAIL_PID
      */
     [[nodiscard]] static bool nsjail_proc_id() {
-        std::ifstream status_file("/proc/self/status");
-        if (!status_file.is_open()) {
+        std::string buffer;
+        const util::text_view status = util::read_into("/proc/self/status", buffer);
+        if (status.data == nullptr) {
             return false;
         }
 
-        std::string line;
+        const char* line = status.data;
+        const char* line_end = line;
+        const char* const status_end = status.data + status.size;
         bool pid_match = false;
         bool ppid_match = false;
 
-        auto parse_number = [&](const std::string& prefix) -> int {
-            if (line.compare(0, prefix.size(), prefix) != 0) {
+        auto parse_number = [&](const char* prefix) -> int {
+            const size_t prefix_len = std::strlen(prefix);
+            if (static_cast<size_t>(line_end - line) < prefix_len || std::memcmp(line, prefix, prefix_len) != 0) {
                 return -1;
             }
             int num = 0;
-            for (size_t i = prefix.size(); i < line.size(); ++i) {
-                u8 ch = static_cast<u8>(line[i]);
+            for (const char* it = line + prefix_len; it < line_end; ++it) {
+                u8 ch = static_cast<u8>(*it);
                 if (std::isdigit(ch)) {
                     num = num * 10 + (ch - '0');
                 }
@@ -6598,7 +8533,9 @@ public:
             return num;
         };
 
-        while (std::getline(status_file, line)) {
+        for (; line < status_end; line = (line_end == status_end) ? line_end : line_end + 1) {
+            line_end = std::find(line, status_end, '\n');
+
             int pid = parse_number("Pid:");
             if (pid == 1) {
                 pid_match = true;
@@ -6635,7 +8572,7 @@ public:
      * @implements VM::PROCESSES
      */
     [[nodiscard]] static bool processes() {
-        if (util::is_proc_running("qemu_ga")) {
+        if (util::process_table::fetch()->running(util::process_table::QEMU_GA)) {
             debug("PROCESSES: Detected QEMU guest agent process.");
             return core::add(brand_enum::QEMU);
         }
@@ -7223,30 +9160,78 @@ public:
             ~dir_closer() { if (d) closedir(d); }
         } dir(raw_dir);
 
-        constexpr const char* targets[] = {
-            "Parallels Software", "Parallels(R)",
-            "innotek",            "Oracle",   "VirtualBox", "vbox", "VBOX",
-            "VMware, Inc.",       "VMware",   "VMWARE",     "VMW0003",
-            "QEMU",               "pc-q35",   "Q35 +",      "FWCF",     "BOCHS",
-            "ovmf",               "edk ii unknown", "S3 Corp.", "Virtual Machine", "VS2005R2",
-            "Xen"
+        // in order of priority, the first one found anywhere in a table decides the brand
+        static constexpr util::pattern targets[] = {
+            { "Parallels Software", brand_enum::PARALLELS }, { "Parallels(R)", brand_enum::PARALLELS },
+            { "innotek", brand_enum::VBOX }, { "Oracle", brand_enum::VBOX }, { "VirtualBox", brand_enum::VBOX },
+            { "vbox", brand_enum::VBOX }, { "VBOX", brand_enum::VBOX },
+            { "VMware, Inc.", brand_enum::VMWARE }, { "VMware", brand_enum::VMWARE }, { "VMWARE", brand_enum::VMWARE },
+            { "VMW0003", brand_enum::NULL_BRAND },
+            { "QEMU", brand_enum::QEMU }, { "pc-q35", brand_enum::NULL_BRAND }, { "Q35 +", brand_enum::NULL_BRAND },
+            { "FWCF", brand_enum::NULL_BRAND }, { "BOCHS", brand_enum::BOCHS },
+            { "ovmf", brand_enum::NULL_BRAND }, { "edk ii unknown", brand_enum::NULL_BRAND },
+            { "S3 Corp.", brand_enum::NULL_BRAND }, { "Virtual Machine", brand_enum::NULL_BRAND },
+            { "VS2005R2", brand_enum::NULL_BRAND }, { "Xen", brand_enum::NULL_BRAND }
+        };
+
+        static const util::pattern_matcher matcher(targets, sizeof(targets) / sizeof(targets[0]));
+
+        // true as soon as a target is found, with the technique's result in the last argument
+        auto scan = [&](const u8* data, const size_t size, bool& result) -> bool {
+            const util::pattern* hit = matcher.find(reinterpret_cast<const char*>(data), size);
+            if (hit == nullptr) {
+                return false;
+            }
+
+            result = (hit->brand != brand_enum::NULL_BRAND) ? core::add(hit->brand) : true;
+            return true;
+        };
+
+        // reads until the buffer is full or EOF, sysfs hands out ACPI tables in page sized chunks
+        auto read_at = [](const int fd, u8* out, const size_t size, const size_t offset) noexcept -> size_t {
+            size_t total = 0;
+
+            while (total < size) {
+                const ssize_t n = pread(fd, out + total, size - total, static_cast<off_t>(offset + total));
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) break; // error or EOF
+                total += static_cast<size_t>(n);
+            }
+
+            return total;
+        };
+
+        // every table starts with the same 36 byte header: signature, length, revision, checksum, 
+        // OEM ID, OEM table ID, OEM revision, creator ID and creator revision. Strings only show 
+        // up past the header in the AML of the DSDT and SSDTs, the FADT and OEM specific tables. 
+        // Everything else is fixed binary layouts (APIC, MCFG, HPET...), so only their header 
+        // is read, which is where the OEM and creator IDs like "BOCHS " or "VBOX" are anyway
+        constexpr size_t header_size = 36;
+        constexpr size_t MAX_TABLE_SIZE = 8 * 1024 * 1024;
+
+        auto has_body_strings = [](const u8* signature) noexcept -> bool {
+            return (
+                (memcmp(signature, "DSDT", 4) == 0) ||
+                (memcmp(signature, "SSDT", 4) == 0) ||
+                (memcmp(signature, "FACP", 4) == 0) ||
+                (memcmp(signature, "OEM", 3) == 0)
+            );
         };
 
+        // sysfs doesn't support mmap for ACPI tables, so every table is read into this buffer, which only ever grows
+        std::vector<u8> buffer(header_size);
+        const int dir_fd = dirfd(raw_dir);
+        bool result = false;
+
         struct dirent* entry;
-        constexpr long MAX_TABLE_SIZE = 8 * 1024 * 1024;
 
         while ((entry = readdir(raw_dir)) != nullptr) {
-            // Skip "." and ".."
-            if (strcmp(entry->d_name, ".") == 0 ||
-                strcmp(entry->d_name, "..") == 0)
+            // Skip ".", ".." and the "data" and "dynamic" subdirectories
+            if (entry->d_name[0] == '.' || entry->d_type == DT_DIR) {
                 continue;
+            }
 
-            char path[PATH_MAX];
-            snprintf(path, sizeof(path),
-                "/sys/firmware/acpi/tables/%s",
-                entry->d_name);
-
-            int fd = open(path, O_RDONLY);
+            const int fd = openat(dir_fd, entry->d_name, O_RDONLY | O_CLOEXEC);
             if (fd == -1) {
                 debug("FIRMWARE: could not open ACPI table ", entry->d_name);
                 continue;
@@ -7258,136 +9243,283 @@ public:
                 ~fd_closer() { if (fd != -1) close(fd); }
             } fdguard(fd);
 
-            struct stat statbuf;
-            if (fstat(fd, &statbuf) != 0 || S_ISDIR(statbuf.st_mode)) {
-                debug("FIRMWARE: skipped ", entry->d_name);
+            const size_t header_length = read_at(fd, buffer.data(), header_size, 0);
+
+            if (header_length == 0) {
+                debug("FIRMWARE: file empty or error ", entry->d_name);
                 continue;
             }
-            long file_size = statbuf.st_size;
-            if (file_size <= 0) {
-                debug("FIRMWARE: file empty or error ", entry->d_name);
+
+            if (header_length < header_size || !has_body_strings(buffer.data())) {
+                if (scan(buffer.data(), header_length, result)) {
+                    return result;
+                }
                 continue;
             }
 
-            if (file_size > MAX_TABLE_SIZE) {
+            u32 table_length = 0;
+            memcpy(&table_length, buffer.data() + 4, sizeof(table_length));
+
+            if (table_length > MAX_TABLE_SIZE) {
                 debug("FIRMWARE: table too large, skipping ", entry->d_name);
                 continue;
             }
 
-            const size_t file_size_u = static_cast<size_t>(file_size);
+            if (table_length > buffer.size()) {
+                buffer.resize(table_length);
+            }
 
-            std::vector<u8> buffer;
-            try {
-                buffer.resize(file_size_u);
+            const size_t length = (table_length > header_size)
+                ? header_size + read_at(fd, buffer.data() + header_size, table_length - header_size, header_size)
+                : header_size;
+
+            if (scan(buffer.data(), length, result)) {
+                return result;
             }
-            catch (...) {
-                debug("FIRMWARE: failed to allocate memory for buffer");
-                continue;
+        }
+
+        return false;
+    #endif
+    }
+
+
+    /**
+     * @brief Check for PCI vendor and device IDs that are VM-specific
+     * @link https://www.pcilookup.com/?ven=&dev=&action=submit
+     * @category Linux, Windows
+     * @implements VM::DEVICES
+     */
+    [[nodiscard]] static bool pci_devices() {
+        struct pci_device { u16 vendor_id; u32 device_id; };
+
+        // true once a VM specific device is found, with the technique's result in the second argument
+        auto match = [](const pci_device& d, bool& result) -> bool {
+            const u64 id64 = (static_cast<u64>(d.vendor_id) << 32) | d.device_id;
+            const u32 id32 = (static_cast<u32>(d.vendor_id) << 16) | static_cast<u32>(d.device_id);
+            switch (id32) {
+                // Red Hat + Virtio
+                case 0x1af40022: case 0x1af41000: case 0x1af41001: case 0x1af41002:
+                case 0x1af41003: case 0x1af41004: case 0x1af41005: case 0x1af41009:
+                case 0x1af41041: case 0x1af41042: case 0x1af41043: case 0x1af41044:
+                case 0x1af41045: case 0x1af41048: case 0x1af41049: case 0x1af41050:
+                case 0x1af41052: case 0x1af41053: case 0x1af4105a: case 0x1af41100:
+                case 0x1af41110: case 0x1af41b36:
+                    debug("DEVICES: Detected Red Hat + Virtio device -> 0x", std::hex, id32);
+                    result = true;
+                    return true;
+
+                // VMware
+                case 0x15ad0710: case 0x15ad0720: case 0x15ad0770: case 0x15ad0774: 
+                case 0x15ad0778: case 0x15ad0779: case 0x15ad0790: case 0x15ad07a0: 
+                case 0x15ad07b0: case 0x15ad07c0: case 0x15ad07e0: case 0x15ad07f0: 
+                case 0x15ad0801: case 0x15ad0820: case 0x15ad1977: case 0xfffe0710: 
+                case 0x0e0f0001: case 0x0e0f0002: case 0x0e0f0003: case 0x0e0f0004: 
+                case 0x0e0f0005: case 0x0e0f0006: case 0x0e0f000a: case 0x0e0f8001: 
+                case 0x0e0f8002: case 0x0e0f8003: case 0x0e0ff80a:
+                    debug("DEVICES: Detected VMWARE device -> 0x", std::hex, id32);
+                    result = core::add(brand_enum::VMWARE);
+                    return true;
+
+                // Red Hat + QEMU
+                case 0x1b360001: case 0x1b360002: case 0x1b360003: case 0x1b360004:
+                case 0x1b360005: case 0x1b360008: case 0x1b360009: case 0x1b36000b:
+                case 0x1b36000c: case 0x1b36000d: case 0x1b360010: case 0x1b360011:
+                case 0x1b360013: case 0x1b360100:
+                    debug("DEVICES: Detected Red Hat + QEMU device -> 0x", std::hex, id32);
+                    result = core::add(brand_enum::QEMU);
+                    return true;
+
+                // QEMU
+                case 0x06270001: case 0x1d1d1f1f: case 0x80865845: case 0x1d6b0200:
+                    debug("DEVICES: Detected QEMU device -> 0x", std::hex, id32);
+                    result = core::add(brand_enum::QEMU);
+                    return true;
+
+                // vGPUs (NVIDIA + others)
+                case 0x10de0fe7: case 0x10de0ff7: case 0x10de118d: case 0x10de11b0:
+                case 0x1ec6020f:
+                    debug("DEVICES: Detected virtual gpu device -> 0x", std::hex, id32);
+                    result = true;
+                    return true;
+
+                // VirtualBox
+                case 0x80ee0021: case 0x80ee0022: case 0x80eebeef: case 0x80eecafe:
+                    debug("DEVICES: Detected VirtualBox device -> 0x", std::hex, id32);
+                    result = core::add(brand_enum::VBOX);
+                    return true;
+
+                // Parallels
+                case 0x1ab84000: case 0x1ab84005: case 0x1ab84006:
+                    debug("DEVICES: Detected Parallels device -> 0x", std::hex, id32);
+                    result = core::add(brand_enum::PARALLELS);
+                    return true;
+
+                // Xen
+                case 0x5853c000: case 0xfffd0101: case 0x5853c147:
+                case 0x5853c110: case 0x5853c200: case 0x58530001:
+                    debug("DEVICES: Detected Xen device -> 0x", std::hex, id32);
+                    result = core::add(brand_enum::XEN);
+                    return true;
+
+                // Connectix (VirtualPC)
+                case 0x29556e61:
+                    debug("DEVICES: Detected VirtualPC device -> 0x", std::hex, id32);
+                    result = core::add(brand_enum::VPC);
+                    return true;
             }
 
-            size_t total = 0;
-            while (total < file_size_u) {
-                ssize_t n = read(fdguard.fd, buffer.data() + total, file_size_u - total);
-                if (n <= 0) break; // error or EOF
-                total += static_cast<size_t>(n);
+            // Devices with 32 bit device ids
+            switch (id64) {
+                case 0x0000000011061100ULL:
+                case 0x000000001af41100ULL:
+                case 0x000000001b361100ULL:
+                case 0x0000000010ec1100ULL:
+                case 0x0000000010331100ULL:
+                case 0x0000000080861100ULL:
+                case 0x0000000010131100ULL:
+                case 0x00000000106b1100ULL:
+                case 0x0000000010221100ULL:
+                    debug("DEVICES: Detected QEMU device -> 0x", std::hex, id64);
+                    result = core::add(brand_enum::QEMU);
+                    return true;
+    
+                case 0x0000000015ad0800ULL:  // Hypervisor ROM Interface
+                    debug("DEVICES: Detected Hypervisor ROM interface -> 0x", std::hex, id64);
+                    result = core::add(brand_enum::VMWARE);
+                    return true;
             }
-            if (total != file_size_u) {
-                debug("FIRMWARE: could not read full table ", entry->d_name);
-                continue;
+
+            return false;
+        };
+
+        #if (LINUX)
+        auto parse_hex = [](const char* it, const char* const end) noexcept -> u32 {
+            u32 value = 0;
+
+            for (; it < end; ++it) {
+                const char c = *it;
+                u32 digit;
+
+                if (c >= '0' && c <= '9') digit = static_cast<u32>(c - '0');
+                else if (c >= 'a' && c <= 'f') digit = static_cast<u32>(c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F') digit = static_cast<u32>(c - 'A' + 10);
+                else break;
+
+                value = (value << 4) | digit;
             }
 
-            for (const char* target : targets) {
-                size_t target_length = strlen(target);
-                if (target_length > file_size_u)
-                    continue;
-                for (size_t j = 0; j <= file_size_u - target_length; ++j) {
-                    if (memcmp(buffer.data() + j, target, target_length) == 0) {
-                        enum brand_enum brand = brand_enum::NULL_BRAND;
-    
-                        if (strcmp(target, "Parallels Software International") == 0 ||
-                            strcmp(target, "Parallels(R)") == 0) {
-                            brand = brand_enum::PARALLELS;
-                        }
-                        else if (strcmp(target, "innotek") == 0 ||
-                            strcmp(target, "Oracle") == 0 ||
-                            strcmp(target, "VirtualBox") == 0 ||
-                            strcmp(target, "vbox") == 0 ||
-                            strcmp(target, "VBOX") == 0) {
-                            brand = brand_enum::VBOX;
-                        }
-                        else if (strcmp(target, "VMware, Inc.") == 0 ||
-                            strcmp(target, "VMware") == 0 ||
-                            strcmp(target, "VMWARE") == 0) {
-                            brand = brand_enum::VMWARE;
-                        }
-                        else if (strcmp(target, "QEMU") == 0) {
-                            brand = brand_enum::QEMU;
-                        }
-                        else if (strcmp(target, "BOCHS") == 0 ||
-                            strcmp(target, "BXPC") == 0) {
-                            brand = brand_enum::BOCHS;
+            return value;
+        };
+
+        bool result = false;
+
+        // every device is a line in /proc/bus/pci/devices, with the vendor and device ID 
+        // as the second tab separated field ("0000\t1af41000\t..."), so it's a single read
+        {
+            std::string buffer;
+            const util::text_view listing = util::read_into("/proc/bus/pci/devices", buffer);
+
+            if (listing.data != nullptr) {
+                const char* const end = listing.data + listing.size;
+
+                for (const char* line = listing.data; line < end; ) {
+                    const char* const line_end = std::find(line, end, '\n');
+                    const char* const tab = std::find(line, line_end, '\t');
+
+                    if (tab != line_end) {
+                        const u32 ids = parse_hex(tab + 1, line_end);
+                        const pci_device device = { static_cast<u16>(ids >> 16), (ids & 0xFFFF) };
+
+                        if (match(device, result)) {
+                            return result;
                         }
+                    }
+
+                    line = (line_end == end) ? end : line_end + 1;
+                }
+
+                return false;
+            }
+        }
+
+        // kernels without CONFIG_PCI_PROC, go through sysfs with a directory fd instead
+        const int dir_fd = open("/sys/bus/pci/devices", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if (dir_fd < 0) {
+            debug("DEVICES: ", "failed to open /sys/bus/pci/devices");
+            return false;
+        }
+
+        // reads a "0x1af4\n" style attribute of a device relative to the directory fd
+        auto read_id = [&](const char* device_name, const char* attribute, u32& out) noexcept -> bool {
+            char path[128];
+            const int length = std::snprintf(path, sizeof(path), "%s/%s", device_name, attribute);
+
+            if (length <= 0 || static_cast<size_t>(length) >= sizeof(path)) {
+                return false;
+            }
+
+            const int fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return false;
+            }
+
+            char content[16];
+            ssize_t bytes;
+            do {
+                bytes = pread(fd, content, sizeof(content), 0);
+            } while (bytes < 0 && errno == EINTR);
+
+            close(fd);
+
+            if (bytes < 3 || content[0] != '0' || (content[1] | 0x20) != 'x') {
+                return false;
+            }
+
+            out = parse_hex(content + 2, content + bytes);
+            return true;
+        };
+
+        // linux_dirent64 records: 8 byte inode, 8 byte offset, 2 byte record length, 1 byte type, then the name
+        constexpr size_t reclen_offset = 16;
+        constexpr size_t name_offset = 19;
+        alignas(8) char entries[8192];
+
+        while (true) {
+            const long bytes = syscall(SYS_getdents64, dir_fd, entries, sizeof(entries));
+
+            if (bytes <= 0) {
+                break;
+            }
+
+            for (long position = 0; position < bytes; ) {
+                u16 record_length = 0;
+                std::memcpy(&record_length, entries + position + reclen_offset, sizeof(record_length));
+
+                const char* const name = entries + position + name_offset;
+                position += record_length;
+
+                if (name[0] == '.') {
+                    continue;
+                }
 
-                        if (brand != brand_enum::NULL_BRAND) {
-                            return core::add(brand);
-                        } else {
-                            return true;
-                        }
-                    }
+                u32 vendor_id = 0, device_id = 0;
+                if (!read_id(name, "vendor", vendor_id) || !read_id(name, "device", device_id)) {
+                    continue;
+                }
+
+                if (match({ static_cast<u16>(vendor_id), device_id }, result)) {
+                    close(dir_fd);
+                    return result;
                 }
             }
         }
 
+        close(dir_fd);
         return false;
-    #endif
-    }
-
-
-    /**
-     * @brief Check for PCI vendor and device IDs that are VM-specific
-     * @link https://www.pcilookup.com/?ven=&dev=&action=submit
-     * @category Linux, Windows
-     * @implements VM::DEVICES
-     */
-    [[nodiscard]] static bool pci_devices() {
-        struct pci_device { u16 vendor_id; u32 device_id; };
+        #elif (WINDOWS)
         std::vector<pci_device> devices;
 
-        #if (LINUX)
-         const std::string pci_path = "/sys/bus/pci/devices";
-         #if (VMA_CPP >= 17)
-            // std::filesystem throws exceptions when directories don't exist (SIGSEGV)
-            std::error_code ec;
-            auto dir_iter = std::filesystem::directory_iterator(pci_path, ec);
-
-            if (!ec) {
-                for (const auto& entry : dir_iter) {
-                    std::ifstream vf(entry.path() / "vendor"), df(entry.path() / "device");
-                    if (!vf || !df) continue;
-                    u16 vid = 0; u32 did = 0;
-                    vf >> std::hex >> vid;
-                    df >> std::hex >> did;
-                    devices.push_back({ vid, did });
-                }
-            }
-         #else
-            DIR* dir = opendir(pci_path.c_str());
-            if (dir) {
-                while (struct dirent* ent = readdir(dir)) {
-                    std::string name = ent->d_name;
-                    if (name == "." || name == "..") continue;
-                    std::string base = pci_path + "/" + name;
-                    std::ifstream vf(base + "/vendor"), df(base + "/device");
-                    if (!vf || !df) continue;
-                    u16 vid = 0; u32 did = 0;
-                    vf >> std::hex >> vid;
-                    df >> std::hex >> did;
-                    devices.push_back({ vid, did });
-                }
-                closedir(dir);
-            }
-        #endif
-        #elif (WINDOWS)
         static constexpr const wchar_t* kroots[] = {
             L"SYSTEM\\CurrentControlSet\\Enum\\PCI",
             L"SYSTEM\\CurrentControlSet\\Enum\\USB",
@@ -7498,1060 +9630,1602 @@ public:
                 &cb_data
             );
 
-            if (rv == ERROR_MORE_DATA) {
-                if (cb_data > MAX_MULTI_SZ) {
-                    return;
+            if (rv == ERROR_MORE_DATA) {
+                if (cb_data > MAX_MULTI_SZ) {
+                    return;
+                }
+
+                // allocate a buffer large enough to hold the entire MULTI_SZ
+                // (+1 for safety null terminator logic below)
+                buf.resize((cb_data / sizeof(wchar_t)) + 2);
+
+                rv = RegGetValueW(
+                    h_inst,
+                    nullptr,
+                    L"HardwareID",
+                    RRF_RT_REG_MULTI_SZ,
+                    &type,
+                    buf.data(),
+                    &cb_data
+                );
+            }
+
+            if (rv != ERROR_SUCCESS || type != REG_MULTI_SZ || cb_data <= sizeof(wchar_t)) {
+                return;
+            }
+
+            // guarantee terminating NUL
+            // RegGetValueW with RRF_RT_REG_MULTI_SZ usually handles this but for safety
+            const size_t wchar_count = cb_data / sizeof(wchar_t);
+            if (wchar_count < buf.size()) buf[wchar_count] = L'\0';
+            else buf.back() = L'\0';
+
+            for (wchar_t* p = buf.data(); *p; p += wcslen(p) + 1) {
+                scan_text_ids(p);
+            }
+        };
+
+        // all instance subkeys under a given device key
+        auto enum_instances = [&](HKEY h_dev) noexcept {
+            wchar_t inst_name[256];
+
+            for (DWORD j = 0;; ++j) {
+                // reset size for each iteration as RegEnumKeyExW modifies it
+                DWORD cb_inst = _countof(inst_name);
+
+                const LONG st2 = RegEnumKeyExW(
+                    h_dev,
+                    j,
+                    inst_name,
+                    &cb_inst,
+                    nullptr,
+                    nullptr,
+                    nullptr,
+                    nullptr
+                );
+                if (st2 == ERROR_NO_MORE_ITEMS) break;
+                if (st2 != ERROR_SUCCESS) continue;
+
+                HKEY h_inst = nullptr;
+                if (RegOpenKeyExW(h_dev, inst_name, 0, KEY_READ, &h_inst) != ERROR_SUCCESS) continue;
+
+                process_hardware_id_reg(h_inst);
+                RegCloseKey(h_inst);
+            }
+        };
+
+        // all device subkeys under a given root key
+        auto enum_devices = [&](HKEY h_root) noexcept {
+            wchar_t device_name[256];
+
+            for (DWORD i = 0;; ++i) {
+                DWORD cb_name = _countof(device_name);
+
+                const LONG status = RegEnumKeyExW(
+                    h_root,
+                    i,
+                    device_name,
+                    &cb_name,
+                    nullptr,
+                    nullptr,
+                    nullptr,
+                    nullptr
+                );
+                if (status == ERROR_NO_MORE_ITEMS) break;
+                if (status != ERROR_SUCCESS) continue;
+
+                HKEY h_dev = nullptr;
+                if (RegOpenKeyExW(h_root, device_name, 0, KEY_READ, &h_dev) != ERROR_SUCCESS) continue;
+
+                enum_instances(h_dev);
+                RegCloseKey(h_dev);
+            }
+        };
+
+        // for each rootPath we open the root key once
+        for (size_t root_idx = 0; root_idx < _countof(kroots); ++root_idx) {
+            const wchar_t* root_path = kroots[root_idx];
+            HKEY root = nullptr;
+            if (RegOpenKeyExW(
+                HKEY_LOCAL_MACHINE,
+                root_path,
+                0,
+                KEY_READ,
+                &root
+            ) != ERROR_SUCCESS) {
+                continue;
+            }
+
+            enum_devices(root);
+            RegCloseKey(root);
+        }
+
+        bool result = false;
+
+        for (const auto& d : devices) {
+            if (match(d, result)) {
+                return result;
+            }
+        }
+        #endif
+
+        return false;
+    }
+#endif
+
+#if (LINUX || APPLE)
+    /**
+     * @brief Check if there are only 1 or 2 threads, which is a common pattern in VMs with default settings, nowadays physical CPUs should have at least 4 threads for modern CPUs
+     * @category x86 (ARM might have very low thread counts, which is why it should be only for x86)
+     * @implements VM::THREAD_COUNT
+     */
+    [[nodiscard]] static bool thread_count() {
+    #if (x86 && !APPLE)
+        debug("THREADCOUNT: ", "threads = ", memo::threadcount::fetch());
+
+        if (cpu::is_celeron()) {
+            return false;
+        }
+
+        return (memo::threadcount::fetch() <= 2);
+    #else 
+        return false;
+    #endif
+    }
+#endif
+
+#if (APPLE) 
+    /**
+     * @brief Check if the sysctl for the hwmodel does not contain the "Mac" string
+     * @author MacRansom ransomware
+     * @category MacOS
+     * @implements VM::HWMODEL
+     */
+    [[nodiscard]] static bool hwmodel() {
+        
+        //hw.model strings are short (like for example MacBookPro16,1), 128 bytes is plenty
+        char buffer[128] = { 0 };
+        size_t size = sizeof(buffer);
+
+        // sysctlbyname queries the kernel directly, bypassing the overhead of 
+        // fork(), exec(), and pipe() found in util::sys_result (popen)
+        if (sysctlbyname("hw.model", buffer, &size, nullptr, 0) != 0) {
+            debug("HWMODEL: ", "failed to read hw.model");
+            return false;
+        }
+
+        // sysctlbyname returns the raw value (usually without a trailing newline),
+        // so no trimming is required
+        debug("HWMODEL: ", "output = ", buffer);
+
+        if (strstr(buffer, "Mac") != nullptr) {
+            return false;
+        }
+
+        if (strstr(buffer, "VMware") != nullptr) {
+            return core::add(brand_enum::VMWARE);
+        }
+
+        // assumed true since it doesn't contain "Mac" string
+        return true;
+    }
+
+
+    /**
+     * @brief Check if memory is too low for MacOS system
+     * @category MacOS
+     * @link https://evasions.checkpoint.com/src/MacOS/macos.html
+     * @implements VM::MAC_MEMSIZE
+     */
+    [[nodiscard]] static bool hw_memsize() {
+        std::unique_ptr<std::string> result = util::sys_result("sysctl -n hw.memsize");
+        const std::string ram = *result;
+
+        if (ram == "0") {
+            return false;
+        }
+
+        debug("MAC_MEMSIZE: ", "ram size = ", ram);
+
+        for (const char c : ram) {
+            if (!std::isdigit(c)) {
+                debug("MAC_MEMSIZE: ", "found non-digit character, returned false");
+                return false;
+            }
+        }
+
+        const u64 ram_u64 = std::stoull(ram);
+
+        debug("MAC_MEMSIZE: ", "ram size in u64 = ", ram_u64);
+
+        constexpr u64 limit = 4000000000; // 4GB 
+
+        return (ram_u64 <= limit);
+    }
+
+
+    /**
+     * @brief Check MacOS' IO kit registry for VM-specific strings
+     * @category MacOS
+     * @link https://evasions.checkpoint.com/src/MacOS/macos.html
+     * @implements VM::MAC_IOKIT
+     */
+    [[nodiscard]] static bool io_kit() {
+        // board_ptr and manufacturer_ptr empty
+        std::unique_ptr<std::string> platform_ptr = util::sys_result("ioreg -rd1 -c IOPlatformExpertDevice");
+        std::unique_ptr<std::string> board_ptr = util::sys_result("ioreg -rd1 -c board-id");
+        std::unique_ptr<std::string> manufacturer_ptr = util::sys_result("ioreg -rd1 -c manufacturer");
+        std::unique_ptr<std::string> keyboard_ptr = util::sys_result("ioreg -lw0 -p IODeviceTree");
+
+        const std::string platform = *platform_ptr;
+        const std::string board = *board_ptr;
+        const std::string manufacturer = *manufacturer_ptr;
+        const std::string keyboard = *keyboard_ptr;
+
+        auto check_platform = [&]() -> bool {
+            debug("IO_KIT: ", "platform = ", platform);
+
+            if (platform.empty()) {
+                return false;
+            }
+
+            for (const char c : platform) {
+                if (!std::isdigit(c)) {
+                    return false;
                 }
+            }
 
-                // allocate a buffer large enough to hold the entire MULTI_SZ
-                // (+1 for safety null terminator logic below)
-                buf.resize((cb_data / sizeof(wchar_t)) + 2);
+            return (platform == "0");
+        };
 
-                rv = RegGetValueW(
-                    h_inst,
-                    nullptr,
-                    L"HardwareID",
-                    RRF_RT_REG_MULTI_SZ,
-                    &type,
-                    buf.data(),
-                    &cb_data
-                );
+        auto check_board = [&]() -> bool {
+            debug("IO_KIT: ", "board = ", board);
+
+            if (board.empty()) {
+                return false;
             }
 
-            if (rv != ERROR_SUCCESS || type != REG_MULTI_SZ || cb_data <= sizeof(wchar_t)) {
-                return;
+            if (util::find(board, "Mac")) {
+                return false;
             }
 
-            // guarantee terminating NUL
-            // RegGetValueW with RRF_RT_REG_MULTI_SZ usually handles this but for safety
-            const size_t wchar_count = cb_data / sizeof(wchar_t);
-            if (wchar_count < buf.size()) buf[wchar_count] = L'\0';
-            else buf.back() = L'\0';
+            if (util::find(board, "VirtualBox")) {
+                return core::add(brand_enum::VBOX);
+            }
 
-            for (wchar_t* p = buf.data(); *p; p += wcslen(p) + 1) {
-                scan_text_ids(p);
+            if (util::find(board, "VMware")) {
+                return core::add(brand_enum::VMWARE);
             }
+
+            return false;
         };
 
-        // all instance subkeys under a given device key
-        auto enum_instances = [&](HKEY h_dev) noexcept {
-            wchar_t inst_name[256];
+        auto check_manufacturer = [&]() -> bool {
+            debug("IO_KIT: ", "manufacturer = ", manufacturer);
 
-            for (DWORD j = 0;; ++j) {
-                // reset size for each iteration as RegEnumKeyExW modifies it
-                DWORD cb_inst = _countof(inst_name);
+            if (manufacturer.empty()) {
+                return false;
+            }
 
-                const LONG st2 = RegEnumKeyExW(
-                    h_dev,
-                    j,
-                    inst_name,
-                    &cb_inst,
-                    nullptr,
-                    nullptr,
-                    nullptr,
-                    nullptr
-                );
-                if (st2 == ERROR_NO_MORE_ITEMS) break;
-                if (st2 != ERROR_SUCCESS) continue;
+            if (util::find(manufacturer, "Apple")) {
+                return false;
+            }
 
-                HKEY h_inst = nullptr;
-                if (RegOpenKeyExW(h_dev, inst_name, 0, KEY_READ, &h_inst) != ERROR_SUCCESS) continue;
+            if (util::find(manufacturer, "innotek")) {
+                return core::add(brand_enum::VBOX);
+            }
 
-                process_hardware_id_reg(h_inst);
-                RegCloseKey(h_inst);
+            return false;
+        };
+
+        auto check_keyboard = [&]() -> bool {
+            debug("IO_KIT: ", "keyboard = ", keyboard);
+
+            if (keyboard.empty()) {
+                return false;
+            }
+
+            if (util::find(keyboard, "Virtual Machine")) {
+                return true;
             }
+
+            return false;
         };
 
-        // all device subkeys under a given root key
-        auto enum_devices = [&](HKEY h_root) noexcept {
-            wchar_t device_name[256];
+        return (
+            check_platform() ||
+            check_board() ||
+            check_manufacturer() ||
+            check_keyboard()
+       );
+    }
 
-            for (DWORD i = 0;; ++i) {
-                DWORD cb_name = _countof(device_name);
 
-                const LONG status = RegEnumKeyExW(
-                    h_root,
-                    i,
-                    device_name,
-                    &cb_name,
-                    nullptr,
-                    nullptr,
-                    nullptr,
-                    nullptr
-                );
-                if (status == ERROR_NO_MORE_ITEMS) break;
-                if (status != ERROR_SUCCESS) continue;
+    /**
+     * @brief Check for VM-strings in ioreg commands for MacOS
+     * @category MacOS
+     * @link https://evasions.checkpoint.com/src/MacOS/macos.html
+     * @implements VM::IOREG_GREP
+     */
+    [[nodiscard]] static bool ioreg_grep() {
+        auto check_usb = []() -> bool {
+            std::unique_ptr<std::string> result = util::sys_result("ioreg -rd1 -c IOUSBHostDevice | grep \"USB Vendor Name\"");
+            const std::string usb = *result;
 
-                HKEY h_dev = nullptr;
-                if (RegOpenKeyExW(h_root, device_name, 0, KEY_READ, &h_dev) != ERROR_SUCCESS) continue;
+            if (util::find(usb, "Apple")) {
+                return false;
+            }
 
-                enum_instances(h_dev);
-                RegCloseKey(h_dev);
+            if (util::find(usb, "VirtualBox")) {
+                return core::add(brand_enum::VBOX);
             }
+
+            return false;
         };
 
-        // for each rootPath we open the root key once
-        for (size_t root_idx = 0; root_idx < _countof(kroots); ++root_idx) {
-            const wchar_t* root_path = kroots[root_idx];
-            HKEY root = nullptr;
-            if (RegOpenKeyExW(
-                HKEY_LOCAL_MACHINE,
-                root_path,
-                0,
-                KEY_READ,
-                &root
-            ) != ERROR_SUCCESS) {
-                continue;
+        auto check_rom = []() -> bool {
+            std::unique_ptr<std::string> sys_rom = util::sys_result("system_profiler SPHardwareDataType | grep \"Boot ROM Version\"");
+            const std::string rom = *sys_rom;
+
+            if (util::find(rom, "VirtualBox")) {
+                return core::add(brand_enum::VBOX);
             }
 
-            enum_devices(root);
-            RegCloseKey(root);
+            return false;
+        };
+
+        return (
+            check_usb() ||
+            check_general() ||
+            check_rom()
+        );
+    }
+
+
+    /**
+     * @brief Check for the status of System Integrity Protection and hv_mm_present
+     * @category MacOS
+     * @link https://evasions.checkpoint.com/src/MacOS/macos.html
+     * @implements VM::MAC_SIP
+     */
+    [[nodiscard]] static bool mac_sip() {
+        int hv_present = 0;
+        std::size_t size = sizeof(hv_present);
+        if (sysctlbyname("kern.hv_vmm_present",
+            &hv_present,
+            &size,
+            nullptr,
+            0) != 0) {
+            return false;
         }
-        #endif
 
-        for (auto& d : devices) {
-            const u64 id64 = (static_cast<u64>(d.vendor_id) << 32) | d.device_id;
-            const u32 id32 = (static_cast<u32>(d.vendor_id) << 16) | static_cast<u32>(d.device_id);
-            switch (id32) {
-                // Red Hat + Virtio
-                case 0x1af40022: case 0x1af41000: case 0x1af41001: case 0x1af41002:
-                case 0x1af41003: case 0x1af41004: case 0x1af41005: case 0x1af41009:
-                case 0x1af41041: case 0x1af41042: case 0x1af41043: case 0x1af41044:
-                case 0x1af41045: case 0x1af41048: case 0x1af41049: case 0x1af41050:
-                case 0x1af41052: case 0x1af41053: case 0x1af4105a: case 0x1af41100:
-                case 0x1af41110: case 0x1af41b36:
-                    debug("DEVICES: Detected Red Hat + Virtio device -> 0x", std::hex, id32);
-                    return true;
+        if (hv_present != 0) {
+            return true;
+        }
 
-                // VMware
-                case 0x15ad0710: case 0x15ad0720: case 0x15ad0770: case 0x15ad0774: 
-                case 0x15ad0778: case 0x15ad0779: case 0x15ad0790: case 0x15ad07a0: 
-                case 0x15ad07b0: case 0x15ad07c0: case 0x15ad07e0: case 0x15ad07f0: 
-                case 0x15ad0801: case 0x15ad0820: case 0x15ad1977: case 0xfffe0710: 
-                case 0x0e0f0001: case 0x0e0f0002: case 0x0e0f0003: case 0x0e0f0004: 
-                case 0x0e0f0005: case 0x0e0f0006: case 0x0e0f000a: case 0x0e0f8001: 
-                case 0x0e0f8002: case 0x0e0f8003: case 0x0e0ff80a:
-                    debug("DEVICES: Detected VMWARE device -> 0x", std::hex, id32);
-                    return core::add(brand_enum::VMWARE);
+        std::unique_ptr<std::string> result = util::sys_result("csrutil status");
 
-                // Red Hat + QEMU
-                case 0x1b360001: case 0x1b360002: case 0x1b360003: case 0x1b360004:
-                case 0x1b360005: case 0x1b360008: case 0x1b360009: case 0x1b36000b:
-                case 0x1b36000c: case 0x1b36000d: case 0x1b360010: case 0x1b360011:
-                case 0x1b360013: case 0x1b360100:
-                    debug("DEVICES: Detected Red Hat + QEMU device -> 0x", std::hex, id32);
-                    return core::add(brand_enum::QEMU);
+        if (!result) {
+            return false;
+        }
 
-                // QEMU
-                case 0x06270001: case 0x1d1d1f1f: case 0x80865845: case 0x1d6b0200:
-                    debug("DEVICES: Detected QEMU device -> 0x", std::hex, id32);
-                    return core::add(brand_enum::QEMU);
+        std::string tmp = *result;
 
-                // vGPUs (NVIDIA + others)
-                case 0x10de0fe7: case 0x10de0ff7: case 0x10de118d: case 0x10de11b0:
-                case 0x1ec6020f:
-                    debug("DEVICES: Detected virtual gpu device -> 0x", std::hex, id32);
-                    return true;
+        auto pos = tmp.find('\n');
 
-                // VirtualBox
-                case 0x80ee0021: case 0x80ee0022: case 0x80eebeef: case 0x80eecafe:
-                    debug("DEVICES: Detected VirtualBox device -> 0x", std::hex, id32);
-                    return core::add(brand_enum::VBOX);
+        if (pos != std::string::npos) {
+            tmp.resize(pos);
+        }
 
-                // Parallels
-                case 0x1ab84000: case 0x1ab84005: case 0x1ab84006:
-                    debug("DEVICES: Detected Parallels device -> 0x", std::hex, id32);
-                    return core::add(brand_enum::PARALLELS);
+        debug("MAC_SIP: ", "result = ", tmp);
+
+        if (util::find(tmp, "unknown")) {
+            return false;
+        }
+
+        return (util::find(tmp, "disabled"));
+    }
+
+
+    /**
+     * @brief Check for VM-strings in system profiler commands for MacOS
+     * @category MacOS
+     * @implements VM::MAC_SYS
+     */
+    [[nodiscard]] static bool mac_sys() {
+        const char* keyword = "virtual machine";
 
-                // Xen
-                case 0x5853c000: case 0xfffd0101: case 0x5853c147:
-                case 0x5853c110: case 0x5853c200: case 0x58530001:
-                    debug("DEVICES: Detected Xen device -> 0x", std::hex, id32);
-                    return core::add(brand_enum::XEN);
+        if (std::unique_ptr<std::string> profiler_res_ptr = util::sys_result("system_profiler SPHardwareDataType")) {
+            std::string& output = *profiler_res_ptr;
 
-                // Connectix (VirtualPC)
-                case 0x29556e61:
-                    debug("DEVICES: Detected VirtualPC device -> 0x", std::hex, id32);
-                    return core::add(brand_enum::VPC);
-            }
+            std::transform(output.begin(), output.end(), output.begin(),
+                [](u8 c) { return std::tolower(c); });
 
-            // Devices with 32 bit device ids
-            switch (id64) {
-                case 0x0000000011061100ULL:
-                case 0x000000001af41100ULL:
-                case 0x000000001b361100ULL:
-                case 0x0000000010ec1100ULL:
-                case 0x0000000010331100ULL:
-                case 0x0000000080861100ULL:
-                case 0x0000000010131100ULL:
-                case 0x00000000106b1100ULL:
-                case 0x0000000010221100ULL:
-                    debug("DEVICES: Detected QEMU device -> 0x", std::hex, id64);
-                    return core::add(brand_enum::QEMU);
-    
-                case 0x0000000015ad0800ULL:  // Hypervisor ROM Interface
-                    debug("DEVICES: Detected Hypervisor ROM interface -> 0x", std::hex, id64);
-                    return core::add(brand_enum::VMWARE);
+            if (util::find(output, keyword)) {
+                return true;
             }
         }
-        
+
         return false;
     }
 #endif
 
-#if (LINUX || APPLE)
+
+#if (WINDOWS)
     /**
-     * @brief Check if there are only 1 or 2 threads, which is a common pattern in VMs with default settings, nowadays physical CPUs should have at least 4 threads for modern CPUs
-     * @category x86 (ARM might have very low thread counts, which is why it should be only for x86)
-     * @implements VM::THREAD_COUNT
+     * @brief Check for VM-specific DLLs
+     * @category Windows
+     * @implements VM::DLL
      */
-    [[nodiscard]] static bool thread_count() {
-    #if (x86 && !APPLE)
-        debug("THREADCOUNT: ", "threads = ", memo::threadcount::fetch());
-
-        struct cpu::stepping_struct steps = cpu::fetch_steppings();
+    [[nodiscard]] static bool dll() {
+        static constexpr struct {
+            const char* dll_name;
+            enum brand_enum brand;
+        } dlls[] = {
+            {"sbiedll.dll",   brand_enum::SANDBOXIE},
+            {"pstorec.dll",   brand_enum::CWSANDBOX},
+            {"vmcheck.dll",   brand_enum::VPC},
+            {"cmdvrt32.dll",  brand_enum::COMODO},
+            {"cmdvrt64.dll",  brand_enum::COMODO},
+            {"cuckoomon.dll", brand_enum::CUCKOO},
+            {"SxIn.dll",      brand_enum::QIHOO},
+            {"wpespy.dll",    brand_enum::NULL_BRAND}
+        };
 
-        if (cpu::is_celeron(steps)) {
-            return false;
+        for (const auto& x : dlls) {
+            if (GetModuleHandleA(x.dll_name) != nullptr) {
+                debug("DLL: Found ", x.dll_name, " (", brands::brand_enum_to_string(x.brand), ")");
+                return core::add(x.brand);
+            }
         }
 
-        return (memo::threadcount::fetch() <= 2);
-    #else 
         return false;
-    #endif
     }
-#endif
 
-#if (APPLE) 
+             
     /**
-     * @brief Check if the sysctl for the hwmodel does not contain the "Mac" string
-     * @author MacRansom ransomware
-     * @category MacOS
-     * @implements VM::HWMODEL
+     * @brief Check if the function "wine_get_unix_file_name" is present and if the OS booted from a VHD container
+     * @category Windows
+     * @implements VM::WINE_FUNC
      */
-    [[nodiscard]] static bool hwmodel() {
-        
-        //hw.model strings are short (like for example MacBookPro16,1), 128 bytes is plenty
-        char buffer[128] = { 0 };
-        size_t size = sizeof(buffer);
+    [[nodiscard]] static bool wine() {
+        #if (_WIN32_WINNT < _WIN32_WINNT_WIN8)
+            return false;
+        #else
+            __try {
+                BOOL isNativeVhdBoot = 0;
+                // we dont call NtQuerySystemInformation with SystemPrefetchPathInformation | SystemHandleInformation
+                // the point is to check if this kernel32.dll function throws an exception
+                IsNativeVhdBoot(&isNativeVhdBoot);
+                VMAWARE_UNUSED(isNativeVhdBoot);
+            }
+            __except (EXCEPTION_EXECUTE_HANDLER) {
+                debug("WINE: SEH invoked");
+                return true;
+            }
+        #endif
 
-        // sysctlbyname queries the kernel directly, bypassing the overhead of 
-        // fork(), exec(), and pipe() found in util::sys_result (popen)
-        if (sysctlbyname("hw.model", buffer, &size, nullptr, 0) != 0) {
-            debug("HWMODEL: ", "failed to read hw.model");
+        return false;
+    }
+                
+                
+    /**
+     * @brief Check what power states are enabled
+     * @category Windows
+     * @implements VM::POWER_CAPABILITIES
+     */
+    [[nodiscard]] static bool power_capabilities() {
+        const HMODULE ntdll = util::get_ntdll();
+
+        const char* names[] = { "NtPowerInformation" }; // Win8
+        void* funcs[ARRAYSIZE(names)] = {};
+        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
+
+        if (!funcs[0]) return false;
+
+        using NtPI_t = NTSTATUS(__stdcall*)(POWER_INFORMATION_LEVEL,
+            PVOID, ULONG,
+            PVOID, ULONG);
+        const auto nt_power_information = reinterpret_cast<NtPI_t>(funcs[0]);
+
+        SYSTEM_POWER_CAPABILITIES caps = { 0 };
+        const NTSTATUS status = nt_power_information(
+            SystemPowerCapabilities,
+            nullptr, 0,
+            &caps, sizeof(caps)
+        );
+        if (status != 0) return false;
+
+        const bool s0_supported = caps.AoAc;
+        const bool s1_supported = caps.SystemS1;
+        const bool s2_supported = caps.SystemS2;
+        const bool s3_supported = caps.SystemS3;
+        const bool s4_supported = caps.SystemS4;
+        const bool hiber_file_present = caps.HiberFilePresent;
+
+        const bool is_physical_pattern = (s0_supported || s3_supported) &&
+            (s4_supported || hiber_file_present);
+
+        if (is_physical_pattern) {
             return false;
         }
 
-        // sysctlbyname returns the raw value (usually without a trailing newline),
-        // so no trimming is required
-        debug("HWMODEL: ", "output = ", buffer);
+        const bool is_vm_pattern = !(s0_supported || s3_supported || s4_supported || hiber_file_present) &&
+            (s1_supported || s2_supported);
 
-        if (strstr(buffer, "Mac") != nullptr) {
-            return false;
+        if (is_vm_pattern) {
+            debug("POWER_CAPABILITIES: Detected !(S0||S3||S4||HiberFilePresent) + S1|S2 pattern");
+            return true;
         }
 
-        if (strstr(buffer, "VMware") != nullptr) {
-            return core::add(brand_enum::VMWARE);
+        // could check for HKLM\\SYSTEM\\CurrentControlSet\\Control\\Power\\PlatformAoAcOverride
+        const bool no_sleep_states = !s0_supported && !s1_supported && !s2_supported && !s3_supported && !s4_supported && !hiber_file_present;
+        if (no_sleep_states) {
+            debug("POWER_CAPABILITIES: Detected !(S0||S1||S2||S3||S4||H) pattern");
+            return true;
         }
 
-        // assumed true since it doesn't contain "Mac" string
-        return true;
+        return (caps.ThermalControl == 0);
     }
 
 
     /**
-     * @brief Check if memory is too low for MacOS system
-     * @category MacOS
-     * @link https://evasions.checkpoint.com/src/MacOS/macos.html
-     * @implements VM::MAC_MEMSIZE
+     * @brief Check for Gamarue ransomware technique which compares VM-specific Window product IDs
+     * @category Windows
+     * @implements VM::GAMARUE
      */
-    [[nodiscard]] static bool hw_memsize() {
-        std::unique_ptr<std::string> result = util::sys_result("sysctl -n hw.memsize");
-        const std::string ram = *result;
+    [[nodiscard]] static bool gamarue() {
+        const HMODULE ntdll = util::get_ntdll();
+        if (!ntdll) return false;
 
-        if (ram == "0") {
-            return false;
-        }
+        const char* names[] = { "NtOpenKey", "NtQueryValueKey", "RtlInitUnicodeString", "NtClose" };
+        void* funcs[ARRAYSIZE(names)] = {};
+        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-        debug("MAC_MEMSIZE: ", "ram size = ", ram);
+        const auto nt_open_key = reinterpret_cast<NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES)>(funcs[0]);
+        const auto nt_query_value_key = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PUNICODE_STRING, ULONG, PVOID, ULONG, PULONG)>(funcs[1]);
+        const auto rtl_init_unicode_string = reinterpret_cast<void(__stdcall*)(PUNICODE_STRING, PCWSTR)>(funcs[2]);
+        const auto nt_close = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE)>(funcs[3]);
 
-        for (const char c : ram) {
-            if (!std::isdigit(c)) {
-                debug("MAC_MEMSIZE: ", "found non-digit character, returned false");
-                return false;
-            }
-        }
+        if (!nt_open_key || !nt_query_value_key || !rtl_init_unicode_string || !nt_close) 
+            return false;
 
-        const u64 ram_u64 = std::stoull(ram);
+        // We use native unicode strings and object attributes to interface directly with the kernel
+        UNICODE_STRING key_name;
+        rtl_init_unicode_string(&key_name, L"\\Registry\\Machine\\Software\\Microsoft\\Windows NT\\CurrentVersion");
 
-        debug("MAC_MEMSIZE: ", "ram size in u64 = ", ram_u64);
+        OBJECT_ATTRIBUTES object_attributes;
+        ZeroMemory(&object_attributes, sizeof(object_attributes));
+        object_attributes.Length = sizeof(object_attributes);
+        object_attributes.ObjectName = &key_name;
+        object_attributes.Attributes = OBJ_CASE_INSENSITIVE;
 
-        constexpr u64 limit = 4000000000; // 4GB 
+        // Open the registry key with minimal permissions (query only)
+        HANDLE key = nullptr;
+        constexpr ACCESS_MASK KEY_QUERY_ONLY = 0x0001; // KEY_QUERY_VALUE
+        NTSTATUS st = nt_open_key(&key, KEY_QUERY_ONLY, &object_attributes);
+        if (!NT_SUCCESS(st) || !key) {
+            return false;
+        }
 
-        return (ram_u64 <= limit);
-    }
+        // We specifically want the "ProductId". Automated malware analysis sandboxes often
+        // neglect to randomize this value, thats why we flag it
+        UNICODE_STRING value_name;
+        rtl_init_unicode_string(&value_name, L"ProductId");
+
+        // Buffer for KEY_VALUE_PARTIAL_INFORMATION
+        BYTE buffer[128]{};
+        ULONG result_length = 0;
+        constexpr ULONG key_value_partial_information = 2;
 
+        st = nt_query_value_key(key, &value_name, key_value_partial_information, buffer, sizeof(buffer), &result_length);
 
-    /**
-     * @brief Check MacOS' IO kit registry for VM-specific strings
-     * @category MacOS
-     * @link https://evasions.checkpoint.com/src/MacOS/macos.html
-     * @implements VM::MAC_IOKIT
-     */
-    [[nodiscard]] static bool io_kit() {
-        // board_ptr and manufacturer_ptr empty
-        std::unique_ptr<std::string> platform_ptr = util::sys_result("ioreg -rd1 -c IOPlatformExpertDevice");
-        std::unique_ptr<std::string> board_ptr = util::sys_result("ioreg -rd1 -c board-id");
-        std::unique_ptr<std::string> manufacturer_ptr = util::sys_result("ioreg -rd1 -c manufacturer");
-        std::unique_ptr<std::string> keyboard_ptr = util::sys_result("ioreg -lw0 -p IODeviceTree");
+        nt_close(key);
 
-        const std::string platform = *platform_ptr;
-        const std::string board = *board_ptr;
-        const std::string manufacturer = *manufacturer_ptr;
-        const std::string keyboard = *keyboard_ptr;
+        if (!NT_SUCCESS(st)) {
+            return false;
+        }
 
-        auto check_platform = [&]() -> bool {
-            debug("IO_KIT: ", "platform = ", platform);
+        // raw structure returned by the native API to manually parse the binary data
+        struct KEY_VALUE_PARTIAL_INFORMATION_LOCAL {
+            ULONG TitleIndex;
+            ULONG Type;
+            ULONG DataLength;
+            BYTE Data[1];
+        };
 
-            if (platform.empty()) {
-                return false;
-            }
+        if (result_length < offsetof(KEY_VALUE_PARTIAL_INFORMATION_LOCAL, Data) + 1) {
+            return false;
+        }
 
-            for (const char c : platform) {
-                if (!std::isdigit(c)) {
-                    return false;
-                }
-            }
+        // Safely extract the ProductId string from the raw byte buffer, ensuring we don't 
+        // buffer overflow if the registry returns garbage data
+        const auto* kv = reinterpret_cast<KEY_VALUE_PARTIAL_INFORMATION_LOCAL*>(buffer);
+        const ULONG data_length = kv->DataLength;
+        if (data_length == 0 || data_length >= sizeof(buffer)) return false;
 
-            return (platform == "0");
+        char product_id[64] = { 0 };
+        const size_t copyLen = (data_length < (sizeof(product_id) - 1)) ? data_length : (sizeof(product_id) - 1);
+        memcpy(product_id, kv->Data, copyLen);
+        product_id[copyLen] = '\0';
+
+        // A list of known "dirty" Product IDs associated with public malware analysis sandboxes
+        struct target_pattern {
+            const char* product_id;
+            enum brand_enum brand;
         };
 
-        auto check_board = [&]() -> bool {
-            debug("IO_KIT: ", "board = ", board);
+        constexpr target_pattern targets[] = {
+            {"55274-640-2673064-23950", brand_enum::JOEBOX},   
+            {"76487-644-3177037-23510", brand_enum::CWSANDBOX}, 
+            {"76487-337-8429955-22614", brand_enum::ANUBIS}     
+        };
 
-            if (board.empty()) {
-                return false;
-            }
+        constexpr size_t target_length = 21;
 
-            if (util::find(board, "Mac")) {
-                return false;
-            }
+        if (strlen(product_id) != target_length) return false;
 
-            if (util::find(board, "VirtualBox")) {
-                return core::add(brand_enum::VBOX);
+        // compare the current system's ProductId against the blacklist
+        // if a match is found, we identify the specific sandbox environment and flag it
+        for (const auto& target : targets) {
+            if (memcmp(product_id, target.product_id, target_length) == 0) {
+                debug("GAMARUE: Detected ", target.product_id);
+                return core::add(target.brand);
             }
+        }
 
-            if (util::find(board, "VMware")) {
-                return core::add(brand_enum::VMWARE);
-            }
+        return false;
+    }
+ 
 
-            return false;
-        };
+    /**
+     * @brief Check for official VPC method
+     * @category Windows, x86_32
+     * @implements VM::VPC_INVALID
+     */
+    [[nodiscard]] static bool vpc_invalid() {
+        bool rc = false;
+    #if (x86_32 && !CLANG)
 
-        auto check_manufacturer = [&]() -> bool {
-            debug("IO_KIT: ", "manufacturer = ", manufacturer);
+        auto is_inside_vpc = [](PEXCEPTION_POINTERS ep) noexcept -> DWORD {
+            PCONTEXT ctx = ep->ContextRecord;
 
-            if (manufacturer.empty()) {
-                return false;
-            }
+            ctx->Ebx = static_cast<DWORD>(-1); // Not running VPC
+            ctx->Eip += 4; // skip past the "call VPC" opcodes
+            return static_cast<DWORD>(EXCEPTION_CONTINUE_EXECUTION);
+            // we can safely resume execution since we skipped faulty instruction
+        };
 
-            if (util::find(manufacturer, "Apple")) {
-                return false;
-            }
+        __try {
+            __asm {
+                push eax
+                push ebx
+                push ecx
+                push edx
 
-            if (util::find(manufacturer, "innotek")) {
-                return core::add(brand_enum::VBOX);
-            }
+                mov ebx, 0h
+                mov eax, 01h
 
-            return false;
-        };
+                __emit 0Fh
+                __emit 3Fh
+                __emit 07h
+                __emit 0Bh
 
-        auto check_keyboard = [&]() -> bool {
-            debug("IO_KIT: ", "keyboard = ", keyboard);
+                test ebx, ebx
+                setz[rc]
 
-            if (keyboard.empty()) {
-                return false;
+                pop edx
+                pop ecx
+                pop ebx
+                pop eax
             }
+        }
+        __except (is_inside_vpc(GetExceptionInformation())) {
+            rc = false;
+        }
+    #endif
+        return rc;
+    }
 
-            if (util::find(keyboard, "Virtual Machine")) {
-                return true;
-            }
 
-            return false;
-        };
+    /**
+     * @brief Check str assembly instruction method for VMware
+     * @author Alfredo Omella's (S21sec) STR technique, paper describing this technique is located in /papers/
+     * @category Windows, x86_32
+     * @implements VM::VMWARE_STR
+     */
+    [[nodiscard]] static bool vmware_str() {
+    #if (x86_32)
+        u16 tr = 0;
+        __asm {
+            str ax
+            mov tr, ax
+        }
+        if ((tr & 0xFF) == 0x00 && ((tr >> 8) & 0xFF) == 0x40) {
+            return core::add(brand_enum::VMWARE);
+        }
 
-        return (
-            check_platform() ||
-            check_board() ||
-            check_manufacturer() ||
-            check_keyboard()
-       );
+        return false;
+    #else
+        return false;
+    #endif
     }
 
 
     /**
-     * @brief Check for VM-strings in ioreg commands for MacOS
-     * @category MacOS
-     * @link https://evasions.checkpoint.com/src/MacOS/macos.html
-     * @implements VM::IOREG_GREP
+     * @brief Check for official VMware io port backdoor technique
+     * @category Windows, x86_32
+     * @author Code from ScoopyNG by Tobias Klein, technique founded by Ken Kato
+     * @copyright BSD clause 2
+     * @implements VM::VMWARE_BACKDOOR
      */
-    [[nodiscard]] static bool ioreg_grep() {
-        auto check_usb = []() -> bool {
-            std::unique_ptr<std::string> result = util::sys_result("ioreg -rd1 -c IOUSBHostDevice | grep \"USB Vendor Name\"");
-            const std::string usb = *result;
+    [[nodiscard]] static bool vmware_backdoor() {
+        bool is_vm = false;
+    #if (x86_32 && !CLANG)
+        u32 a = 0;
+        u32 b = 0;
 
-            if (util::find(usb, "Apple")) {
-                return false;
-            }
+        constexpr std::array<i16, 2> ioports = { { 'VX' , 'VY' } };
+        i16 ioport;
 
-            if (util::find(usb, "VirtualBox")) {
-                return core::add(brand_enum::VBOX);
-            }
+        for (u8 i = 0; i < ioports.size(); ++i) {
+            ioport = ioports[i];
+            for (u8 cmd = 0; cmd < 0x2c; ++cmd) {
+                __try {
+                    __asm {
+                        push eax
+                        push ebx
+                        push ecx
+                        push edx
 
-            return false;
-        };
+                        mov eax, 'VMXh'
+                        movzx ecx, cmd
+                        mov dx, ioport
+                        in eax, dx      // <- key point is here
 
-        auto check_rom = []() -> bool {
-            std::unique_ptr<std::string> sys_rom = util::sys_result("system_profiler SPHardwareDataType | grep \"Boot ROM Version\"");
-            const std::string rom = *sys_rom;
+                        mov a, ebx
+                        mov b, ecx
 
-            if (util::find(rom, "VirtualBox")) {
-                return core::add(brand_enum::VBOX);
-            }
+                        pop edx
+                        pop ecx
+                        pop ebx
+                        pop eax
+                    }
 
-            return false;
-        };
+                    is_vm = true;
+                    break;
+                }
+                __except (EXCEPTION_EXECUTE_HANDLER) {}
+            }
+        }
 
-        return (
-            check_usb() ||
-            check_general() ||
-            check_rom()
-        );
+        if (is_vm) {
+            switch (b) {
+                case 1:  return core::add(brand_enum::VMWARE_EXPRESS);
+                case 2:  return core::add(brand_enum::VMWARE_ESX);
+                case 3:  return core::add(brand_enum::VMWARE_GSX);
+                case 4:  return core::add(brand_enum::VMWARE_WORKSTATION);
+                default: return core::add(brand_enum::VMWARE);
+            }
+        }
+    #endif
+        return is_vm;
     }
 
 
     /**
-     * @brief Check for the status of System Integrity Protection and hv_mm_present
-     * @category MacOS
-     * @link https://evasions.checkpoint.com/src/MacOS/macos.html
-     * @implements VM::MAC_SIP
+     * @brief Check for mutex strings of VM brands
+     * @category Windows
+     * @author from VMDE project
+     * @author hfiref0x
+     * @implements VM::MUTEX
      */
-    [[nodiscard]] static bool mac_sip() {
-        int hv_present = 0;
-        std::size_t size = sizeof(hv_present);
-        if (sysctlbyname("kern.hv_vmm_present",
-            &hv_present,
-            &size,
-            nullptr,
-            0) != 0) {
-            return false;
-        }
+    [[nodiscard]] static bool mutex() {
+        const HMODULE ntdll = util::get_ntdll();
+        if (!ntdll) return false;
 
-        if (hv_present != 0) {
-            return true;
-        }
+        using RtlInitUnicodeString_t = void(__stdcall*)(PUNICODE_STRING DestinationString, PCWSTR SourceString);
+        using NtClose_t = NTSTATUS(__stdcall*)(HANDLE Handle);
+        using NtOpenMutant_t = NTSTATUS(__stdcall*)(PHANDLE MutantHandle, ACCESS_MASK DesiredAccess, POBJECT_ATTRIBUTES ObjectAttributes);
+
+        const char* names[] = { "NtOpenMutant", "RtlInitUnicodeString", "NtClose" };
+        void* funcs[ARRAYSIZE(names)] = {};
+        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-        std::unique_ptr<std::string> result = util::sys_result("csrutil status");
+        const auto nt_open_mutant = reinterpret_cast<NtOpenMutant_t>(funcs[0]);
+        const auto rtl_init_unicode_string = reinterpret_cast<RtlInitUnicodeString_t>(funcs[1]);
+        const auto nt_close = reinterpret_cast<NtClose_t>(funcs[2]);
 
-        if (!result) {
+        if (!nt_open_mutant || !rtl_init_unicode_string || !nt_close) {
             return false;
         }
 
-        std::string tmp = *result;
-
-        auto pos = tmp.find('\n');
+        auto try_mutex_name = [&](const wchar_t* base_name) noexcept -> bool {
+            constexpr wchar_t prefix[] = L"\\BaseNamedObjects\\";
+            constexpr size_t prefix_len = (sizeof(prefix) / sizeof(wchar_t)) - 1;
 
-        if (pos != std::string::npos) {
-            tmp.resize(pos);
-        }
+            wchar_t full_path[260];
 
-        debug("MAC_SIP: ", "result = ", tmp);
+            // memcpy as it is faster than wcscpy/wcscat
+            memcpy(full_path, prefix, sizeof(prefix)); 
 
-        if (util::find(tmp, "unknown")) {
-            return false;
-        }
+            const size_t name_len = wcslen(base_name);
+            if (prefix_len + name_len < 260) {
+                memcpy(full_path + prefix_len, base_name, (name_len + 1) * sizeof(wchar_t));
+            }
+            else {
+                // should not happen for standard VM artifacts
+                full_path[0] = L'\0';
+            }
 
-        return (util::find(tmp, "disabled"));
-    }
+            const wchar_t* attempts[] = { full_path, base_name };
 
+            for (const wchar_t* path : attempts) {
+                if (*path == L'\0') continue;
 
-    /**
-     * @brief Check for VM-strings in system profiler commands for MacOS
-     * @category MacOS
-     * @implements VM::MAC_SYS
-     */
-    [[nodiscard]] static bool mac_sys() {
-        const char* keyword = "virtual machine";
+                UNICODE_STRING u_name;
+                rtl_init_unicode_string(&u_name, path);
 
-        if (std::unique_ptr<std::string> profiler_res_ptr = util::sys_result("system_profiler SPHardwareDataType")) {
-            std::string& output = *profiler_res_ptr;
+                OBJECT_ATTRIBUTES obj_attr;
+                memset(&obj_attr, 0, sizeof(obj_attr));
+                obj_attr.Length = sizeof(obj_attr);
+                obj_attr.ObjectName = &u_name;
+                obj_attr.Attributes = OBJ_CASE_INSENSITIVE;
 
-            std::transform(output.begin(), output.end(), output.begin(),
-                [](u8 c) { return std::tolower(c); });
+                HANDLE h_mutant = nullptr;
+                const NTSTATUS st = nt_open_mutant(&h_mutant, MUTANT_QUERY_STATE, &obj_attr);
 
-            if (util::find(output, keyword)) {
-                return true;
+                if (NT_SUCCESS(st)) {
+                    if (h_mutant) nt_close(h_mutant);
+                    return true;
+                }
             }
+
+            return false;
+        };
+
+        if (try_mutex_name(L"Sandboxie_SingleInstanceMutex_Control") ||
+            try_mutex_name(L"SBIE_BOXED_ServiceInitComplete_Mutex1")) {
+            debug("MUTEX: Detected Sandboxie");
+            return core::add(brand_enum::SANDBOXIE);
+        }
+
+        if (try_mutex_name(L"MicrosoftVirtualPC7UserServiceMakeSureWe'reTheOnlyOneMutex")) {
+            debug("MUTEX: Detected VPC");
+            return core::add(brand_enum::VPC);
         }
 
         return false;
     }
-#endif
 
 
-#if (WINDOWS)
     /**
-     * @brief Check for VM-specific DLLs
+     * @brief Check for cuckoo directory using crt and WIN API directory functions
      * @category Windows
-     * @implements VM::DLL
+     * @author 一半人生
+     * @link https://unprotect.it/snippet/checking-specific-folder-name/196/
+     * @implements VM::CUCKOO_DIR
      */
-    [[nodiscard]] static bool dll() {
-        static constexpr struct {
-            const char* dll_name;
-            enum brand_enum brand;
-        } dlls[] = {
-            {"sbiedll.dll",   brand_enum::SANDBOXIE},
-            {"pstorec.dll",   brand_enum::CWSANDBOX},
-            {"vmcheck.dll",   brand_enum::VPC},
-            {"cmdvrt32.dll",  brand_enum::COMODO},
-            {"cmdvrt64.dll",  brand_enum::COMODO},
-            {"cuckoomon.dll", brand_enum::CUCKOO},
-            {"SxIn.dll",      brand_enum::QIHOO},
-            {"wpespy.dll",    brand_enum::NULL_BRAND}
-        };
+    [[nodiscard]] static bool cuckoo_dir() {
+        using NtOpenFile_t = NTSTATUS(__stdcall*)(PHANDLE FileHandle, ACCESS_MASK DesiredAccess,
+            POBJECT_ATTRIBUTES ObjectAttributes, PIO_STATUS_BLOCK IoStatusBlock,
+            ULONG ShareAccess, ULONG OpenOptions);
+        using RtlInitUnicodeString_t = void(__stdcall*)(PUNICODE_STRING DestinationString, PCWSTR SourceString);
+        using NtClose_t = NTSTATUS(__stdcall*)(HANDLE Handle);
 
-        for (const auto& x : dlls) {
-            if (GetModuleHandleA(x.dll_name) != nullptr) {
-                debug("DLL: Found ", x.dll_name, " (", brands::brand_enum_to_string(x.brand), ")");
-                return core::add(x.brand);
-            }
-        }
+        const HMODULE ntdll = util::get_ntdll();
+        if (!ntdll) return false;
 
-        return false;
-    }
+        const char* names[] = { "NtOpenFile", "RtlInitUnicodeString", "NtClose" };
+        void* funcs[ARRAYSIZE(names)] = {};
+        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-             
-    /**
-     * @brief Check if the function "wine_get_unix_file_name" is present and if the OS booted from a VHD container
-     * @category Windows
-     * @implements VM::WINE_FUNC
-     */
-    [[nodiscard]] static bool wine() {
-        #if (_WIN32_WINNT < _WIN32_WINNT_WIN8)
+        const auto nt_open_file = reinterpret_cast<NtOpenFile_t>(funcs[0]);
+        const auto rtl_init_unicode_string = reinterpret_cast<RtlInitUnicodeString_t>(funcs[1]);
+        const auto nt_close = reinterpret_cast<NtClose_t>(funcs[2]);
+
+        if (!nt_open_file || !rtl_init_unicode_string || !nt_close) {
             return false;
-        #else
-            __try {
-                BOOL isNativeVhdBoot = 0;
-                // we dont call NtQuerySystemInformation with SystemPrefetchPathInformation | SystemHandleInformation
-                // the point is to check if this kernel32.dll function throws an exception
-                IsNativeVhdBoot(&isNativeVhdBoot);
-                VMAWARE_UNUSED(isNativeVhdBoot);
-            }
-            __except (EXCEPTION_EXECUTE_HANDLER) {
-                debug("WINE: SEH invoked");
-                return true;
-            }
-        #endif
+        }
+
+        const wchar_t* native_path = L"\\??\\C:\\Cuckoo";
+        UNICODE_STRING path;
+        rtl_init_unicode_string(&path, native_path);
+
+        OBJECT_ATTRIBUTES object_attributes;
+        ZeroMemory(&object_attributes, sizeof(object_attributes));
+        object_attributes.Length = sizeof(object_attributes);
+        object_attributes.ObjectName = &path;
+        object_attributes.Attributes = OBJ_CASE_INSENSITIVE;
+
+        IO_STATUS_BLOCK iosb;
+        HANDLE hFile = nullptr;
+
+        constexpr ACCESS_MASK desired_access = FILE_READ_ATTRIBUTES; 
+        constexpr ULONG share_access = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+        constexpr ULONG open_options = FILE_OPEN | FILE_SYNCHRONOUS_IO_NONALERT | FILE_DIRECTORY_FILE;
+
+        const NTSTATUS st = nt_open_file(&hFile, desired_access, &object_attributes, &iosb, share_access, open_options);
+        if (NT_SUCCESS(st)) {
+            if (hFile) nt_close(hFile);
+            return core::add(brand_enum::CUCKOO);
+        }
 
         return false;
     }
                 
                 
     /**
-     * @brief Check what power states are enabled
+     * @brief Check for Cuckoo specific piping mechanism
      * @category Windows
-     * @implements VM::POWER_CAPABILITIES
+     * @author Thomas Roccia (fr0gger)
+     * @link https://unprotect.it/snippet/checking-specific-folder-name/196/
+     * @implements VM::CUCKOO_PIPE
      */
-    [[nodiscard]] static bool power_capabilities() {
+    [[nodiscard]] static bool cuckoo_pipe() {
+        using NtOpenFile_t = NTSTATUS(__stdcall*)(PHANDLE FileHandle, ACCESS_MASK DesiredAccess,
+            POBJECT_ATTRIBUTES ObjectAttributes, PIO_STATUS_BLOCK IoStatusBlock,
+            ULONG ShareAccess, ULONG OpenOptions);
+        using RtlInitUnicodeString_t = void(__stdcall*)(PUNICODE_STRING DestinationString, PCWSTR SourceString);
+        using NtClose_t = NTSTATUS(__stdcall*)(HANDLE Handle);
+
         const HMODULE ntdll = util::get_ntdll();
+        if (!ntdll) return false;
 
-        const char* names[] = { "NtPowerInformation" }; // Win8
+        const char* names[] = { "NtOpenFile", "RtlInitUnicodeString", "NtClose" };
         void* funcs[ARRAYSIZE(names)] = {};
         util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-        if (!funcs[0]) return false;
+        const auto nt_open_file = reinterpret_cast<NtOpenFile_t>(funcs[0]);
+        const auto rtl_init_unicode_string = reinterpret_cast<RtlInitUnicodeString_t>(funcs[1]);
+        const auto nt_close = reinterpret_cast<NtClose_t>(funcs[2]);
 
-        using NtPI_t = NTSTATUS(__stdcall*)(POWER_INFORMATION_LEVEL,
-            PVOID, ULONG,
-            PVOID, ULONG);
-        const auto nt_power_information = reinterpret_cast<NtPI_t>(funcs[0]);
+        if (!nt_open_file || !rtl_init_unicode_string || !nt_close) {
+            return false;
+        }
 
-        SYSTEM_POWER_CAPABILITIES caps = { 0 };
-        const NTSTATUS status = nt_power_information(
-            SystemPowerCapabilities,
-            nullptr, 0,
-            &caps, sizeof(caps)
-        );
-        if (status != 0) return false;
+        const wchar_t* pipe_path = L"\\??\\pipe\\cuckoo";
+        UNICODE_STRING pipe;
+        rtl_init_unicode_string(&pipe, pipe_path);
 
-        const bool s0_supported = caps.AoAc;
-        const bool s1_supported = caps.SystemS1;
-        const bool s2_supported = caps.SystemS2;
-        const bool s3_supported = caps.SystemS3;
-        const bool s4_supported = caps.SystemS4;
-        const bool hiber_file_present = caps.HiberFilePresent;
+        OBJECT_ATTRIBUTES object_attributes;
+        ZeroMemory(&object_attributes, sizeof(object_attributes));
+        object_attributes.Length = sizeof(object_attributes);
+        object_attributes.ObjectName = &pipe;
+        object_attributes.Attributes = OBJ_CASE_INSENSITIVE;
 
-        const bool is_physical_pattern = (s0_supported || s3_supported) &&
-            (s4_supported || hiber_file_present);
+        IO_STATUS_BLOCK iosb;
+        HANDLE h_pipe = nullptr;
 
-        if (is_physical_pattern) {
-            return false;
+        constexpr ACCESS_MASK desired_access = FILE_READ_DATA | FILE_READ_ATTRIBUTES;
+        constexpr ULONG share_access = 0;
+        constexpr ULONG open_options = FILE_OPEN | FILE_SYNCHRONOUS_IO_NONALERT;
+
+        const NTSTATUS st = nt_open_file(&h_pipe, desired_access, &object_attributes, &iosb, share_access, open_options);
+        if (NT_SUCCESS(st)) {
+            if (h_pipe) nt_close(h_pipe);
+            return core::add(brand_enum::CUCKOO);
         }
 
-        const bool is_vm_pattern = !(s0_supported || s3_supported || s4_supported || hiber_file_present) &&
-            (s1_supported || s2_supported);
+        return false;
+    }
 
-        if (is_vm_pattern) {
-            debug("POWER_CAPABILITIES: Detected !(S0||S3||S4||HiberFilePresent) + S1|S2 pattern");
+
+    /**
+     * @brief Check for display configurations commonly found in VMs
+     * @category Windows
+     * @implements VM::DISPLAY
+     */
+    [[nodiscard]] static bool display() {
+        const HDC hdc = GetDC(nullptr);
+        const int bpp = GetDeviceCaps(hdc, BITSPIXEL) *
+            GetDeviceCaps(hdc, PLANES);
+        const int logpix = GetDeviceCaps(hdc, LOGPIXELSX);
+        ReleaseDC(nullptr, hdc);
+
+        // physical monitors are almost always 32bpp and 96–144 DPI
+        if (bpp != 32 || logpix < 90)
             return true;
-        }
 
-        // could check for HKLM\\SYSTEM\\CurrentControlSet\\Control\\Power\\PlatformAoAcOverride
-        const bool no_sleep_states = !s0_supported && !s1_supported && !s2_supported && !s3_supported && !s4_supported && !hiber_file_present;
-        if (no_sleep_states) {
-            debug("POWER_CAPABILITIES: Detected !(S0||S1||S2||S3||S4||H) pattern");
+        return false;
+    }
+
+
+    /**
+     * @brief Check if bogus device string would be accepted
+     * @category Windows
+     * @author Huntress Research Team
+     * @link https://unprotect.it/technique/buildcommdcbandtimeouta/
+     * @implements VM::DEVICE_STRING
+     */
+    [[nodiscard]] static bool device_string() {
+        DCB dcb = { 0 };
+        COMMTIMEOUTS timeouts = { 0 };
+
+        if (BuildCommDCBAndTimeoutsA("jhl46745fghb", &dcb, &timeouts)) {
             return true;
+        } else {
+            return false;
         }
-
-        return (caps.ThermalControl == 0);
     }
 
 
     /**
-     * @brief Check for Gamarue ransomware technique which compares VM-specific Window product IDs
+     * @brief Check for VM-specific names for drivers
      * @category Windows
-     * @implements VM::GAMARUE
+     * @implements VM::DRIVERS
      */
-    [[nodiscard]] static bool gamarue() {
+    [[nodiscard]] static bool drivers() {
+        struct _SYSTEM_MODULE_INFORMATION {
+            PVOID  Reserved[2];
+            PVOID  ImageBaseAddress;
+            ULONG  ImageSize;
+            ULONG  Flags;
+            USHORT Index;
+            USHORT NameLength;
+            USHORT LoadCount;
+            USHORT PathLength;
+            CHAR   ImageName[256];
+        };
+
+        struct _SYSTEM_MODULE_INFORMATION_EX {
+            ULONG  NumberOfModules;
+            _SYSTEM_MODULE_INFORMATION Module[1];
+        };
+
+        using SYSTEM_MODULE_INFORMATION = _SYSTEM_MODULE_INFORMATION;
+        using PSYSTEM_MODULE_INFORMATION = _SYSTEM_MODULE_INFORMATION*;
+        using SYSTEM_MODULE_INFORMATION_EX = _SYSTEM_MODULE_INFORMATION_EX;
+        using PSYSTEM_MODULE_INFORMATION_EX = _SYSTEM_MODULE_INFORMATION_EX*;
+
+        using NtQuerySystemInformationFn = NTSTATUS(__stdcall*)(ULONG SystemInformationClass, PVOID SystemInformation, ULONG SystemInformationLength, PULONG ReturnLength);
+        using NtAllocateVirtualMemoryFn = NTSTATUS(__stdcall*)(
+            HANDLE ProcessHandle,
+            PVOID* BaseAddress,
+            ULONG_PTR ZeroBits,
+            PSIZE_T RegionSize,
+            ULONG AllocationType,
+            ULONG Protect
+        );
+        using NtFreeVirtualMemoryFn = NTSTATUS(__stdcall*)(HANDLE ProcessHandle, PVOID* BaseAddress, PSIZE_T RegionSize, ULONG FreeType);
+
+        constexpr ULONG system_module_information = 11;
         const HMODULE ntdll = util::get_ntdll();
         if (!ntdll) return false;
 
-        const char* names[] = { "NtOpenKey", "NtQueryValueKey", "RtlInitUnicodeString", "NtClose" };
+        const char* names[] = { "NtQuerySystemInformation", "NtAllocateVirtualMemory", "NtFreeVirtualMemory" };
         void* funcs[ARRAYSIZE(names)] = {};
         util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-        const auto nt_open_key = reinterpret_cast<NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES)>(funcs[0]);
-        const auto nt_query_value_key = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PUNICODE_STRING, ULONG, PVOID, ULONG, PULONG)>(funcs[1]);
-        const auto rtl_init_unicode_string = reinterpret_cast<void(__stdcall*)(PUNICODE_STRING, PCWSTR)>(funcs[2]);
-        const auto nt_close = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE)>(funcs[3]);
+        const auto nt_query_system_information = reinterpret_cast<NtQuerySystemInformationFn>(funcs[0]);
+        const auto nt_allocate_virtual_memory = reinterpret_cast<NtAllocateVirtualMemoryFn>(funcs[1]);
+        const auto nt_free_virtual_memory = reinterpret_cast<NtFreeVirtualMemoryFn>(funcs[2]);
 
-        if (!nt_open_key || !nt_query_value_key || !rtl_init_unicode_string || !nt_close) 
+        if (nt_query_system_information == nullptr || nt_allocate_virtual_memory == nullptr || nt_free_virtual_memory == nullptr)
             return false;
+        
+        ULONG ul_size = 0;
+        NTSTATUS status = nt_query_system_information(system_module_information, nullptr, 0, &ul_size);
+        if (status != ((NTSTATUS)0xC0000004L)) return false;
 
-        // We use native unicode strings and object attributes to interface directly with the kernel
-        UNICODE_STRING key_name;
-        rtl_init_unicode_string(&key_name, L"\\Registry\\Machine\\Software\\Microsoft\\Windows NT\\CurrentVersion");
-
-        OBJECT_ATTRIBUTES object_attributes;
-        ZeroMemory(&object_attributes, sizeof(object_attributes));
-        object_attributes.Length = sizeof(object_attributes);
-        object_attributes.ObjectName = &key_name;
-        object_attributes.Attributes = OBJ_CASE_INSENSITIVE;
+        const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
+        PVOID allocated_memory = nullptr;
+        SIZE_T region_size = ul_size;
+        nt_allocate_virtual_memory(current_process, &allocated_memory, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
 
-        // Open the registry key with minimal permissions (query only)
-        HANDLE key = nullptr;
-        constexpr ACCESS_MASK KEY_QUERY_ONLY = 0x0001; // KEY_QUERY_VALUE
-        NTSTATUS st = nt_open_key(&key, KEY_QUERY_ONLY, &object_attributes);
-        if (!NT_SUCCESS(st) || !key) {
+        const auto system_module_info_ex = reinterpret_cast<PSYSTEM_MODULE_INFORMATION_EX>(allocated_memory);
+        status = nt_query_system_information(system_module_information, system_module_info_ex, ul_size, &ul_size);
+        if (!(((NTSTATUS)(status)) >= 0)) {
+            nt_free_virtual_memory(current_process, &allocated_memory, &region_size, MEM_RELEASE);
             return false;
         }
 
-        // We specifically want the "ProductId". Automated malware analysis sandboxes often
-        // neglect to randomize this value, thats why we flag it
-        UNICODE_STRING value_name;
-        rtl_init_unicode_string(&value_name, L"ProductId");
+        for (ULONG i = 0; i < system_module_info_ex->NumberOfModules; ++i) {
+            const char* driverPath = reinterpret_cast<const char*>(system_module_info_ex->Module[i].ImageName);
+            if (
+                strstr(driverPath, "VBoxGuest") || // only installed after vbox guest additions
+                strstr(driverPath, "VBoxMouse") ||
+                strstr(driverPath, "VBoxSF")
+            ) {
+                debug("DRIVERS: Detected VBox driver: ", driverPath);
+                nt_free_virtual_memory(current_process, &allocated_memory, &region_size, MEM_RELEASE);
+                return core::add(brand_enum::VBOX);
+            }
 
-        // Buffer for KEY_VALUE_PARTIAL_INFORMATION
-        BYTE buffer[128]{};
-        ULONG result_length = 0;
-        constexpr ULONG key_value_partial_information = 2;
+            if (
+                strstr(driverPath, "vmusbmouse") ||
+                strstr(driverPath, "vmmouse") ||
+                strstr(driverPath, "vmmemctl")
+            ) {
+                debug("DRIVERS: Detected VMware driver: ", driverPath);
+                nt_free_virtual_memory(current_process, &allocated_memory, &region_size, MEM_RELEASE);
+                return core::add(brand_enum::VMWARE);
+            }
+        }
 
-        st = nt_query_value_key(key, &value_name, key_value_partial_information, buffer, sizeof(buffer), &result_length);
+        nt_free_virtual_memory(current_process, &allocated_memory, &region_size, MEM_RELEASE);
+        return false;
+    }
 
-        nt_close(key);
 
-        if (!NT_SUCCESS(st)) {
-            return false;
-        }
+    /**
+     * @brief Check for serial numbers of virtual disks
+     * @category Windows
+     * @implements VM::DISK_SERIAL
+     */
+    [[nodiscard]] static bool disk_serial_number() {
+        using NtOpenFile_t = NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES, PIO_STATUS_BLOCK, ULONG, ULONG);
+        using NtDeviceIoControlFile_t = NTSTATUS(__stdcall*)(HANDLE, HANDLE, PVOID, PVOID, PIO_STATUS_BLOCK, ULONG, PVOID, ULONG, PVOID, ULONG);
+        using NtAllocateVirtualMemory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG);
+        using NtFreeVirtualMemory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG);
+        using NtClose_t = NTSTATUS(__stdcall*)(HANDLE);
+        using RtlInitUnicodeString_t = void(__stdcall*)(PUNICODE_STRING, PCWSTR);
 
-        // raw structure returned by the native API to manually parse the binary data
-        struct KEY_VALUE_PARTIAL_INFORMATION_LOCAL {
-            ULONG TitleIndex;
-            ULONG Type;
-            ULONG DataLength;
-            BYTE Data[1];
+        bool result = false;
+        constexpr u8 MAX_PHYSICAL_DRIVES = 4;
+        constexpr SIZE_T MAX_DESCRIPTOR_SIZE = 64 * 1024;
+        u8 successful_opens = 0;
+
+        // Helper to detect QEMU instances based on default hard drive serial patterns
+        // QEMU drives often start with "QM000" followed by digits
+        auto is_qemu_serial = [](const char* str) noexcept -> bool {
+            if ((str[0] & 0xDF) != 'Q') return false;
+            if ((str[1] & 0xDF) != 'M') return false;
+
+            // we check byte-by-byte to be safe regarding alignment,
+            // though a 32-bit integer check (0x30303030) could be used if alignment is guaranteed
+            // we also essentially check for null termination safety here because '\0' != '0'
+            return str[2] == '0' && str[3] == '0' && str[4] == '0' && str[5] == '0';
         };
 
-        if (result_length < offsetof(KEY_VALUE_PARTIAL_INFORMATION_LOCAL, Data) + 1) {
-            return false;
-        }
+        // Helper to detect VirtualBox instances
+        // VirtualBox uses a specific serial format "VB" followed by hex segments
+        auto is_vbox_serial = [](const char* str, size_t len) noexcept -> bool {
+            // format: VB12345678-12345678 (19 chars)
+            if (len != 19) return false;
 
-        // Safely extract the ProductId string from the raw byte buffer, ensuring we don't 
-        // buffer overflow if the registry returns garbage data
-        const auto* kv = reinterpret_cast<KEY_VALUE_PARTIAL_INFORMATION_LOCAL*>(buffer);
-        const ULONG data_length = kv->DataLength;
-        if (data_length == 0 || data_length >= sizeof(buffer)) return false;
+            if ((str[0] & 0xDF) != 'V' || (str[1] & 0xDF) != 'B') {
+                return false;
+            }
+            if (str[10] != '-') return false;
 
-        char product_id[64] = { 0 };
-        const size_t copyLen = (data_length < (sizeof(product_id) - 1)) ? data_length : (sizeof(product_id) - 1);
-        memcpy(product_id, kv->Data, copyLen);
-        product_id[copyLen] = '\0';
+            auto is_hex = [](char c) noexcept -> bool {
+                const char lower = c | 0x20;
+                return (c >= '0' && c <= '9') 
+                    || (lower >= 'a' && lower <= 'f');
+            };
 
-        // A list of known "dirty" Product IDs associated with public malware analysis sandboxes
-        struct target_pattern {
-            const char* product_id;
-            enum brand_enum brand;
-        };
+            for (size_t i = 2; i < 10; ++i) {
+                if (!is_hex(str[i])) return false;
+            }
 
-        constexpr target_pattern targets[] = {
-            {"55274-640-2673064-23950", brand_enum::JOEBOX},   
-            {"76487-644-3177037-23510", brand_enum::CWSANDBOX}, 
-            {"76487-337-8429955-22614", brand_enum::ANUBIS}     
-        };
+            for (size_t i = 11; i < 19; ++i) {
+                if (!is_hex(str[i])) return false;
+            }
 
-        constexpr size_t target_length = 21;
+            return true;
+        };
 
-        if (strlen(product_id) != target_length) return false;
+        auto strnlen = [](const char* s, size_t max) noexcept -> size_t {
+            const void* p = memchr(s, 0, max);
+            if (!p) return max;
+            return static_cast<size_t>(static_cast<const char*>(p) - s);
+        };
 
-        // compare the current system's ProductId against the blacklist
-        // if a match is found, we identify the specific sandbox environment and flag it
-        for (const auto& target : targets) {
-            if (memcmp(product_id, target.product_id, target_length) == 0) {
-                debug("GAMARUE: Detected ", target.product_id);
-                return core::add(target.brand);
-            }
-        }
+        const HMODULE ntdll = util::get_ntdll();
+        if (!ntdll) return result;
 
-        return false;
-    }
- 
+        const char* names[] = {
+            "RtlInitUnicodeString",
+            "NtOpenFile",
+            "NtDeviceIoControlFile",
+            "NtAllocateVirtualMemory",
+            "NtFreeVirtualMemory",
+            "NtFlushInstructionCache",
+            "NtClose"
+        };
+        void* funcs[ARRAYSIZE(names)] = {};
+        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-    /**
-     * @brief Check for official VPC method
-     * @category Windows, x86_32
-     * @implements VM::VPC_INVALID
-     */
-    [[nodiscard]] static bool vpc_invalid() {
-        bool rc = false;
-    #if (x86_32 && !CLANG)
+        const auto rtl_init_unicode_string = reinterpret_cast<RtlInitUnicodeString_t>(funcs[0]);
+        const auto nt_open_file = reinterpret_cast<NtOpenFile_t>(funcs[1]);
+        const auto nt_device_io_control_file = reinterpret_cast<NtDeviceIoControlFile_t>(funcs[2]);
+        const auto nt_allocate_virtual_memory = reinterpret_cast<NtAllocateVirtualMemory_t>(funcs[3]);
+        const auto nt_free_virtual_memory = reinterpret_cast<NtFreeVirtualMemory_t>(funcs[4]);
+        const auto nt_close = reinterpret_cast<NtClose_t>(funcs[6]);
 
-        auto is_inside_vpc = [](PEXCEPTION_POINTERS ep) noexcept -> DWORD {
-            PCONTEXT ctx = ep->ContextRecord;
+        if (!rtl_init_unicode_string || !nt_open_file || !nt_device_io_control_file ||
+            !nt_allocate_virtual_memory || !nt_free_virtual_memory || !nt_close) {
+            return result;
+        }
 
-            ctx->Ebx = static_cast<DWORD>(-1); // Not running VPC
-            ctx->Eip += 4; // skip past the "call VPC" opcodes
-            return static_cast<DWORD>(EXCEPTION_CONTINUE_EXECUTION);
-            // we can safely resume execution since we skipped faulty instruction
-        };
+        // Iterate through the first few physical drives (PhysicalDrive0 to PhysicalDrive3)
+        // Most systems boot from 0, and VMs rarely emulate more than 1 or 2 drives by default
+        for (u8 drive = 0; drive < MAX_PHYSICAL_DRIVES; ++drive) {
+            wchar_t path[32];
+            swprintf_s(path, L"\\??\\PhysicalDrive%u", drive);
 
-        __try {
-            __asm {
-                push eax
-                push ebx
-                push ecx
-                push edx
+            UNICODE_STRING unicode_path;
+            rtl_init_unicode_string(&unicode_path, path);
 
-                mov ebx, 0h
-                mov eax, 01h
+            OBJECT_ATTRIBUTES object_attributes;
+            RtlZeroMemory(&object_attributes, sizeof(object_attributes));
+            object_attributes.Length = sizeof(object_attributes);
+            object_attributes.ObjectName = &unicode_path;
+            object_attributes.Attributes = OBJ_CASE_INSENSITIVE;
+            object_attributes.RootDirectory = nullptr;
 
-                __emit 0Fh
-                __emit 3Fh
-                __emit 07h
-                __emit 0Bh
+            IO_STATUS_BLOCK iosb;
+            HANDLE device = nullptr;
 
-                test ebx, ebx
-                setz[rc]
+            constexpr ACCESS_MASK desired_access = SYNCHRONIZE | FILE_READ_ATTRIBUTES;
+            constexpr ULONG share_access = FILE_SHARE_READ | FILE_SHARE_WRITE;
+            constexpr ULONG open_options = FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT;
 
-                pop edx
-                pop ecx
-                pop ebx
-                pop eax
+            // Attempt to open the physical drive directly using Native API
+            NTSTATUS st = nt_open_file(&device, desired_access, &object_attributes, &iosb, share_access, open_options);
+            if (!NT_SUCCESS(st) || device == nullptr) {
+                continue;
             }
-        }
-        __except (is_inside_vpc(GetExceptionInformation())) {
-            rc = false;
-        }
-    #endif
-        return rc;
-    }
-
+            ++successful_opens;
 
-    /**
-     * @brief Check str assembly instruction method for VMware
-     * @author Alfredo Omella's (S21sec) STR technique, paper describing this technique is located in /papers/
-     * @category Windows, x86_32
-     * @implements VM::VMWARE_STR
-     */
-    [[nodiscard]] static bool vmware_str() {
-    #if (x86_32)
-        u16 tr = 0;
-        __asm {
-            str ax
-            mov tr, ax
-        }
-        if ((tr & 0xFF) == 0x00 && ((tr >> 8) & 0xFF) == 0x40) {
-            return core::add(brand_enum::VMWARE);
-        }
+            // stack buffer attempt
+            // We first try to read the storage properties into a small stack buffer to avoid heap
+            BYTE stackBuf[512] = { 0 };
+            const STORAGE_DEVICE_DESCRIPTOR* descriptor = reinterpret_cast<STORAGE_DEVICE_DESCRIPTOR*>(stackBuf);
 
-        return false;
-    #else
-        return false;
-    #endif
-    }
+            STORAGE_PROPERTY_QUERY query{};
+            query.PropertyId = StorageDeviceProperty;
+            query.QueryType = PropertyStandardQuery;
 
+            const ULONG ioctl = IOCTL_STORAGE_QUERY_PROPERTY;
 
-    /**
-     * @brief Check for official VMware io port backdoor technique
-     * @category Windows, x86_32
-     * @author Code from ScoopyNG by Tobias Klein, technique founded by Ken Kato
-     * @copyright BSD clause 2
-     * @implements VM::VMWARE_BACKDOOR
-     */
-    [[nodiscard]] static bool vmware_backdoor() {
-        bool is_vm = false;
-    #if (x86_32 && !CLANG)
-        u32 a = 0;
-        u32 b = 0;
+            st = nt_device_io_control_file(device, nullptr, nullptr, nullptr, &iosb,
+                ioctl,
+                &query, sizeof(query),
+                stackBuf, sizeof(stackBuf));
 
-        constexpr std::array<i16, 2> ioports = { { 'VX' , 'VY' } };
-        i16 ioport;
+            BYTE* allocated_buffer = nullptr;
+            SIZE_T allocated_size = 0;
+            const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
 
-        for (u8 i = 0; i < ioports.size(); ++i) {
-            ioport = ioports[i];
-            for (u8 cmd = 0; cmd < 0x2c; ++cmd) {
-                __try {
-                    __asm {
-                        push eax
-                        push ebx
-                        push ecx
-                        push edx
+            // If the stack buffer was too small (NtDeviceIoControlFile failed), we fall back 
+            // to allocating memory dynamically using NtAllocateVirtualMemory
+            if (!NT_SUCCESS(st)) {
+                DWORD reported_size = 0;
+                if (descriptor && descriptor->Size > 0) {
+                    reported_size = descriptor->Size;
+                }
 
-                        mov eax, 'VMXh'
-                        movzx ecx, cmd
-                        mov dx, ioport
-                        in eax, dx      // <- key point is here
+                // This branch just ensures the requested size is reasonable before allocating
+                if (reported_size > 0 && reported_size < static_cast<DWORD>(MAX_DESCRIPTOR_SIZE) && reported_size >= sizeof(STORAGE_DEVICE_DESCRIPTOR)) {
+                    allocated_size = static_cast<SIZE_T>(reported_size);
+                    PVOID allocation_base = nullptr;
+                    SIZE_T region_size = allocated_size;
+                    st = nt_allocate_virtual_memory(current_process, &allocation_base, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+                    if (!NT_SUCCESS(st) || allocation_base == nullptr) {
+                        nt_close(device);
+                        continue;
+                    }
+                    allocated_buffer = reinterpret_cast<BYTE*>(allocation_base);
 
-                        mov a, ebx
-                        mov b, ecx
+                    // Retry the query with the larger allocated buffer
+                    st = nt_device_io_control_file(device, nullptr, nullptr, nullptr, &iosb,
+                        ioctl,
+                        &query, sizeof(query),
+                        allocated_buffer, static_cast<ULONG>(allocated_size));
+                    if (!NT_SUCCESS(st)) {
+                        PVOID free_base = reinterpret_cast<PVOID>(allocated_buffer);
+                        SIZE_T free_size = allocated_size;
+                        nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
+                        nt_close(device);
+                        continue;
+                    }
+                    descriptor = reinterpret_cast<STORAGE_DEVICE_DESCRIPTOR*>(allocated_buffer);
+                }
+                else {
+                    nt_close(device);
+                    continue;
+                }
+            }
 
-                        pop edx
-                        pop ecx
-                        pop ebx
-                        pop eax
+            // This part is just to validate the structure size returned by the driver to prevent out-of-bounds reads
+            {
+                const DWORD reported_size = descriptor->Size;
+                if (reported_size < sizeof(STORAGE_DEVICE_DESCRIPTOR) || static_cast<SIZE_T>(reported_size) > MAX_DESCRIPTOR_SIZE) {
+                    if (allocated_buffer) {
+                        PVOID free_base = reinterpret_cast<PVOID>(allocated_buffer);
+                        SIZE_T free_size = allocated_size;
+                        nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
+                        allocated_buffer = nullptr;
                     }
+                    nt_close(device);
+                    continue;
+                }
+            }
 
-                    is_vm = true;
-                    break;
+            // Serial number string within the descriptor structure
+            const u32 serial_offset = descriptor->SerialNumberOffset;
+            if (serial_offset > 0 && serial_offset < descriptor->Size) {
+                const char* serial = reinterpret_cast<const char*>(descriptor) + serial_offset;
+                const size_t max_avail = static_cast<size_t>(descriptor->Size) - static_cast<size_t>(serial_offset);
+                const size_t serialLen = strnlen(serial, max_avail);
+
+                debug("DISK_SERIAL: ", serial);
+
+                // Check the retrieved serial number against known VM artifacts
+                if (is_qemu_serial(serial) || is_vbox_serial(serial, serialLen)) {
+                    if (allocated_buffer) {
+                        PVOID free_base = reinterpret_cast<PVOID>(allocated_buffer);
+                        SIZE_T free_size = allocated_size;
+                        nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
+                        allocated_buffer = nullptr;
+                    }
+                    nt_close(device);
+                    return true;
                 }
-                __except (EXCEPTION_EXECUTE_HANDLER) {}
             }
-        }
 
-        if (is_vm) {
-            switch (b) {
-                case 1:  return core::add(brand_enum::VMWARE_EXPRESS);
-                case 2:  return core::add(brand_enum::VMWARE_ESX);
-                case 3:  return core::add(brand_enum::VMWARE_GSX);
-                case 4:  return core::add(brand_enum::VMWARE_WORKSTATION);
-                default: return core::add(brand_enum::VMWARE);
+            // Cleanup for the current iteration if no VM was detected on this drive
+            if (allocated_buffer) {
+                PVOID free_base = reinterpret_cast<PVOID>(allocated_buffer);
+                SIZE_T free_size = allocated_size;
+                nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
+                allocated_buffer = nullptr;
             }
+            nt_close(device);
         }
-    #endif
-        return is_vm;
+
+		// If we couldn't open any physical drives (not even read permissions) it's weird so we flag it.
+        if (successful_opens == 0) {
+            debug("DISK_SERIAL: No physical drives detected");
+            return true;
+        }
+
+        return result;
     }
 
 
     /**
-     * @brief Check for mutex strings of VM brands
+     * @brief Check for IVSHMEM device presence
      * @category Windows
-     * @author from VMDE project
-     * @author hfiref0x
-     * @implements VM::MUTEX
+     * @author dmfrpro (https://github.com/dmfrpro)
+     * @implements VM::IVSHMEM
      */
-    [[nodiscard]] static bool mutex() {
+    [[nodiscard]] static bool ivshmem() {
+        typedef struct _KEY_FULL_INFORMATION {
+            LARGE_INTEGER LastWriteTime;
+            ULONG         TitleIndex;
+            ULONG         ClassOffset;
+            ULONG         ClassLength;
+            ULONG         SubKeys;
+            ULONG         MaxNameLen;
+            ULONG         MaxClassLen;
+            ULONG         Values;
+            ULONG         MaxValueNameLen;
+            ULONG         MaxValueDataLen;
+            WCHAR         Class[1];
+        } KEY_FULL_INFORMATION, * PKEY_FULL_INFORMATION;
+
+        typedef enum _KEY_INFORMATION_CLASS {
+            KeyBasicInformation,
+            KeyNodeInformation,
+            KeyFullInformation,
+            KeyNameInformation,
+            KeyCachedInformation,
+            KeyFlagsInformation,
+            KeyVirtualizationInformation,
+            KeyHandleTagsInformation,
+            KeyTrustInformation,
+            KeyLayerInformation,
+            MaxKeyInfoClass
+        } KEY_INFORMATION_CLASS;
+
         const HMODULE ntdll = util::get_ntdll();
         if (!ntdll) return false;
 
-        using RtlInitUnicodeString_t = void(__stdcall*)(PUNICODE_STRING DestinationString, PCWSTR SourceString);
-        using NtClose_t = NTSTATUS(__stdcall*)(HANDLE Handle);
-        using NtOpenMutant_t = NTSTATUS(__stdcall*)(PHANDLE MutantHandle, ACCESS_MASK DesiredAccess, POBJECT_ATTRIBUTES ObjectAttributes);
-
-        const char* names[] = { "NtOpenMutant", "RtlInitUnicodeString", "NtClose" };
+        const char* names[] = { "RtlInitUnicodeString", "NtOpenKey", "NtQueryKey", "NtClose" };
         void* funcs[ARRAYSIZE(names)] = {};
         util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-        const auto nt_open_mutant = reinterpret_cast<NtOpenMutant_t>(funcs[0]);
-        const auto rtl_init_unicode_string = reinterpret_cast<RtlInitUnicodeString_t>(funcs[1]);
-        const auto nt_close = reinterpret_cast<NtClose_t>(funcs[2]);
+        const auto rtl_init_unicode_string = reinterpret_cast<void(__stdcall*)(PUNICODE_STRING, PCWSTR)>(funcs[0]);
+        const auto nt_open_key = reinterpret_cast<NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES)>(funcs[1]);
+        const auto nt_query_key = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, KEY_INFORMATION_CLASS, PVOID, ULONG, PULONG)>(funcs[2]);
+        const auto nt_close = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE)>(funcs[3]);
 
-        if (!nt_open_mutant || !rtl_init_unicode_string || !nt_close) {
+        if (!rtl_init_unicode_string || !nt_open_key || !nt_query_key || !nt_close) {
             return false;
         }
 
-        auto try_mutex_name = [&](const wchar_t* base_name) noexcept -> bool {
-            constexpr wchar_t prefix[] = L"\\BaseNamedObjects\\";
-            constexpr size_t prefix_len = (sizeof(prefix) / sizeof(wchar_t)) - 1;
+        // Targeted GUID for IVSHMEM (Inter-VM Shared Memory).
+        // This device is typically used in KVM/QEMU environments (like Looking Glass) to pass memory between host and guest
+        constexpr GUID GUID_IVSHMEM_IFACE =
+        { 0xdf576976, 0x569d, 0x4672, { 0x95, 0xa0, 0xf5, 0x7e, 0x4e, 0xa0, 0xb2, 0x10 } };
 
-            wchar_t full_path[260];
+        // Construct the registry path for the DeviceClasses key
+        // We access the "DeviceClasses" registry hive directly to find hardware interfaces
+        wchar_t interface_class_path[256];
+        swprintf_s(
+            interface_class_path,
+            ARRAYSIZE(interface_class_path),
+            L"\\Registry\\Machine\\SYSTEM\\CurrentControlSet\\Control\\DeviceClasses\\{%08lX-%04hX-%04hX-%02hhX%02hhX-%02hhX%02hhX%02hhX%02hhX%02hhX%02hhX}",
+            GUID_IVSHMEM_IFACE.Data1, GUID_IVSHMEM_IFACE.Data2, GUID_IVSHMEM_IFACE.Data3,
+            GUID_IVSHMEM_IFACE.Data4[0], GUID_IVSHMEM_IFACE.Data4[1], GUID_IVSHMEM_IFACE.Data4[2],
+            GUID_IVSHMEM_IFACE.Data4[3], GUID_IVSHMEM_IFACE.Data4[4], GUID_IVSHMEM_IFACE.Data4[5],
+            GUID_IVSHMEM_IFACE.Data4[6], GUID_IVSHMEM_IFACE.Data4[7]
+        );
 
-            // memcpy as it is faster than wcscpy/wcscat
-            memcpy(full_path, prefix, sizeof(prefix)); 
+        UNICODE_STRING unicode_path;
+        rtl_init_unicode_string(&unicode_path, interface_class_path);
 
-            const size_t name_len = wcslen(base_name);
-            if (prefix_len + name_len < 260) {
-                memcpy(full_path + prefix_len, base_name, (name_len + 1) * sizeof(wchar_t));
-            }
-            else {
-                // should not happen for standard VM artifacts
-                full_path[0] = L'\0';
-            }
+        OBJECT_ATTRIBUTES object_attributes;
+        RtlZeroMemory(&object_attributes, sizeof(object_attributes));
+        object_attributes.Length = sizeof(object_attributes);
+        object_attributes.ObjectName = &unicode_path;
+        object_attributes.Attributes = OBJ_CASE_INSENSITIVE;
 
-            const wchar_t* attempts[] = { full_path, base_name };
+        HANDLE key = nullptr;
+        NTSTATUS st = nt_open_key(&key, KEY_READ, &object_attributes);
+        if (!NT_SUCCESS(st) || key == nullptr) {
+            return false;
+        }
 
-            for (const wchar_t* path : attempts) {
-                if (*path == L'\0') continue;
+        // We query the "Full Information" of the key to get the count of subkeys
+        // The existence of the class key alone isn't enough cuz Windows might register the class but have no devices
+        // If SubKeys > 0, it means actual device instances (for ex. PCI devices) are registered under this interface
+        BYTE info_buffer[512] = {};
+        ULONG returned_len = 0;
+        st = nt_query_key(key, KeyFullInformation, info_buffer, sizeof(info_buffer), &returned_len);
 
-                UNICODE_STRING u_name;
-                rtl_init_unicode_string(&u_name, path);
+        DWORD number_of_subkeys = 0;
+        if (NT_SUCCESS(st) && returned_len >= sizeof(KEY_FULL_INFORMATION)) {
+            auto* kfi = reinterpret_cast<KEY_FULL_INFORMATION*>(info_buffer);
+            number_of_subkeys = static_cast<DWORD>(kfi->SubKeys);
+        }
+        else {
+            nt_close(key);
+            return false;
+        }
 
-                OBJECT_ATTRIBUTES obj_attr;
-                memset(&obj_attr, 0, sizeof(obj_attr));
-                obj_attr.Length = sizeof(obj_attr);
-                obj_attr.ObjectName = &u_name;
-                obj_attr.Attributes = OBJ_CASE_INSENSITIVE;
+        nt_close(key);
 
-                HANDLE h_mutant = nullptr;
-                const NTSTATUS st = nt_open_mutant(&h_mutant, MUTANT_QUERY_STATE, &obj_attr);
+        return number_of_subkeys > 0;
+    }
 
-                if (NT_SUCCESS(st)) {
-                    if (h_mutant) nt_close(h_mutant);
-                    return true;
-                }
+
+    /**
+     * @brief Check for GPU capabilities related to VMs
+     * @category Windows
+     * @implements VM::GPU_CAPABILITIES
+     */
+    [[nodiscard]] static bool gpu_capabilities() {
+        /*
+            Microsoft::WRL::ComPtr<IDirect3D9> d3d9 {
+                Direct3DCreate9(D3D_SDK_VERSION)
+            };
+
+            if (!d3d9) {
+                debug("GPU_CAPABILITIES: Direct3DCreate9 failed");
+                return true;
             }
 
-            return false;
-        };
+            D3DCAPS9 caps;
+            if (FAILED(d3d9->GetDeviceCaps(D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, &caps))) {
+                debug("GPU_CAPABILITIES: GetDeviceCaps failed");
+                return false;
+            }
 
-        if (try_mutex_name(L"Sandboxie_SingleInstanceMutex_Control") ||
-            try_mutex_name(L"SBIE_BOXED_ServiceInitComplete_Mutex1")) {
-            debug("MUTEX: Detected Sandboxie");
-            return core::add(brand_enum::SANDBOXIE);
-        }
+            // if the driver cannot adjust the display gamma ramp dynamically but only in full-screen mode—via the IDirect3DDevice9::SetGammaRamp API
+            return !(caps.Caps2 & D3DCAPS2_FULLSCREENGAMMA);
+        */
 
-        if (try_mutex_name(L"MicrosoftVirtualPC7UserServiceMakeSureWe'reTheOnlyOneMutex")) {
-            debug("MUTEX: Detected VPC");
-            return core::add(brand_enum::VPC);
+        const HDC hdc = GetDC(nullptr);
+        if (!hdc) {
+            return true;
         }
 
-        return false;
+        const int color_caps = GetDeviceCaps(hdc, COLORMGMTCAPS);
+        ReleaseDC(nullptr, hdc);
+
+        return !(color_caps & CM_GAMMA_RAMP) || color_caps == 0;
     }
 
 
     /**
-     * @brief Check for cuckoo directory using crt and WIN API directory functions
+     * @brief Check for vm-specific devices
      * @category Windows
-     * @author 一半人生
-     * @link https://unprotect.it/snippet/checking-specific-folder-name/196/
-     * @implements VM::CUCKOO_DIR
+     * @implements VM::HANDLES
      */
-    [[nodiscard]] static bool cuckoo_dir() {
-        using NtOpenFile_t = NTSTATUS(__stdcall*)(PHANDLE FileHandle, ACCESS_MASK DesiredAccess,
-            POBJECT_ATTRIBUTES ObjectAttributes, PIO_STATUS_BLOCK IoStatusBlock,
-            ULONG ShareAccess, ULONG OpenOptions);
-        using RtlInitUnicodeString_t = void(__stdcall*)(PUNICODE_STRING DestinationString, PCWSTR SourceString);
-        using NtClose_t = NTSTATUS(__stdcall*)(HANDLE Handle);
-
+    [[nodiscard]] static bool device_handles() {
         const HMODULE ntdll = util::get_ntdll();
         if (!ntdll) return false;
 
-        const char* names[] = { "NtOpenFile", "RtlInitUnicodeString", "NtClose" };
+        const char* names[] = { "RtlInitUnicodeString", "NtOpenFile", "NtClose" };
         void* funcs[ARRAYSIZE(names)] = {};
-        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
+        util::get_function_address(ntdll, names, funcs, (ULONG)(sizeof(names) / sizeof(names[0])));
 
-        const auto nt_open_file = reinterpret_cast<NtOpenFile_t>(funcs[0]);
-        const auto rtl_init_unicode_string = reinterpret_cast<RtlInitUnicodeString_t>(funcs[1]);
-        const auto nt_close = reinterpret_cast<NtClose_t>(funcs[2]);
+        const auto rtl_init_unicode_string = reinterpret_cast<void(__stdcall*)(PUNICODE_STRING, PCWSTR)>(funcs[0]);
+        const auto nt_open_file = reinterpret_cast<NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES, PIO_STATUS_BLOCK, ULONG, ULONG)>(funcs[1]);
+        const auto nt_close = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE)>(funcs[2]);
 
-        if (!nt_open_file || !rtl_init_unicode_string || !nt_close) {
+        if (!rtl_init_unicode_string || !nt_open_file || !nt_close) {
             return false;
         }
 
-        const wchar_t* native_path = L"\\??\\C:\\Cuckoo";
-        UNICODE_STRING path;
-        rtl_init_unicode_string(&path, native_path);
-
-        OBJECT_ATTRIBUTES object_attributes;
-        ZeroMemory(&object_attributes, sizeof(object_attributes));
-        object_attributes.Length = sizeof(object_attributes);
-        object_attributes.ObjectName = &path;
-        object_attributes.Attributes = OBJ_CASE_INSENSITIVE;
+        auto try_open_mutex = [&](const wchar_t* native_path) noexcept -> HANDLE {
+            UNICODE_STRING u_path{};
+            u_path.Buffer = const_cast<wchar_t*>(native_path);
+            const size_t len_bytes = wcslen(native_path) * sizeof(wchar_t);
+            u_path.Length = static_cast<USHORT>(len_bytes);
+            u_path.MaximumLength = static_cast<USHORT>(len_bytes + sizeof(wchar_t));
 
-        IO_STATUS_BLOCK iosb;
-        HANDLE hFile = nullptr;
+            OBJECT_ATTRIBUTES obj_attr = {
+                sizeof(OBJECT_ATTRIBUTES),
+                nullptr,
+                &u_path,
+                OBJ_CASE_INSENSITIVE,
+                nullptr,
+                nullptr
+            };
 
-        constexpr ACCESS_MASK desired_access = FILE_READ_ATTRIBUTES; 
-        constexpr ULONG share_access = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
-        constexpr ULONG open_options = FILE_OPEN | FILE_SYNCHRONOUS_IO_NONALERT | FILE_DIRECTORY_FILE;
+            IO_STATUS_BLOCK iosb;
+            HANDLE h_file = nullptr;
 
-        const NTSTATUS st = nt_open_file(&hFile, desired_access, &object_attributes, &iosb, share_access, open_options);
-        if (NT_SUCCESS(st)) {
-            if (hFile) nt_close(hFile);
-            return core::add(brand_enum::CUCKOO);
-        }
+            constexpr ACCESS_MASK desired_access = FILE_READ_DATA | FILE_READ_ATTRIBUTES | SYNCHRONIZE;
+            constexpr ULONG share_access = FILE_SHARE_READ;
+            constexpr ULONG open_options = FILE_OPEN | FILE_SYNCHRONOUS_IO_NONALERT;
 
-        return false;
-    }
-                
-                
-    /**
-     * @brief Check for Cuckoo specific piping mechanism
-     * @category Windows
-     * @author Thomas Roccia (fr0gger)
-     * @link https://unprotect.it/snippet/checking-specific-folder-name/196/
-     * @implements VM::CUCKOO_PIPE
-     */
-    [[nodiscard]] static bool cuckoo_pipe() {
-        using NtOpenFile_t = NTSTATUS(__stdcall*)(PHANDLE FileHandle, ACCESS_MASK DesiredAccess,
-            POBJECT_ATTRIBUTES ObjectAttributes, PIO_STATUS_BLOCK IoStatusBlock,
-            ULONG ShareAccess, ULONG OpenOptions);
-        using RtlInitUnicodeString_t = void(__stdcall*)(PUNICODE_STRING DestinationString, PCWSTR SourceString);
-        using NtClose_t = NTSTATUS(__stdcall*)(HANDLE Handle);
+            const NTSTATUS st = nt_open_file(&h_file, desired_access, &obj_attr, &iosb, share_access, open_options);
 
-        const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll) return false;
+            if (NT_SUCCESS(st)) {
+                return h_file;
+            }
+            return INVALID_HANDLE_VALUE;
+        };
 
-        const char* names[] = { "NtOpenFile", "RtlInitUnicodeString", "NtClose" };
-        void* funcs[ARRAYSIZE(names)] = {};
-        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
+        constexpr const wchar_t* paths[] = {
+            L"\\??\\VBoxMiniRdrDN",    // \\.\VBoxMiniRdrDN
+            L"\\??\\pipe\\VBoxMiniRdDN",// \\.\pipe\VBoxMiniRdDN
+            L"\\??\\VBoxTrayIPC",      // \\.\VBoxTrayIPC
+            L"\\??\\pipe\\VBoxTrayIPC",// \\.\pipe\VBoxTrayIPC
+            L"\\??\\HGFS",             // \\.\HGFS (VMware)
+            L"\\??\\pipe\\cuckoo"      // \\.\pipe\cuckoo (Cuckoo)
+        };
 
-        const auto nt_open_file = reinterpret_cast<NtOpenFile_t>(funcs[0]);
-        const auto rtl_init_unicode_string = reinterpret_cast<RtlInitUnicodeString_t>(funcs[1]);
-        const auto nt_close = reinterpret_cast<NtClose_t>(funcs[2]);
+        const size_t path_count = sizeof(paths) / sizeof(paths[0]);
+        HANDLE handles[sizeof(paths) / sizeof(paths[0])] = {};
 
-        if (!nt_open_file || !rtl_init_unicode_string || !nt_close) {
-            return false;
+        for (size_t i = 0; i < path_count; ++i) {
+            handles[i] = try_open_mutex(paths[i]);
         }
 
-        const wchar_t* pipe_path = L"\\??\\pipe\\cuckoo";
-        UNICODE_STRING pipe;
-        rtl_init_unicode_string(&pipe, pipe_path);
+        const bool vbox = (handles[0] != INVALID_HANDLE_VALUE) ||
+            (handles[1] != INVALID_HANDLE_VALUE) ||
+            (handles[2] != INVALID_HANDLE_VALUE) ||
+            (handles[3] != INVALID_HANDLE_VALUE);
+
+        const bool vmware = (handles[4] != INVALID_HANDLE_VALUE);
+        const bool cuckoo = (handles[5] != INVALID_HANDLE_VALUE);
 
-        OBJECT_ATTRIBUTES object_attributes;
-        ZeroMemory(&object_attributes, sizeof(object_attributes));
-        object_attributes.Length = sizeof(object_attributes);
-        object_attributes.ObjectName = &pipe;
-        object_attributes.Attributes = OBJ_CASE_INSENSITIVE;
+        for (size_t i = 0; i < path_count; ++i) {
+            if (handles[i] != INVALID_HANDLE_VALUE) {
+                (void)nt_close(handles[i]);
+                handles[i] = INVALID_HANDLE_VALUE;
+            }
+        }
 
-        IO_STATUS_BLOCK iosb;
-        HANDLE h_pipe = nullptr;
+        if (vbox) {
+            debug("HANDLES: Detected VBox related device handles");
+            return core::add(brand_enum::VBOX);
+        }
 
-        constexpr ACCESS_MASK desired_access = FILE_READ_DATA | FILE_READ_ATTRIBUTES;
-        constexpr ULONG share_access = 0;
-        constexpr ULONG open_options = FILE_OPEN | FILE_SYNCHRONOUS_IO_NONALERT;
+        if (vmware) {
+            debug("HANDLES: Detected VMware related device (HGFS)");
+            return core::add(brand_enum::VMWARE);
+        }
 
-        const NTSTATUS st = nt_open_file(&h_pipe, desired_access, &object_attributes, &iosb, share_access, open_options);
-        if (NT_SUCCESS(st)) {
-            if (h_pipe) nt_close(h_pipe);
+        if (cuckoo) {
+            debug("HANDLES: Detected Cuckoo related device (pipe)");
             return core::add(brand_enum::CUCKOO);
         }
 
@@ -8560,3620 +11234,4100 @@ public:
 
 
     /**
-     * @brief Check for display configurations commonly found in VMs
-     * @category Windows
-     * @implements VM::DISPLAY
+     * @brief Check if the number of virtual and logical processors are reported correctly by the system
+     * @category Windows, x86
+     * @implements VM::VIRTUAL_PROCESSORS
      */
-    [[nodiscard]] static bool display() {
-        const HDC hdc = GetDC(nullptr);
-        const int bpp = GetDeviceCaps(hdc, BITSPIXEL) *
-            GetDeviceCaps(hdc, PLANES);
-        const int logpix = GetDeviceCaps(hdc, LOGPIXELSX);
-        ReleaseDC(nullptr, hdc);
-
-        // physical monitors are almost always 32bpp and 96–144 DPI
-        if (bpp != 32 || logpix < 90)
-            return true;
+    [[nodiscard]] static bool virtual_processors() {
+    #if (x86)
+        int regs[4];
+        __cpuid(regs, 0x40000000);
 
-        return false;
-    }
+        const u32 max_leaf = static_cast<u32>(regs[0]);
+        if (max_leaf < 0x40000005) {
+            return false;
+        }
 
+        __cpuid(regs, 0x40000005);
+        const u32 max_virtual_processors = static_cast<u32>(regs[0]);
+        const u32 max_logical_processors = static_cast<u32>(regs[1]);
 
-    /**
-     * @brief Check if bogus device string would be accepted
-     * @category Windows
-     * @author Huntress Research Team
-     * @link https://unprotect.it/technique/buildcommdcbandtimeouta/
-     * @implements VM::DEVICE_STRING
-     */
-    [[nodiscard]] static bool device_string() {
-        DCB dcb = { 0 };
-        COMMTIMEOUTS timeouts = { 0 };
+        debug("VIRTUAL_PROCESSORS: MaxVirtualProcessors -> ", max_virtual_processors,
+            ", MaxLogicalProcessors -> ", max_logical_processors);
 
-        if (BuildCommDCBAndTimeoutsA("jhl46745fghb", &dcb, &timeouts)) {
+        if (max_virtual_processors == 0xFFFFFFFF || max_logical_processors == 0) {
             return true;
-        } else {
-            return false;
         }
+    #endif
+        return false;
     }
 
 
     /**
-     * @brief Check for VM-specific names for drivers
-     * @category Windows
-     * @implements VM::DRIVERS
+     * @brief Check if a call to NtQuerySystemInformation with the 0x9f leaf fills a _SYSTEM_HYPERVISOR_DETAIL_INFORMATION structure
+     * @category Windows, x86_64
+     * @implements VM::HYPERVISOR_QUERY
      */
-    [[nodiscard]] static bool drivers() {
-        struct _SYSTEM_MODULE_INFORMATION {
-            PVOID  Reserved[2];
-            PVOID  ImageBaseAddress;
-            ULONG  ImageSize;
-            ULONG  Flags;
-            USHORT Index;
-            USHORT NameLength;
-            USHORT LoadCount;
-            USHORT PathLength;
-            CHAR   ImageName[256];
-        };
+    [[nodiscard]] static bool hypervisor_query() {
+    #if (x86_32)
+        return false;
+    #else
+        if (util::hyper_x() == HYPERV_ARTIFACT_VM) {
+            return false;
+        }
 
-        struct _SYSTEM_MODULE_INFORMATION_EX {
-            ULONG  NumberOfModules;
-            _SYSTEM_MODULE_INFORMATION Module[1];
+        struct HV_DETAILS {
+            ULONG Data[4];
+        };
+        struct SYSTEM_HYPERVISOR_DETAIL_INFORMATION {
+            HV_DETAILS HvVendorAndMaxFunction;
+            HV_DETAILS HypervisorInterface;
+            HV_DETAILS HypervisorVersion;
+            HV_DETAILS HvFeatures;
+            HV_DETAILS HwFeatures;
+            HV_DETAILS EnlightenmentInfo;
+            HV_DETAILS ImplementationLimits;
         };
 
-        using SYSTEM_MODULE_INFORMATION = _SYSTEM_MODULE_INFORMATION;
-        using PSYSTEM_MODULE_INFORMATION = _SYSTEM_MODULE_INFORMATION*;
-        using SYSTEM_MODULE_INFORMATION_EX = _SYSTEM_MODULE_INFORMATION_EX;
-        using PSYSTEM_MODULE_INFORMATION_EX = _SYSTEM_MODULE_INFORMATION_EX*;
+        using PHV_DETAILS = HV_DETAILS*;
+        using PSYSTEM_HYPERVISOR_DETAIL_INFORMATION = SYSTEM_HYPERVISOR_DETAIL_INFORMATION*;
 
-        using NtQuerySystemInformationFn = NTSTATUS(__stdcall*)(ULONG SystemInformationClass, PVOID SystemInformation, ULONG SystemInformationLength, PULONG ReturnLength);
-        using NtAllocateVirtualMemoryFn = NTSTATUS(__stdcall*)(
-            HANDLE ProcessHandle,
-            PVOID* BaseAddress,
-            ULONG_PTR ZeroBits,
-            PSIZE_T RegionSize,
-            ULONG AllocationType,
-            ULONG Protect
+        using FN_NtQuerySystemInformation = NTSTATUS(__stdcall*)(
+            SYSTEM_INFORMATION_CLASS SystemInformationClass,
+            PVOID SystemInformation,
+            ULONG SystemInformationLength,
+            PULONG ReturnLength
         );
-        using NtFreeVirtualMemoryFn = NTSTATUS(__stdcall*)(HANDLE ProcessHandle, PVOID* BaseAddress, PSIZE_T RegionSize, ULONG FreeType);
 
-        constexpr ULONG system_module_information = 11;
         const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll) return false;
+        if (!ntdll) return false;        
 
-        const char* names[] = { "NtQuerySystemInformation", "NtAllocateVirtualMemory", "NtFreeVirtualMemory" };
+        const char* names[] = { "NtQuerySystemInformation" };
         void* funcs[ARRAYSIZE(names)] = {};
         util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-        const auto nt_query_system_information = reinterpret_cast<NtQuerySystemInformationFn>(funcs[0]);
-        const auto nt_allocate_virtual_memory = reinterpret_cast<NtAllocateVirtualMemoryFn>(funcs[1]);
-        const auto nt_free_virtual_memory = reinterpret_cast<NtFreeVirtualMemoryFn>(funcs[2]);
-
-        if (nt_query_system_information == nullptr || nt_allocate_virtual_memory == nullptr || nt_free_virtual_memory == nullptr)
-            return false;
-        
-        ULONG ul_size = 0;
-        NTSTATUS status = nt_query_system_information(system_module_information, nullptr, 0, &ul_size);
-        if (status != ((NTSTATUS)0xC0000004L)) return false;
-
-        const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
-        PVOID allocated_memory = nullptr;
-        SIZE_T region_size = ul_size;
-        nt_allocate_virtual_memory(current_process, &allocated_memory, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        const FN_NtQuerySystemInformation nt_query_system_information = reinterpret_cast<FN_NtQuerySystemInformation>(funcs[0]);
+        if (nt_query_system_information) {
+            SYSTEM_HYPERVISOR_DETAIL_INFORMATION hypervisor_information = { {} };
 
-        const auto system_module_info_ex = reinterpret_cast<PSYSTEM_MODULE_INFORMATION_EX>(allocated_memory);
-        status = nt_query_system_information(system_module_information, system_module_info_ex, ul_size, &ul_size);
-        if (!(((NTSTATUS)(status)) >= 0)) {
-            nt_free_virtual_memory(current_process, &allocated_memory, &region_size, MEM_RELEASE);
-            return false;
-        }
+            // Request class 0x9F (SystemHypervisorDetailInformation)
+            // This asks the OS kernel to fill the structure with information about the 
+            // hypervisor layer it is running on top of
+            const NTSTATUS status = nt_query_system_information(static_cast<SYSTEM_INFORMATION_CLASS>(0x9F), &hypervisor_information, sizeof(hypervisor_information), nullptr);
 
-        for (ULONG i = 0; i < system_module_info_ex->NumberOfModules; ++i) {
-            const char* driverPath = reinterpret_cast<const char*>(system_module_info_ex->Module[i].ImageName);
-            if (
-                strstr(driverPath, "VBoxGuest") || // only installed after vbox guest additions
-                strstr(driverPath, "VBoxMouse") ||
-                strstr(driverPath, "VBoxSF")
-            ) {
-                debug("DRIVERS: Detected VBox driver: ", driverPath);
-                nt_free_virtual_memory(current_process, &allocated_memory, &region_size, MEM_RELEASE);
-                return core::add(brand_enum::VBOX);
+            if (status != 0) {
+                return false;
             }
 
-            if (
-                strstr(driverPath, "vmusbmouse") ||
-                strstr(driverPath, "vmmouse") ||
-                strstr(driverPath, "vmmemctl")
-            ) {
-                debug("DRIVERS: Detected VMware driver: ", driverPath);
-                nt_free_virtual_memory(current_process, &allocated_memory, &region_size, MEM_RELEASE);
-                return core::add(brand_enum::VMWARE);
+            // If Data[0] is non-zero, it means the kernel has successfully communicated 
+            // with a hypervisor and retrieved a vendor signature like "Micr" for Microsoft
+            if (hypervisor_information.HvVendorAndMaxFunction.Data[0] != 0) {
+                return true;
             }
         }
-
-        nt_free_virtual_memory(current_process, &allocated_memory, &region_size, MEM_RELEASE);
+    #endif
         return false;
     }
 
-
+    
     /**
-     * @brief Check for serial numbers of virtual disks
+     * @brief Check for particular object directory which is present in Sandboxie virtual environment but not in usual host systems
      * @category Windows
-     * @implements VM::DISK_SERIAL
+     * @link https://evasions.checkpoint.com/src/Evasions/techniques/global-os-objects.html
+     * @implements VM::VIRTUAL_REGISTRY
      */
-    [[nodiscard]] static bool disk_serial_number() {
-        using NtOpenFile_t = NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES, PIO_STATUS_BLOCK, ULONG, ULONG);
-        using NtDeviceIoControlFile_t = NTSTATUS(__stdcall*)(HANDLE, HANDLE, PVOID, PVOID, PIO_STATUS_BLOCK, ULONG, PVOID, ULONG, PVOID, ULONG);
-        using NtAllocateVirtualMemory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG);
-        using NtFreeVirtualMemory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG);
-        using NtClose_t = NTSTATUS(__stdcall*)(HANDLE);
-        using RtlInitUnicodeString_t = void(__stdcall*)(PUNICODE_STRING, PCWSTR);
+    [[nodiscard]] static bool virtual_registry() {
+        struct UNICODE_STRING {
+            USHORT Length;
+            USHORT MaximumLength;
+            PWSTR  Buffer;
+        };
+        struct OBJECT_ATTRIBUTES {
+            ULONG Length;
+            HANDLE RootDirectory;
+            UNICODE_STRING* ObjectName;
+            ULONG Attributes;
+            PVOID SecurityDescriptor;
+            PVOID SecurityQualityOfService;
+        };
+        enum OBJECT_INFORMATION_CLASS {
+            ObjectBasicInformation = 0,
+            ObjectNameInformation = 1,
+            ObjectTypeInformation = 2
+        };
+        struct OBJECT_NAME_INFORMATION {
+            UNICODE_STRING Name;
+        };
 
-        bool result = false;
-        constexpr u8 MAX_PHYSICAL_DRIVES = 4;
-        constexpr SIZE_T MAX_DESCRIPTOR_SIZE = 64 * 1024;
-        u8 successful_opens = 0;
+        using POBJECT_NAME_INFORMATION = OBJECT_NAME_INFORMATION*;
+        using PNtOpenKey = NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES );
+        using PNtQueryObject = NTSTATUS(__stdcall*)(HANDLE, OBJECT_INFORMATION_CLASS, PVOID, ULONG, PULONG);
+    
+        const HMODULE ntdll = util::get_ntdll();
+        if (!ntdll) return false;
+    
+        const char* names[] = { "NtOpenKey", "NtQueryObject", "NtClose" };
+        void* funcs[ARRAYSIZE(names)] = {};
+        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
+    
+        const auto nt_open_key = reinterpret_cast<PNtOpenKey>(funcs[0]);
+        const auto nt_query_object = reinterpret_cast<PNtQueryObject>(funcs[1]);
+        const auto nt_close = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE)>(funcs[2]);
 
-        // Helper to detect QEMU instances based on default hard drive serial patterns
-        // QEMU drives often start with "QM000" followed by digits
-        auto is_qemu_serial = [](const char* str) noexcept -> bool {
-            if ((str[0] & 0xDF) != 'Q') return false;
-            if ((str[1] & 0xDF) != 'M') return false;
+        if (!nt_open_key || !nt_query_object || !nt_close)
+            return false;
+    
+        // Prepare to open the root USER registry hive
+        UNICODE_STRING key_path{};
+        key_path.Buffer = const_cast<PWSTR>(L"\\REGISTRY\\USER");
+        key_path.Length = static_cast<USHORT>(wcslen(key_path.Buffer) * sizeof(WCHAR));
+        key_path.MaximumLength = key_path.Length + sizeof(WCHAR);
 
-            // we check byte-by-byte to be safe regarding alignment,
-            // though a 32-bit integer check (0x30303030) could be used if alignment is guaranteed
-            // we also essentially check for null termination safety here because '\0' != '0'
-            return str[2] == '0' && str[3] == '0' && str[4] == '0' && str[5] == '0';
+        OBJECT_ATTRIBUTES object_attributes = {
+            sizeof(OBJECT_ATTRIBUTES),
+            nullptr,
+            &key_path,
+            0x00000040L,  // OBJ_CASE_INSENSITIVE
+            nullptr,
+            nullptr
         };
 
-        // Helper to detect VirtualBox instances
-        // VirtualBox uses a specific serial format "VB" followed by hex segments
-        auto is_vbox_serial = [](const char* str, size_t len) noexcept -> bool {
-            // format: VB12345678-12345678 (19 chars)
-            if (len != 19) return false;
+        // Attempt to open the key. If we are sandboxed, this open call often succeeds,
+        // but the underlying handle will point to a virtualized container, not the real OS path
+        HANDLE key = nullptr;
+        NTSTATUS status = nt_open_key(&key, KEY_READ, reinterpret_cast<POBJECT_ATTRIBUTES>(&object_attributes));
+        if (!(((NTSTATUS)(status)) >= 0))
+            return false;
 
-            if ((str[0] & 0xDF) != 'V' || (str[1] & 0xDF) != 'B') {
-                return false;
-            }
-            if (str[10] != '-') return false;
+        // Ask the kernel: "What is the actual name of the object this handle points to?"
+        // Sandboxie implements file system and registry virtualization by redirecting access
+        // While the API pretends we opened "\REGISTRY\USER", the handle might actually point to 
+        // something like "\Device\HarddiskVolume2\Sandbox\User\DefaultBox\RegHive"
+        alignas(16) BYTE buffer[1024]{};
+        ULONG returned_length = 0;
+        status = nt_query_object(key, ObjectNameInformation, buffer, sizeof(buffer), &returned_length);
+        nt_close(key);
+        if (!(((NTSTATUS)(status)) >= 0))
+            return false;
 
-            auto is_hex = [](char c) noexcept -> bool {
-                const char lower = c | 0x20;
-                return (c >= '0' && c <= '9') 
-                    || (lower >= 'a' && lower <= 'f');
-            };
+        const auto object_name = reinterpret_cast<POBJECT_NAME_INFORMATION>(buffer);
 
-            for (size_t i = 2; i < 10; ++i) {
-                if (!is_hex(str[i])) return false;
-            }
+        UNICODE_STRING expected_name{};
+        expected_name.Buffer = const_cast<PWSTR>(L"\\REGISTRY\\USER");
+        expected_name.Length = static_cast<USHORT>(wcslen(expected_name.Buffer) * sizeof(WCHAR));
 
-            for (size_t i = 11; i < 19; ++i) {
-                if (!is_hex(str[i])) return false;
-            }
+        // Compare the requested name vs the actual kernel object name
+        // If they don't match, we have been redirected, confirming the presence of Sandboxie
+        const bool mismatch = (object_name->Name.Length != expected_name.Length) ||
+            (memcmp(object_name->Name.Buffer, expected_name.Buffer, expected_name.Length) != 0);
 
-            return true;
+        return mismatch ? core::add(brand_enum::SANDBOXIE) : false;
+    }
+    
+    
+    /**
+     * @brief Check if no waveform-audio output devices are present in the system
+     * @category Windows
+     * @implements VM::AUDIO
+     */
+    [[nodiscard]] static bool audio() {
+        struct KEY_FULL_INFORMATION {
+            LARGE_INTEGER LastWriteTime;
+            ULONG         TitleIndex;
+            ULONG         ClassOffset;
+            ULONG         ClassLength;
+            ULONG         SubKeys;
+            ULONG         MaxNameLen;
+            ULONG         MaxClassLen;
+            ULONG         Values;             
+            ULONG         MaxValueNameLen;
+            ULONG         MaxValueDataLen;
+            WCHAR         Class[1];
         };
+        using PKEY_FULL_INFORMATION = KEY_FULL_INFORMATION*;
 
-        auto strnlen = [](const char* s, size_t max) noexcept -> size_t {
-            const void* p = memchr(s, 0, max);
-            if (!p) return max;
-            return static_cast<size_t>(static_cast<const char*>(p) - s);
+        enum KEY_INFORMATION_CLASS {
+            KeyBasicInformation,
+            KeyNodeInformation,
+            KeyFullInformation,
+            KeyNameInformation,
+            KeyCachedInformation,
+            KeyFlagsInformation,
+            KeyVirtualizationInformation,
+            KeyHandleTagsInformation,
+            KeyTrustInformation,
+            KeyLayerInformation,
+            MaxKeyInfoClass
         };
 
         const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll) return result;
+        if (!ntdll) return false;
 
-        const char* names[] = {
-            "RtlInitUnicodeString",
-            "NtOpenFile",
-            "NtDeviceIoControlFile",
-            "NtAllocateVirtualMemory",
-            "NtFreeVirtualMemory",
-            "NtFlushInstructionCache",
-            "NtClose"
-        };
+        const char* names[] = { "RtlInitUnicodeString", "NtOpenKey", "NtQueryKey", "NtClose" };
         void* funcs[ARRAYSIZE(names)] = {};
         util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-        const auto rtl_init_unicode_string = reinterpret_cast<RtlInitUnicodeString_t>(funcs[0]);
-        const auto nt_open_file = reinterpret_cast<NtOpenFile_t>(funcs[1]);
-        const auto nt_device_io_control_file = reinterpret_cast<NtDeviceIoControlFile_t>(funcs[2]);
-        const auto nt_allocate_virtual_memory = reinterpret_cast<NtAllocateVirtualMemory_t>(funcs[3]);
-        const auto nt_free_virtual_memory = reinterpret_cast<NtFreeVirtualMemory_t>(funcs[4]);
-        const auto nt_close = reinterpret_cast<NtClose_t>(funcs[6]);
+        const auto rtl_init_unicode_string = reinterpret_cast<void(__stdcall*)(PUNICODE_STRING, PCWSTR)>(funcs[0]);
+        const auto nt_open_key = reinterpret_cast<NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES)>(funcs[1]);
+        const auto nt_query_key = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, KEY_INFORMATION_CLASS, PVOID, ULONG, PULONG)>(funcs[2]);
+        const auto nt_close = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE)>(funcs[3]);
 
-        if (!rtl_init_unicode_string || !nt_open_file || !nt_device_io_control_file ||
-            !nt_allocate_virtual_memory || !nt_free_virtual_memory || !nt_close) {
-            return result;
+        if (!rtl_init_unicode_string || !nt_open_key || !nt_query_key || !nt_close) {
+            return false;
         }
 
-        // Iterate through the first few physical drives (PhysicalDrive0 to PhysicalDrive3)
-        // Most systems boot from 0, and VMs rarely emulate more than 1 or 2 drives by default
-        for (u8 drive = 0; drive < MAX_PHYSICAL_DRIVES; ++drive) {
-            wchar_t path[32];
-            swprintf_s(path, L"\\??\\PhysicalDrive%u", drive);
+        // We are checking for the presence of Audio Render devices
+        // Most legitimate user PCs have speakers or headphones (audio endpoints)
+        // Automated sandboxes and headless servers often have no audio devices configured
+        // We target the MMDevices\Audio\Render key where these endpoints are registered
+        const wchar_t* native_path = L"\\Registry\\Machine\\SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\MMDevices\\Audio\\Render";
 
-            UNICODE_STRING unicode_path;
-            rtl_init_unicode_string(&unicode_path, path);
+        UNICODE_STRING unicode_path;
+        rtl_init_unicode_string(&unicode_path, native_path);
 
-            OBJECT_ATTRIBUTES object_attributes;
-            RtlZeroMemory(&object_attributes, sizeof(object_attributes));
-            object_attributes.Length = sizeof(object_attributes);
-            object_attributes.ObjectName = &unicode_path;
-            object_attributes.Attributes = OBJ_CASE_INSENSITIVE;
-            object_attributes.RootDirectory = nullptr;
+        OBJECT_ATTRIBUTES object_attributes;
+        RtlZeroMemory(&object_attributes, sizeof(object_attributes));
+        object_attributes.Length = sizeof(object_attributes);
+        object_attributes.ObjectName = &unicode_path;
+        object_attributes.Attributes = OBJ_CASE_INSENSITIVE;
 
-            IO_STATUS_BLOCK iosb;
-            HANDLE device = nullptr;
+        HANDLE key = nullptr;
+        const ACCESS_MASK desired_access = KEY_READ;
 
-            constexpr ACCESS_MASK desired_access = SYNCHRONIZE | FILE_READ_ATTRIBUTES;
-            constexpr ULONG share_access = FILE_SHARE_READ | FILE_SHARE_WRITE;
-            constexpr ULONG open_options = FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT;
+        NTSTATUS st = nt_open_key(&key, desired_access, &object_attributes);
+        if (!NT_SUCCESS(st) || key == nullptr) {
+            return false;
+        }
 
-            // Attempt to open the physical drive directly using Native API
-            NTSTATUS st = nt_open_file(&device, desired_access, &object_attributes, &iosb, share_access, open_options);
-            if (!NT_SUCCESS(st) || device == nullptr) {
-                continue;
-            }
-            ++successful_opens;
+        constexpr KEY_INFORMATION_CLASS InfoClass = KeyFullInformation;
+        std::vector<BYTE> info_buffer(512);
+        ULONG returned_len = 0;
 
-            // stack buffer attempt
-            // We first try to read the storage properties into a small stack buffer to avoid heap
-            BYTE stackBuf[512] = { 0 };
-            const STORAGE_DEVICE_DESCRIPTOR* descriptor = reinterpret_cast<STORAGE_DEVICE_DESCRIPTOR*>(stackBuf);
+        // Query the key information. If the buffer is too small (STATUS_BUFFER_TOO_SMALL),
+        // resize it to the exact length required by the kernel and try again
+        st = nt_query_key(key, InfoClass, info_buffer.data(), static_cast<ULONG>(info_buffer.size()), &returned_len);
 
-            STORAGE_PROPERTY_QUERY query{};
-            query.PropertyId = StorageDeviceProperty;
-            query.QueryType = PropertyStandardQuery;
+        if (!NT_SUCCESS(st) && returned_len > info_buffer.size()) {
+            info_buffer.resize(returned_len);
+            st = nt_query_key(key, InfoClass, info_buffer.data(), static_cast<ULONG>(info_buffer.size()), &returned_len);
+        }
 
-            const ULONG ioctl = IOCTL_STORAGE_QUERY_PROPERTY;
+        bool has_values = false;
+        if (NT_SUCCESS(st) && returned_len >= sizeof(KEY_FULL_INFORMATION)) {
+            const auto* kfi = reinterpret_cast<PKEY_FULL_INFORMATION>(info_buffer.data());
 
-            st = nt_device_io_control_file(device, nullptr, nullptr, nullptr, &iosb,
-                ioctl,
-                &query, sizeof(query),
-                stackBuf, sizeof(stackBuf));
+            // Check if the registry key has any values associated with it
+            // If 'Values' is 0, the audio system is likely uninitialized or barren,
+            // which strongly suggests a virtualized/sandbox environment
+            const DWORD value_count = static_cast<DWORD>(kfi->Values); // values, not subkeys
+            has_values = (value_count > 0);
+        }
+        else {
+            nt_close(key);
+            return false;
+        }
 
-            BYTE* allocated_buffer = nullptr;
-            SIZE_T allocated_size = 0;
-            const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
+        nt_close(key);
 
-            // If the stack buffer was too small (NtDeviceIoControlFile failed), we fall back 
-            // to allocating memory dynamically using NtAllocateVirtualMemory
-            if (!NT_SUCCESS(st)) {
-                DWORD reported_size = 0;
-                if (descriptor && descriptor->Size > 0) {
-                    reported_size = descriptor->Size;
-                }
+        return has_values;
+    }
+    
+    
+    /**
+     * @brief Check for VM-specific ACPI device signatures
+     * @category Windows
+     * @implements VM::ACPI_SIGNATURE
+     */
+    [[nodiscard]] static bool acpi_signature() {
+        auto is_hex = [](wchar_t c) noexcept -> bool {
+            return (c >= L'0' && c <= L'9') || (c >= L'A' && c <= L'F');
+        };
+
+        // enumerate all DISPLAY devices
+        const HDEVINFO handle_dev_info = SetupDiGetClassDevsW(&GUID_DEVCLASS_DISPLAY, nullptr, nullptr, DIGCF_PRESENT);
+        if (handle_dev_info == INVALID_HANDLE_VALUE) {
+            debug("ACPI_SIGNATURE: No display device detected");
+            return true;
+        }
+
+        SP_DEVINFO_DATA dev_info;
+        ZeroMemory(&dev_info, sizeof(dev_info));
+        dev_info.cbSize = sizeof(dev_info);
+        const DEVPROPKEY key = DEVPKEY_Device_LocationPaths;
+
+        // baremetal tokens (case-sensitive to preserve handling against edge-cases)
+        static constexpr const wchar_t* excluded_tokens[] = {
+            L"GFX",
+            L"IGD", L"IGFX", L"IGPU",
+            L"VGA", L"VIDEO", L"DISPLAY", L"GPU",
+            L"PCIROOT", L"PNP0A03", L"PNP0A08",
+            L"PCH", L"PXS", L"PEG", L"PEGP"
+        };
+
+        auto has_excluded_token = [&](const wchar_t* s) noexcept -> bool {
+            if (!s || !*s) return false;
+            for (const wchar_t* tok : excluded_tokens) {
+                if (wcsstr(s, tok) != nullptr) return true;
+            }
+            return false;
+        };
 
-                // This branch just ensures the requested size is reasonable before allocating
-                if (reported_size > 0 && reported_size < static_cast<DWORD>(MAX_DESCRIPTOR_SIZE) && reported_size >= sizeof(STORAGE_DEVICE_DESCRIPTOR)) {
-                    allocated_size = static_cast<SIZE_T>(reported_size);
-                    PVOID allocation_base = nullptr;
-                    SIZE_T region_size = allocated_size;
-                    st = nt_allocate_virtual_memory(current_process, &allocation_base, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-                    if (!NT_SUCCESS(st) || allocation_base == nullptr) {
-                        nt_close(device);
-                        continue;
-                    }
-                    allocated_buffer = reinterpret_cast<BYTE*>(allocation_base);
+        for (DWORD idx = 0; SetupDiEnumDeviceInfo(handle_dev_info, idx, &dev_info); ++idx) {
+            DEVPROPTYPE prop_type = 0;
+            DWORD required_size = 0;
 
-                    // Retry the query with the larger allocated buffer
-                    st = nt_device_io_control_file(device, nullptr, nullptr, nullptr, &iosb,
-                        ioctl,
-                        &query, sizeof(query),
-                        allocated_buffer, static_cast<ULONG>(allocated_size));
-                    if (!NT_SUCCESS(st)) {
-                        PVOID free_base = reinterpret_cast<PVOID>(allocated_buffer);
-                        SIZE_T free_size = allocated_size;
-                        nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
-                        nt_close(device);
-                        continue;
-                    }
-                    descriptor = reinterpret_cast<STORAGE_DEVICE_DESCRIPTOR*>(allocated_buffer);
+            // query required size (bytes)
+            SetupDiGetDevicePropertyW(handle_dev_info, &dev_info, &key, &prop_type, nullptr, 0, &required_size, 0);
+            if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || required_size == 0) {
+                if (GetLastError() == ERROR_NOT_FOUND) {
+                    debug("ACPI_SIGNATURE: No dedicated display/GPU detected");
+                    SetupDiDestroyDeviceInfoList(handle_dev_info);
+                    return false;
                 }
                 else {
-                    nt_close(device);
                     continue;
                 }
             }
 
-            // This part is just to validate the structure size returned by the driver to prevent out-of-bounds reads
+            // fetch buffer (multi-sz)
+            std::vector<BYTE> buffer(required_size);
+            if (!SetupDiGetDevicePropertyW(handle_dev_info, &dev_info, &key, &prop_type,
+                buffer.data(), required_size, &required_size, 0))
             {
-                const DWORD reported_size = descriptor->Size;
-                if (reported_size < sizeof(STORAGE_DEVICE_DESCRIPTOR) || static_cast<SIZE_T>(reported_size) > MAX_DESCRIPTOR_SIZE) {
-                    if (allocated_buffer) {
-                        PVOID free_base = reinterpret_cast<PVOID>(allocated_buffer);
-                        SIZE_T free_size = allocated_size;
-                        nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
-                        allocated_buffer = nullptr;
-                    }
-                    nt_close(device);
+                continue;
+            }
+
+            const wchar_t* ptr = reinterpret_cast<const wchar_t*>(buffer.data());
+            // number of wchar_t slots in buffer
+            const size_t total_wchars = required_size / sizeof(wchar_t);
+            const wchar_t* buf_end = ptr + (total_wchars ? total_wchars : 0);
+
+        #ifdef __VMAWARE_DEBUG__
+            for (const wchar_t* p = ptr; p < buf_end && *p; p += (wcslen(p) + 1)) {
+                debug("ACPI_SIGNATURE: ", p);
+            }
+        #endif
+
+            static const wchar_t acpi_prefix[] = L"#ACPI(S";
+            static const wchar_t acpi_paren[] = L"ACPI(";
+
+            // First pass: QEMU-style "#ACPI(Sxx...)" and generic "ACPI(Sxx)"
+            for (const wchar_t* p = ptr; p < buf_end && *p; p += (wcslen(p) + 1)) {
+                if (has_excluded_token(p)) {
+                    debug("ACPI_SIGNATURE: Valid signature -> ", p);
                     continue;
                 }
-            }
 
-            // Serial number string within the descriptor structure
-            const u32 serial_offset = descriptor->SerialNumberOffset;
-            if (serial_offset > 0 && serial_offset < descriptor->Size) {
-                const char* serial = reinterpret_cast<const char*>(descriptor) + serial_offset;
-                const size_t max_avail = static_cast<size_t>(descriptor->Size) - static_cast<size_t>(serial_offset);
-                const size_t serialLen = strnlen(serial, max_avail);
+                // search for "#ACPI(S"
+                const wchar_t* search = p;
+                while (true) {
+                    const wchar_t* found = wcsstr(search, acpi_prefix);
+                    if (!found) break;
 
-                debug("DISK_SERIAL: ", serial);
+                    // after "#ACPI(S" we expect two hex chars
+                    const wchar_t* hexpos = found + wcslen(acpi_prefix); // first hex char
+                    if (hexpos && hexpos[0] && hexpos[1]) {
+                        wchar_t b = hexpos[0];
+                        wchar_t s = hexpos[1];
+                        if (is_hex(b) && is_hex(s)) {
+                            const wchar_t after = hexpos[2]; // may be '_' or ')'
+                            if (after == L'_' || after == L')') {
+                                SetupDiDestroyDeviceInfoList(handle_dev_info);
+                                return core::add(brand_enum::QEMU);
+                            }
+                        }
+                    }
+                    search = found + 1;
+                }
 
-                // Check the retrieved serial number against known VM artifacts
-                if (is_qemu_serial(serial) || is_vbox_serial(serial, serialLen)) {
-                    if (allocated_buffer) {
-                        PVOID free_base = reinterpret_cast<PVOID>(allocated_buffer);
-                        SIZE_T free_size = allocated_size;
-                        nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
-                        allocated_buffer = nullptr;
+                // search for "ACPI(" then check for "S" + two hex digits
+                search = p;
+                while (true) {
+                    const wchar_t* found = wcsstr(search, acpi_paren);
+                    if (!found) break;
+                    const wchar_t* start = found + wcslen(acpi_paren); // char after '('
+                    if (start && start[0] && start[1] && start[2]) {
+                        if (start[0] == L'S' && is_hex(start[1]) && is_hex(start[2])) {
+                            SetupDiDestroyDeviceInfoList(handle_dev_info);
+                            return core::add(brand_enum::QEMU);
+                        }
                     }
-                    nt_close(device);
-                    return true;
+                    search = found + 1;
                 }
             }
 
-            // Cleanup for the current iteration if no VM was detected on this drive
-            if (allocated_buffer) {
-                PVOID free_base = reinterpret_cast<PVOID>(allocated_buffer);
-                SIZE_T free_size = allocated_size;
-                nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
-                allocated_buffer = nullptr;
-            }
-            nt_close(device);
-        }
+            // Important to run Hyper-V checks later because of is_hardened() logic
+            static constexpr const wchar_t* vm_signatures[] = {
+                L"#ACPI(VMOD)", L"#ACPI(VMBS)", L"#VMBUS(", L"#VPCI("
+            };
 
-		// If we couldn't open any physical drives (not even read permissions) it's weird so we flag it.
-        if (successful_opens == 0) {
-            debug("DISK_SERIAL: No physical drives detected");
-            return true;
+            for (const wchar_t* p = ptr; p < buf_end && *p; p += (wcslen(p) + 1)) {
+                if (has_excluded_token(p)) continue;
+
+                for (const wchar_t* sig : vm_signatures) {
+                    if (wcsstr(p, sig) != nullptr) {
+                        SetupDiDestroyDeviceInfoList(handle_dev_info);
+                        return core::add(brand_enum::HYPERV);
+                    }
+                }
+            }
         }
 
-        return result;
+        SetupDiDestroyDeviceInfoList(handle_dev_info);
+        return false;
     }
 
 
     /**
-     * @brief Check for IVSHMEM device presence
-     * @category Windows
-     * @author dmfrpro (https://github.com/dmfrpro)
-     * @implements VM::IVSHMEM
+     * @brief Check if after raising two traps at the same RIP, a hypervisor interferes with the instruction pointer delivery
+     * @category Windows, x86_64
+     * @implements VM::TRAP
      */
-    [[nodiscard]] static bool ivshmem() {
-        typedef struct _KEY_FULL_INFORMATION {
-            LARGE_INTEGER LastWriteTime;
-            ULONG         TitleIndex;
-            ULONG         ClassOffset;
-            ULONG         ClassLength;
-            ULONG         SubKeys;
-            ULONG         MaxNameLen;
-            ULONG         MaxClassLen;
-            ULONG         Values;
-            ULONG         MaxValueNameLen;
-            ULONG         MaxValueDataLen;
-            WCHAR         Class[1];
-        } KEY_FULL_INFORMATION, * PKEY_FULL_INFORMATION;
+    [[nodiscard]] static bool trap() {
+        bool hypervisor_caught = false;
+    #if (x86_64)
+        // when a single - step(TF) and hardware breakpoint(DR0) collide, Intel CPUs set both DR6.BS and DR6.B0 to report both events, which help make this detection trick
+        // AMD CPUs prioritize the breakpoint, setting only its corresponding bit in DR6 and clearing the single-step bit, which is why this technique is not compatible with AMD
+        if (!cpu::is_intel()) {
+            return false;
+        }
 
-        typedef enum _KEY_INFORMATION_CLASS {
-            KeyBasicInformation,
-            KeyNodeInformation,
-            KeyFullInformation,
-            KeyNameInformation,
-            KeyCachedInformation,
-            KeyFlagsInformation,
-            KeyVirtualizationInformation,
-            KeyHandleTagsInformation,
-            KeyTrustInformation,
-            KeyLayerInformation,
-            MaxKeyInfoClass
-        } KEY_INFORMATION_CLASS;
+        // mobile SKUs can "false flag" this check
+        const char* brand = cpu::get_brand();
+        for (const char* c = brand; *c; ++c) {
+            if (*c == 'U') {
+                if (c > brand && (c[-1] >= '0' && c[-1] <= '9')) {
+                    if (c[1] == ' ' || c[1] == '\0') {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        // We must preserve RBX because CPUID clobbers it, and RBX is a non-volatile 
+        // register in x64. If we don't restore it, the calling function (VM::check) crashes
+        // we use MOV R8, RBX instead of PUSH RBX. Pushing to the stack without 
+        // unwind metadata breaks SEH in x64 (OS cannot find the handler), causing a crash
+        constexpr u8 trampoline[] = {
+            0x49, 0x89, 0xD8,                     // mov r8, rbx      (save rbx to volatile register r8)
+            0x9C,                                 // pushfq
+            0x81, 0x04, 0x24,                     // OR DWORD PTR [RSP], 0x10100 (Set TF)
+            0x00, 0x01, 0x01, 0x00,
+            0x9D,                                 // popfq
+            0x0F, 0xA2,                           // cpuid 
+            0x4C, 0x89, 0xC3,                     // mov rbx, r8      (restore rbx from r8) - trap happens here
+            0xC3                                  // ret
+        };
+        SIZE_T trampoline_size = sizeof(trampoline);
 
         const HMODULE ntdll = util::get_ntdll();
         if (!ntdll) return false;
 
-        const char* names[] = { "RtlInitUnicodeString", "NtOpenKey", "NtQueryKey", "NtClose" };
+        const char* names[] = {
+            "NtAllocateVirtualMemory",
+            "NtProtectVirtualMemory",
+            "NtFreeVirtualMemory",
+            "NtFlushInstructionCache",
+            "NtClose",
+            "NtGetContextThread",
+            "NtSetContextThread"
+        };
         void* funcs[ARRAYSIZE(names)] = {};
         util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-        const auto rtl_init_unicode_string = reinterpret_cast<void(__stdcall*)(PUNICODE_STRING, PCWSTR)>(funcs[0]);
-        const auto nt_open_key = reinterpret_cast<NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES)>(funcs[1]);
-        const auto nt_query_key = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, KEY_INFORMATION_CLASS, PVOID, ULONG, PULONG)>(funcs[2]);
-        const auto nt_close = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE)>(funcs[3]);
+        using nt_allocate_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG);
+        using nt_protect_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG, PULONG);
+        using nt_free_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG);
+        using nt_flush_instruction_cache_t = NTSTATUS(__stdcall*)(HANDLE, PVOID, SIZE_T);
+        using nt_close_t = NTSTATUS(__stdcall*)(HANDLE);
+        using nt_get_context_thread_t = NTSTATUS(__stdcall*)(HANDLE, PCONTEXT);
+        using nt_set_context_thread_t = NTSTATUS(__stdcall*)(HANDLE, PCONTEXT);
 
-        if (!rtl_init_unicode_string || !nt_open_key || !nt_query_key || !nt_close) {
+        // volatile ensures these are loaded from stack after SEH unwind when compiled with aggresive optimizations
+        nt_allocate_virtual_memory_t volatile nt_allocate_virtual_memory = reinterpret_cast<nt_allocate_virtual_memory_t>(funcs[0]);
+        nt_protect_virtual_memory_t volatile nt_protect_virtual_memory = reinterpret_cast<nt_protect_virtual_memory_t>(funcs[1]);
+        nt_free_virtual_memory_t volatile nt_free_virtual_memory = reinterpret_cast<nt_free_virtual_memory_t>(funcs[2]);
+        nt_flush_instruction_cache_t volatile nt_flush_instruction_cache = reinterpret_cast<nt_flush_instruction_cache_t>(funcs[3]);
+        nt_close_t volatile nt_close = reinterpret_cast<nt_close_t>(funcs[4]);
+        nt_get_context_thread_t volatile nt_get_context_thread = reinterpret_cast<nt_get_context_thread_t>(funcs[5]);
+        nt_set_context_thread_t volatile nt_set_context_thread = reinterpret_cast<nt_set_context_thread_t>(funcs[6]);
+
+        if (!nt_allocate_virtual_memory || !nt_protect_virtual_memory || !nt_flush_instruction_cache ||
+            !nt_free_virtual_memory || !nt_get_context_thread || !nt_set_context_thread || !nt_close) {
+            return false;
+        }
+
+        PVOID exec_mem = nullptr;
+        SIZE_T region_size = trampoline_size;
+        const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
+        NTSTATUS st = nt_allocate_virtual_memory(current_process, &exec_mem, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (!NT_SUCCESS(st) || !exec_mem) {
             return false;
         }
+        memcpy(exec_mem, trampoline, trampoline_size);
 
-        // Targeted GUID for IVSHMEM (Inter-VM Shared Memory).
-        // This device is typically used in KVM/QEMU environments (like Looking Glass) to pass memory between host and guest
-        constexpr GUID GUID_IVSHMEM_IFACE =
-        { 0xdf576976, 0x569d, 0x4672, { 0x95, 0xa0, 0xf5, 0x7e, 0x4e, 0xa0, 0xb2, 0x10 } };
+        {
+            PVOID tmp_base = exec_mem;
+            SIZE_T tmp_sz = trampoline_size;
+            ULONG oldProt = 0;
+            st = nt_protect_virtual_memory(current_process, &tmp_base, &tmp_sz, PAGE_EXECUTE_READ, &oldProt);
+            if (!NT_SUCCESS(st)) {
+                PVOID free_base = exec_mem;
+                SIZE_T free_size = trampoline_size;
+                nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
+                return false;
+            }
+        }
 
-        // Construct the registry path for the DeviceClasses key
-        // We access the "DeviceClasses" registry hive directly to find hardware interfaces
-        wchar_t interface_class_path[256];
-        swprintf_s(
-            interface_class_path,
-            ARRAYSIZE(interface_class_path),
-            L"\\Registry\\Machine\\SYSTEM\\CurrentControlSet\\Control\\DeviceClasses\\{%08lX-%04hX-%04hX-%02hhX%02hhX-%02hhX%02hhX%02hhX%02hhX%02hhX%02hhX}",
-            GUID_IVSHMEM_IFACE.Data1, GUID_IVSHMEM_IFACE.Data2, GUID_IVSHMEM_IFACE.Data3,
-            GUID_IVSHMEM_IFACE.Data4[0], GUID_IVSHMEM_IFACE.Data4[1], GUID_IVSHMEM_IFACE.Data4[2],
-            GUID_IVSHMEM_IFACE.Data4[3], GUID_IVSHMEM_IFACE.Data4[4], GUID_IVSHMEM_IFACE.Data4[5],
-            GUID_IVSHMEM_IFACE.Data4[6], GUID_IVSHMEM_IFACE.Data4[7]
-        );
+        nt_flush_instruction_cache(current_process, exec_mem, trampoline_size);
 
-        UNICODE_STRING unicode_path;
-        rtl_init_unicode_string(&unicode_path, interface_class_path);
+        u8 hitCount = 0;
 
-        OBJECT_ATTRIBUTES object_attributes;
-        RtlZeroMemory(&object_attributes, sizeof(object_attributes));
-        object_attributes.Length = sizeof(object_attributes);
-        object_attributes.ObjectName = &unicode_path;
-        object_attributes.Attributes = OBJ_CASE_INSENSITIVE;
+        CONTEXT original_context{};
+        original_context.ContextFlags = CONTEXT_DEBUG_REGISTERS;
+        const HANDLE current_thread = reinterpret_cast<HANDLE>(-2LL);
 
-        HANDLE key = nullptr;
-        NTSTATUS st = nt_open_key(&key, KEY_READ, &object_attributes);
-        if (!NT_SUCCESS(st) || key == nullptr) {
+        if (!NT_SUCCESS(nt_get_context_thread(current_thread, &original_context))) {
+            PVOID free_base = exec_mem;
+            SIZE_T free_size = trampoline_size;
+            nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
             return false;
         }
 
-        // We query the "Full Information" of the key to get the count of subkeys
-        // The existence of the class key alone isn't enough cuz Windows might register the class but have no devices
-        // If SubKeys > 0, it means actual device instances (for ex. PCI devices) are registered under this interface
-        BYTE info_buffer[512] = {};
-        ULONG returned_len = 0;
-        st = nt_query_key(key, KeyFullInformation, info_buffer, sizeof(info_buffer), &returned_len);
+        // Set DR0 to trampoline + 14 (Instruction: mov rbx, r8)
+        // Offset calculation: mov_r8_rbx(3) + pushfq(1) + or(7) + popfq(1) + cpuid(2) = 14
+        // This is where single step traps after CPUID, and where we want the collision
+        const uintptr_t expected_trap_address = reinterpret_cast<uintptr_t>(exec_mem) + 14;
 
-        DWORD number_of_subkeys = 0;
-        if (NT_SUCCESS(st) && returned_len >= sizeof(KEY_FULL_INFORMATION)) {
-            auto* kfi = reinterpret_cast<KEY_FULL_INFORMATION*>(info_buffer);
-            number_of_subkeys = static_cast<DWORD>(kfi->SubKeys);
-        }
-        else {
-            nt_close(key);
+        // set Dr0 to trampoline+offset
+        CONTEXT debug_context = original_context;
+        debug_context.Dr0 = expected_trap_address; // single step breakpoint address
+        debug_context.Dr7 = 1; // enable Local Breakpoint 0
+
+        if (!NT_SUCCESS(nt_set_context_thread(current_thread, &debug_context))) {
+            nt_set_context_thread(current_thread, &original_context);
+            PVOID free_base = exec_mem;
+            SIZE_T free_size = trampoline_size;
+            nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
             return false;
         }
 
-        nt_close(key);
+        // Context structure to pass data to the static SEH handler
+        struct trap_context {
+            uintptr_t expectedTrapAddr;
+            u8* hitCount;
+            bool* hypervisor_caught;
+        };
 
-        return number_of_subkeys > 0;
-    }
+        // Static class for SEH filtering to avoid Release mode Lambda corruption
+        struct SEH_Trap {
+            static LONG Vet(u32 code, EXCEPTION_POINTERS* info, trap_context* ctx) noexcept {
+                // Lambda returns LONG to support EXCEPTION_CONTINUE_EXECUTION
+                if (code != static_cast<DWORD>(0x80000004L)) {
+                    return EXCEPTION_CONTINUE_SEARCH;
+                }
 
+                // Verify exception happened at our calculated offset
+                if (reinterpret_cast<uintptr_t>(info->ExceptionRecord->ExceptionAddress) != ctx->expectedTrapAddr) {
+                    info->ContextRecord->EFlags &= ~0x100; // Clear TF
+                    info->ContextRecord->Dr7 &= ~1;        // Clear DR0 Enable
+                    *ctx->hypervisor_caught = true;
+                    return EXCEPTION_CONTINUE_EXECUTION;
+                }
 
-    /**
-     * @brief Check for GPU capabilities related to VMs
-     * @category Windows
-     * @implements VM::GPU_CAPABILITIES
-     */
-    [[nodiscard]] static bool gpu_capabilities() {
-        /*
-            Microsoft::WRL::ComPtr<IDirect3D9> d3d9 {
-                Direct3DCreate9(D3D_SDK_VERSION)
-            };
+                (*ctx->hitCount)++;
 
-            if (!d3d9) {
-                debug("GPU_CAPABILITIES: Direct3DCreate9 failed");
-                return true;
-            }
+                // check if Trap Flag and DR0 contributed
+                constexpr u64 required_bits = (1ULL << 14) | 1ULL; // BS | B0
+                const u64 status = info->ContextRecord->Dr6;
 
-            D3DCAPS9 caps;
-            if (FAILED(d3d9->GetDeviceCaps(D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, &caps))) {
-                debug("GPU_CAPABILITIES: GetDeviceCaps failed");
-                return false;
+                if ((status & required_bits) != required_bits) {
+                    if (util::hyper_x() != HYPERV_ARTIFACT_VM) // detects type 1 Hyper-V too, which we consider legitimate
+                        *ctx->hypervisor_caught = true;
+                }
+
+                // Clear Trap Flag to stop single stepping
+                info->ContextRecord->EFlags &= ~0x100;
+
+                // Clear DR7 Local Enable 0 to disable the hardware breakpoint
+                // If we don't do this, the next instruction will trigger the breakpoint again immediately
+                info->ContextRecord->Dr7 &= ~1;
+
+                // executes mov rbx, r8 (restore), and returns
+                return EXCEPTION_CONTINUE_EXECUTION;
             }
+        };
 
-            // if the driver cannot adjust the display gamma ramp dynamically but only in full-screen mode—via the IDirect3DDevice9::SetGammaRamp API
-            return !(caps.Caps2 & D3DCAPS2_FULLSCREENGAMMA);
-        */
+        trap_context ctx = { expected_trap_address, &hitCount, &hypervisor_caught };
 
-        const HDC hdc = GetDC(nullptr);
-        if (!hdc) {
-            return true;
+        __try {
+            reinterpret_cast<void(*)()>(exec_mem)();
+        }
+        __except (SEH_Trap::Vet(_exception_code(), reinterpret_cast<EXCEPTION_POINTERS*>(_exception_info()), &ctx)) {
+            // This block is effectively unreachable because vetExceptions returns CONTINUE_EXECUTION or CONTINUE_SEARCH
         }
 
-        const int color_caps = GetDeviceCaps(hdc, COLORMGMTCAPS);
-        ReleaseDC(nullptr, hdc);
+        // If the hypervisor swallowed the exception entirely, hitCount will be 0
+        if (hitCount != 1) {
+            hypervisor_caught = true;
+        }
 
-        return !(color_caps & CM_GAMMA_RAMP) || color_caps == 0;
+        nt_set_context_thread(current_thread, &original_context);
+
+        PVOID free_base = exec_mem;
+        SIZE_T free_size = trampoline_size;
+        nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
+    #endif
+        return hypervisor_caught;
     }
 
 
     /**
-     * @brief Check for vm-specific devices
+     * @brief Check if after executing an undefined instruction, a hypervisor misinterpret it as a system call
      * @category Windows
-     * @implements VM::HANDLES
+     * @implements VM::UD
      */
-    [[nodiscard]] static bool device_handles() {
+    [[nodiscard]] static bool ud() {
+    #if (x86)
+        // ud2; ret
+        constexpr u8 ud_opcodes[] = { 0x0F, 0x0B, 0xC3 };
+    #elif (ARM32)
+        // udf #0; bx lr
+        // (Little-endian for 0xE7F000F0 and 0xE12FFF1E)
+        constexpr u8 ud_opcodes[] = { 0xF0, 0x00, 0xF0, 0xE7, 0x1E, 0xFF, 0x2F, 0xE1 };
+    #elif (ARM64)
+        // hlt #0; ret
+        // (Little-endian for 0xD4400000 and 0xD65F03C0)
+        constexpr u8 ud_opcodes[] = { 0x00, 0x00, 0x40, 0xD4, 0xC0, 0x03, 0x5F, 0xD6 };
+    #else
+        // architecture not supported by this check
+        return false;
+    #endif
+        
+        bool saw_ud = false;
         const HMODULE ntdll = util::get_ntdll();
         if (!ntdll) return false;
 
-        const char* names[] = { "RtlInitUnicodeString", "NtOpenFile", "NtClose" };
+        const char* names[] = { "NtAllocateVirtualMemory", "NtProtectVirtualMemory", "NtFlushInstructionCache", "NtFreeVirtualMemory" };
         void* funcs[ARRAYSIZE(names)] = {};
-        util::get_function_address(ntdll, names, funcs, (ULONG)(sizeof(names) / sizeof(names[0])));
-
-        const auto rtl_init_unicode_string = reinterpret_cast<void(__stdcall*)(PUNICODE_STRING, PCWSTR)>(funcs[0]);
-        const auto nt_open_file = reinterpret_cast<NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES, PIO_STATUS_BLOCK, ULONG, ULONG)>(funcs[1]);
-        const auto nt_close = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE)>(funcs[2]);
-
-        if (!rtl_init_unicode_string || !nt_open_file || !nt_close) {
-            return false;
-        }
-
-        auto try_open_mutex = [&](const wchar_t* native_path) noexcept -> HANDLE {
-            UNICODE_STRING u_path{};
-            u_path.Buffer = const_cast<wchar_t*>(native_path);
-            const size_t len_bytes = wcslen(native_path) * sizeof(wchar_t);
-            u_path.Length = static_cast<USHORT>(len_bytes);
-            u_path.MaximumLength = static_cast<USHORT>(len_bytes + sizeof(wchar_t));
-
-            OBJECT_ATTRIBUTES obj_attr = {
-                sizeof(OBJECT_ATTRIBUTES),
-                nullptr,
-                &u_path,
-                OBJ_CASE_INSENSITIVE,
-                nullptr,
-                nullptr
-            };
-
-            IO_STATUS_BLOCK iosb;
-            HANDLE h_file = nullptr;
-
-            constexpr ACCESS_MASK desired_access = FILE_READ_DATA | FILE_READ_ATTRIBUTES | SYNCHRONIZE;
-            constexpr ULONG share_access = FILE_SHARE_READ;
-            constexpr ULONG open_options = FILE_OPEN | FILE_SYNCHRONOUS_IO_NONALERT;
-
-            const NTSTATUS st = nt_open_file(&h_file, desired_access, &obj_attr, &iosb, share_access, open_options);
-
-            if (NT_SUCCESS(st)) {
-                return h_file;
-            }
-            return INVALID_HANDLE_VALUE;
-        };
-
-        constexpr const wchar_t* paths[] = {
-            L"\\??\\VBoxMiniRdrDN",    // \\.\VBoxMiniRdrDN
-            L"\\??\\pipe\\VBoxMiniRdDN",// \\.\pipe\VBoxMiniRdDN
-            L"\\??\\VBoxTrayIPC",      // \\.\VBoxTrayIPC
-            L"\\??\\pipe\\VBoxTrayIPC",// \\.\pipe\VBoxTrayIPC
-            L"\\??\\HGFS",             // \\.\HGFS (VMware)
-            L"\\??\\pipe\\cuckoo"      // \\.\pipe\cuckoo (Cuckoo)
-        };
-
-        const size_t path_count = sizeof(paths) / sizeof(paths[0]);
-        HANDLE handles[sizeof(paths) / sizeof(paths[0])] = {};
-
-        for (size_t i = 0; i < path_count; ++i) {
-            handles[i] = try_open_mutex(paths[i]);
-        }
-
-        const bool vbox = (handles[0] != INVALID_HANDLE_VALUE) ||
-            (handles[1] != INVALID_HANDLE_VALUE) ||
-            (handles[2] != INVALID_HANDLE_VALUE) ||
-            (handles[3] != INVALID_HANDLE_VALUE);
+        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-        const bool vmware = (handles[4] != INVALID_HANDLE_VALUE);
-        const bool cuckoo = (handles[5] != INVALID_HANDLE_VALUE);
+        const auto nt_allocate_virtual_memory = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG)>(funcs[0]);
+        const auto nt_protect_virtual_memory = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG, PULONG)>(funcs[1]);
+        const auto nt_flush_instruction_cache = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID, SIZE_T)>(funcs[2]);
+        const auto nt_free_virtual_memory = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG)>(funcs[3]);
 
-        for (size_t i = 0; i < path_count; ++i) {
-            if (handles[i] != INVALID_HANDLE_VALUE) {
-                (void)nt_close(handles[i]);
-                handles[i] = INVALID_HANDLE_VALUE;
-            }
+        if (!nt_allocate_virtual_memory || !nt_protect_virtual_memory || !nt_flush_instruction_cache || !nt_free_virtual_memory) {
+            return false;
         }
 
-        if (vbox) {
-            debug("HANDLES: Detected VBox related device handles");
-            return core::add(brand_enum::VBOX);
+        const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
+        PVOID base = nullptr;
+        SIZE_T region_size = sizeof(ud_opcodes);
+        NTSTATUS st = nt_allocate_virtual_memory(current_process, &base, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (!NT_SUCCESS(st) || !base) {
+            return false;
         }
 
-        if (vmware) {
-            debug("HANDLES: Detected VMware related device (HGFS)");
-            return core::add(brand_enum::VMWARE);
+        memcpy(base, ud_opcodes, sizeof(ud_opcodes));
+
+        ULONG old_protection = 0;
+        st = nt_protect_virtual_memory(current_process, &base, &region_size, PAGE_EXECUTE_READ, &old_protection);
+        if (!NT_SUCCESS(st)) {
+            nt_free_virtual_memory(current_process, &base, &region_size, MEM_RELEASE);
+            return false;
         }
 
-        if (cuckoo) {
-            debug("HANDLES: Detected Cuckoo related device (pipe)");
-            return core::add(brand_enum::CUCKOO);
+        nt_flush_instruction_cache(current_process, base, region_size);
+
+        __try {
+            reinterpret_cast<void(*)()>(base)();
+        }
+        __except (GetExceptionCode() == EXCEPTION_ILLEGAL_INSTRUCTION ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+            saw_ud = true;
         }
 
-        return false;
+        nt_free_virtual_memory(current_process, &base, &region_size, MEM_RELEASE);
+
+        return !saw_ud;
     }
 
 
     /**
-     * @brief Check if the number of virtual and logical processors are reported correctly by the system
-     * @category Windows, x86
-     * @implements VM::VIRTUAL_PROCESSORS
+     * @brief Check if a hypervisor does not properly restore the interruptibility state after a VM-exit in compatibility mode
+     * @category Windows
+     * @implements VM::BLOCKSTEP
      */
-    [[nodiscard]] static bool virtual_processors() {
-    #if (x86)
-        int regs[4];
-        __cpuid(regs, 0x40000000);
+    [[nodiscard]] static bool blockstep() {  
+    #if (x86_32 && MSVC && !CLANG)
+        volatile int saw_single_step = 0;
 
-        const u32 max_leaf = static_cast<u32>(regs[0]);
-        if (max_leaf < 0x40000005) {
-            return false;
-        }
+        __try
+        {
+            __asm
+            {
+                // set TF in EFLAGS
+                pushfd
+                or dword ptr[esp], 0x100
+                popfd
 
-        __cpuid(regs, 0x40000005);
-        const u32 max_virtual_processors = static_cast<u32>(regs[0]);
-        const u32 max_logical_processors = static_cast<u32>(regs[1]);
+                // execute MOV SS,AX (reload SS with itself) to force the interruptible state block
+                mov ax, ss
+                mov ss, ax // this blocks any debug exception for exactly one instruction
 
-        debug("VIRTUAL_PROCESSORS: MaxVirtualProcessors -> ", max_virtual_processors,
-            ", MaxLogicalProcessors -> ", max_logical_processors);
+                // because TF was set, CPUID would normally cause a #DB on the next instruction.
+                xor eax, eax
+                cpuid
 
-        if (max_virtual_processors == 0xFFFFFFFF || max_logical_processors == 0) {
-            return true;
+                // one extra instruction: on bare metal, TF's single-step now fires here
+                nop
+
+                pushfd
+                and dword ptr[esp], 0xFFFFFEFF
+                popfd
+            }
         }
-    #endif
+        __except (GetExceptionCode() == EXCEPTION_SINGLE_STEP
+            ? EXCEPTION_EXECUTE_HANDLER
+            : EXCEPTION_CONTINUE_SEARCH)
+        {
+            saw_single_step = 1;
+        }
+        return (saw_single_step == 0) ? true : false;
+    #else
         return false;
+    #endif
     }
 
 
     /**
-     * @brief Check if a call to NtQuerySystemInformation with the 0x9f leaf fills a _SYSTEM_HYPERVISOR_DETAIL_INFORMATION structure
-     * @category Windows, x86_64
-     * @implements VM::HYPERVISOR_QUERY
+     * @brief Check if Dark Byte's VM is present
+     * @category Windows
+     * @implements VM::DBVM_HYPERCALL
      */
-    [[nodiscard]] static bool hypervisor_query() {
-    #if (x86_32)
+    [[nodiscard]] static bool dbvm_hypercall() {
+    #if (!x86_64)
         return false;
     #else
-        if (util::hyper_x() == HYPERV_ARTIFACT_VM) {
-            return false;
-        }
+        constexpr u64 PW1 = 0x0000000076543210ULL;
+        constexpr u64 PW3 = 0x0000000090909090ULL;
+        constexpr u32 PW2 = 0xFEDCBA98U;
 
-        struct HV_DETAILS {
-            ULONG Data[4];
+        struct vmcall_info {
+            u32 structsize;
+            u32 level2pass;
+            u32 command;
         };
-        struct SYSTEM_HYPERVISOR_DETAIL_INFORMATION {
-            HV_DETAILS HvVendorAndMaxFunction;
-            HV_DETAILS HypervisorInterface;
-            HV_DETAILS HypervisorVersion;
-            HV_DETAILS HvFeatures;
-            HV_DETAILS HwFeatures;
-            HV_DETAILS EnlightenmentInfo;
-            HV_DETAILS ImplementationLimits;
+
+        vmcall_info vmcall_info = {};
+        u64 vmcall_result = 0;
+
+        constexpr u8 intel_template[44] = {
+            0x48,0xBA,0,0,0,0,0,0,0,0,                     // mov rdx, imm64   ; PW1
+            0x48,0xB9,0,0,0,0,0,0,0,0,                     // mov rcx, imm64   ; PW3
+            0x48,0xB8,0,0,0,0,0,0,0,0,                     // mov rax, imm64   ; &vmcallInfo
+            0x0F,0x01,0xC1,                                // vmcall
+            0x48,0xA3,0,0,0,0,0,0,0,0,                     // mov [imm64], rax ; &vmcallResult
+            0xC3                                           // ret
         };
 
-        using PHV_DETAILS = HV_DETAILS*;
-        using PSYSTEM_HYPERVISOR_DETAIL_INFORMATION = SYSTEM_HYPERVISOR_DETAIL_INFORMATION*;
+        constexpr u8 amd_template[44] = {
+            0x48,0xBA,0,0,0,0,0,0,0,0,                     // mov rdx, imm64   ; PW1
+            0x48,0xB9,0,0,0,0,0,0,0,0,                     // mov rcx, imm64   ; PW3
+            0x48,0xB8,0,0,0,0,0,0,0,0,                     // mov rax, imm64   ; &vmcallInfo
+            0x0F,0x01,0xD9,                                // vmmcall (AMD)
+            0x48,0xA3,0,0,0,0,0,0,0,0,                     // mov [imm64], rax ; &vmcallResult
+            0xC3                                           // ret
+        };
 
-        using FN_NtQuerySystemInformation = NTSTATUS(__stdcall*)(
-            SYSTEM_INFORMATION_CLASS SystemInformationClass,
-            PVOID SystemInformation,
-            ULONG SystemInformationLength,
-            PULONG ReturnLength
-        );
+        const SIZE_T stub_size = sizeof(intel_template);
+        const bool is_amd = cpu::is_amd();
 
+        const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
         const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll) return false;        
+        if (!ntdll) return false;
 
-        const char* names[] = { "NtQuerySystemInformation" };
+        const char* names[] = { "NtAllocateVirtualMemory", "NtProtectVirtualMemory", "NtFlushInstructionCache", "NtFreeVirtualMemory" };
         void* funcs[ARRAYSIZE(names)] = {};
         util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-        const FN_NtQuerySystemInformation nt_query_system_information = reinterpret_cast<FN_NtQuerySystemInformation>(funcs[0]);
-        if (nt_query_system_information) {
-            SYSTEM_HYPERVISOR_DETAIL_INFORMATION hypervisor_information = { {} };
+        const auto nt_allocate_virtual_memory = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG)>(funcs[0]);
+        const auto nt_protect_virtual_memory = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG, PULONG)>(funcs[1]);
+        const auto nt_flush_instruction_cache = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID, SIZE_T)>(funcs[2]);
+        const auto nt_free_virtual_memory = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG)>(funcs[3]);
 
-            // Request class 0x9F (SystemHypervisorDetailInformation)
-            // This asks the OS kernel to fill the structure with information about the 
-            // hypervisor layer it is running on top of
-            const NTSTATUS status = nt_query_system_information(static_cast<SYSTEM_INFORMATION_CLASS>(0x9F), &hypervisor_information, sizeof(hypervisor_information), nullptr);
+        if (!nt_allocate_virtual_memory || !nt_protect_virtual_memory || !nt_flush_instruction_cache || !nt_free_virtual_memory) {
+            return false;
+        }
 
-            if (status != 0) {
-                return false;
-            }
+        PVOID stub = nullptr;
+        SIZE_T region_size = stub_size;
+        NTSTATUS st = nt_allocate_virtual_memory(current_process, &stub, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (!NT_SUCCESS(st) || !stub) return false;
 
-            // If Data[0] is non-zero, it means the kernel has successfully communicated 
-            // with a hypervisor and retrieved a vendor signature like "Micr" for Microsoft
-            if (hypervisor_information.HvVendorAndMaxFunction.Data[0] != 0) {
-                return true;
-            }
+        if (is_amd) {
+            memcpy(stub, amd_template, stub_size);
+        }
+        else {
+            memcpy(stub, intel_template, stub_size);
         }
-    #endif
-        return false;
-    }
 
-    
-    /**
-     * @brief Check for particular object directory which is present in Sandboxie virtual environment but not in usual host systems
-     * @category Windows
-     * @link https://evasions.checkpoint.com/src/Evasions/techniques/global-os-objects.html
-     * @implements VM::VIRTUAL_REGISTRY
-     */
-    [[nodiscard]] static bool virtual_registry() {
-        struct UNICODE_STRING {
-            USHORT Length;
-            USHORT MaximumLength;
-            PWSTR  Buffer;
-        };
-        struct OBJECT_ATTRIBUTES {
-            ULONG Length;
-            HANDLE RootDirectory;
-            UNICODE_STRING* ObjectName;
-            ULONG Attributes;
-            PVOID SecurityDescriptor;
-            PVOID SecurityQualityOfService;
-        };
-        enum OBJECT_INFORMATION_CLASS {
-            ObjectBasicInformation = 0,
-            ObjectNameInformation = 1,
-            ObjectTypeInformation = 2
-        };
-        struct OBJECT_NAME_INFORMATION {
-            UNICODE_STRING Name;
-        };
+        // rdx imm64
+        // rcx imm64
+        // rax imm64
+        // mov [imm64], rax immediate
+        *reinterpret_cast<u64*>(reinterpret_cast<u8*>(stub) + 2) = PW1;
+        *reinterpret_cast<u64*>(reinterpret_cast<u8*>(stub) + 12) = PW3;
+        *reinterpret_cast<u64*>(reinterpret_cast<u8*>(stub) + 22) = reinterpret_cast<u64>(static_cast<void*>(&vmcall_info));
+        *reinterpret_cast<u64*>(reinterpret_cast<u8*>(stub) + 35) = reinterpret_cast<u64>(static_cast<void*>(&vmcall_result));
 
-        using POBJECT_NAME_INFORMATION = OBJECT_NAME_INFORMATION*;
-        using PNtOpenKey = NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES );
-        using PNtQueryObject = NTSTATUS(__stdcall*)(HANDLE, OBJECT_INFORMATION_CLASS, PVOID, ULONG, PULONG);
-    
-        const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll) return false;
-    
-        const char* names[] = { "NtOpenKey", "NtQueryObject", "NtClose" };
-        void* funcs[ARRAYSIZE(names)] = {};
-        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
-    
-        const auto nt_open_key = reinterpret_cast<PNtOpenKey>(funcs[0]);
-        const auto nt_query_object = reinterpret_cast<PNtQueryObject>(funcs[1]);
-        const auto nt_close = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE)>(funcs[2]);
+        ULONG old_protection = 0;
+        st = nt_protect_virtual_memory(current_process, &stub, &region_size, PAGE_EXECUTE_READ, &old_protection);
+        if (!NT_SUCCESS(st)) {
+            nt_free_virtual_memory(current_process, &stub, &region_size, MEM_RELEASE);
+            return false;
+        }
+
+        nt_flush_instruction_cache(current_process, stub, region_size);
+
+        auto tryPass = [&]() noexcept -> bool {
+            // store forwarding in modern CPUs
+            vmcall_info.structsize = static_cast<u32>(sizeof(vmcall_info));
+            vmcall_info.level2pass = PW2;
+            vmcall_info.command = 0;
+            vmcall_result = 0;
 
-        if (!nt_open_key || !nt_query_object || !nt_close)
-            return false;
-    
-        // Prepare to open the root USER registry hive
-        UNICODE_STRING key_path{};
-        key_path.Buffer = const_cast<PWSTR>(L"\\REGISTRY\\USER");
-        key_path.Length = static_cast<USHORT>(wcslen(key_path.Buffer) * sizeof(WCHAR));
-        key_path.MaximumLength = key_path.Length + sizeof(WCHAR);
+            __try {
+                reinterpret_cast<void(*)()>(stub)();
+            }
+            __except (EXCEPTION_EXECUTE_HANDLER) { // EXCEPTION_ILLEGAL_INSTRUCTION normally, EXCEPTION_ACCESS_VIOLATION_READ on edge-cases
+                vmcall_result = 0;
+            }
 
-        OBJECT_ATTRIBUTES object_attributes = {
-            sizeof(OBJECT_ATTRIBUTES),
-            nullptr,
-            &key_path,
-            0x00000040L,  // OBJ_CASE_INSENSITIVE
-            nullptr,
-            nullptr
+            return (((vmcall_result >> 24) & 0xFF) == 0xCE); // the VM returns status in bits 24–31; Cheat Engine uses 0xCE here
         };
 
-        // Attempt to open the key. If we are sandboxed, this open call often succeeds,
-        // but the underlying handle will point to a virtualized container, not the real OS path
-        HANDLE key = nullptr;
-        NTSTATUS status = nt_open_key(&key, KEY_READ, reinterpret_cast<POBJECT_ATTRIBUTES>(&object_attributes));
-        if (!(((NTSTATUS)(status)) >= 0))
-            return false;
+        const bool found = tryPass();
 
-        // Ask the kernel: "What is the actual name of the object this handle points to?"
-        // Sandboxie implements file system and registry virtualization by redirecting access
-        // While the API pretends we opened "\REGISTRY\USER", the handle might actually point to 
-        // something like "\Device\HarddiskVolume2\Sandbox\User\DefaultBox\RegHive"
-        alignas(16) BYTE buffer[1024]{};
-        ULONG returned_length = 0;
-        status = nt_query_object(key, ObjectNameInformation, buffer, sizeof(buffer), &returned_length);
-        nt_close(key);
-        if (!(((NTSTATUS)(status)) >= 0))
-            return false;
+        nt_free_virtual_memory(current_process, &stub, &region_size, MEM_RELEASE);
 
-        const auto object_name = reinterpret_cast<POBJECT_NAME_INFORMATION>(buffer);
+        if (found) return core::add(brand_enum::DBVM);
 
-        UNICODE_STRING expected_name{};
-        expected_name.Buffer = const_cast<PWSTR>(L"\\REGISTRY\\USER");
-        expected_name.Length = static_cast<USHORT>(wcslen(expected_name.Buffer) * sizeof(WCHAR));
+        return false;
+    #endif
+    }
 
-        // Compare the requested name vs the actual kernel object name
-        // If they don't match, we have been redirected, confirming the presence of Sandboxie
-        const bool mismatch = (object_name->Name.Length != expected_name.Length) ||
-            (memcmp(object_name->Name.Buffer, expected_name.Buffer, expected_name.Length) != 0);
 
-        return mismatch ? core::add(brand_enum::SANDBOXIE) : false;
-    }
-    
-    
     /**
-     * @brief Check if no waveform-audio output devices are present in the system
-     * @category Windows
-     * @implements VM::AUDIO
+     * @brief Check boot logo for known VM images
+     * @category Windows, x86_64
+     * @author Teselka (https://github.com/Teselka)
+     * @implements VM::BOOT_LOGO
      */
-    [[nodiscard]] static bool audio() {
-        struct KEY_FULL_INFORMATION {
-            LARGE_INTEGER LastWriteTime;
-            ULONG         TitleIndex;
-            ULONG         ClassOffset;
-            ULONG         ClassLength;
-            ULONG         SubKeys;
-            ULONG         MaxNameLen;
-            ULONG         MaxClassLen;
-            ULONG         Values;             
-            ULONG         MaxValueNameLen;
-            ULONG         MaxValueDataLen;
-            WCHAR         Class[1];
-        };
-        using PKEY_FULL_INFORMATION = KEY_FULL_INFORMATION*;
+    [[nodiscard]] static bool boot_logo()
+    #if (x86 && (CLANG || GCC))
+        __attribute__((__target__("crc32")))
+    #endif
+    {
+    #if (x86_64)
+        const HMODULE ntdll = util::get_ntdll();
+        if (!ntdll)
+            return false;
 
-        enum KEY_INFORMATION_CLASS {
-            KeyBasicInformation,
-            KeyNodeInformation,
-            KeyFullInformation,
-            KeyNameInformation,
-            KeyCachedInformation,
-            KeyFlagsInformation,
-            KeyVirtualizationInformation,
-            KeyHandleTagsInformation,
-            KeyTrustInformation,
-            KeyLayerInformation,
-            MaxKeyInfoClass
-        };
+        const char* function_names[] = { "NtQuerySystemInformation" };
+        void* functions[1] = { nullptr };
+        util::get_function_address(ntdll, function_names, functions, 1);
 
-        const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll) return false;
+        using NtQuerySysInfo_t = NTSTATUS(__stdcall*)(SYSTEM_INFORMATION_CLASS, PVOID, ULONG, PULONG);
+        NtQuerySysInfo_t nt_query = reinterpret_cast<NtQuerySysInfo_t>(functions[0]);
+        if (!nt_query)
+            return false;
 
-        const char* names[] = { "RtlInitUnicodeString", "NtOpenKey", "NtQueryKey", "NtClose" };
-        void* funcs[ARRAYSIZE(names)] = {};
-        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
+        // determine required buffer size
+        const SYSTEM_INFORMATION_CLASS sys_boot_info = static_cast<SYSTEM_INFORMATION_CLASS>(140);
+        ULONG needed = 0;
+        NTSTATUS st = nt_query(sys_boot_info, nullptr, 0, &needed);
+        if (st != static_cast<NTSTATUS>(0xC0000023) && st != static_cast<NTSTATUS>(0x80000005) && st != static_cast<NTSTATUS>(0xC0000004))
+            return false;
 
-        const auto rtl_init_unicode_string = reinterpret_cast<void(__stdcall*)(PUNICODE_STRING, PCWSTR)>(funcs[0]);
-        const auto nt_open_key = reinterpret_cast<NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES)>(funcs[1]);
-        const auto nt_query_key = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, KEY_INFORMATION_CLASS, PVOID, ULONG, PULONG)>(funcs[2]);
-        const auto nt_close = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE)>(funcs[3]);
+        std::vector<u8> buffer(needed);
 
-        if (!rtl_init_unicode_string || !nt_open_key || !nt_query_key || !nt_close) {
+        // fetch the boot-logo data
+        st = nt_query(sys_boot_info, buffer.data(), needed, &needed);
+        if (!NT_SUCCESS(st))
             return false;
-        }
 
-        // We are checking for the presence of Audio Render devices
-        // Most legitimate user PCs have speakers or headphones (audio endpoints)
-        // Automated sandboxes and headless servers often have no audio devices configured
-        // We target the MMDevices\Audio\Render key where these endpoints are registered
-        const wchar_t* native_path = L"\\Registry\\Machine\\SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\MMDevices\\Audio\\Render";
+        // parse header to locate the bitmap
+        struct boot_logo_info { ULONG flags, bitmap_offset; };
+        const auto* info = reinterpret_cast<boot_logo_info*>(buffer.data());
+        if (info->bitmap_offset >= needed) return false;
+        const u8* bmp = buffer.data() + info->bitmap_offset;
+        const size_t size = static_cast<size_t>(needed) - info->bitmap_offset;
 
-        UNICODE_STRING unicode_path;
-        rtl_init_unicode_string(&unicode_path, native_path);
+        // struct + function to isolate SEH from the stack frame containing std::vector and use __target__
+        struct crc {
+            #if (GCC || CLANG)
+                __attribute__((__target__("sse4.2")))
+            #endif
+                static u32 compute(const u8* data, size_t len) {
+                // 8 byte chunks
+                u64 crcReg = 0xFFFFFFFFull;
+                const size_t qwords = len >> 3;
+                const auto* ptr = reinterpret_cast<const u64*>(data);
 
-        OBJECT_ATTRIBUTES object_attributes;
-        RtlZeroMemory(&object_attributes, sizeof(object_attributes));
-        object_attributes.Length = sizeof(object_attributes);
-        object_attributes.ObjectName = &unicode_path;
-        object_attributes.Attributes = OBJ_CASE_INSENSITIVE;
+                size_t i = 0;
 
-        HANDLE key = nullptr;
-        const ACCESS_MASK desired_access = KEY_READ;
+                __try {
+                    // Unrolled loop
+                    for (; i + 3 < qwords; i += 4) {
+                        crcReg = _mm_crc32_u64(crcReg, ptr[i]);
+                        crcReg = _mm_crc32_u64(crcReg, ptr[i + 1]);
+                        crcReg = _mm_crc32_u64(crcReg, ptr[i + 2]);
+                        crcReg = _mm_crc32_u64(crcReg, ptr[i + 3]);
+                    }
 
-        NTSTATUS st = nt_open_key(&key, desired_access, &object_attributes);
-        if (!NT_SUCCESS(st) || key == nullptr) {
-            return false;
-        }
+                    for (; i < qwords; ++i) {
+                        crcReg = _mm_crc32_u64(crcReg, ptr[i]);
+                    }
 
-        constexpr KEY_INFORMATION_CLASS InfoClass = KeyFullInformation;
-        std::vector<BYTE> info_buffer(512);
-        ULONG returned_len = 0;
+                    u32 crc = static_cast<u32>(crcReg);
+                    const auto* tail = reinterpret_cast<const u8*>(ptr + qwords);
 
-        // Query the key information. If the buffer is too small (STATUS_BUFFER_TOO_SMALL),
-        // resize it to the exact length required by the kernel and try again
-        st = nt_query_key(key, InfoClass, info_buffer.data(), static_cast<ULONG>(info_buffer.size()), &returned_len);
+                    for (size_t j = 0, r = len & 7; j < r; ++j) {
+                        crc = _mm_crc32_u8(crc, tail[j]);
+                    }
+                    crc ^= 0xFFFFFFFFu;
+                    return crc;
+                }
+                __except (EXCEPTION_EXECUTE_HANDLER) {
+                    return 0;
+                }
+            }
+        };
 
-        if (!NT_SUCCESS(st) && returned_len > info_buffer.size()) {
-            info_buffer.resize(returned_len);
-            st = nt_query_key(key, InfoClass, info_buffer.data(), static_cast<ULONG>(info_buffer.size()), &returned_len);
-        }
+        const u32 hash = crc::compute(bmp, size);
 
-        bool has_values = false;
-        if (NT_SUCCESS(st) && returned_len >= sizeof(KEY_FULL_INFORMATION)) {
-            const auto* kfi = reinterpret_cast<PKEY_FULL_INFORMATION>(info_buffer.data());
+        debug("BOOT_LOGO: size=", needed, ", flags=", info->flags, ", offset=", info->bitmap_offset, ", crc=0x", std::hex, hash);
 
-            // Check if the registry key has any values associated with it
-            // If 'Values' is 0, the audio system is likely uninitialized or barren,
-            // which strongly suggests a virtualized/sandbox environment
-            const DWORD value_count = static_cast<DWORD>(kfi->Values); // values, not subkeys
-            has_values = (value_count > 0);
-        }
-        else {
-            nt_close(key);
-            return false;
+        switch (hash) {
+            case 0x110350C5: return core::add(brand_enum::QEMU); // TianoCore EDK2
+            case 0x87c39681: return core::add(brand_enum::HYPERV);
+            case 0x9502cb33: return core::add(brand_enum::VBOX);
+            default:         return false;
         }
+    #else
+        return false;
+    #endif
+    }
+
+
+    /**
+     * @brief Check for any signs of VMs in Windows kernel object entities 
+     * @category Windows
+     * @implements VM::KERNEL_OBJECTS
+     */
+    [[nodiscard]] static bool kernel_objects() {
+        struct OBJECT_DIRECTORY_INFORMATION {
+            UNICODE_STRING Name;
+            UNICODE_STRING TypeName;
+        };
+
+        using POBJECT_DIRECTORY_INFORMATION = OBJECT_DIRECTORY_INFORMATION*;
+        constexpr auto DIRECTORY_QUERY = 0x0001;
+        constexpr NTSTATUS NO_MORE_ENTRIES = 0x8000001A;
+
+        HANDLE dir = nullptr;
+        OBJECT_ATTRIBUTES object_attributes{};
+        UNICODE_STRING dir_name{};
+        NTSTATUS status;
+
+        const HMODULE ntdll = util::get_ntdll();
+        if (!ntdll) return false;
+
+        const char* names[] = { "NtOpenDirectoryObject", "NtQueryDirectoryObject", "NtClose" };
+        void* funcs[ARRAYSIZE(names)] = {};
+        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
+
+        const auto nt_open_directory_object = reinterpret_cast<NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES)>(funcs[0]);
+        const auto nt_query_directory_object = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID, ULONG, BOOLEAN, BOOLEAN, PULONG, PULONG)>(funcs[1]);
+        const auto nt_close = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE)>(funcs[2]);
 
-        nt_close(key);
+        if (!nt_open_directory_object || !nt_query_directory_object || !nt_close) return false;
 
-        return has_values;
-    }
-    
-    
-    /**
-     * @brief Check for VM-specific ACPI device signatures
-     * @category Windows
-     * @implements VM::ACPI_SIGNATURE
-     */
-    [[nodiscard]] static bool acpi_signature() {
-        auto is_hex = [](wchar_t c) noexcept -> bool {
-            return (c >= L'0' && c <= L'9') || (c >= L'A' && c <= L'F');
-        };
+        // Prepare to open the root "\Device" directory in the Object Manager namespace
+        // This is different from the file system and we are looking for kernel objects created by drivers
+        const wchar_t* device_dir_path = L"\\Device";
+        dir_name.Buffer = (PWSTR)device_dir_path;
+        dir_name.Length = (USHORT)(wcslen(device_dir_path) * sizeof(wchar_t));
+        dir_name.MaximumLength = dir_name.Length + sizeof(wchar_t);
 
-        // enumerate all DISPLAY devices
-        const HDEVINFO handle_dev_info = SetupDiGetClassDevsW(&GUID_DEVCLASS_DISPLAY, nullptr, nullptr, DIGCF_PRESENT);
-        if (handle_dev_info == INVALID_HANDLE_VALUE) {
-            debug("ACPI_SIGNATURE: No display device detected");
-            return true;
+        InitializeObjectAttributes(&object_attributes, &dir_name, OBJ_CASE_INSENSITIVE, nullptr, nullptr);
+
+        // Open the directory object so we can enumerate its contents
+        status = nt_open_directory_object(&dir, DIRECTORY_QUERY, &object_attributes);
+
+        if (!NT_SUCCESS(status)) {
+            return false;
         }
 
-        SP_DEVINFO_DATA dev_info;
-        ZeroMemory(&dev_info, sizeof(dev_info));
-        dev_info.cbSize = sizeof(dev_info);
-        const DEVPROPKEY key = DEVPKEY_Device_LocationPaths;
+        // Set up a buffer for querying directory entries
+        // We process entries one by one using a context index
+        std::vector<BYTE> buffer(4096);
+        constexpr size_t MAX_DIR_BUFFER = 64 * 1024;
+        ULONG context = 0;
+        ULONG returned_length = 0;
 
-        // baremetal tokens (case-sensitive to preserve handling against edge-cases)
-        static constexpr const wchar_t* excluded_tokens[] = {
-            L"GFX",
-            L"IGD", L"IGFX", L"IGPU",
-            L"VGA", L"VIDEO", L"DISPLAY", L"GPU",
-            L"PCIROOT", L"PNP0A03", L"PNP0A08",
-            L"PCH", L"PXS", L"PEG", L"PEGP"
-        };
+        while (true) {
+            // Query the next single object in the directory
+            // 'ReturnSingleEntry' is TRUE to simplify buffer parsing logic
+            status = nt_query_directory_object(
+                dir,
+                buffer.data(),
+                static_cast<ULONG>(buffer.size()),
+                TRUE,
+                FALSE,
+                &context,
+                &returned_length
+            );
 
-        auto has_excluded_token = [&](const wchar_t* s) noexcept -> bool {
-            if (!s || !*s) return false;
-            for (const wchar_t* tok : excluded_tokens) {
-                if (wcsstr(s, tok) != nullptr) return true;
+            // Stop if we have iterated through all objects
+            if (status == NO_MORE_ENTRIES) {
+                break;
             }
-            return false;
-        };
-
-        for (DWORD idx = 0; SetupDiEnumDeviceInfo(handle_dev_info, idx, &dev_info); ++idx) {
-            DEVPROPTYPE prop_type = 0;
-            DWORD required_size = 0;
 
-            // query required size (bytes)
-            SetupDiGetDevicePropertyW(handle_dev_info, &dev_info, &key, &prop_type, nullptr, 0, &required_size, 0);
-            if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || required_size == 0) {
-                if (GetLastError() == ERROR_NOT_FOUND) {
-                    debug("ACPI_SIGNATURE: No dedicated display/GPU detected");
-                    SetupDiDestroyDeviceInfoList(handle_dev_info);
-                    return false;
-                }
-                else {
+            // Handle buffer sizing. If the buffer is too small, the kernel tells us how much it needs
+            // We resize and retry, but impose a sanity cap to prevent memory issues
+            if (!NT_SUCCESS(status)) {
+                if (returned_length > buffer.size()) {
+                    size_t new_size = static_cast<size_t>(returned_length);
+                    if (new_size > MAX_DIR_BUFFER) new_size = MAX_DIR_BUFFER;
+                    if (new_size <= buffer.size()) {
+                        nt_close(dir);
+                        return false;
+                    }
+                    try {
+                        buffer.resize(new_size);
+                    }
+                    catch (...) {
+                        nt_close(dir);
+                        return false;
+                    }
                     continue;
                 }
+                nt_close(dir);
+                return false;
             }
 
-            // fetch buffer (multi-sz)
-            std::vector<BYTE> buffer(required_size);
-            if (!SetupDiGetDevicePropertyW(handle_dev_info, &dev_info, &key, &prop_type,
-                buffer.data(), required_size, &required_size, 0))
-            {
-                continue;
+            // Validate the returned data length to ensure we don't read out of bounds
+            const size_t used_len = (returned_length == 0) ? buffer.size() : static_cast<size_t>(returned_length);
+            if (used_len < sizeof(OBJECT_DIRECTORY_INFORMATION) || used_len > buffer.size()) {
+                nt_close(dir);
+                return false;
             }
 
-            const wchar_t* ptr = reinterpret_cast<const wchar_t*>(buffer.data());
-            // number of wchar_t slots in buffer
-            const size_t total_wchars = required_size / sizeof(wchar_t);
-            const wchar_t* buf_end = ptr + (total_wchars ? total_wchars : 0);
-
-        #ifdef __VMAWARE_DEBUG__
-            for (const wchar_t* p = ptr; p < buf_end && *p; p += (wcslen(p) + 1)) {
-                debug("ACPI_SIGNATURE: ", p);
-            }
-        #endif
+            const POBJECT_DIRECTORY_INFORMATION object_directory_information = reinterpret_cast<POBJECT_DIRECTORY_INFORMATION>(buffer.data());
 
-            static const wchar_t acpi_prefix[] = L"#ACPI(S";
-            static const wchar_t acpi_paren[] = L"ACPI(";
+            // memory boundaries just for safe pointer arithmetic
+            const uintptr_t buf_base = reinterpret_cast<uintptr_t>(buffer.data());
+            const uintptr_t buf_end = buf_base + used_len;
 
-            // First pass: QEMU-style "#ACPI(Sxx...)" and generic "ACPI(Sxx)"
-            for (const wchar_t* p = ptr; p < buf_end && *p; p += (wcslen(p) + 1)) {
-                if (has_excluded_token(p)) {
-                    debug("ACPI_SIGNATURE: Valid signature -> ", p);
-                    continue;
-                }
+            std::wstring object_name;
+            bool found_name = false;
 
-                // search for "#ACPI(S"
-                const wchar_t* search = p;
-                while (true) {
-                    const wchar_t* found = wcsstr(search, acpi_prefix);
-                    if (!found) break;
+            // Extract the name using the explicit Name pointer in the structure
+            // We strictly validate that the pointer falls within our allocated buffer to prevent crashes
+            const size_t nameBytes = static_cast<size_t>(object_directory_information->Name.Length);
+            const uintptr_t name_ptr = reinterpret_cast<uintptr_t>(object_directory_information->Name.Buffer);
 
-                    // after "#ACPI(S" we expect two hex chars
-                    const wchar_t* hexpos = found + wcslen(acpi_prefix); // first hex char
-                    if (hexpos && hexpos[0] && hexpos[1]) {
-                        wchar_t b = hexpos[0];
-                        wchar_t s = hexpos[1];
-                        if (is_hex(b) && is_hex(s)) {
-                            const wchar_t after = hexpos[2]; // may be '_' or ')'
-                            if (after == L'_' || after == L')') {
-                                SetupDiDestroyDeviceInfoList(handle_dev_info);
-                                return core::add(brand_enum::QEMU);
-                            }
+            if (nameBytes > 0 && (nameBytes % sizeof(wchar_t) == 0)) {
+                const uintptr_t min_valid_ptr = buf_base + sizeof(OBJECT_DIRECTORY_INFORMATION);
+                if (name_ptr >= min_valid_ptr && (name_ptr + nameBytes) <= buf_end && (name_ptr % sizeof(wchar_t) == 0)) {
+                    const wchar_t* wname = reinterpret_cast<const wchar_t*>(name_ptr);
+                    const size_t wlen = nameBytes / sizeof(wchar_t);
+                    bool found_term = false;
+                    // scan for null terminator just in case
+                    for (size_t i = 0; i < wlen; ++i) {
+                        if (wname[i] == L'\0') { 
+                            object_name.assign(wname, i); 
+                            found_term = true;
+                            break; 
                         }
                     }
-                    search = found + 1;
-                }
-
-                // search for "ACPI(" then check for "S" + two hex digits
-                search = p;
-                while (true) {
-                    const wchar_t* found = wcsstr(search, acpi_paren);
-                    if (!found) break;
-                    const wchar_t* start = found + wcslen(acpi_paren); // char after '('
-                    if (start && start[0] && start[1] && start[2]) {
-                        if (start[0] == L'S' && is_hex(start[1]) && is_hex(start[2])) {
-                            SetupDiDestroyDeviceInfoList(handle_dev_info);
-                            return core::add(brand_enum::QEMU);
-                        }
+                    if (!found_term) {
+                        object_name.assign(wname, wlen);
                     }
-                    search = found + 1;
+                    found_name = true;
                 }
             }
 
-            // Important to run Hyper-V checks later because of is_hardened() logic
-            static constexpr const wchar_t* vm_signatures[] = {
-                L"#ACPI(VMOD)", L"#ACPI(VMBS)", L"#VMBUS(", L"#VPCI("
-            };
-
-            for (const wchar_t* p = ptr; p < buf_end && *p; p += (wcslen(p) + 1)) {
-                if (has_excluded_token(p)) continue;
+            // If the explicit pointer was invalid, assume the string data immediately follows the structure
+            if (!found_name) {
+                const uintptr_t altStart = buf_base + sizeof(OBJECT_DIRECTORY_INFORMATION);
+                if (altStart >= buf_end) {
+                    nt_close(dir);
+                    return false;
+                }
+                const size_t maxBytes = buf_end - altStart;
+                if (maxBytes < sizeof(wchar_t)) {
+                    nt_close(dir);
+                    return false;
+                }
+                const wchar_t* alt_ptr = reinterpret_cast<const wchar_t*>(buffer.data() + (altStart - buf_base));
+                const size_t max_chars = maxBytes / sizeof(wchar_t);
 
-                for (const wchar_t* sig : vm_signatures) {
-                    if (wcsstr(p, sig) != nullptr) {
-                        SetupDiDestroyDeviceInfoList(handle_dev_info);
-                        return core::add(brand_enum::HYPERV);
-                    }
+                size_t realChars = 0;
+                for (; realChars < max_chars; ++realChars) {
+                    if (alt_ptr[realChars] == L'\0') break;
+                }
+                if (realChars == max_chars) {
+                    nt_close(dir);
+                    return false;
                 }
+                object_name.assign(alt_ptr, realChars);
+                found_name = true;
             }
-        }
-
-        SetupDiDestroyDeviceInfoList(handle_dev_info);
-        return false;
-    }
-
-
-    /**
-     * @brief Check if after raising two traps at the same RIP, a hypervisor interferes with the instruction pointer delivery
-     * @category Windows, x86_64
-     * @implements VM::TRAP
-     */
-    [[nodiscard]] static bool trap() {
-        bool hypervisor_caught = false;
-    #if (x86_64)
-        // when a single - step(TF) and hardware breakpoint(DR0) collide, Intel CPUs set both DR6.BS and DR6.B0 to report both events, which help make this detection trick
-        // AMD CPUs prioritize the breakpoint, setting only its corresponding bit in DR6 and clearing the single-step bit, which is why this technique is not compatible with AMD
-        if (!cpu::is_intel()) {
-            return false;
-        }
 
-        // mobile SKUs can "false flag" this check
-        const char* brand = cpu::get_brand();
-        for (const char* c = brand; *c; ++c) {
-            if (*c == 'U') {
-                if (c > brand && (c[-1] >= '0' && c[-1] <= '9')) {
-                    if (c[1] == ' ' || c[1] == '\0') {
-                        return false;
-                    }
-                }
+            if (!found_name) {
+                nt_close(dir);
+                return false;
             }
-        }
 
-        // We must preserve RBX because CPUID clobbers it, and RBX is a non-volatile 
-        // register in x64. If we don't restore it, the calling function (VM::check) crashes
-        // we use MOV R8, RBX instead of PUSH RBX. Pushing to the stack without 
-        // unwind metadata breaks SEH in x64 (OS cannot find the handler), causing a crash
-        constexpr u8 trampoline[] = {
-            0x49, 0x89, 0xD8,                     // mov r8, rbx      (save rbx to volatile register r8)
-            0x9C,                                 // pushfq
-            0x81, 0x04, 0x24,                     // OR DWORD PTR [RSP], 0x10100 (Set TF)
-            0x00, 0x01, 0x01, 0x00,
-            0x9D,                                 // popfq
-            0x0F, 0xA2,                           // cpuid 
-            0x4C, 0x89, 0xC3,                     // mov rbx, r8      (restore rbx from r8) - trap happens here
-            0xC3                                  // ret
-        };
-        SIZE_T trampoline_size = sizeof(trampoline);
+            // "VmGenerationCounter" and "VmGid" are created by the Hyper-V VM Bus provider
+            if (object_name == L"VmGenerationCounter") {
+                nt_close(dir);
+                debug("KERNEL_OBJECTS: Detected VmGenerationCounter");
+                return core::add(brand_enum::HYPERV);
+            }
+            if (object_name == L"VmGid") {
+                nt_close(dir);
+                debug("KERNEL_OBJECTS: Detected VmGid");
+                return core::add(brand_enum::HYPERV);
+            }
+        }
 
-        const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll) return false;
+        nt_close(dir);
+        return false;
+    }
 
-        const char* names[] = {
-            "NtAllocateVirtualMemory",
-            "NtProtectVirtualMemory",
-            "NtFreeVirtualMemory",
-            "NtFlushInstructionCache",
-            "NtClose",
-            "NtGetContextThread",
-            "NtSetContextThread"
-        };
-        void* funcs[ARRAYSIZE(names)] = {};
-        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
+    /**
+     * @brief Check for known NVRAM signatures that are present on virtual firmware
+     * @category Windows
+     * @warning Permissions required
+     * @implements VM::NVRAM
+     */
+    static bool nvram() {
+        struct VARIABLE_NAME { ULONG NextEntryOffset; GUID VendorGuid; WCHAR Name[1]; };
+        using variable_name_ptr = VARIABLE_NAME*;
+        using nt_enumerate_system_environment_values_ex_t = NTSTATUS(__stdcall*)(ULONG, PVOID, PULONG);
+        using nt_query_system_environment_value_ex_t = NTSTATUS(__stdcall*)(PUNICODE_STRING VariableName, LPGUID VendorGuid, PVOID Value, PULONG ValueLength, PULONG Attributes);
         using nt_allocate_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG);
-        using nt_protect_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG, PULONG);
         using nt_free_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG);
-        using nt_flush_instruction_cache_t = NTSTATUS(__stdcall*)(HANDLE, PVOID, SIZE_T);
-        using nt_close_t = NTSTATUS(__stdcall*)(HANDLE);
-        using nt_get_context_thread_t = NTSTATUS(__stdcall*)(HANDLE, PCONTEXT);
-        using nt_set_context_thread_t = NTSTATUS(__stdcall*)(HANDLE, PCONTEXT);
-
-        // volatile ensures these are loaded from stack after SEH unwind when compiled with aggresive optimizations
-        nt_allocate_virtual_memory_t volatile nt_allocate_virtual_memory = reinterpret_cast<nt_allocate_virtual_memory_t>(funcs[0]);
-        nt_protect_virtual_memory_t volatile nt_protect_virtual_memory = reinterpret_cast<nt_protect_virtual_memory_t>(funcs[1]);
-        nt_free_virtual_memory_t volatile nt_free_virtual_memory = reinterpret_cast<nt_free_virtual_memory_t>(funcs[2]);
-        nt_flush_instruction_cache_t volatile nt_flush_instruction_cache = reinterpret_cast<nt_flush_instruction_cache_t>(funcs[3]);
-        nt_close_t volatile nt_close = reinterpret_cast<nt_close_t>(funcs[4]);
-        nt_get_context_thread_t volatile nt_get_context_thread = reinterpret_cast<nt_get_context_thread_t>(funcs[5]);
-        nt_set_context_thread_t volatile nt_set_context_thread = reinterpret_cast<nt_set_context_thread_t>(funcs[6]);
-
-        if (!nt_allocate_virtual_memory || !nt_protect_virtual_memory || !nt_flush_instruction_cache ||
-            !nt_free_virtual_memory || !nt_get_context_thread || !nt_set_context_thread || !nt_close) {
-            return false;
-        }
-
-        PVOID exec_mem = nullptr;
-        SIZE_T region_size = trampoline_size;
-        const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
-        NTSTATUS st = nt_allocate_virtual_memory(current_process, &exec_mem, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-        if (!NT_SUCCESS(st) || !exec_mem) {
-            return false;
-        }
-        memcpy(exec_mem, trampoline, trampoline_size);
 
-        {
-            PVOID tmp_base = exec_mem;
-            SIZE_T tmp_sz = trampoline_size;
-            ULONG oldProt = 0;
-            st = nt_protect_virtual_memory(current_process, &tmp_base, &tmp_sz, PAGE_EXECUTE_READ, &oldProt);
-            if (!NT_SUCCESS(st)) {
-                PVOID free_base = exec_mem;
-                SIZE_T free_size = trampoline_size;
-                nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
-                return false;
-            }
-        }
+        // Secure Boot stuff
+        bool found_dbx_default = false;
+        bool found_kek_default = false;
+        bool found_pk_default = false;
 
-        nt_flush_instruction_cache(current_process, exec_mem, trampoline_size);
+        /*
+            MemoryOverwriteRequestControlLock is part of a state machine defined in the TCG Platform Reset Attack Mitigation Specification
+            the SMM driver expects to initialize and manage this variable itself during the DXE phase of booting
+            Secure Boot, TPM and SMM must be enabled to set it
+        */
+        bool found_morcl = false;
+        bool detection_result = false;
 
-        u8 hitCount = 0;
+        // Handles and Buffers
+        HANDLE token_handle = nullptr;
+        PVOID enum_base_buffer = nullptr;
+        BYTE* pk_default_buf = nullptr;
+        BYTE* pk_buf = nullptr;
+        BYTE* kek_default_buf = nullptr;
+        BYTE* kek_buf = nullptr;
+        bool privileges_enabled = false;
+        LUID luid_struct{};
 
-        CONTEXT original_context{};
-        original_context.ContextFlags = CONTEXT_DEBUG_REGISTERS;
-        const HANDLE current_thread = reinterpret_cast<HANDLE>(-2LL);
+        // Function Pointers
+        nt_enumerate_system_environment_values_ex_t nt_enumerate_values = nullptr;
+        nt_allocate_virtual_memory_t nt_allocate_memory = nullptr;
+        nt_free_virtual_memory_t nt_free_memory = nullptr;
+        nt_query_system_environment_value_ex_t nt_query_value = nullptr;
 
-        if (!NT_SUCCESS(nt_get_context_thread(current_thread, &original_context))) {
-            PVOID free_base = exec_mem;
-            SIZE_T free_size = trampoline_size;
-            nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
-            return false;
-        }
+        const HANDLE current_process_handle = reinterpret_cast<HANDLE>(-1LL);
 
-        // Set DR0 to trampoline + 14 (Instruction: mov rbx, r8)
-        // Offset calculation: mov_r8_rbx(3) + pushfq(1) + or(7) + popfq(1) + cpuid(2) = 14
-        // This is where single step traps after CPUID, and where we want the collision
-        const uintptr_t expected_trap_address = reinterpret_cast<uintptr_t>(exec_mem) + 14;
+        const char* manufacturer_str = "";
+        const char* model_str = "";
+        util::get_manufacturer_model(&manufacturer_str, &model_str);
 
-        // set Dr0 to trampoline+offset
-        CONTEXT debug_context = original_context;
-        debug_context.Dr0 = expected_trap_address; // single step breakpoint address
-        debug_context.Dr7 = 1; // enable Local Breakpoint 0
+        // -------------------------------------------------------------------------
+        // Helper Lambdas
+        // -------------------------------------------------------------------------
 
-        if (!NT_SUCCESS(nt_set_context_thread(current_thread, &debug_context))) {
-            nt_set_context_thread(current_thread, &original_context);
-            PVOID free_base = exec_mem;
-            SIZE_T free_size = trampoline_size;
-            nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
+        auto buffer_contains_ascii_ci = [](const BYTE* data, size_t len, const char* pat) noexcept -> bool {
+            if (!data || len == 0 || !pat) return false;
+            const size_t plen = strlen(pat); if (len < plen) return false;
+            const BYTE p0 = static_cast<BYTE>((pat[0] >= 'A' && pat[0] <= 'Z') ? (pat[0] + 32) : pat[0]);
+            const BYTE* end = data + (len - plen);
+            for (const BYTE* p = data; p <= end; ++p) {
+                BYTE c0 = *p; c0 = static_cast<BYTE>((c0 >= 'A' && c0 <= 'Z') ? (c0 + 32) : c0);
+                if (c0 != p0) continue;
+                bool ok = true;
+                for (size_t j = 1; j < plen; ++j) {
+                    BYTE dj = p[j]; dj = static_cast<BYTE>((dj >= 'A' && dj <= 'Z') ? (dj + 32) : dj);
+                    BYTE pj = static_cast<BYTE>((pat[j] >= 'A' && pat[j] <= 'Z') ? (pat[j] + 32) : pat[j]);
+                    if (dj != pj) { ok = false; break; }
+                }
+                if (ok) return true;
+            }
             return false;
-        }
-
-        // Context structure to pass data to the static SEH handler
-        struct trap_context {
-            uintptr_t expectedTrapAddr;
-            u8* hitCount;
-            bool* hypervisor_caught;
         };
 
-        // Static class for SEH filtering to avoid Release mode Lambda corruption
-        struct SEH_Trap {
-            static LONG Vet(u32 code, EXCEPTION_POINTERS* info, trap_context* ctx) noexcept {
-                // Lambda returns LONG to support EXCEPTION_CONTINUE_EXECUTION
-                if (code != static_cast<DWORD>(0x80000004L)) {
-                    return EXCEPTION_CONTINUE_SEARCH;
-                }
-
-                // Verify exception happened at our calculated offset
-                if (reinterpret_cast<uintptr_t>(info->ExceptionRecord->ExceptionAddress) != ctx->expectedTrapAddr) {
-                    info->ContextRecord->EFlags &= ~0x100; // Clear TF
-                    info->ContextRecord->Dr7 &= ~1;        // Clear DR0 Enable
-                    *ctx->hypervisor_caught = true;
-                    return EXCEPTION_CONTINUE_EXECUTION;
+        auto buffer_contains_utf16le_ci = [](const WCHAR* data, size_t wlen, const wchar_t* pat) noexcept -> bool {
+            if (!data || wlen == 0 || !pat) return false;
+            const size_t plen = wcslen(pat); if (wlen < plen) return false;
+            const WCHAR p0 = static_cast<WCHAR>((pat[0] >= L'A' && pat[0] <= L'Z') ? (pat[0] + 32) : pat[0]);
+            const WCHAR* end = data + (wlen - plen);
+            for (const WCHAR* p = data; p <= end; ++p) {
+                WCHAR c0 = *p; c0 = static_cast<WCHAR>((c0 >= L'A' && c0 <= L'Z') ? (c0 + 32) : c0);
+                if (c0 != p0) continue;
+                bool ok = true;
+                for (size_t j = 1; j < plen; ++j) {
+                    WCHAR dj = p[j]; dj = static_cast<WCHAR>((dj >= L'A' && dj <= L'Z') ? (dj + 32) : dj);
+                    WCHAR pj = static_cast<WCHAR>((pat[j] >= L'A' && pat[j] <= L'Z') ? (pat[j] + 32) : pat[j]);
+                    if (dj != pj) { ok = false; break; }
                 }
+                if (ok) return true;
+            }
+            return false;
+        };
 
-                (*ctx->hitCount)++;
-
-                // check if Trap Flag and DR0 contributed
-                constexpr u64 required_bits = (1ULL << 14) | 1ULL; // BS | B0
-                const u64 status = info->ContextRecord->Dr6;
-
-                if ((status & required_bits) != required_bits) {
-                    if (util::hyper_x() != HYPERV_ARTIFACT_VM) // detects type 1 Hyper-V too, which we consider legitimate
-                        *ctx->hypervisor_caught = true;
-                }
+        // -------------------------------------------------------------------------
+        // Main Logic Block
+        // -------------------------------------------------------------------------
 
-                // Clear Trap Flag to stop single stepping
-                info->ContextRecord->EFlags &= ~0x100;
+        do {
+            if (!util::is_admin()) break;
 
-                // Clear DR7 Local Enable 0 to disable the hardware breakpoint
-                // If we don't do this, the next instruction will trigger the breakpoint again immediately
-                info->ContextRecord->Dr7 &= ~1;
+            if (!OpenProcessToken(current_process_handle, TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token_handle)) break;
 
-                // executes mov rbx, r8 (restore), and returns
-                return EXCEPTION_CONTINUE_EXECUTION;
-            }
-        };
+            if (!LookupPrivilegeValue(nullptr, SE_SYSTEM_ENVIRONMENT_NAME, &luid_struct)) break;
 
-        trap_context ctx = { expected_trap_address, &hitCount, &hypervisor_caught };
+            TOKEN_PRIVILEGES tp_enable{};
+            tp_enable.PrivilegeCount = 1;
+            tp_enable.Privileges[0].Luid = luid_struct;
+            tp_enable.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+            AdjustTokenPrivileges(token_handle, FALSE, &tp_enable, sizeof(TOKEN_PRIVILEGES), nullptr, nullptr);
+            if (GetLastError() != ERROR_SUCCESS) break;
+            privileges_enabled = true;
 
-        __try {
-            reinterpret_cast<void(*)()>(exec_mem)();
-        }
-        __except (SEH_Trap::Vet(_exception_code(), reinterpret_cast<EXCEPTION_POINTERS*>(_exception_info()), &ctx)) {
-            // This block is effectively unreachable because vetExceptions returns CONTINUE_EXECUTION or CONTINUE_SEARCH
-        }
+            const HMODULE ntdll_module = util::get_ntdll();
+            if (!ntdll_module) break;
 
-        // If the hypervisor swallowed the exception entirely, hitCount will be 0
-        if (hitCount != 1) {
-            hypervisor_caught = true;
-        }
+            const char* func_names[] = { "NtEnumerateSystemEnvironmentValuesEx", "NtAllocateVirtualMemory", "NtFreeVirtualMemory", "NtQuerySystemEnvironmentValueEx" };
+            void* resolved_funcs[sizeof(func_names) / sizeof(func_names[0])] = {};
+            util::get_function_address(ntdll_module, func_names, resolved_funcs, sizeof(func_names) / sizeof(func_names[0]));
 
-        nt_set_context_thread(current_thread, &original_context);
+            nt_enumerate_values = reinterpret_cast<nt_enumerate_system_environment_values_ex_t>(resolved_funcs[0]);
+            nt_allocate_memory = reinterpret_cast<nt_allocate_virtual_memory_t>(resolved_funcs[1]);
+            nt_free_memory = reinterpret_cast<nt_free_virtual_memory_t>(resolved_funcs[2]);
+            nt_query_value = reinterpret_cast<nt_query_system_environment_value_ex_t>(resolved_funcs[3]);
 
-        PVOID free_base = exec_mem;
-        SIZE_T free_size = trampoline_size;
-        nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
-    #endif
-        return hypervisor_caught;
-    }
+            if (!nt_enumerate_values || !nt_allocate_memory || !nt_free_memory || !nt_query_value) break;
 
+            bool has_function = false;
+            bool call_success = false;
+            SIZE_T enum_alloc_size = 0;
+            ULONG buffer_required_length = 0;
 
-    /**
-     * @brief Check if after executing an undefined instruction, a hypervisor misinterpret it as a system call
-     * @category Windows
-     * @implements VM::UD
-     */
-    [[nodiscard]] static bool ud() {
-    #if (x86)
-        // ud2; ret
-        constexpr u8 ud_opcodes[] = { 0x0F, 0x0B, 0xC3 };
-    #elif (ARM32)
-        // udf #0; bx lr
-        // (Little-endian for 0xE7F000F0 and 0xE12FFF1E)
-        constexpr u8 ud_opcodes[] = { 0xF0, 0x00, 0xF0, 0xE7, 0x1E, 0xFF, 0x2F, 0xE1 };
-    #elif (ARM64)
-        // hlt #0; ret
-        // (Little-endian for 0xD4400000 and 0xD65F03C0)
-        constexpr u8 ud_opcodes[] = { 0x00, 0x00, 0x40, 0xD4, 0xC0, 0x03, 0x5F, 0xD6 };
-    #else
-        // architecture not supported by this check
-        return false;
-    #endif
-        
-        bool saw_ud = false;
-        const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll) return false;
+            // ask for size
+            if (nt_enumerate_values) {
+                has_function = true;
+                nt_enumerate_values(static_cast<ULONG>(1), nullptr, &buffer_required_length);
 
-        const char* names[] = { "NtAllocateVirtualMemory", "NtProtectVirtualMemory", "NtFlushInstructionCache", "NtFreeVirtualMemory" };
-        void* funcs[ARRAYSIZE(names)] = {};
-        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
+                if (buffer_required_length != 0) {
+                    enum_alloc_size = static_cast<SIZE_T>(buffer_required_length);
+                    NTSTATUS alloc_status = nt_allocate_memory(current_process_handle, &enum_base_buffer, 0, &enum_alloc_size, static_cast<ULONG>(MEM_COMMIT | MEM_RESERVE), static_cast<ULONG>(PAGE_READWRITE));
 
-        const auto nt_allocate_virtual_memory = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG)>(funcs[0]);
-        const auto nt_protect_virtual_memory = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG, PULONG)>(funcs[1]);
-        const auto nt_flush_instruction_cache = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID, SIZE_T)>(funcs[2]);
-        const auto nt_free_virtual_memory = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG)>(funcs[3]);
+                    if (alloc_status == 0 && enum_base_buffer) {
+                        alloc_status = nt_enumerate_values(static_cast<ULONG>(1), enum_base_buffer, &buffer_required_length);
+                        if (alloc_status == 0) {
+                            call_success = true;
+                        }
+                        else {
+                            SIZE_T zero_size = 0;
+                            nt_free_memory(current_process_handle, &enum_base_buffer, &zero_size, 0x8000);
+                            enum_base_buffer = nullptr;
+                            enum_alloc_size = 0;
+                        }
+                    }
+                }
+            }
 
-        if (!nt_allocate_virtual_memory || !nt_protect_virtual_memory || !nt_flush_instruction_cache || !nt_free_virtual_memory) {
-            return false;
-        }
+            if (!has_function) {
+                debug("NVRAM: NtEnumerateSystemEnvironmentValuesEx could not be resolved");
+                detection_result = false;
+                break;
+            }
+            if (!call_success) {
+                debug("NVRAM: System is not UEFI");
+                detection_result = false;
+                break;
+            }
 
-        const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
-        PVOID base = nullptr;
-        SIZE_T region_size = sizeof(ud_opcodes);
-        NTSTATUS st = nt_allocate_virtual_memory(current_process, &base, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-        if (!NT_SUCCESS(st) || !base) {
-            return false;
-        }
+            // ---------------------------------------------------------------------
+            // Constants & Data
+            // ---------------------------------------------------------------------
+            constexpr const char redhat_sig_ascii[] = "red hat";
+            constexpr const wchar_t redhat_sig_wide[] = L"red hat";
 
-        memcpy(base, ud_opcodes, sizeof(ud_opcodes));
+            SIZE_T pk_default_len = 0;
+            SIZE_T pk_len = 0;
+            SIZE_T kek_default_len = 0;
+            SIZE_T kek_len = 0;
 
-        ULONG old_protection = 0;
-        st = nt_protect_virtual_memory(current_process, &base, &region_size, PAGE_EXECUTE_READ, &old_protection);
-        if (!NT_SUCCESS(st)) {
-            nt_free_virtual_memory(current_process, &base, &region_size, MEM_RELEASE);
-            return false;
-        }
+            const GUID EFI_GLOBAL_VARIABLE = { 0x8BE4DF61, 0x93CA, 0x11D2, {0xAA,0x0D,0x00,0xE0,0x98,0x03,0x2B,0x8C} };
 
-        nt_flush_instruction_cache(current_process, base, region_size);
+            // Helper to read 1-byte UEFI variables like SecureBoot or SetupMode
+            auto read_uint8_var = [&](const std::wstring& name, const GUID& g, u8& out) noexcept -> bool {
+                if (!nt_query_value || !nt_allocate_memory || !nt_free_memory) return false;
+                UNICODE_STRING uni_str{};
+                uni_str.Buffer = const_cast<PWSTR>(name.c_str());
+                uni_str.Length = static_cast<USHORT>(name.length() * sizeof(wchar_t));
+                uni_str.MaximumLength = uni_str.Length + sizeof(wchar_t);
 
-        __try {
-            reinterpret_cast<void(*)()>(base)();
-        }
-        __except (GetExceptionCode() == EXCEPTION_ILLEGAL_INSTRUCTION ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
-            saw_ud = true;
-        }
+                ULONG required_size = 0;
+                NTSTATUS status = nt_query_value(&uni_str, const_cast<LPGUID>(&g), nullptr, &required_size, nullptr);
+                if (required_size == 0) return false;
 
-        nt_free_virtual_memory(current_process, &base, &region_size, MEM_RELEASE);
+                PVOID allocation_base = nullptr;
+                SIZE_T alloc_size = required_size;
+                if (alloc_size < 0x1000) alloc_size = 0x1000;
 
-        return !saw_ud;
-    }
+                status = nt_allocate_memory(current_process_handle, &allocation_base, 0, &alloc_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+                if (status != 0 || !allocation_base) { return false; }
 
+                status = nt_query_value(&uni_str, const_cast<LPGUID>(&g), allocation_base, &required_size, nullptr);
+                if (status == 0 && required_size >= 1) {
+                    out = *reinterpret_cast<u8*>(allocation_base);
+                    SIZE_T z = 0;
+                    nt_free_memory(current_process_handle, &allocation_base, &z, 0x8000);
+                    return true;
+                }
 
-    /**
-     * @brief Check if a hypervisor does not properly restore the interruptibility state after a VM-exit in compatibility mode
-     * @category Windows
-     * @implements VM::BLOCKSTEP
-     */
-    [[nodiscard]] static bool blockstep() {  
-    #if (x86_32 && MSVC && !CLANG)
-        volatile int saw_single_step = 0;
+                SIZE_T zero_s = 0;
+                nt_free_memory(current_process_handle, &allocation_base, &zero_s, 0x8000);
+                return false;
+            };
 
-        __try
-        {
-            __asm
-            {
-                // set TF in EFLAGS
-                pushfd
-                or dword ptr[esp], 0x100
-                popfd
+            bool have_secureboot = false;
+            u8 secureboot_val = 0;
+            if (read_uint8_var(L"SecureBoot", EFI_GLOBAL_VARIABLE, secureboot_val)) {
+                have_secureboot = true;
+                debug("NVRAM: SecureBoot variable detected");
+            }
 
-                // execute MOV SS,AX (reload SS with itself) to force the interruptible state block
-                mov ax, ss
-                mov ss, ax // this blocks any debug exception for exactly one instruction
+            bool have_setupmode = false;
+            u8 setupmode_val = 0;
+            if (read_uint8_var(L"SetupMode", EFI_GLOBAL_VARIABLE, setupmode_val)) {
+                have_setupmode = true;
+                debug("NVRAM: SetupMode variable detected");
+            }
 
-                // because TF was set, CPUID would normally cause a #DB on the next instruction.
-                xor eax, eax
-                cpuid
+            // Determine whether it's safe to run Secure Boot dependent checks
+            const bool sb_active = (have_secureboot && (secureboot_val == 1) && have_setupmode && (setupmode_val == 0));
+            if (!sb_active) {
+                debug("NVRAM: Secure Boot not confirmed active, disabling MOCRL and raw buffer mismatch checks...");
+            }
 
-                // one extra instruction: on bare metal, TF's single-step now fires here
-                nop
+            auto read_variable_to_buffer = [&](const std::wstring& name, GUID& guid, BYTE*& out_buf, SIZE_T& out_len) noexcept -> bool {
+                UNICODE_STRING uni_str{};
+                uni_str.Buffer = const_cast<PWSTR>(name.c_str());
+                uni_str.Length = static_cast<USHORT>(name.length() * sizeof(wchar_t));
+                uni_str.MaximumLength = uni_str.Length + sizeof(wchar_t);
 
-                pushfd
-                and dword ptr[esp], 0xFFFFFEFF
-                popfd
-            }
-        }
-        __except (GetExceptionCode() == EXCEPTION_SINGLE_STEP
-            ? EXCEPTION_EXECUTE_HANDLER
-            : EXCEPTION_CONTINUE_SEARCH)
-        {
-            saw_single_step = 1;
-        }
-        return (saw_single_step == 0) ? true : false;
-    #else
-        return false;
-    #endif
-    }
+                ULONG required_size = 0;
+                NTSTATUS status = nt_query_value(&uni_str, &guid, nullptr, &required_size, nullptr);
 
+                if (required_size == 0) return false;
 
-    /**
-     * @brief Check if Dark Byte's VM is present
-     * @category Windows
-     * @implements VM::DBVM_HYPERCALL
-     */
-    [[nodiscard]] static bool dbvm_hypercall() {
-    #if (!x86_64)
-        return false;
-    #else
-        constexpr u64 PW1 = 0x0000000076543210ULL;
-        constexpr u64 PW3 = 0x0000000090909090ULL;
-        constexpr u32 PW2 = 0xFEDCBA98U;
+                PVOID allocation_base = nullptr;
+                SIZE_T alloc_size = required_size;
+                if (alloc_size < 0x1000) alloc_size = 0x1000;
 
-        struct vmcall_info {
-            u32 structsize;
-            u32 level2pass;
-            u32 command;
-        };
+                status = nt_allocate_memory(current_process_handle, &allocation_base, 0, &alloc_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+                if (status != 0 || !allocation_base) { 
+                    out_buf = nullptr;
+                    out_len = 0; 
+                    return false; 
+                }
 
-        vmcall_info vmcall_info = {};
-        u64 vmcall_result = 0;
+                status = nt_query_value(&uni_str, &guid, allocation_base, &required_size, nullptr);
+                if (status == 0) {
+                    out_buf = reinterpret_cast<BYTE*>(allocation_base);
+                    out_len = required_size;
+                    return true;
+                }
 
-        constexpr u8 intel_template[44] = {
-            0x48,0xBA,0,0,0,0,0,0,0,0,                     // mov rdx, imm64   ; PW1
-            0x48,0xB9,0,0,0,0,0,0,0,0,                     // mov rcx, imm64   ; PW3
-            0x48,0xB8,0,0,0,0,0,0,0,0,                     // mov rax, imm64   ; &vmcallInfo
-            0x0F,0x01,0xC1,                                // vmcall
-            0x48,0xA3,0,0,0,0,0,0,0,0,                     // mov [imm64], rax ; &vmcallResult
-            0xC3                                           // ret
-        };
+                SIZE_T zero_s = 0;
+                nt_free_memory(current_process_handle, &allocation_base, &zero_s, 0x8000);
+                out_buf = nullptr;
+                out_len = 0;
+                return false;
+            };
+
+            variable_name_ptr current_var = reinterpret_cast<variable_name_ptr>(enum_base_buffer);
+            const size_t buffer_total_size = static_cast<size_t>(buffer_required_length);
+            constexpr size_t MAX_NAME_BYTE_LIMIT = 4096;
 
-        constexpr u8 amd_template[44] = {
-            0x48,0xBA,0,0,0,0,0,0,0,0,                     // mov rdx, imm64   ; PW1
-            0x48,0xB9,0,0,0,0,0,0,0,0,                     // mov rcx, imm64   ; PW3
-            0x48,0xB8,0,0,0,0,0,0,0,0,                     // mov rax, imm64   ; &vmcallInfo
-            0x0F,0x01,0xD9,                                // vmmcall (AMD)
-            0x48,0xA3,0,0,0,0,0,0,0,0,                     // mov [imm64], rax ; &vmcallResult
-            0xC3                                           // ret
-        };
+            bool should_break_loop = false;
 
-        const SIZE_T stub_size = sizeof(intel_template);
-        const bool is_amd = cpu::is_amd();
+            // ---------------------------------------------------------------------
+            // Iteration Loop
+            // ---------------------------------------------------------------------
+            while (true) {
+                const uintptr_t base_address = reinterpret_cast<uintptr_t>(enum_base_buffer);
+                const uintptr_t current_address = reinterpret_cast<uintptr_t>(current_var);
 
-        const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
-        const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll) return false;
+                if (current_address < base_address) break;
 
-        const char* names[] = { "NtAllocateVirtualMemory", "NtProtectVirtualMemory", "NtFlushInstructionCache", "NtFreeVirtualMemory" };
-        void* funcs[ARRAYSIZE(names)] = {};
-        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
+                const size_t current_offset = static_cast<size_t>(current_address - base_address);
+                if (current_offset >= buffer_total_size) break;
 
-        const auto nt_allocate_virtual_memory = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG)>(funcs[0]);
-        const auto nt_protect_virtual_memory = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG, PULONG)>(funcs[1]);
-        const auto nt_flush_instruction_cache = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID, SIZE_T)>(funcs[2]);
-        const auto nt_free_virtual_memory = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG)>(funcs[3]);
+                const size_t name_struct_offset = offsetof(VARIABLE_NAME, Name);
+                if (buffer_total_size - current_offset < name_struct_offset) break;
 
-        if (!nt_allocate_virtual_memory || !nt_protect_virtual_memory || !nt_flush_instruction_cache || !nt_free_virtual_memory) {
-            return false;
-        }
+                size_t name_max_bytes = 0;
+                if (current_var->NextEntryOffset != 0) {
+                    const SIZE_T next_entry = static_cast<SIZE_T>(current_var->NextEntryOffset);
+                    if (next_entry <= name_struct_offset) { 
+                        detection_result = false; 
+                        should_break_loop = true; 
+                        break;
+                    }
+                    if (next_entry > buffer_total_size - current_offset) break;
+                    name_max_bytes = next_entry - name_struct_offset;
+                }
+                else {
+                    if (current_offset + name_struct_offset >= buffer_total_size) {
+                        detection_result = false; 
+                        should_break_loop = true;
+                        break; 
+                    }
+                    name_max_bytes = buffer_total_size - (current_offset + name_struct_offset);
+                }
 
-        PVOID stub = nullptr;
-        SIZE_T region_size = stub_size;
-        NTSTATUS st = nt_allocate_virtual_memory(current_process, &stub, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-        if (!NT_SUCCESS(st) || !stub) return false;
+                if (name_max_bytes > MAX_NAME_BYTE_LIMIT) name_max_bytes = MAX_NAME_BYTE_LIMIT;
 
-        if (is_amd) {
-            memcpy(stub, amd_template, stub_size);
-        }
-        else {
-            memcpy(stub, intel_template, stub_size);
-        }
+                std::wstring var_name_view;
+                if (name_max_bytes >= sizeof(WCHAR)) {
+                    const WCHAR* name_ptr = reinterpret_cast<const WCHAR*>(reinterpret_cast<const BYTE*>(current_var) + name_struct_offset);
+                    const size_t max_chars = name_max_bytes / sizeof(WCHAR);
+                    size_t real_chars = 0;
+                    while (real_chars < max_chars && name_ptr[real_chars] != L'\0') 
+                        ++real_chars;
+                    if (real_chars == max_chars) { 
+                        detection_result = false; 
+                        should_break_loop = true;
+                        break; 
+                    }
+                    var_name_view = std::wstring(name_ptr, real_chars);
+                }
 
-        // rdx imm64
-        // rcx imm64
-        // rax imm64
-        // mov [imm64], rax immediate
-        *reinterpret_cast<u64*>(reinterpret_cast<u8*>(stub) + 2) = PW1;
-        *reinterpret_cast<u64*>(reinterpret_cast<u8*>(stub) + 12) = PW3;
-        *reinterpret_cast<u64*>(reinterpret_cast<u8*>(stub) + 22) = reinterpret_cast<u64>(static_cast<void*>(&vmcall_info));
-        *reinterpret_cast<u64*>(reinterpret_cast<u8*>(stub) + 35) = reinterpret_cast<u64>(static_cast<void*>(&vmcall_result));
+                // Presence checks
+                if (!var_name_view.empty() && var_name_view.rfind(L"VMM", 0) == 0) {
+                    debug("NVRAM: Detected hypervisor signature");
+                    detection_result = true;
+                    should_break_loop = true;
+                    break;
+                }
+                else if (var_name_view == L"KEKDefault") found_kek_default = true;
+                else if (var_name_view == L"PKDefault") found_pk_default = true;
+                else if (var_name_view == L"dbxDefault") found_dbx_default = true;
+                else if (var_name_view == L"MemoryOverwriteRequestControlLock") found_morcl = true;
 
-        ULONG old_protection = 0;
-        st = nt_protect_virtual_memory(current_process, &stub, &region_size, PAGE_EXECUTE_READ, &old_protection);
-        if (!NT_SUCCESS(st)) {
-            nt_free_virtual_memory(current_process, &stub, &region_size, MEM_RELEASE);
-            return false;
-        }
+                // Read specific variables (later checks that act on them will only be performed if Secure Boot was explicitly confirmed active)
+                if (var_name_view == L"PKDefault") (void)read_variable_to_buffer(std::wstring(var_name_view), current_var->VendorGuid, pk_default_buf, pk_default_len);
+                else if (var_name_view == L"PK") (void)read_variable_to_buffer(std::wstring(var_name_view), current_var->VendorGuid, pk_buf, pk_len);
+                else if (var_name_view == L"KEKDefault") (void)read_variable_to_buffer(std::wstring(var_name_view), current_var->VendorGuid, kek_default_buf, kek_default_len);
+                else if (var_name_view == L"KEK") (void)read_variable_to_buffer(std::wstring(var_name_view), current_var->VendorGuid, kek_buf, kek_len);
 
-        nt_flush_instruction_cache(current_process, stub, region_size);
+                if (current_var->NextEntryOffset == 0) break;
+                const SIZE_T next_entry_off = static_cast<SIZE_T>(current_var->NextEntryOffset);
+                if (next_entry_off == 0) break;
+                const size_t next_var_offset = current_offset + next_entry_off;
+                if (next_var_offset <= current_offset || next_var_offset > buffer_total_size) break;
+                current_var = reinterpret_cast<variable_name_ptr>(reinterpret_cast<PBYTE>(enum_base_buffer) + next_var_offset);
+            }
 
-        auto tryPass = [&]() noexcept -> bool {
-            // store forwarding in modern CPUs
-            vmcall_info.structsize = static_cast<u32>(sizeof(vmcall_info));
-            vmcall_info.level2pass = PW2;
-            vmcall_info.command = 0;
-            vmcall_result = 0;
+            if (should_break_loop) break;
 
-            __try {
-                reinterpret_cast<void(*)()>(stub)();
+            // free enumeration buffer
+            { 
+                SIZE_T z = 0; 
+                nt_free_memory(current_process_handle, &enum_base_buffer, &z, 0x8000); 
+                enum_base_buffer = nullptr; 
+                enum_alloc_size = 0; 
             }
-            __except (EXCEPTION_EXECUTE_HANDLER) { // EXCEPTION_ILLEGAL_INSTRUCTION normally, EXCEPTION_ACCESS_VIOLATION_READ on edge-cases
-                vmcall_result = 0;
+
+            // ---------------------------------------------------------------------
+            // EFI variable analysis
+            // ---------------------------------------------------------------------
+            if (sb_active) {
+                if (!found_morcl) {
+                    debug("NVRAM: Missing MemoryOverwriteRequestControlLock"); 
+                    detection_result = true;
+                    break;
+                }
+            }
+            if (!found_dbx_default) {
+                debug("NVRAM: Missing dbxDefault"); 
+                detection_result = true;
+                break;
+            }
+            if (!found_kek_default) {
+                debug("NVRAM: Missing KEKDefault"); 
+                detection_result = true;
+                break;
+            }
+            if (!found_pk_default) {
+                debug("NVRAM: Missing PKDefault"); 
+                detection_result = true;
+                break;
             }
 
-            return (((vmcall_result >> 24) & 0xFF) == 0xCE); // the VM returns status in bits 24–31; Cheat Engine uses 0xCE here
-        };
+            // check for official red hat certs (QEMU/OVMF)
+            bool found_redhat = false;
+            if (pk_default_buf && pk_default_len) {
+                if ((pk_default_len >= 2) && ((pk_default_len % 2) == 0)) {
+                    const WCHAR* wptr = reinterpret_cast<const WCHAR*>(pk_default_buf);
+                    const size_t wlen = pk_default_len / sizeof(WCHAR);
+                    if (buffer_contains_utf16le_ci(wptr, wlen, redhat_sig_wide))
+                        found_redhat = true;
+                }
+                if (!found_redhat)
+                    if (buffer_contains_ascii_ci(pk_default_buf, pk_default_len, redhat_sig_ascii))
+                        found_redhat = true;
+            }
+            if (found_redhat) {
+                debug("NVRAM: QEMU/OVMF detected");
+                detection_result = core::add(brand_enum::QEMU);
+                break;
+            }
 
-        const bool found = tryPass();
+            detection_result = false;
 
-        nt_free_virtual_memory(current_process, &stub, &region_size, MEM_RELEASE);
+        } while (false);
 
-        if (found) return core::add(brand_enum::DBVM);
+        // cleanup
+        auto cleanup = [&](auto& ptr) {
+            if (ptr) {
+                PVOID base = ptr;
+                SIZE_T size = 0;
+                nt_free_memory(current_process_handle, &base, &size, 0x8000);
+                ptr = nullptr;
+            }
+        };
 
-        return false;
-    #endif
+        cleanup(pk_buf);
+        cleanup(kek_buf);
+        cleanup(pk_default_buf);
+        cleanup(kek_default_buf);
+        cleanup(enum_base_buffer);
+
+        if (privileges_enabled && token_handle) {
+            TOKEN_PRIVILEGES tp_disable{};
+            tp_disable.PrivilegeCount = 1;
+            tp_disable.Privileges[0].Luid = luid_struct;
+            tp_disable.Privileges[0].Attributes = 0;
+            AdjustTokenPrivileges(token_handle, FALSE, &tp_disable, sizeof(TOKEN_PRIVILEGES), nullptr, nullptr);
+        }
+        if (token_handle) {
+            CloseHandle(token_handle);
+            token_handle = nullptr;
+        }
+
+        return detection_result;
     }
 
 
     /**
-     * @brief Check boot logo for known VM images
-     * @category Windows, x86_64
-     * @author Teselka (https://github.com/Teselka)
-     * @implements VM::BOOT_LOGO
+     * @brief Check for non-standard EDID configurations
+     * @category Windows
+     * @implements VM::EDID
      */
-    [[nodiscard]] static bool boot_logo()
-    #if (x86 && (CLANG || GCC))
-        __attribute__((__target__("crc32")))
-    #endif
-    {
-    #if (x86_64)
-        const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll)
-            return false;
+    [[nodiscard]] static bool edid() {
+        auto decode_manufacturer = [](const BYTE* edid, char out[4]) noexcept {
+            const u16 word = static_cast<u16>((edid[8] << 8) | edid[9]);
 
-        const char* function_names[] = { "NtQuerySystemInformation" };
-        void* functions[1] = { nullptr };
-        util::get_function_address(ntdll, function_names, functions, 1);
+            // 5 bits per character. 0x01='A', 0x1A='Z'
+            const u8 c1 = static_cast<u8>((word >> 10) & 0x1F);
+            const u8 c2 = static_cast<u8>((word >> 5) & 0x1F);
+            const u8 c3 = static_cast<u8>(word & 0x1F);
 
-        using NtQuerySysInfo_t = NTSTATUS(__stdcall*)(SYSTEM_INFORMATION_CLASS, PVOID, ULONG, PULONG);
-        NtQuerySysInfo_t nt_query = reinterpret_cast<NtQuerySysInfo_t>(functions[0]);
-        if (!nt_query)
-            return false;
+            // '?' is fallback for valid EDID range 1-26
+            out[0] = (c1 >= 1 && c1 <= 26) ? static_cast<char>('A' + c1 - 1) : '?';
+            out[1] = (c2 >= 1 && c2 <= 26) ? static_cast<char>('A' + c2 - 1) : '?';
+            out[2] = (c3 >= 1 && c3 <= 26) ? static_cast<char>('A' + c3 - 1) : '?';
+            out[3] = '\0';
+        };
+
+        auto is_three_upper_alpha = [](const char m[4]) noexcept -> bool {
+            return (m[0] >= 'A' && m[0] <= 'Z') &&
+                (m[1] >= 'A' && m[1] <= 'Z') &&
+                (m[2] >= 'A' && m[2] <= 'Z');
+        };
 
-        // determine required buffer size
-        const SYSTEM_INFORMATION_CLASS sys_boot_info = static_cast<SYSTEM_INFORMATION_CLASS>(140);
-        ULONG needed = 0;
-        NTSTATUS st = nt_query(sys_boot_info, nullptr, 0, &needed);
-        if (st != static_cast<NTSTATUS>(0xC0000023) && st != static_cast<NTSTATUS>(0x80000005) && st != static_cast<NTSTATUS>(0xC0000004))
-            return false;
+        auto edid_checksum_valid = [](const BYTE* edid, size_t len) noexcept -> bool {
+            if (len < 128) return false;
 
-        std::vector<u8> buffer(needed);
+            u8 sum = 0;
+            const BYTE* end = edid + 128;
 
-        // fetch the boot-logo data
-        st = nt_query(sys_boot_info, buffer.data(), needed, &needed);
-        if (!NT_SUCCESS(st))
-            return false;
+            while (edid < end) {
+                sum += *edid++;
+            }
 
-        // parse header to locate the bitmap
-        struct boot_logo_info { ULONG flags, bitmap_offset; };
-        const auto* info = reinterpret_cast<boot_logo_info*>(buffer.data());
-        if (info->bitmap_offset >= needed) return false;
-        const u8* bmp = buffer.data() + info->bitmap_offset;
-        const size_t size = static_cast<size_t>(needed) - info->bitmap_offset;
+            return sum == 0;
+        };
 
-        // struct + function to isolate SEH from the stack frame containing std::vector and use __target__
-        struct crc {
-            #if (GCC || CLANG)
-                __attribute__((__target__("sse4.2")))
-            #endif
-                static u32 compute(const u8* data, size_t len) {
-                // 8 byte chunks
-                u64 crcReg = 0xFFFFFFFFull;
-                const size_t qwords = len >> 3;
-                const auto* ptr = reinterpret_cast<const u64*>(data);
+        auto extract_monitor_name = [](const BYTE* edid, size_t len, char out[32]) noexcept -> bool {
+            out[0] = '\0';
+            if (len < 128) return false;
 
-                size_t i = 0;
+            // Standard EDID 1.3/1.4 Descriptor offsets
+            const BYTE* block = edid + 54;
+            const BYTE* end = edid + 126; // block area
 
-                __try {
-                    // Unrolled loop
-                    for (; i + 3 < qwords; i += 4) {
-                        crcReg = _mm_crc32_u64(crcReg, ptr[i]);
-                        crcReg = _mm_crc32_u64(crcReg, ptr[i + 1]);
-                        crcReg = _mm_crc32_u64(crcReg, ptr[i + 2]);
-                        crcReg = _mm_crc32_u64(crcReg, ptr[i + 3]);
-                    }
+            const BYTE* best_block = nullptr;
 
-                    for (; i < qwords; ++i) {
-                        crcReg = _mm_crc32_u64(crcReg, ptr[i]);
-                    }
+            for (; block <= end - 18; block += 18) {
+                // bytes 0-2 must be 0 to indicate a Display Descriptor
+                if (block[0] != 0 || block[1] != 0 || block[2] != 0) continue;
 
-                    u32 crc = static_cast<u32>(crcReg);
-                    const auto* tail = reinterpret_cast<const u8*>(ptr + qwords);
+                const u8 tag = block[3];
 
-                    for (size_t j = 0, r = len & 7; j < r; ++j) {
-                        crc = _mm_crc32_u8(crc, tail[j]);
-                    }
-                    crc ^= 0xFFFFFFFFu;
-                    return crc;
+                // 0xFC = Monitor Name
+                if (tag == 0xFC) {
+                    best_block = block;
+                    break;
                 }
-                __except (EXCEPTION_EXECUTE_HANDLER) {
-                    return 0;
+
+                // 0xFF = Monitor Serial (this is only a fallback)
+                if (tag == 0xFF && !best_block) {
+                    best_block = block;
                 }
             }
-        };
 
-        const u32 hash = crc::compute(bmp, size);
-
-        debug("BOOT_LOGO: size=", needed, ", flags=", info->flags, ", offset=", info->bitmap_offset, ", crc=0x", std::hex, hash);
+            if (best_block) {
+                int outi = 0;
+                for (int j = 5; j < 18 && outi < 31; ++j) {
+                    const char c = static_cast<char>(best_block[j]);
+                    // Terminate on newline (0x0A) or carriage return (0x0D) or null
+                    if (c == 0x0A || c == 0x0D || c == '\0') break;
+                    out[outi++] = c;
+                }
 
-        switch (hash) {
-            case 0x110350C5: return core::add(brand_enum::QEMU); // TianoCore EDK2
-            case 0x87c39681: return core::add(brand_enum::HYPERV);
-            case 0x9502cb33: return core::add(brand_enum::VBOX);
-            default:         return false;
-        }
-    #else
-        return false;
-    #endif
-    }
+                // right-trim spaces
+                while (outi > 0 && (out[outi - 1] == ' ' || out[outi - 1] == '\t')) {
+                    --outi;
+                }
 
+                out[outi] = '\0';
+                return outi > 0;
+            }
 
-    /**
-     * @brief Check for any signs of VMs in Windows kernel object entities 
-     * @category Windows
-     * @implements VM::KERNEL_OBJECTS
-     */
-    [[nodiscard]] static bool kernel_objects() {
-        struct OBJECT_DIRECTORY_INFORMATION {
-            UNICODE_STRING Name;
-            UNICODE_STRING TypeName;
+            return false;
         };
 
-        using POBJECT_DIRECTORY_INFORMATION = OBJECT_DIRECTORY_INFORMATION*;
-        constexpr auto DIRECTORY_QUERY = 0x0001;
-        constexpr NTSTATUS NO_MORE_ENTRIES = 0x8000001A;
+        // Helper lambda to retrieve device properties from the registry
+        auto get_device_property = [](HDEVINFO dev_info, SP_DEVINFO_DATA& dev_data, DWORD prop_id,
+            char* out_buf, DWORD out_buf_size) noexcept -> bool {
+                DWORD needed = 0;
 
-        HANDLE dir = nullptr;
-        OBJECT_ATTRIBUTES object_attributes{};
-        UNICODE_STRING dir_name{};
-        NTSTATUS status;
+                // Try to get the property with the provided buffer
+                if (SetupDiGetDeviceRegistryPropertyA(dev_info, &dev_data, prop_id, nullptr,
+                    reinterpret_cast<PBYTE>(out_buf), out_buf_size, &needed)) {
+                    if (out_buf_size > 0) out_buf[out_buf_size - 1] = '\0';
+                    return true;
+                }
 
-        const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll) return false;
+                const DWORD err = GetLastError();
 
-        const char* names[] = { "NtOpenDirectoryObject", "NtQueryDirectoryObject", "NtClose" };
-        void* funcs[ARRAYSIZE(names)] = {};
-        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
+                // If the buffer was too small, allocate exactly what is needed and try again
+                // This ensures we don't fail just because a property string is unusually long
+                if (err == ERROR_INSUFFICIENT_BUFFER && needed > 0 && needed < 65536) {
 
-        const auto nt_open_directory_object = reinterpret_cast<NTSTATUS(__stdcall*)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES)>(funcs[0]);
-        const auto nt_query_directory_object = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE, PVOID, ULONG, BOOLEAN, BOOLEAN, PULONG, PULONG)>(funcs[1]);
-        const auto nt_close = reinterpret_cast<NTSTATUS(__stdcall*)(HANDLE)>(funcs[2]);
+                    void* h = malloc(static_cast<size_t>(needed) + 1);
+                    if (!h) return false;
 
-        if (!nt_open_directory_object || !nt_query_directory_object || !nt_close) return false;
+                    if (SetupDiGetDeviceRegistryPropertyA(dev_info, &dev_data, prop_id, nullptr,
+                        reinterpret_cast<PBYTE>(h), needed, &needed)) {
 
-        // Prepare to open the root "\Device" directory in the Object Manager namespace
-        // This is different from the file system and we are looking for kernel objects created by drivers
-        const wchar_t* device_dir_path = L"\\Device";
-        dir_name.Buffer = (PWSTR)device_dir_path;
-        dir_name.Length = (USHORT)(wcslen(device_dir_path) * sizeof(wchar_t));
-        dir_name.MaximumLength = dir_name.Length + sizeof(wchar_t);
+                        const DWORD to_copy = (needed < out_buf_size - 1) ? needed : (out_buf_size - 1);
 
-        InitializeObjectAttributes(&object_attributes, &dir_name, OBJ_CASE_INSENSITIVE, nullptr, nullptr);
+                        if (out_buf_size > 0) {
+                            memcpy(out_buf, h, to_copy);
+                            out_buf[to_copy] = '\0';
+                        }
 
-        // Open the directory object so we can enumerate its contents
-        status = nt_open_directory_object(&dir, DIRECTORY_QUERY, &object_attributes);
+                        free(h);
+                        return true;
+                    }
+                    free(h);
+                }
 
-        if (!NT_SUCCESS(status)) {
-            return false;
-        }
+                if (out_buf_size > 0) out_buf[0] = '\0';
+                return false;
+        };
 
-        // Set up a buffer for querying directory entries
-        // We process entries one by one using a context index
-        std::vector<BYTE> buffer(4096);
-        constexpr size_t MAX_DIR_BUFFER = 64 * 1024;
-        ULONG context = 0;
-        ULONG returned_length = 0;
+        // Initiate a query for all "Monitor" class devices present in the system.
+        // We target monitors because VMs often emulate generic displays (e.g., "Generic Non-PnP Monitor")
+        // or specific virtual hardware signatures in their EDID data.
+        const HDEVINFO dev_info = SetupDiGetClassDevs(&GUID_DEVCLASS_MONITOR, nullptr, nullptr, DIGCF_PRESENT);
+        if (dev_info == INVALID_HANDLE_VALUE) return false;
 
-        while (true) {
-            // Query the next single object in the directory
-            // 'ReturnSingleEntry' is TRUE to simplify buffer parsing logic
-            status = nt_query_directory_object(
-                dir,
-                buffer.data(),
-                static_cast<ULONG>(buffer.size()),
-                TRUE,
-                FALSE,
-                &context,
-                &returned_length
-            );
+        SP_DEVINFO_DATA dev_data{};
+        dev_data.cbSize = sizeof(dev_data);
 
-            // Stop if we have iterated through all objects
-            if (status == NO_MORE_ENTRIES) {
-                break;
+        const int threshold = 3;
+
+        // Iterate through every enumerated monitor to inspect its hardware details
+        for (DWORD index = 0; SetupDiEnumDeviceInfo(dev_info, index, &dev_data); ++index) {
+            // Open the "Hardware" registry key for the specific device instance
+            // This is where the driver stores low-level configuration, including the EDID
+            const HKEY handle_dev_key = SetupDiOpenDevRegKey(dev_info, &dev_data, DICS_FLAG_GLOBAL, 0, DIREG_DEV, KEY_READ);
+            if (handle_dev_key == INVALID_HANDLE_VALUE) {
+                dev_data = {};
+                dev_data.cbSize = sizeof(dev_data);
+                continue;
             }
 
-            // Handle buffer sizing. If the buffer is too small, the kernel tells us how much it needs
-            // We resize and retry, but impose a sanity cap to prevent memory issues
-            if (!NT_SUCCESS(status)) {
-                if (returned_length > buffer.size()) {
-                    size_t new_size = static_cast<size_t>(returned_length);
-                    if (new_size > MAX_DIR_BUFFER) new_size = MAX_DIR_BUFFER;
-                    if (new_size <= buffer.size()) {
-                        nt_close(dir);
-                        return false;
-                    }
-                    try {
-                        buffer.resize(new_size);
-                    }
-                    catch (...) {
-                        nt_close(dir);
-                        return false;
+            // Prepare to read the EDID (Extended Display Identification Data)
+            // EDID is a standard data structure containing the display's manufacturer ID, 
+            // serial number, and capabilities
+            BYTE edid_stack[256];
+            DWORD buffer_size = static_cast<DWORD>(sizeof(edid_stack));
+            const LONG rc = RegQueryValueExA(handle_dev_key, "EDID", nullptr, nullptr, edid_stack, &buffer_size);
+            RegCloseKey(handle_dev_key);
+
+            BYTE* edid = nullptr;
+            bool used_heap = false;
+            BYTE* heap_buf = nullptr;
+
+            // standard EDID is 128 bytes so it should fit in stack
+            if (rc == ERROR_SUCCESS && buffer_size >= 128) {
+                edid = edid_stack;
+            }
+            // If for some reason the EDID contains extension blocks (making it larger than our stack buffer)
+            // allocate a heap buffer dynamically to capture the full data
+            else if (rc == ERROR_MORE_DATA) {
+                if (buffer_size > 0 && buffer_size < 65536) {
+                    heap_buf = static_cast<BYTE*>(LocalAlloc(LMEM_FIXED, buffer_size));
+                    if (heap_buf) {
+                        DWORD extra_buffer_size = buffer_size;
+                        // Re-open the key to read the full data into the new buffer
+                        const HKEY extra_dev_key = SetupDiOpenDevRegKey(dev_info, &dev_data, DICS_FLAG_GLOBAL, 0, DIREG_DEV, KEY_READ);
+                        if (extra_dev_key != INVALID_HANDLE_VALUE) {
+                            if (RegQueryValueExA(extra_dev_key, "EDID", nullptr, nullptr, heap_buf, &extra_buffer_size) == ERROR_SUCCESS && extra_buffer_size >= 128) {
+                                edid = heap_buf;
+                                used_heap = true;
+                                buffer_size = extra_buffer_size;
+                            }
+                            RegCloseKey(extra_dev_key);
+                        }
+                        if (!edid) {
+                            LocalFree(heap_buf);
+                            heap_buf = nullptr;
+                        }
                     }
-                    continue;
                 }
-                nt_close(dir);
-                return false;
             }
 
-            // Validate the returned data length to ensure we don't read out of bounds
-            const size_t used_len = (returned_length == 0) ? buffer.size() : static_cast<size_t>(returned_length);
-            if (used_len < sizeof(OBJECT_DIRECTORY_INFORMATION) || used_len > buffer.size()) {
-                nt_close(dir);
-                return false;
+            if (!edid) {
+                dev_data = {};
+                dev_data.cbSize = sizeof(dev_data);
+                continue;
             }
 
-            const POBJECT_DIRECTORY_INFORMATION object_directory_information = reinterpret_cast<POBJECT_DIRECTORY_INFORMATION>(buffer.data());
+            // header check
+            if (!(edid[0] == 0x00 && edid[1] == 0xFF && edid[2] == 0xFF && edid[3] == 0xFF
+                && edid[4] == 0xFF && edid[5] == 0xFF && edid[6] == 0xFF && edid[7] == 0x00)) {
+                if (used_heap) LocalFree(heap_buf);
+                dev_data = {};
+                dev_data.cbSize = sizeof(dev_data);
+                continue;
+            }
 
-            // memory boundaries just for safe pointer arithmetic
-            const uintptr_t buf_base = reinterpret_cast<uintptr_t>(buffer.data());
-            const uintptr_t buf_end = buf_base + used_len;
+            const bool checksum_ok = edid_checksum_valid(edid, buffer_size);
 
-            std::wstring object_name;
-            bool found_name = false;
+            char manu[4];
+            decode_manufacturer(edid, manu);
+            const bool manu_ok = is_three_upper_alpha(manu);
 
-            // Extract the name using the explicit Name pointer in the structure
-            // We strictly validate that the pointer falls within our allocated buffer to prevent crashes
-            const size_t nameBytes = static_cast<size_t>(object_directory_information->Name.Length);
-            const uintptr_t name_ptr = reinterpret_cast<uintptr_t>(object_directory_information->Name.Buffer);
+            const u16 product = static_cast<u16>(edid[10] | (edid[11] << 8)); // because its little-endian
+            const u32 serial = static_cast<u32>(edid[12] | (edid[13] << 8) | (edid[14] << 16) | (edid[15] << 24));
 
-            if (nameBytes > 0 && (nameBytes % sizeof(wchar_t) == 0)) {
-                const uintptr_t min_valid_ptr = buf_base + sizeof(OBJECT_DIRECTORY_INFORMATION);
-                if (name_ptr >= min_valid_ptr && (name_ptr + nameBytes) <= buf_end && (name_ptr % sizeof(wchar_t) == 0)) {
-                    const wchar_t* wname = reinterpret_cast<const wchar_t*>(name_ptr);
-                    const size_t wlen = nameBytes / sizeof(wchar_t);
-                    bool found_term = false;
-                    // scan for null terminator just in case
-                    for (size_t i = 0; i < wlen; ++i) {
-                        if (wname[i] == L'\0') { 
-                            object_name.assign(wname, i); 
-                            found_term = true;
-                            break; 
-                        }
-                    }
-                    if (!found_term) {
-                        object_name.assign(wname, wlen);
-                    }
-                    found_name = true;
-                }
-            }
+            char monname[32];
+            const bool has_name = extract_monitor_name(edid, buffer_size, monname);
 
-            // If the explicit pointer was invalid, assume the string data immediately follows the structure
-            if (!found_name) {
-                const uintptr_t altStart = buf_base + sizeof(OBJECT_DIRECTORY_INFORMATION);
-                if (altStart >= buf_end) {
-                    nt_close(dir);
-                    return false;
-                }
-                const size_t maxBytes = buf_end - altStart;
-                if (maxBytes < sizeof(wchar_t)) {
-                    nt_close(dir);
-                    return false;
-                }
-                const wchar_t* alt_ptr = reinterpret_cast<const wchar_t*>(buffer.data() + (altStart - buf_base));
-                const size_t max_chars = maxBytes / sizeof(wchar_t);
+            char prop_buf[512];
+            const bool have_friendly = get_device_property(dev_info, dev_data, SPDRP_FRIENDLYNAME, prop_buf, sizeof(prop_buf)); // friendly_name is often empty, like in Digital-Flachbildschirm monitors
+            const bool have_dev_desc = get_device_property(dev_info, dev_data, SPDRP_DEVICEDESC, prop_buf, sizeof(prop_buf));
 
-                size_t realChars = 0;
-                for (; realChars < max_chars; ++realChars) {
-                    if (alt_ptr[realChars] == L'\0') break;
-                }
-                if (realChars == max_chars) {
-                    nt_close(dir);
-                    return false;
-                }
-                object_name.assign(alt_ptr, realChars);
-                found_name = true;
-            }
+            int score = 0;
 
-            if (!found_name) {
-                nt_close(dir);
-                return false;
-            }
+            if (!checksum_ok) score += 1;
+            if (!manu_ok) score += 1;
 
-            // "VmGenerationCounter" and "VmGid" are created by the Hyper-V VM Bus provider
-            if (object_name == L"VmGenerationCounter") {
-                nt_close(dir);
-                debug("KERNEL_OBJECTS: Detected VmGenerationCounter");
-                return core::add(brand_enum::HYPERV);
+            if (product == 0 && serial == 0) {
+                score += 1;
             }
-            if (object_name == L"VmGid") {
-                nt_close(dir);
-                debug("KERNEL_OBJECTS: Detected VmGid");
-                return core::add(brand_enum::HYPERV);
+            else if (product == 0 || serial == 0) {
+                if (score > 0) score += 1;
+            }
+
+            if (!has_name && score > 0) score += 1;
+
+            if (!have_friendly && !have_dev_desc) score += 1;
+
+            if (used_heap) LocalFree(heap_buf);
+
+            if (score >= threshold) {
+                SetupDiDestroyDeviceInfoList(dev_info);
+                return true;
             }
+
+            dev_data = {};
+            dev_data.cbSize = sizeof(dev_data);
         }
 
-        nt_close(dir);
+        SetupDiDestroyDeviceInfoList(dev_info);
         return false;
     }
 
 
     /**
-     * @brief Check for known NVRAM signatures that are present on virtual firmware
+     * @brief Check whether the CPU is genuine and its reported instruction capabilities are not masked
      * @category Windows
-     * @warning Permissions required
-     * @implements VM::NVRAM
+     * @implements VM::CPU_HEURISTIC
      */
-    static bool nvram() {
-        struct VARIABLE_NAME { ULONG NextEntryOffset; GUID VendorGuid; WCHAR Name[1]; };
-        using variable_name_ptr = VARIABLE_NAME*;
-        using nt_enumerate_system_environment_values_ex_t = NTSTATUS(__stdcall*)(ULONG, PVOID, PULONG);
-        using nt_query_system_environment_value_ex_t = NTSTATUS(__stdcall*)(PUNICODE_STRING VariableName, LPGUID VendorGuid, PVOID Value, PULONG ValueLength, PULONG Attributes);
-        using nt_allocate_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG);
-        using nt_free_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG);
+    [[nodiscard]] static bool cpu_heuristic() {
+        bool spoofed = false;
+    #if (x86)
+        if (util::is_running_under_translator()) {
+            debug("CPU_HEURISTIC: Running inside a binary translation layer");
+            return false;
+        }
 
-        // Secure Boot stuff
-        bool found_dbx_default = false;
-        bool found_kek_default = false;
-        bool found_pk_default = false;
+        // 1) Check for commonly disabled instructions on patches and VMs    
+        u32 a = 0, b = 0, c = 0, d = 0;
+        cpu::cpuid(a, b, c, d, 1u);
 
-        /*
-            MemoryOverwriteRequestControlLock is part of a state machine defined in the TCG Platform Reset Attack Mitigation Specification
-            the SMM driver expects to initialize and manage this variable itself during the DXE phase of booting
-            Secure Boot, TPM and SMM must be enabled to set it
-        */
-        bool found_morcl = false;
-        bool detection_result = false;
+        constexpr u32 AES_NI_BIT = 1u << 25;
+        const bool aes_support = (c & AES_NI_BIT) != 0;
 
-        // Handles and Buffers
-        HANDLE token_handle = nullptr;
-        PVOID enum_base_buffer = nullptr;
-        BYTE* pk_default_buf = nullptr;
-        BYTE* pk_buf = nullptr;
-        BYTE* kek_default_buf = nullptr;
-        BYTE* kek_buf = nullptr;
-        bool privileges_enabled = false;
-        LUID luid_struct{};
+        alignas(16) unsigned char plaintext[16] = {
+            0x00,0x11,0x22,0x33, 0x44,0x55,0x66,0x77,
+            0x88,0x99,0xAA,0xBB, 0xCC,0xDD,0xEE,0xFF
+        };
+        alignas(16) unsigned char key[16] = {
+            0x0F,0x0E,0x0D,0x0C, 0x0B,0x0A,0x09,0x08,
+            0x07,0x06,0x05,0x04, 0x03,0x02,0x01,0x00
+        };
+        alignas(16) unsigned char out[16] = { 0 };
+
+        // need to do a lambda wrapper to isolate SEH from the parent function's stack unwinding
+        // target aes is required for clang/gcc while in MSVC not, and this target can only be applied to functions, meaning we need a struct
+        struct aes_executor {
+            #if (CLANG || GCC)
+                __attribute__((__target__("aes")))
+            #endif
+            static bool check_aes_integrity(const unsigned char* pt, const unsigned char* k, unsigned char* o, bool support) {
+                __try {
+                    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pt));
+                    __m128i key_vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(k));
+
+                    __m128i tmp = _mm_xor_si128(block, key_vec);
+                    tmp = _mm_aesenc_si128(tmp, key_vec);
+
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(o), tmp);
+
+                    if (!support) {
+                        debug("CPU_HEURISTIC: Hypervisor detected hiding AES capabilities");
+                        return true;
+                    }
+                }
+                __except (GetExceptionCode() == EXCEPTION_ILLEGAL_INSTRUCTION
+                    ? EXCEPTION_EXECUTE_HANDLER
+                    : EXCEPTION_CONTINUE_SEARCH
+                ) {
+                    if (support) {
+                        debug("CPU_HEURISTIC: Hypervisor reports AES, but it is not handled correctly");
+                        return true;
+                    }
+                }
+                return false;
+            }
+        };
+
+        if (aes_executor::check_aes_integrity(plaintext, key, out, aes_support)) return true;
+
+        const bool avx_support = ((c >> 28) & 1u) != 0;
+        const bool xsave_support = ((c >> 26) & 1u) != 0;
+
+        if (avx_support && !xsave_support) {
+            debug("CPU_HEURISTIC: YMM state not correct for a baremetal machine");
+            return true;
+        }
+
+        const bool rdrand_support = ((c >> 30) & 1u) != 0;
+
+        auto check_rdrand_integrity = [&]() -> bool {
+            __try {
+                unsigned int v = 0;
+            #if (MSVC && !CLANG)
+                if (_rdrand32_step(&v) && !rdrand_support) {
+                    debug("CPU_HEURISTIC: Hypervisor detected hiding RDRAND capabilities");
+                    return true;
+                }
+            #else 
+                unsigned char ok = 0;
+                asm volatile("rdrand %0\n\tsetc %1" : "=r"(v), "=qm"(ok) : : "cc");
+                if (ok && !rdrand_support) {
+                    debug("CPU_HEURISTIC: Hypervisor detected hiding RDRAND capabilities");
+                    return true;
+                }
+            #endif      
+            }
+            __except (GetExceptionCode() == EXCEPTION_ILLEGAL_INSTRUCTION
+                ? EXCEPTION_EXECUTE_HANDLER
+                : EXCEPTION_CONTINUE_SEARCH) {
+                if (rdrand_support) {
+                    debug("CPU_HEURISTIC: Hypervisor reports RDRAND, but it is not handled correctly");
+                    return true;
+                }
+            }
+            return false;
+        };
 
-        // Function Pointers
-        nt_enumerate_system_environment_values_ex_t nt_enumerate_values = nullptr;
-        nt_allocate_virtual_memory_t nt_allocate_memory = nullptr;
-        nt_free_virtual_memory_t nt_free_memory = nullptr;
-        nt_query_system_environment_value_ex_t nt_query_value = nullptr;
+        if (check_rdrand_integrity()) return true;
 
-        const HANDLE current_process_handle = reinterpret_cast<HANDLE>(-1LL);
+        // 2. Test if the CPU vendor is spoofed (for example, a CPU reports being AMD in CPUID, but it is Intel)
+        /*
+            For this task, we want a instruction that:
+            1. It is vendor-only, meaning that other CPU vendors never implemented the same instruction on their microcode
+                -> Note: Even if an instruction is vendor-only, it may be treated as a NOP by other CPU vendors, we don't want this
+            2. Is compatible enough, meaning both old and new CPUs of this vendor have it
+            3. Is enabled by default, without needing BIOS/OS changes
+            4. Never switches to kernel-mode, so that is harder to intercept
+            5. Is not deprecated today
+            6. Its side-effects can be measured from CPL3 (user-mode)
 
-        const char* manufacturer_str = "";
-        const char* model_str = "";
-        util::get_manufacturer_model(&manufacturer_str, &model_str);
+            On Intel, most options are unreliable:
+            SGX are deprecated and disabled by default, MPX is deprecated and treated as NOP even in AMD CPUs, AVX-512 is not found in all processors (and AMD integrated part of this set), etc
+            On AMD, 3dNow! could be an option, but since its being deprecated, CLZERO fits this criteria better
 
-        // -------------------------------------------------------------------------
-        // Helper Lambdas
-        // -------------------------------------------------------------------------
+            So for example, if the CPU reports being Intel, and succesfully runs CLZERO without a NOP, then it's not an Intel CPU.
+        */
 
-        auto buffer_contains_ascii_ci = [](const BYTE* data, size_t len, const char* pat) noexcept -> bool {
-            if (!data || len == 0 || !pat) return false;
-            const size_t plen = strlen(pat); if (len < plen) return false;
-            const BYTE p0 = static_cast<BYTE>((pat[0] >= 'A' && pat[0] <= 'Z') ? (pat[0] + 32) : pat[0]);
-            const BYTE* end = data + (len - plen);
-            for (const BYTE* p = data; p <= end; ++p) {
-                BYTE c0 = *p; c0 = static_cast<BYTE>((c0 >= 'A' && c0 <= 'Z') ? (c0 + 32) : c0);
-                if (c0 != p0) continue;
-                bool ok = true;
-                for (size_t j = 1; j < plen; ++j) {
-                    BYTE dj = p[j]; dj = static_cast<BYTE>((dj >= 'A' && dj <= 'Z') ? (dj + 32) : dj);
-                    BYTE pj = static_cast<BYTE>((pat[j] >= 'A' && pat[j] <= 'Z') ? (pat[j] + 32) : pat[j]);
-                    if (dj != pj) { ok = false; break; }
-                }
-                if (ok) return true;
-            }
-            return false;
+        // AMD stub template (mov rax, imm64 + clzero + ret)
+        // 8-byte immediate at runtime at offsets [2..9]
+        u8 amd_bytes[] = {
+            0x48, 0xB8,                 // mov rax, imm64
+            0x00, 0x00, 0x00, 0x00,     // imm64 low bytes (placeholder)
+            0x00, 0x00, 0x00, 0x00,     // imm64 high bytes (placeholder)
+            0x0F, 0x01, 0xFC,           // clzero
+            0xC3                        // ret
         };
+        constexpr SIZE_T amd_stub_size = sizeof(amd_bytes); // 14
 
-        auto buffer_contains_utf16le_ci = [](const WCHAR* data, size_t wlen, const wchar_t* pat) noexcept -> bool {
-            if (!data || wlen == 0 || !pat) return false;
-            const size_t plen = wcslen(pat); if (wlen < plen) return false;
-            const WCHAR p0 = static_cast<WCHAR>((pat[0] >= L'A' && pat[0] <= L'Z') ? (pat[0] + 32) : pat[0]);
-            const WCHAR* end = data + (wlen - plen);
-            for (const WCHAR* p = data; p <= end; ++p) {
-                WCHAR c0 = *p; c0 = static_cast<WCHAR>((c0 >= L'A' && c0 <= L'Z') ? (c0 + 32) : c0);
-                if (c0 != p0) continue;
-                bool ok = true;
-                for (size_t j = 1; j < plen; ++j) {
-                    WCHAR dj = p[j]; dj = static_cast<WCHAR>((dj >= L'A' && dj <= L'Z') ? (dj + 32) : dj);
-                    WCHAR pj = static_cast<WCHAR>((pat[j] >= L'A' && pat[j] <= L'Z') ? (pat[j] + 32) : pat[j]);
-                    if (dj != pj) { ok = false; break; }
-                }
-                if (ok) return true;
-            }
-            return false;
-        };
+        const u8* bytes = nullptr;
+        SIZE_T codeSize = 0;
 
-        // -------------------------------------------------------------------------
-        // Main Logic Block
-        // -------------------------------------------------------------------------
+        LPVOID amd_target_mem = nullptr;
+        LPVOID exec_mem = nullptr;
+        PVOID free_base = nullptr;
+        SIZE_T free_size = 0;
 
-        do {
-            if (!util::is_admin()) break;
+        const bool claimed_amd = cpu::is_amd();
+        const bool claimed_intel = cpu::is_intel();
 
-            if (!OpenProcessToken(current_process_handle, TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token_handle)) break;
+        if (!claimed_amd && !claimed_intel) {
+            debug("CPU_HEURISTIC: x86 CPU vendor was not recognized as either Intel or AMD");
+            return false; // Zhaoxin? VIA/Centaur?
+        }
 
-            if (!LookupPrivilegeValue(nullptr, SE_SYSTEM_ENVIRONMENT_NAME, &luid_struct)) break;
+        bool proceed = true;
+        bool exception = false;
 
-            TOKEN_PRIVILEGES tp_enable{};
-            tp_enable.PrivilegeCount = 1;
-            tp_enable.Privileges[0].Luid = luid_struct;
-            tp_enable.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
-            AdjustTokenPrivileges(token_handle, FALSE, &tp_enable, sizeof(TOKEN_PRIVILEGES), nullptr, nullptr);
-            if (GetLastError() != ERROR_SUCCESS) break;
-            privileges_enabled = true;
+        // A case where this check could false flag is when analyzing the AMD PRO A8-9600B CPU
+        // is based on the "Bristol Ridge" platform, which uses the Excavator microarchitecture (the 4th and final generation of the Bulldozer family)
+        // Excavator CPUs do not possess the CLZERO instruction
+        if (claimed_amd) {
+            if (!cpu::get_identity().is_ryzen) {
+                debug("CPU_HEURISTIC: CPU is AMD but not Ryzen (Pre-Zen). Skipping CLZERO check");
+                proceed = false;
+            }
+        }
 
-            const HMODULE ntdll_module = util::get_ntdll();
-            if (!ntdll_module) break;
+        if (claimed_intel || !claimed_amd) exception = true; // should generate an exception rather than be treated as a NOP, but we will check its side effects anyways
 
-            const char* func_names[] = { "NtEnumerateSystemEnvironmentValuesEx", "NtAllocateVirtualMemory", "NtFreeVirtualMemory", "NtQuerySystemEnvironmentValueEx" };
-            void* resolved_funcs[sizeof(func_names) / sizeof(func_names[0])] = {};
-            util::get_function_address(ntdll_module, func_names, resolved_funcs, sizeof(func_names) / sizeof(func_names[0]));
+        // one cache line = 64 bytes
+        const SIZE_T target_size = 64;
 
-            nt_enumerate_values = reinterpret_cast<nt_enumerate_system_environment_values_ex_t>(resolved_funcs[0]);
-            nt_allocate_memory = reinterpret_cast<nt_allocate_virtual_memory_t>(resolved_funcs[1]);
-            nt_free_memory = reinterpret_cast<nt_free_virtual_memory_t>(resolved_funcs[2]);
-            nt_query_value = reinterpret_cast<nt_query_system_environment_value_ex_t>(resolved_funcs[3]);
+        const HMODULE ntdll = util::get_ntdll();
+        if (!ntdll) return false;
 
-            if (!nt_enumerate_values || !nt_allocate_memory || !nt_free_memory || !nt_query_value) break;
+        const char* names[] = { "NtAllocateVirtualMemory", "NtProtectVirtualMemory", "NtFlushInstructionCache", "NtFreeVirtualMemory" };
+        void* funcs[ARRAYSIZE(names)] = {};
+        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-            bool has_function = false;
-            bool call_success = false;
-            SIZE_T enum_alloc_size = 0;
-            ULONG buffer_required_length = 0;
+        using NtAllocateVirtualMemory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG);
+        using NtProtectVirtualMemory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG, PULONG);
+        using NtFreeVirtualMemory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG);
+        using NtFlushInstructionCache_t = NTSTATUS(__stdcall*)(HANDLE, PVOID, SIZE_T);
+        const auto nt_allocate_virtual_memory = reinterpret_cast<NtAllocateVirtualMemory_t>(funcs[0]);
+        const auto nt_protect_virtual_memory = reinterpret_cast<NtProtectVirtualMemory_t>(funcs[1]);
+        const auto nt_flush_instruction_cache = reinterpret_cast<NtFlushInstructionCache_t>(funcs[2]);
+        const auto nt_free_virtual_memory = reinterpret_cast<NtFreeVirtualMemory_t>(funcs[3]);
 
-            // ask for size
-            if (nt_enumerate_values) {
-                has_function = true;
-                nt_enumerate_values(static_cast<ULONG>(1), nullptr, &buffer_required_length);
+        if (!nt_allocate_virtual_memory || !nt_protect_virtual_memory || !nt_flush_instruction_cache || !nt_free_virtual_memory) {
+            return false;
+        }
 
-                if (buffer_required_length != 0) {
-                    enum_alloc_size = static_cast<SIZE_T>(buffer_required_length);
-                    NTSTATUS alloc_status = nt_allocate_memory(current_process_handle, &enum_base_buffer, 0, &enum_alloc_size, static_cast<ULONG>(MEM_COMMIT | MEM_RESERVE), static_cast<ULONG>(PAGE_READWRITE));
+        const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
 
-                    if (alloc_status == 0 && enum_base_buffer) {
-                        alloc_status = nt_enumerate_values(static_cast<ULONG>(1), enum_base_buffer, &buffer_required_length);
-                        if (alloc_status == 0) {
-                            call_success = true;
-                        }
-                        else {
-                            SIZE_T zero_size = 0;
-                            nt_free_memory(current_process_handle, &enum_base_buffer, &zero_size, 0x8000);
-                            enum_base_buffer = nullptr;
-                            enum_alloc_size = 0;
-                        }
-                    }
-                }
+        {
+            PVOID base = nullptr;
+            SIZE_T sz = target_size;
+            NTSTATUS st2 = nt_allocate_virtual_memory(current_process, &base, 0, &sz, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+            if (!NT_SUCCESS(st2) || base == nullptr) {
+                proceed = false;
             }
+            else {
+                amd_target_mem = base;
+                // fill target with a recognizable non-zero pattern so we can detect CLZERO's effect (in case some obscure Intel CPU treat our instruction as a NOP)
+                memset(amd_target_mem, 0xA5, target_size);
 
-            if (!has_function) {
-                debug("NVRAM: NtEnumerateSystemEnvironmentValuesEx could not be resolved");
-                detection_result = false;
-                break;
-            }
-            if (!call_success) {
-                debug("NVRAM: System is not UEFI");
-                detection_result = false;
-                break;
+                const std::uintptr_t paddr = reinterpret_cast<std::uintptr_t>(amd_target_mem); // to avoid sign-extension, 32-bit compatible
+                const u64 addr = static_cast<u64>(paddr);
+                for (u8 i = 0; i < 8; ++i) {
+                    amd_bytes[2 + i] = static_cast<u8>((addr >> (i * 8)) & 0xFF);
+                }
+                bytes = amd_bytes;
+                codeSize = amd_stub_size;
             }
+        }
 
-            // ---------------------------------------------------------------------
-            // Constants & Data
-            // ---------------------------------------------------------------------
-            constexpr const char redhat_sig_ascii[] = "red hat";
-            constexpr const wchar_t redhat_sig_wide[] = L"red hat";
-
-            SIZE_T pk_default_len = 0;
-            SIZE_T pk_len = 0;
-            SIZE_T kek_default_len = 0;
-            SIZE_T kek_len = 0;
-
-            const GUID EFI_GLOBAL_VARIABLE = { 0x8BE4DF61, 0x93CA, 0x11D2, {0xAA,0x0D,0x00,0xE0,0x98,0x03,0x2B,0x8C} };
+        if (proceed) {
+            PVOID base = nullptr;
+            SIZE_T sz = codeSize;
+            NTSTATUS st2 = nt_allocate_virtual_memory(current_process, &base, 0, &sz, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+            if (NT_SUCCESS(st2) && base != nullptr) {
+                exec_mem = base;
+                memcpy(exec_mem, bytes, codeSize);
 
-            // Helper to read 1-byte UEFI variables like SecureBoot or SetupMode
-            auto read_uint8_var = [&](const std::wstring& name, const GUID& g, u8& out) noexcept -> bool {
-                if (!nt_query_value || !nt_allocate_memory || !nt_free_memory) return false;
-                UNICODE_STRING uni_str{};
-                uni_str.Buffer = const_cast<PWSTR>(name.c_str());
-                uni_str.Length = static_cast<USHORT>(name.length() * sizeof(wchar_t));
-                uni_str.MaximumLength = uni_str.Length + sizeof(wchar_t);
+                // change to RX
+                ULONG oldProt = 0;
+                PVOID tmp_base = exec_mem;
+                SIZE_T tmp_sz = codeSize;
+                st2 = nt_protect_virtual_memory(current_process, &tmp_base, &tmp_sz, PAGE_EXECUTE_READ, &oldProt);
+                if (NT_SUCCESS(st2)) {
+                    nt_flush_instruction_cache(current_process, exec_mem, codeSize);
 
-                ULONG required_size = 0;
-                NTSTATUS status = nt_query_value(&uni_str, const_cast<LPGUID>(&g), nullptr, &required_size, nullptr);
-                if (required_size == 0) return false;
+                    using code_func = void(*)();
+                    using runner_func = u8(*)(code_func);
+                    runner_func runner = +[](code_func func) -> u8 {
+                        __try {
+                            func();
+                            return 0;
+                        }
+                        __except (GetExceptionCode() == EXCEPTION_ILLEGAL_INSTRUCTION ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+                            return 1;
+                        }
+                    };
 
-                PVOID allocation_base = nullptr;
-                SIZE_T alloc_size = required_size;
-                if (alloc_size < 0x1000) alloc_size = 0x1000;
+                    const u8 runner_rc = runner(reinterpret_cast<code_func>(exec_mem));
 
-                status = nt_allocate_memory(current_process_handle, &allocation_base, 0, &alloc_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-                if (status != 0 || !allocation_base) { return false; }
+                    // check if the target buffer was written to zero by CLZERO
+                    bool memory_all_zero = false;
+                    if (amd_target_mem) {
+                        volatile u8* p = reinterpret_cast<volatile u8*>(amd_target_mem);
+                        memory_all_zero = true;
+                        for (SIZE_T i = 0; i < target_size; ++i) {
+                            if (p[i] != 0) { memory_all_zero = false; break; }
+                        }
+                    }
 
-                status = nt_query_value(&uni_str, const_cast<LPGUID>(&g), allocation_base, &required_size, nullptr);
-                if (status == 0 && required_size >= 1) {
-                    out = *reinterpret_cast<u8*>(allocation_base);
-                    SIZE_T z = 0;
-                    nt_free_memory(current_process_handle, &allocation_base, &z, 0x8000);
-                    return true;
+                    if (runner_rc == 0 && exception) {
+                        // only treat as spoofed if the CLZERO execution actually zeroed the target memory
+                        if (memory_all_zero) {
+                            debug("CPU_HEURISTIC: CPU reports being Intel, but VMAware detected a hypervisor running an AMD CPU in the host"); // or another CPU vendor
+                            spoofed = true;
+                        }
+                        else {
+                            debug("CPU_HEURISTIC: CLZERO returned without exception but target memory was NOT zeroed (NOP/emulated)");
+                        }
+                    }
+                    else if (runner_rc == 1 && !exception) {
+                        debug("CPU_HEURISTIC: CPU reports being AMD, but VMAware detected a hypervisor running an Intel CPU in the host"); // or another CPU vendor
+                        spoofed = true;
+                    }
+                    else if (runner_rc == 0 && !exception) {
+                        if (!memory_all_zero) {
+                            debug("CPU_HEURISTIC: CPU reports being AMD, CLZERO executed but did NOT zero the target memory");
+                            spoofed = true;
+                        }
+                    }
                 }
+            }
+        }
 
-                SIZE_T zero_s = 0;
-                nt_free_memory(current_process_handle, &allocation_base, &zero_s, 0x8000);
-                return false;
-            };
+        if (exec_mem) {
+            free_base = exec_mem; free_size = codeSize;
+            nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
+            exec_mem = nullptr;
+        }
+        if (amd_target_mem) {
+            free_base = amd_target_mem; free_size = target_size;
+            nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
+            amd_target_mem = nullptr;
+        }
 
-            bool have_secureboot = false;
-            u8 secureboot_val = 0;
-            if (read_uint8_var(L"SecureBoot", EFI_GLOBAL_VARIABLE, secureboot_val)) {
-                have_secureboot = true;
-                debug("NVRAM: SecureBoot variable detected");
-            }
+        if (spoofed) return spoofed;
 
-            bool have_setupmode = false;
-            u8 setupmode_val = 0;
-            if (read_uint8_var(L"SetupMode", EFI_GLOBAL_VARIABLE, setupmode_val)) {
-                have_setupmode = true;
-                debug("NVRAM: SetupMode variable detected");
-            }
+        // ok so if the CPU is intel, the motherboard should be intel aswell (and same with AMD)
+        // this doesnt happen in most public hardened configs out there so lets abuse it
+        static constexpr unsigned int VID_INTEL = 0x8086;
+        static constexpr unsigned int VID_AMD_ATI = 0x1002;
+        static constexpr unsigned int VID_AMD_MICRO = 0x1022;
 
-            // Determine whether it's safe to run Secure Boot dependent checks
-            const bool sb_active = (have_secureboot && (secureboot_val == 1) && have_setupmode && (setupmode_val == 0));
-            if (!sb_active) {
-                debug("NVRAM: Secure Boot not confirmed active, disabling MOCRL and raw buffer mismatch checks...");
-            }
+        enum class MBVendor { Unknown = 0, Intel = 1, AMD = 2 };
 
-            auto read_variable_to_buffer = [&](const std::wstring& name, GUID& guid, BYTE*& out_buf, SIZE_T& out_len) noexcept -> bool {
-                UNICODE_STRING uni_str{};
-                uni_str.Buffer = const_cast<PWSTR>(name.c_str());
-                uni_str.Length = static_cast<USHORT>(name.length() * sizeof(wchar_t));
-                uni_str.MaximumLength = uni_str.Length + sizeof(wchar_t);
+        auto detect_motherboard = []() noexcept -> MBVendor {
+            static constexpr const wchar_t* TOKENS[] = {
+                L"host bridge", L"northbridge", L"southbridge", L"pci bridge", L"chipset", L"pch", L"fch",
+                L"platform controller", L"lpc", L"sata controller", L"ahci", L"ide controller", L"usb controller",
+                L"xhci", L"usb3", L"usb 3.0", L"usb 3", L"pcie root", L"pci express", L" sata", nullptr
+            };
 
-                ULONG required_size = 0;
-                NTSTATUS status = nt_query_value(&uni_str, &guid, nullptr, &required_size, nullptr);
+            auto contains_token = [](const wchar_t* haystack) noexcept -> bool {
+                if (!haystack) return false;
+                for (const wchar_t* const* t = TOKENS; *t; ++t) {
+                    const wchar_t* needle = *t;
+                    const wchar_t* h = haystack;
 
-                if (required_size == 0) return false;
+                    // naive scan is faster than BM/KMP for very short needles/haystacks
+                    while (*h) {
+                        const wchar_t* h_iter = h;
+                        const wchar_t* n_iter = needle;
 
-                PVOID allocation_base = nullptr;
-                SIZE_T alloc_size = required_size;
-                if (alloc_size < 0x1000) alloc_size = 0x1000;
+                        while (*n_iter) {
+                            wchar_t hc = *h_iter;
+                            if (hc >= L'A' && hc <= L'Z') hc += 32;
 
-                status = nt_allocate_memory(current_process_handle, &allocation_base, 0, &alloc_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-                if (status != 0 || !allocation_base) { 
-                    out_buf = nullptr;
-                    out_len = 0; 
-                    return false; 
-                }
+                            if (hc != *n_iter) break;
+                            h_iter++;
+                            n_iter++;
+                        }
 
-                status = nt_query_value(&uni_str, &guid, allocation_base, &required_size, nullptr);
-                if (status == 0) {
-                    out_buf = reinterpret_cast<BYTE*>(allocation_base);
-                    out_len = required_size;
-                    return true;
+                        if (!*n_iter) return true; 
+                        h++;
+                    }
                 }
-
-                SIZE_T zero_s = 0;
-                nt_free_memory(current_process_handle, &allocation_base, &zero_s, 0x8000);
-                out_buf = nullptr;
-                out_len = 0;
                 return false;
             };
 
-            variable_name_ptr current_var = reinterpret_cast<variable_name_ptr>(enum_base_buffer);
-            const size_t buffer_total_size = static_cast<size_t>(buffer_required_length);
-            constexpr size_t MAX_NAME_BYTE_LIMIT = 4096;
-
-            bool should_break_loop = false;
-
-            // ---------------------------------------------------------------------
-            // Iteration Loop
-            // ---------------------------------------------------------------------
-            while (true) {
-                const uintptr_t base_address = reinterpret_cast<uintptr_t>(enum_base_buffer);
-                const uintptr_t current_address = reinterpret_cast<uintptr_t>(current_var);
-
-                if (current_address < base_address) break;
-
-                const size_t current_offset = static_cast<size_t>(current_address - base_address);
-                if (current_offset >= buffer_total_size) break;
+            auto find_vendor_hex = [](const wchar_t* wptr) noexcept -> u32 {
+                if (!wptr) return 0;
+                const wchar_t* p = wptr;
+                while (*p) {
+                    // Check for "VEN_" (case-insensitive)
+                    if (((p[0] | 0x20) == L'v') &&
+                        ((p[1] | 0x20) == L'e') &&
+                        ((p[2] | 0x20) == L'n') &&
+                        (p[3] == L'_')) {
 
-                const size_t name_struct_offset = offsetof(VARIABLE_NAME, Name);
-                if (buffer_total_size - current_offset < name_struct_offset) break;
+                        const wchar_t* q = p + 4;
+                        u32 val = 0;
+                        int got = 0;
+                        while (got < 4 && *q) {
+                            const wchar_t c = *q;
+                            u32 nib = 0;
+                            if (c >= L'0' && c <= L'9') 
+                                nib = static_cast<u32>(c - L'0');
+                            else if ((c | 0x20) >= L'a' && (c | 0x20) <= L'f') 
+                                nib = static_cast<u32>((c | 0x20) - L'a' + 10);
+                            else
+                                break;
 
-                size_t name_max_bytes = 0;
-                if (current_var->NextEntryOffset != 0) {
-                    const SIZE_T next_entry = static_cast<SIZE_T>(current_var->NextEntryOffset);
-                    if (next_entry <= name_struct_offset) { 
-                        detection_result = false; 
-                        should_break_loop = true; 
-                        break;
-                    }
-                    if (next_entry > buffer_total_size - current_offset) break;
-                    name_max_bytes = next_entry - name_struct_offset;
-                }
-                else {
-                    if (current_offset + name_struct_offset >= buffer_total_size) {
-                        detection_result = false; 
-                        should_break_loop = true;
-                        break; 
+                            val = (val << 4) | nib;
+                            ++got; ++q;
+                        }
+                        if (got == 4) return val;
                     }
-                    name_max_bytes = buffer_total_size - (current_offset + name_struct_offset);
+                    ++p;
                 }
+                return 0;
+            };
 
-                if (name_max_bytes > MAX_NAME_BYTE_LIMIT) name_max_bytes = MAX_NAME_BYTE_LIMIT;
+            // setupapi stuff
+            int intel_hits = 0;
+            int amd_hits = 0;
 
-                std::wstring var_name_view;
-                if (name_max_bytes >= sizeof(WCHAR)) {
-                    const WCHAR* name_ptr = reinterpret_cast<const WCHAR*>(reinterpret_cast<const BYTE*>(current_var) + name_struct_offset);
-                    const size_t max_chars = name_max_bytes / sizeof(WCHAR);
-                    size_t real_chars = 0;
-                    while (real_chars < max_chars && name_ptr[real_chars] != L'\0') 
-                        ++real_chars;
-                    if (real_chars == max_chars) { 
-                        detection_result = false; 
-                        should_break_loop = true;
-                        break; 
-                    }
-                    var_name_view = std::wstring(name_ptr, real_chars);
-                }
+            wchar_t stack_buf[1024]{};
+            std::vector<BYTE> heap_buf; // fallback for rare huge strings
 
-                // Presence checks
-                if (!var_name_view.empty() && var_name_view.rfind(L"VMM", 0) == 0) {
-                    debug("NVRAM: Detected hypervisor signature");
-                    detection_result = true;
-                    should_break_loop = true;
-                    break;
-                }
-                else if (var_name_view == L"KEKDefault") found_kek_default = true;
-                else if (var_name_view == L"PKDefault") found_pk_default = true;
-                else if (var_name_view == L"dbxDefault") found_dbx_default = true;
-                else if (var_name_view == L"MemoryOverwriteRequestControlLock") found_morcl = true;
+            auto scan_devices = [&](const GUID* classGuid, DWORD flags) noexcept {
+                HDEVINFO handle_dev_info = SetupDiGetClassDevsW(classGuid, nullptr, nullptr, flags);
+                if (handle_dev_info == INVALID_HANDLE_VALUE) return;
 
-                // Read specific variables (later checks that act on them will only be performed if Secure Boot was explicitly confirmed active)
-                if (var_name_view == L"PKDefault") (void)read_variable_to_buffer(std::wstring(var_name_view), current_var->VendorGuid, pk_default_buf, pk_default_len);
-                else if (var_name_view == L"PK") (void)read_variable_to_buffer(std::wstring(var_name_view), current_var->VendorGuid, pk_buf, pk_len);
-                else if (var_name_view == L"KEKDefault") (void)read_variable_to_buffer(std::wstring(var_name_view), current_var->VendorGuid, kek_default_buf, kek_default_len);
-                else if (var_name_view == L"KEK") (void)read_variable_to_buffer(std::wstring(var_name_view), current_var->VendorGuid, kek_buf, kek_len);
+                SP_DEVINFO_DATA dev_info_data{};
+                dev_info_data.cbSize = sizeof(SP_DEVINFO_DATA);
 
-                if (current_var->NextEntryOffset == 0) break;
-                const SIZE_T next_entry_off = static_cast<SIZE_T>(current_var->NextEntryOffset);
-                if (next_entry_off == 0) break;
-                const size_t next_var_offset = current_offset + next_entry_off;
-                if (next_var_offset <= current_offset || next_var_offset > buffer_total_size) break;
-                current_var = reinterpret_cast<variable_name_ptr>(reinterpret_cast<PBYTE>(enum_base_buffer) + next_var_offset);
-            }
+                for (DWORD i = 0; SetupDiEnumDeviceInfo(handle_dev_info, i, &dev_info_data); ++i) {
 
-            if (should_break_loop) break;
+                    const wchar_t* w_desc = nullptr;
+                    DWORD req_size = 0;
+                    DWORD prop_type = 0;
 
-            // free enumeration buffer
-            { 
-                SIZE_T z = 0; 
-                nt_free_memory(current_process_handle, &enum_base_buffer, &z, 0x8000); 
-                enum_base_buffer = nullptr; 
-                enum_alloc_size = 0; 
-            }
+                    if (SetupDiGetDeviceRegistryPropertyW(handle_dev_info, &dev_info_data, SPDRP_DEVICEDESC, &prop_type, reinterpret_cast<PBYTE>(stack_buf), sizeof(stack_buf), &req_size)) {
+                        w_desc = stack_buf;
+                    }
+                    else if (GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
+                        if (heap_buf.size() < req_size) heap_buf.resize(req_size);
+                        if (SetupDiGetDeviceRegistryPropertyW(handle_dev_info, &dev_info_data, SPDRP_DEVICEDESC, &prop_type, heap_buf.data(), req_size, nullptr)) {
+                            w_desc = reinterpret_cast<const wchar_t*>(heap_buf.data());
+                        }
+                    }
+
+                    // check if the description contains any interesting stuff
+                    if (w_desc && contains_token(w_desc)) {
+
+                        // if interesting get hwid to get vendor
+                        const wchar_t* w_hardware_id = nullptr;
 
-            // ---------------------------------------------------------------------
-            // EFI variable analysis
-            // ---------------------------------------------------------------------
-            if (sb_active) {
-                if (!found_morcl) {
-                    debug("NVRAM: Missing MemoryOverwriteRequestControlLock"); 
-                    detection_result = true;
-                    break;
-                }
-            }
-            if (!found_dbx_default) {
-                debug("NVRAM: Missing dbxDefault"); 
-                detection_result = true;
-                break;
-            }
-            if (!found_kek_default) {
-                debug("NVRAM: Missing KEKDefault"); 
-                detection_result = true;
-                break;
-            }
-            if (!found_pk_default) {
-                debug("NVRAM: Missing PKDefault"); 
-                detection_result = true;
-                break;
-            }
+                        if (SetupDiGetDeviceRegistryPropertyW(handle_dev_info, &dev_info_data, SPDRP_HARDWAREID, &prop_type, reinterpret_cast<PBYTE>(stack_buf), sizeof(stack_buf), &req_size)) {
+                            w_hardware_id = stack_buf;
+                        }
+                        else if (GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
+                            if (heap_buf.size() < req_size) heap_buf.resize(req_size);
+                            if (SetupDiGetDeviceRegistryPropertyW(handle_dev_info, &dev_info_data, SPDRP_HARDWAREID, &prop_type, heap_buf.data(), req_size, nullptr)) {
+                                w_hardware_id = reinterpret_cast<const wchar_t*>(heap_buf.data());
+                            }
+                        }
 
-            // check for official red hat certs (QEMU/OVMF)
-            bool found_redhat = false;
-            if (pk_default_buf && pk_default_len) {
-                if ((pk_default_len >= 2) && ((pk_default_len % 2) == 0)) {
-                    const WCHAR* wptr = reinterpret_cast<const WCHAR*>(pk_default_buf);
-                    const size_t wlen = pk_default_len / sizeof(WCHAR);
-                    if (buffer_contains_utf16le_ci(wptr, wlen, redhat_sig_wide))
-                        found_redhat = true;
+                        if (w_hardware_id) {
+                            const u32 vid = find_vendor_hex(w_hardware_id);
+                            if (vid == VID_INTEL) intel_hits++;
+                            else if (vid == VID_AMD_ATI || vid == VID_AMD_MICRO) amd_hits++;
+                        }
+                    }
                 }
-                if (!found_redhat)
-                    if (buffer_contains_ascii_ci(pk_default_buf, pk_default_len, redhat_sig_ascii))
-                        found_redhat = true;
-            }
-            if (found_redhat) {
-                debug("NVRAM: QEMU/OVMF detected");
-                detection_result = core::add(brand_enum::QEMU);
-                break;
-            }
+                SetupDiDestroyDeviceInfoList(handle_dev_info);
+            };
 
-            detection_result = false;
+            // GUID_DEVCLASS_SYSTEM covers Host Bridges, LPC, PCI bridges Chipset/CPU etc
+            // GUID_DEVCLASS_USB covers USB controller stuff
+            // GUID_DEVCLASS_HDC covers SATA/IDE
+            const GUID* interesting_classes[] = {
+                &GUID_DEVCLASS_SYSTEM,
+                &GUID_DEVCLASS_USB,
+                &GUID_DEVCLASS_HDC
+            };
 
-        } while (false);
+            for (const GUID* guid : interesting_classes) {
+                scan_devices(guid, DIGCF_PRESENT);
+            }
 
-        // cleanup
-        auto cleanup = [&](auto& ptr) {
-            if (ptr) {
-                PVOID base = ptr;
-                SIZE_T size = 0;
-                nt_free_memory(current_process_handle, &base, &size, 0x8000);
-                ptr = nullptr;
+            // if no stuff then mybe query all devices in the system?
+            if (intel_hits == 0 && amd_hits == 0) {
+                scan_devices(nullptr, DIGCF_ALLCLASSES | DIGCF_PRESENT);
             }
+
+            if (intel_hits > amd_hits) return MBVendor::Intel;
+            if (amd_hits > intel_hits) return MBVendor::AMD;
+            return MBVendor::Unknown;
         };
 
-        cleanup(pk_buf);
-        cleanup(kek_buf);
-        cleanup(pk_default_buf);
-        cleanup(kek_default_buf);
-        cleanup(enum_base_buffer);
+        const MBVendor vendor = detect_motherboard();
 
-        if (privileges_enabled && token_handle) {
-            TOKEN_PRIVILEGES tp_disable{};
-            tp_disable.PrivilegeCount = 1;
-            tp_disable.Privileges[0].Luid = luid_struct;
-            tp_disable.Privileges[0].Attributes = 0;
-            AdjustTokenPrivileges(token_handle, FALSE, &tp_disable, sizeof(TOKEN_PRIVILEGES), nullptr, nullptr);
-        }
-        if (token_handle) {
-            CloseHandle(token_handle);
-            token_handle = nullptr;
+        switch (vendor) {
+        case MBVendor::Intel:
+            if (claimed_amd && !claimed_intel) {
+                debug("CPU_HEURISTIC: CPU reports AMD but chipset looks Intel");
+                spoofed = true;
+            }
+            break;
+        case MBVendor::AMD:
+            if (claimed_intel && !claimed_amd) {
+                debug("CPU_HEURISTIC: CPU reports Intel but chipset looks AMD");
+                spoofed = true;
+            }
+            break;
+        case MBVendor::Unknown:
+            debug("CPU_HEURISTIC: Could not determine chipset vendor");
+            break;
         }
-
-        return detection_result;
+    #endif
+        return spoofed;
     }
 
 
     /**
-     * @brief Check for non-standard EDID configurations
-     * @category Windows
-     * @implements VM::EDID
+     * @brief Check the presence of system timers
+     * @category x86, Windows
+     * @implements VM::CLOCK
      */
-    [[nodiscard]] static bool edid() {
-        auto decode_manufacturer = [](const BYTE* edid, char out[4]) noexcept {
-            const u16 word = static_cast<u16>((edid[8] << 8) | edid[9]);
+    [[nodiscard]] static bool clock() {
+    #if (ARM)
+		return false; // ARM systems do not have the classic x86 timers
+    #endif
+		if (util::is_running_under_translator()) {
+            debug("CLOCK: Running inside an ARM CPU");
+            return false;
+        }
 
-            // 5 bits per character. 0x01='A', 0x1A='Z'
-            const u8 c1 = static_cast<u8>((word >> 10) & 0x1F);
-            const u8 c2 = static_cast<u8>((word >> 5) & 0x1F);
-            const u8 c3 = static_cast<u8>(word & 0x1F);
+        // Surface Pro models typically do not have PIT, some devices might have it but not expose it due to firmware bugs (i.e. Lenovo 83AG)
+        {
+            const char* manufacturer = nullptr;
+            const char* model = nullptr;
+            if (util::get_manufacturer_model(&manufacturer, &model)) {
+                auto ci_contains = [](const char* hay, const char* needle) noexcept -> bool {
+                    if (!hay || !needle || !*hay || !*needle) return false;
 
-            // '?' is fallback for valid EDID range 1-26
-            out[0] = (c1 >= 1 && c1 <= 26) ? static_cast<char>('A' + c1 - 1) : '?';
-            out[1] = (c2 >= 1 && c2 <= 26) ? static_cast<char>('A' + c2 - 1) : '?';
-            out[2] = (c3 >= 1 && c3 <= 26) ? static_cast<char>('A' + c3 - 1) : '?';
-            out[3] = '\0';
-        };
+                    const unsigned char* h =
+                        reinterpret_cast<const unsigned char*>(hay);
+                    const unsigned char* n =
+                        reinterpret_cast<const unsigned char*>(needle);
 
-        auto is_three_upper_alpha = [](const char m[4]) noexcept -> bool {
-            return (m[0] >= 'A' && m[0] <= 'Z') &&
-                (m[1] >= 'A' && m[1] <= 'Z') &&
-                (m[2] >= 'A' && m[2] <= 'Z');
-        };
+                    for (; *h; ++h) {
+                        size_t i = 0;
+                        for (;; ++i) {
+                            unsigned char hc = h[i];
+                            unsigned char nc = n[i];
 
-        auto edid_checksum_valid = [](const BYTE* edid, size_t len) noexcept -> bool {
-            if (len < 128) return false;
+                            if (!nc) return true; 
+                            if (!hc) break;
 
-            u8 sum = 0;
-            const BYTE* end = edid + 128;
+                            if (hc >= 'A' && hc <= 'Z') hc += 32;
+                            if (nc >= 'A' && nc <= 'Z') nc += 32;
 
-            while (edid < end) {
-                sum += *edid++;
+                            if (hc != nc) break;
+                        }
+                    }
+                    return false;
+                };
+
+                const bool model_has_surface = ci_contains(model, "surface");
+                const bool model_has_pro = ci_contains(model, "pro");
+                const bool man_is_microsoft = ci_contains(manufacturer, "microsoft");
+
+                if (model_has_surface && (model_has_pro || man_is_microsoft)) {
+                    return false;
+                }
             }
+        }
 
-            return sum == 0;
-        };
+        // The RTC (ACPI/CMOS RTC) timer can't be always detected via SetupAPI, it needs AML decode of the DSDT firmware table
+        // The HPET (PNP0103) timer presence check was removed, more info at: https://github.com/kernelwernel/VMAware/pull/616
+        // Here, we check for the PIT/AT timer (PC-class System Timer)
+        constexpr wchar_t pattern[] = L"pnp0100"; 
+        constexpr size_t patLen = (sizeof(pattern) / sizeof(wchar_t)) - 1;
 
-        auto extract_monitor_name = [](const BYTE* edid, size_t len, char out[32]) noexcept -> bool {
-            out[0] = '\0';
-            if (len < 128) return false;
+        auto wcsstr_ci_ascii = [&](const wchar_t* hay) noexcept -> const wchar_t* {
+            if (!hay) return nullptr;
 
-            // Standard EDID 1.3/1.4 Descriptor offsets
-            const BYTE* block = edid + 54;
-            const BYTE* end = edid + 126; // block area
+            for (; *hay; ++hay) {
+                wchar_t h = *hay;
+                if (h >= L'A' && h <= L'Z') h += 32;
 
-            const BYTE* best_block = nullptr;
+                if (h != pattern[0]) continue;
 
-            for (; block <= end - 18; block += 18) {
-                // bytes 0-2 must be 0 to indicate a Display Descriptor
-                if (block[0] != 0 || block[1] != 0 || block[2] != 0) continue;
+                size_t i = 1;
+                for (; i < patLen; ++i) {
+                    wchar_t next_h = hay[i];
 
-                const u8 tag = block[3];
+                    if (next_h == L'\0') return nullptr;
 
-                // 0xFC = Monitor Name
-                if (tag == 0xFC) {
-                    best_block = block;
-                    break;
+                    if (next_h >= L'A' && next_h <= L'Z') next_h += 32;
+
+                    if (next_h != pattern[i]) break;
+                }
+
+                if (i == patLen) return hay; 
+            }
+            return nullptr;
+        };
+
+        const HDEVINFO devs = SetupDiGetClassDevsW(nullptr, nullptr, nullptr, DIGCF_PRESENT | DIGCF_ALLCLASSES);
+        if (devs == INVALID_HANDLE_VALUE) return false;
+
+        SP_DEVINFO_DATA dev_info{};
+        dev_info.cbSize = sizeof(SP_DEVINFO_DATA);
+
+        DWORD buf_bytes = 4096;
+        BYTE* buffer = static_cast<BYTE*>(malloc(buf_bytes));
+        if (!buffer) {
+            SetupDiDestroyDeviceInfoList(devs);
+            return false;
+        }
+
+        bool found = false;
+        for (DWORD idx = 0; SetupDiEnumDeviceInfo(devs, idx, &dev_info); ++idx) {
+            DWORD property_type = 0;
+            if (!SetupDiGetDeviceRegistryPropertyW(devs, &dev_info, SPDRP_HARDWAREID,
+                &property_type, buffer, buf_bytes, nullptr))
+            {
+                const DWORD err = GetLastError();
+                if (err == ERROR_INSUFFICIENT_BUFFER) {
+                    DWORD required = 0;
+                    SetupDiGetDeviceRegistryPropertyW(devs, &dev_info, SPDRP_HARDWAREID,
+                        &property_type, nullptr, 0, &required);
+                    if (required > buf_bytes) {
+                        BYTE* new_buffer = static_cast<BYTE*>(realloc(buffer, required));
+                        if (!new_buffer) { 
+                            found = false; 
+                            break; 
+                        } 
+                        buffer = new_buffer;
+                        buf_bytes = required;
+                    }
+                    if (!SetupDiGetDeviceRegistryPropertyW(devs, &dev_info, SPDRP_HARDWAREID,
+                        &property_type, buffer, buf_bytes, nullptr)) {
+                        continue;
+                    }
                 }
-
-                // 0xFF = Monitor Serial (this is only a fallback)
-                if (tag == 0xFF && !best_block) {
-                    best_block = block;
+                else {
+                    continue;
                 }
             }
 
-            if (best_block) {
-                int outi = 0;
-                for (int j = 5; j < 18 && outi < 31; ++j) {
-                    const char c = static_cast<char>(best_block[j]);
-                    // Terminate on newline (0x0A) or carriage return (0x0D) or null
-                    if (c == 0x0A || c == 0x0D || c == '\0') break;
-                    out[outi++] = c;
-                }
+            if (property_type != REG_MULTI_SZ) continue;
 
-                // right-trim spaces
-                while (outi > 0 && (out[outi - 1] == ' ' || out[outi - 1] == '\t')) {
-                    --outi;
+            wchar_t* cur = reinterpret_cast<wchar_t*>(buffer);
+            while (*cur) {
+                if (wcsstr_ci_ascii(cur)) {
+                    found = true;
+                    break;
                 }
-
-                out[outi] = '\0';
-                return outi > 0;
+                cur += wcslen(cur) + 1;
             }
+            if (found) break;
+        }
 
-            return false;
-        };
-
-        // Helper lambda to retrieve device properties from the registry
-        auto get_device_property = [](HDEVINFO dev_info, SP_DEVINFO_DATA& dev_data, DWORD prop_id,
-            char* out_buf, DWORD out_buf_size) noexcept -> bool {
-                DWORD needed = 0;
-
-                // Try to get the property with the provided buffer
-                if (SetupDiGetDeviceRegistryPropertyA(dev_info, &dev_data, prop_id, nullptr,
-                    reinterpret_cast<PBYTE>(out_buf), out_buf_size, &needed)) {
-                    if (out_buf_size > 0) out_buf[out_buf_size - 1] = '\0';
-                    return true;
-                }
+		free(buffer);
+		SetupDiDestroyDeviceInfoList(devs);
+		
+		return !found;
+    }
 
-                const DWORD err = GetLastError();
 
-                // If the buffer was too small, allocate exactly what is needed and try again
-                // This ensures we don't fail just because a property string is unusually long
-                if (err == ERROR_INSUFFICIENT_BUFFER && needed > 0 && needed < 65536) {
+    /**
+     * @brief Check whether the hypervisor correctly handles MSR behavior
+     * @category Windows
+     * @implements VM::MSR
+     */
+    [[nodiscard]] static bool msr() {
+    #if (!x86)
+        return false;
+    #endif  
+        constexpr u32 random_msr = 0xDEADBEEFu;
 
-                    void* h = malloc(static_cast<size_t>(needed) + 1);
-                    if (!h) return false;
+        auto try_read = [](u32 msr_index) -> bool {
+        #if (MSVC)
+            unsigned __int64 value = 0;
+            __try {
+                value = __readmsr(static_cast<unsigned long>(msr_index));
+                (void)value;
+                return true;
+            }
+            __except (EXCEPTION_EXECUTE_HANDLER) {
+                return false;
+            }
+        #elif (GCC || CLANG)
+            static thread_local bool g_msr_faulted = false;
 
-                    if (SetupDiGetDeviceRegistryPropertyA(dev_info, &dev_data, prop_id, nullptr,
-                        reinterpret_cast<PBYTE>(h), needed, &needed)) {
+            auto veh_handler = [](PEXCEPTION_POINTERS info) -> LONG {
+                if (info->ExceptionRecord->ExceptionCode == EXCEPTION_PRIV_INSTRUCTION) {
+                    g_msr_faulted = true;
+                    // skip the 'rdmsr' instruction (2 bytes: 0F 32)
+                #if (x86_64)
+                    info->ContextRecord->Rip += 2;
+                #else
+                    info->ContextRecord->Eip += 2;
+                #endif
+                    return EXCEPTION_CONTINUE_EXECUTION;
+                }
+                return EXCEPTION_CONTINUE_SEARCH;
+            };
 
-                        const DWORD to_copy = (needed < out_buf_size - 1) ? needed : (out_buf_size - 1);
+            const PVOID handle = AddVectoredExceptionHandler(1, veh_handler);
 
-                        if (out_buf_size > 0) {
-                            memcpy(out_buf, h, to_copy);
-                            out_buf[to_copy] = '\0';
-                        }
+            u32 low, high;
+            asm volatile (
+                "rdmsr"
+                : "=a"(low), "=d"(high)
+                : "c"(msr_index)
+            );
 
-                        free(h);
-                        return true;
-                    }
-                    free(h);
-                }
+            RemoveVectoredExceptionHandler(handle);
 
-                if (out_buf_size > 0) out_buf[0] = '\0';
-                return false;
+            return !g_msr_faulted;
+        #endif
         };
 
-        // Initiate a query for all "Monitor" class devices present in the system.
-        // We target monitors because VMs often emulate generic displays (e.g., "Generic Non-PnP Monitor")
-        // or specific virtual hardware signatures in their EDID data.
-        const HDEVINFO dev_info = SetupDiGetClassDevs(&GUID_DEVCLASS_MONITOR, nullptr, nullptr, DIGCF_PRESENT);
-        if (dev_info == INVALID_HANDLE_VALUE) return false;
+        if (try_read(random_msr)) {
+            debug("MSR: Detected hypervisor not correctly handling #GP");
+            return true;
+        }
 
-        SP_DEVINFO_DATA dev_data{};
-        dev_data.cbSize = sizeof(dev_data);
+        return false;
+    }
 
-        const int threshold = 3;
 
-        // Iterate through every enumerated monitor to inspect its hardware details
-        for (DWORD index = 0; SetupDiEnumDeviceInfo(dev_info, index, &dev_data); ++index) {
-            // Open the "Hardware" registry key for the specific device instance
-            // This is where the driver stores low-level configuration, including the EDID
-            const HKEY handle_dev_key = SetupDiOpenDevRegKey(dev_info, &dev_data, DICS_FLAG_GLOBAL, 0, DIREG_DEV, KEY_READ);
-            if (handle_dev_key == INVALID_HANDLE_VALUE) {
-                dev_data = {};
-                dev_data.cbSize = sizeof(dev_data);
-                continue;
-            }
+    /**
+     * @brief Check whether KVM attempts to patch a mismatched hypercall instruction
+     * @link https://lists.nongnu.org/archive/html/qemu-devel/2025-07/msg05044.html
+     * @category Windows
+     * @implements VM::KVM_INTERCEPTION
+     */
+    [[nodiscard]] static bool kvm_interception() {
+    #if (!x86)
+        return false;
+    #endif
+        using nt_allocate_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG);
+        using nt_protect_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG, PULONG);
+        using nt_free_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG);
+        using nt_flush_instruction_cache_t = NTSTATUS(__stdcall*)(HANDLE, PVOID, SIZE_T);
+        using nt_close_t = NTSTATUS(__stdcall*)(HANDLE);
 
-            // Prepare to read the EDID (Extended Display Identification Data)
-            // EDID is a standard data structure containing the display's manufacturer ID, 
-            // serial number, and capabilities
-            BYTE edid_stack[256];
-            DWORD buffer_size = static_cast<DWORD>(sizeof(edid_stack));
-            const LONG rc = RegQueryValueExA(handle_dev_key, "EDID", nullptr, nullptr, edid_stack, &buffer_size);
-            RegCloseKey(handle_dev_key);
+        const HMODULE ntdll = util::get_ntdll();
+        if (!ntdll) return false;
 
-            BYTE* edid = nullptr;
-            bool used_heap = false;
-            BYTE* heap_buf = nullptr;
+        const char* names[] = { "NtAllocateVirtualMemory", "NtProtectVirtualMemory", "NtFreeVirtualMemory", "NtFlushInstructionCache", "NtClose" };
+        void* funcs[ARRAYSIZE(names)] = {};
+        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-            // standard EDID is 128 bytes so it should fit in stack
-            if (rc == ERROR_SUCCESS && buffer_size >= 128) {
-                edid = edid_stack;
-            }
-            // If for some reason the EDID contains extension blocks (making it larger than our stack buffer)
-            // allocate a heap buffer dynamically to capture the full data
-            else if (rc == ERROR_MORE_DATA) {
-                if (buffer_size > 0 && buffer_size < 65536) {
-                    heap_buf = static_cast<BYTE*>(LocalAlloc(LMEM_FIXED, buffer_size));
-                    if (heap_buf) {
-                        DWORD extra_buffer_size = buffer_size;
-                        // Re-open the key to read the full data into the new buffer
-                        const HKEY extra_dev_key = SetupDiOpenDevRegKey(dev_info, &dev_data, DICS_FLAG_GLOBAL, 0, DIREG_DEV, KEY_READ);
-                        if (extra_dev_key != INVALID_HANDLE_VALUE) {
-                            if (RegQueryValueExA(extra_dev_key, "EDID", nullptr, nullptr, heap_buf, &extra_buffer_size) == ERROR_SUCCESS && extra_buffer_size >= 128) {
-                                edid = heap_buf;
-                                used_heap = true;
-                                buffer_size = extra_buffer_size;
-                            }
-                            RegCloseKey(extra_dev_key);
-                        }
-                        if (!edid) {
-                            LocalFree(heap_buf);
-                            heap_buf = nullptr;
-                        }
-                    }
-                }
-            }
+        const auto nt_allocate_virtual_memory = reinterpret_cast<nt_allocate_virtual_memory_t>(funcs[0]);
+        const auto nt_protect_virtual_memory = reinterpret_cast<nt_protect_virtual_memory_t>(funcs[1]);
+        const auto nt_free_virtual_memory = reinterpret_cast<nt_free_virtual_memory_t>(funcs[2]);
+        const auto nt_flush_instruction_cache = reinterpret_cast<nt_flush_instruction_cache_t>(funcs[3]);
+        const auto nt_close = reinterpret_cast<nt_close_t>(funcs[4]);
 
-            if (!edid) {
-                dev_data = {};
-                dev_data.cbSize = sizeof(dev_data);
-                continue;
-            }
+        if (!nt_allocate_virtual_memory || !nt_protect_virtual_memory || !nt_free_virtual_memory || !nt_flush_instruction_cache || !nt_close)
+            return false;
 
-            // header check
-            if (!(edid[0] == 0x00 && edid[1] == 0xFF && edid[2] == 0xFF && edid[3] == 0xFF
-                && edid[4] == 0xFF && edid[5] == 0xFF && edid[6] == 0xFF && edid[7] == 0x00)) {
-                if (used_heap) LocalFree(heap_buf);
-                dev_data = {};
-                dev_data.cbSize = sizeof(dev_data);
-                continue;
-            }
+        // VMCALL (0F 01 C1) + RET (C3) and VMMCALL (0F 01 D9) + RET (C3)
+        constexpr BYTE opcodes[2][4] = {
+            { 0x0F, 0x01, 0xC1, 0xC3 },
+            { 0x0F, 0x01, 0xD9, 0xC3 }
+        };
 
-            const bool checksum_ok = edid_checksum_valid(edid, buffer_size);
+        const HANDLE current_process = reinterpret_cast<HANDLE>(-1);
+        bool is_kvm_detected = false; // KVM-specific behavior, detector is 100% sure is running under KVM
+        bool generic_hypervisor = false; // behavior present in KVM but other hypervisors might replicate it as well
 
-            char manu[4];
-            decode_manufacturer(edid, manu);
-            const bool manu_ok = is_three_upper_alpha(manu);
+        for (int i = 0; i < 2; ++i) {
+            PVOID base_address = nullptr;
+            SIZE_T region_size = 0x1000;
 
-            const u16 product = static_cast<u16>(edid[10] | (edid[11] << 8)); // because its little-endian
-            const u32 serial = static_cast<u32>(edid[12] | (edid[13] << 8) | (edid[14] << 16) | (edid[15] << 24));
+            // memory as RWX initially to write the opcode
+            NTSTATUS status = nt_allocate_virtual_memory(
+                current_process, &base_address, 0, &region_size,
+                MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
 
-            char monname[32];
-            const bool has_name = extract_monitor_name(edid, buffer_size, monname);
+            if (!NT_SUCCESS(status))
+                continue;
 
-            char prop_buf[512];
-            const bool have_friendly = get_device_property(dev_info, dev_data, SPDRP_FRIENDLYNAME, prop_buf, sizeof(prop_buf)); // friendly_name is often empty, like in Digital-Flachbildschirm monitors
-            const bool have_dev_desc = get_device_property(dev_info, dev_data, SPDRP_DEVICEDESC, prop_buf, sizeof(prop_buf));
+            // copy stuff to page
+            memcpy(base_address, opcodes[i], sizeof(opcodes[i]));
 
-            int score = 0;
+            ULONG old_protect = 0;
+            PVOID protect_address = base_address;
+            SIZE_T protect_size = region_size;
 
-            if (!checksum_ok) score += 1;
-            if (!manu_ok) score += 1;
+            // change memory protection to RX because it is what breaks KVM's instruction patching attempt
+            status = nt_protect_virtual_memory(
+                current_process, &protect_address, &protect_size,
+                PAGE_EXECUTE_READ, &old_protect);
 
-            if (product == 0 && serial == 0) {
-                score += 1;
-            }
-            else if (product == 0 || serial == 0) {
-                if (score > 0) score += 1;
+            if (NT_SUCCESS(status)) {
+                DWORD exception_status = 0;
+                __try {
+                    const auto execute_hypercall = reinterpret_cast<void(*)()>(base_address);
+                    execute_hypercall();
+                    generic_hypervisor = true; // if no exception occurs then a hypervisor handled it, this is default KVM behavior
+                    debug("KVM_INTERCEPTION: Detected a hypervisor intercepting hypercalls");
+                }
+                __except (exception_status = GetExceptionCode(), EXCEPTION_EXECUTE_HANDLER) {
+                    // if it's #PF instead of #UD then old KVM quirk is present
+                    if (exception_status == EXCEPTION_ACCESS_VIOLATION) {
+                        debug("KVM_INTERCEPTION: Detected KVM attempting to patch instructions on the fly");
+                        is_kvm_detected = true;
+                    }
+                }
             }
 
-            if (!has_name && score > 0) score += 1;
-
-            if (!have_friendly && !have_dev_desc) score += 1;
-
-            if (used_heap) LocalFree(heap_buf);
+            SIZE_T free_size = 0;
+            nt_free_virtual_memory(current_process, &base_address, &free_size, MEM_RELEASE);
 
-            if (score >= threshold) {
-                SetupDiDestroyDeviceInfoList(dev_info);
+            if (is_kvm_detected) {
+                return core::add(brand_enum::KVM);
+            }
+            else if (generic_hypervisor) {
                 return true;
             }
-
-            dev_data = {};
-            dev_data.cbSize = sizeof(dev_data);
         }
 
-        SetupDiDestroyDeviceInfoList(dev_info);
-        return false;
-    }
-
-
-    /**
-     * @brief Check whether the CPU is genuine and its reported instruction capabilities are not masked
-     * @category Windows
-     * @implements VM::CPU_HEURISTIC
-     */
-    [[nodiscard]] static bool cpu_heuristic() {
-        bool spoofed = false;
-    #if (x86)
-        if (util::is_running_under_translator()) {
-            debug("CPU_HEURISTIC: Running inside a binary translation layer");
+        // we will run amd only stuff
+        if (!cpu::is_amd()) {
             return false;
         }
 
-        // 1) Check for commonly disabled instructions on patches and VMs    
-        u32 a = 0, b = 0, c = 0, d = 0;
-        cpu::cpuid(a, b, c, d, 1u);
-
-        constexpr u32 AES_NI_BIT = 1u << 25;
-        const bool aes_support = (c & AES_NI_BIT) != 0;
-
-        alignas(16) unsigned char plaintext[16] = {
-            0x00,0x11,0x22,0x33, 0x44,0x55,0x66,0x77,
-            0x88,0x99,0xAA,0xBB, 0xCC,0xDD,0xEE,0xFF
-        };
-        alignas(16) unsigned char key[16] = {
-            0x0F,0x0E,0x0D,0x0C, 0x0B,0x0A,0x09,0x08,
-            0x07,0x06,0x05,0x04, 0x03,0x02,0x01,0x00
+        struct state {
+            volatile int in_asm;
+            volatile int exception_seen;
         };
-        alignas(16) unsigned char out[16] = { 0 };
 
-        // need to do a lambda wrapper to isolate SEH from the parent function's stack unwinding
-        // target aes is required for clang/gcc while in MSVC not, and this target can only be applied to functions, meaning we need a struct
-        struct aes_executor {
-            #if (CLANG || GCC)
-                __attribute__((__target__("aes")))
-            #endif
-            static bool check_aes_integrity(const unsigned char* pt, const unsigned char* k, unsigned char* o, bool support) {
-                __try {
-                    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pt));
-                    __m128i key_vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(k));
+        static thread_local state* tls_state = nullptr;
 
-                    __m128i tmp = _mm_xor_si128(block, key_vec);
-                    tmp = _mm_aesenc_si128(tmp, key_vec);
+        state state{};
+        tls_state = &state;
 
-                    _mm_storeu_si128(reinterpret_cast<__m128i*>(o), tmp);
+        // lambda to capture exceptions
+        const PVOID vh = AddVectoredExceptionHandler(
+            1,
+            [](PEXCEPTION_POINTERS ep) -> LONG {
+                if (!tls_state || !tls_state->in_asm)
+                    return EXCEPTION_CONTINUE_SEARCH;
 
-                    if (!support) {
-                        debug("CPU_HEURISTIC: Hypervisor detected hiding AES capabilities");
-                        return true;
-                    }
-                }
-                __except (GetExceptionCode() == EXCEPTION_ILLEGAL_INSTRUCTION
-                    ? EXCEPTION_EXECUTE_HANDLER
-                    : EXCEPTION_CONTINUE_SEARCH
-                ) {
-                    if (support) {
-                        debug("CPU_HEURISTIC: Hypervisor reports AES, but it is not handled correctly");
-                        return true;
-                    }
+                const DWORD code = ep->ExceptionRecord->ExceptionCode;
+                if (code == EXCEPTION_ILLEGAL_INSTRUCTION) {
+                    tls_state->exception_seen = 1;
+                #if (x86_64)
+                    ep->ContextRecord->Rip += 3;
+                #else
+                    ep->ContextRecord->Eip += 3;
+                #endif
+                    return EXCEPTION_CONTINUE_EXECUTION;
                 }
-                return false;
+                return EXCEPTION_CONTINUE_SEARCH;
             }
-        };
+        );
+        if (!vh) return false;
 
-        if (aes_executor::check_aes_integrity(plaintext, key, out, aes_support)) return true;
+        // xor rdpru ret
+        constexpr unsigned char code[] = {
+            0x31, 0xC9,
+            0x0F, 0x01, 0xFD,
+            0xC3
+        };
 
-        const bool avx_support = ((c >> 28) & 1u) != 0;
-        const bool xsave_support = ((c >> 26) & 1u) != 0;
+        PVOID mem = nullptr;
+        SIZE_T size = sizeof(code);
 
-        if (avx_support && !xsave_support) {
-            debug("CPU_HEURISTIC: YMM state not correct for a baremetal machine");
-            return true;
+        if (nt_allocate_virtual_memory(
+            current_process,
+            &mem,
+            0,
+            &size,
+            MEM_COMMIT | MEM_RESERVE,
+            PAGE_EXECUTE_READWRITE) != 0 || !mem)
+        {
+            RemoveVectoredExceptionHandler(vh);
+            return false;
         }
 
-        const bool rdrand_support = ((c >> 30) & 1u) != 0;
-
-        auto check_rdrand_integrity = [&]() -> bool {
-            __try {
-                unsigned int v = 0;
-            #if (MSVC && !CLANG)
-                if (_rdrand32_step(&v) && !rdrand_support) {
-                    debug("CPU_HEURISTIC: Hypervisor detected hiding RDRAND capabilities");
-                    return true;
-                }
-            #else 
-                unsigned char ok = 0;
-                asm volatile("rdrand %0\n\tsetc %1" : "=r"(v), "=qm"(ok) : : "cc");
-                if (ok && !rdrand_support) {
-                    debug("CPU_HEURISTIC: Hypervisor detected hiding RDRAND capabilities");
-                    return true;
-                }
-            #endif      
-            }
-            __except (GetExceptionCode() == EXCEPTION_ILLEGAL_INSTRUCTION
-                ? EXCEPTION_EXECUTE_HANDLER
-                : EXCEPTION_CONTINUE_SEARCH) {
-                if (rdrand_support) {
-                    debug("CPU_HEURISTIC: Hypervisor reports RDRAND, but it is not handled correctly");
-                    return true;
-                }
-            }
-            return false;
-        };
+        memcpy(mem, code, sizeof(code));
 
-        if (check_rdrand_integrity()) return true;
+        nt_flush_instruction_cache(current_process, mem, sizeof(code));
 
-        // 2. Test if the CPU vendor is spoofed (for example, a CPU reports being AMD in CPUID, but it is Intel)
-        /*
-            For this task, we want a instruction that:
-            1. It is vendor-only, meaning that other CPU vendors never implemented the same instruction on their microcode
-                -> Note: Even if an instruction is vendor-only, it may be treated as a NOP by other CPU vendors, we don't want this
-            2. Is compatible enough, meaning both old and new CPUs of this vendor have it
-            3. Is enabled by default, without needing BIOS/OS changes
-            4. Never switches to kernel-mode, so that is harder to intercept
-            5. Is not deprecated today
-            6. Its side-effects can be measured from CPL3 (user-mode)
+        using fn_t = void(*)();
+        fn_t fn = reinterpret_cast<fn_t>(mem);
 
-            On Intel, most options are unreliable:
-            SGX are deprecated and disabled by default, MPX is deprecated and treated as NOP even in AMD CPUs, AVX-512 is not found in all processors (and AMD integrated part of this set), etc
-            On AMD, 3dNow! could be an option, but since its being deprecated, CLZERO fits this criteria better
+        state.exception_seen = 0;
+        state.in_asm = 1;
 
-            So for example, if the CPU reports being Intel, and succesfully runs CLZERO without a NOP, then it's not an Intel CPU.
-        */
+        __try {
+            fn();
+        }
+        __except (EXCEPTION_EXECUTE_HANDLER) {
+            state.exception_seen = 1;
+        }
 
-        // AMD stub template (mov rax, imm64 + clzero + ret)
-        // 8-byte immediate at runtime at offsets [2..9]
-        u8 amd_bytes[] = {
-            0x48, 0xB8,                 // mov rax, imm64
-            0x00, 0x00, 0x00, 0x00,     // imm64 low bytes (placeholder)
-            0x00, 0x00, 0x00, 0x00,     // imm64 high bytes (placeholder)
-            0x0F, 0x01, 0xFC,           // clzero
-            0xC3                        // ret
-        };
-        constexpr SIZE_T amd_stub_size = sizeof(amd_bytes); // 14
+        state.in_asm = 0;
 
-        const u8* bytes = nullptr;
-        SIZE_T codeSize = 0;
+        if (state.exception_seen) {
+            debug("KVM_INTERCEPTION: Detected a hypervisor intercepting performance counter reads");
+            generic_hypervisor = true;
+        }
 
-        LPVOID amd_target_mem = nullptr;
-        LPVOID exec_mem = nullptr;
-        PVOID free_base = nullptr;
         SIZE_T free_size = 0;
+        nt_free_virtual_memory(
+            current_process,
+            &mem,
+            &free_size,
+            MEM_RELEASE
+        );
 
-        const bool claimed_amd = cpu::is_amd();
-        const bool claimed_intel = cpu::is_intel();
-
-        if (!claimed_amd && !claimed_intel) {
-            debug("CPU_HEURISTIC: x86 CPU vendor was not recognized as either Intel or AMD");
-            return false; // Zhaoxin? VIA/Centaur?
-        }
+        nt_close(current_process);
 
-        bool proceed = true;
-        bool exception = false;
+        RemoveVectoredExceptionHandler(vh);
 
-        // A case where this check could false flag is when analyzing the AMD PRO A8-9600B CPU
-        // is based on the "Bristol Ridge" platform, which uses the Excavator microarchitecture (the 4th and final generation of the Bulldozer family)
-        // Excavator CPUs do not possess the CLZERO instruction
-        if (claimed_amd) {
-            cpu::model_struct model = cpu::get_model();
-            if (!model.is_ryzen) {
-                debug("CPU_HEURISTIC: CPU is AMD but not Ryzen (Pre-Zen). Skipping CLZERO check");
-                proceed = false;
-            }
+        // KVM does this, but other hypervisors might do the same, reason why is generic
+        // kernel might configure CR4 to inject exception if CPL > 0, so if this case is detected, trigger a lower probability score 
+        if (generic_hypervisor) {
+            return core::add(brand_enum::NULL_BRAND, 50); 
         }
 
-        if (claimed_intel || !claimed_amd) exception = true; // should generate an exception rather than be treated as a NOP, but we will check its side effects anyways
+        return false;
+    }
 
-        // one cache line = 64 bytes
-        const SIZE_T target_size = 64;
 
+    /**
+     * @brief Check whether a hypervisor uses EPT/NPT hooking to intercept hardware breakpoints
+     * @category Windows
+     * @implements VM::BREAKPOINT
+     */
+    [[nodiscard]] static bool breakpoint() {
         const HMODULE ntdll = util::get_ntdll();
         if (!ntdll) return false;
 
-        const char* names[] = { "NtAllocateVirtualMemory", "NtProtectVirtualMemory", "NtFlushInstructionCache", "NtFreeVirtualMemory" };
+        const char* names[] = {
+            "NtAllocateVirtualMemory",
+            "NtFreeVirtualMemory",
+            "NtGetContextThread",
+            "NtSetContextThread",
+            "RtlAddVectoredExceptionHandler",
+            "RtlRemoveVectoredExceptionHandler"
+        };
         void* funcs[ARRAYSIZE(names)] = {};
         util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
 
-        using NtAllocateVirtualMemory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG);
-        using NtProtectVirtualMemory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG, PULONG);
-        using NtFreeVirtualMemory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG);
-        using NtFlushInstructionCache_t = NTSTATUS(__stdcall*)(HANDLE, PVOID, SIZE_T);
-        const auto nt_allocate_virtual_memory = reinterpret_cast<NtAllocateVirtualMemory_t>(funcs[0]);
-        const auto nt_protect_virtual_memory = reinterpret_cast<NtProtectVirtualMemory_t>(funcs[1]);
-        const auto nt_flush_instruction_cache = reinterpret_cast<NtFlushInstructionCache_t>(funcs[2]);
-        const auto nt_free_virtual_memory = reinterpret_cast<NtFreeVirtualMemory_t>(funcs[3]);
+        using nt_allocate_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG);
+        using nt_free_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG);
+        using net_get_context_thread_t = NTSTATUS(__stdcall*)(HANDLE, PCONTEXT);
+        using nt_set_context_thread_t = NTSTATUS(__stdcall*)(HANDLE, PCONTEXT);
+        using rtl_add_vectored_exception_handler_t = PVOID(__stdcall*)(ULONG, PVECTORED_EXCEPTION_HANDLER);
+        using rtl_remove_vectored_exception_handler_t = ULONG(__stdcall*)(PVOID);
 
-        if (!nt_allocate_virtual_memory || !nt_protect_virtual_memory || !nt_flush_instruction_cache || !nt_free_virtual_memory) {
+        // volatile ensures these are loaded from stack after SEH unwind when compiled with aggressive optimizations
+        nt_allocate_virtual_memory_t volatile nt_allocate_virtual_memory = reinterpret_cast<nt_allocate_virtual_memory_t>(funcs[0]);
+        nt_free_virtual_memory_t volatile nt_free_virtual_memory = reinterpret_cast<nt_free_virtual_memory_t>(funcs[1]);
+        net_get_context_thread_t volatile nt_get_context_thread = reinterpret_cast<net_get_context_thread_t>(funcs[2]);
+        nt_set_context_thread_t volatile nt_set_context_thread = reinterpret_cast<nt_set_context_thread_t>(funcs[3]);
+        rtl_add_vectored_exception_handler_t volatile rtl_add_vectored_exception_handler = reinterpret_cast<rtl_add_vectored_exception_handler_t>(funcs[4]);
+        rtl_remove_vectored_exception_handler_t volatile rtl_remove_vectored_exception_handler = reinterpret_cast<rtl_remove_vectored_exception_handler_t>(funcs[5]);
+
+        if (!nt_allocate_virtual_memory || !nt_free_virtual_memory || !nt_get_context_thread ||
+            !nt_set_context_thread || !rtl_add_vectored_exception_handler || !rtl_remove_vectored_exception_handler) {
             return false;
         }
 
-        const HANDLE current_process = reinterpret_cast<HANDLE>(-1LL);
+        HANDLE current_process = reinterpret_cast<HANDLE>(-1);
+        HANDLE current_thread = reinterpret_cast<HANDLE>(-2);
 
-        {
-            PVOID base = nullptr;
-            SIZE_T sz = target_size;
-            NTSTATUS st2 = nt_allocate_virtual_memory(current_process, &base, 0, &sz, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-            if (!NT_SUCCESS(st2) || base == nullptr) {
-                proceed = false;
-            }
-            else {
-                amd_target_mem = base;
-                // fill target with a recognizable non-zero pattern so we can detect CLZERO's effect (in case some obscure Intel CPU treat our instruction as a NOP)
-                memset(amd_target_mem, 0xA5, target_size);
+        PVOID src_page = nullptr;
+        PVOID dst_page = nullptr;
+        SIZE_T region_size = 0x2000;
 
-                const std::uintptr_t paddr = reinterpret_cast<std::uintptr_t>(amd_target_mem); // to avoid sign-extension, 32-bit compatible
-                const u64 addr = static_cast<u64>(paddr);
-                for (u8 i = 0; i < 8; ++i) {
-                    amd_bytes[2 + i] = static_cast<u8>((addr >> (i * 8)) & 0xFF);
-                }
-                bytes = amd_bytes;
-                codeSize = amd_stub_size;
-            }
+        // allocate source and destination pages
+        const NTSTATUS status_src = nt_allocate_virtual_memory(current_process, &src_page, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        const NTSTATUS status_dst = nt_allocate_virtual_memory(current_process, &dst_page, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+        if (status_src < 0 || status_dst < 0) {
+            if (src_page) { SIZE_T free_size = 0; nt_free_virtual_memory(current_process, &src_page, &free_size, MEM_RELEASE); }
+            if (dst_page) { SIZE_T free_size = 0; nt_free_virtual_memory(current_process, &dst_page, &free_size, MEM_RELEASE); }
+            return false;
         }
 
-        if (proceed) {
-            PVOID base = nullptr;
-            SIZE_T sz = codeSize;
-            NTSTATUS st2 = nt_allocate_virtual_memory(current_process, &base, 0, &sz, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-            if (NT_SUCCESS(st2) && base != nullptr) {
-                exec_mem = base;
-                memcpy(exec_mem, bytes, codeSize);
+        // initialize src memory
+        __stosb(static_cast<PBYTE>(src_page), 0xAB, 0x2000);
 
-                // change to RX
-                ULONG oldProt = 0;
-                PVOID tmp_base = exec_mem;
-                SIZE_T tmp_sz = codeSize;
-                st2 = nt_protect_virtual_memory(current_process, &tmp_base, &tmp_sz, PAGE_EXECUTE_READ, &oldProt);
-                if (NT_SUCCESS(st2)) {
-                    nt_flush_instruction_cache(current_process, exec_mem, codeSize);
+        thread_local static volatile bool ermsb_trap_detected = false;
+        ermsb_trap_detected = false;
 
-                    using code_func = void(*)();
-                    using runner_func = u8(*)(code_func);
-                    runner_func runner = +[](code_func func) -> u8 {
-                        __try {
-                            func();
-                            return 0;
-                        }
-                        __except (GetExceptionCode() == EXCEPTION_ILLEGAL_INSTRUCTION ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
-                            return 1;
-                        }
-                    };
+        // capture-less local lambda decays to PVECTORED_EXCEPTION_HANDLER function pointer
+        auto veh_handler = [](PEXCEPTION_POINTERS ctx) -> LONG {
+            if (ctx->ExceptionRecord->ExceptionCode == EXCEPTION_SINGLE_STEP) {
+                ermsb_trap_detected = true;
+                return EXCEPTION_CONTINUE_EXECUTION;
+            }
+            return EXCEPTION_CONTINUE_SEARCH;
+        };
 
-                    const u8 runner_rc = runner(reinterpret_cast<code_func>(exec_mem));
+        const PVOID veh_handle = rtl_add_vectored_exception_handler(1, static_cast<PVECTORED_EXCEPTION_HANDLER>(veh_handler));
+        if (!veh_handle) {
+            SIZE_T free_size = 0;
+            nt_free_virtual_memory(current_process, &src_page, &free_size, MEM_RELEASE);
+            nt_free_virtual_memory(current_process, &dst_page, &free_size, MEM_RELEASE);
+            return false;
+        }
 
-                    // check if the target buffer was written to zero by CLZERO
-                    bool memory_all_zero = false;
-                    if (amd_target_mem) {
-                        volatile u8* p = reinterpret_cast<volatile u8*>(amd_target_mem);
-                        memory_all_zero = true;
-                        for (SIZE_T i = 0; i < target_size; ++i) {
-                            if (p[i] != 0) { memory_all_zero = false; break; }
-                        }
-                    }
+        CONTEXT ctx = { 0 };
+        ctx.ContextFlags = CONTEXT_DEBUG_REGISTERS;
+        nt_get_context_thread(current_thread, &ctx);
 
-                    if (runner_rc == 0 && exception) {
-                        // only treat as spoofed if the CLZERO execution actually zeroed the target memory
-                        if (memory_all_zero) {
-                            debug("CPU_HEURISTIC: CPU reports being Intel, but VMAware detected a hypervisor running an AMD CPU in the host"); // or another CPU vendor
-                            spoofed = true;
-                        }
-                        else {
-                            debug("CPU_HEURISTIC: CLZERO returned without exception but target memory was NOT zeroed (NOP/emulated)");
-                        }
-                    }
-                    else if (runner_rc == 1 && !exception) {
-                        debug("CPU_HEURISTIC: CPU reports being AMD, but VMAware detected a hypervisor running an Intel CPU in the host"); // or another CPU vendor
-                        spoofed = true;
-                    }
-                    else if (runner_rc == 0 && !exception) {
-                        if (!memory_all_zero) {
-                            debug("CPU_HEURISTIC: CPU reports being AMD, CLZERO executed but did NOT zero the target memory");
-                            spoofed = true;
-                        }
-                    }
-                }
-            }
-        }
+        // set hw breakpoint inside the source page
+        ctx.Dr0 = reinterpret_cast<DWORD64>(src_page) + 0x1000;
 
-        if (exec_mem) {
-            free_base = exec_mem; free_size = codeSize;
-            nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
-            exec_mem = nullptr;
+        // Dr7 = 0x30001
+        // bit 0      = 1
+        // bits 17:16 = 11b
+        // bits 19:18 = 00b
+        ctx.Dr7 = 0x30001;
+        nt_set_context_thread(current_thread, &ctx);
+
+        __try {
+            __movsb(static_cast<PBYTE>(dst_page), static_cast<PBYTE>(src_page), 0x2000);
         }
-        if (amd_target_mem) {
-            free_base = amd_target_mem; free_size = target_size;
-            nt_free_virtual_memory(current_process, &free_base, &free_size, MEM_RELEASE);
-            amd_target_mem = nullptr;
+        __except (EXCEPTION_EXECUTE_HANDLER) {
+            // veh will already detect if Dr0 fired successfully
         }
 
-        if (spoofed) return spoofed;
+        // Cleanup
+        rtl_remove_vectored_exception_handler(veh_handle);
 
-        // ok so if the CPU is intel, the motherboard should be intel aswell (and same with AMD)
-        // this doesnt happen in most public hardened configs out there so lets abuse it
-        static constexpr unsigned int VID_INTEL = 0x8086;
-        static constexpr unsigned int VID_AMD_ATI = 0x1002;
-        static constexpr unsigned int VID_AMD_MICRO = 0x1022;
+        ctx.Dr0 = 0;
+        ctx.Dr7 = 0;
+        nt_set_context_thread(current_thread, &ctx);
 
-        enum class MBVendor { Unknown = 0, Intel = 1, AMD = 2 };
+        SIZE_T free_size = 0;
+        nt_free_virtual_memory(current_process, &src_page, &free_size, MEM_RELEASE);
+        nt_free_virtual_memory(current_process, &dst_page, &free_size, MEM_RELEASE);
 
-        auto detect_motherboard = []() noexcept -> MBVendor {
-            static constexpr const wchar_t* TOKENS[] = {
-                L"host bridge", L"northbridge", L"southbridge", L"pci bridge", L"chipset", L"pch", L"fch",
-                L"platform controller", L"lpc", L"sata controller", L"ahci", L"ide controller", L"usb controller",
-                L"xhci", L"usb3", L"usb 3.0", L"usb 3", L"pcie root", L"pci express", L" sata", nullptr
-            };
+        return !ermsb_trap_detected;
+    }
+    // ADD NEW TECHNIQUE FUNCTION HERE
+#endif
+ 
+
+    /* ============================================================================================== *
+     *                                                                                                *                                                                                               *
+     *                                        CORE SECTION                                            *
+     *                                                                                                *
+     * ============================================================================================== */
+public:
+    struct core {
+        struct technique {
+            u8 points;                    // this is the certainty score between 0 and 100
+            bool(*run)();                 // this is the technique function itself
+        };
+
+        struct custom_technique {
+            u8 points;
+            u16 id;
+            bool(*run)();
+        };
+
+        // entry for the initialization list
+        struct technique_entry {
+            enum_flags id;
+            technique tech;
+        };
+
+        // entry for brand scoreboard
+        struct brand_entry {
+            brand_enum name;
+            brand_score_t score;
+        };
+
+        // the 0~100 points are debatable, but we think it's fine how it is. Feel free to disagree
+        // FORMAT: { VM::<ID>, { certainty%, function pointer } },
+        static constexpr technique_entry technique_list[] = {
+            // START OF TECHNIQUE TABLE
+            #if (WINDOWS)
+                {VM::TRAP, {100, VM::trap}},
+                {VM::NVRAM, {100, VM::nvram}},
+                {VM::HYPERVISOR_QUERY, {100, VM::hypervisor_query}},
+                {VM::ACPI_SIGNATURE, {100, VM::acpi_signature}},
+                {VM::CPU_HEURISTIC, {90, VM::cpu_heuristic}},
+                {VM::CLOCK, {45, VM::clock}},
+                {VM::POWER_CAPABILITIES, {45, VM::power_capabilities}},
+                {VM::GPU_CAPABILITIES, {45, VM::gpu_capabilities}},
+                {VM::KVM_INTERCEPTION, {100, VM::kvm_interception}},
+                {VM::MSR, {100, VM::msr}},
+                {VM::BOOT_LOGO, {100, VM::boot_logo}},
+                {VM::EDID, {100, VM::edid}},
+                {VM::BREAKPOINT, {100, VM::breakpoint}},
+                {VM::VIRTUAL_PROCESSORS, {100, VM::virtual_processors}},
+                {VM::WINE, {100, VM::wine}},
+                {VM::DBVM_HYPERCALL, {150, VM::dbvm_hypercall}},
+                {VM::IVSHMEM, {100, VM::ivshmem}},
+                {VM::DISK_SERIAL, {100, VM::disk_serial_number}},
+                {VM::DRIVERS, {100, VM::drivers}},
+                {VM::HANDLES, {100, VM::device_handles}},
+                {VM::KERNEL_OBJECTS, {100, VM::kernel_objects}},
+                {VM::AUDIO, {25, VM::audio}},
+                {VM::DISPLAY, {25, VM::display}},
+                {VM::DLL, {50, VM::dll}},
+                {VM::UD, {100, VM::ud}},
+                {VM::BLOCKSTEP, {100, VM::blockstep}},
+                {VM::VMWARE_BACKDOOR, {100, VM::vmware_backdoor}},
+                {VM::VIRTUAL_REGISTRY, {90, VM::virtual_registry}},
+                {VM::MUTEX, {100, VM::mutex}},
+                {VM::DEVICE_STRING, {25, VM::device_string}},
+                {VM::VPC_INVALID, {75, VM::vpc_invalid}},
+                {VM::VMWARE_STR, {35, VM::vmware_str}},
+                {VM::GAMARUE, {10, VM::gamarue}},
+                {VM::CUCKOO_DIR, {30, VM::cuckoo_dir}},
+                {VM::CUCKOO_PIPE, {30, VM::cuckoo_pipe}},
+            #endif
+
+            #if (LINUX || WINDOWS)
+                {VM::FIRMWARE, {100, VM::firmware}},
+                {VM::DEVICES, {95, VM::pci_devices}},
+                {VM::SYSTEM_REGISTERS, {50, VM::system_registers}},
+                {VM::AZURE, {30, VM::azure}},
+            #endif
+
+            #if (LINUX)
+                {VM::SMBIOS_VM_BIT, {50, VM::smbios_vm_bit}},
+                {VM::KMSG, {5, VM::kmsg}},
+                {VM::CVENDOR, {65, VM::chassis_vendor}},
+                {VM::QEMU_FW_CFG, {70, VM::qemu_fw_cfg}},
+                {VM::SYSTEMD, {35, VM::systemd_virt}},
+                {VM::CTYPE, {20, VM::chassis_type}},
+                {VM::DOCKERENV, {30, VM::dockerenv}},
+                {VM::DMIDECODE, {55, VM::dmidecode}},
+                {VM::DMESG, {55, VM::dmesg}},
+                {VM::HWMON, {35, VM::hwmon}},
+                {VM::LINUX_USER_HOST, {10, VM::linux_user_host}},
+                {VM::VMWARE_IOMEM, {65, VM::vmware_iomem}},
+                {VM::VMWARE_IOPORTS, {70, VM::vmware_ioports}},
+                {VM::VMWARE_SCSI, {40, VM::vmware_scsi}},
+                {VM::VMWARE_DMESG, {65, VM::vmware_dmesg}},
+                {VM::QEMU_VIRTUAL_DMI, {40, VM::qemu_virtual_dmi}},
+                {VM::QEMU_USB, {20, VM::qemu_USB}},
+                {VM::HYPERVISOR_DIR, {20, VM::hypervisor_dir}},
+                {VM::UML_CPU, {80, VM::uml_cpu}},
+                {VM::VBOX_MODULE, {15, VM::vbox_module}},
+                {VM::SYSINFO_PROC, {15, VM::sysinfo_proc}},
+                {VM::DMI_SCAN, {50, VM::dmi_scan}},
+                {VM::PODMAN_FILE, {5, VM::podman_file}},
+                {VM::WSL_PROC, {30, VM::wsl_proc_subdir}},
+                {VM::FILE_ACCESS_HISTORY, {15, VM::file_access_history}},
+                {VM::MAC, {20, VM::mac_address_check}},
+                {VM::NSJAIL_PID, {75, VM::nsjail_proc_id}},
+                {VM::BLUESTACKS_FOLDERS, {5, VM::bluestacks}},
+                {VM::AMD_SEV_MSR, {50, VM::amd_sev_msr}},
+                {VM::TEMPERATURE, {20, VM::temperature}},
+                {VM::PROCESSES, {40, VM::processes}},
+            #endif    
+
+            #if (LINUX || APPLE)
+                {VM::THREAD_COUNT, {35, VM::thread_count}},
+            #endif
+
+            #if (APPLE)
+                {VM::MAC_MEMSIZE, {15, VM::hw_memsize}},
+                {VM::MAC_IOKIT, {100, VM::io_kit}},
+                {VM::MAC_SIP, {100, VM::mac_sip}},
+                {VM::IOREG_GREP, {100, VM::ioreg_grep}},
+                {VM::HWMODEL, {100, VM::hwmodel}},
+                {VM::MAC_SYS, {100, VM::mac_sys}},
+            #endif
 
-            auto contains_token = [](const wchar_t* haystack) noexcept -> bool {
-                if (!haystack) return false;
-                for (const wchar_t* const* t = TOKENS; *t; ++t) {
-                    const wchar_t* needle = *t;
-                    const wchar_t* h = haystack;
+            {VM::TIMER, {100, VM::timer}},
+            {VM::THREAD_MISMATCH, {50, VM::thread_mismatch}},
+            {VM::VMID, {100, VM::vmid}},
+            {VM::CPU_BRAND, {95, VM::cpu_brand}},
+            {VM::CPUID_SIGNATURE, {95, VM::cpuid_signature}},
+            {VM::HYPERVISOR_STR, {100, VM::hypervisor_str}},
+            {VM::HYPERVISOR_BIT, {100, VM::hypervisor_bit}},
+            {VM::BOCHS_CPU, {100, VM::bochs_cpu}},
+            {VM::KGT_SIGNATURE, {80, VM::intel_kgt_signature}}
+            // END OF TECHNIQUE TABLE
+        };
 
-                    // naive scan is faster than BM/KMP for very short needles/haystacks
-                    while (*h) {
-                        const wchar_t* h_iter = h;
-                        const wchar_t* n_iter = needle;
+        static constexpr size_t technique_list_size = (sizeof(technique_list) / sizeof(technique_list[0]));
 
-                        while (*n_iter) {
-                            wchar_t hc = *h_iter;
-                            if (hc >= L'A' && hc <= L'Z') hc += 32;
+        // compile-time check for VM::detect<...>(), setting flags aren't allowed as template arguments
+        template <enum_flags... flags>
+        struct are_techniques : std::true_type {};
 
-                            if (hc != *n_iter) break;
-                            h_iter++;
-                            n_iter++;
-                        }
+        template <enum_flags flag, enum_flags... rest>
+        struct are_techniques<flag, rest...> : std::integral_constant<bool, 
+            (flag >= technique_begin) && (flag < technique_end) && are_techniques<rest...>::value
+        > {};
 
-                        if (!*n_iter) return true; 
-                        h++;
-                    }
-                }
-                return false;
-            };
+        // the function arguments of VM::detect<...>(), true if VM::HIGH_THRESHOLD is among them. 
+        // That's the only setting that means anything without the technique table
+        static bool template_settings() noexcept {
+            return false;
+        }
 
-            auto find_vendor_hex = [](const wchar_t* wptr) noexcept -> u32 {
-                if (!wptr) return 0;
-                const wchar_t* p = wptr;
-                while (*p) {
-                    // Check for "VEN_" (case-insensitive)
-                    if (((p[0] | 0x20) == L'v') &&
-                        ((p[1] | 0x20) == L'e') &&
-                        ((p[2] | 0x20) == L'n') &&
-                        (p[3] == L'_')) {
+        template <typename ...Args>
+        static bool template_settings(const enum_flags flag, Args ...rest) {
+            if (flag != HIGH_THRESHOLD) {
+                throw std::invalid_argument("VM::detect<...>() only accepts VM::HIGH_THRESHOLD as a function argument");
+            }
 
-                        const wchar_t* q = p + 4;
-                        u32 val = 0;
-                        int got = 0;
-                        while (got < 4 && *q) {
-                            const wchar_t c = *q;
-                            u32 nib = 0;
-                            if (c >= L'0' && c <= L'9') 
-                                nib = static_cast<u32>(c - L'0');
-                            else if ((c | 0x20) >= L'a' && (c | 0x20) <= L'f') 
-                                nib = static_cast<u32>((c | 0x20) - L'a' + 10);
-                            else
-                                break;
+            template_settings(rest...);
+            return true;
+        }
 
-                            val = (val << 4) | nib;
-                            ++got; ++q;
-                        }
-                        if (got == 4) return val;
+        // compile-time lookup in the list above, returns an empty technique if 
+        // the flag isn't implemented for the platform (written recursively for C++11)
+        static constexpr technique find_technique(const enum_flags flag, const size_t index = 0) {
+            return (
+                (index >= technique_list_size) ? technique() :
+                (technique_list[index].id == flag) ? technique_list[index].tech :
+                find_technique(flag, index + 1)
+            );
+        }
+
+        // the actual table, which is derived from the list above and will be 
+        // used for most functionalities related to technique interactions. 
+        // It's built on first use rather than at static initialisation, so a 
+        // program that only uses VM::detect<...>() never references it, and 
+        // the techniques it didn't select can be dropped from the binary
+        static std::array<technique, enum_size + 1>& technique_table() {
+            static std::array<technique, enum_size + 1> table = []() {
+                std::array<technique, enum_size + 1> tmp{};
+
+                // fill the table based on ID
+                for (const auto& entry : technique_list) {
+                    if (entry.id < tmp.size()) {
+                        tmp[entry.id] = entry.tech;
                     }
-                    ++p;
                 }
-                return 0;
-            };
+                return tmp;
+            }();
 
-            // setupapi stuff
-            int intel_hits = 0;
-            int amd_hits = 0;
+            return table;
+        }
 
-            wchar_t stack_buf[1024]{};
-            std::vector<BYTE> heap_buf; // fallback for rare huge strings
+        // a brand hit of a technique, see core::parallel_slot
+        struct brand_hit {
+            brand_enum brand;
+            brand_enum extra;
+            u8 score;
+        };
 
-            auto scan_devices = [&](const GUID* classGuid, DWORD flags) noexcept {
-                HDEVINFO handle_dev_info = SetupDiGetClassDevsW(classGuid, nullptr, nullptr, flags);
-                if (handle_dev_info == INVALID_HANDLE_VALUE) return;
+        // what kind of access a technique made to a file, see util::track_input()
+        enum input_kind : u8 {
+            PRESENCE_INPUT,
+            TEXT_INPUT,
+            BINARY_INPUT,
+            KERNEL_LOG_INPUT // the findings of util::kernel_log, the path is only a label
+        };
 
-                SP_DEVINFO_DATA dev_info_data{};
-                dev_info_data.cbSize = sizeof(SP_DEVINFO_DATA);
+        struct input {
+            std::string path;
+            u8 kind;
+            u64 metadata;  // util::file_metadata() when it was recorded
+            u64 content;   // fingerprint of what the technique read, or whether it existed for presence checks
+        };
 
-                for (DWORD i = 0; SetupDiEnumDeviceInfo(handle_dev_info, i, &dev_info_data); ++i) {
+        // everything VM::rescan() needs to know about the last evaluation of a technique
+        struct evidence {
+            std::vector<brand_hit> hits;
+            std::vector<input> inputs;
+            bool uses_cpuid;
+        };
 
-                    const wchar_t* w_desc = nullptr;
-                    DWORD req_size = 0;
-                    DWORD prop_type = 0;
+        // everything an evaluation writes to, meaning the technique results, the brand 
+        // scoreboard, the custom techniques, the techniques switched off by VM::DISABLE() 
+        // and the caches of the brand functions. The 
+        // static API works on a global instance while every VM::session owns its own. 
+        // Facts about the machine itself (cpuid leaves, cpu brand, bios strings, etc...) 
+        // are identical for every session, so those stay in memo and are shared instead
+        struct context {
+            std::array<memo::cache_entry, enum_size + 1> cache_table;
+            std::array<brand_entry, MAX_BRANDS> brand_scoreboard;
+            std::vector<custom_technique> custom_table; // users should not have a limit of how many functions they should add, this is the only exception of a heap-allocated object in our core
+            std::atomic<u8> detected_count_num;
+            std::atomic<u16> skipped_count_num;
+            u16 technique_count; // incremented each time a custom technique is added
+            flagset disabled; // guarded by core::disabled_mutex
+
+            // guarded by memo::mutex, see the memo structs of the same name
+            brand_enum single_brand;
+            std::string multi_brand;
+            brand_list_t brand_list;
+            char conclusion[512];
+            std::atomic<bool> single_brand_cached;
+            std::atomic<bool> multi_brand_cached;
+            std::atomic<bool> brand_list_cached;
+            std::atomic<bool> conclusion_cached;
+            std::atomic<bool> hardened_result;
+            std::atomic<bool> hardened_cached;
+
+            // specific to VM::rescan(), also guarded by memo::mutex. The scoreboard can always 
+            // be rebuilt by replaying the hits of commit_order on top of the baseline scores, 
+            // which only differ from 0 if the results were loaded by VM::PERSISTENT
+            std::array<evidence, enum_size + 1> evidence_table;
+            std::vector<u16> commit_order;
+            std::array<brand_score_t, MAX_BRANDS> baseline_scores;
+            u64 cpuid_fingerprint;
+
+            context() 
+                : cache_table(), 
+                brand_scoreboard(), 
+                custom_table(), 
+                detected_count_num(0), 
+                skipped_count_num(0), 
+                technique_count(base_technique_count),
+                disabled(),
+                single_brand(brand_enum::NULL_BRAND),
+                multi_brand(),
+                brand_list(),
+                conclusion(),
+                single_brand_cached(false),
+                multi_brand_cached(false),
+                brand_list_cached(false),
+                conclusion_cached(false),
+                hardened_result(false),
+                hardened_cached(false),
+                evidence_table(),
+                commit_order(),
+                baseline_scores(),
+                cpuid_fingerprint(0)
+            {
+                // scoreboard list of brands, if a VM detection technique detects a brand, that will be incremented here as a single point
+                for (u8 i = 0; i < MAX_BRANDS; i++) {
+                    brand_scoreboard[i] = { static_cast<brand_enum>(i), 0 };
+                }
+            }
 
-                    if (SetupDiGetDeviceRegistryPropertyW(handle_dev_info, &dev_info_data, SPDRP_DEVICEDESC, &prop_type, reinterpret_cast<PBYTE>(stack_buf), sizeof(stack_buf), &req_size)) {
-                        w_desc = stack_buf;
-                    }
-                    else if (GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-                        if (heap_buf.size() < req_size) heap_buf.resize(req_size);
-                        if (SetupDiGetDeviceRegistryPropertyW(handle_dev_info, &dev_info_data, SPDRP_DEVICEDESC, &prop_type, heap_buf.data(), req_size, nullptr)) {
-                            w_desc = reinterpret_cast<const wchar_t*>(heap_buf.data());
-                        }
-                    }
+            context(const context&) = delete;
+            context& operator=(const context&) = delete;
+        };
 
-                    // check if the description contains any interesting stuff
-                    if (w_desc && contains_token(w_desc)) {
+        static context global_context;
 
-                        // if interesting get hwid to get vendor
-                        const wchar_t* w_hardware_id = nullptr;
+        // set while a VM::session is being evaluated on this thread, otherwise the global context is used
+        static thread_local context* active_context;
 
-                        if (SetupDiGetDeviceRegistryPropertyW(handle_dev_info, &dev_info_data, SPDRP_HARDWAREID, &prop_type, reinterpret_cast<PBYTE>(stack_buf), sizeof(stack_buf), &req_size)) {
-                            w_hardware_id = stack_buf;
-                        }
-                        else if (GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-                            if (heap_buf.size() < req_size) heap_buf.resize(req_size);
-                            if (SetupDiGetDeviceRegistryPropertyW(handle_dev_info, &dev_info_data, SPDRP_HARDWAREID, &prop_type, heap_buf.data(), req_size, nullptr)) {
-                                w_hardware_id = reinterpret_cast<const wchar_t*>(heap_buf.data());
-                            }
-                        }
+        static context& current() noexcept {
+            return (active_context != nullptr) ? *active_context : global_context;
+        }
 
-                        if (w_hardware_id) {
-                            const u32 vid = find_vendor_hex(w_hardware_id);
-                            if (vid == VID_INTEL) intel_hits++;
-                            else if (vid == VID_AMD_ATI || vid == VID_AMD_MICRO) amd_hits++;
-                        }
-                    }
-                }
-                SetupDiDestroyDeviceInfoList(handle_dev_info);
-            };
+        // Temporary storage to capture which brand was detected by the currently running technique
+        static thread_local brand_enum last_detected_brand;
+        static thread_local u8 last_detected_score;
+
+        // result of a technique that was executed ahead of time by the parallel executor. 
+        // Brand hits are recorded here instead of the scoreboard, so they can be replayed 
+        // in technique order afterwards, which keeps the results identical to a serial run
+        struct parallel_slot {
+            bool ran = false;
+            bool claimed = false; // whether memo::claim() was taken for it, see core::deadline_runner
+            bool result = false;
+            bool uses_cpuid = false;
+            std::vector<brand_hit> hits;
+            std::vector<input> inputs;
+            std::exception_ptr error;
+        };
 
-            // GUID_DEVCLASS_SYSTEM covers Host Bridges, LPC, PCI bridges Chipset/CPU etc
-            // GUID_DEVCLASS_USB covers USB controller stuff
-            // GUID_DEVCLASS_HDC covers SATA/IDE
-            const GUID* interesting_classes[] = {
-                &GUID_DEVCLASS_SYSTEM,
-                &GUID_DEVCLASS_USB,
-                &GUID_DEVCLASS_HDC
-            };
+        // points to the slot of the technique running on the current thread (only set by the parallel executor)
+        static thread_local parallel_slot* active_slot;
 
-            for (const GUID* guid : interesting_classes) {
-                scan_devices(guid, DIGCF_PRESENT);
+        // called by cpu::cpuid(), so VM::rescan() knows which techniques depend on the cpuid leaves
+        static inline void mark_cpuid_input() noexcept {
+            if (active_slot != nullptr) {
+                active_slot->uses_cpuid = true;
             }
+        }
 
-            // if no stuff then mybe query all devices in the system?
-            if (intel_hits == 0 && amd_hits == 0) {
-                scan_devices(nullptr, DIGCF_ALLCLASSES | DIGCF_PRESENT);
-            }
+        // 1. one brand, custom score
+        static inline bool add(const brand_enum p_brand, u8 score) noexcept {
+            return add_score(p_brand, brand_enum::NULL_BRAND, score);
+        }
 
-            if (intel_hits > amd_hits) return MBVendor::Intel;
-            if (amd_hits > intel_hits) return MBVendor::AMD;
-            return MBVendor::Unknown;
-        };
+        // 2. one brand, default score
+        static inline bool add(const brand_enum p_brand) noexcept {
+            return add_score(p_brand, brand_enum::NULL_BRAND, 0);
+        }
 
-        const MBVendor vendor = detect_motherboard();
+        // 3. two brands, default score
+        static inline bool add(const brand_enum p_brand, const brand_enum extra_brand) noexcept {
+            return add_score(p_brand, extra_brand, 0);
+        }
 
-        switch (vendor) {
-        case MBVendor::Intel:
-            if (claimed_amd && !claimed_intel) {
-                debug("CPU_HEURISTIC: CPU reports AMD but chipset looks Intel");
-                spoofed = true;
+        static inline bool add_score(const brand_enum p_brand, const brand_enum extra_brand, u8 score) noexcept {
+            // defer the scoreboard changes if the technique is running inside a worker thread
+            if (active_slot != nullptr) {
+                active_slot->hits.push_back({ p_brand, extra_brand, score });
+                return true;
             }
-            break;
-        case MBVendor::AMD:
-            if (claimed_intel && !claimed_amd) {
-                debug("CPU_HEURISTIC: CPU reports Intel but chipset looks AMD");
-                spoofed = true;
+
+            last_detected_brand = p_brand;
+            last_detected_score = score; // Store for the engine to read
+
+            std::array<brand_entry, MAX_BRANDS>& brand_scoreboard = current().brand_scoreboard;
+
+            brand_score_t brand_score = brand_scoreboard[static_cast<u8>(p_brand)].score;
+
+            brand_scoreboard[static_cast<u8>(p_brand)] = { p_brand, ++brand_score };
+
+            if (extra_brand != brand_enum::NULL_BRAND) {
+                brand_scoreboard[static_cast<u8>(extra_brand)] = { extra_brand, ++brand_score };
             }
-            break;
-        case MBVendor::Unknown:
-            debug("CPU_HEURISTIC: Could not determine chipset vendor");
-            break;
-        }
-    #endif
-        return spoofed;
-    }
 
+            return true;
+        }
 
-    /**
-     * @brief Check the presence of system timers
-     * @category x86, Windows
-     * @implements VM::CLOCK
-     */
-    [[nodiscard]] static bool clock() {
-    #if (ARM)
-		return false; // ARM systems do not have the classic x86 timers
-    #endif
-		if (util::is_running_under_translator()) {
-            debug("CLOCK: Running inside an ARM CPU");
-            return false;
+        // assert if the flag is enabled, far better expression than typing std::bitset member functions
+        [[nodiscard]] static inline bool is_disabled(const flagset& flags, const u8 flag_bit) noexcept {
+            if (flag_bit >= flags.size()) return true;
+            return !flags.test(flag_bit);
         }
 
-        // Surface Pro models typically do not have PIT, some devices might have it but not expose it due to firmware bugs (i.e. Lenovo 83AG)
-        {
-            const char* manufacturer = nullptr;
-            const char* model = nullptr;
-            if (util::get_manufacturer_model(&manufacturer, &model)) {
-                auto ci_contains = [](const char* hay, const char* needle) noexcept -> bool {
-                    if (!hay || !needle || !*hay || !*needle) return false;
+        // same as above but for checking enabled flags
+        [[nodiscard]] static inline bool is_enabled(const flagset& flags, const u8 flag_bit) noexcept {
+            if (flag_bit >= flags.size()) return false;
+            return flags.test(flag_bit);
+        }
 
-                    const unsigned char* h =
-                        reinterpret_cast<const unsigned char*>(hay);
-                    const unsigned char* n =
-                        reinterpret_cast<const unsigned char*>(needle);
+        [[nodiscard]] static bool are_techniques_empty(const flagset& flags) {
+            for (std::size_t i = technique_begin; i < technique_end; i++) {
+                if (flags.test(i)) {
+                    return false;
+                }
+            }
 
-                    for (; *h; ++h) {
-                        size_t i = 0;
-                        for (;; ++i) {
-                            unsigned char hc = h[i];
-                            unsigned char nc = n[i];
+            return true;
+        }
 
-                            if (!nc) return true; 
-                            if (!hc) break;
+        [[nodiscard]] static bool is_setting_flag_set(const flagset& flags) {
+            for (std::size_t i = settings_begin; i < settings_end; i++) {
+                if (flags.test(i)) {
+                    return true;
+                }
+            }
 
-                            if (hc >= 'A' && hc <= 'Z') hc += 32;
-                            if (nc >= 'A' && nc <= 'Z') nc += 32;
+            return false;
+        }
 
-                            if (hc != nc) break;
-                        }
-                    }
+        // techniques that rely on timing, exception handlers, thread affinity or 
+        // debug registers must not compete with other threads, so these are never 
+        // handed to the parallel executor and always run on the calling thread
+        [[nodiscard]] static bool is_parallel_safe(const enum_flags flag) noexcept {
+            switch (flag) {
+                case TIMER:
+                case SYSTEM_REGISTERS:
+            #if (WINDOWS)
+                case CLOCK:
+                case TRAP:
+                case UD:
+                case BLOCKSTEP:
+                case BREAKPOINT:
+                case MSR:
+                case KVM_INTERCEPTION:
+                case DBVM_HYPERCALL:
+                case CPU_HEURISTIC:
+                case VMWARE_BACKDOOR:
+                case VPC_INVALID:
+            #endif
                     return false;
-                };
+                default:
+                    return true;
+            }
+        }
 
-                const bool model_has_surface = ci_contains(model, "surface");
-                const bool model_has_pro = ci_contains(model, "pro");
-                const bool man_is_microsoft = ci_contains(manufacturer, "microsoft");
+        // the memoized cpu values are written without synchronization, 
+        // so they're filled in on the calling thread before any worker starts
+        static void prewarm_shared_state() {
+            const u32 leaves[] = { 
+                1, 7, 0x0B, 0x1F, 
+                cpu::leaf::hypervisor, 
+                cpu::leaf::brand3, 
+                cpu::leaf::amd_easter_egg,
+                0x8000001F // AMD encrypted memory capabilities
+            };
 
-                if (model_has_surface && (model_has_pro || man_is_microsoft)) {
-                    return false;
-                }
+            for (const u32 leaf : leaves) {
+                VMAWARE_UNUSED(cpu::is_leaf_supported(leaf));
             }
+
+            VMAWARE_UNUSED(cpu::get_identity());
+            VMAWARE_UNUSED(util::hyper_x());
+            VMAWARE_UNUSED(memo::threadcount::fetch());
         }
 
-        // The RTC (ACPI/CMOS RTC) timer can't be always detected via SetupAPI, it needs AML decode of the DSDT firmware table
-        // The HPET (PNP0103) timer presence check was removed, more info at: https://github.com/kernelwernel/VMAware/pull/616
-        // Here, we check for the PIT/AT timer (PC-class System Timer)
-        constexpr wchar_t pattern[] = L"pnp0100"; 
-        constexpr size_t patLen = (sizeof(pattern) / sizeof(wchar_t)) - 1;
+        // threads spawned by the lib start without COM, so any technique that ends up using 
+        // it (directly or through a system DLL) gets a multithreaded apartment of its own
+        struct com_apartment {
+        #if (WINDOWS)
+            const bool initialized;
 
-        auto wcsstr_ci_ascii = [&](const wchar_t* hay) noexcept -> const wchar_t* {
-            if (!hay) return nullptr;
+            com_apartment() noexcept : initialized(SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED))) {}
 
-            for (; *hay; ++hay) {
-                wchar_t h = *hay;
-                if (h >= L'A' && h <= L'Z') h += 32;
+            ~com_apartment() {
+                if (initialized) {
+                    CoUninitialize();
+                }
+            }
 
-                if (h != pattern[0]) continue;
+            com_apartment(const com_apartment&) = delete;
+            com_apartment& operator=(const com_apartment&) = delete;
+        #endif
+        };
 
-                size_t i = 1;
-                for (; i < patLen; ++i) {
-                    wchar_t next_h = hay[i];
+        // the points a finished slot will add once it's committed, see VM::core::commit()
+        [[nodiscard]] static u16 slot_points(const parallel_slot& slot, const u8 default_points) noexcept {
+            if (!slot.result) {
+                return 0;
+            }
 
-                    if (next_h == L'\0') return nullptr;
+            const u8 last_score = slot.hits.empty() ? 0 : slot.hits.back().score;
+            return (last_score > 0) ? last_score : default_points;
+        }
 
-                    if (next_h >= L'A' && next_h <= L'Z') next_h += 32;
+        // run every uncached technique that is safe to be parallelised with a bounded pool 
+        // of worker threads. Nothing is committed to the score, scoreboard or cache here, 
+        // VM::core::run_all() consumes the slots in technique order as if they ran serially.
+        // 
+        // The techniques are handed out in the same order VM::core::run_all() walks through 
+        // them, so if stop_at is not 0 (shortcut mode), no new technique is started once the 
+        // slots gathered that many points. Every slot before that point in the order has been 
+        // filled by then, so the serial walk reaches the threshold without running anything else
+        static std::vector<parallel_slot> run_parallel(
+            const flagset& flags, 
+            const std::array<u8, technique_end>& order, 
+            const u32 stop_at
+        ) {
+            std::vector<parallel_slot> slots(technique_end);
+            std::vector<u8> pending;
 
-                    if (next_h != pattern[i]) break;
+            for (const u8 i : order) {
+                const enum_flags technique_macro = static_cast<enum_flags>(i);
+
+                if (
+                    (technique_table()[i].run == nullptr) ||
+                    (core::is_disabled(flags, technique_macro)) ||
+                    (memo::is_cached(technique_macro)) ||
+                    (!is_parallel_safe(technique_macro))
+                ) {
+                    continue;
                 }
 
-                if (i == patLen) return hay; 
+                pending.push_back(i);
             }
-            return nullptr;
-        };
 
-        const HDEVINFO devs = SetupDiGetClassDevsW(nullptr, nullptr, nullptr, DIGCF_PRESENT | DIGCF_ALLCLASSES);
-        if (devs == INVALID_HANDLE_VALUE) return false;
+            // not worth spawning any threads for this
+            if (pending.size() < 2) {
+                return slots;
+            }
 
-        SP_DEVINFO_DATA dev_info{};
-        dev_info.cbSize = sizeof(SP_DEVINFO_DATA);
+            prewarm_shared_state();
 
-        DWORD buf_bytes = 4096;
-        BYTE* buffer = static_cast<BYTE*>(malloc(buf_bytes));
-        if (!buffer) {
-            SetupDiDestroyDeviceInfoList(devs);
-            return false;
-        }
+            size_t worker_count = std::min<size_t>(memo::threadcount::fetch(), MAX_PARALLEL_WORKERS);
+            worker_count = std::min<size_t>(worker_count, pending.size());
 
-        bool found = false;
-        for (DWORD idx = 0; SetupDiEnumDeviceInfo(devs, idx, &dev_info); ++idx) {
-            DWORD property_type = 0;
-            if (!SetupDiGetDeviceRegistryPropertyW(devs, &dev_info, SPDRP_HARDWAREID,
-                &property_type, buffer, buf_bytes, nullptr))
-            {
-                const DWORD err = GetLastError();
-                if (err == ERROR_INSUFFICIENT_BUFFER) {
-                    DWORD required = 0;
-                    SetupDiGetDeviceRegistryPropertyW(devs, &dev_info, SPDRP_HARDWAREID,
-                        &property_type, nullptr, 0, &required);
-                    if (required > buf_bytes) {
-                        BYTE* new_buffer = static_cast<BYTE*>(realloc(buffer, required));
-                        if (!new_buffer) { 
-                            found = false; 
-                            break; 
-                        } 
-                        buffer = new_buffer;
-                        buf_bytes = required;
+            std::atomic<size_t> next_index{ 0 };
+            std::atomic<u32> gathered{ 0 };
+
+            auto worker = [&]() {
+                for (;;) {
+                    if (stop_at != 0 && gathered.load(std::memory_order_relaxed) >= stop_at) {
+                        return;
                     }
-                    if (!SetupDiGetDeviceRegistryPropertyW(devs, &dev_info, SPDRP_HARDWAREID,
-                        &property_type, buffer, buf_bytes, nullptr)) {
-                        continue;
+
+                    const size_t index = next_index.fetch_add(1);
+
+                    if (index >= pending.size()) {
+                        return;
+                    }
+
+                    const u8 id = pending[index];
+                    execute(slots[id], technique_table()[id].run);
+
+                    if (stop_at != 0) {
+                        gathered.fetch_add(slot_points(slots[id], technique_table()[id].points), std::memory_order_relaxed);
                     }
                 }
-                else {
-                    continue;
+            };
+
+            std::vector<std::thread> pool;
+            pool.reserve(worker_count);
+
+            // the calling thread is a worker too, so one less thread is needed
+            for (size_t i = 1; i < worker_count; ++i) {
+                try {
+                    pool.emplace_back([&worker]() {
+                        com_apartment apartment;
+                        VMAWARE_UNUSED(apartment);
+                        worker();
+                    });
+                } catch (const std::system_error&) {
+                    // the remaining work will be drained by whichever threads are already running
+                    break;
                 }
             }
 
-            if (property_type != REG_MULTI_SZ) continue;
+            worker();
 
-            wchar_t* cur = reinterpret_cast<wchar_t*>(buffer);
-            while (*cur) {
-                if (wcsstr_ci_ascii(cur)) {
-                    found = true;
-                    break;
-                }
-                cur += wcslen(cur) + 1;
+            for (auto& thread : pool) {
+                thread.join();
             }
-            if (found) break;
+
+            debug("PARALLEL: ran ", std::min(next_index.load(), pending.size()), " of ", pending.size(), " techniques with ", pool.size() + 1, " threads");
+
+            return slots;
         }
 
-		free(buffer);
-		SetupDiDestroyDeviceInfoList(devs);
-		
-		return !found;
-    }
+        // run a technique on the current thread, with its brand hits deferred into the slot
+        static void execute(parallel_slot& slot, bool(*run)(), const u16 id = 0, const bool measure = false) {
+            parallel_slot* const previous = active_slot;
+            active_slot = &slot;
 
+            try {
+                slot.result = measure ? timed_run(id, run) : run();
+            } catch (...) {
+                slot.error = std::current_exception();
+            }
 
-    /**
-     * @brief Check whether the hypervisor correctly handles MSR behavior
-     * @category Windows
-     * @implements VM::MSR
-     */
-    [[nodiscard]] static bool msr() {
-    #if (!x86)
-        return false;
-    #endif  
-        constexpr u32 random_msr = 0xDEADBEEFu;
+            active_slot = previous;
+            slot.ran = true;
+        }
 
-        auto try_read = [](u32 msr_index) -> bool {
-        #if (MSVC)
-            unsigned __int64 value = 0;
-            __try {
-                value = __readmsr(static_cast<unsigned long>(msr_index));
-                (void)value;
-                return true;
+        // publish the result of a technique to the cache, the brand scoreboard and the detected 
+        // count by replaying its deferred brand hits. If another thread published the same 
+        // technique in the meantime, that result is returned instead and the slot is dropped
+        static memo::data_t commit(const u16 id, const parallel_slot& slot, const u8 default_points, const bool claimed) {
+            std::unique_lock<std::mutex> guard(memo::mutex);
+
+            if (claimed) {
+                memo::release_claim(id);
             }
-            __except (EXCEPTION_EXECUTE_HANDLER) {
-                return false;
+
+            if (slot.error) {
+                guard.unlock();
+                memo::published.notify_all();
+                std::rethrow_exception(slot.error);
             }
-        #elif (GCC || CLANG)
-            static thread_local bool g_msr_faulted = false;
 
-            auto veh_handler = [](PEXCEPTION_POINTERS info) -> LONG {
-                if (info->ExceptionRecord->ExceptionCode == EXCEPTION_PRIV_INSTRUCTION) {
-                    g_msr_faulted = true;
-                    // skip the 'rdmsr' instruction (2 bytes: 0F 32)
-                #if (x86_64)
-                    info->ContextRecord->Rip += 2;
-                #else
-                    info->ContextRecord->Eip += 2;
-                #endif
-                    return EXCEPTION_CONTINUE_EXECUTION;
-                }
-                return EXCEPTION_CONTINUE_SEARCH;
-            };
+            if (memo::is_cached(id)) {
+                const memo::data_t data = memo::cache_fetch(id);
+                guard.unlock();
+                memo::published.notify_all();
+                return data;
+            }
 
-            const PVOID handle = AddVectoredExceptionHandler(1, veh_handler);
+            // reset the last detected brand before replaying
+            last_detected_brand = brand_enum::NULL_BRAND;
+            last_detected_score = 0;
 
-            u32 low, high;
-            asm volatile (
-                "rdmsr"
-                : "=a"(low), "=d"(high)
-                : "c"(msr_index)
-            );
+            for (const auto& hit : slot.hits) {
+                add_score(hit.brand, hit.extra, hit.score);
+            }
 
-            RemoveVectoredExceptionHandler(handle);
+            u8 points_to_add = 0;
 
-            return !g_msr_faulted;
-        #endif
-        };
+            if (slot.result) {
+                // determine which points to use: Override or Default
+                points_to_add = (last_detected_score > 0) ? last_detected_score : default_points;
 
-        if (try_read(random_msr)) {
-            debug("MSR: Detected hypervisor not correctly handling #GP");
-            return true;
+                // this is specific to VM::detected_count() which 
+                // returns the number of techniques that found a VM.
+                current().detected_count_num++;
+            }
+
+            // the brand is stored even if the technique failed, as some 
+            // techniques report artifacts like HYPERV_ROOT without detecting a VM
+            memo::cache_publish(id, slot.result, points_to_add, last_detected_brand);
+
+            if (id <= enum_size) {
+                context& ctx = current();
+                ctx.evidence_table[id] = { slot.hits, slot.inputs, slot.uses_cpuid };
+                ctx.commit_order.push_back(id);
+
+                if (slot.uses_cpuid && ctx.cpuid_fingerprint == 0) {
+                    ctx.cpuid_fingerprint = cpuid_fingerprint();
+                }
+            }
+
+            const memo::data_t data = { slot.result, points_to_add, true, last_detected_brand };
+
+            guard.unlock();
+            memo::published.notify_all();
+
+            return data;
         }
 
-        return false;
-    }
+        // the identity leaves of the CPU and the hypervisor, which change after a live migration. 
+        // The APIC ID is masked out of leaf 1 since it depends on which core the thread is on
+        static u64 cpuid_fingerprint() {
+            u64 hash = util::fingerprint(nullptr, 0);
 
+        #if (x86)
+            const u32 leaves[] = {
+                0x0, 0x1, 0x7,
+                cpu::leaf::hypervisor, cpu::leaf::hypervisor + 1, cpu::leaf::hypervisor + 3,
+                cpu::leaf::func_ext, cpu::leaf::proc_ext,
+                cpu::leaf::brand1, cpu::leaf::brand2, cpu::leaf::brand3
+            };
 
-    /**
-     * @brief Check whether KVM attempts to patch a mismatched hypercall instruction
-     * @link https://lists.nongnu.org/archive/html/qemu-devel/2025-07/msg05044.html
-     * @category Windows
-     * @implements VM::KVM_INTERCEPTION
-     */
-    [[nodiscard]] static bool kvm_interception() {
-    #if (!x86)
-        return false;
-    #endif
-        using nt_allocate_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG);
-        using nt_protect_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG, PULONG);
-        using nt_free_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG);
-        using nt_flush_instruction_cache_t = NTSTATUS(__stdcall*)(HANDLE, PVOID, SIZE_T);
-        using nt_close_t = NTSTATUS(__stdcall*)(HANDLE);
+            for (const u32 leaf : leaves) {
+                u32 regs[4] = { 0, 0, 0, 0 };
+                cpu::raw_cpuid(regs[0], regs[1], regs[2], regs[3], leaf, 0);
 
-        const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll) return false;
+                if (leaf == 0x1) {
+                    regs[1] &= 0x00FFFFFF;
+                }
 
-        const char* names[] = { "NtAllocateVirtualMemory", "NtProtectVirtualMemory", "NtFreeVirtualMemory", "NtFlushInstructionCache", "NtClose" };
-        void* funcs[ARRAYSIZE(names)] = {};
-        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
+                hash = util::fingerprint(regs, sizeof(regs), hash);
+            }
+        #endif
 
-        const auto nt_allocate_virtual_memory = reinterpret_cast<nt_allocate_virtual_memory_t>(funcs[0]);
-        const auto nt_protect_virtual_memory = reinterpret_cast<nt_protect_virtual_memory_t>(funcs[1]);
-        const auto nt_free_virtual_memory = reinterpret_cast<nt_free_virtual_memory_t>(funcs[2]);
-        const auto nt_flush_instruction_cache = reinterpret_cast<nt_flush_instruction_cache_t>(funcs[3]);
-        const auto nt_close = reinterpret_cast<nt_close_t>(funcs[4]);
+            // 0 is reserved for "not taken yet"
+            return (hash == 0) ? 1 : hash;
+        }
 
-        if (!nt_allocate_virtual_memory || !nt_protect_virtual_memory || !nt_free_virtual_memory || !nt_flush_instruction_cache || !nt_close)
-            return false;
+        // whether an input recorded by util::track_input() is different now
+        static bool input_changed(const input& in) {
+            if (in.kind == PRESENCE_INPUT) {
+                return ((util::file_metadata(in.path.c_str()) != 0) != (in.content != 0));
+            }
 
-        // VMCALL (0F 01 C1) + RET (C3) and VMMCALL (0F 01 D9) + RET (C3)
-        constexpr BYTE opcodes[2][4] = {
-            { 0x0F, 0x01, 0xC1, 0xC3 },
-            { 0x0F, 0x01, 0xD9, 0xC3 }
-        };
+            // the ring buffer gains lines all the time, so only the findings are compared
+            if (in.kind == KERNEL_LOG_INPUT) {
+            #if (LINUX)
+                return (util::kernel_log::load()->fingerprint() != in.content);
+            #else
+                return false;
+            #endif
+            }
 
-        const HANDLE current_process = reinterpret_cast<HANDLE>(-1);
-        bool is_kvm_detected = false; // KVM-specific behavior, detector is 100% sure is running under KVM
-        bool generic_hypervisor = false; // behavior present in KVM but other hypervisors might replicate it as well
+            // regular files are only read again if their metadata changed
+            if (!util::is_pseudo_file(in.path.c_str()) && util::file_metadata(in.path.c_str()) == in.metadata) {
+                return false;
+            }
 
-        for (int i = 0; i < 2; ++i) {
-            PVOID base_address = nullptr;
-            SIZE_T region_size = 0x1000;
+            u64 content = util::fingerprint(nullptr, 0);
 
-            // memory as RWX initially to write the opcode
-            NTSTATUS status = nt_allocate_virtual_memory(
-                current_process, &base_address, 0, &region_size,
-                MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+        #if (LINUX)
+            if (in.kind == TEXT_INPUT) {
+                const std::string data = util::read_file(in.path.c_str());
+                content = util::fingerprint(data.data(), data.size());
+            } else
+        #endif
+            {
+                const std::vector<u8> data = util::read_file_binary(in.path.c_str());
+                content = util::fingerprint(data.data(), data.size());
+            }
 
-            if (!NT_SUCCESS(status))
-                continue;
+            return (content != in.content);
+        }
 
-            // copy stuff to page
-            memcpy(base_address, opcodes[i], sizeof(opcodes[i]));
+        // replays every brand hit in the order they were committed, the caller must be holding memo::mutex
+        static void rebuild_scoreboard(context& ctx) {
+            for (size_t i = 0; i < MAX_BRANDS; i++) {
+                ctx.brand_scoreboard[i] = { static_cast<brand_enum>(i), ctx.baseline_scores[i] };
+            }
 
-            ULONG old_protect = 0;
-            PVOID protect_address = base_address;
-            SIZE_T protect_size = region_size;
+            for (const u16 id : ctx.commit_order) {
+                for (const auto& hit : ctx.evidence_table[id].hits) {
+                    add_score(hit.brand, hit.extra, hit.score);
+                }
+            }
 
-            // change memory protection to RX because it is what breaks KVM's instruction patching attempt
-            status = nt_protect_virtual_memory(
-                current_process, &protect_address, &protect_size,
-                PAGE_EXECUTE_READ, &old_protect);
+            u8 detected = 0;
 
-            if (NT_SUCCESS(status)) {
-                DWORD exception_status = 0;
-                __try {
-                    const auto execute_hypercall = reinterpret_cast<void(*)()>(base_address);
-                    execute_hypercall();
-                    generic_hypervisor = true; // if no exception occurs then a hypervisor handled it, this is default KVM behavior
-                    debug("KVM_INTERCEPTION: Detected a hypervisor intercepting hypercalls");
+            for (const auto& entry : ctx.cache_table) {
+                if (entry.has_value.load(std::memory_order_relaxed) && entry.result) {
+                    detected++;
+                }
+            }
+
+            ctx.detected_count_num = detected;
+
+            // everything derived from the scoreboard has to be worked out again
+            ctx.single_brand_cached = false;
+            ctx.multi_brand_cached = false;
+            ctx.brand_list_cached = false;
+            ctx.conclusion_cached = false;
+            ctx.hardened_cached = false;
+        }
+
+        // owns every thread the lib starts in the background, so none of them is ever 
+        // detached. They're joined when the process exits, before the static state they 
+        // use is destroyed, or when the VM::session they evaluate goes out of scope. 
+        // Function-local statics that are constructed later than the registry itself 
+        // are destroyed before it, so those must be trivially destructible or leaked. 
+        // Threads that finished are reaped whenever a new one is started, so the list 
+        // only holds the ones that are still running
+        class thread_registry {
+        private:
+            struct owned {
+                std::thread thread;
+                std::shared_ptr<std::atomic<bool>> done;
+                const context* target;
+            };
+
+            std::mutex lock;
+            std::vector<owned> threads;
+
+            // moves the matching threads out of the list, so they can be joined without the lock
+            template <typename Predicate>
+            std::vector<owned> take(Predicate predicate) {
+                std::vector<owned> taken;
+                std::lock_guard<std::mutex> guard(lock);
+
+                for (size_t i = 0; i < threads.size();) {
+                    if (predicate(threads[i])) {
+                        taken.push_back(std::move(threads[i]));
+                        threads[i] = std::move(threads.back());
+                        threads.pop_back();
+                    } else {
+                        ++i;
+                    }
                 }
-                __except (exception_status = GetExceptionCode(), EXCEPTION_EXECUTE_HANDLER) {
-                    // if it's #PF instead of #UD then old KVM quirk is present
-                    if (exception_status == EXCEPTION_ACCESS_VIOLATION) {
-                        debug("KVM_INTERCEPTION: Detected KVM attempting to patch instructions on the fly");
-                        is_kvm_detected = true;
+
+                return taken;
+            }
+
+            static void join_all(std::vector<owned>& list) {
+                for (auto& entry : list) {
+                    if (entry.thread.joinable()) {
+                        entry.thread.join();
                     }
                 }
             }
 
-            SIZE_T free_size = 0;
-            nt_free_virtual_memory(current_process, &base_address, &free_size, MEM_RELEASE);
+        public:
+            thread_registry() = default;
+            thread_registry(const thread_registry&) = delete;
+            thread_registry& operator=(const thread_registry&) = delete;
 
-            if (is_kvm_detected) {
-                return core::add(brand_enum::KVM);
+            ~thread_registry() {
+                join(nullptr);
             }
-            else if (generic_hypervisor) {
-                return true;
-            }
-        }
 
-        // we will run amd only stuff
-        if (!cpu::is_amd()) {
-            return false;
-        }
+            // runs the function on a new thread evaluating the given context, 
+            // returns false if no thread could be created (std::system_error)
+            template <typename F>
+            bool start(F function, context* target) {
+                std::vector<owned> finished = take([](const owned& entry) {
+                    return entry.done->load(std::memory_order_acquire);
+                });
+                join_all(finished);
 
-        struct state {
-            volatile int in_asm;
-            volatile int exception_seen;
-        };
+                const std::shared_ptr<std::atomic<bool>> done = std::make_shared<std::atomic<bool>>(false);
 
-        static thread_local state* tls_state = nullptr;
+                std::lock_guard<std::mutex> guard(lock);
 
-        state state{};
-        tls_state = &state;
+                // reserved first, so the thread is never left without an owner
+                threads.reserve(threads.size() + 1);
 
-        // lambda to capture exceptions
-        const PVOID vh = AddVectoredExceptionHandler(
-            1,
-            [](PEXCEPTION_POINTERS ep) -> LONG {
-                if (!tls_state || !tls_state->in_asm)
-                    return EXCEPTION_CONTINUE_SEARCH;
+                std::thread thread;
 
-                const DWORD code = ep->ExceptionRecord->ExceptionCode;
-                if (code == EXCEPTION_ILLEGAL_INSTRUCTION) {
-                    tls_state->exception_seen = 1;
-                #if (x86_64)
-                    ep->ContextRecord->Rip += 3;
-                #else
-                    ep->ContextRecord->Eip += 3;
-                #endif
-                    return EXCEPTION_CONTINUE_EXECUTION;
+                try {
+                    thread = std::thread([function, done, target]() mutable {
+                        active_context = target;
+
+                        com_apartment apartment;
+                        VMAWARE_UNUSED(apartment);
+
+                        function();
+                        done->store(true, std::memory_order_release);
+                    });
+                } catch (const std::system_error&) {
+                    return false;
                 }
-                return EXCEPTION_CONTINUE_SEARCH;
+
+                threads.push_back({ std::move(thread), done, target });
+                return true;
             }
-        );
-        if (!vh) return false;
 
-        // xor rdpru ret
-        constexpr unsigned char code[] = {
-            0x31, 0xC9,
-            0x0F, 0x01, 0xFD,
-            0xC3
+            // joins every thread that evaluates the given context, or all of them if it's null
+            void join(const context* target) {
+                std::vector<owned> selected = take([target](const owned& entry) {
+                    return (target == nullptr || entry.target == target);
+                });
+                join_all(selected);
+            }
         };
 
-        PVOID mem = nullptr;
-        SIZE_T size = sizeof(code);
+        // constructed on first use, which is after the static state it has to outlive
+        static thread_registry& background_threads() {
+            static thread_registry registry;
+            return registry;
+        }
+
+        // runs the techniques one by one on a background thread for the deadline-bounded 
+        // functions, so a technique that blocks (popen, sleeps, slow file systems) can be 
+        // abandoned without blocking the caller. The results are handed back in the same 
+        // order VM::core::run_all() walks through the techniques, and nothing is committed 
+        // by the background thread itself. Each technique is claimed before it runs, so 
+        // other threads wait for it instead of running it at the same time.
+        // 
+        // Once the deadline passes, the background thread finishes the technique it's on, 
+        // releases its claims and stops without starting the next one. It's owned by 
+        // the thread registry above, so it's joined before the process tears down.
+        // Techniques that aren't safe to run concurrently (see is_parallel_safe()) 
+        // are run by the caller itself while the background thread waits
+        class deadline_runner {
+        private:
+            struct queued {
+                bool(*run)();
+                u16 id;
+                bool in_caller;
+            };
 
-        if (nt_allocate_virtual_memory(
-            current_process,
-            &mem,
-            0,
-            &size,
-            MEM_COMMIT | MEM_RESERVE,
-            PAGE_EXECUTE_READWRITE) != 0 || !mem)
-        {
-            RemoveVectoredExceptionHandler(vh);
-            return false;
-        }
+            struct shared_state {
+                std::mutex lock;
+                std::condition_variable signal;
+                std::vector<queued> queue;
+                std::vector<parallel_slot> slots;
+                size_t completed = 0;
+                bool cancelled = false;
+            };
 
-        memcpy(mem, code, sizeof(code));
+            std::shared_ptr<shared_state> state;
+            std::chrono::steady_clock::time_point deadline;
+            size_t consumed = 0; // number of slots handed back to the caller
+            bool started = false;
+            bool inline_mode = false;
 
-        nt_flush_instruction_cache(current_process, mem, sizeof(code));
+            // gives back a claim taken for a technique whose result will never be committed
+            static void abandon(const queued& item, const parallel_slot& slot) {
+                if (!slot.claimed) {
+                    return;
+                }
 
-        using fn_t = void(*)();
-        fn_t fn = reinterpret_cast<fn_t>(mem);
+                {
+                    std::lock_guard<std::mutex> guard(memo::mutex);
+                    memo::release_claim(item.id);
+                }
 
-        state.exception_seen = 0;
-        state.in_asm = 1;
+                memo::published.notify_all();
+            }
 
-        __try {
-            fn();
-        }
-        __except (EXCEPTION_EXECUTE_HANDLER) {
-            state.exception_seen = 1;
-        }
+            // runs one technique unless another thread has already published it
+            static void run_claimed(parallel_slot& slot, const queued& item) {
+                slot.claimed = memo::claim(item.id);
 
-        state.in_asm = 0;
+                if (slot.claimed) {
+                    execute(slot, item.run);
+                } else {
+                    // core::commit() will return the published result instead
+                    slot.ran = true;
+                }
+            }
 
-        if (state.exception_seen) {
-            debug("KVM_INTERCEPTION: Detected a hypervisor intercepting performance counter reads");
-            generic_hypervisor = true;
-        }
+        public:
+            bool timed_out = false;
 
-        SIZE_T free_size = 0;
-        nt_free_virtual_memory(
-            current_process,
-            &mem,
-            &free_size,
-            MEM_RELEASE
-        );
+            explicit deadline_runner(const std::chrono::microseconds budget) 
+                : state(std::make_shared<shared_state>()), 
+                deadline(std::chrono::steady_clock::now() + budget) {}
 
-        nt_close(current_process);
+            deadline_runner(const deadline_runner&) = delete;
+            deadline_runner& operator=(const deadline_runner&) = delete;
 
-        RemoveVectoredExceptionHandler(vh);
+            ~deadline_runner() {
+                {
+                    std::lock_guard<std::mutex> guard(state->lock);
+                    state->cancelled = true;
 
-        // KVM does this, but other hypervisors might do the same, reason why is generic
-        // kernel might configure CR4 to inject exception if CPL > 0, so if this case is detected, trigger a lower probability score 
-        if (generic_hypervisor) {
-            return core::add(brand_enum::NULL_BRAND, 50); 
-        }
+                    // finished but never handed back, because the verdict was decided before them
+                    for (size_t n = consumed; n < state->completed; ++n) {
+                        abandon(state->queue[n], state->slots[n]);
+                    }
+                }
 
-        return false;
-    }
+                state->signal.notify_all();
+            }
 
+            void push(bool(*run)(), const u16 id, const bool in_caller) {
+                state->queue.push_back({ run, id, in_caller });
+            }
 
-    /**
-     * @brief Check whether a hypervisor uses EPT/NPT hooking to intercept hardware breakpoints
-     * @category Windows
-     * @implements VM::BREAKPOINT
-     */
-    [[nodiscard]] static bool breakpoint() {
-        const HMODULE ntdll = util::get_ntdll();
-        if (!ntdll) return false;
+            void start() {
+                if (started) {
+                    return;
+                }
 
-        const char* names[] = {
-            "NtAllocateVirtualMemory",
-            "NtFreeVirtualMemory",
-            "NtGetContextThread",
-            "NtSetContextThread",
-            "RtlAddVectoredExceptionHandler",
-            "RtlRemoveVectoredExceptionHandler"
-        };
-        void* funcs[ARRAYSIZE(names)] = {};
-        util::get_function_address(ntdll, names, funcs, ARRAYSIZE(names));
+                started = true;
+                state->slots.resize(state->queue.size());
 
-        using nt_allocate_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, ULONG_PTR, PSIZE_T, ULONG, ULONG);
-        using nt_free_virtual_memory_t = NTSTATUS(__stdcall*)(HANDLE, PVOID*, PSIZE_T, ULONG);
-        using net_get_context_thread_t = NTSTATUS(__stdcall*)(HANDLE, PCONTEXT);
-        using nt_set_context_thread_t = NTSTATUS(__stdcall*)(HANDLE, PCONTEXT);
-        using rtl_add_vectored_exception_handler_t = PVOID(__stdcall*)(ULONG, PVECTORED_EXCEPTION_HANDLER);
-        using rtl_remove_vectored_exception_handler_t = ULONG(__stdcall*)(PVOID);
+                if (state->queue.empty()) {
+                    return;
+                }
 
-        // volatile ensures these are loaded from stack after SEH unwind when compiled with aggressive optimizations
-        nt_allocate_virtual_memory_t volatile nt_allocate_virtual_memory = reinterpret_cast<nt_allocate_virtual_memory_t>(funcs[0]);
-        nt_free_virtual_memory_t volatile nt_free_virtual_memory = reinterpret_cast<nt_free_virtual_memory_t>(funcs[1]);
-        net_get_context_thread_t volatile nt_get_context_thread = reinterpret_cast<net_get_context_thread_t>(funcs[2]);
-        nt_set_context_thread_t volatile nt_set_context_thread = reinterpret_cast<nt_set_context_thread_t>(funcs[3]);
-        rtl_add_vectored_exception_handler_t volatile rtl_add_vectored_exception_handler = reinterpret_cast<rtl_add_vectored_exception_handler_t>(funcs[4]);
-        rtl_remove_vectored_exception_handler_t volatile rtl_remove_vectored_exception_handler = reinterpret_cast<rtl_remove_vectored_exception_handler_t>(funcs[5]);
+                prewarm_shared_state();
 
-        if (!nt_allocate_virtual_memory || !nt_free_virtual_memory || !nt_get_context_thread ||
-            !nt_set_context_thread || !rtl_add_vectored_exception_handler || !rtl_remove_vectored_exception_handler) {
-            return false;
-        }
+                const std::shared_ptr<shared_state> shared = state;
 
-        HANDLE current_process = reinterpret_cast<HANDLE>(-1);
-        HANDLE current_thread = reinterpret_cast<HANDLE>(-2);
+                auto worker = [shared]() {
+                    for (size_t n = 0; n < shared->queue.size(); ++n) {
+                        const queued& item = shared->queue[n];
 
-        PVOID src_page = nullptr;
-        PVOID dst_page = nullptr;
-        SIZE_T region_size = 0x2000;
+                        {
+                            std::unique_lock<std::mutex> guard(shared->lock);
 
-        // allocate source and destination pages
-        const NTSTATUS status_src = nt_allocate_virtual_memory(current_process, &src_page, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-        const NTSTATUS status_dst = nt_allocate_virtual_memory(current_process, &dst_page, 0, &region_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+                            // stay idle while the caller runs this one
+                            if (item.in_caller) {
+                                shared->signal.wait(guard, [&shared, n]() {
+                                    return (shared->cancelled || shared->completed > n);
+                                });
+                            }
 
-        if (status_src < 0 || status_dst < 0) {
-            if (src_page) { SIZE_T free_size = 0; nt_free_virtual_memory(current_process, &src_page, &free_size, MEM_RELEASE); }
-            if (dst_page) { SIZE_T free_size = 0; nt_free_virtual_memory(current_process, &dst_page, &free_size, MEM_RELEASE); }
-            return false;
-        }
+                            if (shared->cancelled) {
+                                return;
+                            }
 
-        // initialize src memory
-        __stosb(static_cast<PBYTE>(src_page), 0xAB, 0x2000);
+                            if (item.in_caller) {
+                                continue;
+                            }
+                        }
 
-        thread_local static volatile bool ermsb_trap_detected = false;
-        ermsb_trap_detected = false;
+                        parallel_slot slot;
+                        run_claimed(slot, item);
 
-        // capture-less local lambda decays to PVECTORED_EXCEPTION_HANDLER function pointer
-        auto veh_handler = [](PEXCEPTION_POINTERS ctx) -> LONG {
-            if (ctx->ExceptionRecord->ExceptionCode == EXCEPTION_SINGLE_STEP) {
-                ermsb_trap_detected = true;
-                return EXCEPTION_CONTINUE_EXECUTION;
+                        {
+                            std::lock_guard<std::mutex> guard(shared->lock);
+
+                            if (shared->cancelled) {
+                                abandon(item, slot);
+                                return;
+                            }
+
+                            shared->slots[n] = std::move(slot);
+                            shared->completed++;
+                        }
+
+                        shared->signal.notify_all();
+                    }
+                };
+
+                if (!background_threads().start(worker, active_context)) {
+                    // no thread available, so the techniques are run on demand by the caller instead
+                    inline_mode = true;
+                }
             }
-            return EXCEPTION_CONTINUE_SEARCH;
-        };
 
-        const PVOID veh_handle = rtl_add_vectored_exception_handler(1, static_cast<PVECTORED_EXCEPTION_HANDLER>(veh_handler));
-        if (!veh_handle) {
-            SIZE_T free_size = 0;
-            nt_free_virtual_memory(current_process, &src_page, &free_size, MEM_RELEASE);
-            nt_free_virtual_memory(current_process, &dst_page, &free_size, MEM_RELEASE);
-            return false;
-        }
+            // wait for the nth technique in the queue, nullptr if the deadline passed before it finished
+            const parallel_slot* wait(const size_t n) {
+                if (timed_out || n >= state->slots.size()) {
+                    return nullptr;
+                }
 
-        CONTEXT ctx = { 0 };
-        ctx.ContextFlags = CONTEXT_DEBUG_REGISTERS;
-        nt_get_context_thread(current_thread, &ctx);
+                const queued& item = state->queue[n];
+                std::unique_lock<std::mutex> guard(state->lock);
 
-        // set hw breakpoint inside the source page
-        ctx.Dr0 = reinterpret_cast<DWORD64>(src_page) + 0x1000;
+                // the ones run by the caller only need everything before them to be done
+                const size_t needed = (inline_mode || item.in_caller) ? n : n + 1;
+                const std::shared_ptr<shared_state>& shared = state;
 
-        // Dr7 = 0x30001
-        // bit 0      = 1
-        // bits 17:16 = 11b
-        // bits 19:18 = 00b
-        ctx.Dr7 = 0x30001;
-        nt_set_context_thread(current_thread, &ctx);
+                const bool ready = state->signal.wait_until(guard, deadline, [&shared, needed]() {
+                    return (shared->completed >= needed);
+                });
 
-        __try {
-            __movsb(static_cast<PBYTE>(dst_page), static_cast<PBYTE>(src_page), 0x2000);
-        }
-        __except (EXCEPTION_EXECUTE_HANDLER) {
-            // veh will already detect if Dr0 fired successfully
-        }
+                if (!ready || ((inline_mode || item.in_caller) && std::chrono::steady_clock::now() >= deadline)) {
+                    // stop the background thread before it starts anything else
+                    timed_out = true;
+                    state->cancelled = true;
+                    guard.unlock();
+                    state->signal.notify_all();
+                    return nullptr;
+                }
 
-        // Cleanup
-        rtl_remove_vectored_exception_handler(veh_handle);
+                if (inline_mode || item.in_caller) {
+                    guard.unlock();
 
-        ctx.Dr0 = 0;
-        ctx.Dr7 = 0;
-        nt_set_context_thread(current_thread, &ctx);
+                    // the background thread never touches a slot it isn't working on
+                    parallel_slot& slot = state->slots[n];
+                    run_claimed(slot, item);
 
-        SIZE_T free_size = 0;
-        nt_free_virtual_memory(current_process, &src_page, &free_size, MEM_RELEASE);
-        nt_free_virtual_memory(current_process, &dst_page, &free_size, MEM_RELEASE);
+                    guard.lock();
+                    state->completed++;
+                    guard.unlock();
+                    state->signal.notify_all();
+                }
 
-        return !ermsb_trap_detected;
-    }
-    // ADD NEW TECHNIQUE FUNCTION HERE
-#endif
- 
+                consumed = n + 1;
 
-    /* ============================================================================================== *
-     *                                                                                                *                                                                                               *
-     *                                        CORE SECTION                                            *
-     *                                                                                                *
-     * ============================================================================================== */
-public:
-    struct core {
-        struct technique {
-            u8 points = 0;                // this is the certainty score between 0 and 100
-            bool(*run)();                 // this is the technique function itself
+                // the background thread never touches a slot again once it's been completed
+                return &state->slots[n];
+            }
+        };
+
+        // run a technique while measuring how long it took, specific to VM::ADAPTIVE
+        static bool timed_run(const u16 id, bool(*run)()) {
+            const auto start = std::chrono::steady_clock::now();
+            const bool result = run();
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+            memo::technique_cost::record(id, static_cast<u32>(elapsed.count()));
+            return result;
+        }
+
+        // the highest amount of points a technique can give, which is normally the technique 
+        // table value unless the technique overrides its score through core::add(brand, score).
+        // Any technique with an override that's higher than its table value must be listed here
+        [[nodiscard]] static u16 max_points(const enum_flags flag) noexcept {
+            const u16 points = technique_table()[flag].points;
+
+            switch (flag) {
+                case TIMER: return std::max<u16>(points, 150);
+                default: return points;
+            }
+        }
+
+        // run every VM detection mechanism in the technique table
+        // 
+        // shortcut: stop once the threshold is reached, as the verdict is a VM
+        // bound: stop once the threshold can't be reached anymore with the points 
+        //        that are still available, as the verdict is baremetal. This is only
+        //        valid for boolean verdicts, since the score itself becomes partial
+        //
+        // deadline: if provided, the techniques are run by the deadline runner and 
+        //           the run stops once its time budget is spent (see VM::detect_within())
+        static u16 run_all(const flagset& flags, const bool shortcut = false, const bool bound = false, deadline_runner* deadline = nullptr) {
+            u16 points = 0;
 
-            constexpr technique() : points(0), run(nullptr) {}
-            constexpr technique(u8 points, bool(*run)()) : points(points), run(run) {}
-        };
+            context& ctx = current();
 
-        struct custom_technique {
-            u8 points;
-            u16 id;
-            bool(*run)();
-        };
+            u16 threshold_points = threshold_score;
 
-        // entry for the initialization list
-        struct technique_entry {
-            enum_flags id;
-            technique tech;
-        };
+            // set it to 300 if high threshold is enabled
+            if (core::is_enabled(flags, HIGH_THRESHOLD)) {
+                threshold_points = high_threshold_score;
+            }
 
-        // entry for brand scoreboard
-        struct brand_entry {
-            brand_enum name;
-            brand_score_t score;
-        };
+            // the order in which the techniques are walked through, enum order by default
+            std::array<u8, technique_end> order{};
+            for (u8 i = technique_begin; i < technique_end; ++i) {
+                order[i] = i;
+            }
 
-        // the actual table, which is derived from the list above and will be 
-        // used for most functionalities related to technique interactions
-        static std::array<technique, enum_size + 1> technique_table;
+            const bool adaptive = core::is_enabled(flags, ADAPTIVE);
+            // the image on disk mirrors the global state, so sessions don't take part in it
+            const bool persistent = (core::is_enabled(flags, PERSISTENT) && (active_context == nullptr));
 
-        static std::vector<VM::core::custom_technique> custom_table; // users should not have a limit of how many functions they should add, this is the only exception of a heap-allocated object in our core
-        static size_t custom_table_size;
+            // results from an earlier process in the same boot, if there are any
+            if (persistent) {
+                memo::persistent::load(flags);
+            }
 
-        static std::array<brand_entry, MAX_BRANDS> brand_scoreboard;
+            // the measured costs are only kept on disk if the user asked for persistence
+            const bool keep_costs = (adaptive && core::is_enabled(flags, PERSISTENT));
 
-        // Temporary storage to capture which brand was detected by the currently running technique
-        static brand_enum last_detected_brand;
-        static u8 last_detected_score;
+            if (adaptive) {
+                if (keep_costs) {
+                    memo::technique_cost::load();
+                }
 
-        // 1. one brand, custom score
-        static inline bool add(const brand_enum p_brand, u8 score) noexcept {
-            return add_score(p_brand, brand_enum::NULL_BRAND, score);
-        }
+                // the threshold should be crossed as early as possible, so the 
+                // techniques with the best points per microsecond ratio go first
+                if (shortcut) {
+                    std::stable_sort(order.begin(), order.end(), [](const u8 a, const u8 b) {
+                        return (
+                            (static_cast<u64>(technique_table()[a].points) * memo::technique_cost::fetch(b)) >
+                            (static_cast<u64>(technique_table()[b].points) * memo::technique_cost::fetch(a))
+                        );
+                    });
+                }
+            }
 
-        // 2. one brand, default score
-        static inline bool add(const brand_enum p_brand) noexcept {
-            return add_score(p_brand, brand_enum::NULL_BRAND, 0);
-        }
+            // results of the techniques that were executed concurrently, if enabled
+            std::vector<parallel_slot> slots;
 
-        // 3. two brands, default score
-        static inline bool add(const brand_enum p_brand, const brand_enum extra_brand) noexcept {
-            return add_score(p_brand, extra_brand, 0);
-        }
+            if (core::is_enabled(flags, PARALLEL) && (deadline == nullptr)) {
+                u32 stop_at = 0;
 
-        static inline bool add_score(const brand_enum p_brand, const brand_enum extra_brand, u8 score) noexcept {
-            last_detected_brand = p_brand;
-            last_detected_score = score; // Store for the engine to read
+                // the cached results count towards the threshold as well
+                if (shortcut) {
+                    u32 cached_points = 0;
 
-            brand_score_t brand_score = brand_scoreboard[static_cast<u8>(p_brand)].score;
+                    for (u8 i = technique_begin; i < technique_end; ++i) {
+                        if (core::is_enabled(flags, i) && memo::is_cached(i)) {
+                            const memo::data_t data = memo::cache_fetch(i);
+                            if (data.result) {
+                                cached_points += data.points;
+                            }
+                        }
+                    }
 
-            brand_scoreboard[static_cast<u8>(p_brand)] = { p_brand, ++brand_score };
+                    // the verdict is already decided, so there's nothing to run ahead of time
+                    stop_at = (cached_points >= threshold_points) ? 0 : (threshold_points - cached_points);
+                }
 
-            if (extra_brand != brand_enum::NULL_BRAND) {
-                brand_scoreboard[static_cast<u8>(extra_brand)] = { extra_brand, ++brand_score };
+                if (!shortcut || stop_at != 0) {
+                    slots = run_parallel(flags, order, stop_at);
+                }
             }
 
-            return true;
-        }
+            // upper bound of the points that can still be gained, and 
+            // the number of techniques that haven't been evaluated yet
+            u32 remaining_points = 0;
+            u16 remaining_count = 0;
 
-        // assert if the flag is enabled, far better expression than typing std::bitset member functions
-        [[nodiscard]] static inline bool is_disabled(const flagset& flags, const u8 flag_bit) noexcept {
-            if (flag_bit >= flags.size()) return true;
-            return !flags.test(flag_bit);
-        }
+            for (u8 i = technique_begin; i < technique_end; ++i) {
+                const enum_flags technique_macro = static_cast<enum_flags>(i);
 
-        // same as above but for checking enabled flags
-        [[nodiscard]] static inline bool is_enabled(const flagset& flags, const u8 flag_bit) noexcept {
-            if (flag_bit >= flags.size()) return false;
-            return flags.test(flag_bit);
-        }
+                if (
+                    (technique_table()[i].run != nullptr) &&
+                    (core::is_enabled(flags, technique_macro)) &&
+                    (!memo::is_cached(technique_macro))
+                ) {
+                    remaining_points += max_points(technique_macro);
+                    remaining_count++;
+                }
+            }
 
-        [[nodiscard]] static bool are_techniques_empty(const flagset& flags) {
-            for (std::size_t i = technique_begin; i < technique_end; i++) {
-                if (flags.test(i)) {
-                    return false;
+            for (const auto& technique : ctx.custom_table) {
+                if (!memo::is_cached(technique.id)) {
+                    remaining_points += technique.points;
+                    remaining_count++;
                 }
             }
 
-            return true;
-        }
+            // the deadline runner has to be fed in the exact order of the loops below
+            size_t deadline_index = 0;
 
-        [[nodiscard]] static bool is_setting_flag_set(const flagset& flags) {
-            for (std::size_t i = settings_begin; i < settings_end; i++) {
-                if (flags.test(i)) {
-                    return true;
+            if (deadline != nullptr) {
+                for (const u8 i : order) {
+                    const enum_flags technique_macro = static_cast<enum_flags>(i);
+
+                    if (
+                        (technique_table()[i].run != nullptr) &&
+                        (core::is_enabled(flags, technique_macro)) &&
+                        (!memo::is_cached(technique_macro))
+                    ) {
+                        deadline->push(technique_table()[i].run, i, !is_parallel_safe(technique_macro));
+                    }
                 }
+
+                for (const auto& technique : ctx.custom_table) {
+                    if (!memo::is_cached(technique.id)) {
+                        deadline->push(technique.run, technique.id, false);
+                    }
+                }
+
+                deadline->start();
             }
 
-            return false;
-        }
+            ctx.skipped_count_num = 0;
 
-        // run every VM detection mechanism in the technique table
-        static u16 run_all(const flagset& flags, const bool shortcut = false) {
-            u16 points = 0;
+            // either way the verdict is decided, so whatever is left is skipped
+            auto finish = [&]() -> u16 {
+                ctx.skipped_count_num = remaining_count;
 
-            u16 threshold_points = threshold_score;
+                if (keep_costs) {
+                    memo::technique_cost::save();
+                }
 
-            // set it to 300 if high threshold is enabled
-            if (core::is_enabled(flags, HIGH_THRESHOLD)) {
-                threshold_points = high_threshold_score;
-            }
+                if (persistent) {
+                    memo::persistent::save(flags);
+                }
+
+                return points;
+            };
+
+            auto is_unreachable = [&]() -> bool {
+                return (bound && (points + remaining_points < threshold_points));
+            };
 
-            for (size_t i = technique_begin; i < technique_end; ++i) {
+            for (const u8 i : order) {
                 const enum_flags technique_macro = static_cast<enum_flags>(i);
-                const technique& technique_data = technique_table[i];
+                const technique& technique_data = technique_table()[i];
 
                 // skip empty entries
                 if (!technique_data.run) continue;
@@ -12194,28 +15348,40 @@ public:
                     continue;
                 }
 
-                // reset the last detected brand before running
-                last_detected_brand = brand_enum::NULL_BRAND;
-                last_detected_score = 0;
+                if (is_unreachable()) {
+                    debug("run_all: threshold is unreachable, skipping ", remaining_count, " techniques");
+                    return finish();
+                }
+
+                remaining_points -= max_points(technique_macro);
+                remaining_count--;
 
-                // run the technique
-                const bool result = technique_data.run();
+                // run the technique, or take the result from the parallel executor
+                memo::data_t data{};
 
-                if (result) {
-                    // determine which points to use: Override or Default
-                    const u8 points_to_add = (last_detected_score > 0) ? last_detected_score : technique_data.points;
+                if (deadline != nullptr) {
+                    const parallel_slot* slot = deadline->wait(deadline_index++);
 
-                    points += points_to_add;
-                    // this is specific to VM::detected_count() which 
-                    // returns the number of techniques that found a VM.
-                    detected_count_num++;
+                    if (slot == nullptr) {
+                        debug("run_all: deadline exceeded, abandoning ", remaining_count + 1, " techniques");
+                        remaining_count++;
+                        return finish();
+                    }
 
-                    // retrieve the brand that was set during execution (if any)
-                    const enum brand_enum detected_brand = (last_detected_brand != brand_enum::NULL_BRAND) ? last_detected_brand : brand_enum::NULL_BRAND;
-                    // store the current technique result to the cache
-                    memo::cache_store(technique_macro, result, points_to_add, detected_brand);
+                    data = commit(technique_macro, *slot, technique_data.points, slot->claimed);
+                } else if (!slots.empty() && slots[i].ran) {
+                    data = commit(technique_macro, slots[i], technique_data.points, false);
+                } else if (memo::claim(technique_macro)) {
+                    parallel_slot slot;
+                    execute(slot, technique_data.run, technique_macro, adaptive);
+                    data = commit(technique_macro, slot, technique_data.points, true);
                 } else {
-                    memo::cache_store(technique_macro, false, 0);
+                    // another thread has published the result while this one was waiting
+                    data = memo::cache_fetch(technique_macro);
+                }
+
+                if (data.result) {
+                    points += data.points;
                 }
 
                 // for things like VM::detect() and VM::percentage(),
@@ -12227,13 +15393,13 @@ public:
                     (shortcut) &&
                     (points >= threshold_points)
                 ) {
-                    return points;
+                    return finish();
                 }
             }
 
             // for custom VM techniques, won't be used most of the time
-            if (!core::custom_table.empty()) {
-                for (const auto& technique : core::custom_table) {
+            if (!ctx.custom_table.empty()) {
+                for (const auto& technique : ctx.custom_table) {
 
                     // if cached, return that result
                     if (memo::is_cached(technique.id)) {
@@ -12245,25 +15411,228 @@ public:
                         continue;
                     }
 
+                    if (is_unreachable()) {
+                        debug("run_all: threshold is unreachable, skipping ", remaining_count, " custom techniques");
+                        return finish();
+                    }
+
+                    remaining_points -= technique.points;
+                    remaining_count--;
+
                     // run the custom technique
-                    const bool result = technique.run();
+                    memo::data_t data{};
+
+                    if (deadline != nullptr) {
+                        const parallel_slot* slot = deadline->wait(deadline_index++);
 
-                    // accumulate a few important values
-                    if (result) {
-                        points += technique.points;
-                        detected_count_num++;
+                        if (slot == nullptr) {
+                            remaining_count++;
+                            return finish();
+                        }
+
+                        data = commit(technique.id, *slot, technique.points, slot->claimed);
+                    } else if (memo::claim(technique.id)) {
+                        parallel_slot slot;
+                        execute(slot, technique.run);
+                        data = commit(technique.id, slot, technique.points, true);
+                    } else {
+                        data = memo::cache_fetch(technique.id);
                     }
 
-                    // cache the result
-                    memo::cache_store(
-                        technique.id,
-                        result,
-                        technique.points
-                    );
+                    if (data.result) {
+                        points += data.points;
+                    }
+                }
+            }
+
+            return finish();
+        }
+
+
+        // run a function on a background thread and hand the result back through a future. 
+        // Unlike std::async, dropping the returned future never blocks the caller, the 
+        // thread is owned by the thread registry instead (see core::thread_registry). 
+        // If no thread can be created, the function is run on the calling thread
+        template <typename T, typename F>
+        static void fulfil(std::promise<T>& promise, F& function) {
+            promise.set_value(function());
+        }
+
+        template <typename F>
+        static void fulfil(std::promise<void>& promise, F& function) {
+            function();
+            promise.set_value();
+        }
+
+        template <typename T, typename F>
+        static std::future<T> spawn(F function) {
+            const std::shared_ptr<std::promise<T>> promise = std::make_shared<std::promise<T>>();
+            std::future<T> future = promise->get_future();
+
+            auto task = [promise, function]() mutable {
+                try {
+                    fulfil(*promise, function);
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            };
+
+            // the worker evaluates whichever context the caller is bound to
+            if (!background_threads().start(task, active_context)) {
+                task();
+            }
+
+            return future;
+        }
+
+        [[nodiscard]] static u16 get_threshold(const flagset& flags) noexcept {
+            // set to 300 if high threshold is enabled
+            if (core::is_enabled(flags, HIGH_THRESHOLD)) {
+                return high_threshold_score;
+            }
+
+            return threshold_score;
+        }
+
+        [[nodiscard]] static u8 points_to_percentage(const flagset& flags, const u16 points) noexcept {
+            // the percentage will be set to 99%, because a score 
+            // of 100 is not entirely robust. 150 is more robust
+            // in my opinion, which is why you need a score of
+            // above 150 to get to 100% 
+            if (points >= get_threshold(flags)) {
+                return 100;
+            } else if (points >= 100) {
+                return 99;
+            }
+
+            return static_cast<u8>(std::min<u16>(points, 99));
+        }
+
+        // every technique that's enabled but hasn't been evaluated
+        // will have no cache entry after the run has finished
+        static partial_result make_partial_result(const flagset& flags, const u16 points, const bool timed_out) {
+            partial_result result{};
+
+            result.points = points;
+            result.is_vm = (points >= get_threshold(flags));
+            result.percentage = points_to_percentage(flags, points);
+            result.timed_out = timed_out;
+
+            for (u8 i = technique_begin; i < technique_end; ++i) {
+                const enum_flags technique_macro = static_cast<enum_flags>(i);
+
+                if (
+                    (technique_table()[i].run != nullptr) &&
+                    (core::is_enabled(flags, technique_macro)) &&
+                    (!memo::is_cached(technique_macro))
+                ) {
+                    result.unevaluated.push_back(technique_macro);
+                }
+            }
+
+            return result;
+        }
+
+        // the conclusion message for an already computed percentage, specific to VM::conclusion() and VM::vmaware
+        static std::string conclusion_message(const flagset& flags, const u8 percent_tmp) {
+            const bool has_hardener = is_hardened();
+        
+            constexpr const char* very_unlikely = "Very unlikely";
+            constexpr const char* unlikely = "Unlikely";
+            constexpr const char* potentially = "Potentially";
+            constexpr const char* might = "Might be";
+            constexpr const char* likely = "Likely";
+            constexpr const char* very_likely = "Very likely";
+            constexpr const char* inside_vm = "Running inside";
+        
+            auto make_conclusion = [&](const char* category) -> std::string {
+                const brand_list_t& list = brands::brand_list(flags);
+
+                const brand_enum first_brand = brands::brand_enum(list);
+
+
+                const char* hardener = "";
+            
+                if (has_hardener) {
+                    hardener = "hardened ";
+                }
+            
+                const char* addition = " a ";
+
+                // this basically just fixes the grammatical syntax
+                // by either having "a" or "an" before the VM brand
+                // name. It would look weird if the conclusion 
+                // message was "an VirtualBox" or "a Anubis", so this
+                // condition fixes that issue.
+                if (
+                    !has_hardener && (
+                        (first_brand == brand_enum::ACRN) ||
+                        (first_brand == brand_enum::ANUBIS) ||
+                        (first_brand == brand_enum::BSD_VMM) ||
+                        (first_brand == brand_enum::INTEL_HAXM) ||
+                        (first_brand == brand_enum::APPLE_VZ) ||
+                        (first_brand == brand_enum::INTEL_KGT) ||
+                        (first_brand == brand_enum::POWERVM) ||
+                        (first_brand == brand_enum::OPENSTACK) ||
+                        (first_brand == brand_enum::AWS_NITRO) ||
+                        (first_brand == brand_enum::OPENVZ) ||
+                        (first_brand == brand_enum::INTEL_TDX) ||
+                        (first_brand == brand_enum::AMD_SEV) ||
+                        (first_brand == brand_enum::AMD_SEV_ES) ||
+                        (first_brand == brand_enum::AMD_SEV_SNP) ||
+                        (first_brand == brand_enum::NSJAIL) ||
+                        (first_brand == brand_enum::NULL_BRAND)
+                    )
+                ) {
+                    addition = " an ";
                 }
+
+                std::string brand_str = "";
+
+                // this is basically just to remove the capital "U", 
+                // since it doesn't make sense to see "an Unknown"
+                if (first_brand == brand_enum::NULL_BRAND) {
+                    brand_str = "unknown";
+                } else {
+                    if (core::is_enabled(flags, MULTIPLE)) {
+                        brand_str = brands::brand_multiple(list);
+                    } else {
+                        brand_str = brands::brand_enum_to_string(first_brand);
+                    }
+                }
+
+                const std::string result = 
+                    std::string(category) + 
+                    addition + 
+                    hardener + 
+                    brand_str + 
+                    // Hyper-V artifacts are an exception due to how unique the circumstance is
+                    (first_brand == brand_enum::HYPERV_ROOT ? "" : " VM");
+
+                memo::conclusion::store(result.c_str());
+
+                return result;
+            };
+
+            if (has_hardener) {
+                return make_conclusion(inside_vm);
+            }
+
+            if (core::is_enabled(flags, DYNAMIC)) {
+                if (percent_tmp == 0) { return "Running on baremetal"; }
+                else if (percent_tmp <= 20) { return make_conclusion(very_unlikely); }
+                else if (percent_tmp <= 35) { return make_conclusion(unlikely); }
+                else if (percent_tmp < 50) { return make_conclusion(potentially); }
+                else if (percent_tmp <= 62) { return make_conclusion(might); }
+                else if (percent_tmp <= 75) { return make_conclusion(likely); }
+                else if (percent_tmp < 100) { return make_conclusion(very_likely); }
+            }
+
+            if (percent_tmp == 100) {
+                return make_conclusion(inside_vm);
             }
 
-            return points;
+            return "Running on baremetal";
         }
 
 
@@ -12287,8 +15656,16 @@ public:
     
     // this is public but only for advanced use cases. It's intentionally undocumented.
     public: 
-        static flagset flag_collector;
-        static flagset disabled_flag_collector;
+        // the collector is per thread, so concurrent calls never see each other's arguments. 
+        // Disabled techniques belong to the context, so VM::DISABLE() applies to every thread 
+        // of the static API while a VM::session keeps its own set
+        static thread_local flagset flag_collector;
+        static std::mutex disabled_mutex; // guards context::disabled
+
+        static flagset fetch_disabled() {
+            std::lock_guard<std::mutex> guard(disabled_mutex);
+            return current().disabled;
+        }
     
         static void generate_default(flagset& flags) {
             // set all bits to 1
@@ -12304,6 +15681,9 @@ public:
             flags.flip(NULL_ARG);
             flags.flip(DYNAMIC);
             flags.flip(MULTIPLE);
+            flags.flip(PARALLEL);
+            flags.flip(ADAPTIVE);
+            flags.flip(PERSISTENT);
             flags.flip(ALL);
         }
 
@@ -12323,9 +15703,11 @@ public:
         }
 
         static void reset_disabled_flagset() {
-            disabled_flag_collector.reset();
+            std::lock_guard<std::mutex> guard(disabled_mutex);
+            flagset& disabled = current().disabled;
+            disabled.reset();
             for (const auto technique : disabled_techniques) {
-                disabled_flag_collector.set(static_cast<u32>(technique), true);
+                disabled.set(static_cast<u32>(technique), true);
             }
         }
 
@@ -12390,8 +15772,10 @@ public:
             }
 
             // if flag is disabled, remove it from the flag_collector
+            const flagset disabled = fetch_disabled();
+
             for (u8 i = 0; i < enum_size + 1; i++) {
-                if (disabled_flag_collector.test(i)) {
+                if (disabled.test(i)) {
                     flag_collector.set(i, false);
                 }
             }
@@ -12410,16 +15794,21 @@ public:
                 throw std::invalid_argument("VM::DISABLE() must contain a flag");
             }
 
+            flagset disabled;
+
             // C++ trick to loop over the variadic arguments one by one
             int dummy[] = { 
-                (disabled_flag_collector.set(args, true), 0)...
+                (disabled.set(args, true), 0)...
             };
             VMAWARE_UNUSED(dummy);
 
             // check if a settings flag is set, which is not valid
-            if (core::is_setting_flag_set(disabled_flag_collector)) {
+            if (core::is_setting_flag_set(disabled)) {
                 throw std::invalid_argument("VM::DISABLE() must not contain a settings flag, they are disabled by default anyway");
             }
+
+            std::lock_guard<std::mutex> guard(disabled_mutex);
+            current().disabled |= disabled;
         }
     };
 
@@ -12459,7 +15848,10 @@ public: // START OF PUBLIC FUNCTIONS
         if (
             (flag_bit == HIGH_THRESHOLD) ||
             (flag_bit == DYNAMIC) ||
-            (flag_bit == MULTIPLE)
+            (flag_bit == MULTIPLE) ||
+            (flag_bit == PARALLEL) ||
+            (flag_bit == ADAPTIVE) ||
+            (flag_bit == PERSISTENT)
         ) {
             throw_error("Flag argument must be a technique flag and not a settings flag");
         }
@@ -12475,22 +15867,17 @@ public: // START OF PUBLIC FUNCTIONS
         }
 
         if (flag_bit < technique_end) {
-            const core::technique& pair = core::technique_table[flag_bit];
+            const core::technique& pair = core::technique_table()[flag_bit];
 
             if (auto run_fn = pair.run) {
-                core::last_detected_brand = brand_enum::NULL_BRAND;
-                core::last_detected_score = 0;
-
-                const bool result = run_fn();
-
-                const u8 points_to_add = (core::last_detected_score > 0) ? core::last_detected_score : pair.points;
-
-                if (result) {
-                    detected_count_num++;
+                // if another thread got here first, wait for its result instead of running it twice
+                if (!memo::claim(flag_bit)) {
+                    return memo::cache_fetch(flag_bit).result;
                 }
 
-                memo::cache_store(flag_bit, result, result ? points_to_add : 0, core::last_detected_brand);
-                return result;
+                core::parallel_slot slot;
+                core::execute(slot, run_fn);
+                return core::commit(flag_bit, slot, pair.points, true).result;
             }
             else {
                 throw_error("Flag is not known or not implemented");
@@ -12541,9 +15928,9 @@ public: // START OF PUBLIC FUNCTIONS
     }
 
     static bool detect(const flagset &flags = core::generate_default()) {
-        // run all the techniques based on the 
-        // flags above, and get a total score 
-        const u16 points = core::run_all(flags, SHORTCUT);
+        // run all the techniques based on the flags above, and get a 
+        // total score. The run stops as soon as the verdict is decided 
+        const u16 points = core::run_all(flags, SHORTCUT, true);
 
         u16 threshold = threshold_score;
 
@@ -12557,53 +15944,183 @@ public: // START OF PUBLIC FUNCTIONS
             return true;
         }
 
-        // this is added as a last ditch attempt to detect a VM, 
-        // because if there are indications of hardening then logically 
-        // it should in fact be a VM.
-        return (is_hardened());
+        // this is added as a last ditch attempt to detect a VM, 
+        // because if there are indications of hardening then logically 
+        // it should in fact be a VM.
+        return (is_hardened());
+    }
+
+
+    /**
+     * @brief Detect if running inside a VM with only the techniques given as template arguments
+     * @param technique flags only, as template arguments (e.g. VM::detect<VM::VMID, VM::HYPERVISOR_BIT>()), 
+     *        then VM::HIGH_THRESHOLD or nothing as the function argument
+     * @return bool
+     * @note The technique list is resolved at compile time and the global technique table 
+     *       is never touched, so every technique that wasn't selected can be dropped from 
+     *       the binary if the rest of the static API isn't used. Techniques that aren't 
+     *       implemented for the platform count as not detected.
+     * @link https://github.com/kernelwernel/VMAware/blob/main/docs/documentation.md#vmdetect-with-template-arguments
+     */
+    template <enum_flags first, enum_flags... rest, typename ...Args>
+    static bool detect(Args ...settings) {
+        static_assert(core::are_techniques<first, rest...>::value, "VM::detect<...>() only accepts technique flags as template arguments, VM::HIGH_THRESHOLD goes in the function arguments");
+
+        static constexpr enum_flags ids[] = { first, rest... };
+        static constexpr core::technique selected[] = { core::find_technique(first), core::find_technique(rest)... };
+
+        const u16 threshold = (core::template_settings(settings...) ? high_threshold_score : threshold_score);
+        u16 points = 0;
+
+        for (size_t i = 0; i < (sizeof...(rest) + 1); i++) {
+            if (selected[i].run == nullptr) {
+                continue;
+            }
+
+            memo::data_t data;
+
+            // a result that's already cached counts the same as one that runs here
+            if (memo::claim(ids[i])) {
+                core::parallel_slot slot;
+                core::execute(slot, selected[i].run);
+                data = core::commit(ids[i], slot, selected[i].points, true);
+            } else {
+                data = memo::cache_fetch(ids[i]);
+            }
+
+            if (data.result) {
+                points += data.points;
+            }
+
+            if (points >= threshold) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    /**
+     * @brief Get the percentage of how likely it's a VM
+     * @param any flag combination in VM structure or nothing
+     * @return std::uint8_t
+     * @link https://github.com/kernelwernel/VMAware/blob/main/docs/documentation.md#vmpercentage
+     */
+    template <typename ...Args>
+    static u8 percentage(Args ...args) {
+        // fetch all the flags in a std::bitset
+        const flagset flags = core::arg_handler(args...);
+        return percentage(flags);
+    }
+
+
+    static u8 percentage(const flagset &flags = core::generate_default()) {
+        // run all the techniques based on the 
+        // flags above, and get a total score
+        const u16 points = core::run_all(flags, SHORTCUT);
+
+        return core::points_to_percentage(flags, points);
+    }
+
+
+
+    /**
+     * @brief Detect if running inside a VM, but only with the techniques that finish within the time budget
+     * @param time budget, then any flag combination in VM structure or nothing
+     * @return VM::partial_result
+     * @link https://github.com/kernelwernel/VMAware/blob/main/docs/documentation.md#vmdetect_within
+     */
+    template <typename ...Args>
+    static partial_result detect_within(const std::chrono::microseconds budget, Args ...args) {
+        const flagset flags = core::arg_handler(args...);
+        return detect_within(budget, flags);
+    }
+
+    static partial_result detect_within(const std::chrono::microseconds budget, const flagset& flags = core::generate_default()) {
+        core::deadline_runner runner(budget);
+        const u16 points = core::run_all(flags, SHORTCUT, true, &runner);
+        return core::make_partial_result(flags, points, runner.timed_out);
+    }
+
+
+    /**
+     * @brief Get the percentage of how likely it's a VM, but only with the techniques that finish within the time budget
+     * @param time budget, then any flag combination in VM structure or nothing
+     * @return VM::partial_result
+     * @link https://github.com/kernelwernel/VMAware/blob/main/docs/documentation.md#vmpercentage_within
+     */
+    template <typename ...Args>
+    static partial_result percentage_within(const std::chrono::microseconds budget, Args ...args) {
+        const flagset flags = core::arg_handler(args...);
+        return percentage_within(budget, flags);
+    }
+
+    static partial_result percentage_within(const std::chrono::microseconds budget, const flagset& flags = core::generate_default()) {
+        core::deadline_runner runner(budget);
+        const u16 points = core::run_all(flags, SHORTCUT, false, &runner);
+        return core::make_partial_result(flags, points, runner.timed_out);
     }
 
 
     /**
-     * @brief Get the percentage of how likely it's a VM
+     * @brief Start running all the techniques in the background, so later calls are served from the cache
      * @param any flag combination in VM structure or nothing
-     * @return std::uint8_t
-     * @link https://github.com/kernelwernel/VMAware/blob/main/docs/documentation.md#vmpercentage
+     * @return std::shared_future<void>, which is ready once everything has been evaluated
+     * @link https://github.com/kernelwernel/VMAware/blob/main/docs/documentation.md#vmprewarm
      */
     template <typename ...Args>
-    static u8 percentage(Args ...args) {
-        // fetch all the flags in a std::bitset
+    static std::shared_future<void> prewarm(Args ...args) {
         const flagset flags = core::arg_handler(args...);
-        return percentage(flags);
+        return prewarm(flags);
     }
 
+    static std::shared_future<void> prewarm(const flagset& flags = core::generate_default()) {
+        // calls made while this is still running won't evaluate the same techniques 
+        // twice, they either wait for the technique that's in flight to be published 
+        // (see memo::claim()) or run whatever hasn't started yet
+        return core::spawn<void>([flags]() {
+            brands::brand_list(flags);
+            is_hardened();
+        }).share();
+    }
 
-    static u8 percentage(const flagset &flags = core::generate_default()) {
-        // run all the techniques based on the 
-        // flags above, and get a total score
-        const u16 points = core::run_all(flags, SHORTCUT);
 
-        u8 percent = 0;
-        u16 threshold = threshold_score;
+    /**
+     * @brief Same as VM::detect(), but runs in the background
+     * @param any flag combination in VM structure or nothing
+     * @return std::future<bool>
+     * @link https://github.com/kernelwernel/VMAware/blob/main/docs/documentation.md#vmdetect_async-and-vmbrand_async
+     */
+    template <typename ...Args>
+    static std::future<bool> detect_async(Args ...args) {
+        const flagset flags = core::arg_handler(args...);
+        return detect_async(flags);
+    }
 
-        // set to 300 if high threshold is enabled
-        if (core::is_enabled(flags, HIGH_THRESHOLD)) {
-            threshold = high_threshold_score;
-        }
+    static std::future<bool> detect_async(const flagset& flags = core::generate_default()) {
+        return core::spawn<bool>([flags]() -> bool {
+            return detect(flags);
+        });
+    }
 
-        // the percentage will be set to 99%, because a score 
-        // of 100 is not entirely robust. 150 is more robust
-        // in my opinion, which is why you need a score of
-        // above 150 to get to 100% 
-        if (points >= threshold) {
-            percent = 100;
-        } else if (points >= 100) {
-            percent = 99;
-        } else {
-            percent = static_cast<u8>(std::min<u16>(points, 99));
-        }
 
-        return percent;
+    /**
+     * @brief Same as VM::brand(), but runs in the background
+     * @param any flag combination in VM structure or nothing (VM::MULTIPLE can be added)
+     * @return std::future<std::string>
+     * @link https://github.com/kernelwernel/VMAware/blob/main/docs/documentation.md#vmdetect_async-and-vmbrand_async
+     */
+    template <typename ...Args>
+    static std::future<std::string> brand_async(Args ...args) {
+        const flagset flags = core::arg_handler(args...);
+        return brand_async(flags);
+    }
+
+    static std::future<std::string> brand_async(const flagset& flags = core::generate_default()) {
+        return core::spawn<std::string>([flags]() -> std::string {
+            return brand(flags);
+        });
     }
 
 
@@ -12638,7 +16155,9 @@ public: // START OF PUBLIC FUNCTIONS
         [[assume(percent > 0 && percent <= 100)]];
     #endif
 
-        size_t current_index = core::custom_table.size();
+        core::context& ctx = core::current();
+
+        size_t current_index = ctx.custom_table.size();
 
         core::custom_technique query{
             percent,
@@ -12646,15 +16165,21 @@ public: // START OF PUBLIC FUNCTIONS
             detection_func
         };
 
-        technique_count++;
+        ctx.custom_table.push_back(query);
 
-        core::custom_table.push_back(query);
+        ctx.technique_count++;
+
+        // the public counter mirrors the global state only
+        if (&ctx == &core::global_context) {
+            technique_count = ctx.technique_count;
+        }
     }
 
 
     /**
      * @brief disable the provided technique flags so they are not counted to the overall result
      * @param technique flag(s) only
+     * @note This applies to the static API. A VM::session has its own DISABLE() member
      * @link https://github.com/kernelwernel/VMAware/blob/main/docs/documentation.md#vmdetect
      * @return flagset
      */
@@ -12766,6 +16291,9 @@ public: // START OF PUBLIC FUNCTIONS
             case HIGH_THRESHOLD: return "HIGH_THRESHOLD"; 
             case DYNAMIC: return "DYNAMIC"; 
             case MULTIPLE: return "MULTIPLE"; 
+            case PARALLEL: return "PARALLEL"; 
+            case ADAPTIVE: return "ADAPTIVE"; 
+            case PERSISTENT: return "PERSISTENT"; 
             default: return "Unknown flag";
         }
     }
@@ -12838,7 +16366,7 @@ public: // START OF PUBLIC FUNCTIONS
             throw_error("The flag is not a technique flag");
         }
 
-        core::technique_table[flag].points = percent;
+        core::technique_table()[flag].points = percent;
     }
 
     /**
@@ -12857,7 +16385,150 @@ public: // START OF PUBLIC FUNCTIONS
         // run all the techniques, which will set the detected_count variable 
         core::run_all(flags);
 
-        return detected_count_num;
+        return core::current().detected_count_num;
+    }
+
+
+    /**
+     * @brief Fetch the number of techniques that the last VM::detect() call skipped because the verdict was already decided
+     * @return std::uint16_t
+     * @link https://github.com/kernelwernel/VMAware/blob/main/docs/documentation.md#vmskipped_count
+     */
+    static u16 skipped_count() noexcept {
+        return core::current().skipped_count_num;
+    }
+
+
+    /**
+     * @brief Re-evaluate only the techniques whose inputs changed since they last ran
+     * @param any flag combination in VM structure or nothing
+     * @return std::uint16_t, the number of techniques that were evaluated again
+     * @note Every technique records the files it read or checked and whether it used cpuid. 
+     *       A rescan compares those against their current state (file metadata, or the contents 
+     *       for procfs and sysfs) and the current cpuid identity leaves, then patches the cache 
+     *       and the brand scoreboard in place. Techniques that didn't record any input, and 
+     *       results loaded through VM::PERSISTENT, are kept as they are.
+     * @link https://github.com/kernelwernel/VMAware/blob/main/docs/documentation.md#vmrescan
+     */
+    template <typename ...Args>
+    static u16 rescan(Args ...args) {
+        const flagset flags = core::arg_handler(args...);
+        return rescan(flags);
+    }
+
+    static u16 rescan(const flagset& flags = core::generate_default()) {
+        core::context& ctx = core::current();
+
+        std::vector<u16> order;
+        std::vector<core::evidence> evidence;
+        u64 previous_fingerprint = 0;
+
+        {
+            std::lock_guard<std::mutex> guard(memo::mutex);
+            order = ctx.commit_order;
+            previous_fingerprint = ctx.cpuid_fingerprint;
+
+            for (const u16 id : order) {
+                evidence.push_back(ctx.evidence_table[id]);
+            }
+        }
+
+        // only worked out if a technique actually depends on it
+        u64 fingerprint = 0;
+
+        std::vector<u16> stale;
+
+        for (size_t i = 0; i < order.size(); i++) {
+            const core::evidence& e = evidence[i];
+            bool changed = false;
+
+            if (e.uses_cpuid) {
+                if (fingerprint == 0) {
+                    fingerprint = core::cpuid_fingerprint();
+                }
+                changed = (fingerprint != previous_fingerprint);
+            }
+
+            for (size_t j = 0; !changed && j < e.inputs.size(); j++) {
+                changed = core::input_changed(e.inputs[j]);
+            }
+
+            if (changed) {
+                debug("VM::rescan(): inputs of ", order[i], " changed");
+                stale.push_back(order[i]);
+            }
+        }
+
+        if (stale.empty()) {
+            return 0;
+        }
+
+        // drop the stale results, their brand hits will be gone once the scoreboard is rebuilt
+        {
+            std::lock_guard<std::mutex> guard(memo::mutex);
+
+            for (const u16 id : stale) {
+                memo::cache_entry& entry = ctx.cache_table[id];
+                entry.has_value.store(false, std::memory_order_release);
+                entry.brand_name = brand_enum::NULL_BRAND;
+                ctx.evidence_table[id] = {};
+                ctx.commit_order.erase(std::remove(ctx.commit_order.begin(), ctx.commit_order.end(), id), ctx.commit_order.end());
+            }
+
+            if (fingerprint != 0) {
+                ctx.cpuid_fingerprint = fingerprint;
+            }
+        }
+
+        // the techniques that run again should see the leaves as they are now
+        if (fingerprint != 0 && fingerprint != previous_fingerprint) {
+            memo::cpuid_snapshot::invalidate();
+        }
+
+    #if (LINUX)
+        util::sys_snapshot::invalidate();
+        util::kernel_log::invalidate();
+        util::smbios::invalidate();
+        util::process_table::invalidate();
+    #endif
+
+        u16 count = 0;
+
+        for (const u16 id : stale) {
+            bool(*run)() = nullptr;
+            u8 points = 0;
+
+            if (id < technique_end) {
+                if (core::is_disabled(flags, static_cast<u8>(id))) {
+                    continue;
+                }
+                run = core::technique_table()[id].run;
+                points = core::technique_table()[id].points;
+            } else {
+                for (const auto& technique : ctx.custom_table) {
+                    if (technique.id == id) {
+                        run = technique.run;
+                        points = technique.points;
+                    }
+                }
+            }
+
+            if (run == nullptr || !memo::claim(id)) {
+                continue;
+            }
+
+            core::parallel_slot slot;
+            core::execute(slot, run);
+            core::commit(id, slot, points, true);
+            count++;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(memo::mutex);
+            core::rebuild_scoreboard(ctx);
+        }
+
+        return count;
     }
 
 
@@ -12976,109 +16647,11 @@ public: // START OF PUBLIC FUNCTIONS
 
 
     static std::string conclusion(const flagset &flags = core::generate_default()) {
-        if (memo::conclusion::cached) {
+        if (memo::conclusion::is_cached()) {
             return memo::conclusion::fetch();
         }
 
-        const u8 percent_tmp = percentage(flags);
-        const bool has_hardener = is_hardened();
-        
-        constexpr const char* very_unlikely = "Very unlikely";
-        constexpr const char* unlikely = "Unlikely";
-        constexpr const char* potentially = "Potentially";
-        constexpr const char* might = "Might be";
-        constexpr const char* likely = "Likely";
-        constexpr const char* very_likely = "Very likely";
-        constexpr const char* inside_vm = "Running inside";
-        
-        auto make_conclusion = [&](const char* category) -> std::string {
-            const brand_list_t& list = brands::brand_list(flags);
-
-            const brand_enum first_brand = brands::brand_enum(list);
-
-
-            const char* hardener = "";
-            
-            if (has_hardener) {
-                hardener = "hardened ";
-            }
-            
-            const char* addition = " a ";
-
-            // this basically just fixes the grammatical syntax
-            // by either having "a" or "an" before the VM brand
-            // name. It would look weird if the conclusion 
-            // message was "an VirtualBox" or "a Anubis", so this
-            // condition fixes that issue.
-            if (
-                !has_hardener && (
-                    (first_brand == brand_enum::ACRN) ||
-                    (first_brand == brand_enum::ANUBIS) ||
-                    (first_brand == brand_enum::BSD_VMM) ||
-                    (first_brand == brand_enum::INTEL_HAXM) ||
-                    (first_brand == brand_enum::APPLE_VZ) ||
-                    (first_brand == brand_enum::INTEL_KGT) ||
-                    (first_brand == brand_enum::POWERVM) ||
-                    (first_brand == brand_enum::OPENSTACK) ||
-                    (first_brand == brand_enum::AWS_NITRO) ||
-                    (first_brand == brand_enum::OPENVZ) ||
-                    (first_brand == brand_enum::INTEL_TDX) ||
-                    (first_brand == brand_enum::AMD_SEV) ||
-                    (first_brand == brand_enum::AMD_SEV_ES) ||
-                    (first_brand == brand_enum::AMD_SEV_SNP) ||
-                    (first_brand == brand_enum::NSJAIL) ||
-                    (first_brand == brand_enum::NULL_BRAND)
-                )
-            ) {
-                addition = " an ";
-            }
-
-            std::string brand_str = "";
-
-            // this is basically just to remove the capital "U", 
-            // since it doesn't make sense to see "an Unknown"
-            if (first_brand == brand_enum::NULL_BRAND) {
-                brand_str = "unknown";
-            } else {
-                if (core::is_enabled(flags, MULTIPLE)) {
-                    brand_str = brands::brand_multiple(flags);
-                } else {
-                    brand_str = brands::brand_enum_to_string(first_brand);
-                }
-            }
-
-            const std::string result = 
-                std::string(category) + 
-                addition + 
-                hardener + 
-                brand_str + 
-                // Hyper-V artifacts are an exception due to how unique the circumstance is
-                (first_brand == brand_enum::HYPERV_ROOT ? "" : " VM");
-
-            memo::conclusion::store(result.c_str());
-
-            return result;
-        };
-
-        if (has_hardener) {
-            return make_conclusion(inside_vm);
-        }
-
-        if (core::is_enabled(flags, DYNAMIC)) {
-            if (percent_tmp == 0) { return "Running on baremetal"; }
-            else if (percent_tmp <= 20) { return make_conclusion(very_unlikely); }
-            else if (percent_tmp <= 35) { return make_conclusion(unlikely); }
-            else if (percent_tmp < 50) { return make_conclusion(potentially); }
-            else if (percent_tmp <= 62) { return make_conclusion(might); }
-            else if (percent_tmp <= 75) { return make_conclusion(likely); }
-            else if (percent_tmp < 100) { return make_conclusion(very_likely); }
-        }
-
-        if (percent_tmp == 100) {
-            return make_conclusion(inside_vm);
-        }
-
-        return "Running on baremetal";
+        return core::conclusion_message(flags, percentage(flags));
     }
 
 
@@ -13087,8 +16660,10 @@ public: // START OF PUBLIC FUNCTIONS
      * @return bool
      */
     static bool is_hardened() {
-        if (memo::hardened::cached) {
-            return memo::hardened::result;
+        core::context& ctx = core::current();
+
+        if (ctx.hardened_cached) {
+            return ctx.hardened_result;
         }
 
         auto hardened_logic = []() -> bool {
@@ -13097,10 +16672,7 @@ public: // START OF PUBLIC FUNCTIONS
                 if (!check(flag)) {
                     return brand_enum::NULL_BRAND;
                 }
-                if (memo::cache_table[flag].has_value) {
-                    return memo::cache_table[flag].brand_name;
-                }
-                return brand_enum::NULL_BRAND;
+                return memo::cache_fetch(flag).brand_name;
             };
 
             const bool hv_present = (check(VM::HYPERVISOR_BIT) || check(VM::HYPERVISOR_STR));
@@ -13109,8 +16681,8 @@ public: // START OF PUBLIC FUNCTIONS
                     return false;
                 }
 
-                const brand_enum bit_brand = memo::cache_table[VM::HYPERVISOR_BIT].brand_name;
-                const brand_enum str_brand = memo::cache_table[VM::HYPERVISOR_STR].brand_name;
+                const brand_enum bit_brand = memo::cache_fetch(VM::HYPERVISOR_BIT).brand_name;
+                const brand_enum str_brand = memo::cache_fetch(VM::HYPERVISOR_STR).brand_name;
 
                 return (
                     (bit_brand == brand_enum::HYPERV_ROOT) || 
@@ -13156,8 +16728,8 @@ public: // START OF PUBLIC FUNCTIONS
 
         const bool result = hardened_logic();
 
-        memo::hardened::result = result;
-        memo::hardened::cached = true;
+        ctx.hardened_result = result;
+        ctx.hardened_cached = true;
 
         return result;
     }
@@ -13168,6 +16740,7 @@ public: // START OF PUBLIC FUNCTIONS
         std::string type;
         std::string conclusion;
         bool is_vm;
+        bool is_vm_high_threshold; // the verdict as if VM::HIGH_THRESHOLD was passed, from the same evaluation
         bool is_hardened; 
         u8 percentage;
         u8 detected_count;
@@ -13188,15 +16761,38 @@ public: // START OF PUBLIC FUNCTIONS
 
         // having this design avoids some niche errors
         void initialise(const flagset &flags) {
-            brand = VM::brand(flags);
+            // a single full pass over the techniques, every field below is derived from its 
+            // results instead of each public function walking through the techniques again
+            const u16 points = core::run_all(flags);
+            const brand_list_t list = brands::brand_list(points);
+
+            if (core::is_enabled(flags, MULTIPLE)) {
+                brand = brands::brand_multiple(list);
+            } else {
+                brand = brands::brand_enum_to_string(brands::brand_enum(list));
+            }
+
             type = VM::type(flags);
-            conclusion = VM::conclusion(flags);
-            is_vm = VM::detect(flags);
             is_hardened = VM::is_hardened();
-            percentage = VM::percentage(flags);
-            detected_count = VM::detected_count(flags);
-            technique_count = VM::technique_count;
-            detected_techniques = VM::detected_enums(flags);
+            percentage = core::points_to_percentage(flags, points);
+            is_vm = ((points >= core::get_threshold(flags)) || is_hardened);
+            is_vm_high_threshold = ((points >= high_threshold_score) || is_hardened);
+            conclusion = (memo::conclusion::is_cached() ? memo::conclusion::fetch() : core::conclusion_message(flags, percentage));
+            detected_count = core::current().detected_count_num;
+            technique_count = core::current().technique_count;
+            detected_techniques = [&]() -> std::vector<enum_flags> {
+                std::vector<enum_flags> tmp{};
+
+                for (u8 i = technique_begin; i < technique_end; ++i) {
+                    const enum_flags technique_enum = static_cast<enum_flags>(i);
+
+                    if (flags.test(technique_enum) && memo::cache_fetch(technique_enum).result) {
+                        tmp.push_back(technique_enum);
+                    }
+                }
+
+                return tmp;
+            }();
             detected_technique_strings = [&]() -> std::vector<std::string> {
                 std::vector<std::string> tmp{};
 
@@ -13210,60 +16806,226 @@ public: // START OF PUBLIC FUNCTIONS
         }
 
     };
+
+
+    /**
+     * @brief An independent detection context with its own technique cache, brand scoreboard and custom techniques
+     * @note The static functions above all share one global state. A session doesn't, so separate 
+     *       sessions (or the same session from multiple threads) can be used concurrently without 
+     *       results leaking between them. Facts about the machine itself like the cpuid leaves, 
+     *       the CPU brand string and the BIOS strings are still shared, since they can't differ.
+     *       The session must outlive any future returned by its async functions.
+     * @link https://github.com/kernelwernel/VMAware/blob/main/docs/documentation.md#vmsession
+     */
+    class session {
+    private:
+        core::context state;
+
+        // binds the session to the calling thread for the duration of a call
+        struct scope {
+            core::context* previous;
+
+            explicit scope(core::context& state) : previous(core::active_context) {
+                core::active_context = &state;
+            }
+
+            ~scope() {
+                core::active_context = previous;
+            }
+
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+        };
+
+    public:
+        session() = default;
+        session(const session&) = delete;
+        session& operator=(const session&) = delete;
+
+        // the background threads still evaluating this session are waited for
+        ~session() {
+            core::background_threads().join(&state);
+        }
+
+        bool check(const enum_flags flag_bit) {
+            scope bound(state);
+            return VM::check(flag_bit);
+        }
+
+        template <typename ...Args>
+        bool detect(Args ...args) {
+            scope bound(state);
+            return VM::detect(args...);
+        }
+
+        template <typename ...Args>
+        u8 percentage(Args ...args) {
+            scope bound(state);
+            return VM::percentage(args...);
+        }
+
+        template <typename ...Args>
+        std::string brand(Args ...args) {
+            scope bound(state);
+            return VM::brand(args...);
+        }
+
+        template <typename ...Args>
+        std::string type(Args ...args) {
+            scope bound(state);
+            return VM::type(args...);
+        }
+
+        template <typename ...Args>
+        std::string conclusion(Args ...args) {
+            scope bound(state);
+            return VM::conclusion(args...);
+        }
+
+        template <typename ...Args>
+        u8 detected_count(Args ...args) {
+            scope bound(state);
+            return VM::detected_count(args...);
+        }
+
+        template <typename ...Args>
+        std::vector<enum_flags> detected_enums(Args ...args) {
+            scope bound(state);
+            return VM::detected_enums(args...);
+        }
+
+        template <typename ...Args>
+        partial_result detect_within(const std::chrono::microseconds budget, Args ...args) {
+            scope bound(state);
+            return VM::detect_within(budget, args...);
+        }
+
+        template <typename ...Args>
+        partial_result percentage_within(const std::chrono::microseconds budget, Args ...args) {
+            scope bound(state);
+            return VM::percentage_within(budget, args...);
+        }
+
+        template <typename ...Args>
+        std::shared_future<void> prewarm(Args ...args) {
+            scope bound(state);
+            return VM::prewarm(args...);
+        }
+
+        template <typename ...Args>
+        std::future<bool> detect_async(Args ...args) {
+            scope bound(state);
+            return VM::detect_async(args...);
+        }
+
+        template <typename ...Args>
+        std::future<std::string> brand_async(Args ...args) {
+            scope bound(state);
+            return VM::brand_async(args...);
+        }
+
+        bool is_hardened() {
+            scope bound(state);
+            return VM::is_hardened();
+        }
+
+        // only for this session, the static API and other sessions keep their own set
+        template <typename ...Args>
+        enum_flags DISABLE(Args ...args) {
+            scope bound(state);
+            return VM::DISABLE(args...);
+        }
+
+        template <typename ...Args>
+        u16 rescan(Args ...args) {
+            scope bound(state);
+            return VM::rescan(args...);
+        }
+
+        // the same aggregate as constructing a VM::vmaware, evaluated in this session
+        template <typename ...Args>
+        VM::vmaware vmaware(Args ...args) {
+            scope bound(state);
+            return VM::vmaware(args...);
+        }
+
+        void add_custom(
+            const u8 percent, 
+            bool(*detection_func)()
+            #if (SOURCE_LOCATION_SUPPORTED)
+            , const std::source_location& loc = std::source_location::current()
+            #endif
+        ) {
+            scope bound(state);
+        #if (SOURCE_LOCATION_SUPPORTED)
+            VM::add_custom(percent, detection_func, loc);
+        #else
+            VM::add_custom(percent, detection_func);
+        #endif
+        }
+
+        u16 skipped_count() noexcept {
+            scope bound(state);
+            return VM::skipped_count();
+        }
+
+        u16 technique_count() const noexcept {
+            return state.technique_count;
+        }
+    };
 };
 
 // ============= EXTERNAL DEFINITIONS =============
 // These are added here due to warnings related to C++17 inline variables for C++ standards that are under 17
 // It's easier to just group them together rather than having C++17<= preprocessors with inline stuff
-char VM::memo::conclusion::cache[512] = { 0 };
-bool VM::memo::conclusion::cached = false;
-
-// scoreboard list of brands, if a VM detection technique detects a brand, that will be incremented here as a single point
-std::array<VM::core::brand_entry, VM::MAX_BRANDS> VM::core::brand_scoreboard = []() {
-    std::array<VM::core::brand_entry, VM::MAX_BRANDS> arr{};
-
-    for (u8 i = 0; i < MAX_BRANDS; i++) {
-        arr[i] = { static_cast<brand_enum>(i), 0 };
-    }
 
-    return arr;
-}();
+// the state used by the static API, every VM::session has its own separate one
+VM::core::context VM::core::global_context;
+thread_local VM::core::context* VM::core::active_context = nullptr;
 
 // initial definitions for cache items because C++ forbids in-class initializations
-std::array<VM::memo::cache_entry, VM::enum_size + 1> VM::memo::cache_table{};
-enum VM::brand_enum VM::memo::single_brand::brand_cache = brand_enum::NULL_BRAND;
-std::string VM::memo::multi_brand::brand_cache = "";
+std::mutex VM::memo::mutex;
+std::condition_variable VM::memo::published;
 char VM::memo::cpu_brand::brand_cache[128] = { 0 };
 char VM::memo::bios_info::manufacturer[256] = { 0 };
 char VM::memo::bios_info::model[128] = { 0 };
-bool VM::memo::single_brand::cached = false;
-bool VM::memo::multi_brand::cached = false;
-bool VM::memo::cpu_brand::cached = false;
-bool VM::memo::bios_info::cached = false;
-bool VM::memo::hyperx::cached = false;
-bool VM::memo::hardened::result = false;
-bool VM::memo::hardened::cached = false;
-VM::u32 VM::memo::threadcount::threadcount_cache = 0;
+std::atomic<bool> VM::memo::cpu_brand::cached{ false };
+std::atomic<bool> VM::memo::bios_info::cached{ false };
+std::atomic<bool> VM::memo::hyperx::cached{ false };
+std::array<std::atomic<VM::u32>, VM::enum_size + 1> VM::memo::technique_cost::table{};
+bool VM::memo::technique_cost::loaded = false;
+bool VM::memo::persistent::attempted = false;
+VM::u16 VM::memo::persistent::published_count = 0;
+std::atomic<bool> VM::memo::technique_cost::dirty{ false };
+std::atomic<VM::u32> VM::memo::threadcount::threadcount_cache{ 0 };
 VM::hyperx_state VM::memo::hyperx::state = VM::HYPERV_UNKNOWN;
-std::array<VM::memo::leaf_entry, VM::memo::leaf_cache::CAPACITY> VM::memo::leaf_cache::table{};
-std::size_t VM::memo::leaf_cache::count = 0;
-std::size_t VM::memo::leaf_cache::next_index = 0;
-VM::brand_list_t VM::memo::brand_list::cache = {};
-bool VM::memo::brand_list::cached = false;
+std::array<std::array<std::atomic<VM::u32>, 4>, VM::memo::cpuid_snapshot::SLOT_COUNT> VM::memo::cpuid_snapshot::slots;
+std::array<std::atomic<VM::u32>, VM::memo::cpuid_snapshot::SLOT_COUNT> VM::memo::cpuid_snapshot::generations;
+std::atomic<VM::u32> VM::memo::cpuid_snapshot::generation(1);
+std::mutex VM::memo::cpuid_snapshot::fill_mutex;
+#if (LINUX)
+std::mutex VM::util::sys_snapshot::mutex;
+std::shared_ptr<const VM::util::sys_snapshot> VM::util::sys_snapshot::cache;
+std::mutex VM::util::kernel_log::mutex;
+std::shared_ptr<const VM::util::kernel_log> VM::util::kernel_log::cache;
+std::mutex VM::util::smbios::mutex;
+std::shared_ptr<const VM::util::smbios> VM::util::smbios::cache;
+std::mutex VM::util::process_table::mutex;
+std::shared_ptr<const VM::util::process_table> VM::util::process_table::cache;
+#endif
 
-enum VM::brand_enum VM::core::last_detected_brand = VM::brand_enum::NULL_BRAND;
-VM::u8 VM::core::last_detected_score = 0;
+thread_local enum VM::brand_enum VM::core::last_detected_brand = VM::brand_enum::NULL_BRAND;
+thread_local VM::u8 VM::core::last_detected_score = 0;
+thread_local VM::core::parallel_slot* VM::core::active_slot = nullptr;
 
 // these are basically the base values for the core::arg_handler function.
 // It's like a bucket that will collect all the bits enabled. If for example 
 // VM::detect(VM::HIGH_THRESHOLD) is passed, the HIGH_THRESHOLD bit will be 
 // collected to this flagset (std::bitset) variable, and eventually be provided
 // as the return value for actual end-user functions like VM::detect() to operate on.
-VM::flagset VM::core::flag_collector;
-VM::flagset VM::core::disabled_flag_collector;
-
+thread_local VM::flagset VM::core::flag_collector;
+std::mutex VM::core::disabled_mutex;
 
-VM::u8 VM::detected_count_num = 0;
 
 std::vector<VM::enum_flags> VM::disabled_techniques = []() {
     std::vector<VM::enum_flags> c;
@@ -13272,131 +17034,13 @@ std::vector<VM::enum_flags> VM::disabled_techniques = []() {
 }();
 
 // this value is incremented each time VM::add_custom is called
-VM::u16 VM::technique_count = base_technique_count;
-
-// this is initialised as empty, because this is where custom techniques can be added at runtime 
-std::vector<VM::core::custom_technique> VM::core::custom_table = {
-
-}; 
-size_t VM::core::custom_table_size = 0;
-
-// the 0~100 points are debatable, but we think it's fine how it is. Feel free to disagree
-std::array<VM::core::technique, VM::enum_size + 1> VM::core::technique_table = []() {
-    std::array<VM::core::technique, VM::enum_size + 1> table{};
-    // FORMAT: { VM::<ID>, { certainty%, function pointer } },
-    const VM::core::technique_entry entries[] = {
-        // START OF TECHNIQUE TABLE
-        #if (WINDOWS)
-            {VM::TRAP, {100, VM::trap}},
-            {VM::NVRAM, {100, VM::nvram}},
-            {VM::HYPERVISOR_QUERY, {100, VM::hypervisor_query}},
-            {VM::ACPI_SIGNATURE, {100, VM::acpi_signature}},
-            {VM::CPU_HEURISTIC, {90, VM::cpu_heuristic}},
-            {VM::CLOCK, {45, VM::clock}},
-            {VM::POWER_CAPABILITIES, {45, VM::power_capabilities}},
-            {VM::GPU_CAPABILITIES, {45, VM::gpu_capabilities}},
-            {VM::KVM_INTERCEPTION, {100, VM::kvm_interception}},
-            {VM::MSR, {100, VM::msr}},
-            {VM::BOOT_LOGO, {100, VM::boot_logo}},
-            {VM::EDID, {100, VM::edid}},
-            {VM::BREAKPOINT, {100, VM::breakpoint}},
-            {VM::VIRTUAL_PROCESSORS, {100, VM::virtual_processors}},
-            {VM::WINE, {100, VM::wine}},
-            {VM::DBVM_HYPERCALL, {150, VM::dbvm_hypercall}},
-            {VM::IVSHMEM, {100, VM::ivshmem}},
-            {VM::DISK_SERIAL, {100, VM::disk_serial_number}},
-            {VM::DRIVERS, {100, VM::drivers}},
-            {VM::HANDLES, {100, VM::device_handles}},
-            {VM::KERNEL_OBJECTS, {100, VM::kernel_objects}},
-            {VM::AUDIO, {25, VM::audio}},
-            {VM::DISPLAY, {25, VM::display}},
-            {VM::DLL, {50, VM::dll}},
-            {VM::UD, {100, VM::ud}},
-            {VM::BLOCKSTEP, {100, VM::blockstep}},
-            {VM::VMWARE_BACKDOOR, {100, VM::vmware_backdoor}},
-            {VM::VIRTUAL_REGISTRY, {90, VM::virtual_registry}},
-            {VM::MUTEX, {100, VM::mutex}},
-            {VM::DEVICE_STRING, {25, VM::device_string}},
-            {VM::VPC_INVALID, {75, VM::vpc_invalid}},
-            {VM::VMWARE_STR, {35, VM::vmware_str}},
-            {VM::GAMARUE, {10, VM::gamarue}},
-            {VM::CUCKOO_DIR, {30, VM::cuckoo_dir}},
-            {VM::CUCKOO_PIPE, {30, VM::cuckoo_pipe}},
-        #endif
-
-        #if (LINUX || WINDOWS)
-            {VM::FIRMWARE, {100, VM::firmware}},
-            {VM::DEVICES, {95, VM::pci_devices}},
-            {VM::SYSTEM_REGISTERS, {50, VM::system_registers}},
-            {VM::AZURE, {30, VM::azure}},
-        #endif
-
-        #if (LINUX)
-            {VM::SMBIOS_VM_BIT, {50, VM::smbios_vm_bit}},
-            {VM::KMSG, {5, VM::kmsg}},
-            {VM::CVENDOR, {65, VM::chassis_vendor}},
-            {VM::QEMU_FW_CFG, {70, VM::qemu_fw_cfg}},
-            {VM::SYSTEMD, {35, VM::systemd_virt}},
-            {VM::CTYPE, {20, VM::chassis_type}},
-            {VM::DOCKERENV, {30, VM::dockerenv}},
-            {VM::DMIDECODE, {55, VM::dmidecode}},
-            {VM::DMESG, {55, VM::dmesg}},
-            {VM::HWMON, {35, VM::hwmon}},
-            {VM::LINUX_USER_HOST, {10, VM::linux_user_host}},
-            {VM::VMWARE_IOMEM, {65, VM::vmware_iomem}},
-            {VM::VMWARE_IOPORTS, {70, VM::vmware_ioports}},
-            {VM::VMWARE_SCSI, {40, VM::vmware_scsi}},
-            {VM::VMWARE_DMESG, {65, VM::vmware_dmesg}},
-            {VM::QEMU_VIRTUAL_DMI, {40, VM::qemu_virtual_dmi}},
-            {VM::QEMU_USB, {20, VM::qemu_USB}},
-            {VM::HYPERVISOR_DIR, {20, VM::hypervisor_dir}},
-            {VM::UML_CPU, {80, VM::uml_cpu}},
-            {VM::VBOX_MODULE, {15, VM::vbox_module}},
-            {VM::SYSINFO_PROC, {15, VM::sysinfo_proc}},
-            {VM::DMI_SCAN, {50, VM::dmi_scan}},
-            {VM::PODMAN_FILE, {5, VM::podman_file}},
-            {VM::WSL_PROC, {30, VM::wsl_proc_subdir}},
-            {VM::FILE_ACCESS_HISTORY, {15, VM::file_access_history}},
-            {VM::MAC, {20, VM::mac_address_check}},
-            {VM::NSJAIL_PID, {75, VM::nsjail_proc_id}},
-            {VM::BLUESTACKS_FOLDERS, {5, VM::bluestacks}},
-            {VM::AMD_SEV_MSR, {50, VM::amd_sev_msr}},
-            {VM::TEMPERATURE, {20, VM::temperature}},
-            {VM::PROCESSES, {40, VM::processes}},
-        #endif    
-
-        #if (LINUX || APPLE)
-            {VM::THREAD_COUNT, {35, VM::thread_count}},
-        #endif
+VM::u16 VM::technique_count = VM::base_technique_count;
+std::atomic<VM::u8>& VM::detected_count_num = VM::core::global_context.detected_count_num;
+std::atomic<VM::u16>& VM::skipped_count_num = VM::core::global_context.skipped_count_num;
 
-        #if (APPLE)
-            {VM::MAC_MEMSIZE, {15, VM::hw_memsize}},
-            {VM::MAC_IOKIT, {100, VM::io_kit}},
-            {VM::MAC_SIP, {100, VM::mac_sip}},
-            {VM::IOREG_GREP, {100, VM::ioreg_grep}},
-            {VM::HWMODEL, {100, VM::hwmodel}},
-            {VM::MAC_SYS, {100, VM::mac_sys}},
-        #endif
-
-        {VM::TIMER, {100, VM::timer}},
-        {VM::THREAD_MISMATCH, {50, VM::thread_mismatch}},
-        {VM::VMID, {100, VM::vmid}},
-        {VM::CPU_BRAND, {95, VM::cpu_brand}},
-        {VM::CPUID_SIGNATURE, {95, VM::cpuid_signature}},
-        {VM::HYPERVISOR_STR, {100, VM::hypervisor_str}},
-        {VM::HYPERVISOR_BIT, {100, VM::hypervisor_bit}},
-        {VM::BOCHS_CPU, {100, VM::bochs_cpu}},
-        {VM::KGT_SIGNATURE, {80, VM::intel_kgt_signature}}
-        // END OF TECHNIQUE TABLE
-    };
-
-    // fill the table based on ID
-    for (const auto& entry : entries) {
-        if (entry.id < table.size()) {
-            table[entry.id] = entry.tech;
-        }
-    }
-    return table;
-}();
+// the compile-time technique list is odr-used by core::technique_table(), which needs a definition below C++17
+#if (VMA_CPP < 17)
+constexpr VM::core::technique_entry VM::core::technique_list[];
+#endif
 
 #endif // include guard end
\ No newline at end of file